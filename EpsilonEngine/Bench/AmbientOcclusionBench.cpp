@@ -0,0 +1,160 @@
+#include "BenchHarness.h"
+#include "AmbientOcclusion.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	const float PROJ_Y = 1.732f;
+	const float FAR_DEPTH = 100;
+	const float SPHERE[4] = { 0.8f, -0.4f, 4, 0.6f };
+
+	//A corner of floor and walls with a ball near it, seen from the origin looking along +z
+	void RayCastScene(uint32_t width, uint32_t height, float proj_x, std::vector<float>& depth, std::vector<float>& normals)
+	{
+		depth.resize(width * height);
+		normals.resize(width * height * 3);
+		for (uint32_t y = 0; y != height; y++)
+		{
+			for (uint32_t x = 0; x != width; x++)
+			{
+				float dir[3] = { ((x + 0.5f) / width * 2 - 1) / proj_x, (1 - (y + 0.5f) / height * 2) / PROJ_Y, 1 };
+				float z = FAR_DEPTH;
+				float n[3] = { 0, 0, -1 };
+
+				//Planes y = -1, x = -2 and z = 8, the ray's z is its distance along the view axis
+				if ((dir[1] < 0) && (-1 / dir[1] < z))
+				{
+					z = -1 / dir[1];
+					n[0] = 0;
+					n[1] = 1;
+					n[2] = 0;
+				}
+				if ((dir[0] < 0) && (-2 / dir[0] < z))
+				{
+					z = -2 / dir[0];
+					n[0] = 1;
+					n[1] = 0;
+					n[2] = 0;
+				}
+				if (8 < z)
+				{
+					z = 8;
+					n[0] = 0;
+					n[1] = 0;
+					n[2] = -1;
+				}
+
+				float dd = dir[0] * dir[0] + dir[1] * dir[1] + 1;
+				float dc = dir[0] * SPHERE[0] + dir[1] * SPHERE[1] + SPHERE[2];
+				float cc = SPHERE[0] * SPHERE[0] + SPHERE[1] * SPHERE[1] + SPHERE[2] * SPHERE[2] - SPHERE[3] * SPHERE[3];
+				float disc = dc * dc - dd * cc;
+				if (disc >= 0)
+				{
+					float t = (dc - std::sqrt(disc)) / dd;
+					if ((t > 0) && (t < z))
+					{
+						z = t;
+						for (int c = 0; c != 3; c++)
+						{
+							n[c] = (dir[c] * t - SPHERE[c]) / SPHERE[3];
+						}
+					}
+				}
+
+				depth[y * width + x] = z;
+				std::copy(n, n + 3, &normals[(y * width + x) * 3]);
+			}
+		}
+	}
+}
+
+
+//SSAO quality against cost: the reference passes at each resolution divisor and sample count on a
+//ray-cast test scene, timed and compared with a full-resolution 64-sample result
+BENCHMARK(ssao)
+{
+	const uint32_t width = opts.quick ? 160 : 640;
+	const uint32_t height = opts.quick ? 90 : 360;
+	const uint32_t iterations = opts.quick ? 1 : 5;
+	const float proj_x = PROJ_Y * height / width;
+
+	std::vector<float> depth;
+	std::vector<float> normals;
+	RayCastScene(width, height, proj_x, depth, normals);
+
+	std::vector<float> ao;
+	std::vector<float> kernel;
+	auto run = [&](uint32_t downscale, uint32_t num_samples, std::vector<float>& visibility)
+	{
+		SSAOSettings settings = SSAOPreset(SQ_High);
+		settings.downscale = downscale;
+		settings.num_samples = num_samples;
+
+		kernel.resize(num_samples * 4);
+		SSAOKernel(num_samples, kernel.data());
+
+		uint32_t ao_width = SSAOTargetSize(width, downscale);
+		uint32_t ao_height = SSAOTargetSize(height, downscale);
+		ao.resize(ao_width * ao_height * 2);
+		visibility.resize(width * height);
+
+		ComputeSSAO(depth.data(), normals.data(), width, height, proj_x, PROJ_Y, settings, kernel.data(), ao.data());
+		UpsampleSSAO(ao.data(), ao_width, ao_height, depth.data(), width, height, visibility.data());
+	};
+
+	std::vector<float> reference;
+	run(1, 64, reference);
+
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+	os << "  \"width\": " << width << ",\n";
+	os << "  \"height\": " << height << ",\n";
+	os << "  \"reference\": { \"downscale\": 1, \"samples\": 64 },\n";
+	os << "  \"configs\": [";
+
+	const uint32_t downscales[] = { 1, 2, 4 };
+	const uint32_t sample_counts[] = { 4, 8, 16 };
+	bool first = true;
+	std::vector<float> visibility;
+	for (uint32_t downscale : downscales)
+	{
+		for (uint32_t num_samples : sample_counts)
+		{
+			double ms = AverageMs(iterations, [&] { run(downscale, num_samples, visibility); });
+
+			double error = 0;
+			for (size_t i = 0; i != visibility.size(); i++)
+			{
+				error += std::abs(visibility[i] - reference[i]);
+			}
+			error /= visibility.size();
+
+			//Which preset this is, if any
+			const char* preset = "";
+			for (int q = SQ_Low; q != SQ_NumQualities; q++)
+			{
+				SSAOSettings settings = SSAOPreset(static_cast<SSAOQuality>(q));
+				if ((settings.downscale == downscale) && (settings.num_samples == num_samples))
+				{
+					preset = SSAOQualityName(static_cast<SSAOQuality>(q));
+				}
+			}
+
+			os << (first ? "\n" : ",\n");
+			os << "    { \"downscale\": " << downscale << ", \"samples\": " << num_samples
+				<< ", \"preset\": \"" << preset << "\""
+				<< ", \"samples_per_pixel\": " << static_cast<double>(num_samples) / (downscale * downscale)
+				<< ", \"cpu_ms\": " << ms << ", \"mean_abs_error\": " << error << " }";
+			first = false;
+		}
+	}
+
+	os << "\n  ]\n";
+	os << "}";
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+
+namespace epsilon
+{
+	namespace bench
+	{
+
+		//Benchmarks of the platform-neutral engine code. BENCHMARK registers a function writing one JSON
+		//object; EpsilonEngineBench runs the one named on its command line, every one without, and writes
+		//them as one object keyed by name. --quick shrinks the workloads so CTest can run them as smoke tests
+
+		struct BenchOptions
+		{
+			bool quick;
+		};
+
+		typedef void (*BenchFunc)(std::ostream& os, const BenchOptions& opts);
+
+		struct BenchCase
+		{
+			const char* name;
+			BenchFunc func;
+		};
+
+		std::vector<BenchCase>& BenchCases();
+
+		struct BenchRegistrar
+		{
+			BenchRegistrar(const char* name, BenchFunc func);
+		};
+
+		//Milliseconds per call of run, after one call to warm up
+		template <typename F>
+		double AverageMs(uint32_t iterations, F run)
+		{
+			run();
+
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			for (uint32_t it = 0; it != iterations; it++)
+			{
+				run();
+			}
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+		}
+
+	}
+}
+
+
+#define BENCHMARK(name)\
+	static void name##_benchmark(std::ostream& os, const epsilon::bench::BenchOptions& opts);\
+	static epsilon::bench::BenchRegistrar name##_registrar(#name, name##_benchmark);\
+	static void name##_benchmark(std::ostream& os, const epsilon::bench::BenchOptions& opts)
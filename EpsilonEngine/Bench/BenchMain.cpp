@@ -0,0 +1,76 @@
+#include "BenchHarness.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+
+namespace epsilon
+{
+	namespace bench
+	{
+		std::vector<BenchCase>& BenchCases()
+		{
+			static std::vector<BenchCase> cases;
+			return cases;
+		}
+
+		BenchRegistrar::BenchRegistrar(const char* name, BenchFunc func)
+		{
+			BenchCase bc = { name, func };
+			BenchCases().push_back(bc);
+		}
+	}
+}
+
+
+//EpsilonEngineBench [--quick] [name], or --list for the names
+int main(int argc, char* argv[])
+{
+	using namespace epsilon::bench;
+
+	BenchOptions opts;
+	opts.quick = false;
+	const char* name = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--list"))
+		{
+			for (const auto& bc : BenchCases())
+			{
+				std::cout << bc.name << std::endl;
+			}
+			return 0;
+		}
+		else if (0 == strcmp(argv[i], "--quick"))
+		{
+			opts.quick = true;
+		}
+		else
+		{
+			name = argv[i];
+		}
+	}
+
+	int num_run = 0;
+	std::cout << "{";
+	for (const auto& bc : BenchCases())
+	{
+		if (name && strcmp(name, bc.name))
+		{
+			continue;
+		}
+
+		std::ostringstream ss;
+		bc.func(ss, opts);
+		std::cout << (num_run ? ",\n" : "\n") << "\"" << bc.name << "\": " << ss.str();
+		++num_run;
+	}
+	std::cout << "\n}" << std::endl;
+
+	if (0 == num_run)
+	{
+		std::cerr << "No benchmark named " << name << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include "BenchHarness.h"
+#include "CommandStream.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	const uint32_t WORKER_COUNTS[] = { 1, 2, 4, 8 };
+
+	//Replays into nothing, only counting, so the timing is of decoding
+	class CountingBackend : public CommandBackend
+	{
+	public:
+		CountingBackend() : calls(0) {}
+
+		virtual void SetVertexBuffer(CommandHandle, uint32_t) override { ++calls; }
+		virtual void SetIndexBuffer(CommandHandle) override { ++calls; }
+		virtual void SetTopology(PrimitiveTopology) override { ++calls; }
+		virtual void SetInputLayout(CommandHandle) override { ++calls; }
+		virtual void SetTexture(uint32_t, CommandHandle) override { ++calls; }
+		virtual void SetConstants(ConstantFrequency, const void*, uint32_t) override { ++calls; }
+		virtual void SetStaticConstants(ConstantFrequency, CommandHandle, uint32_t, const void*, uint32_t) override { ++calls; }
+		virtual void ApplyPass(CommandHandle) override { ++calls; }
+		virtual void Draw(uint32_t, uint32_t) override { ++calls; }
+		virtual void DrawIndexed(uint32_t, uint32_t, int32_t) override { ++calls; }
+
+		uint64_t calls;
+	};
+
+	//The commands of one StaticMesh draw with a material
+	void RecordMesh(CommandStream& cs, uint32_t i, const ObjectConstants& object)
+	{
+		CommandHandle h = reinterpret_cast<CommandHandle>(static_cast<uintptr_t>(i + 1));
+		cs.SetTexture(0, h);
+		cs.SetTexture(1, h);
+		cs.SetStaticConstants(CF_PerMaterial, h, i % 64 * 16, &object, sizeof(MaterialConstants));
+		cs.SetVertexBuffer(h, 32);
+		cs.SetTopology(PT_TriangleList);
+		cs.SetIndexBuffer(h);
+		cs.SetInputLayout(h);
+		cs.SetConstants(CF_PerObject, object);
+		cs.ApplyPass(h);
+		cs.DrawIndexed(3 * 1024, 0, 0);
+	}
+}
+
+
+//Recording a G-buffer pass's draws into one stream per chunk, as RenderGBuffer does, for 1 to 8
+//workers, in milliseconds and million commands a second. Then replaying them in order
+BENCHMARK(commands)
+{
+	const uint32_t num_draws = opts.quick ? 2000 : 50000;
+	const uint32_t iterations = opts.quick ? 3 : 30;
+
+	ObjectConstants object = {};
+	XMStoreFloat4x4(&object.model_mat, XMMatrixIdentity());
+
+	os << std::fixed << std::setprecision(3);
+	os << "{\n";
+	os << "  \"draws\": " << num_draws << ",\n";
+
+	size_t num_commands = 0;
+	std::vector<CommandStream> chunks;
+	os << "  \"record\": {";
+	for (size_t w = 0; w != sizeof(WORKER_COUNTS) / sizeof(WORKER_COUNTS[0]); w++)
+	{
+		JobSystem js(WORKER_COUNTS[w]);
+		uint32_t num_chunks = WORKER_COUNTS[w] + 1;
+		uint32_t chunk_size = (num_draws + num_chunks - 1) / num_chunks;
+		chunks.assign(num_chunks, CommandStream());
+
+		double ms = AverageMs(iterations, [&]()
+		{
+			js.ParallelFor(num_chunks, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t c = begin; c != end; c++)
+				{
+					CommandStream& cs = chunks[c];
+					cs.Reset();
+					uint32_t first = static_cast<uint32_t>(c) * chunk_size;
+					uint32_t last = (std::min)(first + chunk_size, num_draws);
+					for (uint32_t i = first; i < last; i++)
+					{
+						RecordMesh(cs, i, object);
+					}
+				}
+			});
+		});
+
+		num_commands = 0;
+		for (const auto& cs : chunks)
+		{
+			num_commands += cs.NumCommands();
+		}
+
+		os << (w ? ",\n" : "\n") << "    \"" << WORKER_COUNTS[w] << "\": { \"ms\": " << ms
+			<< ", \"mcommands_per_s\": " << num_commands / ms / 1000 << " }";
+	}
+	os << "\n  },\n";
+
+	CountingBackend backend;
+	double replay_ms = AverageMs(iterations, [&]()
+	{
+		for (const auto& cs : chunks)
+		{
+			cs.Replay(backend);
+		}
+	});
+	os << "  \"commands\": " << num_commands << ",\n";
+	os << "  \"replay_ms\": " << replay_ms << "\n";
+	os << "}";
+}
@@ -0,0 +1,512 @@
+#include "BenchHarness.h"
+#include "BatchMath.h"
+#include "CameraPath.h"
+#include "CommandStream.h"
+#include "FrameStats.h"
+#include "JobSystem.h"
+#include "LightBounds.h"
+#include "LightPacker.h"
+#include "MaterialParser.h"
+#include "NullBackend.h"
+#include "Profiler.h"
+#include "ShaderConstants.h"
+#include "Transform.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <string>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	//A 45 degree 16:9 perspective projection
+	const float NEAR_PLANE = 0.1f;
+	const float FAR_PLANE = 100.0f;
+	const float PROJ_X = 1.358f;
+	const float PROJ_Y = 2.414f;
+
+	//The CULL_GRAIN and GBUFFER_CHUNK_MIN of RenderEngine
+	const size_t CULL_GRAIN = 64;
+	const size_t GBUFFER_CHUNK_MIN = 64;
+
+	//Handles the null backend is given. Each kind of geometry has its own buffers, the textures follow
+	enum FakeHandle
+	{
+		FH_QuadBuffer = 1,
+		FH_QuadLayout,
+		FH_MeshLayout,
+		FH_MaterialBuffer,
+		FH_GBufferPass,
+		FH_AmbientLightingPass,
+		FH_DirectionLightingPass,
+		FH_LocalLightingPass,
+		FH_TemporalResolvePass,
+		FH_SRGBCorrectionPass,
+		FH_FirstGeometry = 0x100,
+		FH_FirstTexture = 0x10000
+	};
+
+	CommandHandle Handle(uintptr_t id)
+	{
+		return reinterpret_cast<CommandHandle>(id);
+	}
+
+	struct SceneMesh
+	{
+		TransformHandle transform;
+		float radius;
+		uint32_t geometry;
+		uint32_t num_indices;
+		uint32_t material;
+
+		//Curtains and banners sway, so their transforms change every frame
+		bool cloth;
+		float phase;
+	};
+
+	struct SceneMaterial
+	{
+		MaterialConstants constants;
+		int32_t textures[MM_NumMaps];
+	};
+
+	//Sponza's geometry isn't in the tree, only its materials, so this lays boxes out like its atrium:
+	//a tiled floor, two storeys of columns and arches around the nave, the outer walls, curtains and
+	//banners between the upper columns, and vases with plants. Torches burn on the columns
+	struct Scene
+	{
+		TransformSystem transforms;
+		std::vector<SceneMesh> meshes;
+		std::vector<SceneMaterial> materials;
+		std::vector<Vector3f> torches;
+
+		void AddMesh(uint32_t geometry, uint32_t num_triangles, uint32_t material, const Vector3f& pos,
+			const Vector3f& half_size, bool cloth = false)
+		{
+			SceneMesh mesh;
+			mesh.transform = transforms.Create();
+			transforms.SetPosition(mesh.transform, pos);
+			transforms.SetScale(mesh.transform, half_size);
+			mesh.radius = std::sqrt(half_size.x * half_size.x + half_size.y * half_size.y + half_size.z * half_size.z);
+			mesh.geometry = geometry;
+			mesh.num_indices = num_triangles * 3;
+			mesh.material = material % static_cast<uint32_t>(materials.size());
+			mesh.cloth = cloth;
+			mesh.phase = static_cast<float>(meshes.size());
+			meshes.push_back(mesh);
+		}
+	};
+
+	void BuildScene(const std::vector<MaterialDesc>& descs, const std::vector<int32_t>& map_textures, Scene& scene)
+	{
+		for (size_t i = 0; i != descs.size(); i++)
+		{
+			const MaterialDesc& desc = descs[i];
+
+			SceneMaterial material;
+			material.constants = {};
+			material.constants.albedo_clr = Vector3f(desc.albedo[0], desc.albedo[1], desc.albedo[2]);
+			material.constants.albedo_map_enabled = desc.maps[MM_Albedo].empty() ? 0 : 1;
+			material.constants.metalness_clr = Vector2f(desc.metalness, desc.maps[MM_Metalness].empty() ? 0.0f : 1.0f);
+			material.constants.glossiness_clr = Vector2f(desc.glossiness, desc.maps[MM_SpecGloss].empty() ? 0.0f : 1.0f);
+			material.constants.normal_map_enabled = desc.maps[MM_Normal].empty() ? 0 : 1;
+			std::copy(&map_textures[i * MM_NumMaps], &map_textures[i * MM_NumMaps] + MM_NumMaps, material.textures);
+			scene.materials.push_back(material);
+		}
+
+		enum Geometry
+		{
+			G_FloorTile,
+			G_ColumnBase,
+			G_ColumnShaft,
+			G_ColumnCapital,
+			G_Arch,
+			G_Wall,
+			G_Railing,
+			G_Cloth,
+			G_Vase,
+			G_Plant,
+			G_LionHead
+		};
+
+		for (int x = -8; x != 8; x++)
+		{
+			for (int z = -4; z != 4; z++)
+			{
+				scene.AddMesh(G_FloorTile, 2, 0, Vector3f(x * 2 + 1.0f, 0, z * 2 + 1.0f), Vector3f(1, 0.05f, 1));
+			}
+		}
+
+		for (int storey = 0; storey != 2; storey++)
+		{
+			float y = storey * 6.0f;
+			for (int side = -1; side <= 1; side += 2)
+			{
+				for (int c = 0; c != 9; c++)
+				{
+					float x = -12.0f + c * 3;
+					scene.AddMesh(G_ColumnBase, 96, 1, Vector3f(x, y + 0.25f, side * 4.0f), Vector3f(0.6f, 0.25f, 0.6f));
+					scene.AddMesh(G_ColumnShaft, 640, 2, Vector3f(x, y + 2.5f, side * 4.0f), Vector3f(0.4f, 2, 0.4f));
+					scene.AddMesh(G_ColumnCapital, 384, 3, Vector3f(x, y + 4.75f, side * 4.0f), Vector3f(0.7f, 0.25f, 0.7f));
+					if (0 == storey)
+					{
+						scene.torches.push_back(Vector3f(x, 3.5f, side * 3.4f));
+					}
+				}
+				for (int a = 0; a != 8; a++)
+				{
+					float x = -10.5f + a * 3;
+					scene.AddMesh(G_Arch, 1200, 4, Vector3f(x, y + 5.5f, side * 4.0f), Vector3f(1.5f, 0.5f, 0.4f));
+					if (1 == storey)
+					{
+						scene.AddMesh(G_Railing, 480, 5, Vector3f(x, y + 0.6f, side * 3.6f), Vector3f(1.4f, 0.6f, 0.1f));
+						scene.AddMesh(G_Cloth, 1800, 6 + a % 3, Vector3f(x, y + 3, side * 3.8f), Vector3f(1.2f, 2.5f, 0.05f), true);
+					}
+				}
+			}
+		}
+
+		for (int level = 0; level != 3; level++)
+		{
+			float y = level * 6 + 3.0f;
+			for (int x = -8; x != 8; x++)
+			{
+				scene.AddMesh(G_Wall, 12, 9, Vector3f(x * 2 + 1.0f, y, -8), Vector3f(1, 3, 0.2f));
+				scene.AddMesh(G_Wall, 12, 9, Vector3f(x * 2 + 1.0f, y, 8), Vector3f(1, 3, 0.2f));
+			}
+			for (int z = -4; z != 4; z++)
+			{
+				scene.AddMesh(G_Wall, 12, 10, Vector3f(-16, y, z * 2 + 1.0f), Vector3f(0.2f, 3, 1));
+				scene.AddMesh(G_Wall, 12, 10, Vector3f(16, y, z * 2 + 1.0f), Vector3f(0.2f, 3, 1));
+			}
+		}
+
+		//Banners hanging from the top of the nave's ends
+		for (int b = 0; b != 8; b++)
+		{
+			float z = -3.5f + b;
+			scene.AddMesh(G_Cloth, 1800, 11 + b % 2, Vector3f((b & 1) ? 14.0f : -14.0f, 14, z), Vector3f(0.05f, 3, 0.4f), true);
+		}
+
+		for (int v = 0; v != 14; v++)
+		{
+			float x = -10.5f + (v / 2) * 3;
+			float z = (v & 1) ? 5.5f : -5.5f;
+			scene.AddMesh(G_Vase, 2400, 13, Vector3f(x, 0.6f, z), Vector3f(0.5f, 0.6f, 0.5f));
+			scene.AddMesh(G_Plant, 3600, 14, Vector3f(x, 1.6f, z), Vector3f(0.8f, 0.6f, 0.8f));
+		}
+
+		scene.AddMesh(G_LionHead, 9000, 15, Vector3f(15.6f, 4, 0), Vector3f(0.3f, 1, 1));
+		scene.AddMesh(G_LionHead, 9000, 15, Vector3f(-15.6f, 4, 0), Vector3f(0.3f, 1, 1));
+
+		scene.transforms.Update();
+	}
+
+	//Looking from eye at at, y up, row-major for row vectors
+	void LookAtMatrix(const Vector3f& eye, const Vector3f& at, float view[16])
+	{
+		Vector3f f = Normalize(at - eye);
+		Vector3f r = Normalize(CrossProduct3(Vector3f(0, 1, 0), f));
+		Vector3f u = CrossProduct3(f, r);
+		const Vector3f* axes[3] = { &r, &u, &f };
+		for (int row = 0; row != 3; row++)
+		{
+			for (int col = 0; col != 3; col++)
+			{
+				view[row * 4 + col] = (&axes[col]->x)[row];
+			}
+			view[row * 4 + 3] = 0;
+		}
+		for (int col = 0; col != 3; col++)
+		{
+			view[12 + col] = -(axes[col]->x * eye.x + axes[col]->y * eye.y + axes[col]->z * eye.z);
+		}
+		view[15] = 1;
+	}
+
+	void ProjMatrix(float proj[16])
+	{
+		std::fill(proj, proj + 16, 0.0f);
+		proj[0] = PROJ_X;
+		proj[5] = PROJ_Y;
+		proj[10] = FAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+		proj[11] = 1;
+		proj[14] = -NEAR_PLANE * FAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+	}
+
+	//What StaticMesh::Render records for a mesh in the G-buffer pass
+	void RecordMesh(CommandStream& cs, const Scene& scene, const SceneMesh& mesh)
+	{
+		const SceneMaterial& material = scene.materials[mesh.material];
+		for (uint32_t m = 0; m != MM_NumMaps; m++)
+		{
+			if (material.textures[m] >= 0)
+			{
+				cs.SetTexture(m, Handle(FH_FirstTexture + material.textures[m]));
+			}
+		}
+		cs.SetStaticConstants(CF_PerMaterial, Handle(FH_MaterialBuffer), mesh.material * 16, material.constants);
+
+		cs.SetVertexBuffer(Handle(FH_FirstGeometry + mesh.geometry * 2), 32);
+		cs.SetTopology(PT_TriangleList);
+		cs.SetIndexBuffer(Handle(FH_FirstGeometry + mesh.geometry * 2 + 1));
+		cs.SetInputLayout(Handle(FH_MeshLayout));
+
+		ObjectConstants constants;
+		constants.model_mat = scene.transforms.WorldMatrix(mesh.transform);
+		cs.SetConstants(CF_PerObject, constants);
+
+		cs.ApplyPass(Handle(FH_GBufferPass));
+
+		cs.DrawIndexed(mesh.num_indices, 0, 0);
+	}
+
+	//And what Quad::Render records for a full-screen pass
+	void RecordQuad(CommandStream& cs, FakeHandle pass)
+	{
+		cs.SetVertexBuffer(Handle(FH_QuadBuffer), sizeof(Vector3f));
+		cs.SetTopology(PT_TriangleStrip);
+		cs.SetInputLayout(Handle(FH_QuadLayout));
+		cs.ApplyPass(Handle(pass));
+		cs.Draw(4, 0);
+	}
+}
+
+
+//The CPU side of rendering a Sponza-like scene along the benchmark camera path, against the null backend:
+//culling, light packing and recording each pass's commands as RenderEngine does, with the same frame time
+//percentiles, per-pass milliseconds and render counters the D3D11 -benchmark mode writes
+BENCHMARK(frame)
+{
+	const uint32_t num_frames = opts.quick ? 30 : 1000;
+	const uint32_t num_warmup_frames = opts.quick ? 5 : 30;
+
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+
+	std::vector<MaterialDesc> descs;
+	std::vector<MaterialDesc> unique;
+	std::vector<uint32_t> remap;
+	std::vector<std::string> textures;
+	std::vector<int32_t> map_textures;
+	if (!LoadMTL(EPSILON_MEDIA_DIR "/Model/Sponza/Sponza.mtl", descs))
+	{
+		os << "  \"error\": \"no materials\"\n";
+		os << "}";
+		return;
+	}
+	DedupeMaterials(descs, unique, remap);
+	CollectMaterialTextures(unique, textures, map_textures);
+
+	Scene scene;
+	BuildScene(unique, map_textures, scene);
+	size_t num_meshes = scene.meshes.size();
+
+	CameraPath path = SponzaBenchmarkPath();
+	JobSystem js;
+	LightPacker packer;
+	RenderStatistics stats;
+	FrameStats frame_stats;
+	frame_stats.Reserve(num_frames);
+
+	std::vector<float> centers(num_meshes * 3);
+	std::vector<float> centers_es(num_meshes * 3);
+	std::vector<uint8_t> visible(num_meshes);
+	std::vector<uint32_t> draws;
+	draws.reserve(num_meshes);
+
+	//One stream and backend per recording job, as RenderGBuffer has a deferred context each
+	std::vector<CommandStream> gbuffer_css(js.NumWorkers() + 1);
+	std::vector<NullBackend> gbuffer_backends(gbuffer_css.size());
+	CommandStream imm_cs;
+	NullBackend imm_backend;
+
+	std::vector<PassTiming> passes;
+	auto timed = [&passes](const char* name, uint64_t begin_ns)
+	{
+		PassTiming timing;
+		timing.name = name;
+		timing.cpu_ms = (TraceBuffer::NowNs() - begin_ns) / 1e6;
+		timing.gpu_ms = 0;
+		passes.push_back(timing);
+	};
+	auto flush = [&imm_cs, &imm_backend]()
+	{
+		imm_cs.Replay(imm_backend);
+		imm_cs.Reset();
+	};
+
+	FrameConstants frame_constants = {};
+	XMFLOAT4X4 proj;
+	ProjMatrix(&proj.m[0][0]);
+	frame_constants.proj_mat = proj;
+	frame_constants.near_q_far = Vector4f(NEAR_PLANE, FAR_PLANE / (FAR_PLANE - NEAR_PLANE), FAR_PLANE, 0);
+	frame_constants.tc_scale = Vector2f(1, 1);
+
+	const float torch_falloff[3] = { 1, 0, 1 };
+	const float torch_range = 6;
+
+	stats.EndFrame();
+	for (uint32_t frame = 0; frame != num_warmup_frames + num_frames; frame++)
+	{
+		uint64_t frame_begin_ns = TraceBuffer::NowNs();
+		passes.clear();
+
+		float t = 0;
+		if ((frame >= num_warmup_frames) && (num_frames > 1))
+		{
+			t = static_cast<float>(frame - num_warmup_frames) / (num_frames - 1);
+		}
+		CameraKey key = path.Evaluate(t);
+		XMFLOAT4X4 view;
+		LookAtMatrix(key.eye, key.at, &view.m[0][0]);
+
+		//Move the cloth, then cull every mesh's bounding sphere against the view
+		uint64_t begin_ns = TraceBuffer::NowNs();
+		for (const auto& mesh : scene.meshes)
+		{
+			if (mesh.cloth)
+			{
+				float angle = std::sin(frame * 0.05f + mesh.phase) * 0.1f;
+				scene.transforms.SetRotation(mesh.transform, Vector4f(std::sin(angle / 2), 0, 0, std::cos(angle / 2)));
+			}
+		}
+		scene.transforms.Update();
+
+		for (size_t i = 0; i != num_meshes; i++)
+		{
+			const XMFLOAT4X4& world = scene.transforms.WorldMatrix(scene.meshes[i].transform);
+			std::copy(&world.m[3][0], &world.m[3][0] + 3, &centers[i * 3]);
+		}
+		TransformCoords(&view.m[0][0], centers.data(), centers_es.data(), num_meshes);
+
+		js.ParallelFor(num_meshes, CULL_GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i != end; i++)
+			{
+				float rect[4];
+				visible[i] = SphereScreenRect(&centers_es[i * 3], scene.meshes[i].radius, NEAR_PLANE, PROJ_X, PROJ_Y, rect) ? 1 : 0;
+			}
+		});
+
+		draws.clear();
+		for (uint32_t i = 0; i != num_meshes; i++)
+		{
+			if (visible[i])
+			{
+				draws.push_back(i);
+			}
+		}
+		timed("Update", begin_ns);
+
+		//Flickering torches, packed in view space and uploaded where they changed
+		begin_ns = TraceBuffer::NowNs();
+		packer.Clear();
+		for (size_t i = 0; i != scene.torches.size(); i++)
+		{
+			float flicker = 0.8f + 0.2f * std::sin(frame * 0.3f + i * 1.7f);
+			const float color[3] = { flicker, flicker * 0.6f, flicker * 0.3f };
+			const float dir[3] = { 0, -1, 0 };
+			const float* pos = &scene.torches[i].x;
+			packer.Add(pos, dir, torch_range, -2, -1, color, torch_falloff, pos, torch_range);
+		}
+		packer.Pack(&view.m[0][0], NEAR_PLANE, PROJ_X, PROJ_Y);
+		for (const auto& range : packer.DirtyRanges())
+		{
+			RenderStatistics::Add(SC_LightBufferBytes, range.count * sizeof(PackedLight));
+		}
+		timed("LightPacking", begin_ns);
+
+		frame_constants.view_mat = view;
+		frame_constants.num_lights = static_cast<uint32_t>(packer.NumLights());
+
+		//Contiguous chunks recorded and replayed by one job each
+		begin_ns = TraceBuffer::NowNs();
+		size_t num_chunks = (std::max)((std::min)(gbuffer_css.size(), draws.size() / GBUFFER_CHUNK_MIN), static_cast<size_t>(1));
+		size_t chunk_size = (draws.size() + num_chunks - 1) / num_chunks;
+		js.ParallelFor(num_chunks, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c != end; c++)
+			{
+				CommandStream& cs = gbuffer_css[c];
+				NullBackend& backend = gbuffer_backends[c];
+
+				cs.Reset();
+				size_t first = c * chunk_size;
+				size_t last = (std::min)(first + chunk_size, draws.size());
+				for (size_t i = first; i < last; i++)
+				{
+					RecordMesh(cs, scene, scene.meshes[draws[i]]);
+				}
+
+				backend.Reset();
+				backend.SetConstants(CF_PerFrame, &frame_constants, sizeof(frame_constants));
+				cs.Replay(backend);
+			}
+		});
+		timed("GBuffer", begin_ns);
+
+		imm_backend.Reset();
+		imm_cs.SetConstants(CF_PerFrame, frame_constants);
+
+		begin_ns = TraceBuffer::NowNs();
+		LightConstants ambient = {};
+		ambient.light_color = Vector3f(0.1f, 0.1f, 0.12f);
+		imm_cs.SetConstants(CF_PerLight, ambient);
+		RecordQuad(imm_cs, FH_AmbientLightingPass);
+		flush();
+		timed("AmbientLighting", begin_ns);
+
+		begin_ns = TraceBuffer::NowNs();
+		LightConstants sun = {};
+		sun.light_dir_es = Normalize(TransformNormal(Vector3f(0.3f, -1, 0.2f), Matrix(&view.m[0][0])));
+		sun.light_color = Vector3f(3, 2.8f, 2.5f);
+		sun.num_cascades = static_cast<float>(MAX_SHADOW_CASCADES);
+		imm_cs.SetConstants(CF_PerLight, sun);
+		RecordQuad(imm_cs, FH_DirectionLightingPass);
+		flush();
+		timed("DirectionLighting", begin_ns);
+
+		if (packer.NumLights() > 0)
+		{
+			begin_ns = TraceBuffer::NowNs();
+			RenderStatistics::Add(SC_TextureBinds);
+			RecordQuad(imm_cs, FH_LocalLightingPass);
+			flush();
+			timed("LocalLighting", begin_ns);
+		}
+
+		begin_ns = TraceBuffer::NowNs();
+		PassConstants pass_constants = {};
+		pass_constants.render_size = Vector2f(1280, 720);
+		pass_constants.taa_blend = 0.1f;
+		pass_constants.taa_prev_tc_scale = Vector2f(1, 1);
+		imm_cs.SetConstants(CF_PerPass, pass_constants);
+		RecordQuad(imm_cs, FH_TemporalResolvePass);
+		flush();
+		timed("TemporalResolve", begin_ns);
+
+		begin_ns = TraceBuffer::NowNs();
+		RecordQuad(imm_cs, FH_SRGBCorrectionPass);
+		flush();
+		timed("SRGBCorrection", begin_ns);
+
+		double frame_ms = (TraceBuffer::NowNs() - frame_begin_ns) / 1e6;
+		stats.EndFrame();
+		if (frame >= num_warmup_frames)
+		{
+			frame_stats.Sample(frame_ms, passes, stats);
+		}
+	}
+
+	os << "  \"meshes\": " << num_meshes << ",\n";
+	os << "  \"materials\": " << unique.size() << ",\n";
+	os << "  \"textures\": " << textures.size() << ",\n";
+	os << "  \"lights\": " << scene.torches.size() << ",\n";
+	os << "  \"threads\": " << js.NumWorkers() + 1 << ",\n";
+	frame_stats.WriteJsonMembers(os, num_warmup_frames);
+	os << "}";
+}
@@ -0,0 +1,152 @@
+#include "BenchHarness.h"
+#include "BatchMath.h"
+#include "ImageBasedLighting.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	//Directions the results are checked in, and the floor under the reference so the dark ground doesn't
+	//dominate the relative error
+	const uint32_t NUM_DIRECTIONS = 64;
+	const float ERROR_FLOOR = 0.05f;
+
+	//Fibonacci sphere
+	std::vector<std::array<float, 3>> SphereDirections()
+	{
+		std::vector<std::array<float, 3>> dirs(NUM_DIRECTIONS);
+		for (uint32_t i = 0; i != NUM_DIRECTIONS; i++)
+		{
+			float y = 1 - (i + 0.5f) * 2 / NUM_DIRECTIONS;
+			float r = std::sqrt(1 - y * y);
+			float phi = i * 2.39996323f;
+			dirs[i] = { { r * std::cos(phi), y, r * std::sin(phi) } };
+		}
+		return dirs;
+	}
+}
+
+
+//Milliseconds to project the built-in sky onto SH9 and to prefilter its specular mips, at every SIMD level
+//the kernels have, on one thread and on a job system, how far each run is from the scalar one, and how
+//far the results are from integrals over every texel
+BENCHMARK(ibl)
+{
+	const uint32_t size = opts.quick ? 32 : 128;
+	const uint32_t num_samples = opts.quick ? 16 : 64;
+	const uint32_t iterations = opts.quick ? 1 : 3;
+
+	Cubemap sky;
+	BuildSkyCubemap(size, sky);
+
+	JobSystem js;
+
+	os << std::fixed << std::setprecision(6);
+	os << "{\n";
+	os << "  \"size\": " << size << ",\n";
+	os << "  \"samples\": " << num_samples << ",\n";
+	os << "  \"threads\": " << js.NumWorkers() + 1 << ",\n";
+	os << "  \"runs\": [";
+
+	float sh[SH_COEFFICIENTS][3];
+	std::vector<Cubemap> mips;
+	std::vector<float> reference_sh;
+	std::vector<Cubemap> reference_mips;
+
+	//AVX2 runs the SSE2 kernels
+	SIMDLevel detected = DetectSIMDLevel();
+	bool first = true;
+	for (int level = SL_Scalar; level <= (std::min)(detected, SL_SSE2); level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+
+		for (int threaded = 0; threaded != 2; threaded++)
+		{
+			JobSystem* jobs = threaded ? &js : nullptr;
+
+			double sh_ms = AverageMs(iterations, [&] { ProjectSH9(sky, sh, jobs); });
+			double prefilter_ms = AverageMs(iterations, [&] { PrefilterSpecular(sky, num_samples, mips, jobs); });
+
+			if (reference_sh.empty())
+			{
+				reference_sh.assign(&sh[0][0], &sh[0][0] + SH_COEFFICIENTS * 3);
+				reference_mips = mips;
+			}
+			double sh_diff = 0;
+			for (size_t i = 0; i != reference_sh.size(); i++)
+			{
+				sh_diff = (std::max)(sh_diff, static_cast<double>(std::abs((&sh[0][0])[i] - reference_sh[i])));
+			}
+			double prefilter_diff = 0;
+			for (size_t m = 0; m != mips.size(); m++)
+			{
+				for (size_t i = 0; i != mips[m].texels.size(); i++)
+				{
+					prefilter_diff = (std::max)(prefilter_diff,
+						static_cast<double>(std::abs(mips[m].texels[i] - reference_mips[m].texels[i])));
+				}
+			}
+
+			os << (first ? "\n" : ",\n");
+			os << "    { \"simd\": \"" << SIMDLevelName(static_cast<SIMDLevel>(level)) << "\""
+				<< ", \"threaded\": " << (threaded ? "true" : "false")
+				<< ", \"sh_projection_ms\": " << sh_ms << ", \"prefilter_ms\": " << prefilter_ms
+				<< ", \"sh_max_abs_diff_vs_scalar\": " << sh_diff
+				<< ", \"prefilter_max_abs_diff_vs_scalar\": " << prefilter_diff << " }";
+			first = false;
+		}
+	}
+	ForceSIMDLevel(detected);
+
+	os << "\n  ],\n";
+
+	std::vector<std::array<float, 3>> dirs = SphereDirections();
+
+	ProjectSH9(sky, sh, &js);
+	ConvolveSH9Irradiance(sh);
+	double irradiance_err = 0;
+	for (const auto& dir : dirs)
+	{
+		float approx[3];
+		float reference[3];
+		EvaluateSH9(sh, dir.data(), approx);
+		ReferenceIrradiance(sky, dir.data(), reference);
+		for (int c = 0; c != 3; c++)
+		{
+			irradiance_err = (std::max)(irradiance_err, static_cast<double>(std::abs(approx[c] - reference[c]) / (reference[c] + ERROR_FLOOR)));
+		}
+	}
+	os << "  \"irradiance_max_rel_error\": " << irradiance_err << ",\n";
+
+	PrefilterSpecular(sky, num_samples, mips, &js);
+	os << "  \"specular_mips\": [";
+	for (uint32_t m = 1; m < mips.size(); m++)
+	{
+		float roughness = SpecularMipRoughness(m, static_cast<uint32_t>(mips.size()));
+		double specular_err = 0;
+		for (const auto& dir : dirs)
+		{
+			float approx[4];
+			float reference[3];
+			SampleCubemap(mips[m], dir.data(), approx);
+			ReferenceSpecular(sky, dir.data(), roughness, reference);
+			for (int c = 0; c != 3; c++)
+			{
+				specular_err = (std::max)(specular_err, static_cast<double>(std::abs(approx[c] - reference[c]) / (reference[c] + ERROR_FLOOR)));
+			}
+		}
+
+		os << (m != 1 ? ",\n" : "\n");
+		os << "    { \"size\": " << mips[m].size << ", \"roughness\": " << roughness
+			<< ", \"max_rel_error\": " << specular_err << " }";
+	}
+	os << "\n  ]\n";
+	os << "}";
+}
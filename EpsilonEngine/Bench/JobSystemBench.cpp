@@ -0,0 +1,136 @@
+#include "BenchHarness.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <future>
+#include <iomanip>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	const uint32_t WORKER_COUNTS[] = { 1, 2, 4, 8 };
+
+	//A few hundred nanoseconds of arithmetic, enough to be a job and short enough that scheduling shows
+	uint32_t SmallWork(uint32_t seed)
+	{
+		for (int i = 0; i != 64; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+		}
+		return seed;
+	}
+}
+
+
+//Nanoseconds per job, spawning from the main thread and from inside a job whose children the other
+//workers have to steal, against a std::async per job. Also a ParallelFor against one std::async per
+//chunk of the same work
+BENCHMARK(jobs)
+{
+	const uint32_t num_jobs = opts.quick ? 2000 : 100000;
+	const uint32_t num_async = opts.quick ? 200 : 5000;
+	const uint32_t iterations = opts.quick ? 2 : 10;
+	const uint32_t num_items = opts.quick ? 1 << 14 : 1 << 20;
+
+	os << std::fixed << std::setprecision(2);
+	os << "{\n";
+	os << "  \"jobs\": " << num_jobs << ",\n";
+
+	std::atomic<uint32_t> sink(0);
+
+	double async_spawn_ms = AverageMs(iterations, [&]()
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(num_async);
+		for (uint32_t i = 0; i != num_async; i++)
+		{
+			futures.push_back(std::async(std::launch::async, [&sink, i]() { sink.fetch_add(SmallWork(i), std::memory_order_relaxed); }));
+		}
+		for (auto& f : futures)
+		{
+			f.get();
+		}
+	});
+	os << "  \"std_async_ns_per_job\": " << async_spawn_ms * 1e6 / num_async << ",\n";
+
+	double async_for_ms = AverageMs(iterations, [&]()
+	{
+		uint32_t chunks = (std::max)(std::thread::hardware_concurrency(), 1u);
+		uint32_t per_chunk = (num_items + chunks - 1) / chunks;
+		std::vector<std::future<void>> futures;
+		for (uint32_t begin = 0; begin < num_items; begin += per_chunk)
+		{
+			uint32_t end = (std::min)(begin + per_chunk, num_items);
+			futures.push_back(std::async(std::launch::async, [&sink, begin, end]()
+			{
+				uint32_t acc = 0;
+				for (uint32_t i = begin; i != end; i++)
+				{
+					acc += SmallWork(i);
+				}
+				sink.fetch_add(acc, std::memory_order_relaxed);
+			}));
+		}
+		for (auto& f : futures)
+		{
+			f.get();
+		}
+	});
+	os << "  \"std_async_parallel_for_ms\": " << async_for_ms << ",\n";
+
+	os << "  \"workers\": {";
+	for (size_t w = 0; w != sizeof(WORKER_COUNTS) / sizeof(WORKER_COUNTS[0]); w++)
+	{
+		JobSystem js(WORKER_COUNTS[w]);
+
+		double spawn_ms = AverageMs(iterations, [&]()
+		{
+			JobCounter counter;
+			for (uint32_t i = 0; i != num_jobs; i++)
+			{
+				js.Run([&sink, i]() { sink.fetch_add(SmallWork(i), std::memory_order_relaxed); }, &counter);
+			}
+			js.Wait(counter);
+		});
+
+		//The children land on the spawning job's deque, everyone else steals them
+		double steal_ms = AverageMs(iterations, [&]()
+		{
+			JobCounter root;
+			js.Run([&]()
+			{
+				JobCounter children;
+				for (uint32_t i = 0; i != num_jobs; i++)
+				{
+					js.Run([&sink, i]() { sink.fetch_add(SmallWork(i), std::memory_order_relaxed); }, &children);
+				}
+				js.Wait(children);
+			}, &root);
+			js.Wait(root);
+		});
+
+		double for_ms = AverageMs(iterations, [&]()
+		{
+			js.ParallelFor(num_items, 1024, [&sink](size_t begin, size_t end)
+			{
+				uint32_t acc = 0;
+				for (size_t i = begin; i != end; i++)
+				{
+					acc += SmallWork(static_cast<uint32_t>(i));
+				}
+				sink.fetch_add(acc, std::memory_order_relaxed);
+			});
+		});
+
+		os << (w ? ",\n" : "\n") << "    \"" << WORKER_COUNTS[w] << "\": {\n";
+		os << "      \"spawn_ns_per_job\": " << spawn_ms * 1e6 / num_jobs << ",\n";
+		os << "      \"steal_ns_per_job\": " << steal_ms * 1e6 / num_jobs << ",\n";
+		os << "      \"parallel_for_ms\": " << for_ms << "\n";
+		os << "    }";
+	}
+	os << "\n  }\n";
+	os << "}";
+}
@@ -0,0 +1,151 @@
+#include "BenchHarness.h"
+#include "BatchMath.h"
+#include "LightPacker.h"
+#include <cmath>
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	//A 45 degree 16:9 perspective projection
+	const float NEAR_PLANE = 0.1f;
+	const float PROJ_X = 1.358f;
+	const float PROJ_Y = 2.414f;
+
+	//Camera at (0, 5, 0) looking along +z turned by yaw around y, row-major for row vectors
+	void ViewMatrix(float yaw, float view[16])
+	{
+		const float eye[3] = { 0, 5, 0 };
+		float r[3] = { std::cos(yaw), 0, -std::sin(yaw) };
+		float u[3] = { 0, 1, 0 };
+		float f[3] = { std::sin(yaw), 0, std::cos(yaw) };
+		const float* axes[3] = { r, u, f };
+		for (int row = 0; row != 3; row++)
+		{
+			for (int col = 0; col != 3; col++)
+			{
+				view[row * 4 + col] = axes[col][row];
+			}
+			view[row * 4 + 3] = 0;
+		}
+		for (int col = 0; col != 3; col++)
+		{
+			view[12 + col] = -(axes[col][0] * eye[0] + axes[col][1] * eye[1] + axes[col][2] * eye[2]);
+		}
+		view[15] = 1;
+	}
+}
+
+
+//Microseconds to collect and pack a frame's lights, and the lights and bytes left to upload, with a moving
+//camera (every light changes) and a still one where a percent of the lights move, at every SIMD level
+BENCHMARK(lights)
+{
+	const size_t num_lights = opts.quick ? 1000 : 10000;
+	const uint32_t iterations = opts.quick ? 3 : 200;
+
+	//Spread along a 100 x 20 x 100 box in front of the camera, every other light is a spot
+	std::vector<float> pos(num_lights * 3);
+	std::vector<float> dir(num_lights * 3);
+	for (size_t i = 0; i != num_lights; i++)
+	{
+		float f = static_cast<float>(i);
+		pos[i * 3 + 0] = std::sin(f * 0.37f) * 50;
+		pos[i * 3 + 1] = std::cos(f * 0.11f) * 10 + 10;
+		pos[i * 3 + 2] = std::sin(f * 0.73f) * 50 + 60;
+		dir[i * 3 + 0] = std::cos(f);
+		dir[i * 3 + 1] = -1;
+		dir[i * 3 + 2] = std::sin(f);
+	}
+	NormalizeVectors(dir.data(), dir.data(), num_lights);
+
+	const float color[3] = { 1, 0.9f, 0.8f };
+	const float falloff[3] = { 1, 0, 1 };
+	const float range = 8;
+
+	LightPacker packer;
+	auto pack = [&](uint32_t frame, bool move_camera)
+	{
+		packer.Clear();
+		for (size_t i = 0; i != num_lights; i++)
+		{
+			float p[3] = { pos[i * 3 + 0], pos[i * 3 + 1], pos[i * 3 + 2] };
+			if (!move_camera && (i % 100 == frame % 100))
+			{
+				p[1] += std::sin(static_cast<float>(frame));
+			}
+
+			if (i & 1)
+			{
+				packer.Add(p, &dir[i * 3], range, 0.7f, 0.9f, color, falloff, p, range);
+			}
+			else
+			{
+				packer.Add(p, &dir[i * 3], range, -2, -1, color, falloff, p, range);
+			}
+		}
+
+		float view[16];
+		ViewMatrix(move_camera ? frame * 0.01f : 0, view);
+		packer.Pack(view, NEAR_PLANE, PROJ_X, PROJ_Y);
+	};
+
+	auto run = [&](bool move_camera, double& us_per_pack, double& dirty_lights, double& upload_calls)
+	{
+		pack(0, move_camera);
+
+		uint64_t total_dirty = 0;
+		uint64_t total_calls = 0;
+		double us = 0;
+		for (uint32_t it = 1; it <= iterations; it++)
+		{
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			pack(it, move_camera);
+			us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+			total_dirty += packer.NumDirtyLights();
+			total_calls += packer.DirtyRanges().size();
+		}
+		us_per_pack = us / iterations;
+		dirty_lights = static_cast<double>(total_dirty) / iterations;
+		upload_calls = static_cast<double>(total_calls) / iterations;
+	};
+
+	os << std::fixed << std::setprecision(2);
+	os << "{\n";
+	os << "  \"lights\": " << num_lights << ",\n";
+	os << "  \"iterations\": " << iterations << ",\n";
+	os << "  \"light_bytes\": " << sizeof(PackedLight) << ",\n";
+	os << "  \"levels\": [";
+
+	SIMDLevel detected = DetectSIMDLevel();
+	for (int level = SL_Scalar; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+
+		os << (level != SL_Scalar ? ",\n" : "\n");
+		os << "    { \"simd\": \"" << SIMDLevelName(static_cast<SIMDLevel>(level)) << "\"";
+
+		const char* names[] = { "still_camera", "moving_camera" };
+		for (int move_camera = 0; move_camera != 2; move_camera++)
+		{
+			double us_per_pack;
+			double dirty_lights;
+			double upload_calls;
+			run(move_camera != 0, us_per_pack, dirty_lights, upload_calls);
+
+			os << ", \"" << names[move_camera] << "\": { \"us_per_pack\": " << us_per_pack
+				<< ", \"dirty_lights\": " << dirty_lights
+				<< ", \"upload_bytes\": " << dirty_lights * sizeof(PackedLight)
+				<< ", \"upload_calls\": " << upload_calls << " }";
+		}
+		os << " }";
+	}
+	ForceSIMDLevel(detected);
+
+	os << "\n  ]\n";
+	os << "}";
+}
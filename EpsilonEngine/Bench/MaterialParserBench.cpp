@@ -0,0 +1,61 @@
+#include "BenchHarness.h"
+#include "MaterialParser.h"
+#include <iomanip>
+#include <string>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+//Sponza's materials and how many are left after DedupeMaterials, the textures they load and the maps each
+//slot gets, with the milliseconds to load the file, looking for the maps on disk included, and to dedupe
+BENCHMARK(materials)
+{
+	const std::string mtl_path = EPSILON_MEDIA_DIR "/Model/Sponza/Sponza.mtl";
+	const uint32_t iterations = opts.quick ? 5 : 100;
+
+	std::vector<MaterialDesc> materials;
+	std::vector<MaterialDesc> unique;
+	std::vector<uint32_t> remap;
+	std::vector<std::string> textures;
+	std::vector<int32_t> map_textures;
+
+	os << std::fixed << std::setprecision(3);
+	os << "{\n";
+	if (!LoadMTL(mtl_path, materials))
+	{
+		os << "  \"error\": \"no materials\"\n";
+		os << "}";
+		return;
+	}
+
+	double load_ms = AverageMs(iterations, [&] { LoadMTL(mtl_path, materials); });
+	double dedupe_ms = AverageMs(iterations, [&]
+	{
+		DedupeMaterials(materials, unique, remap);
+		CollectMaterialTextures(unique, textures, map_textures);
+	});
+
+	const char* MAP_NAMES[MM_NumMaps] = { "albedo", "normal", "spec_gloss", "metalness" };
+	uint32_t num_maps[MM_NumMaps] = {};
+	for (const auto& desc : unique)
+	{
+		for (int m = 0; m != MM_NumMaps; m++)
+		{
+			num_maps[m] += desc.maps[m].empty() ? 0 : 1;
+		}
+	}
+
+	os << "  \"materials\": " << materials.size() << ",\n";
+	os << "  \"unique_materials\": " << unique.size() << ",\n";
+	os << "  \"textures\": " << textures.size() << ",\n";
+	os << "  \"unique_materials_with_map\": {";
+	for (int m = 0; m != MM_NumMaps; m++)
+	{
+		os << (m ? ", " : " ") << "\"" << MAP_NAMES[m] << "\": " << num_maps[m];
+	}
+	os << " },\n";
+	os << "  \"load_ms\": " << load_ms << ",\n";
+	os << "  \"dedupe_ms\": " << dedupe_ms << "\n";
+	os << "}";
+}
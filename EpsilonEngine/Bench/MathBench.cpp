@@ -0,0 +1,68 @@
+#include "BenchHarness.h"
+#include "Utils.h"
+#include <cmath>
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+//Million vectors per second through per-element TransformCoord and through the batched path at every
+//SIMD level the CPU has
+BENCHMARK(math)
+{
+	const size_t num_vectors = opts.quick ? 1 << 12 : 1 << 16;
+	const uint32_t iterations = opts.quick ? 3 : 200;
+
+	std::vector<Vector3f> in(num_vectors);
+	std::vector<Vector3f> out(num_vectors);
+	for (size_t i = 0; i != num_vectors; i++)
+	{
+		float f = static_cast<float>(i);
+		in[i] = Vector3f(std::sin(f), std::cos(f * 0.7f), f * 1e-3f);
+	}
+
+	//A rotation and translation, then a 45 degree 16:9 perspective projection, so every point has its own w
+	Matrix proj(1.358f, 0, 0, 0,
+		0, 2.414f, 0, 0,
+		0, 0, 1.0002f, 1,
+		0, 0, -0.10002f, 0);
+	Matrix mat;
+	mat = XMMatrixMultiply(XMMatrixMultiply(XMMatrixRotationQuaternion(Normalize(Vector4f(0.3f, 0.5f, -0.2f, 0.8f)).XMV()),
+		XMMatrixTranslation(1, 2, 3)), proj);
+
+	auto mvecs_per_sec = [num_vectors](double ms)
+	{
+		return static_cast<double>(num_vectors) / (ms * 1000);
+	};
+
+	double per_element = mvecs_per_sec(AverageMs(iterations, [&]()
+	{
+		for (size_t i = 0; i != num_vectors; i++)
+		{
+			out[i] = TransformCoord(in[i], mat);
+		}
+	}));
+
+	os << std::fixed << std::setprecision(2);
+	os << "{\n";
+	os << "  \"vectors\": " << num_vectors << ",\n";
+	os << "  \"iterations\": " << iterations << ",\n";
+	os << "  \"transform_coord_mvecs_per_sec\": {\n";
+	os << "    \"per_element\": " << per_element;
+
+	SIMDLevel detected = DetectSIMDLevel();
+	for (int level = SL_Scalar; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+		double batched = mvecs_per_sec(AverageMs(iterations, [&]()
+		{
+			TransformCoords(in.data(), out.data(), num_vectors, mat);
+		}));
+		os << ",\n    \"batched_" << SIMDLevelName(static_cast<SIMDLevel>(level)) << "\": " << batched;
+	}
+	ForceSIMDLevel(detected);
+
+	os << "\n  }\n";
+	os << "}";
+}
@@ -0,0 +1,139 @@
+#include "BenchHarness.h"
+#include "BatchMath.h"
+#include "PostProcess.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	const uint32_t LUT_SIZE = 16;
+
+	//A dim gradient with bright discs, the kind of input the bright pass is there to pick from
+	std::vector<float> TestImage(uint32_t width, uint32_t height)
+	{
+		std::vector<float> scene(width * height * 4);
+		for (uint32_t y = 0; y != height; y++)
+		{
+			for (uint32_t x = 0; x != width; x++)
+			{
+				float* t = &scene[(y * width + x) * 4];
+				float base = 0.1f + 0.4f * x / width;
+				t[0] = base;
+				t[1] = base * 0.9f;
+				t[2] = base * 0.8f;
+				t[3] = 1;
+
+				for (uint32_t spot = 0; spot != 4; spot++)
+				{
+					float dx = x - width * (spot + 0.5f) / 4.0f;
+					float dy = y - height * (0.3f + 0.1f * spot);
+					if (dx * dx + dy * dy < 64)
+					{
+						t[0] = t[1] = t[2] = 1;
+					}
+				}
+			}
+		}
+		return scene;
+	}
+}
+
+
+//Milliseconds of each post-processing stage's reference kernel on a test image with a few bright spots,
+//at every SIMD level the kernels have, and how far each level's final image is from the scalar one
+BENCHMARK(post)
+{
+	const uint32_t width = opts.quick ? 320 : 1280;
+	const uint32_t height = opts.quick ? 180 : 720;
+	const uint32_t iterations = opts.quick ? 1 : 10;
+
+	std::vector<float> scene = TestImage(width, height);
+
+	PostSettings settings = DefaultPostSettings();
+	settings.bloom = true;
+	settings.vignette = 0.5f;
+	settings.color_grading = true;
+
+	std::vector<float> lut(LUT_SIZE * LUT_SIZE * LUT_SIZE * 4);
+	BuildGradingLUT(settings, LUT_SIZE, lut.data());
+
+	std::vector<std::vector<float>> levels(settings.bloom_levels);
+	for (uint32_t level = 0; level != settings.bloom_levels; level++)
+	{
+		levels[level].resize(BloomTargetSize(width, level) * BloomTargetSize(height, level) * 4);
+	}
+	std::vector<float> out(width * height * 4);
+	std::vector<float> reference;
+
+	auto bw = [&](uint32_t level) { return BloomTargetSize(width, level); };
+	auto bh = [&](uint32_t level) { return BloomTargetSize(height, level); };
+	auto upsample = [&]
+	{
+		for (uint32_t l = settings.bloom_levels - 1; l > 0; l--)
+		{
+			BloomUpsample(levels[l].data(), bw(l), bh(l), levels[l - 1].data(), bw(l - 1), bh(l - 1));
+		}
+	};
+
+	os << std::fixed << std::setprecision(6);
+	os << "{\n";
+	os << "  \"width\": " << width << ",\n";
+	os << "  \"height\": " << height << ",\n";
+	os << "  \"bloom_levels\": " << settings.bloom_levels << ",\n";
+	os << "  \"runs\": [";
+
+	//AVX2 runs the SSE2 kernels, a texel fills one register
+	SIMDLevel detected = DetectSIMDLevel();
+	for (int level = SL_Scalar; level <= (std::min)(detected, SL_SSE2); level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+
+		double bright_ms = AverageMs(iterations, [&]
+		{
+			BloomBrightPass(scene.data(), width, height, settings.bloom_threshold, settings.bloom_knee, levels[0].data(), bw(0), bh(0));
+		});
+		double down_ms = AverageMs(iterations, [&]
+		{
+			for (uint32_t l = 1; l != settings.bloom_levels; l++)
+			{
+				BloomDownsample(levels[l - 1].data(), bw(l - 1), bh(l - 1), levels[l].data(), bw(l), bh(l));
+			}
+		});
+
+		//Upsampling adds into the levels, so each run starts from the downsampled pyramid
+		std::vector<std::vector<float>> pyramid = levels;
+		double up_ms = AverageMs(iterations, upsample);
+		levels = pyramid;
+		upsample();
+
+		double composite_ms = AverageMs(iterations, [&]
+		{
+			PostComposite(scene.data(), width, height, levels[0].data(), bw(0), bh(0), settings, lut.data(), LUT_SIZE, out.data());
+		});
+
+		if (reference.empty())
+		{
+			reference = out;
+		}
+		double max_diff = 0;
+		for (size_t i = 0; i != out.size(); i++)
+		{
+			max_diff = (std::max)(max_diff, static_cast<double>(std::abs(out[i] - reference[i])));
+		}
+
+		os << (level != SL_Scalar ? ",\n" : "\n");
+		os << "    { \"simd\": \"" << SIMDLevelName(static_cast<SIMDLevel>(level)) << "\""
+			<< ", \"bright_pass_ms\": " << bright_ms << ", \"downsample_ms\": " << down_ms
+			<< ", \"upsample_ms\": " << up_ms << ", \"composite_ms\": " << composite_ms
+			<< ", \"max_abs_diff_vs_scalar\": " << max_diff << " }";
+	}
+	ForceSIMDLevel(detected);
+
+	os << "\n  ]\n";
+	os << "}";
+}
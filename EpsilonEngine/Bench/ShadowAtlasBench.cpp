@@ -0,0 +1,241 @@
+#include "BenchHarness.h"
+#include "CameraPath.h"
+#include "LightBounds.h"
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	//A 45 degree 16:9 perspective projection at 720p
+	const float NEAR_PLANE = 0.1f;
+	const float PROJ_X = 1.358f;
+	const float PROJ_Y = 2.414f;
+	const float VIEWPORT_HEIGHT = 720;
+
+	//The shadow atlas of RenderEngine
+	const uint32_t SHADOW_ATLAS_SIZE = 4096;
+	const uint32_t SHADOW_PAGE_MIN_SIZE = 128;
+	const uint32_t SHADOW_PAGE_MAX_SIZE = 1024;
+	const uint64_t SHADOW_PAGE_MAX_IDLE_FRAMES = 120;
+
+	const float SPOT_RANGE = 6;
+	const float SPOT_OUTER_ANGLE = 0.6f;
+
+	struct Caster
+	{
+		Vector3f pos;
+		float radius;
+
+		//Banners sway, so their transforms change every frame
+		bool cloth;
+		float phase;
+	};
+
+	struct Spot
+	{
+		Vector3f pos;
+		Vector3f dir;
+	};
+
+	//The atrium of the frame benchmark's scene, spot lights under the lower columns' capitals shine
+	//down and into the nave. Only the two banners at the nave's west end move
+	void BuildScene(std::vector<Caster>& casters, std::vector<Spot>& spots)
+	{
+		auto add = [&casters](const Vector3f& pos, const Vector3f& half_size, bool cloth)
+		{
+			Caster caster;
+			caster.pos = pos;
+			caster.radius = std::sqrt(half_size.x * half_size.x + half_size.y * half_size.y + half_size.z * half_size.z);
+			caster.cloth = cloth;
+			caster.phase = static_cast<float>(casters.size());
+			casters.push_back(caster);
+		};
+
+		for (int x = -8; x != 8; x++)
+		{
+			for (int z = -4; z != 4; z++)
+			{
+				add(Vector3f(x * 2 + 1.0f, 0, z * 2 + 1.0f), Vector3f(1, 0.05f, 1), false);
+			}
+		}
+
+		for (int storey = 0; storey != 2; storey++)
+		{
+			float y = storey * 6.0f;
+			for (int side = -1; side <= 1; side += 2)
+			{
+				for (int c = 0; c != 9; c++)
+				{
+					float x = -12.0f + c * 3;
+					add(Vector3f(x, y + 2.5f, side * 4.0f), Vector3f(0.4f, 2, 0.4f), false);
+					if (0 == storey)
+					{
+						Spot spot;
+						spot.pos = Vector3f(x, 4.5f, side * 3.4f);
+						spot.dir = Normalize(Vector3f(0, -1, -side * 0.5f));
+						spots.push_back(spot);
+					}
+				}
+				for (int a = 0; a != 8; a++)
+				{
+					add(Vector3f(-10.5f + a * 3, y + 5.5f, side * 4.0f), Vector3f(1.5f, 0.5f, 0.4f), false);
+				}
+			}
+		}
+
+		add(Vector3f(-10.5f, 2.5f, -3.6f), Vector3f(1.2f, 2, 0.05f), true);
+		add(Vector3f(-10.5f, 2.5f, 3.6f), Vector3f(1.2f, 2, 0.05f), true);
+
+		for (int v = 0; v != 14; v++)
+		{
+			float x = -10.5f + (v / 2) * 3;
+			float z = (v & 1) ? 5.5f : -5.5f;
+			add(Vector3f(x, 1.2f, z), Vector3f(0.8f, 1.2f, 0.8f), false);
+		}
+	}
+
+	//Looking from eye at at, y up, row-major for row vectors
+	void LookAtMatrix(const Vector3f& eye, const Vector3f& at, float view[16])
+	{
+		Vector3f f = Normalize(at - eye);
+		Vector3f r = Normalize(CrossProduct3(Vector3f(0, 1, 0), f));
+		Vector3f u = CrossProduct3(f, r);
+		const Vector3f* axes[3] = { &r, &u, &f };
+		for (int row = 0; row != 3; row++)
+		{
+			for (int col = 0; col != 3; col++)
+			{
+				view[row * 4 + col] = (&axes[col]->x)[row];
+			}
+			view[row * 4 + 3] = 0;
+		}
+		for (int col = 0; col != 3; col++)
+		{
+			view[12 + col] = -(axes[col]->x * eye.x + axes[col]->y * eye.y + axes[col]->z * eye.z);
+		}
+		view[15] = 1;
+	}
+}
+
+
+//Spot light shadow pages rendered per frame along the benchmark camera path, with the shadow cache deciding
+//which lights re-render as RenderEngine::UpdateShadows does, against every visible light re-rendering
+//without it. Also the microseconds the cache's bookkeeping takes and how much of the atlas is left free
+BENCHMARK(shadows)
+{
+	const uint32_t num_frames = opts.quick ? 60 : 2000;
+
+	std::vector<Caster> casters;
+	std::vector<Spot> spots;
+	BuildScene(casters, spots);
+
+	CameraPath path = SponzaBenchmarkPath();
+	ShadowCache cache;
+	cache.Reset(SHADOW_ATLAS_SIZE, SHADOW_PAGE_MIN_SIZE);
+
+	uint64_t total_visible = 0;
+	uint64_t max_renders = 0;
+	uint64_t first_renders = 0;
+	uint64_t resizes = 0;
+	uint64_t unshadowed = 0;
+	double min_free = 1;
+	double us = 0;
+	std::vector<uint32_t> page_sizes(spots.size(), 0);
+	for (uint32_t frame = 0; frame != num_frames; frame++)
+	{
+		float t = (num_frames > 1) ? static_cast<float>(frame) / (num_frames - 1) : 0;
+		CameraKey key = path.Evaluate(t);
+		float view[16];
+		LookAtMatrix(key.eye, key.at, view);
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		uint64_t renders_before = cache.NumRenders();
+		cache.BeginFrame();
+		for (uint32_t i = 0; i != spots.size(); i++)
+		{
+			const Spot& spot = spots[i];
+			Vector3f center;
+			float radius;
+			SpotLightBoundingSphere(&spot.pos.x, &spot.dir.x, SPOT_RANGE, SPOT_OUTER_ANGLE, &center.x, radius);
+
+			float center_es[3];
+			for (int col = 0; col != 3; col++)
+			{
+				center_es[col] = center.x * view[col] + center.y * view[4 + col] + center.z * view[8 + col] + view[12 + col];
+			}
+			float rect[4];
+			if (!SphereScreenRect(center_es, radius, NEAR_PLANE, PROJ_X, PROJ_Y, rect))
+			{
+				continue;
+			}
+			++total_visible;
+
+			ShadowHash light_hash;
+			light_hash.Add(spot.pos);
+			light_hash.Add(spot.dir);
+			light_hash.Add(SPOT_RANGE);
+			light_hash.Add(SPOT_OUTER_ANGLE);
+
+			//The light's bounding sphere stands in for its frustum
+			ShadowHash casters_hash;
+			for (size_t c = 0; c != casters.size(); c++)
+			{
+				const Caster& caster = casters[c];
+				if (Length(caster.pos - center) > caster.radius + radius)
+				{
+					continue;
+				}
+
+				float angle = caster.cloth ? std::sin(frame * 0.05f + caster.phase) * 0.1f : 0;
+				casters_hash.Add(c);
+				casters_hash.Add(caster.pos);
+				casters_hash.Add(angle);
+			}
+
+			float projected_size = ProjectedSphereSize(Length(center - key.eye), radius, PROJ_Y, VIEWPORT_HEIGHT);
+			uint32_t page_size = ShadowPageSize(projected_size, cache.PageSize(i), SHADOW_PAGE_MIN_SIZE, SHADOW_PAGE_MAX_SIZE);
+
+			ShadowPage page;
+			if (cache.Update(i, light_hash.Value(), casters_hash.Value(), page_size, page))
+			{
+				if (0 == page_sizes[i])
+				{
+					++first_renders;
+				}
+				else if (page_sizes[i] != page.size)
+				{
+					++resizes;
+				}
+			}
+			unshadowed += (0 == page.size) ? 1 : 0;
+			page_sizes[i] = page.size;
+		}
+		cache.Trim(SHADOW_PAGE_MAX_IDLE_FRAMES);
+		us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+		max_renders = (std::max)(max_renders, cache.NumRenders() - renders_before);
+		double free = static_cast<double>(cache.Packer().FreeArea()) / (static_cast<double>(SHADOW_ATLAS_SIZE) * SHADOW_ATLAS_SIZE);
+		min_free = (std::min)(min_free, free);
+	}
+
+	os << std::fixed << std::setprecision(3);
+	os << "{\n";
+	os << "  \"frames\": " << num_frames << ",\n";
+	os << "  \"lights\": " << spots.size() << ",\n";
+	os << "  \"casters\": " << casters.size() << ",\n";
+	os << "  \"visible_lights_per_frame\": " << static_cast<double>(total_visible) / num_frames << ",\n";
+	os << "  \"renders_per_frame\": " << static_cast<double>(cache.NumRenders()) / num_frames << ",\n";
+	os << "  \"max_renders_per_frame\": " << max_renders << ",\n";
+	os << "  \"first_renders\": " << first_renders << ",\n";
+	os << "  \"resize_renders\": " << resizes << ",\n";
+	os << "  \"unshadowed_lights\": " << unshadowed << ",\n";
+	os << "  \"min_free_atlas\": " << min_free << ",\n";
+	os << "  \"us_per_frame\": " << us / num_frames << "\n";
+	os << "}";
+}
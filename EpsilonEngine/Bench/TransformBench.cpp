@@ -0,0 +1,188 @@
+#include "BenchHarness.h"
+#include "Transform.h"
+#include <iomanip>
+
+using namespace epsilon;
+using namespace epsilon::bench;
+
+
+namespace
+{
+	//What TransformSystem::Update did before batching: a matrix per node through XMMatrixAffineTransformation
+	class PerNodeTransforms
+	{
+	public:
+		void Create(TransformHandle parent, const Vector3f& pos, const Vector4f& rot, const Vector3f& scale)
+		{
+			positions_.push_back(pos);
+			rotations_.push_back(rot);
+			scales_.push_back(scale);
+			parents_.push_back(parent);
+			dirty_.push_back(1);
+			world_mats_.emplace_back();
+		}
+
+		void SetPosition(TransformHandle h, const Vector3f& pos)
+		{
+			positions_[h] = pos;
+			dirty_[h] = 1;
+		}
+
+		void Update()
+		{
+			for (size_t i = 0; i != parents_.size(); i++)
+			{
+				TransformHandle p = parents_[i];
+				if (p != INVALID_TRANSFORM && dirty_[p])
+				{
+					dirty_[i] = 1;
+				}
+			}
+
+			XMVECTOR zero = XMVectorZero();
+			for (size_t h = 0; h != parents_.size(); h++)
+			{
+				if (!dirty_[h])
+				{
+					continue;
+				}
+
+				XMMATRIX world = XMMatrixAffineTransformation(scales_[h].XMV(), zero, rotations_[h].XMV(), positions_[h].XMV());
+				TransformHandle p = parents_[h];
+				if (p != INVALID_TRANSFORM)
+				{
+					world = XMMatrixMultiply(world, XMLoadFloat4x4(&world_mats_[p]));
+				}
+				XMStoreFloat4x4(&world_mats_[h], world);
+			}
+
+			for (auto& d : dirty_)
+			{
+				d = 0;
+			}
+		}
+
+	private:
+		std::vector<Vector3f> positions_;
+		std::vector<Vector4f> rotations_;
+		std::vector<Vector3f> scales_;
+		std::vector<TransformHandle> parents_;
+		std::vector<uint8_t> dirty_;
+		std::vector<XMFLOAT4X4> world_mats_;
+	};
+
+	//8-ary tree, parents before children
+	TransformHandle TreeParent(size_t i)
+	{
+		return (0 == i) ? INVALID_TRANSFORM : static_cast<TransformHandle>((i - 1) / 8);
+	}
+
+	Vector4f NodeRotation(size_t i)
+	{
+		float half = static_cast<float>(i % 360) * (XM_PI / 360);
+		return Normalize(Vector4f(std::sin(half), 0.5f * std::sin(half), 0, std::cos(half)));
+	}
+
+	Vector3f NodePosition(size_t i, uint32_t frame)
+	{
+		float f = static_cast<float>(i);
+		return Vector3f(std::sin(f + frame), std::cos(f * 0.7f), f * 1e-4f);
+	}
+
+	//Two poses per node to alternate between, so the timings aren't of the sines
+	void BuildPoses(size_t num_nodes, std::vector<Vector3f> (&poses)[2])
+	{
+		for (uint32_t p = 0; p != 2; p++)
+		{
+			poses[p].resize(num_nodes);
+			for (size_t i = 0; i != num_nodes; i++)
+			{
+				poses[p][i] = NodePosition(i, p + 1);
+			}
+		}
+	}
+
+	//Every k-th node, k spreading the dirty ones through the tree. Descendants of those are updated too
+	std::vector<TransformHandle> DirtyNodes(size_t num_nodes, double fraction)
+	{
+		std::vector<TransformHandle> nodes;
+		if (fraction > 0)
+		{
+			size_t step = (std::max)(static_cast<size_t>(1 / fraction + 0.5), static_cast<size_t>(1));
+			for (size_t i = 0; i < num_nodes; i += step)
+			{
+				nodes.push_back(static_cast<TransformHandle>(num_nodes - 1 - i));
+			}
+		}
+		return nodes;
+	}
+}
+
+
+//Milliseconds per TransformSystem::Update of a 100k-node tree as the fraction of nodes moved each frame
+//grows, per node as before against batched at every SIMD level
+BENCHMARK(transforms)
+{
+	const size_t num_nodes = opts.quick ? 10000 : 100000;
+	const uint32_t iterations = opts.quick ? 3 : 50;
+	const double fractions[] = { 0, 0.001, 0.01, 0.1, 0.5, 1 };
+
+	TransformSystem batched;
+	PerNodeTransforms per_node;
+	for (size_t i = 0; i != num_nodes; i++)
+	{
+		TransformHandle h = batched.Create(TreeParent(i));
+		batched.SetPosition(h, NodePosition(i, 0));
+		batched.SetRotation(h, NodeRotation(i));
+		batched.SetScale(h, Vector3f(1.01f, 0.99f, 1));
+		per_node.Create(TreeParent(i), NodePosition(i, 0), NodeRotation(i), Vector3f(1.01f, 0.99f, 1));
+	}
+
+	std::vector<Vector3f> poses[2];
+	BuildPoses(num_nodes, poses);
+
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+	os << "  \"nodes\": " << num_nodes << ",\n";
+	os << "  \"iterations\": " << iterations << ",\n";
+	os << "  \"update_ms\": {";
+
+	SIMDLevel detected = DetectSIMDLevel();
+	for (size_t f = 0; f != sizeof(fractions) / sizeof(fractions[0]); f++)
+	{
+		std::vector<TransformHandle> dirty = DirtyNodes(num_nodes, fractions[f]);
+		uint32_t frame = 0;
+
+		double per_node_ms = AverageMs(iterations, [&]()
+		{
+			++frame;
+			for (TransformHandle h : dirty)
+			{
+				per_node.SetPosition(h, poses[frame & 1][h]);
+			}
+			per_node.Update();
+		});
+
+		os << (f ? ",\n" : "\n") << "    \"" << std::setprecision(3) << fractions[f] << std::setprecision(4) << "\": {\n";
+		os << "      \"per_node\": " << per_node_ms;
+		for (int level = SL_Scalar; level <= detected; level++)
+		{
+			ForceSIMDLevel(static_cast<SIMDLevel>(level));
+			double batched_ms = AverageMs(iterations, [&]()
+			{
+				++frame;
+				for (TransformHandle h : dirty)
+				{
+					batched.SetPosition(h, poses[frame & 1][h]);
+				}
+				batched.Update();
+			});
+			os << ",\n      \"batched_" << SIMDLevelName(static_cast<SIMDLevel>(level)) << "\": " << batched_ms;
+		}
+		ForceSIMDLevel(detected);
+		os << "\n    }";
+	}
+
+	os << "\n  }\n";
+	os << "}";
+}
@@ -1,31 +1,129 @@
-float3		g_albedo_clr;
-bool		g_albedo_map_enabled;
-Texture2D	g_albedo_tex;
+// Constants grouped by how often they change, each bound as a slice of one ring buffer. Materials are
+// slices of a buffer holding all of them instead
 
-float2		g_metalness_clr;
-Texture2D	g_metalness_tex;
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SSAO_SAMPLES 16
+#define SH_COEFFICIENTS 9
 
-float2		g_glossiness_clr;
-Texture2D	g_glossiness_tex;
+cbuffer cb_per_frame : register(b0)
+{
+	row_major float4x4 g_view_mat;
+	row_major float4x4 g_proj_mat;
+	row_major float4x4 g_inv_proj_mat;
+	float4		g_near_q_far;
+	// Part of the pooled render targets covered by the viewport
+	float2		g_tc_scale;
+	// Lights in g_lights
+	uint		g_num_lights;
+};
+
+cbuffer cb_per_object : register(b1)
+{
+	row_major float4x4 g_model_mat;
+};
+
+cbuffer cb_per_light : register(b2)
+{
+	float3		g_light_pos_es;
+	float3		g_light_dir_es;
+	float3		g_light_color;
+	float4		g_light_falloff_range;
+	float		g_shadow_enabled;
+	float		g_num_cascades;
+	// World to light clip space, for rendering the shadow page
+	row_major float4x4 g_light_view_proj;
+	// View space to light space for direction lights, to world space for the ambient light
+	row_major float4x4 g_shadow_mat;
+	// Light space to each cascade's atlas uv and depth
+	float4		g_cascade_scale[MAX_SHADOW_CASCADES];
+	float4		g_cascade_offset[MAX_SHADOW_CASCADES];
+	float4		g_cascade_uv_clamp[MAX_SHADOW_CASCADES];
+	// Irradiance SH of the ambient light's environment, and the mips of g_env_specular_tex
+	float4		g_ambient_sh[SH_COEFFICIENTS];
+	float		g_env_specular_mips;
+};
+
+cbuffer cb_per_material : register(b3)
+{
+	float3		g_albedo_clr;
+	bool		g_albedo_map_enabled;
+	float2		g_metalness_clr;
+	float2		g_glossiness_clr;
+	bool		g_normal_map_enabled;
+};
+
+cbuffer cb_per_pass : register(b4)
+{
+	// Kernel points in the frame around the normal
+	float4		g_ao_kernel[MAX_SSAO_SAMPLES];
+	// Viewports of the occlusion target and the full-resolution targets, in texels
+	float2		g_ao_size;
+	float2		g_render_size;
+	float		g_ao_radius;
+	float		g_ao_bias;
+	float		g_ao_intensity;
+	uint		g_ao_num_samples;
+	// View space to the previous frame's unjittered clip space, and the part of the history it covered
+	row_major float4x4 g_taa_reproj_mat;
+	float2		g_taa_prev_tc_scale;
+	// Weight of the current frame
+	float		g_taa_blend;
+	float		g_bloom_threshold;
+	float		g_bloom_knee;
+	float		g_bloom_intensity;
+	// Valid texels of the source and the target of a post-processing pass
+	float2		g_post_src_size;
+	float2		g_post_dst_size;
+	float		g_vignette;
+	uint		g_grading_enabled;
+};
+
+// A spot or point light in view space, PackedLight in LightPacker.h. Point lights have a cone
+// wider than every direction
+struct PACKED_LIGHT
+{
+	float3		pos_es;
+	float		range;
+	float3		dir_es;
+	float		cos_outer;
+	float3		color;
+	float		cos_inner;
+	float3		falloff;
+	float		shadow_enabled;
+	// NDC rectangle the light's bounding sphere covers, (min x, min y, max x, max y)
+	float4		screen_rect;
+	// View space to the shadow page's atlas uv and depth
+	row_major float4x4 shadow_mat;
+	float4		shadow_uv_clamp;
+};
+
+StructuredBuffer<PACKED_LIGHT> g_lights;
 
-float4x4	g_model_mat;
-float4x4	g_view_mat;
-float4x4	g_proj_mat;
-float4x4	g_inv_proj_mat;
+Texture2D	g_albedo_tex;
+// Tangent space, DirectX convention: green along +v
+Texture2D	g_normal_tex;
+Texture2D	g_metalness_tex;
+Texture2D	g_glossiness_tex;
 
 Texture2D	g_buffer_tex;
 Texture2D	g_buffer_1_tex;
 Texture2D	g_depth_tex;
 
-float3		g_light_pos_es;
-float3		g_light_dir_es;
-float3		g_light_color;
-float4		g_light_falloff_range;
-float2		g_spot_light_cos_cone;
-
 Texture2D	g_pp_tex;
 
-float4		g_near_q_far;
+Texture2D	g_shadow_tex;
+
+// Visibility and the depth it was computed at
+Texture2D	g_ao_tex;
+
+Texture2D	g_history_tex;
+
+// First level of the bloom pyramid, and the color grading from sRGB-encoded color to graded
+Texture2D	g_bloom_tex;
+Texture3D	g_grading_lut;
+
+// The environment's radiance prefiltered with GGX, roughness rising linearly down the mips
+TextureCube	g_env_specular_tex;
 
 #define MAX_SHININESS 8192.0f
 
@@ -46,6 +144,24 @@ SamplerState linear_sampler
 };
 
 
+SamplerState lut_sampler
+{
+	Filter = MIN_MAG_MIP_LINEAR;
+	AddressU = Clamp;
+	AddressV = Clamp;
+	AddressW = Clamp;
+};
+
+
+SamplerState env_sampler
+{
+	Filter = MIN_MAG_MIP_LINEAR;
+	AddressU = Clamp;
+	AddressV = Clamp;
+	AddressW = Clamp;
+};
+
+
 SamplerState aniso_sampler
 {
 	Filter = ANISOTROPIC;
@@ -54,6 +170,15 @@ SamplerState aniso_sampler
 };
 
 
+SamplerComparisonState shadow_sampler
+{
+	Filter = COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	AddressU = Clamp;
+	AddressV = Clamp;
+	ComparisonFunc = LESS_EQUAL;
+};
+
+
 DepthStencilState depth_enalbed
 {
 	DepthEnable = true;
@@ -62,6 +187,21 @@ DepthStencilState depth_enalbed
 };
 
 
+DepthStencilState depth_disabled
+{
+	DepthEnable = false;
+	DepthWriteMask = ZERO;
+};
+
+
+DepthStencilState depth_always
+{
+	DepthEnable = true;
+	DepthWriteMask = ALL;
+	DepthFunc = ALWAYS;
+};
+
+
 DepthStencilState lighting_dss
 {
 	DepthEnable = false;
@@ -91,6 +231,17 @@ RasterizerState front_solid_rs
 };
 
 
+// Sponza has single-sided walls, so both faces cast. The slope bias keeps lit faces from shadowing themselves
+RasterizerState shadow_rs
+{
+	FillMode = Solid;
+	CullMode = NONE;
+	DepthBias = 100;
+	SlopeScaledDepthBias = 2.0f;
+	DepthBiasClamp = 0.01f;
+};
+
+
 RasterizerState double_solid_rs
 {
 	FillMode = Solid;
@@ -230,6 +381,7 @@ struct GBUFFER_VSO
 	float4 pos : SV_Position;
 	float3 norm : NORMAL;
 	float2 tc : TEXCOORD0;
+	float3 pos_es : TEXCOORD1;
 };
 
 
@@ -244,6 +396,7 @@ GBUFFER_VSO GBufferVS(
 	opt.pos = pos;
 	opt.pos = mul(opt.pos, g_model_mat);
 	opt.pos = mul(opt.pos, g_view_mat);
+	opt.pos_es = opt.pos.xyz;
 	opt.pos = mul(opt.pos, g_proj_mat);
 
 	opt.norm = norm;
@@ -263,9 +416,33 @@ struct GBUFFER_PSO
 };
 
 
+// Tangent frame from screen-space derivatives, as the vertices have no tangents. The rows are the
+// directions u and v increase in, scaled alike, and the normal
+float3x3 CotangentFrame(float3 normal, float3 pos, float2 tc)
+{
+	float3 dp1 = ddx(pos);
+	float3 dp2 = ddy(pos);
+	float2 duv1 = ddx(tc);
+	float2 duv2 = ddy(tc);
+
+	float3 dp2_perp = cross(dp2, normal);
+	float3 dp1_perp = cross(normal, dp1);
+	float3 t = dp2_perp * duv1.x + dp1_perp * duv2.x;
+	float3 b = dp2_perp * duv1.y + dp1_perp * duv2.y;
+
+	float inv_scale = rsqrt(max(max(dot(t, t), dot(b, b)), 1e-20f));
+	return float3x3(t * inv_scale, b * inv_scale, normal);
+}
+
+
 GBUFFER_PSO GBufferPS(GBUFFER_VSO ipt)
 {
-	float3 normal = ipt.norm;
+	float3 normal = normalize(ipt.norm);
+	if (g_normal_map_enabled)
+	{
+		float3 tangent_normal = g_normal_tex.Sample(aniso_sampler, ipt.tc).xyz * 2 - 1;
+		normal = normalize(mul(tangent_normal, CotangentFrame(normal, ipt.pos_es, ipt.tc)));
+	}
 
 	float3 albedo = g_albedo_clr.rgb;
 	if (g_albedo_map_enabled)
@@ -297,7 +474,7 @@ float2 TexCoordFromPos(float4 pos)
 	float2 tex = pos.xy / 2;
 	tex.y *= -1;
 	tex += 0.5f;
-	return tex;
+	return tex * g_tc_scale;
 }
 
 
@@ -336,24 +513,130 @@ float4 LightingTestPS(LIGHTING_VSO ipt) : SV_Target
 }
 
 
+// Relative depth difference at which an occlusion texel stops counting for a pixel
+#define SSAO_DEPTH_TOLERANCE 0.05f
+
+
+// Mirrors UpsampleSSAO in AmbientOcclusion.cpp: the 4x4 occlusion texels around the pixel, weighted by
+// how close their depth is to its own, which also averages out the 4x4 rotation pattern
+float SSAOTerm(float2 pixel)
+{
+	if (g_ao_num_samples == 0)
+	{
+		return 1;
+	}
+
+	float z = g_depth_tex.Load(uint3(pixel, 0)).x;
+	float2 a = pixel / g_render_size * g_ao_size - 0.5f;
+	int2 base = int2(floor(a)) - 1;
+	int2 max_texel = int2(g_ao_size) - 1;
+
+	float sum = 0;
+	float weight_sum = 0;
+	for (int dy = 0; dy < 4; ++dy)
+	{
+		for (int dx = 0; dx < 4; ++dx)
+		{
+			int2 texel = clamp(base + int2(dx, dy), 0, max_texel);
+			float2 t = g_ao_tex.Load(int3(texel, 0)).xy;
+
+			float w = max(1 - abs(t.y - z) / (z * SSAO_DEPTH_TOLERANCE), 0);
+			sum += w * t.x;
+			weight_sum += w;
+		}
+	}
+
+	if (weight_sum > 1e-4f)
+	{
+		return sum / weight_sum;
+	}
+	else
+	{
+		return g_ao_tex.Load(int3(clamp(int2(floor(a + 0.5f)), 0, max_texel), 0)).x;
+	}
+}
+
+
+// EvaluateSH9 in ImageBasedLighting.cpp
+float3 AmbientIrradiance(float3 n)
+{
+	float3 irradiance = g_ambient_sh[0].rgb * 0.282095f
+		+ (g_ambient_sh[1].rgb * n.y + g_ambient_sh[2].rgb * n.z + g_ambient_sh[3].rgb * n.x) * 0.488603f
+		+ (g_ambient_sh[4].rgb * (n.x * n.y) + g_ambient_sh[5].rgb * (n.y * n.z) + g_ambient_sh[7].rgb * (n.x * n.z)) * 1.092548f
+		+ g_ambient_sh[6].rgb * (0.315392f * (3 * n.z * n.z - 1))
+		+ g_ambient_sh[8].rgb * (0.546274f * (n.x * n.x - n.y * n.y));
+	return max(irradiance, 0);
+}
+
+
+// The GGX roughness whose lobe is as wide as the normalized Blinn-Phong one, alpha^2 = 2 / (shininess + 2)
+float Shininess2Roughness(float shininess)
+{
+	return sqrt(sqrt(2 / (shininess + 2)));
+}
+
+
+// Split-sum environment BRDF, fitted analytically instead of read from a table (Karis, "Physically Based
+// Shading on Mobile")
+float3 EnvironmentBRDF(float3 c_spec, float roughness, float n_dot_v)
+{
+	float4 r = roughness * float4(-1, -0.0275f, -0.572f, 0.022f) + float4(1, 0.0425f, 1.04f, -0.04f);
+	float a004 = min(r.x * r.x, exp2(-9.28f * n_dot_v)) * r.x + r.y;
+	float2 ab = float2(-1.04f, 1.04f) * a004 + r.zw;
+	return c_spec * ab.x + ab.y;
+}
+
+
+float3 AmbientTerm(float3 normal, float3 view_dir, float3 c_diff, float3 c_spec, float shininess, float2 pixel)
+{
+	float3 normal_ws = mul(normal, (float3x3)g_shadow_mat);
+	float3 reflect_ws = mul(reflect(view_dir, normal), (float3x3)g_shadow_mat);
+
+	float roughness = Shininess2Roughness(shininess);
+	float3 prefiltered = g_env_specular_tex.SampleLevel(env_sampler, reflect_ws, roughness * (g_env_specular_mips - 1)).rgb;
+	float3 spec = prefiltered * EnvironmentBRDF(c_spec, roughness, saturate(dot(normal, -view_dir)));
+
+	return (c_diff * AmbientIrradiance(normal_ws) + spec) * g_light_color * SSAOTerm(pixel);
+}
+
+
 float4 AmbientLightingPS(LIGHTING_VSO ipt) : SV_Target
 {
 	float2 tc = ipt.tc;
-	float3 view_dir = ipt.view_dir;
+	float3 view_dir = normalize(ipt.view_dir);
 
 	float4 mrt_0 = g_buffer_tex.Sample(point_sampler, tc);
 	float4 mrt_1 = g_buffer_1_tex.Sample(point_sampler, tc);
-	view_dir = normalize(view_dir);
 	float3 normal = GetNormal(mrt_0);
-	float glossiness = GetGlossiness(mrt_0);
-	float shininess = Glossiness2Shininess(glossiness);
+	float shininess = Glossiness2Shininess(GetGlossiness(mrt_0));
 	float3 c_diff = GetDiffuse(mrt_1);
 	float3 c_spec = GetSpecular(mrt_1);
 
-	float n_dot_l = 0.5f + 0.5f * dot(g_light_dir_es.xyz, normal);
-	float4 shading = float4(max(c_diff * n_dot_l, 0) * g_light_color, 1);
+	return float4(AmbientTerm(normal, view_dir, c_diff, c_spec, shininess, ipt.pos.xy), 1);
+}
 
-	return shading;
+
+float DirectionShadowTerm(float3 pos_es)
+{
+	if (g_shadow_enabled < 0.5f)
+	{
+		return 1;
+	}
+
+	float3 pos_ls = mul(float4(pos_es, 1), g_shadow_mat).xyz;
+
+	// The first cascade whose page covers the position, skipped cascades may lag behind the split distances
+	for (int i = 0; i < MAX_SHADOW_CASCADES; ++i)
+	{
+		float3 p = pos_ls * g_cascade_scale[i].xyz + g_cascade_offset[i].xyz;
+		float4 rect = g_cascade_uv_clamp[i];
+		if ((i < g_num_cascades) && all(p.xy >= rect.xy) && all(p.xy <= rect.zw) && (p.z <= 1))
+		{
+			return g_shadow_tex.SampleCmpLevelZero(shadow_sampler, p.xy, p.z);
+		}
+	}
+
+	return 1;
 }
 
 
@@ -374,6 +657,7 @@ float4 DirectionLightingPS(LIGHTING_VSO ipt) : SV_Target
 		float4 mrt_1 = g_buffer_1_tex.Sample(point_sampler, tc);
 
 		view_dir = normalize(view_dir);
+		float3 pos_es = view_dir * (g_depth_tex.Sample(point_sampler, tc).x / view_dir.z);
 
 		float shininess = Glossiness2Shininess(GetGlossiness(mrt_0));
 		float3 c_diff = GetDiffuse(mrt_1);
@@ -381,7 +665,7 @@ float4 DirectionLightingPS(LIGHTING_VSO ipt) : SV_Target
 
 		float3 halfway = normalize(dir - view_dir);
 		float3 spec = SpecularTerm(c_spec, dir, halfway, normal, shininess);
-		shading = max((c_diff + spec) * n_dot_l, 0) * g_light_color;
+		shading = max((c_diff + spec) * n_dot_l, 0) * g_light_color * DirectionShadowTerm(pos_es);
 	}
 
 	return float4(shading, 1);
@@ -397,14 +681,14 @@ float AttenuationTerm(float3 light_pos, float3 pos, float3 atten)
 }
 
 
-float3 CalcShading(float3 light_pos, float3 pos_es, float3 normal, float3 view_dir,
+float3 CalcShading(float3 light_pos, float3 light_color, float range, float3 pos_es, float3 normal, float3 view_dir,
 	float3 c_diff, float3 c_spec, float spec_normalize, float shininess, float2 tc,
 	float atten, float2 tc_ddx, float2 tc_ddy)
 {
 	float3 shading = 0;
 	float3 dir = light_pos - pos_es;
 	float dist = length(dir);
-	if (dist < g_light_falloff_range.w)
+	if (dist < range)
 	{
 		dir /= dist;
 		float n_dot_l = dot(normal, dir);
@@ -413,7 +697,7 @@ float3 CalcShading(float3 light_pos, float3 pos_es, float3 normal, float3 view_d
 			float3 halfway = normalize(dir - view_dir);
 			float3 spec = spec_normalize * DistributionTerm(halfway, normal, shininess)
 				* FresnelTerm(dir, halfway, c_spec);
-			shading = max((c_diff + spec) * (n_dot_l * atten), 0) * g_light_color;
+			shading = max((c_diff + spec) * (n_dot_l * atten), 0) * light_color;
 		}
 	}
 
@@ -432,31 +716,48 @@ float SpotLighting(float3 light_pos, float3 light_dir, float2 cos_cone, float3 p
 }
 
 
-float3 CalcSpotShading(float3 pos_es, float3 normal, float3 view_dir,
-	float3 c_diff, float3 c_spec, float spec_normalize, float shininess, float2 tc, float2 tc_ddx, float2 tc_ddy)
+float SpotShadowTerm(float3 pos_es, float4x4 shadow_mat, float4 uv_clamp)
+{
+	float4 pos_ls = mul(float4(pos_es, 1), shadow_mat);
+	if (pos_ls.w <= 0)
+	{
+		return 1;
+	}
+	pos_ls.xyz /= pos_ls.w;
+
+	// Bilinear 2x2 comparison, clamped so it never reads the neighbouring pages
+	float2 uv = clamp(pos_ls.xy, uv_clamp.xy, uv_clamp.zw);
+	return g_shadow_tex.SampleCmpLevelZero(shadow_sampler, uv, pos_ls.z);
+}
+
+
+float3 LocalLightTerm(PACKED_LIGHT light, float3 pos_es, float3 normal, float3 view_dir, float3 c_diff, float3 c_spec,
+	float spec_normalize, float shininess)
 {
 	float3 shading = 0;
-	float spot = SpotLighting(g_light_pos_es, g_light_dir_es, g_spot_light_cos_cone, pos_es);
+
+	float spot = SpotLighting(light.pos_es, light.dir_es, float2(light.cos_outer, light.cos_inner), pos_es);
 	if (spot > 0)
 	{
-		float atten_term = AttenuationTerm(g_light_pos_es, pos_es, g_light_falloff_range.xyz);
-		shading = CalcShading(g_light_pos_es, pos_es, normal, view_dir,
-			c_diff, c_spec, spec_normalize, shininess, tc,
-			spot * atten_term, tc_ddx, tc_ddy);
+		float atten = spot * AttenuationTerm(light.pos_es, pos_es, light.falloff);
+		if (light.shadow_enabled > 0.5f)
+		{
+			atten *= SpotShadowTerm(pos_es, light.shadow_mat, light.shadow_uv_clamp);
+		}
+		shading = CalcShading(light.pos_es, light.color, light.range, pos_es, normal, view_dir,
+			c_diff, c_spec, spec_normalize, shininess, 0, atten, 0, 0);
 	}
 
 	return shading;
 }
 
 
-float4 SpotLightingPS(LIGHTING_VSO ipt) : SV_Target
+// Every spot and point light in one loop, a light is skipped where its screen rectangle ends
+float4 LocalLightingPS(LIGHTING_VSO ipt) : SV_Target
 {
 	float2 tc = ipt.tc;
 	float3 view_dir = ipt.view_dir;
 
-	float2 tc_ddx = ddx(tc);
-	float2 tc_ddy = ddy(tc);
-
 	float4 shading = float4(0, 0, 0, 1);
 
 	float4 mrt_0 = g_buffer_tex.Sample(point_sampler, tc);
@@ -469,13 +770,119 @@ float4 SpotLightingPS(LIGHTING_VSO ipt) : SV_Target
 	float3 c_spec = GetSpecular(mrt_1);
 	float spec_normalize = SpecularNormalizeFactor(shininess);
 
-	shading.rgb += CalcSpotShading(pos_es, normal, view_dir, c_diff, c_spec, spec_normalize, shininess,
-		tc, tc_ddx, tc_ddy);
+	float2 ndc = tc / g_tc_scale * float2(2, -2) + float2(-1, 1);
+
+	for (uint i = 0; i < g_num_lights; ++i)
+	{
+		PACKED_LIGHT light = g_lights[i];
+		if (any(ndc < light.screen_rect.xy) || any(ndc > light.screen_rect.zw))
+		{
+			continue;
+		}
+
+		shading.rgb += LocalLightTerm(light, pos_es, normal, view_dir, c_diff, c_spec, spec_normalize, shininess);
+	}
 
 	return shading;
 }
 
 
+// Mirror TiledLighting.h
+#define LIGHTING_TILE_SIZE 8
+#define MAX_TILE_LIGHTS 256
+
+RWTexture2D<float4> g_lighting_uav;
+
+groupshared uint tile_min_z;
+groupshared uint tile_max_z;
+groupshared uint tile_num_lights;
+groupshared uint tile_lights[MAX_TILE_LIGHTS];
+
+// A thread a pixel, a group a tile. The group culls the lights against the tile's screen rectangle and
+// depth range into a shared list, then each thread shades its pixel once with the ambient and the listed
+// lights, like BuildTileLightLists in TiledLighting.cpp
+[numthreads(LIGHTING_TILE_SIZE, LIGHTING_TILE_SIZE, 1)]
+void TiledLightingCS(uint3 group_id : SV_GroupID, uint3 dispatch_id : SV_DispatchThreadID,
+	uint group_index : SV_GroupIndex)
+{
+	uint2 pixel = dispatch_id.xy;
+	uint2 render_size = uint2(g_render_size);
+	bool inside = all(pixel < render_size);
+
+	float z = g_depth_tex.Load(uint3(min(pixel, render_size - 1), 0)).x;
+
+	if (group_index == 0)
+	{
+		tile_min_z = 0x7F7FFFFF;
+		tile_max_z = 0;
+		tile_num_lights = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// Depths are positive, their bits order like the floats
+	if (inside)
+	{
+		InterlockedMin(tile_min_z, asuint(z));
+		InterlockedMax(tile_max_z, asuint(z));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	float min_z = asfloat(tile_min_z);
+	float max_z = asfloat(tile_max_z);
+
+	// NDC y points up, the tile's bottom row is its min y
+	uint2 tile_min = group_id.xy * LIGHTING_TILE_SIZE;
+	uint2 tile_max = min(tile_min + LIGHTING_TILE_SIZE, render_size);
+	float4 tile_rect = float4(tile_min.x, tile_max.y, tile_max.x, tile_min.y) / g_render_size.xyxy
+		* float4(2, -2, 2, -2) + float4(-1, 1, -1, 1);
+
+	for (uint i = group_index; i < g_num_lights; i += LIGHTING_TILE_SIZE * LIGHTING_TILE_SIZE)
+	{
+		PACKED_LIGHT light = g_lights[i];
+		float4 sr = light.screen_rect;
+		if (all(max(sr.xy, tile_rect.xy) <= min(sr.zw, tile_rect.zw))
+			&& (light.pos_es.z - light.range <= max_z) && (light.pos_es.z + light.range >= min_z))
+		{
+			uint slot;
+			InterlockedAdd(tile_num_lights, 1, slot);
+			if (slot < MAX_TILE_LIGHTS)
+			{
+				tile_lights[slot] = i;
+			}
+		}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if (!inside)
+	{
+		return;
+	}
+
+	float4 mrt_0 = g_buffer_tex.Load(uint3(pixel, 0));
+	float4 mrt_1 = g_buffer_1_tex.Load(uint3(pixel, 0));
+	float3 normal = GetNormal(mrt_0);
+	float shininess = Glossiness2Shininess(GetGlossiness(mrt_0));
+	float3 c_diff = GetDiffuse(mrt_1);
+	float3 c_spec = GetSpecular(mrt_1);
+	float spec_normalize = SpecularNormalizeFactor(shininess);
+
+	float2 ndc = (pixel + 0.5f) / g_render_size * float2(2, -2) + float2(-1, 1);
+	float3 view_dir = normalize(mul(float4(ndc, 1, 1), g_inv_proj_mat).xyz);
+	float3 pos_es = view_dir * (z / view_dir.z);
+
+	float3 shading = AmbientTerm(normal, view_dir, c_diff, c_spec, shininess, pixel + 0.5f);
+
+	uint num_lights = min(tile_num_lights, MAX_TILE_LIGHTS);
+	for (uint j = 0; j < num_lights; ++j)
+	{
+		shading += LocalLightTerm(g_lights[tile_lights[j]], pos_es, normal, view_dir, c_diff, c_spec,
+			spec_normalize, shininess);
+	}
+
+	g_lighting_uav[pixel] = float4(shading, 1);
+}
+
+
 struct PP_VSO
 {
 	float4 pos : SV_Position;
@@ -509,6 +916,179 @@ float4 LinearDepthPS(PP_VSO ipt) : SV_Target
 }
 
 
+uint2 FullResolutionTexel(float2 uv)
+{
+	return min(uint2(max(uv, 0) * g_render_size), uint2(g_render_size) - 1);
+}
+
+
+// Mirrors ComputeSSAO in AmbientOcclusion.cpp. Writes the visibility and the depth it was computed at,
+// so the upsample can tell which texels belong to a pixel's surface
+float4 SSAOPS(PP_VSO ipt) : SV_Target
+{
+	uint2 pixel = uint2(ipt.pos.xy);
+	float2 uv = (pixel + 0.5f) / g_ao_size;
+	uint3 texel = uint3(FullResolutionTexel(uv), 0);
+
+	float z = g_depth_tex.Load(texel).x;
+	float3 normal = GetNormal(g_buffer_tex.Load(texel));
+	float2 proj = float2(g_proj_mat._11, g_proj_mat._22);
+	float3 pos = float3((uv * float2(2, -2) + float2(-1, 1)) / proj * z, z);
+
+	// Tangent frame around the normal, turned by the texel's angle of a 4x4 pattern
+	float angle = (((pixel.x & 3) << 2) | (pixel.y & 3)) * (2 * 3.14159265f / 16);
+	float3 rot = float3(cos(angle), sin(angle), 0);
+	float3 t = rot - normal * dot(rot, normal);
+	if (length(t) < 1e-3f)
+	{
+		rot = float3(-rot.y, rot.x, 0);
+		t = rot - normal * dot(rot, normal);
+	}
+	t = normalize(t);
+	float3 b = cross(normal, t);
+
+	float occlusion = 0;
+	for (uint i = 0; i < g_ao_num_samples; ++i)
+	{
+		float3 k = g_ao_kernel[i].xyz;
+		float3 p = pos + (t * k.x + b * k.y + normal * k.z) * g_ao_radius;
+		if (p.z <= 0)
+		{
+			continue;
+		}
+
+		float2 suv = p.xy * proj / p.z * float2(0.5f, -0.5f) + 0.5f;
+		if (any(suv < 0) || any(suv >= 1))
+		{
+			continue;
+		}
+
+		float sample_z = g_depth_tex.Load(uint3(FullResolutionTexel(suv), 0)).x;
+		if (sample_z < p.z - g_ao_bias)
+		{
+			// Occluders far in front of the surface fade out
+			occlusion += smoothstep(0, 1, g_ao_radius / max(abs(z - sample_z), 1e-6f));
+		}
+	}
+
+	float visibility = saturate(1 - g_ao_intensity * occlusion / max(g_ao_num_samples, 1));
+	return float4(visibility, z, 0, 0);
+}
+
+
+float4 ShadowDepthVS(float4 pos : POSITION) : SV_Position
+{
+	return mul(mul(pos, g_model_mat), g_light_view_proj);
+}
+
+
+float4 ShadowClearVS(float4 pos : POSITION) : SV_Position
+{
+	return float4(pos.xy, 1, 1);
+}
+
+
+// Mirrors ResolveTemporalAA in TemporalAA.cpp. The history is clamped to the current 3x3 neighbourhood
+// so colors that are no longer there don't ghost
+float4 TemporalResolvePS(PP_VSO ipt) : SV_Target
+{
+	int2 pixel = int2(ipt.pos.xy);
+	int2 max_pixel = int2(g_render_size) - 1;
+
+	float3 current = g_pp_tex.Load(int3(pixel, 0)).rgb;
+	float3 lo = current;
+	float3 hi = current;
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			float3 c = g_pp_tex.Load(int3(clamp(pixel + int2(dx, dy), 0, max_pixel), 0)).rgb;
+			lo = min(lo, c);
+			hi = max(hi, c);
+		}
+	}
+
+	// From the pixel's center without the jitter, so a still camera reads the history where it wrote it
+	float z = g_depth_tex.Load(int3(pixel, 0)).x;
+	float2 ndc = (pixel + 0.5f) / g_render_size * float2(2, -2) + float2(-1, 1);
+	float3 pos_es = float3(ndc / float2(g_proj_mat._11, g_proj_mat._22) * z, z);
+
+	float4 prev = mul(float4(pos_es, 1), g_taa_reproj_mat);
+	if ((g_taa_blend >= 1) || (prev.w <= 0))
+	{
+		return float4(current, 1);
+	}
+
+	float2 uv = prev.xy / prev.w * float2(0.5f, -0.5f) + 0.5f;
+	if (any(uv < 0) || any(uv > 1))
+	{
+		return float4(current, 1);
+	}
+
+	// Kept half a texel inside the part the history covered, the sampler wraps
+	float2 size;
+	g_history_tex.GetDimensions(size.x, size.y);
+	uv = clamp(uv * g_taa_prev_tc_scale, 0.5f / size, g_taa_prev_tc_scale - 0.5f / size);
+
+	float3 history = clamp(g_history_tex.SampleLevel(linear_sampler, uv, 0).rgb, lo, hi);
+	return float4(lerp(history, current, g_taa_blend), 1);
+}
+
+
+// A bilinear tap at a position in texels of the valid part of a pooled target, kept half a texel inside it
+float4 SampleTexels(Texture2D tex, float2 pos, float2 valid_size)
+{
+	float2 size;
+	tex.GetDimensions(size.x, size.y);
+	return tex.SampleLevel(linear_sampler, clamp(pos, 0.5f, valid_size - 0.5f) / size, 0);
+}
+
+
+// Dual-filter upsample, a texel out along the axes and half a texel along the diagonals weighted 2
+float4 BloomUpsampleTaps(Texture2D tex, float2 pos, float2 valid_size)
+{
+	float4 sum = SampleTexels(tex, pos + float2(-1, 0), valid_size) + SampleTexels(tex, pos + float2(1, 0), valid_size)
+		+ SampleTexels(tex, pos + float2(0, -1), valid_size) + SampleTexels(tex, pos + float2(0, 1), valid_size);
+	sum += 2 * (SampleTexels(tex, pos + float2(-0.5f, -0.5f), valid_size) + SampleTexels(tex, pos + float2(0.5f, -0.5f), valid_size)
+		+ SampleTexels(tex, pos + float2(-0.5f, 0.5f), valid_size) + SampleTexels(tex, pos + float2(0.5f, 0.5f), valid_size));
+	return sum / 12;
+}
+
+
+// The passes below mirror PostProcess.cpp. A target texel maps to the source by the ratio of their valid sizes
+
+// Half resolution, 4 taps averaging a 4x4 block, then a soft threshold on the brightest channel
+float4 BloomBrightPassPS(PP_VSO ipt) : SV_Target
+{
+	float2 pos = ipt.pos.xy * g_post_src_size / g_post_dst_size;
+	float4 c = (SampleTexels(g_pp_tex, pos + float2(-1, -1), g_post_src_size) + SampleTexels(g_pp_tex, pos + float2(1, -1), g_post_src_size)
+		+ SampleTexels(g_pp_tex, pos + float2(-1, 1), g_post_src_size) + SampleTexels(g_pp_tex, pos + float2(1, 1), g_post_src_size)) / 4;
+
+	float brightness = max(max(c.r, c.g), c.b);
+	float soft = clamp(brightness - g_bloom_threshold + g_bloom_knee, 0, 2 * g_bloom_knee);
+	soft = soft * soft / (4 * g_bloom_knee + 1e-5f);
+	return c * (max(soft, brightness - g_bloom_threshold) / max(brightness, 1e-5f));
+}
+
+
+// Dual-filter downsample, the center weighted 4 and the corners a texel past the 2x2 block
+float4 BloomDownsamplePS(PP_VSO ipt) : SV_Target
+{
+	float2 pos = ipt.pos.xy * g_post_src_size / g_post_dst_size;
+	float4 sum = 4 * SampleTexels(g_pp_tex, pos, g_post_src_size);
+	sum += SampleTexels(g_pp_tex, pos + float2(-1, -1), g_post_src_size) + SampleTexels(g_pp_tex, pos + float2(1, -1), g_post_src_size)
+		+ SampleTexels(g_pp_tex, pos + float2(-1, 1), g_post_src_size) + SampleTexels(g_pp_tex, pos + float2(1, 1), g_post_src_size);
+	return sum / 8;
+}
+
+
+// Added to the level above by the blend state
+float4 BloomUpsamplePS(PP_VSO ipt) : SV_Target
+{
+	return BloomUpsampleTaps(g_pp_tex, ipt.pos.xy * g_post_src_size / g_post_dst_size, g_post_src_size);
+}
+
+
 float3 linear_to_srgb(float3 rgb)
 {
 	const float ALPHA = 0.055f;
@@ -518,8 +1098,32 @@ float3 linear_to_srgb(float3 rgb)
 
 float4 SRGBCorrectionPS(PP_VSO ipt) : SV_Target
 {
-	float4 c = g_pp_tex.Sample(linear_sampler, ipt.tc);
-	float3 rgb = linear_to_srgb(max(c.rgb, 1e-6f));
+	// Upscales the rendered part, kept half a texel inside it so filtering never reads past its edge
+	float2 size;
+	g_pp_tex.GetDimensions(size.x, size.y);
+	float2 tc = min(ipt.tc, g_tc_scale - 0.5f / size);
+
+	float3 rgb = g_pp_tex.Sample(linear_sampler, tc).rgb;
+
+	// Bloom, vignette and grading as PostComposite does them, all off unless enabled
+	float2 uv = ipt.tc / g_tc_scale;
+	if (g_bloom_intensity > 0)
+	{
+		rgb += BloomUpsampleTaps(g_bloom_tex, uv * g_post_src_size, g_post_src_size).rgb * g_bloom_intensity;
+	}
+	if (g_vignette > 0)
+	{
+		float2 d = uv * 2 - 1;
+		rgb *= saturate(1 - g_vignette * dot(d, d) * 0.5f);
+	}
+
+	rgb = linear_to_srgb(max(rgb, 1e-6f));
+	if (g_grading_enabled)
+	{
+		float3 lut_size;
+		g_grading_lut.GetDimensions(lut_size.x, lut_size.y, lut_size.z);
+		rgb = g_grading_lut.SampleLevel(lut_sampler, saturate(rgb) * (lut_size - 1) / lut_size + 0.5f / lut_size, 0).rgb;
+	}
 	return float4(rgb, 1);
 }
 
@@ -546,6 +1150,16 @@ technique11 DeferredRendering
 		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
 	}
 
+	pass SSAO
+	{
+		SetVertexShader(CompileShader(vs_5_0, PostProcessVS()));
+		SetPixelShader(CompileShader(ps_5_0, SSAOPS()));
+
+		SetRasterizerState(back_solid_rs);
+		SetDepthStencilState(depth_enalbed, 0);
+		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
+	}
+
 	pass AmbientLighting
 	{
 		SetVertexShader(CompileShader(vs_5_0, LightingVS()));
@@ -566,15 +1180,81 @@ technique11 DeferredRendering
 		SetBlendState(lighting_bs, float4(1, 1, 1, 1), 0xFFFFFFFF);
 	}
 
-	pass SpotLighting
+	pass LocalLighting
 	{
 		SetVertexShader(CompileShader(vs_5_0, LightingVS()));
-		SetPixelShader(CompileShader(ps_5_0, SpotLightingPS()));
+		SetPixelShader(CompileShader(ps_5_0, LocalLightingPS()));
 
 		SetRasterizerState(back_solid_rs);
 		SetDepthStencilState(lighting_dss, 0);
 		SetBlendState(lighting_bs, float4(1, 1, 1, 1), 0xFFFFFFFF);
 	}
+	pass TiledLighting
+	{
+		SetVertexShader(NULL);
+		SetPixelShader(NULL);
+		SetComputeShader(CompileShader(cs_5_0, TiledLightingCS()));
+	}
+
+	pass ShadowClear
+	{
+		SetVertexShader(CompileShader(vs_5_0, ShadowClearVS()));
+		SetPixelShader(NULL);
+
+		SetRasterizerState(double_solid_rs);
+		SetDepthStencilState(depth_always, 0);
+		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
+	}
+
+	pass ShadowDepth
+	{
+		SetVertexShader(CompileShader(vs_5_0, ShadowDepthVS()));
+		SetPixelShader(NULL);
+
+		SetRasterizerState(shadow_rs);
+		SetDepthStencilState(depth_enalbed, 0);
+		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
+	}
+
+	pass TemporalResolve
+	{
+		SetVertexShader(CompileShader(vs_5_0, PostProcessVS()));
+		SetPixelShader(CompileShader(ps_5_0, TemporalResolvePS()));
+
+		SetRasterizerState(back_solid_rs);
+		SetDepthStencilState(depth_disabled, 0);
+		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
+	}
+
+	pass BloomBrightPass
+	{
+		SetVertexShader(CompileShader(vs_5_0, PostProcessVS()));
+		SetPixelShader(CompileShader(ps_5_0, BloomBrightPassPS()));
+
+		SetRasterizerState(back_solid_rs);
+		SetDepthStencilState(depth_disabled, 0);
+		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
+	}
+
+	pass BloomDownsample
+	{
+		SetVertexShader(CompileShader(vs_5_0, PostProcessVS()));
+		SetPixelShader(CompileShader(ps_5_0, BloomDownsamplePS()));
+
+		SetRasterizerState(back_solid_rs);
+		SetDepthStencilState(depth_disabled, 0);
+		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
+	}
+
+	pass BloomUpsample
+	{
+		SetVertexShader(CompileShader(vs_5_0, PostProcessVS()));
+		SetPixelShader(CompileShader(ps_5_0, BloomUpsamplePS()));
+
+		SetRasterizerState(back_solid_rs);
+		SetDepthStencilState(depth_disabled, 0);
+		SetBlendState(lighting_bs, float4(1, 1, 1, 1), 0xFFFFFFFF);
+	}
 
 	pass SRGBCorrection
 	{
@@ -582,7 +1262,7 @@ technique11 DeferredRendering
 		SetPixelShader(CompileShader(ps_5_0, SRGBCorrectionPS()));
 
 		SetRasterizerState(back_solid_rs);
-		SetDepthStencilState(depth_enalbed, 0);
+		SetDepthStencilState(depth_disabled, 0);
 		SetBlendState(no_bs, float4(0, 0, 0, 0), 0xFFFFFFFF);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+#ifdef EPSILON_COUNT_ALLOCATIONS
+
+namespace
+{
+	std::atomic<uint64_t> heap_allocation_count_(0);
+
+	void* CountedAlloc(size_t size)
+	{
+		heap_allocation_count_.fetch_add(1, std::memory_order_relaxed);
+		void* p = std::malloc(size ? size : 1);
+		if (!p)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+}
+
+void* operator new(size_t size)
+{
+	return CountedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return CountedAlloc(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	heap_allocation_count_.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	heap_allocation_count_.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+#endif
+
+
+namespace epsilon
+{
+
+	uint64_t HeapAllocationCount()
+	{
+#ifdef EPSILON_COUNT_ALLOCATIONS
+		return heap_allocation_count_.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+
+namespace epsilon
+{
+
+	//Number of global operator new calls so far. Only counts when the project is built with
+	//EPSILON_COUNT_ALLOCATIONS, which replaces the global operators, otherwise always 0
+	uint64_t HeapAllocationCount();
+
+}
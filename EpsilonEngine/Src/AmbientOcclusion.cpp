@@ -0,0 +1,218 @@
+#include "AmbientOcclusion.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace epsilon
+{
+	const float SSAO_PI = 3.14159265f;
+
+	//Relative depth difference at which a target texel stops counting for a pixel, SSAO_DEPTH_TOLERANCE in
+	//DeferredRendering.fx
+	const float SSAO_DEPTH_TOLERANCE = 0.05f;
+
+	//Shortest kernel point, as a fraction of the radius
+	const float SSAO_MIN_SCALE = 0.1f;
+
+
+	SSAOSettings SSAOPreset(SSAOQuality quality)
+	{
+		static const SSAOSettings presets[SQ_NumQualities] =
+		{
+			{ 1, 0, 0.5f, 0.02f, 1 },
+			{ 2, 8, 0.5f, 0.02f, 1 },
+			{ 2, 16, 0.5f, 0.02f, 1 },
+			{ 1, 16, 0.5f, 0.02f, 1 }
+		};
+		return presets[quality];
+	}
+
+	const char* SSAOQualityName(SSAOQuality quality)
+	{
+		static const char* names[SQ_NumQualities] =
+		{
+			"off",
+			"low",
+			"medium",
+			"high"
+		};
+		return names[quality];
+	}
+
+	uint32_t SSAOTargetSize(uint32_t size, uint32_t downscale)
+	{
+		return (size + downscale - 1) / downscale;
+	}
+
+	//Base-2 Van der Corput sequence
+	float RadicalInverse(uint32_t i)
+	{
+		i = (i << 16) | (i >> 16);
+		i = ((i & 0x55555555U) << 1) | ((i & 0xAAAAAAAAU) >> 1);
+		i = ((i & 0x33333333U) << 2) | ((i & 0xCCCCCCCCU) >> 2);
+		i = ((i & 0x0F0F0F0FU) << 4) | ((i & 0xF0F0F0F0U) >> 4);
+		i = ((i & 0x00FF00FFU) << 8) | ((i & 0xFF00FF00U) >> 8);
+		return i * 2.3283064365386963e-10f;
+	}
+
+	void SSAOKernel(uint32_t num_samples, float* kernel)
+	{
+		for (uint32_t i = 0; i != num_samples; i++)
+		{
+			float t = (i + 0.5f) / num_samples;
+			float u = RadicalInverse(i);
+
+			float r = std::sqrt(u);
+			float phi = 2 * SSAO_PI * t;
+			float scale = SSAO_MIN_SCALE + (1 - SSAO_MIN_SCALE) * t * t;
+
+			float* k = kernel + i * 4;
+			k[0] = r * std::cos(phi) * scale;
+			k[1] = r * std::sin(phi) * scale;
+			k[2] = std::sqrt(1 - u) * scale;
+			k[3] = 0;
+		}
+	}
+
+	float SSAORotation(uint32_t x, uint32_t y)
+	{
+		return static_cast<float>(((x & 3) << 2) | (y & 3)) * (2 * SSAO_PI / 16);
+	}
+
+	//Texel of a size-wide image under a [0, 1] coordinate
+	uint32_t NearestTexel(float u, uint32_t size)
+	{
+		return (std::min)(static_cast<uint32_t>((std::max)(u, 0.0f) * size), size - 1);
+	}
+
+	float Saturate(float x)
+	{
+		return (std::min)((std::max)(x, 0.0f), 1.0f);
+	}
+
+	void ComputeSSAO(const float* depth, const float* normals, uint32_t width, uint32_t height, float proj_x, float proj_y,
+		const SSAOSettings& settings, const float* kernel, float* ao)
+	{
+		uint32_t ao_width = SSAOTargetSize(width, settings.downscale);
+		uint32_t ao_height = SSAOTargetSize(height, settings.downscale);
+
+		for (uint32_t j = 0; j != ao_height; j++)
+		{
+			for (uint32_t i = 0; i != ao_width; i++)
+			{
+				float u = (i + 0.5f) / ao_width;
+				float v = (j + 0.5f) / ao_height;
+				size_t texel = NearestTexel(v, height) * width + NearestTexel(u, width);
+
+				float z = depth[texel];
+				const float* n = normals + texel * 3;
+				float pos[3] = { (u * 2 - 1) / proj_x * z, (1 - v * 2) / proj_y * z, z };
+
+				//Tangent frame around the normal, turned by the texel's angle
+				float angle = SSAORotation(i, j);
+				float rot[3] = { std::cos(angle), std::sin(angle), 0 };
+				float r_dot_n = rot[0] * n[0] + rot[1] * n[1];
+				float t[3] = { rot[0] - n[0] * r_dot_n, rot[1] - n[1] * r_dot_n, -n[2] * r_dot_n };
+				float t_len = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+				if (t_len < 1e-3f)
+				{
+					//The normal lies along the rotation, the perpendicular one in the same plane works
+					r_dot_n = -rot[1] * n[0] + rot[0] * n[1];
+					t[0] = -rot[1] - n[0] * r_dot_n;
+					t[1] = rot[0] - n[1] * r_dot_n;
+					t[2] = -n[2] * r_dot_n;
+					t_len = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+				}
+				for (int c = 0; c != 3; c++)
+				{
+					t[c] /= t_len;
+				}
+				float b[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+
+				float occlusion = 0;
+				for (uint32_t s = 0; s != settings.num_samples; s++)
+				{
+					const float* k = kernel + s * 4;
+					float p[3];
+					for (int c = 0; c != 3; c++)
+					{
+						p[c] = pos[c] + (t[c] * k[0] + b[c] * k[1] + n[c] * k[2]) * settings.radius;
+					}
+					if (p[2] <= 0)
+					{
+						continue;
+					}
+
+					float su = p[0] * proj_x / p[2] * 0.5f + 0.5f;
+					float sv = 0.5f - p[1] * proj_y / p[2] * 0.5f;
+					if ((su < 0) || (su >= 1) || (sv < 0) || (sv >= 1))
+					{
+						continue;
+					}
+
+					float sample_z = depth[NearestTexel(sv, height) * width + NearestTexel(su, width)];
+					if (sample_z < p[2] - settings.bias)
+					{
+						//Occluders far in front of the surface fade out
+						float range = Saturate(settings.radius / (std::max)(std::abs(z - sample_z), 1e-6f));
+						occlusion += range * range * (3 - 2 * range);
+					}
+				}
+
+				float visibility = 1;
+				if (settings.num_samples > 0)
+				{
+					visibility = Saturate(1 - settings.intensity * occlusion / settings.num_samples);
+				}
+
+				float* out = ao + (j * ao_width + i) * 2;
+				out[0] = visibility;
+				out[1] = z;
+			}
+		}
+	}
+
+	void UpsampleSSAO(const float* ao, uint32_t ao_width, uint32_t ao_height, const float* depth, uint32_t width,
+		uint32_t height, float* visibility)
+	{
+		for (uint32_t y = 0; y != height; y++)
+		{
+			for (uint32_t x = 0; x != width; x++)
+			{
+				float z = depth[y * width + x];
+				float ax = (x + 0.5f) / width * ao_width - 0.5f;
+				float ay = (y + 0.5f) / height * ao_height - 0.5f;
+				int bx = static_cast<int>(std::floor(ax)) - 1;
+				int by = static_cast<int>(std::floor(ay)) - 1;
+
+				float sum = 0;
+				float weight_sum = 0;
+				for (int dy = 0; dy != 4; dy++)
+				{
+					int ty = (std::min)((std::max)(by + dy, 0), static_cast<int>(ao_height) - 1);
+					for (int dx = 0; dx != 4; dx++)
+					{
+						int tx = (std::min)((std::max)(bx + dx, 0), static_cast<int>(ao_width) - 1);
+						const float* t = ao + (ty * ao_width + tx) * 2;
+
+						float w = (std::max)(1 - std::abs(t[1] - z) / (z * SSAO_DEPTH_TOLERANCE), 0.0f);
+						sum += w * t[0];
+						weight_sum += w;
+					}
+				}
+
+				if (weight_sum > 1e-4f)
+				{
+					visibility[y * width + x] = sum / weight_sum;
+				}
+				else
+				{
+					int tx = (std::min)((std::max)(static_cast<int>(std::floor(ax + 0.5f)), 0), static_cast<int>(ao_width) - 1);
+					int ty = (std::min)((std::max)(static_cast<int>(std::floor(ay + 0.5f)), 0), static_cast<int>(ao_height) - 1);
+					visibility[y * width + x] = ao[(ty * ao_width + tx) * 2];
+				}
+			}
+		}
+	}
+
+}
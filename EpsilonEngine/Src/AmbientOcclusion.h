@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+
+
+namespace epsilon
+{
+
+	//Reference versions of the SSAO and SSAOUpsample passes of DeferredRendering.fx, in the same
+	//steps and texel mapping, for checking the shaders and for measuring quality against cost.
+	//Images are row-major, depth is view-space z and normals are view-space xyz
+
+	enum SSAOQuality
+	{
+		SQ_Off,
+		SQ_Low,
+		SQ_Medium,
+		SQ_High,
+
+		SQ_NumQualities
+	};
+
+	struct SSAOSettings
+	{
+		//Target size is the render size divided by this, rounded up
+		uint32_t downscale;
+		uint32_t num_samples;
+
+		//View-space distance the kernel reaches, and how far in front of a surface a sample must be to count
+		float radius;
+		float bias;
+		float intensity;
+	};
+
+	SSAOSettings SSAOPreset(SSAOQuality quality);
+	const char* SSAOQualityName(SSAOQuality quality);
+
+	uint32_t SSAOTargetSize(uint32_t size, uint32_t downscale);
+
+	//Points in the unit hemisphere around +z, 4 floats each with w unused. Cosine-distributed directions
+	//on a spiral, lengths growing with the index so more of them fall close to the surface
+	void SSAOKernel(uint32_t num_samples, float* kernel);
+
+	//Angle the kernel turns by at a target texel, a 4x4 pattern the upsample averages out
+	float SSAORotation(uint32_t x, uint32_t y);
+
+	//Writes 2 floats per target texel: the visibility and the depth it was computed at
+	void ComputeSSAO(const float* depth, const float* normals, uint32_t width, uint32_t height, float proj_x, float proj_y,
+		const SSAOSettings& settings, const float* kernel, float* ao);
+
+	//Visibility at full resolution from the 4x4 target texels around each pixel, weighted by how close their
+	//depth is to the pixel's. A pixel no texel matches takes the nearest one
+	void UpsampleSSAO(const float* ao, uint32_t ao_width, uint32_t ao_height, const float* depth, uint32_t width,
+		uint32_t height, float* visibility);
+
+}
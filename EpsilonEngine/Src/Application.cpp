@@ -18,7 +18,10 @@ void Application::Create(const std::string& name, int width, int height)
 {
 	main_wnd_ = std::make_unique<Window>(name, width, height);
 
+	job_system_ = std::make_unique<JobSystem>();
+
 	re_ = std::make_unique<RenderEngine>();
+	re_->SetJobSystem(*job_system_);
 	re_->Create(main_wnd_->HWnd(), width, height);
 
 	main_wnd_->SetRE(*re_);
@@ -29,6 +32,11 @@ void Application::Destory()
 	re_->Destory();
 }
 
+void Application::Quit()
+{
+	::PostQuitMessage(0);
+}
+
 void Application::Run()
 {
 	bool gotMsg;
@@ -56,6 +64,10 @@ void Application::Run()
 		}
 		else
 		{
+			if (on_frame_)
+			{
+				on_frame_();
+			}
 			if (re_)
 			{
 				re_->Frame();
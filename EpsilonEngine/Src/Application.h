@@ -1,6 +1,7 @@
 #pragma once
 #include "RenderEngine.h"
 #include "Window.h"
+#include "JobSystem.h"
 
 
 namespace epsilon
@@ -17,11 +18,21 @@ public:
 
 	RenderEngine& RE() { return *re_; }
 
+	JobSystem& Jobs() { return *job_system_; }
+
 	void Run();
 
+	//Called on every frame before rendering
+	void OnFrame(std::function<void()> func) { on_frame_ = func; }
+
+	void Quit();
+
 private:
+	std::unique_ptr<JobSystem> job_system_;
 	std::unique_ptr<RenderEngine> re_;
 	std::unique_ptr<Window> main_wnd_;
+
+	std::function<void()> on_frame_;
 };
 
 }
\ No newline at end of file
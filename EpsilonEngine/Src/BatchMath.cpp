@@ -0,0 +1,1031 @@
+#include "BatchMath.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EPSILON_BATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVC emits any intrinsic regardless of /arch, the dispatch keeps them off CPUs without it
+#define EPSILON_TARGET_SSE2
+#define EPSILON_TARGET_AVX2
+#else
+#define EPSILON_TARGET_SSE2 __attribute__((target("sse2")))
+#define EPSILON_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+
+namespace epsilon
+{
+	std::atomic<int> active_simd_level_(-1);
+
+
+	//Scalar reference, also finishes the tails of the SIMD paths
+
+	inline void TransformCoord1(const float* m, float x, float y, float z, float* out)
+	{
+		float rx = x * m[0] + y * m[4] + z * m[8] + m[12];
+		float ry = x * m[1] + y * m[5] + z * m[9] + m[13];
+		float rz = x * m[2] + y * m[6] + z * m[10] + m[14];
+		float rw = x * m[3] + y * m[7] + z * m[11] + m[15];
+		out[0] = rx / rw;
+		out[1] = ry / rw;
+		out[2] = rz / rw;
+	}
+
+	inline void TransformNormal1(const float* m, float x, float y, float z, float* out)
+	{
+		float rx = x * m[0] + y * m[4] + z * m[8];
+		float ry = x * m[1] + y * m[5] + z * m[9];
+		float rz = x * m[2] + y * m[6] + z * m[10];
+		out[0] = rx;
+		out[1] = ry;
+		out[2] = rz;
+	}
+
+	inline void Normalize1(float x, float y, float z, float* out)
+	{
+		float len2 = x * x + y * y + z * z;
+		if (len2 > 0)
+		{
+			float len = std::sqrt(len2);
+			out[0] = x / len;
+			out[1] = y / len;
+			out[2] = z / len;
+		}
+		else
+		{
+			out[0] = 0;
+			out[1] = 0;
+			out[2] = 0;
+		}
+	}
+
+	void TransformCoordsScalar(const float* m, const ConstFloat3Streams& in, const Float3Streams& out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			float r[3];
+			TransformCoord1(m, in.x[i], in.y[i], in.z[i], r);
+			out.x[i] = r[0];
+			out.y[i] = r[1];
+			out.z[i] = r[2];
+		}
+	}
+
+	void TransformNormalsScalar(const float* m, const ConstFloat3Streams& in, const Float3Streams& out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			float r[3];
+			TransformNormal1(m, in.x[i], in.y[i], in.z[i], r);
+			out.x[i] = r[0];
+			out.y[i] = r[1];
+			out.z[i] = r[2];
+		}
+	}
+
+	void NormalizeVectorsScalar(const ConstFloat3Streams& in, const Float3Streams& out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			float r[3];
+			Normalize1(in.x[i], in.y[i], in.z[i], r);
+			out.x[i] = r[0];
+			out.y[i] = r[1];
+			out.z[i] = r[2];
+		}
+	}
+
+	void BoundsOfPointsScalar(const ConstFloat3Streams& in, size_t begin, size_t end, float* mn, float* mx)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			mn[0] = (std::min)(mn[0], in.x[i]);
+			mn[1] = (std::min)(mn[1], in.y[i]);
+			mn[2] = (std::min)(mn[2], in.z[i]);
+			mx[0] = (std::max)(mx[0], in.x[i]);
+			mx[1] = (std::max)(mx[1], in.y[i]);
+			mx[2] = (std::max)(mx[2], in.z[i]);
+		}
+	}
+
+	void TransformCoordsScalar(const float* m, const float* in, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			TransformCoord1(m, in[i * 3 + 0], in[i * 3 + 1], in[i * 3 + 2], out + i * 3);
+		}
+	}
+
+	void TransformNormalsScalar(const float* m, const float* in, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			TransformNormal1(m, in[i * 3 + 0], in[i * 3 + 1], in[i * 3 + 2], out + i * 3);
+		}
+	}
+
+	void NormalizeVectorsScalar(const float* in, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Normalize1(in[i * 3 + 0], in[i * 3 + 1], in[i * 3 + 2], out + i * 3);
+		}
+	}
+
+	void BoundsOfPointsScalar(const float* xyz, size_t begin, size_t end, float* mn, float* mx)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			for (size_t c = 0; c != 3; c++)
+			{
+				mn[c] = (std::min)(mn[c], xyz[i * 3 + c]);
+				mx[c] = (std::max)(mx[c], xyz[i * 3 + c]);
+			}
+		}
+	}
+
+	//Both computed the same way on every path, so they match exactly
+
+	inline void AffineMatrix1(float sx, float sy, float sz, float qx, float qy, float qz, float qw,
+		float tx, float ty, float tz, float* m)
+	{
+		float qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+		float qxy = qx * qy, qxz = qx * qz, qyz = qy * qz;
+		float qxw = qx * qw, qyw = qy * qw, qzw = qz * qw;
+
+		m[0] = (1 - 2 * (qyy + qzz)) * sx;
+		m[1] = 2 * (qxy + qzw) * sx;
+		m[2] = 2 * (qxz - qyw) * sx;
+		m[3] = 0;
+		m[4] = 2 * (qxy - qzw) * sy;
+		m[5] = (1 - 2 * (qxx + qzz)) * sy;
+		m[6] = 2 * (qyz + qxw) * sy;
+		m[7] = 0;
+		m[8] = 2 * (qxz + qyw) * sz;
+		m[9] = 2 * (qyz - qxw) * sz;
+		m[10] = (1 - 2 * (qxx + qyy)) * sz;
+		m[11] = 0;
+		m[12] = tx;
+		m[13] = ty;
+		m[14] = tz;
+		m[15] = 1;
+	}
+
+	inline void MultiplyMatrix1(const float* a, const float* b, float* out)
+	{
+		float r[16];
+		for (size_t i = 0; i != 4; i++)
+		{
+			for (size_t j = 0; j != 4; j++)
+			{
+				r[i * 4 + j] = a[i * 4 + 0] * b[0 + j] + a[i * 4 + 1] * b[4 + j] + a[i * 4 + 2] * b[8 + j] + a[i * 4 + 3] * b[12 + j];
+			}
+		}
+		for (size_t i = 0; i != 16; i++)
+		{
+			out[i] = r[i];
+		}
+	}
+
+	void AffineMatricesScalar(const ConstFloat3Streams& s, const ConstFloat4Streams& q, const ConstFloat3Streams& t,
+		float* mats, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			AffineMatrix1(s.x[i], s.y[i], s.z[i], q.x[i], q.y[i], q.z[i], q.w[i], t.x[i], t.y[i], t.z[i], mats + i * 16);
+		}
+	}
+
+	void MultiplyMatricesScalar(const float* a, const float* b, float* out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			MultiplyMatrix1(a + i * 16, b + i * 16, out + i * 16);
+		}
+	}
+
+
+#ifdef EPSILON_BATCH_X86
+
+	//4 packed xyz triples <-> 4-wide x, y, z, three loads or stores and six shuffles each way
+
+	EPSILON_TARGET_SSE2 inline void LoadPacked4(const float* p, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 a = _mm_loadu_ps(p);		//x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(p + 4);	//y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(p + 8);	//z2 x3 y3 z3
+
+		__m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+		x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+			_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+	EPSILON_TARGET_SSE2 inline void StorePacked4(float* p, __m128 x, __m128 y, __m128 z)
+	{
+		_mm_storeu_ps(p, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),
+			_mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(p + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),
+			_mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(p + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+			_mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+
+
+	//SSE2, 4 vectors per step
+
+	struct MatrixSSE
+	{
+		__m128 m[16];
+
+		EPSILON_TARGET_SSE2 explicit MatrixSSE(const float* mat)
+		{
+			for (size_t i = 0; i != 16; i++)
+			{
+				m[i] = _mm_set1_ps(mat[i]);
+			}
+		}
+	};
+
+	EPSILON_TARGET_SSE2 inline void TransformCoord4(const MatrixSSE& m, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[0]), _mm_mul_ps(y, m.m[4])), _mm_add_ps(_mm_mul_ps(z, m.m[8]), m.m[12]));
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[1]), _mm_mul_ps(y, m.m[5])), _mm_add_ps(_mm_mul_ps(z, m.m[9]), m.m[13]));
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[2]), _mm_mul_ps(y, m.m[6])), _mm_add_ps(_mm_mul_ps(z, m.m[10]), m.m[14]));
+		__m128 rw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[3]), _mm_mul_ps(y, m.m[7])), _mm_add_ps(_mm_mul_ps(z, m.m[11]), m.m[15]));
+		x = _mm_div_ps(rx, rw);
+		y = _mm_div_ps(ry, rw);
+		z = _mm_div_ps(rz, rw);
+	}
+
+	EPSILON_TARGET_SSE2 inline void TransformNormal4(const MatrixSSE& m, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[0]), _mm_mul_ps(y, m.m[4])), _mm_mul_ps(z, m.m[8]));
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[1]), _mm_mul_ps(y, m.m[5])), _mm_mul_ps(z, m.m[9]));
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[2]), _mm_mul_ps(y, m.m[6])), _mm_mul_ps(z, m.m[10]));
+		x = rx;
+		y = ry;
+		z = rz;
+	}
+
+	EPSILON_TARGET_SSE2 inline void Normalize4(__m128& x, __m128& y, __m128& z)
+	{
+		__m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		__m128 nonzero = _mm_cmpgt_ps(len2, _mm_setzero_ps());
+		__m128 len = _mm_sqrt_ps(len2);
+		x = _mm_and_ps(_mm_div_ps(x, len), nonzero);
+		y = _mm_and_ps(_mm_div_ps(y, len), nonzero);
+		z = _mm_and_ps(_mm_div_ps(z, len), nonzero);
+	}
+
+	EPSILON_TARGET_SSE2 inline void StoreMinMax4(__m128 vmn, __m128 vmx, float& mn, float& mx)
+	{
+		float lanes[4];
+		_mm_storeu_ps(lanes, vmn);
+		mn = (std::min)((std::min)(mn, lanes[0]), (std::min)((std::min)(lanes[1], lanes[2]), lanes[3]));
+		_mm_storeu_ps(lanes, vmx);
+		mx = (std::max)((std::max)(mx, lanes[0]), (std::max)((std::max)(lanes[1], lanes[2]), lanes[3]));
+	}
+
+	EPSILON_TARGET_SSE2 void TransformCoordsSSE2(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		MatrixSSE m(mat);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(in.x + i);
+			__m128 y = _mm_loadu_ps(in.y + i);
+			__m128 z = _mm_loadu_ps(in.z + i);
+			TransformCoord4(m, x, y, z);
+			_mm_storeu_ps(out.x + i, x);
+			_mm_storeu_ps(out.y + i, y);
+			_mm_storeu_ps(out.z + i, z);
+		}
+		TransformCoordsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void TransformNormalsSSE2(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		MatrixSSE m(mat);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(in.x + i);
+			__m128 y = _mm_loadu_ps(in.y + i);
+			__m128 z = _mm_loadu_ps(in.z + i);
+			TransformNormal4(m, x, y, z);
+			_mm_storeu_ps(out.x + i, x);
+			_mm_storeu_ps(out.y + i, y);
+			_mm_storeu_ps(out.z + i, z);
+		}
+		TransformNormalsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void NormalizeVectorsSSE2(const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(in.x + i);
+			__m128 y = _mm_loadu_ps(in.y + i);
+			__m128 z = _mm_loadu_ps(in.z + i);
+			Normalize4(x, y, z);
+			_mm_storeu_ps(out.x + i, x);
+			_mm_storeu_ps(out.y + i, y);
+			_mm_storeu_ps(out.z + i, z);
+		}
+		NormalizeVectorsScalar(in, out, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void BoundsOfPointsSSE2(const ConstFloat3Streams& in, size_t count, float* mn, float* mx)
+	{
+		__m128 mn_x = _mm_set1_ps(mn[0]), mn_y = _mm_set1_ps(mn[1]), mn_z = _mm_set1_ps(mn[2]);
+		__m128 mx_x = _mm_set1_ps(mx[0]), mx_y = _mm_set1_ps(mx[1]), mx_z = _mm_set1_ps(mx[2]);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(in.x + i);
+			__m128 y = _mm_loadu_ps(in.y + i);
+			__m128 z = _mm_loadu_ps(in.z + i);
+			mn_x = _mm_min_ps(mn_x, x);
+			mn_y = _mm_min_ps(mn_y, y);
+			mn_z = _mm_min_ps(mn_z, z);
+			mx_x = _mm_max_ps(mx_x, x);
+			mx_y = _mm_max_ps(mx_y, y);
+			mx_z = _mm_max_ps(mx_z, z);
+		}
+		StoreMinMax4(mn_x, mx_x, mn[0], mx[0]);
+		StoreMinMax4(mn_y, mx_y, mn[1], mx[1]);
+		StoreMinMax4(mn_z, mx_z, mn[2], mx[2]);
+		BoundsOfPointsScalar(in, i, count, mn, mx);
+	}
+
+	EPSILON_TARGET_SSE2 void TransformCoordsSSE2(const float* mat, const float* in, float* out, size_t count)
+	{
+		MatrixSSE m(mat);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			LoadPacked4(in + i * 3, x, y, z);
+			TransformCoord4(m, x, y, z);
+			StorePacked4(out + i * 3, x, y, z);
+		}
+		TransformCoordsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void TransformNormalsSSE2(const float* mat, const float* in, float* out, size_t count)
+	{
+		MatrixSSE m(mat);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			LoadPacked4(in + i * 3, x, y, z);
+			TransformNormal4(m, x, y, z);
+			StorePacked4(out + i * 3, x, y, z);
+		}
+		TransformNormalsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void NormalizeVectorsSSE2(const float* in, float* out, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			LoadPacked4(in + i * 3, x, y, z);
+			Normalize4(x, y, z);
+			StorePacked4(out + i * 3, x, y, z);
+		}
+		NormalizeVectorsScalar(in, out, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void BoundsOfPointsSSE2(const float* xyz, size_t count, float* mn, float* mx)
+	{
+		__m128 mn_x = _mm_set1_ps(mn[0]), mn_y = _mm_set1_ps(mn[1]), mn_z = _mm_set1_ps(mn[2]);
+		__m128 mx_x = _mm_set1_ps(mx[0]), mx_y = _mm_set1_ps(mx[1]), mx_z = _mm_set1_ps(mx[2]);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			LoadPacked4(xyz + i * 3, x, y, z);
+			mn_x = _mm_min_ps(mn_x, x);
+			mn_y = _mm_min_ps(mn_y, y);
+			mn_z = _mm_min_ps(mn_z, z);
+			mx_x = _mm_max_ps(mx_x, x);
+			mx_y = _mm_max_ps(mx_y, y);
+			mx_z = _mm_max_ps(mx_z, z);
+		}
+		StoreMinMax4(mn_x, mx_x, mn[0], mx[0]);
+		StoreMinMax4(mn_y, mx_y, mn[1], mx[1]);
+		StoreMinMax4(mn_z, mx_z, mn[2], mx[2]);
+		BoundsOfPointsScalar(xyz, i, count, mn, mx);
+	}
+
+	//Row r of 4 matrices from its columns across them, c0 holding m[r][0] of each
+	EPSILON_TARGET_SSE2 inline void StoreMatrixRows4(float* mats, size_t r, __m128 c0, __m128 c1, __m128 c2, __m128 c3)
+	{
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(mats + 0 * 16 + r * 4, c0);
+		_mm_storeu_ps(mats + 1 * 16 + r * 4, c1);
+		_mm_storeu_ps(mats + 2 * 16 + r * 4, c2);
+		_mm_storeu_ps(mats + 3 * 16 + r * 4, c3);
+	}
+
+	EPSILON_TARGET_SSE2 void AffineMatricesSSE2(const ConstFloat3Streams& s, const ConstFloat4Streams& q,
+		const ConstFloat3Streams& t, float* mats, size_t count)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1);
+		__m128 two = _mm_set1_ps(2);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 qx = _mm_loadu_ps(q.x + i);
+			__m128 qy = _mm_loadu_ps(q.y + i);
+			__m128 qz = _mm_loadu_ps(q.z + i);
+			__m128 qw = _mm_loadu_ps(q.w + i);
+			__m128 sx = _mm_loadu_ps(s.x + i);
+			__m128 sy = _mm_loadu_ps(s.y + i);
+			__m128 sz = _mm_loadu_ps(s.z + i);
+
+			__m128 qxx = _mm_mul_ps(qx, qx), qyy = _mm_mul_ps(qy, qy), qzz = _mm_mul_ps(qz, qz);
+			__m128 qxy = _mm_mul_ps(qx, qy), qxz = _mm_mul_ps(qx, qz), qyz = _mm_mul_ps(qy, qz);
+			__m128 qxw = _mm_mul_ps(qx, qw), qyw = _mm_mul_ps(qy, qw), qzw = _mm_mul_ps(qz, qw);
+
+			float* m = mats + i * 16;
+			StoreMatrixRows4(m, 0,
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qyy, qzz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxy, qzw)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxz, qyw)), sx),
+				zero);
+			StoreMatrixRows4(m, 1,
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxy, qzw)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qzz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qyz, qxw)), sy),
+				zero);
+			StoreMatrixRows4(m, 2,
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxz, qyw)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qyz, qxw)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qyy))), sz),
+				zero);
+			StoreMatrixRows4(m, 3, _mm_loadu_ps(t.x + i), _mm_loadu_ps(t.y + i), _mm_loadu_ps(t.z + i), one);
+		}
+		AffineMatricesScalar(s, q, t, mats, i, count);
+	}
+
+	EPSILON_TARGET_SSE2 void MultiplyMatricesSSE2(const float* a, const float* b, float* out, size_t count)
+	{
+		for (size_t i = 0; i != count; i++)
+		{
+			const float* mb = b + i * 16;
+			__m128 b0 = _mm_loadu_ps(mb + 0);
+			__m128 b1 = _mm_loadu_ps(mb + 4);
+			__m128 b2 = _mm_loadu_ps(mb + 8);
+			__m128 b3 = _mm_loadu_ps(mb + 12);
+
+			__m128 r[4];
+			for (size_t row = 0; row != 4; row++)
+			{
+				__m128 ra = _mm_loadu_ps(a + i * 16 + row * 4);
+				r[row] = _mm_mul_ps(_mm_shuffle_ps(ra, ra, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+				r[row] = _mm_add_ps(r[row], _mm_mul_ps(_mm_shuffle_ps(ra, ra, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+				r[row] = _mm_add_ps(r[row], _mm_mul_ps(_mm_shuffle_ps(ra, ra, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+				r[row] = _mm_add_ps(r[row], _mm_mul_ps(_mm_shuffle_ps(ra, ra, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+			}
+			for (size_t row = 0; row != 4; row++)
+			{
+				_mm_storeu_ps(out + i * 16 + row * 4, r[row]);
+			}
+		}
+	}
+
+
+	//AVX2 with FMA, 8 vectors per step. Packed input goes through two 4-wide transposes
+
+	struct MatrixAVX2
+	{
+		__m256 m[16];
+
+		EPSILON_TARGET_AVX2 explicit MatrixAVX2(const float* mat)
+		{
+			for (size_t i = 0; i != 16; i++)
+			{
+				m[i] = _mm256_set1_ps(mat[i]);
+			}
+		}
+	};
+
+	EPSILON_TARGET_AVX2 inline __m256 Combine(__m128 lo, __m128 hi)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+
+	EPSILON_TARGET_AVX2 inline void LoadPacked8(const float* p, __m256& x, __m256& y, __m256& z)
+	{
+		__m128 x0, y0, z0, x1, y1, z1;
+		LoadPacked4(p, x0, y0, z0);
+		LoadPacked4(p + 12, x1, y1, z1);
+		x = Combine(x0, x1);
+		y = Combine(y0, y1);
+		z = Combine(z0, z1);
+	}
+
+	EPSILON_TARGET_AVX2 inline void StorePacked8(float* p, __m256 x, __m256 y, __m256 z)
+	{
+		StorePacked4(p, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+		StorePacked4(p + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+	}
+
+	EPSILON_TARGET_AVX2 inline void TransformCoord8(const MatrixAVX2& m, __m256& x, __m256& y, __m256& z)
+	{
+		__m256 rx = _mm256_fmadd_ps(x, m.m[0], _mm256_fmadd_ps(y, m.m[4], _mm256_fmadd_ps(z, m.m[8], m.m[12])));
+		__m256 ry = _mm256_fmadd_ps(x, m.m[1], _mm256_fmadd_ps(y, m.m[5], _mm256_fmadd_ps(z, m.m[9], m.m[13])));
+		__m256 rz = _mm256_fmadd_ps(x, m.m[2], _mm256_fmadd_ps(y, m.m[6], _mm256_fmadd_ps(z, m.m[10], m.m[14])));
+		__m256 rw = _mm256_fmadd_ps(x, m.m[3], _mm256_fmadd_ps(y, m.m[7], _mm256_fmadd_ps(z, m.m[11], m.m[15])));
+		x = _mm256_div_ps(rx, rw);
+		y = _mm256_div_ps(ry, rw);
+		z = _mm256_div_ps(rz, rw);
+	}
+
+	EPSILON_TARGET_AVX2 inline void TransformNormal8(const MatrixAVX2& m, __m256& x, __m256& y, __m256& z)
+	{
+		__m256 rx = _mm256_fmadd_ps(x, m.m[0], _mm256_fmadd_ps(y, m.m[4], _mm256_mul_ps(z, m.m[8])));
+		__m256 ry = _mm256_fmadd_ps(x, m.m[1], _mm256_fmadd_ps(y, m.m[5], _mm256_mul_ps(z, m.m[9])));
+		__m256 rz = _mm256_fmadd_ps(x, m.m[2], _mm256_fmadd_ps(y, m.m[6], _mm256_mul_ps(z, m.m[10])));
+		x = rx;
+		y = ry;
+		z = rz;
+	}
+
+	EPSILON_TARGET_AVX2 inline void Normalize8(__m256& x, __m256& y, __m256& z)
+	{
+		__m256 len2 = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+		__m256 nonzero = _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ);
+		__m256 len = _mm256_sqrt_ps(len2);
+		x = _mm256_and_ps(_mm256_div_ps(x, len), nonzero);
+		y = _mm256_and_ps(_mm256_div_ps(y, len), nonzero);
+		z = _mm256_and_ps(_mm256_div_ps(z, len), nonzero);
+	}
+
+	EPSILON_TARGET_AVX2 inline void StoreMinMax8(__m256 vmn, __m256 vmx, float& mn, float& mx)
+	{
+		StoreMinMax4(_mm_min_ps(_mm256_castps256_ps128(vmn), _mm256_extractf128_ps(vmn, 1)),
+			_mm_max_ps(_mm256_castps256_ps128(vmx), _mm256_extractf128_ps(vmx, 1)), mn, mx);
+	}
+
+	EPSILON_TARGET_AVX2 void TransformCoordsAVX2(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		MatrixAVX2 m(mat);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(in.x + i);
+			__m256 y = _mm256_loadu_ps(in.y + i);
+			__m256 z = _mm256_loadu_ps(in.z + i);
+			TransformCoord8(m, x, y, z);
+			_mm256_storeu_ps(out.x + i, x);
+			_mm256_storeu_ps(out.y + i, y);
+			_mm256_storeu_ps(out.z + i, z);
+		}
+		TransformCoordsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_AVX2 void TransformNormalsAVX2(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		MatrixAVX2 m(mat);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(in.x + i);
+			__m256 y = _mm256_loadu_ps(in.y + i);
+			__m256 z = _mm256_loadu_ps(in.z + i);
+			TransformNormal8(m, x, y, z);
+			_mm256_storeu_ps(out.x + i, x);
+			_mm256_storeu_ps(out.y + i, y);
+			_mm256_storeu_ps(out.z + i, z);
+		}
+		TransformNormalsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_AVX2 void NormalizeVectorsAVX2(const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(in.x + i);
+			__m256 y = _mm256_loadu_ps(in.y + i);
+			__m256 z = _mm256_loadu_ps(in.z + i);
+			Normalize8(x, y, z);
+			_mm256_storeu_ps(out.x + i, x);
+			_mm256_storeu_ps(out.y + i, y);
+			_mm256_storeu_ps(out.z + i, z);
+		}
+		NormalizeVectorsScalar(in, out, i, count);
+	}
+
+	EPSILON_TARGET_AVX2 void BoundsOfPointsAVX2(const ConstFloat3Streams& in, size_t count, float* mn, float* mx)
+	{
+		__m256 mn_x = _mm256_set1_ps(mn[0]), mn_y = _mm256_set1_ps(mn[1]), mn_z = _mm256_set1_ps(mn[2]);
+		__m256 mx_x = _mm256_set1_ps(mx[0]), mx_y = _mm256_set1_ps(mx[1]), mx_z = _mm256_set1_ps(mx[2]);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(in.x + i);
+			__m256 y = _mm256_loadu_ps(in.y + i);
+			__m256 z = _mm256_loadu_ps(in.z + i);
+			mn_x = _mm256_min_ps(mn_x, x);
+			mn_y = _mm256_min_ps(mn_y, y);
+			mn_z = _mm256_min_ps(mn_z, z);
+			mx_x = _mm256_max_ps(mx_x, x);
+			mx_y = _mm256_max_ps(mx_y, y);
+			mx_z = _mm256_max_ps(mx_z, z);
+		}
+		StoreMinMax8(mn_x, mx_x, mn[0], mx[0]);
+		StoreMinMax8(mn_y, mx_y, mn[1], mx[1]);
+		StoreMinMax8(mn_z, mx_z, mn[2], mx[2]);
+		BoundsOfPointsScalar(in, i, count, mn, mx);
+	}
+
+	EPSILON_TARGET_AVX2 void TransformCoordsAVX2(const float* mat, const float* in, float* out, size_t count)
+	{
+		MatrixAVX2 m(mat);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x, y, z;
+			LoadPacked8(in + i * 3, x, y, z);
+			TransformCoord8(m, x, y, z);
+			StorePacked8(out + i * 3, x, y, z);
+		}
+		TransformCoordsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_AVX2 void TransformNormalsAVX2(const float* mat, const float* in, float* out, size_t count)
+	{
+		MatrixAVX2 m(mat);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x, y, z;
+			LoadPacked8(in + i * 3, x, y, z);
+			TransformNormal8(m, x, y, z);
+			StorePacked8(out + i * 3, x, y, z);
+		}
+		TransformNormalsScalar(mat, in, out, i, count);
+	}
+
+	EPSILON_TARGET_AVX2 void NormalizeVectorsAVX2(const float* in, float* out, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x, y, z;
+			LoadPacked8(in + i * 3, x, y, z);
+			Normalize8(x, y, z);
+			StorePacked8(out + i * 3, x, y, z);
+		}
+		NormalizeVectorsScalar(in, out, i, count);
+	}
+
+	EPSILON_TARGET_AVX2 void BoundsOfPointsAVX2(const float* xyz, size_t count, float* mn, float* mx)
+	{
+		__m256 mn_x = _mm256_set1_ps(mn[0]), mn_y = _mm256_set1_ps(mn[1]), mn_z = _mm256_set1_ps(mn[2]);
+		__m256 mx_x = _mm256_set1_ps(mx[0]), mx_y = _mm256_set1_ps(mx[1]), mx_z = _mm256_set1_ps(mx[2]);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x, y, z;
+			LoadPacked8(xyz + i * 3, x, y, z);
+			mn_x = _mm256_min_ps(mn_x, x);
+			mn_y = _mm256_min_ps(mn_y, y);
+			mn_z = _mm256_min_ps(mn_z, z);
+			mx_x = _mm256_max_ps(mx_x, x);
+			mx_y = _mm256_max_ps(mx_y, y);
+			mx_z = _mm256_max_ps(mx_z, z);
+		}
+		StoreMinMax8(mn_x, mx_x, mn[0], mx[0]);
+		StoreMinMax8(mn_y, mx_y, mn[1], mx[1]);
+		StoreMinMax8(mn_z, mx_z, mn[2], mx[2]);
+		BoundsOfPointsScalar(xyz, i, count, mn, mx);
+	}
+
+	//Two rows per step, each lane pair holding one. No FMA, so it rounds like the other paths
+	EPSILON_TARGET_AVX2 void MultiplyMatricesAVX2(const float* a, const float* b, float* out, size_t count)
+	{
+		for (size_t i = 0; i != count; i++)
+		{
+			const float* mb = b + i * 16;
+			__m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mb + 0));
+			__m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mb + 4));
+			__m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mb + 8));
+			__m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(mb + 12));
+
+			__m256 r[2];
+			for (size_t half = 0; half != 2; half++)
+			{
+				__m256 ra = _mm256_loadu_ps(a + i * 16 + half * 8);
+				r[half] = _mm256_mul_ps(_mm256_permute_ps(ra, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+				r[half] = _mm256_add_ps(r[half], _mm256_mul_ps(_mm256_permute_ps(ra, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+				r[half] = _mm256_add_ps(r[half], _mm256_mul_ps(_mm256_permute_ps(ra, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+				r[half] = _mm256_add_ps(r[half], _mm256_mul_ps(_mm256_permute_ps(ra, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+			}
+			_mm256_storeu_ps(out + i * 16, r[0]);
+			_mm256_storeu_ps(out + i * 16 + 8, r[1]);
+		}
+	}
+
+#endif
+
+
+	SIMDLevel DetectSIMDLevel()
+	{
+#ifdef EPSILON_BATCH_X86
+		bool sse2;
+		bool avx2;
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		int max_leaf = info[0];
+
+		__cpuid(info, 1);
+		sse2 = (info[3] & (1 << 26)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+
+		//The OS has to save the YMM registers too
+		avx2 = false;
+		if (fma && osxsave && ((_xgetbv(0) & 6) == 6) && (max_leaf >= 7))
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		sse2 = __builtin_cpu_supports("sse2") != 0;
+		avx2 = (__builtin_cpu_supports("avx2") != 0) && (__builtin_cpu_supports("fma") != 0);
+#endif
+		if (avx2)
+		{
+			return SL_AVX2;
+		}
+		if (sse2)
+		{
+			return SL_SSE2;
+		}
+#endif
+		return SL_Scalar;
+	}
+
+	SIMDLevel ActiveSIMDLevel()
+	{
+		int level = active_simd_level_.load(std::memory_order_relaxed);
+		if (level < 0)
+		{
+			level = DetectSIMDLevel();
+			active_simd_level_.store(level, std::memory_order_relaxed);
+		}
+		return static_cast<SIMDLevel>(level);
+	}
+
+	void ForceSIMDLevel(SIMDLevel level)
+	{
+		active_simd_level_.store((std::min)(level, DetectSIMDLevel()), std::memory_order_relaxed);
+	}
+
+	const char* SIMDLevelName(SIMDLevel level)
+	{
+		switch (level)
+		{
+		case SL_SSE2:
+			return "SSE2";
+
+		case SL_AVX2:
+			return "AVX2";
+
+		default:
+			return "Scalar";
+		}
+	}
+
+
+	void TransformCoords(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			TransformCoordsAVX2(mat, in, out, count);
+			break;
+
+		case SL_SSE2:
+			TransformCoordsSSE2(mat, in, out, count);
+			break;
+#endif
+
+		default:
+			TransformCoordsScalar(mat, in, out, 0, count);
+			break;
+		}
+	}
+
+	void TransformNormals(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			TransformNormalsAVX2(mat, in, out, count);
+			break;
+
+		case SL_SSE2:
+			TransformNormalsSSE2(mat, in, out, count);
+			break;
+#endif
+
+		default:
+			TransformNormalsScalar(mat, in, out, 0, count);
+			break;
+		}
+	}
+
+	void NormalizeVectors(const ConstFloat3Streams& in, const Float3Streams& out, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			NormalizeVectorsAVX2(in, out, count);
+			break;
+
+		case SL_SSE2:
+			NormalizeVectorsSSE2(in, out, count);
+			break;
+#endif
+
+		default:
+			NormalizeVectorsScalar(in, out, 0, count);
+			break;
+		}
+	}
+
+	void BoundsOfPoints(const ConstFloat3Streams& in, size_t count, float* min_xyz, float* max_xyz)
+	{
+		for (size_t c = 0; c != 3; c++)
+		{
+			min_xyz[c] = FLT_MAX;
+			max_xyz[c] = -FLT_MAX;
+		}
+
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			BoundsOfPointsAVX2(in, count, min_xyz, max_xyz);
+			break;
+
+		case SL_SSE2:
+			BoundsOfPointsSSE2(in, count, min_xyz, max_xyz);
+			break;
+#endif
+
+		default:
+			BoundsOfPointsScalar(in, 0, count, min_xyz, max_xyz);
+			break;
+		}
+	}
+
+	void TransformCoords(const float* mat, const float* in_xyz, float* out_xyz, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			TransformCoordsAVX2(mat, in_xyz, out_xyz, count);
+			break;
+
+		case SL_SSE2:
+			TransformCoordsSSE2(mat, in_xyz, out_xyz, count);
+			break;
+#endif
+
+		default:
+			TransformCoordsScalar(mat, in_xyz, out_xyz, 0, count);
+			break;
+		}
+	}
+
+	void TransformNormals(const float* mat, const float* in_xyz, float* out_xyz, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			TransformNormalsAVX2(mat, in_xyz, out_xyz, count);
+			break;
+
+		case SL_SSE2:
+			TransformNormalsSSE2(mat, in_xyz, out_xyz, count);
+			break;
+#endif
+
+		default:
+			TransformNormalsScalar(mat, in_xyz, out_xyz, 0, count);
+			break;
+		}
+	}
+
+	void NormalizeVectors(const float* in_xyz, float* out_xyz, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			NormalizeVectorsAVX2(in_xyz, out_xyz, count);
+			break;
+
+		case SL_SSE2:
+			NormalizeVectorsSSE2(in_xyz, out_xyz, count);
+			break;
+#endif
+
+		default:
+			NormalizeVectorsScalar(in_xyz, out_xyz, 0, count);
+			break;
+		}
+	}
+
+	void BoundsOfPoints(const float* xyz, size_t count, float* min_xyz, float* max_xyz)
+	{
+		for (size_t c = 0; c != 3; c++)
+		{
+			min_xyz[c] = FLT_MAX;
+			max_xyz[c] = -FLT_MAX;
+		}
+
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			BoundsOfPointsAVX2(xyz, count, min_xyz, max_xyz);
+			break;
+
+		case SL_SSE2:
+			BoundsOfPointsSSE2(xyz, count, min_xyz, max_xyz);
+			break;
+#endif
+
+		default:
+			BoundsOfPointsScalar(xyz, 0, count, min_xyz, max_xyz);
+			break;
+		}
+	}
+
+	void AffineMatrices(const ConstFloat3Streams& scales, const ConstFloat4Streams& rotations,
+		const ConstFloat3Streams& translations, float* mats, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+		case SL_SSE2:
+			AffineMatricesSSE2(scales, rotations, translations, mats, count);
+			break;
+#endif
+
+		default:
+			AffineMatricesScalar(scales, rotations, translations, mats, 0, count);
+			break;
+		}
+	}
+
+	void MultiplyMatrices(const float* a, const float* b, float* out, size_t count)
+	{
+		switch (ActiveSIMDLevel())
+		{
+#ifdef EPSILON_BATCH_X86
+		case SL_AVX2:
+			MultiplyMatricesAVX2(a, b, out, count);
+			break;
+
+		case SL_SSE2:
+			MultiplyMatricesSSE2(a, b, out, count);
+			break;
+#endif
+
+		default:
+			MultiplyMatricesScalar(a, b, out, 0, count);
+			break;
+		}
+	}
+
+}
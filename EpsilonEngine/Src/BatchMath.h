@@ -0,0 +1,88 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+
+namespace epsilon
+{
+
+	//Loops over whole arrays of vectors, so loads, stores and the matrix setup are paid once per batch
+	//instead of once per element. Matrices are 16 floats, row-major, applied to row vectors like
+	//DirectXMath. No Windows or DirectXMath dependency, the kernels build with MSVC, GCC and Clang
+
+	enum SIMDLevel
+	{
+		SL_Scalar,
+		SL_SSE2,
+		SL_AVX2
+	};
+
+	//Best level the CPU and OS support
+	SIMDLevel DetectSIMDLevel();
+
+	//Level the batch functions run at, the detected one unless forced lower
+	SIMDLevel ActiveSIMDLevel();
+
+	//Clamped to the detected level, for comparing the paths against each other
+	void ForceSIMDLevel(SIMDLevel level);
+
+	const char* SIMDLevelName(SIMDLevel level);
+
+
+	//Structure-of-arrays view of 3-vectors. Output streams may be the input streams
+	struct Float3Streams
+	{
+		float* x;
+		float* y;
+		float* z;
+	};
+
+	struct ConstFloat3Streams
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+
+		ConstFloat3Streams(const float* xx, const float* yy, const float* zz) : x(xx), y(yy), z(zz) {}
+		ConstFloat3Streams(const Float3Streams& s) : x(s.x), y(s.y), z(s.z) {}
+	};
+
+	//Point with w = 1, divided by the resulting w
+	void TransformCoords(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count);
+
+	//Direction, the translation row is ignored
+	void TransformNormals(const float* mat, const ConstFloat3Streams& in, const Float3Streams& out, size_t count);
+
+	//Zero-length vectors stay zero
+	void NormalizeVectors(const ConstFloat3Streams& in, const Float3Streams& out, size_t count);
+
+	//An empty set gives min > max
+	void BoundsOfPoints(const ConstFloat3Streams& in, size_t count, float* min_xyz, float* max_xyz);
+
+
+	//Same operations on packed xyz triples, the layout of Vector3f arrays. out may be in
+	void TransformCoords(const float* mat, const float* in_xyz, float* out_xyz, size_t count);
+	void TransformNormals(const float* mat, const float* in_xyz, float* out_xyz, size_t count);
+	void NormalizeVectors(const float* in_xyz, float* out_xyz, size_t count);
+	void BoundsOfPoints(const float* xyz, size_t count, float* min_xyz, float* max_xyz);
+
+
+	struct ConstFloat4Streams
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* w;
+
+		ConstFloat4Streams(const float* xx, const float* yy, const float* zz, const float* ww) : x(xx), y(yy), z(zz), w(ww) {}
+	};
+
+	//Scale, then rotate by the unit quaternion, then translate: XMMatrixAffineTransformation with the
+	//rotation origin at zero. 16 floats per matrix in mats. AVX2 runs the SSE2 kernel
+	void AffineMatrices(const ConstFloat3Streams& scales, const ConstFloat4Streams& rotations,
+		const ConstFloat3Streams& translations, float* mats, size_t count);
+
+	//out[i] = a[i] * b[i] like XMMatrixMultiply, 16 floats each. out may be a or b
+	void MultiplyMatrices(const float* a, const float* b, float* out, size_t count);
+
+}
@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+#include "RenderEngine.h"
+#include "Camera.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+
+namespace epsilon
+{
+
+	Benchmark::Benchmark(RenderEngine& re, CameraPtr cam, const CameraPath& path, uint32_t num_frames,
+		uint32_t num_warmup_frames /*= 30*/)
+		: re_(re), cam_(cam), path_(path), num_frames_((std::max)(num_frames, 1u)), num_warmup_frames_(num_warmup_frames),
+			frame_(0), done_(false)
+	{
+		stats_.Reserve(num_frames_);
+	}
+
+	bool Benchmark::Frame()
+	{
+		if (done_)
+		{
+			return false;
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		//The previous frame has completed, so its time and counters are known
+		if (frame_ > num_warmup_frames_)
+		{
+			this->Sample(std::chrono::duration<double, std::milli>(now - last_).count());
+		}
+		last_ = now;
+
+		if (frame_ == num_warmup_frames_ + num_frames_)
+		{
+			done_ = true;
+			return false;
+		}
+
+		float t = 0;
+		if ((frame_ >= num_warmup_frames_) && (num_frames_ > 1))
+		{
+			t = static_cast<float>(frame_ - num_warmup_frames_) / (num_frames_ - 1);
+		}
+		CameraKey key = path_.Evaluate(t);
+		cam_->LookAt(key.eye, key.at, cam_->up_);
+
+		++frame_;
+		return true;
+	}
+
+	bool Benchmark::Done() const
+	{
+		return done_;
+	}
+
+	void Benchmark::Sample(double frame_ms)
+	{
+		stats_.Sample(frame_ms, re_.PassTimings(), re_.Statistics());
+	}
+
+	void Benchmark::WriteJson(std::ostream& os) const
+	{
+		stats_.WriteJson(os, num_warmup_frames_);
+		os << "\n";
+	}
+
+	void Benchmark::WriteJson(const std::string& file_path) const
+	{
+		std::ofstream ofs(file_path);
+		this->WriteJson(ofs);
+	}
+
+}
\ No newline at end of file
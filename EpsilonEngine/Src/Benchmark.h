@@ -0,0 +1,45 @@
+#pragma once
+#include "Utils.h"
+#include "RSPredeclare.h"
+#include "CameraPath.h"
+#include "FrameStats.h"
+#include <chrono>
+#include <ostream>
+
+
+namespace epsilon
+{
+
+	//Flies the camera along a path for a fixed number of frames and summarizes the frame times
+	class Benchmark
+	{
+	public:
+		Benchmark(RenderEngine& re, CameraPtr cam, const CameraPath& path, uint32_t num_frames, uint32_t num_warmup_frames = 30);
+
+		//Call before each frame, returns false once every frame has been measured
+		bool Frame();
+
+		bool Done() const;
+
+		void WriteJson(std::ostream& os) const;
+		void WriteJson(const std::string& file_path) const;
+
+	private:
+		void Sample(double frame_ms);
+
+	private:
+		RenderEngine& re_;
+		CameraPtr cam_;
+		CameraPath path_;
+
+		uint32_t num_frames_;
+		uint32_t num_warmup_frames_;
+		uint32_t frame_;
+		bool done_;
+
+		std::chrono::steady_clock::time_point last_;
+
+		FrameStats stats_;
+	};
+
+}
@@ -1,23 +1,17 @@
 #include "Camera.h"
-#include <d3dx11effect.h>
 
 
 namespace epsilon
 {
 
-	void Camera::Bind(ID3DX11Effect* effect)
+	void Camera::FillConstants(FrameConstants& constants) const
 	{
-		auto var_g_model_mat = effect->GetVariableByName("g_model_mat")->AsMatrix();
-		auto var_g_view_mat = effect->GetVariableByName("g_view_mat")->AsMatrix();
-		auto var_g_proj_mat = effect->GetVariableByName("g_proj_mat")->AsMatrix();
-		auto var_g_inv_proj_mat = effect->GetVariableByName("g_inv_proj_mat")->AsMatrix();
+		XMStoreFloat4x4(&constants.view_mat, view_);
+		XMStoreFloat4x4(&constants.proj_mat, proj_);
+		XMStoreFloat4x4(&constants.inv_proj_mat, proj_.Inverse());
 
-		var_g_model_mat->SetMatrix((float*)&world_);
-		var_g_view_mat->SetMatrix((float*)&view_);
-		var_g_proj_mat->SetMatrix((float*)&proj_);
-
-		Matrix inv_proj = proj_.Inverse();
-		var_g_inv_proj_mat->SetMatrix((float*)&inv_proj);
+		float q = far_plane_ / (far_plane_ - near_plane_);
+		constants.near_q_far = Vector4f(near_plane_ * q, q, far_plane_, 1 / far_plane_);
 	}
 
 	void Camera::LookAt(Vector3f pos, Vector3f target, Vector3f up)
@@ -30,7 +24,9 @@ namespace epsilon
 
 	void Camera::Perspective(float ang, float aspect, float near_plane, float far_plane)
 	{
-		proj_ = XMMatrixPerspectiveFovLH(ang, aspect, near_plane, far_plane);
+		//Translating clip space by w times the offset moves every projected point by the offset itself
+		proj_ = XMMatrixPerspectiveFovLH(ang, aspect, near_plane, far_plane)
+			* XMMatrixTranslation(jitter_.x, jitter_.y, 0);
 
 		ang_ = ang;
 		aspect_ = aspect;
@@ -38,6 +34,19 @@ namespace epsilon
 		far_plane_ = far_plane;
 	}
 
+	void Camera::Jitter(float x, float y)
+	{
+		jitter_ = Vector2f(x, y);
+		this->Perspective(ang_, aspect_, near_plane_, far_plane_);
+	}
+
+	Matrix Camera::ViewProj() const
+	{
+		Matrix view_proj;
+		view_proj = view_ * XMMatrixPerspectiveFovLH(ang_, aspect_, near_plane_, far_plane_);
+		return view_proj;
+	}
+
 	Vector3f Camera::ForwardVec()
 	{
 		return Normalize(look_at_ - eye_pos_);
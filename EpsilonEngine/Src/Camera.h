@@ -1,6 +1,7 @@
 #pragma once
 #include "Utils.h"
 #include "D3D11Predeclare.h"
+#include "ShaderConstants.h"
 
 
 namespace epsilon
@@ -9,18 +10,29 @@ namespace epsilon
 	class Camera
 	{
 	public:
-		void Bind(ID3DX11Effect* effect);
+		//Fills the camera part of the per-frame constants
+		void FillConstants(FrameConstants& constants) const;
 
 		void LookAt(Vector3f pos, Vector3f target, Vector3f up);
 
+		//The projection is moved by the current jitter
 		void Perspective(float ang, float aspect, float near_plane, float far_plane);
 
+		//Moves the projection by a sub-pixel offset in NDC, a new one each frame for temporal anti-aliasing
+		void Jitter(float x, float y);
+
+		//View-projection without the jitter
+		Matrix ViewProj() const;
+
 		Vector3f ForwardVec();
 
-		Matrix world_;
 		Matrix view_;
 		Matrix proj_;
 
+		//Unjittered view-projection of the previous frame, for finding where a position was in its image
+		Matrix prev_view_proj_;
+		Vector2f jitter_;
+
 		Vector3f eye_pos_;
 		Vector3f look_at_;
 		Vector3f up_;
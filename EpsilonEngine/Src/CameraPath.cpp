@@ -0,0 +1,82 @@
+#include "CameraPath.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+
+namespace epsilon
+{
+
+	void CameraPath::AddKey(const Vector3f& eye, const Vector3f& at)
+	{
+		CameraKey key;
+		key.eye = eye;
+		key.at = at;
+		keys_.push_back(key);
+	}
+
+	void CameraPath::Load(const std::string& file_path)
+	{
+		std::ifstream ifs(file_path);
+		if (!ifs)
+		{
+			DO_THROW_MSG(("Can't open camera path " + file_path).c_str());
+		}
+
+		keys_.clear();
+
+		std::string line;
+		while (std::getline(ifs, line))
+		{
+			std::istringstream iss(line);
+			Vector3f eye, at;
+			if (iss >> eye.x >> eye.y >> eye.z >> at.x >> at.y >> at.z)
+			{
+				this->AddKey(eye, at);
+			}
+		}
+	}
+
+	size_t CameraPath::NumKeys() const
+	{
+		return keys_.size();
+	}
+
+	CameraKey CameraPath::Evaluate(float t) const
+	{
+		if (keys_.size() < 2)
+		{
+			return keys_.empty() ? CameraKey() : keys_[0];
+		}
+
+		int last = static_cast<int>(keys_.size()) - 1;
+		float s = (std::min)((std::max)(t, 0.0f), 1.0f) * last;
+		int seg = (std::min)(static_cast<int>(s), last - 1);
+		float u = s - seg;
+
+		//End segments reuse the end keys as their outer control points
+		const CameraKey& k0 = keys_[(std::max)(seg - 1, 0)];
+		const CameraKey& k1 = keys_[seg];
+		const CameraKey& k2 = keys_[seg + 1];
+		const CameraKey& k3 = keys_[(std::min)(seg + 2, last)];
+
+		CameraKey key;
+		key.eye.XMV(XMVectorCatmullRom(k0.eye.XMV(), k1.eye.XMV(), k2.eye.XMV(), k3.eye.XMV(), u));
+		key.at.XMV(XMVectorCatmullRom(k0.at.XMV(), k1.at.XMV(), k2.at.XMV(), k3.at.XMV(), u));
+		return key;
+	}
+
+
+	CameraPath SponzaBenchmarkPath()
+	{
+		CameraPath path;
+		path.AddKey(Vector3f(-14.5f, 18, -3), Vector3f(-13.6f, 17.55f, -2.8f));
+		path.AddKey(Vector3f(-10, 4, -1), Vector3f(0, 4, -1));
+		path.AddKey(Vector3f(0, 5, -1), Vector3f(10, 5, -0.5f));
+		path.AddKey(Vector3f(10, 5, 0), Vector3f(14, 8, 3));
+		path.AddKey(Vector3f(12, 12, 3), Vector3f(0, 12, 0));
+		path.AddKey(Vector3f(-12, 2, 4), Vector3f(-12, 2, -4));
+		return path;
+	}
+
+}
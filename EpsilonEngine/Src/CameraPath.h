@@ -0,0 +1,38 @@
+#pragma once
+#include "Utils.h"
+#include <vector>
+
+
+namespace epsilon
+{
+
+	struct CameraKey
+	{
+		Vector3f eye;
+		Vector3f at;
+	};
+
+
+	//Catmull-Rom spline through camera keys, evenly spaced in time
+	class CameraPath
+	{
+	public:
+		void AddKey(const Vector3f& eye, const Vector3f& at);
+
+		//One key per line: eye.x eye.y eye.z at.x at.y at.z
+		void Load(const std::string& file_path);
+
+		size_t NumKeys() const;
+
+		//t in [0, 1] over the whole path
+		CameraKey Evaluate(float t) const;
+
+	private:
+		std::vector<CameraKey> keys_;
+	};
+
+
+	//A walk through the Sponza atrium, what benchmarks fly when no path file is given
+	CameraPath SponzaBenchmarkPath();
+
+}
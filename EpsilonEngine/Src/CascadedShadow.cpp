@@ -0,0 +1,237 @@
+#include "CascadedShadow.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace epsilon
+{
+	float Dot3(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	//Half size of a box with the given extents along a unit axis
+	float ProjectedExtent(const float axis[3], const float extents[3])
+	{
+		return std::abs(axis[0]) * extents[0] + std::abs(axis[1]) * extents[1] + std::abs(axis[2]) * extents[2];
+	}
+
+
+	void CascadeSplits(float near_plane, float far_plane, uint32_t num_cascades, float lambda, float* splits)
+	{
+		splits[0] = near_plane;
+		for (uint32_t i = 1; i < num_cascades; i++)
+		{
+			float t = static_cast<float>(i) / num_cascades;
+			float log_split = near_plane * std::pow(far_plane / near_plane, t);
+			float uniform_split = near_plane + (far_plane - near_plane) * t;
+			splits[i] = lambda * log_split + (1 - lambda) * uniform_split;
+		}
+		splits[num_cascades] = far_plane;
+	}
+
+	void FrustumSliceSphere(float near_dist, float far_dist, float tan_half_fov, float aspect,
+		float& center_dist, float& radius)
+	{
+		//Squared distance from the axis to a corner, per unit of depth
+		float k2 = tan_half_fov * tan_half_fov * (1 + aspect * aspect);
+
+		//Equally far from the corners of both ends, or at the far end when the slice is too wide for that
+		center_dist = 0.5f * (near_dist + far_dist) * (1 + k2);
+		if (center_dist >= far_dist)
+		{
+			center_dist = far_dist;
+			radius = far_dist * std::sqrt(k2);
+		}
+		else
+		{
+			float d = far_dist - center_dist;
+			radius = std::sqrt(d * d + far_dist * far_dist * k2);
+		}
+	}
+
+	void ShadowLightAxes(const float dir[3], float axes[3][3])
+	{
+		float len = std::sqrt(Dot3(dir, dir));
+		float* z = axes[2];
+		for (int i = 0; i != 3; i++)
+		{
+			z[i] = dir[i] / len;
+		}
+
+		float up[3] = { 0, 1, 0 };
+		if (std::abs(z[1]) > 0.99f)
+		{
+			up[0] = 1;
+			up[1] = 0;
+		}
+
+		//x = normalize(up cross z), y = z cross x
+		float* x = axes[0];
+		x[0] = up[1] * z[2] - up[2] * z[1];
+		x[1] = up[2] * z[0] - up[0] * z[2];
+		x[2] = up[0] * z[1] - up[1] * z[0];
+		float x_len = std::sqrt(Dot3(x, x));
+		for (int i = 0; i != 3; i++)
+		{
+			x[i] /= x_len;
+		}
+
+		float* y = axes[1];
+		y[0] = z[1] * x[2] - z[2] * x[1];
+		y[1] = z[2] * x[0] - z[0] * x[2];
+		y[2] = z[0] * x[1] - z[1] * x[0];
+	}
+
+	void FitCascade(const float axes[3][3], const float center[3], float radius, float guard, uint32_t resolution,
+		const float* scene_center, const float* scene_extents, ShadowCascade& cascade)
+	{
+		for (int i = 0; i != 3; i++)
+		{
+			for (int j = 0; j != 3; j++)
+			{
+				cascade.axes[i][j] = axes[i][j];
+			}
+		}
+
+		float half_size = radius + guard;
+		float texel = 2 * half_size / resolution;
+		for (int i = 0; i != 2; i++)
+		{
+			float c = std::floor(Dot3(center, axes[i]) / texel) * texel;
+			cascade.min[i] = c - half_size;
+			cascade.max[i] = c + half_size;
+		}
+
+		if (scene_center && scene_extents)
+		{
+			float c = Dot3(scene_center, axes[2]);
+			float e = ProjectedExtent(axes[2], scene_extents);
+			cascade.min[2] = c - e;
+			cascade.max[2] = c + e;
+		}
+		else
+		{
+			float c = std::floor(Dot3(center, axes[2]) / texel) * texel;
+			cascade.min[2] = c - half_size;
+			cascade.max[2] = c + half_size;
+		}
+
+		//A flat scene still needs a depth range to divide by
+		if (cascade.max[2] - cascade.min[2] < texel)
+		{
+			cascade.max[2] = cascade.min[2] + texel;
+		}
+	}
+
+	void CascadeViewProj(const ShadowCascade& cascade, float m[16])
+	{
+		float scale[3];
+		float offset[3];
+		for (int j = 0; j != 2; j++)
+		{
+			scale[j] = 2 / (cascade.max[j] - cascade.min[j]);
+			offset[j] = -(cascade.max[j] + cascade.min[j]) / (cascade.max[j] - cascade.min[j]);
+		}
+		scale[2] = 1 / (cascade.max[2] - cascade.min[2]);
+		offset[2] = -cascade.min[2] * scale[2];
+
+		//Row i takes world component i, column j makes clip component j
+		for (int i = 0; i != 3; i++)
+		{
+			for (int j = 0; j != 3; j++)
+			{
+				m[i * 4 + j] = cascade.axes[j][i] * scale[j];
+			}
+			m[i * 4 + 3] = 0;
+		}
+		for (int j = 0; j != 3; j++)
+		{
+			m[12 + j] = offset[j];
+		}
+		m[15] = 1;
+	}
+
+	void CascadeScaleOffset(const ShadowCascade& cascade, const ShadowPage& page, uint32_t atlas_size,
+		float scale[3], float offset[3])
+	{
+		float so[4];
+		ShadowPageScaleOffset(page, atlas_size, so);
+
+		//Light space to clip space, then clip space to the page
+		for (int j = 0; j != 2; j++)
+		{
+			float clip_scale = 2 / (cascade.max[j] - cascade.min[j]);
+			float clip_offset = -(cascade.max[j] + cascade.min[j]) / (cascade.max[j] - cascade.min[j]);
+			scale[j] = clip_scale * so[j];
+			offset[j] = clip_offset * so[j] + so[j + 2];
+		}
+		scale[2] = 1 / (cascade.max[2] - cascade.min[2]);
+		offset[2] = -cascade.min[2] * scale[2];
+	}
+
+	bool CascadeIntersectsBox(const ShadowCascade& cascade, const float center[3], const float extents[3])
+	{
+		for (int i = 0; i != 3; i++)
+		{
+			float c = Dot3(center, cascade.axes[i]);
+			float e = ProjectedExtent(cascade.axes[i], extents);
+			if ((c + e < cascade.min[i]) || (c - e > cascade.max[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool CascadeCovers(const ShadowCascade& cascade, const float axes[3][3], const float center[3], float radius,
+		const float* scene_center, const float* scene_extents)
+	{
+		for (int i = 0; i != 3; i++)
+		{
+			for (int j = 0; j != 3; j++)
+			{
+				if (cascade.axes[i][j] != axes[i][j])
+				{
+					return false;
+				}
+			}
+		}
+
+		//In z the casters matter rather than the slice, when there are bounds to find them by
+		float lo[3];
+		float hi[3];
+		for (int i = 0; i != 3; i++)
+		{
+			float c = Dot3(center, axes[i]);
+			lo[i] = c - radius;
+			hi[i] = c + radius;
+		}
+		if (scene_center && scene_extents)
+		{
+			float c = Dot3(scene_center, axes[2]);
+			float e = ProjectedExtent(axes[2], scene_extents);
+			lo[2] = c - e;
+			hi[2] = c + e;
+		}
+
+		for (int i = 0; i != 3; i++)
+		{
+			if ((lo[i] < cascade.min[i]) || (hi[i] > cascade.max[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool CascadeScheduled(uint32_t cascade, uint32_t num_cascades, uint64_t frame)
+	{
+		if ((0 == cascade) || (num_cascades <= 2))
+		{
+			return true;
+		}
+		return frame % (num_cascades - 1) == cascade - 1;
+	}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include "ShadowAtlas.h"
+
+
+namespace epsilon
+{
+
+	//Orthographic projection of one cascade of a directional light: an axis-aligned box in the
+	//light's space, whose axes are world-space x, y and z (the direction the light travels)
+	struct ShadowCascade
+	{
+		float axes[3][3];
+		float min[3];
+		float max[3];
+	};
+
+
+	//Distances along the view axis that cut [near_plane, far_plane] into num_cascades slices, splits[0] is
+	//the near plane and splits[num_cascades] the far one. lambda blends the logarithmic scheme (1)
+	//with the uniform one (0)
+	void CascadeSplits(float near_plane, float far_plane, uint32_t num_cascades, float lambda, float* splits);
+
+	//Smallest sphere around the slice of a view frustum between two distances, its center is center_dist
+	//along the view axis. The sphere doesn't turn with the camera, so a cascade fitted to it keeps its size
+	void FrustumSliceSphere(float near_dist, float far_dist, float tan_half_fov, float aspect,
+		float& center_dist, float& radius);
+
+	//Light space of a directional light traveling along dir, oriented like a LookTo view
+	void ShadowLightAxes(const float dir[3], float axes[3][3]);
+
+	//Fits a cascade around a world-space sphere. In xy the box is the sphere's square grown by guard on
+	//each side, moved in whole texels of a resolution-sized page so the map doesn't shimmer as the camera
+	//moves. In z it spans the scene bounds, so every caster between the light and the slice is kept and the
+	//range stays put. Without scene bounds (null) it spans the grown sphere
+	void FitCascade(const float axes[3][3], const float center[3], float radius, float guard, uint32_t resolution,
+		const float* scene_center, const float* scene_extents, ShadowCascade& cascade);
+
+	//World to clip matrix of the cascade, row-major for row vectors as XMFLOAT4X4 holds it
+	void CascadeViewProj(const ShadowCascade& cascade, float m[16]);
+
+	//Scale and offset taking light-space xyz to the page's atlas uv and depth
+	void CascadeScaleOffset(const ShadowCascade& cascade, const ShadowPage& page, uint32_t atlas_size,
+		float scale[3], float offset[3]);
+
+	//Whether a world-space box, given as center and extents, can cast a shadow into the cascade
+	bool CascadeIntersectsBox(const ShadowCascade& cascade, const float center[3], const float extents[3]);
+
+	//Whether the map of a cascade, fitted with a guard band, still holds the sphere of a slice that moved
+	//since, and every caster depth of the scene bounds
+	bool CascadeCovers(const ShadowCascade& cascade, const float axes[3][3], const float center[3], float radius,
+		const float* scene_center, const float* scene_extents);
+
+	//With staggered updates the first cascade is refitted every frame and the others take turns
+	//on the remaining ones, so at most two cascades render per frame
+	bool CascadeScheduled(uint32_t cascade, uint32_t num_cascades, uint64_t frame);
+
+}
@@ -0,0 +1,435 @@
+#include "CommandList.h"
+#include "RenderEngine.h"
+#include "ConstantBufferRing.h"
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <d3d11_2.h>
+#include <d3dx11effect.h>
+#include <assert.h>
+#include <cstring>
+
+
+namespace epsilon
+{
+
+	const uint32_t CB_RING_SIZE = 1024 * 1024;
+
+	const char* CONSTANT_BUFFER_NAMES[CF_NumFrequencies] =
+	{
+		"cb_per_frame",
+		"cb_per_light",
+		"cb_per_material",
+		"cb_per_object",
+		"cb_per_pass"
+	};
+
+	const StatCounter CONSTANT_BYTES_COUNTERS[CF_NumFrequencies] =
+	{
+		SC_FrameConstantBytes,
+		SC_LightConstantBytes,
+		SC_MaterialConstantBytes,
+		SC_ObjectConstantBytes,
+		SC_PassConstantBytes
+	};
+
+	//Effect variables of the material maps, in MaterialMap order
+	const char* MATERIAL_MAP_NAMES[MM_NumMaps] =
+	{
+		"g_albedo_tex",
+		"g_normal_tex",
+		"g_glossiness_tex",
+		"g_metalness_tex"
+	};
+
+
+	CommandList::CommandList()
+	{
+		deferred_ = false;
+		topology_ = PT_TriangleList;
+	}
+
+	CommandList::~CommandList()
+	{
+		this->Destory();
+	}
+
+	void CommandList::CreateImmediate(ID3D11DeviceContext* imm_ctx, ID3DX11Effect* effect)
+	{
+		deferred_ = false;
+
+		imm_ctx->AddRef();
+		d3d_ctx_ = MakeCOMPtr(imm_ctx);
+
+		effect->AddRef();
+		d3d_effect_ = MakeCOMPtr(effect);
+
+		this->CreateConstants();
+	}
+
+	void CommandList::CreateDeferred(ID3DX11Effect* effect)
+	{
+		deferred_ = true;
+
+		ID3D11DeviceContext* d3d_ctx = nullptr;
+		THROW_FAILED(re_->D3DDevice()->CreateDeferredContext(0, &d3d_ctx));
+		d3d_ctx_ = MakeCOMPtr(d3d_ctx);
+
+		ID3DX11Effect* d3d_effect = nullptr;
+		THROW_FAILED(effect->CloneEffect(D3DX11_EFFECT_CLONE_FORCE_NONSINGLE, &d3d_effect));
+		d3d_effect_ = MakeCOMPtr(d3d_effect);
+
+		this->CreateConstants();
+	}
+
+	void CommandList::CreateConstants()
+	{
+		ID3D11DeviceContext1* d3d_ctx_1 = nullptr;
+		if (SUCCEEDED(d3d_ctx_->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&d3d_ctx_1))))
+		{
+			d3d_ctx_1_ = MakeCOMPtr(d3d_ctx_1);
+		}
+
+		for (size_t m = 0; m != MM_NumMaps; m++)
+		{
+			d3d_material_maps_[m] = d3d_effect_->GetVariableByName(MATERIAL_MAP_NAMES[m])->AsShaderResource();
+		}
+
+		bool any_slot = false;
+		for (size_t i = 0; i != CF_NumFrequencies; i++)
+		{
+			ConstantBinding& binding = constants_[i];
+			binding.d3d_cb = nullptr;
+			binding.slot = -1;
+			binding.d3d_static_buffer = nullptr;
+			binding.first_constant = 0;
+			binding.generation = 0;
+			binding.uploaded = false;
+			binding.size = 0;
+
+			ID3DX11EffectConstantBuffer* d3d_cb = d3d_effect_->GetConstantBufferByName(CONSTANT_BUFFER_NAMES[i]);
+			if (d3d_cb->IsValid())
+			{
+				binding.d3d_cb = d3d_cb;
+
+				D3DX11_EFFECT_VARIABLE_DESC cb_desc;
+				if (SUCCEEDED(d3d_cb->GetDesc(&cb_desc)) && (cb_desc.Flags & D3DX11_EFFECT_VARIABLE_EXPLICIT_BIND_POINT))
+				{
+					binding.slot = (int)cb_desc.ExplicitBindPoint;
+					any_slot = true;
+				}
+			}
+		}
+
+		//Constants are sub-allocated from a ring when offset binding is available.
+		//Deferred contexts can only map without overwrite on drivers that allow it.
+		D3D11_FEATURE_DATA_D3D11_OPTIONS d3d11_options;
+		if (d3d_ctx_1_ && any_slot
+			&& SUCCEEDED(re_->D3DDevice()->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &d3d11_options, sizeof(d3d11_options)))
+			&& d3d11_options.ConstantBufferOffsetting
+			&& (!deferred_ || d3d11_options.MapNoOverwriteOnDynamicConstantBuffer))
+		{
+			cb_ring_ = std::make_shared<ConstantBufferRing>();
+			cb_ring_->SetRE(*re_);
+			cb_ring_->Create(CB_RING_SIZE);
+		}
+	}
+
+	void CommandList::Destory()
+	{
+		cb_ring_.reset();
+		d3d_cmd_list_.reset();
+		d3d_effect_.reset();
+		d3d_ctx_1_.reset();
+		d3d_ctx_.reset();
+	}
+
+	bool CommandList::Deferred() const
+	{
+		return deferred_;
+	}
+
+	ID3D11DeviceContext* CommandList::D3DContext()
+	{
+		return d3d_ctx_.get();
+	}
+
+	ID3DX11Effect* CommandList::D3DEffect()
+	{
+		return d3d_effect_.get();
+	}
+
+	ID3DX11EffectPass* CommandList::D3DPass(const char* tech_name, const char* pass_name)
+	{
+		return d3d_effect_->GetTechniqueByName(tech_name)->GetPassByName(pass_name);
+	}
+
+	void CommandList::Begin()
+	{
+		if (deferred_)
+		{
+			//The first map on a deferred context has to discard, and nothing is bound yet
+			if (cb_ring_)
+			{
+				cb_ring_->Reset();
+			}
+			for (auto& binding : constants_)
+			{
+				binding.uploaded = false;
+			}
+		}
+	}
+
+	void CommandList::End()
+	{
+		if (deferred_)
+		{
+			ID3D11CommandList* d3d_cmd_list = nullptr;
+			THROW_FAILED(d3d_ctx_->FinishCommandList(false, &d3d_cmd_list));
+			d3d_cmd_list_ = MakeCOMPtr(d3d_cmd_list);
+		}
+	}
+
+	void CommandList::Execute(ID3D11DeviceContext* imm_ctx)
+	{
+		if (deferred_ && d3d_cmd_list_)
+		{
+			imm_ctx->ExecuteCommandList(d3d_cmd_list_.get(), false);
+			d3d_cmd_list_.reset();
+		}
+	}
+
+	void CommandList::SetVertexBuffer(CommandHandle buffer, uint32_t stride)
+	{
+		ID3D11Buffer* d3d_buffer = static_cast<ID3D11Buffer*>(buffer);
+		UINT offset = 0;
+		d3d_ctx_->IASetVertexBuffers(0, 1, &d3d_buffer, &stride, &offset);
+
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void CommandList::SetIndexBuffer(CommandHandle buffer)
+	{
+		d3d_ctx_->IASetIndexBuffer(static_cast<ID3D11Buffer*>(buffer), DXGI_FORMAT_R32_UINT, 0);
+
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void CommandList::SetTopology(PrimitiveTopology topology)
+	{
+		topology_ = topology;
+		d3d_ctx_->IASetPrimitiveTopology((PT_TriangleStrip == topology)
+			? D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void CommandList::SetInputLayout(CommandHandle layout)
+	{
+		d3d_ctx_->IASetInputLayout(static_cast<ID3D11InputLayout*>(layout));
+
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void CommandList::SetTexture(uint32_t slot, CommandHandle view)
+	{
+		assert(slot < MM_NumMaps);
+
+		//The effect binds it on the next Apply
+		d3d_material_maps_[slot]->SetResource(static_cast<ID3D11ShaderResourceView*>(view));
+
+		RenderStatistics::Add(SC_TextureBinds);
+	}
+
+	void CommandList::SetConstants(ConstantFrequency freq, const void* data, uint32_t size)
+	{
+		assert(size <= MAX_CONSTANTS_SIZE);
+
+		ConstantBinding& binding = constants_[freq];
+		if (!binding.d3d_cb)
+		{
+			return;
+		}
+
+		bool in_ring = cb_ring_ && (binding.slot >= 0);
+		if (binding.uploaded && !binding.d3d_static_buffer && (binding.size == size)
+			&& (0 == memcmp(binding.data.data(), data, size))
+			&& (!in_ring || (binding.generation == cb_ring_->Generation())))
+		{
+			return;
+		}
+
+		memcpy(binding.data.data(), data, size);
+		binding.size = size;
+		binding.d3d_static_buffer = nullptr;
+
+		this->UploadConstants(freq);
+	}
+
+	void CommandList::SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+		const void* data, uint32_t size)
+	{
+		ID3D11Buffer* d3d_buffer = static_cast<ID3D11Buffer*>(buffer);
+
+		ConstantBinding& binding = constants_[freq];
+		if (!binding.d3d_cb)
+		{
+			return;
+		}
+
+		if (!cb_ring_ || (binding.slot < 0))
+		{
+			this->SetConstants(freq, data, size);
+			return;
+		}
+
+		if (binding.uploaded && (binding.d3d_static_buffer == d3d_buffer) && (binding.first_constant == first_constant))
+		{
+			return;
+		}
+
+		binding.d3d_static_buffer = d3d_buffer;
+		binding.first_constant = first_constant;
+		binding.size = size;
+		binding.uploaded = true;
+	}
+
+	void CommandList::UploadConstants(ConstantFrequency freq)
+	{
+		ConstantBinding& binding = constants_[freq];
+
+		if (cb_ring_ && (binding.slot >= 0))
+		{
+			binding.first_constant = cb_ring_->Upload(d3d_ctx_.get(), binding.data.data(), binding.size);
+			binding.generation = cb_ring_->Generation();
+		}
+		else
+		{
+			//The effect keeps its own copy and uploads it on the next Apply
+			binding.d3d_cb->SetRawValue(binding.data.data(), 0, binding.size);
+		}
+		binding.uploaded = true;
+
+		RenderStatistics::Add(CONSTANT_BYTES_COUNTERS[freq], binding.size);
+	}
+
+	void CommandList::ApplyPass(CommandHandle pass)
+	{
+		this->ApplyPass(static_cast<ID3DX11EffectPass*>(pass));
+	}
+
+	void CommandList::ApplyPass(ID3DX11EffectPass* pass)
+	{
+		pass->Apply(0, d3d_ctx_.get());
+
+		RenderStatistics::Add(SC_StateChanges);
+
+		this->BindConstants(false);
+	}
+
+	void CommandList::ApplyComputePass(ID3DX11EffectPass* pass)
+	{
+		pass->Apply(0, d3d_ctx_.get());
+
+		RenderStatistics::Add(SC_StateChanges);
+
+		this->BindConstants(true);
+	}
+
+	void CommandList::BindConstants(bool compute)
+	{
+		if (!cb_ring_)
+		{
+			return;
+		}
+
+		//A discard drops everything uploaded before it. Uploading again can discard once more,
+		//after which the fresh buffer has room for all of them
+		bool stale = true;
+		while (stale)
+		{
+			stale = false;
+			for (size_t i = 0; i != CF_NumFrequencies; i++)
+			{
+				ConstantBinding& binding = constants_[i];
+				if ((binding.slot >= 0) && binding.uploaded && !binding.d3d_static_buffer
+					&& (binding.generation != cb_ring_->Generation()))
+				{
+					this->UploadConstants(static_cast<ConstantFrequency>(i));
+					stale = true;
+				}
+			}
+		}
+
+		//Override the effect's own cbuffer bindings with the slices of the ring or of static buffers
+		ID3D11Buffer* d3d_null_cb = nullptr;
+		for (const auto& binding : constants_)
+		{
+			if ((binding.slot < 0) || !binding.uploaded)
+			{
+				continue;
+			}
+
+			ID3D11Buffer* d3d_cb = binding.d3d_static_buffer ? binding.d3d_static_buffer : cb_ring_->D3DBuffer();
+
+			UINT first_constant = binding.first_constant;
+			UINT num_constants = ConstantBufferRing::NumConstants(binding.size);
+
+			//Rebinding the same buffer with a new offset is ignored by some runtimes unless it is unbound first
+			if (compute)
+			{
+				d3d_ctx_1_->CSSetConstantBuffers(binding.slot, 1, &d3d_null_cb);
+				d3d_ctx_1_->CSSetConstantBuffers1(binding.slot, 1, &d3d_cb, &first_constant, &num_constants);
+
+				RenderStatistics::Add(SC_StateChanges, 2);
+			}
+			else
+			{
+				d3d_ctx_1_->VSSetConstantBuffers(binding.slot, 1, &d3d_null_cb);
+				d3d_ctx_1_->VSSetConstantBuffers1(binding.slot, 1, &d3d_cb, &first_constant, &num_constants);
+				d3d_ctx_1_->PSSetConstantBuffers(binding.slot, 1, &d3d_null_cb);
+				d3d_ctx_1_->PSSetConstantBuffers1(binding.slot, 1, &d3d_cb, &first_constant, &num_constants);
+
+				RenderStatistics::Add(SC_StateChanges, 4);
+			}
+		}
+	}
+
+	void CommandList::Draw(uint32_t num_vertices, uint32_t first_vertex)
+	{
+		d3d_ctx_->Draw(num_vertices, first_vertex);
+
+		RenderStatistics::Add(SC_Draws);
+		RenderStatistics::Add(SC_Triangles, (PT_TriangleStrip == topology_) ? num_vertices - 2 : num_vertices / 3);
+	}
+
+	void CommandList::DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex)
+	{
+		d3d_ctx_->DrawIndexed(num_indices, first_index, base_vertex);
+
+		RenderStatistics::Add(SC_Draws);
+		RenderStatistics::Add(SC_Triangles, (PT_TriangleStrip == topology_) ? num_indices - 2 : num_indices / 3);
+	}
+
+	void CommandList::FinishFrame(uint64_t fence)
+	{
+		if (cb_ring_)
+		{
+			cb_ring_->FinishFrame(fence);
+		}
+
+		//Once the frame's space is released it can be overwritten, so the next frame uploads afresh
+		for (auto& binding : constants_)
+		{
+			binding.uploaded = false;
+		}
+	}
+
+	void CommandList::ReleaseCompleted(uint64_t completed_fence)
+	{
+		if (cb_ring_)
+		{
+			cb_ring_->ReleaseCompleted(completed_fence);
+		}
+	}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <array>
+#include "Utils.h"
+#include "D3D11Predeclare.h"
+#include "RSPredeclare.h"
+#include "ShaderConstants.h"
+#include "CommandStream.h"
+#include "MaterialParser.h"
+
+
+namespace epsilon
+{
+
+	//The D3D11 backend of CommandStream. Replayed streams and the passes set up directly go to one context
+	class CommandList : public CommandBackend
+	{
+	public:
+		//Largest constants of one frequency, a directional light with all its shadow cascades
+		static const uint32_t MAX_CONSTANTS_SIZE = 512;
+
+	public:
+		CommandList();
+		virtual ~CommandList();
+
+		INTERFACE_SET_RE;
+
+		//Records straight into the immediate context
+		void CreateImmediate(ID3D11DeviceContext* imm_ctx, ID3DX11Effect* effect);
+
+		//Records into a deferred context with a private clone of the effect, so it can run on any thread
+		void CreateDeferred(ID3DX11Effect* effect);
+
+		void Destory();
+
+		bool Deferred() const;
+
+		ID3D11DeviceContext* D3DContext();
+
+		ID3DX11Effect* D3DEffect();
+
+		ID3DX11EffectPass* D3DPass(const char* tech_name, const char* pass_name);
+
+		void Begin();
+		void End();
+
+		//Plays the recorded commands on the immediate context, a no-op for immediate lists
+		void Execute(ID3D11DeviceContext* imm_ctx);
+
+		virtual void SetVertexBuffer(CommandHandle buffer, uint32_t stride) override;
+		virtual void SetIndexBuffer(CommandHandle buffer) override;
+		virtual void SetTopology(PrimitiveTopology topology) override;
+		virtual void SetInputLayout(CommandHandle layout) override;
+
+		//Binds a map of the material textures, slot is its MaterialMap
+		virtual void SetTexture(uint32_t slot, CommandHandle view) override;
+
+		//Uploads the constants of one frequency. They stay bound for every following pass until set again,
+		//setting the same values again uploads nothing
+		virtual void SetConstants(ConstantFrequency freq, const void* data, uint32_t size) override;
+
+		template <typename T>
+		void SetConstants(ConstantFrequency freq, const T& constants)
+		{
+			this->SetConstants(freq, &constants, sizeof(constants));
+		}
+
+		//Binds constants already in a buffer of the caller, an ID3D11Buffer, starting at a multiple of
+		//16 constants, without uploading anything. They stay bound like uploaded ones. Without offset
+		//binding the data is uploaded
+		virtual void SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+			const void* data, uint32_t size) override;
+
+		//Applies the ID3DX11EffectPass and binds the constants set so far over the effect's own cbuffers
+		virtual void ApplyPass(CommandHandle pass) override;
+		void ApplyPass(ID3DX11EffectPass* pass);
+
+		//Same for a pass with a compute shader, the constants go to the compute stage
+		void ApplyComputePass(ID3DX11EffectPass* pass);
+
+		virtual void Draw(uint32_t num_vertices, uint32_t first_vertex) override;
+		virtual void DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex) override;
+
+		//Fences the constants uploaded this frame on an immediate list, bindings don't carry over
+		void FinishFrame(uint64_t fence);
+
+		//Constant space of frames the GPU has finished is reused without a discard
+		void ReleaseCompleted(uint64_t completed_fence);
+
+	private:
+		void CreateConstants();
+
+		void UploadConstants(ConstantFrequency freq);
+
+		void BindConstants(bool compute);
+
+	private:
+		struct ConstantBinding
+		{
+			ID3DX11EffectConstantBuffer* d3d_cb;
+			int slot;
+
+			//The caller's buffer of static constants, null for the ring
+			ID3D11Buffer* d3d_static_buffer;
+
+			//Offset in the ring, valid while the ring's generation matches, or in the static buffer
+			uint32_t first_constant;
+			uint64_t generation;
+			bool uploaded;
+
+			uint32_t size;
+			std::array<uint8_t, MAX_CONSTANTS_SIZE> data;
+		};
+
+	private:
+		bool deferred_;
+
+		ID3D11DeviceContextPtr d3d_ctx_;
+		ID3D11DeviceContext1Ptr d3d_ctx_1_;
+		ID3D11CommandListPtr d3d_cmd_list_;
+
+		ID3DX11EffectPtr d3d_effect_;
+		std::array<ID3DX11EffectShaderResourceVariable*, MM_NumMaps> d3d_material_maps_;
+
+		PrimitiveTopology topology_;
+
+		ConstantBufferRingPtr cb_ring_;
+		std::array<ConstantBinding, CF_NumFrequencies> constants_;
+	};
+
+}
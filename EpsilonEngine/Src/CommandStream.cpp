@@ -0,0 +1,248 @@
+#include "CommandStream.h"
+#include <algorithm>
+#include <cstring>
+
+
+namespace epsilon
+{
+	const size_t INITIAL_STREAM_WORDS = 1024;
+
+	enum CommandOp
+	{
+		CO_SetVertexBuffer,
+		CO_SetIndexBuffer,
+		CO_SetTopology,
+		CO_SetInputLayout,
+		CO_SetTexture,
+		CO_SetConstants,
+		CO_SetStaticConstants,
+		CO_ApplyPass,
+		CO_Draw,
+		CO_DrawIndexed
+	};
+
+	//Every command starts with one word holding these, its payload follows padded to whole words
+	struct CommandHeader
+	{
+		uint32_t op;
+		uint32_t payload_size;
+	};
+
+	struct VertexBufferCommand
+	{
+		CommandHandle buffer;
+		uint32_t stride;
+	};
+
+	struct TextureCommand
+	{
+		CommandHandle view;
+		uint32_t slot;
+	};
+
+	//The constants themselves follow
+	struct ConstantsCommand
+	{
+		CommandHandle buffer;
+		uint32_t freq;
+		uint32_t first_constant;
+		uint32_t size;
+	};
+
+	struct DrawCommand
+	{
+		uint32_t num;
+		uint32_t first;
+		int32_t base_vertex;
+	};
+
+
+	template <typename T>
+	T ReadPayload(const uint8_t* payload)
+	{
+		T cmd;
+		memcpy(&cmd, payload, sizeof(cmd));
+		return cmd;
+	}
+
+
+	CommandStream::CommandStream()
+		: used_(0), num_commands_(0)
+	{
+	}
+
+	void CommandStream::Reset()
+	{
+		used_ = 0;
+		num_commands_ = 0;
+	}
+
+	bool CommandStream::Empty() const
+	{
+		return 0 == num_commands_;
+	}
+
+	size_t CommandStream::NumCommands() const
+	{
+		return num_commands_;
+	}
+
+	size_t CommandStream::SizeBytes() const
+	{
+		return used_ * sizeof(uint64_t);
+	}
+
+	uint8_t* CommandStream::Append(uint32_t op, uint32_t payload_size)
+	{
+		size_t num_words = 1 + (payload_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		if (used_ + num_words > words_.size())
+		{
+			words_.resize((std::max)((std::max)(words_.size() * 2, INITIAL_STREAM_WORDS), used_ + num_words));
+		}
+
+		CommandHeader header = { op, payload_size };
+		uint64_t* words = &words_[used_];
+		memcpy(words, &header, sizeof(header));
+
+		used_ += num_words;
+		++num_commands_;
+
+		return reinterpret_cast<uint8_t*>(words + 1);
+	}
+
+	void CommandStream::SetVertexBuffer(CommandHandle buffer, uint32_t stride)
+	{
+		VertexBufferCommand cmd = { buffer, stride };
+		memcpy(this->Append(CO_SetVertexBuffer, sizeof(cmd)), &cmd, sizeof(cmd));
+	}
+
+	void CommandStream::SetIndexBuffer(CommandHandle buffer)
+	{
+		memcpy(this->Append(CO_SetIndexBuffer, sizeof(buffer)), &buffer, sizeof(buffer));
+	}
+
+	void CommandStream::SetTopology(PrimitiveTopology topology)
+	{
+		uint32_t value = topology;
+		memcpy(this->Append(CO_SetTopology, sizeof(value)), &value, sizeof(value));
+	}
+
+	void CommandStream::SetInputLayout(CommandHandle layout)
+	{
+		memcpy(this->Append(CO_SetInputLayout, sizeof(layout)), &layout, sizeof(layout));
+	}
+
+	void CommandStream::SetTexture(uint32_t slot, CommandHandle view)
+	{
+		TextureCommand cmd = { view, slot };
+		memcpy(this->Append(CO_SetTexture, sizeof(cmd)), &cmd, sizeof(cmd));
+	}
+
+	void CommandStream::SetConstants(ConstantFrequency freq, const void* data, uint32_t size)
+	{
+		this->SetStaticConstants(freq, nullptr, 0, data, size);
+	}
+
+	void CommandStream::SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+		const void* data, uint32_t size)
+	{
+		ConstantsCommand cmd = { buffer, static_cast<uint32_t>(freq), first_constant, size };
+		uint8_t* payload = this->Append(buffer ? CO_SetStaticConstants : CO_SetConstants, sizeof(cmd) + size);
+		memcpy(payload, &cmd, sizeof(cmd));
+		memcpy(payload + sizeof(cmd), data, size);
+	}
+
+	void CommandStream::ApplyPass(CommandHandle pass)
+	{
+		memcpy(this->Append(CO_ApplyPass, sizeof(pass)), &pass, sizeof(pass));
+	}
+
+	void CommandStream::Draw(uint32_t num_vertices, uint32_t first_vertex)
+	{
+		DrawCommand cmd = { num_vertices, first_vertex, 0 };
+		memcpy(this->Append(CO_Draw, sizeof(cmd)), &cmd, sizeof(cmd));
+	}
+
+	void CommandStream::DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex)
+	{
+		DrawCommand cmd = { num_indices, first_index, base_vertex };
+		memcpy(this->Append(CO_DrawIndexed, sizeof(cmd)), &cmd, sizeof(cmd));
+	}
+
+	void CommandStream::Replay(CommandBackend& backend) const
+	{
+		for (size_t w = 0; w != used_;)
+		{
+			CommandHeader header;
+			memcpy(&header, &words_[w], sizeof(header));
+			const uint8_t* payload = reinterpret_cast<const uint8_t*>(&words_[w + 1]);
+
+			switch (header.op)
+			{
+			case CO_SetVertexBuffer:
+				{
+					VertexBufferCommand cmd = ReadPayload<VertexBufferCommand>(payload);
+					backend.SetVertexBuffer(cmd.buffer, cmd.stride);
+				}
+				break;
+
+			case CO_SetIndexBuffer:
+				backend.SetIndexBuffer(ReadPayload<CommandHandle>(payload));
+				break;
+
+			case CO_SetTopology:
+				backend.SetTopology(static_cast<PrimitiveTopology>(ReadPayload<uint32_t>(payload)));
+				break;
+
+			case CO_SetInputLayout:
+				backend.SetInputLayout(ReadPayload<CommandHandle>(payload));
+				break;
+
+			case CO_SetTexture:
+				{
+					TextureCommand cmd = ReadPayload<TextureCommand>(payload);
+					backend.SetTexture(cmd.slot, cmd.view);
+				}
+				break;
+
+			case CO_SetConstants:
+			case CO_SetStaticConstants:
+				{
+					ConstantsCommand cmd = ReadPayload<ConstantsCommand>(payload);
+					const uint8_t* data = payload + sizeof(cmd);
+					if (CO_SetConstants == header.op)
+					{
+						backend.SetConstants(static_cast<ConstantFrequency>(cmd.freq), data, cmd.size);
+					}
+					else
+					{
+						backend.SetStaticConstants(static_cast<ConstantFrequency>(cmd.freq), cmd.buffer, cmd.first_constant,
+							data, cmd.size);
+					}
+				}
+				break;
+
+			case CO_ApplyPass:
+				backend.ApplyPass(ReadPayload<CommandHandle>(payload));
+				break;
+
+			case CO_Draw:
+				{
+					DrawCommand cmd = ReadPayload<DrawCommand>(payload);
+					backend.Draw(cmd.num, cmd.first);
+				}
+				break;
+
+			case CO_DrawIndexed:
+				{
+					DrawCommand cmd = ReadPayload<DrawCommand>(payload);
+					backend.DrawIndexed(cmd.num, cmd.first, cmd.base_vertex);
+				}
+				break;
+			}
+
+			w += 1 + (header.payload_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		}
+	}
+
+}
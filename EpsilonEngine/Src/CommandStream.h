@@ -0,0 +1,102 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "ShaderConstants.h"
+
+
+namespace epsilon
+{
+
+	//A buffer, view, input layout or pass of whatever backend replays the stream
+	typedef void* CommandHandle;
+
+	enum PrimitiveTopology
+	{
+		PT_TriangleList,
+		PT_TriangleStrip
+	};
+
+
+	//What a CommandStream replays into. The D3D11 CommandList is one, tests log the calls instead
+	class CommandBackend
+	{
+	public:
+		virtual ~CommandBackend() {}
+
+		virtual void SetVertexBuffer(CommandHandle buffer, uint32_t stride) = 0;
+		virtual void SetIndexBuffer(CommandHandle buffer) = 0;
+		virtual void SetTopology(PrimitiveTopology topology) = 0;
+		virtual void SetInputLayout(CommandHandle layout) = 0;
+
+		//Slots are the backend's, for D3D11 a MaterialMap
+		virtual void SetTexture(uint32_t slot, CommandHandle view) = 0;
+
+		virtual void SetConstants(ConstantFrequency freq, const void* data, uint32_t size) = 0;
+		virtual void SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+			const void* data, uint32_t size) = 0;
+
+		virtual void ApplyPass(CommandHandle pass) = 0;
+
+		virtual void Draw(uint32_t num_vertices, uint32_t first_vertex) = 0;
+		virtual void DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex) = 0;
+	};
+
+
+	//Draw commands recorded without touching any graphics API, so any thread can record while another
+	//replays. Commands are packed one after another with their payloads copied in, and Reset keeps the
+	//memory, so a stream recorded every frame stops allocating once it has grown to the frame's size
+	class CommandStream
+	{
+	public:
+		CommandStream();
+
+		void Reset();
+
+		bool Empty() const;
+		size_t NumCommands() const;
+		size_t SizeBytes() const;
+
+		void SetVertexBuffer(CommandHandle buffer, uint32_t stride);
+		void SetIndexBuffer(CommandHandle buffer);
+		void SetTopology(PrimitiveTopology topology);
+		void SetInputLayout(CommandHandle layout);
+		void SetTexture(uint32_t slot, CommandHandle view);
+
+		void SetConstants(ConstantFrequency freq, const void* data, uint32_t size);
+
+		template <typename T>
+		void SetConstants(ConstantFrequency freq, const T& constants)
+		{
+			this->SetConstants(freq, &constants, sizeof(constants));
+		}
+
+		void SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+			const void* data, uint32_t size);
+
+		template <typename T>
+		void SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant, const T& constants)
+		{
+			this->SetStaticConstants(freq, buffer, first_constant, &constants, sizeof(constants));
+		}
+
+		void ApplyPass(CommandHandle pass);
+
+		void Draw(uint32_t num_vertices, uint32_t first_vertex);
+		void DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex);
+
+		//Calls the backend once per command, in recording order
+		void Replay(CommandBackend& backend) const;
+
+	private:
+		//Appends a command, returning where its payload of payload_size bytes goes
+		uint8_t* Append(uint32_t op, uint32_t payload_size);
+
+	private:
+		//Words keep every command 8-byte aligned. Only the first used_ are recorded, the rest is capacity
+		std::vector<uint64_t> words_;
+		size_t used_;
+		size_t num_commands_;
+	};
+
+}
@@ -0,0 +1,112 @@
+#include "ConstantBufferRing.h"
+#include "RenderEngine.h"
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <d3d11_2.h>
+#include <cstring>
+#include "RenderStatistics.h"
+#include "MemoryTracker.h"
+
+
+namespace epsilon
+{
+
+	//Constant buffer offsets must be multiples of 16 constants
+	const uint32_t CB_ALIGNMENT = 256;
+
+
+	ConstantBufferRing::ConstantBufferRing()
+	{
+		discard_ = true;
+		generation_ = 0;
+	}
+
+	ConstantBufferRing::~ConstantBufferRing()
+	{
+		this->Destory();
+	}
+
+	void ConstantBufferRing::Create(uint32_t size)
+	{
+		uint32_t buffer_size = (size + CB_ALIGNMENT - 1) & ~(CB_ALIGNMENT - 1);
+		allocator_.Reset(buffer_size);
+		discard_ = true;
+
+		D3D11_BUFFER_DESC buffer_desc;
+		buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+		buffer_desc.ByteWidth = buffer_size;
+		buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		buffer_desc.MiscFlags = 0;
+		buffer_desc.StructureByteStride = 0;
+
+		ID3D11Buffer* d3d_buffer = nullptr;
+		THROW_FAILED(re_->D3DDevice()->CreateBuffer(&buffer_desc, nullptr, &d3d_buffer));
+		d3d_buffer_ = MakeTrackedCOMPtr(d3d_buffer, MC_ConstantBuffer, buffer_size);
+	}
+
+	void ConstantBufferRing::Destory()
+	{
+		d3d_buffer_.reset();
+		allocator_.Reset(0);
+		discard_ = true;
+	}
+
+	void ConstantBufferRing::Reset()
+	{
+		discard_ = true;
+	}
+
+	uint32_t ConstantBufferRing::Upload(ID3D11DeviceContext* ctx, const void* data, uint32_t size)
+	{
+		uint32_t aligned_size = NumConstants(size) * 16;
+
+		D3D11_MAP map_type = D3D11_MAP_WRITE_NO_OVERWRITE;
+		uint64_t offset = discard_ ? RingAllocator::INVALID_OFFSET : allocator_.Allocate(aligned_size, CB_ALIGNMENT);
+		if (RingAllocator::INVALID_OFFSET == offset)
+		{
+			//Everything free is still read by frames in flight. Discard renames the buffer, the GPU keeps
+			//the old contents and the ring starts over on the new one
+			map_type = D3D11_MAP_WRITE_DISCARD;
+			allocator_.Reset();
+			offset = allocator_.Allocate(aligned_size, CB_ALIGNMENT);
+			discard_ = false;
+			++generation_;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		THROW_FAILED(ctx->Map(d3d_buffer_.get(), 0, map_type, 0, &mapped));
+		memcpy(static_cast<uint8_t*>(mapped.pData) + offset, data, size);
+		ctx->Unmap(d3d_buffer_.get(), 0);
+
+		RenderStatistics::Add(SC_BytesUploaded, size);
+
+		return static_cast<uint32_t>(offset / 16);
+	}
+
+	void ConstantBufferRing::FinishFrame(uint64_t fence)
+	{
+		allocator_.FinishFrame(fence);
+	}
+
+	void ConstantBufferRing::ReleaseCompleted(uint64_t completed_fence)
+	{
+		allocator_.ReleaseCompleted(completed_fence);
+	}
+
+	uint64_t ConstantBufferRing::Generation() const
+	{
+		return generation_;
+	}
+
+	ID3D11Buffer* ConstantBufferRing::D3DBuffer()
+	{
+		return d3d_buffer_.get();
+	}
+
+	uint32_t ConstantBufferRing::NumConstants(uint32_t size)
+	{
+		return ((size + CB_ALIGNMENT - 1) & ~(CB_ALIGNMENT - 1)) / 16;
+	}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Utils.h"
+#include "D3D11Predeclare.h"
+#include "RSPredeclare.h"
+#include "RingAllocator.h"
+
+
+namespace epsilon
+{
+
+	class ConstantBufferRing
+	{
+	public:
+		ConstantBufferRing();
+		virtual ~ConstantBufferRing();
+
+		INTERFACE_SET_RE;
+
+		void Create(uint32_t size);
+
+		void Destory();
+
+		//Makes the next upload discard the buffer
+		void Reset();
+
+		//Returns the offset of the uploaded data in 16-byte constants
+		uint32_t Upload(ID3D11DeviceContext* ctx, const void* data, uint32_t size);
+
+		//Space uploaded since the previous call belongs to the frame with this fence
+		void FinishFrame(uint64_t fence);
+
+		//Space of frames the GPU has finished can be overwritten without a discard
+		void ReleaseCompleted(uint64_t completed_fence);
+
+		//Changes on every discard, offsets returned before it no longer hold their data
+		uint64_t Generation() const;
+
+		ID3D11Buffer* D3DBuffer();
+
+		static uint32_t NumConstants(uint32_t size);
+
+	private:
+		ID3D11BufferPtr d3d_buffer_;
+
+		RingAllocator allocator_;
+		bool discard_;
+		uint64_t generation_;
+	};
+
+}
@@ -17,6 +17,7 @@ struct ID3D11Device2;
 struct ID3D11DeviceContext;
 struct ID3D11DeviceContext1;
 struct ID3D11DeviceContext2;
+struct ID3D11CommandList;
 struct ID3D11Resource;
 struct ID3D11Texture1D;
 struct ID3D11Texture2D;
@@ -44,6 +45,8 @@ struct ID3D11SamplerState;
 struct ID3D11ShaderResourceView;
 struct ID3DX11Effect;
 struct ID3DX11EffectPass;
+struct ID3DX11EffectConstantBuffer;
+struct ID3DX11EffectShaderResourceVariable;
 
 
 namespace epsilon
@@ -63,6 +66,7 @@ namespace epsilon
 	typedef std::shared_ptr<ID3D11DeviceContext>		ID3D11DeviceContextPtr;
 	typedef std::shared_ptr<ID3D11DeviceContext1>		ID3D11DeviceContext1Ptr;
 	typedef std::shared_ptr<ID3D11DeviceContext2>		ID3D11DeviceContext2Ptr;
+	typedef std::shared_ptr<ID3D11CommandList>			ID3D11CommandListPtr;
 	typedef std::shared_ptr<ID3D11Resource>				ID3D11ResourcePtr;
 	typedef std::shared_ptr<ID3D11Texture1D>			ID3D11Texture1DPtr;
 	typedef std::shared_ptr<ID3D11Texture2D>			ID3D11Texture2DPtr;
@@ -0,0 +1,86 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace epsilon
+{
+	//Errors within this fraction of the target count as on target, so the scale settles
+	//instead of chasing frame time noise
+	const double ERROR_DEADBAND = 0.05;
+
+	//Scales snap to this step, small corrections don't change the render size every frame
+	const double SCALE_STEP = 1.0 / 64;
+
+
+	DynamicResolution::DynamicResolution()
+		: target_ms_(1000.0 / 60), kp_(0.15), ki_(0.05), kd_(0.05), min_scale_(0.5f), max_scale_(1.0f)
+	{
+		this->Reset();
+	}
+
+	void DynamicResolution::TargetFrameTime(double ms)
+	{
+		target_ms_ = (std::max)(ms, 0.1);
+	}
+
+	double DynamicResolution::TargetFrameTime() const
+	{
+		return target_ms_;
+	}
+
+	void DynamicResolution::Gains(double kp, double ki, double kd)
+	{
+		kp_ = kp;
+		ki_ = ki;
+		kd_ = kd;
+	}
+
+	void DynamicResolution::ScaleRange(float min_scale, float max_scale)
+	{
+		min_scale_ = (std::max)(min_scale, 0.1f);
+		max_scale_ = (std::max)(max_scale, min_scale_);
+		scale_ = (std::min)((std::max)(scale_, min_scale_), max_scale_);
+	}
+
+	float DynamicResolution::Update(double gpu_ms)
+	{
+		//Positive error is headroom, relative so the gains don't depend on the target
+		double error = (target_ms_ - gpu_ms) / target_ms_;
+		if (std::abs(error) < ERROR_DEADBAND)
+		{
+			error = 0;
+		}
+
+		double derivative = has_prev_ ? error - prev_error_ : 0;
+		prev_error_ = error;
+		has_prev_ = true;
+
+		//The integral only ever needs to pull the scale down from max_scale to min_scale. Bounding it
+		//to that keeps it from winding up under a long overload, and from stopping short of max_scale
+		//once the headroom is back
+		double min_integral = ki_ > 0 ? (min_scale_ - max_scale_) / ki_ : 0;
+		integral_ = (std::min)((std::max)(integral_ + error, min_integral), 0.0);
+		double output = max_scale_ + kp_ * error + ki_ * integral_ + kd_ * derivative;
+
+		output = std::floor(output / SCALE_STEP + 0.5) * SCALE_STEP;
+		scale_ = static_cast<float>((std::min)((std::max)(output, static_cast<double>(min_scale_)),
+			static_cast<double>(max_scale_)));
+
+		return scale_;
+	}
+
+	float DynamicResolution::Scale() const
+	{
+		return scale_;
+	}
+
+	void DynamicResolution::Reset()
+	{
+		integral_ = 0;
+		prev_error_ = 0;
+		has_prev_ = false;
+		scale_ = max_scale_;
+	}
+
+}
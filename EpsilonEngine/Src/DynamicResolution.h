@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+
+namespace epsilon
+{
+
+	//PID controller trading render resolution for GPU time. The output only depends on the
+	//sequence of frame times fed in, so a recorded trace always replays to the same scales
+	class DynamicResolution
+	{
+	public:
+		DynamicResolution();
+
+		//GPU time per frame the controller steers towards
+		void TargetFrameTime(double ms);
+		double TargetFrameTime() const;
+
+		void Gains(double kp, double ki, double kd);
+
+		//Scale applies to both axes, so 0.5 renders a quarter of the pixels
+		void ScaleRange(float min_scale, float max_scale);
+
+		//Feeds one measured GPU frame time and returns the scale for the next frame
+		float Update(double gpu_ms);
+
+		float Scale() const;
+
+		//Back to max_scale with no history
+		void Reset();
+
+	private:
+		double target_ms_;
+		double kp_;
+		double ki_;
+		double kd_;
+		float min_scale_;
+		float max_scale_;
+
+		double integral_;
+		double prev_error_;
+		bool has_prev_;
+		float scale_;
+	};
+
+}
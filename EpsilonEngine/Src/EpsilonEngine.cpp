@@ -9,8 +9,12 @@
 #include <assimp\postprocess.h>
 #include <assimp\scene.h>
 #include "Renderable.h"
+#include "Material.h"
 #include "Camera.h"
 #include "Light.h"
+#include "Benchmark.h"
+#include "MemoryTracker.h"
+#include <sstream>
 
 
 using namespace epsilon;
@@ -79,7 +83,7 @@ void GenerateCube(StaticMeshPtr r)
 }
 
 
-void LoadAssimpStaticMesh(RenderEngine& re, std::string file_path, float scale = 1, bool inverse_z = false, bool swap_yz = false)
+TransformHandle LoadAssimpStaticMesh(RenderEngine& re, std::string file_path, float scale = 1, bool inverse_z = false, bool swap_yz = false)
 {
 	aiPropertyStore* props = aiCreatePropertyStore();
 	aiSetImportPropertyInteger(props, AI_CONFIG_IMPORT_TER_MAKE_UVS, 1);
@@ -104,118 +108,285 @@ void LoadAssimpStaticMesh(RenderEngine& re, std::string file_path, float scale =
 	{
 		printf("%s\n", aiGetErrorString());
 		getchar();
-		return;
+		return INVALID_TRANSFORM;
 	}
 
+	TransformHandle root = re.Transforms().Create();
+
 	auto pp = _FSPFX path(file_path).parent_path();
 
-	for (unsigned int mi = 0; mi < scene->mNumMeshes; ++mi)
+	//Meshes share the scene's materials. An .obj's come straight from its .mtl, the same as the material
+	//benchmark reads, other formats' from Assimp
+	std::vector<MaterialDesc> mtl_descs;
+	std::string mtl_path = FindMTLLibrary(file_path);
+	if (!mtl_path.empty())
 	{
-		aiMesh const * mesh = scene->mMeshes[mi];
-
-		std::string tex_path;
-		Vector3f ka;
-		Vector3f kd;
-		Vector3f ks;
-		std::vector<Vector3f> pos_data;
-		std::vector<Vector3f> norm_data;
-		std::vector<Vector2f> tc_data;
-		std::vector<uint32_t> indice_data;
-		size_t num_vert = mesh->mNumVertices;
-
-		auto mtl = scene->mMaterials[mesh->mMaterialIndex];
-
-		unsigned int count = aiGetMaterialTextureCount(mtl, aiTextureType_DIFFUSE);
-		if (count > 0)
-		{
-			aiString str;
-			aiGetMaterialTexture(mtl, aiTextureType_DIFFUSE, 0, &str, 0, 0, 0, 0, 0, 0);
-			auto pp2 = pp;
-			pp2.append("/").append(str.C_Str());
-			tex_path = pp2.string();
-		}
+		LoadMTL(mtl_path, mtl_descs);
+	}
+
+	std::vector<MaterialDesc> descs(scene->mNumMaterials);
+	for (unsigned int i = 0; i < scene->mNumMaterials; ++i)
+	{
+		auto mtl = scene->mMaterials[i];
 
-		if (AI_SUCCESS != aiGetMaterialColor(mtl, "Ka", 0, 0, (aiColor4D*)&ka))
+		aiString name;
+		aiGetMaterialString(mtl, AI_MATKEY_NAME, &name);
+		int32_t mtl_index = FindMaterial(mtl_descs, name.C_Str());
+		if (mtl_index >= 0)
 		{
-			ka = Vector3f(0.2f, 0.2f, 0.2f);
+			descs[i] = mtl_descs[mtl_index];
+			continue;
 		}
-		if (AI_SUCCESS != aiGetMaterialColor(mtl, "Kd", 0, 0, (aiColor4D*)&kd))
+
+		MaterialDesc& desc = descs[i];
+		InitMaterialDesc(name.C_Str(), desc);
+
+		auto get_map = [mtl](aiTextureType type, std::string& map)
 		{
-			kd = Vector3f(0.5f, 0.5f, 0.5f);
-		}
-		if (AI_SUCCESS != aiGetMaterialColor(mtl, "Ks", 0, 0, (aiColor4D*)&ks))
+			aiString str;
+			if ((aiGetMaterialTextureCount(mtl, type) > 0)
+				&& (AI_SUCCESS == aiGetMaterialTexture(mtl, type, 0, &str, 0, 0, 0, 0, 0, 0)))
+			{
+				map = str.C_Str();
+			}
+		};
+		get_map(aiTextureType_DIFFUSE, desc.maps[MM_Albedo]);
+		get_map(aiTextureType_NORMALS, desc.maps[MM_Normal]);
+		if (desc.maps[MM_Normal].empty())
 		{
-			ks = Vector3f(0.7f, 0.7f, 0.7f);
+			//Where .obj and some other formats put normal maps
+			get_map(aiTextureType_HEIGHT, desc.maps[MM_Normal]);
 		}
+		get_map(aiTextureType_SPECULAR, desc.maps[MM_SpecGloss]);
 
-		for (unsigned int fi = 0; fi < mesh->mNumFaces; ++fi)
+		auto get_color = [mtl](const char* key, unsigned int type, unsigned int index, float clr[3])
 		{
-			if (3 == mesh->mFaces[fi].mNumIndices)
+			aiColor4D c;
+			if (AI_SUCCESS == aiGetMaterialColor(mtl, key, type, index, &c))
 			{
-				indice_data.push_back(mesh->mFaces[fi].mIndices[0]);
-				indice_data.push_back(mesh->mFaces[fi].mIndices[1]);
-				indice_data.push_back(mesh->mFaces[fi].mIndices[2]);
+				clr[0] = c.r;
+				clr[1] = c.g;
+				clr[2] = c.b;
 			}
-		}
+		};
+		get_color(AI_MATKEY_COLOR_AMBIENT, desc.ka);
+		get_color(AI_MATKEY_COLOR_DIFFUSE, desc.kd);
+		get_color(AI_MATKEY_COLOR_SPECULAR, desc.ks);
+		aiGetMaterialFloat(mtl, AI_MATKEY_SHININESS, &desc.ns);
+
+		ResolveMaterialMaps(desc, pp.string());
+		DerivePBRParameters(desc);
+	}
+
+	std::vector<MaterialDesc> unique_descs;
+	std::vector<uint32_t> remap;
+	DedupeMaterials(descs, unique_descs, remap);
 
-		pos_data.resize(num_vert);
-		norm_data.resize(num_vert);
-		tc_data.resize(num_vert);
-		for (unsigned int vi = 0; vi < mesh->mNumVertices; ++vi)
+	std::vector<MaterialPtr> materials;
+	CreateMaterials(re, unique_descs, materials);
+
+	//Meshes are independent, so conversion and buffer creation run on the job system
+	std::vector<StaticMeshPtr> meshes(scene->mNumMeshes);
+	re.Jobs().ParallelFor(scene->mNumMeshes, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t mi = begin; mi != end; mi++)
 		{
-			pos_data[vi] = Vector3f(&mesh->mVertices[vi].x);
-			pos_data[vi] = pos_data[vi] * scale;
-			
-			if (inverse_z)
+			aiMesh const * mesh = scene->mMeshes[mi];
+
+			std::vector<Vector3f> pos_data;
+			std::vector<Vector3f> norm_data;
+			std::vector<Vector2f> tc_data;
+			std::vector<uint32_t> indice_data;
+			size_t num_vert = mesh->mNumVertices;
+
+			for (unsigned int fi = 0; fi < mesh->mNumFaces; ++fi)
 			{
-				pos_data[vi].z *= -1;
+				if (3 == mesh->mFaces[fi].mNumIndices)
+				{
+					indice_data.push_back(mesh->mFaces[fi].mIndices[0]);
+					indice_data.push_back(mesh->mFaces[fi].mIndices[1]);
+					indice_data.push_back(mesh->mFaces[fi].mIndices[2]);
+				}
 			}
+
+			pos_data.resize(num_vert);
+			norm_data.resize(num_vert);
+			tc_data.resize(num_vert);
+
+			//Scale, mirror and axis swap folded into one matrix, applied to the whole mesh at once
+			Matrix axis_mat;
+			axis_mat = XMMatrixScaling(1, 1, inverse_z ? -1.0f : 1.0f);
 			if (swap_yz)
 			{
-				std::swap(pos_data[vi].y, pos_data[vi].z);
+				axis_mat = axis_mat * Matrix(1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1);
 			}
+			Matrix pos_mat;
+			pos_mat = XMMatrixScaling(scale, scale, scale) * axis_mat;
 
+			TransformCoords(reinterpret_cast<const Vector3f*>(mesh->mVertices), pos_data.data(), num_vert, pos_mat);
 			if (mesh->mNormals)
 			{
-				norm_data[vi] = Vector3f(&mesh->mNormals[vi].x);
-
-				if (inverse_z)
-				{
-					norm_data[vi].z *= -1;
-				}
-				if (swap_yz)
-				{
-					std::swap(norm_data[vi].y, norm_data[vi].z);
-				}
+				TransformNormals(reinterpret_cast<const Vector3f*>(mesh->mNormals), norm_data.data(), num_vert, axis_mat);
 			}
 
 			if (mesh->mTextureCoords && mesh->mTextureCoords[0])
 			{
-				tc_data[vi] = Vector2f(&mesh->mTextureCoords[0][vi].x);
+				for (unsigned int vi = 0; vi < mesh->mNumVertices; ++vi)
+				{
+					tc_data[vi] = Vector2f(&mesh->mTextureCoords[0][vi].x);
+				}
 			}
+
+			StaticMeshPtr r = std::make_shared<StaticMesh>();
+			r->SetRE(re);
+			r->CreateVertexBuffer(num_vert, pos_data.data(), norm_data.data(), tc_data.data());
+			r->CreateIndexBuffer(indice_data.size(), indice_data.data());
+			r->SetMaterial(materials[remap[mesh->mMaterialIndex]]);
+			meshes[mi] = r;
 		}
+	});
 
-		StaticMeshPtr r = std::make_shared<StaticMesh>();
-		r->SetRE(re);
-		r->CreateVertexBuffer(num_vert, pos_data.data(), norm_data.data(), tc_data.data());
-		r->CreateIndexBuffer(indice_data.size(), indice_data.data());
-		r->CreateMaterial(tex_path, ka, kd, ks);
+	for (auto& r : meshes)
+	{
+		r->SetTransform(re.Transforms().Create(root));
 		re.AddRenderable(r);
 	}
+
+	return root;
 }
 
 
-int main()
+int main(int argc, char* argv[])
 {
 	try
 	{
 		int width = 1280;
 		int height = 720;
 
+		//-benchmark [-frames N] [-path camera_path.txt] [-out result.json] [-stats] [-stats_csv stats.csv] [-drs ms]
+		//-sun adds a direction light with cascaded shadows, -stagger_cascades updates them in turns
+		//-point_lights N adds N point lights along the nave, -ssao off|low|medium|high picks the occlusion preset
+		//-taa turns on temporal anti-aliasing, -bloom bloom, -vignette S darkens the corners by S, -grading color grading
+		//-cs_lighting shades the lights in the tiled compute shader, -env cubemap.dds lights the ambient pass with
+		//an environment map instead of the built-in sky
+		bool benchmark = false;
+		bool show_stats = false;
+		double drs_target_ms = 0;
+		bool sun = false;
+		bool stagger_cascades = false;
+		uint32_t num_point_lights = 0;
+		SSAOQuality ssao = SQ_Medium;
+		bool taa = false;
+		bool compute_lighting = false;
+		std::string env_map;
+		PostSettings post = DefaultPostSettings();
+		std::string stats_csv;
+		uint32_t benchmark_frames = 1000;
+		std::string benchmark_path;
+		std::string benchmark_out = "benchmark.json";
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if ("-benchmark" == arg)
+			{
+				benchmark = true;
+			}
+			else if (("-frames" == arg) && (i + 1 < argc))
+			{
+				benchmark_frames = static_cast<uint32_t>(atoi(argv[++i]));
+			}
+			else if (("-path" == arg) && (i + 1 < argc))
+			{
+				benchmark_path = argv[++i];
+			}
+			else if (("-out" == arg) && (i + 1 < argc))
+			{
+				benchmark_out = argv[++i];
+			}
+			else if ("-stats" == arg)
+			{
+				show_stats = true;
+			}
+			else if (("-stats_csv" == arg) && (i + 1 < argc))
+			{
+				stats_csv = argv[++i];
+			}
+			else if (("-drs" == arg) && (i + 1 < argc))
+			{
+				drs_target_ms = atof(argv[++i]);
+			}
+			else if ("-sun" == arg)
+			{
+				sun = true;
+			}
+			else if ("-stagger_cascades" == arg)
+			{
+				stagger_cascades = true;
+			}
+			else if (("-point_lights" == arg) && (i + 1 < argc))
+			{
+				num_point_lights = static_cast<uint32_t>(atoi(argv[++i]));
+			}
+			else if (("-ssao" == arg) && (i + 1 < argc))
+			{
+				std::string name = argv[++i];
+				for (int q = SQ_Off; q != SQ_NumQualities; q++)
+				{
+					if (SSAOQualityName(static_cast<SSAOQuality>(q)) == name)
+					{
+						ssao = static_cast<SSAOQuality>(q);
+					}
+				}
+			}
+			else if ("-taa" == arg)
+			{
+				taa = true;
+			}
+			else if ("-bloom" == arg)
+			{
+				post.bloom = true;
+			}
+			else if (("-vignette" == arg) && (i + 1 < argc))
+			{
+				post.vignette = static_cast<float>(atof(argv[++i]));
+			}
+			else if ("-grading" == arg)
+			{
+				post.color_grading = true;
+			}
+			else if ("-cs_lighting" == arg)
+			{
+				compute_lighting = true;
+			}
+			else if (("-env" == arg) && (i + 1 < argc))
+			{
+				env_map = argv[++i];
+			}
+		}
+
 		Application app;
 		app.Create("Test", width, height);
 
 		RenderEngine& re = app.RE();
+		re.ShowStatistics(show_stats);
+		if (!stats_csv.empty())
+		{
+			re.LogStatistics(stats_csv);
+		}
+		if (drs_target_ms > 0)
+		{
+			re.ResolutionController().TargetFrameTime(drs_target_ms);
+			re.SetDynamicResolution(true);
+		}
+		re.SetCascadeStaggering(stagger_cascades);
+		re.SetAmbientOcclusion(ssao);
+		re.SetTemporalAA(taa);
+		re.SetPostProcessing(post);
+		re.SetComputeLighting(compute_lighting);
+		if (!env_map.empty())
+		{
+			re.SetEnvironmentMap(env_map);
+		}
 
 		CameraPtr cam = std::make_shared<Camera>();
 		Vector3f eye(-14.5f, 18, -3), at(-13.6f, 17.55f, -2.8f), up(0, 1, 0);
@@ -227,10 +398,13 @@ int main()
 		al->color_ = Vector3f(0.1f, 0.1f, 0.1f);
 		re.SetAmbientLight(al);
 
-		/*DirectionLightPtr dl = std::make_shared<DirectionLight>();
-		dl->color_ = Vector3f(0.85f, 0.85f, 0.85f);
-		dl->dir_ = Vector3f(cam->eye_pos_ - cam->look_at_);
-		re.AddDirectionLight(dl);*/
+		if (sun)
+		{
+			DirectionLightPtr dl = std::make_shared<DirectionLight>();
+			dl->color_ = Vector3f(0.85f, 0.85f, 0.85f);
+			dl->dir_ = Vector3f(0.3f, 1, 0.2f);
+			re.AddDirectionLight(dl);
+		}
 
 		SpotLightPtr sl = std::make_shared<SpotLight>();
 		sl->pos_ = Vector3f(0, 12, -4.8f);
@@ -242,8 +416,43 @@ int main()
 		sl->outter_ang_ = XM_PI / 6;
 		re.AddSpotLight(sl);
 
+		for (uint32_t i = 0; i < num_point_lights; i++)
+		{
+			float t = (i + 0.5f) / num_point_lights;
+			PointLightPtr pl = std::make_shared<PointLight>();
+			pl->pos_ = Vector3f(-25 + 50 * t, 2 + 4 * (i % 2), -2 + 4 * ((i / 2) % 2));
+			pl->color_ = Vector3f(0.5f + 0.5f * t, 0.7f, 1.5f - t);
+			pl->falloff_ = Vector3f(1, 0, 0.5f);
+			pl->range_ = 20;
+			re.AddPointLight(pl);
+		}
+
 		LoadAssimpStaticMesh(re, "../../../Media/Model/Sponza/sponza.obj");
 
+		std::unique_ptr<Benchmark> bench;
+		if (benchmark)
+		{
+			CameraPath path = SponzaBenchmarkPath();
+			if (!benchmark_path.empty())
+			{
+				path.Load(benchmark_path);
+			}
+
+			//Uncapped, so the numbers measure the engine rather than the display
+			re.SetPresentMode(RenderEngine::PM_Discard);
+
+			bench = std::make_unique<Benchmark>(re, cam, path, benchmark_frames);
+			app.OnFrame([&]()
+			{
+				if (!bench->Done() && !bench->Frame())
+				{
+					bench->WriteJson(benchmark_out);
+					re.WriteTrace(benchmark_out + ".trace.json");
+					app.Quit();
+				}
+			});
+		}
+
 		app.Run();
 	}
 	catch (const std::exception& e)
@@ -254,7 +463,14 @@ int main()
 	{
 		pe->what();
 	}
-	
+
+	//Only once the scene and the engine are both gone is anything still allocated a leak
+	std::ostringstream leaks;
+	if (MemoryTracker::ReportLeaks(leaks) > 0)
+	{
+		::OutputDebugStringA(leaks.str().c_str());
+	}
+
     return 0;
 }
 
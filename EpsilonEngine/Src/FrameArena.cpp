@@ -0,0 +1,96 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <mutex>
+
+
+namespace epsilon
+{
+
+	std::mutex thread_arenas_mutex_;
+	std::vector<std::unique_ptr<LinearArena>> thread_arenas_;
+	thread_local LinearArena* tls_arena_ = nullptr;
+
+
+	LinearArena::LinearArena(size_t block_size /*= 64 * 1024*/)
+		: block_size_(block_size), current_(0), offset_(0), used_(0)
+	{
+	}
+
+	void* LinearArena::Allocate(size_t size, size_t alignment /*= 16*/)
+	{
+		while (current_ < blocks_.size())
+		{
+			Block& block = blocks_[current_];
+			uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+			uintptr_t p = (base + offset_ + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+			if (p + size <= base + block.size)
+			{
+				offset_ = p + size - base;
+				used_ += size;
+				return reinterpret_cast<void*>(p);
+			}
+
+			++current_;
+			offset_ = 0;
+		}
+
+		Block block;
+		block.size = (std::max)(block_size_, size + alignment);
+		block.data.reset(new uint8_t[block.size]);
+		blocks_.push_back(std::move(block));
+
+		return this->Allocate(size, alignment);
+	}
+
+	void LinearArena::Reset()
+	{
+		if (blocks_.size() > 1)
+		{
+			//Next time everything fits in one block
+			block_size_ = this->Capacity();
+			blocks_.clear();
+		}
+
+		current_ = 0;
+		offset_ = 0;
+		used_ = 0;
+	}
+
+	size_t LinearArena::BytesUsed() const
+	{
+		return used_;
+	}
+
+	size_t LinearArena::Capacity() const
+	{
+		size_t capacity = 0;
+		for (const auto& block : blocks_)
+		{
+			capacity += block.size;
+		}
+		return capacity;
+	}
+
+	LinearArena& LinearArena::ThreadLocal()
+	{
+		if (!tls_arena_)
+		{
+			std::unique_ptr<LinearArena> arena(new LinearArena);
+
+			std::lock_guard<std::mutex> lock(thread_arenas_mutex_);
+			tls_arena_ = arena.get();
+			thread_arenas_.push_back(std::move(arena));
+		}
+		return *tls_arena_;
+	}
+
+	void LinearArena::ResetThreadLocals()
+	{
+		std::lock_guard<std::mutex> lock(thread_arenas_mutex_);
+		for (auto& arena : thread_arenas_)
+		{
+			arena->Reset();
+		}
+	}
+
+}
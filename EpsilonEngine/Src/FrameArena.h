@@ -0,0 +1,115 @@
+#pragma once
+#include <stdint.h>
+#include <assert.h>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Bump allocator for data that dies all at once. Reset keeps the memory, so a frame that fits
+	//in what the previous frames needed never touches the heap
+	class LinearArena
+	{
+	public:
+		explicit LinearArena(size_t block_size = 64 * 1024);
+
+		void* Allocate(size_t size, size_t alignment = 16);
+
+		template <typename T>
+		T* Allocate(size_t count)
+		{
+			return static_cast<T*>(this->Allocate(count * sizeof(T), std::alignment_of<T>::value));
+		}
+
+		//Invalidates everything allocated so far. Spilled blocks are merged into one
+		void Reset();
+
+		size_t BytesUsed() const;
+		size_t Capacity() const;
+
+		//Arena of the calling thread, for scratch memory inside jobs
+		static LinearArena& ThreadLocal();
+
+		//Resets the arenas of every thread, only while no job is running
+		static void ResetThreadLocals();
+
+	private:
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<uint8_t[]> data;
+			size_t size;
+		};
+
+		std::vector<Block> blocks_;
+		size_t block_size_;
+		size_t current_;
+		size_t offset_;
+		size_t used_;
+	};
+
+
+	//Fixed-capacity array carved out of an arena, only for trivially destructible types
+	template <typename T>
+	class FrameArray
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "FrameArray elements are never destroyed");
+
+	public:
+		FrameArray()
+			: data_(nullptr), size_(0), capacity_(0)
+		{
+		}
+
+		void Allocate(LinearArena& arena, size_t capacity)
+		{
+			data_ = capacity > 0 ? arena.Allocate<T>(capacity) : nullptr;
+			size_ = 0;
+			capacity_ = capacity;
+		}
+
+		void push_back(const T& v)
+		{
+			assert(size_ < capacity_);
+			new (data_ + size_) T(v);
+			++size_;
+		}
+
+		void clear()
+		{
+			size_ = 0;
+		}
+
+		//Drops the elements from size on, it can only shrink
+		void resize(size_t size)
+		{
+			assert(size <= size_);
+			size_ = size;
+		}
+
+		size_t size() const { return size_; }
+		bool empty() const { return 0 == size_; }
+
+		T& operator[](size_t i) { return data_[i]; }
+		const T& operator[](size_t i) const { return data_[i]; }
+
+		T* begin() { return data_; }
+		T* end() { return data_ + size_; }
+		const T* begin() const { return data_; }
+		const T* end() const { return data_ + size_; }
+
+	private:
+		T* data_;
+		size_t size_;
+		size_t capacity_;
+	};
+
+}
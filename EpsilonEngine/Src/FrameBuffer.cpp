@@ -1,5 +1,6 @@
 #include "FrameBuffer.h"
 #include "RenderEngine.h"
+#include <array>
 #include <d3d11.h>
 #include <d3d11_1.h>
 #include <d3d11_2.h>
@@ -11,11 +12,13 @@ namespace epsilon
 	FrameBuffer::FrameBuffer()
 	{
 		rtv_fmt_ = DXGI_FORMAT_R8G8B8A8_UNORM;
+		extra_bind_flags_ = 0;
 	}
 
-	FrameBuffer::FrameBuffer(int rtv_fmt)
+	FrameBuffer::FrameBuffer(int rtv_fmt, uint32_t extra_bind_flags /*= 0*/)
 	{
 		rtv_fmt_ = rtv_fmt;
+		extra_bind_flags_ = extra_bind_flags;
 	}
 
 	FrameBuffer::~FrameBuffer()
@@ -47,8 +50,8 @@ namespace epsilon
 			}
 			else
 			{
-				rtv.d3d_rtv_tex_ = MakeCOMPtr(re_->D3DCreateTexture2D(width, height, rtv_fmt_,
-					D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE));
+				rtv.d3d_rtv_tex_ = re_->AcquireRenderTarget(width, height, rtv_fmt_,
+					D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | extra_bind_flags_);
 
 				D3D11_RENDER_TARGET_VIEW_DESC d3d_rtv_desc;
 				d3d_rtv_desc.Format = (DXGI_FORMAT)rtv_fmt_;
@@ -62,19 +65,37 @@ namespace epsilon
 			}
 		}
 
-		//Depth stencil view
-		d3d_dsv_tex_ = MakeCOMPtr(re_->D3DCreateTexture2D(width, height,
-			DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE));
+		//Depth stencil view. The swap chain buffer has the exact window size, which a pooled depth
+		//texture wouldn't match, and nothing drawn into it needs depth
+		if (nullptr == sc_buffer)
+		{
+			d3d_dsv_tex_ = re_->AcquireRenderTarget(width, height,
+				DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
 
-		d3d_dsv_ = MakeCOMPtr(re_->D3DCreateDepthStencilView(d3d_dsv_tex_.get(),
-			DXGI_FORMAT_D24_UNORM_S8_UINT));
+			d3d_dsv_ = MakeCOMPtr(re_->D3DCreateDepthStencilView(d3d_dsv_tex_.get(),
+				DXGI_FORMAT_D24_UNORM_S8_UINT));
+		}
 	}
 
 	void FrameBuffer::Destory()
 	{
+		//Textures go back to the pool for the next frame buffer of the same size class
+		for (auto& rtv : rtvs_)
+		{
+			if (rtv.d3d_rtv_tex_)
+			{
+				re_->ReleaseRenderTarget(rtv.d3d_rtv_tex_);
+			}
+		}
+		if (d3d_dsv_tex_)
+		{
+			re_->ReleaseRenderTarget(d3d_dsv_tex_);
+		}
+
 		rtvs_.clear();
 		d3d_dsv_tex_.reset();
 		d3d_dsv_.reset();
+		d3d_ds_srv_.reset();
 	}
 
 	void FrameBuffer::Clear(Vector4f* c)
@@ -87,19 +108,29 @@ namespace epsilon
 			re_->D3DContext()->ClearRenderTargetView(rtvs_[i].d3d_rtv_.get(), pc);
 		}
 
-		re_->D3DContext()->ClearDepthStencilView(d3d_dsv_.get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		if (d3d_dsv_)
+		{
+			re_->D3DContext()->ClearDepthStencilView(d3d_dsv_.get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		}
 	}
 
 	void FrameBuffer::Bind()
+	{
+		this->Bind(re_->D3DContext());
+	}
+
+	void FrameBuffer::Bind(ID3D11DeviceContext* ctx)
 	{
 		//Bind render target
-		std::vector<ID3D11RenderTargetView*> d3d_rtvs;
+		std::array<ID3D11RenderTargetView*, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT> d3d_rtvs;
 		for (size_t i = 0; i != rtvs_.size(); i++)
 		{
-			d3d_rtvs.push_back(rtvs_[i].d3d_rtv_.get());
+			d3d_rtvs[i] = rtvs_[i].d3d_rtv_.get();
 		}
 
-		re_->D3DContext()->OMSetRenderTargets((UINT)d3d_rtvs.size(), d3d_rtvs.data(), d3d_dsv_.get());
+		ctx->OMSetRenderTargets((UINT)rtvs_.size(), d3d_rtvs.data(), d3d_dsv_.get());
+
+		RenderStatistics::Add(SC_StateChanges);
 	}
 
 	ID3D11ShaderResourceView* FrameBuffer::RetriveRTShaderResourceView(size_t index)
@@ -138,4 +169,21 @@ namespace epsilon
 		return d3d_ds_srv_.get();
 	}
 
+	ID3D11UnorderedAccessView* FrameBuffer::RetriveRTUnorderedAccessView(size_t index)
+	{
+		if (!rtvs_[index].d3d_uav_)
+		{
+			D3D11_UNORDERED_ACCESS_VIEW_DESC d3d_uav_desc;
+			d3d_uav_desc.Format = (DXGI_FORMAT)rtv_fmt_;
+			d3d_uav_desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+			d3d_uav_desc.Texture2D.MipSlice = 0;
+
+			ID3D11UnorderedAccessView* d3d_uav = nullptr;
+			THROW_FAILED(re_->D3DDevice()->CreateUnorderedAccessView(rtvs_[index].d3d_rtv_tex_.get(), &d3d_uav_desc, &d3d_uav));
+			rtvs_[index].d3d_uav_ = MakeCOMPtr(d3d_uav);
+		}
+
+		return rtvs_[index].d3d_uav_.get();
+	}
+
 }
\ No newline at end of file
@@ -12,7 +12,8 @@ namespace epsilon
 	{
 	public:
 		FrameBuffer();
-		FrameBuffer(int rtv_fmt);
+		//Extra bind flags go on each render target, D3D11_BIND_UNORDERED_ACCESS lets compute shaders write it
+		FrameBuffer(int rtv_fmt, uint32_t extra_bind_flags = 0);
 		virtual ~FrameBuffer();
 
 		INTERFACE_SET_RE;
@@ -28,19 +29,24 @@ namespace epsilon
 		void Clear(Vector4f* c = nullptr);
 
 		void Bind();
+		void Bind(ID3D11DeviceContext* ctx);
 
 		ID3D11ShaderResourceView* RetriveRTShaderResourceView(size_t index);
 
 		ID3D11ShaderResourceView* RetriveDSShaderResourceView();
 
+		ID3D11UnorderedAccessView* RetriveRTUnorderedAccessView(size_t index);
+
 	private:
 		int /*DXGI_FORMAT*/ rtv_fmt_;
+		uint32_t extra_bind_flags_;
 
 		struct RTV
 		{
 			ID3D11Texture2DPtr d3d_rtv_tex_;
 			ID3D11RenderTargetViewPtr d3d_rtv_;
 			ID3D11ShaderResourceViewPtr d3d_srv_;
+			ID3D11UnorderedAccessViewPtr d3d_uav_;
 		};
 		std::vector<RTV> rtvs_;
 
@@ -0,0 +1,141 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+
+namespace epsilon
+{
+	const size_t FRAME_HISTORY_SIZE = 256;
+
+	const std::chrono::microseconds INITIAL_SPIN_MARGIN(2000);
+	const std::chrono::microseconds MIN_SPIN_MARGIN(250);
+
+
+	FramePacer::FramePacer()
+		: FramePacer(&Clock::now, [](Clock::duration d) { std::this_thread::sleep_for(d); })
+	{
+	}
+
+	FramePacer::FramePacer(NowFunc now, SleepFunc sleep)
+		: now_(std::move(now)), sleep_(std::move(sleep)), interval_(0), spin_margin_(INITIAL_SPIN_MARGIN), has_last_(false),
+			history_ms_(FRAME_HISTORY_SIZE), history_next_(0), history_count_(0)
+	{
+	}
+
+	void FramePacer::TargetInterval(double seconds)
+	{
+		interval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((std::max)(seconds, 0.0)));
+		deadline_ = Clock::time_point();
+	}
+
+	double FramePacer::TargetInterval() const
+	{
+		return std::chrono::duration<double>(interval_).count();
+	}
+
+	void FramePacer::Pace()
+	{
+		if (interval_.count() > 0)
+		{
+			Clock::time_point now = now_();
+
+			//More than a whole interval late, resynchronize rather than rushing to catch up
+			if (now > deadline_ + interval_)
+			{
+				deadline_ = now;
+			}
+			else
+			{
+				Clock::duration remaining = deadline_ - now;
+				if (remaining > spin_margin_)
+				{
+					Clock::duration request = remaining - spin_margin_;
+					sleep_(request);
+
+					//Grow the margin to the worst oversleep seen, shrink it slowly otherwise
+					Clock::duration oversleep = now_() - now - request;
+					if (oversleep > spin_margin_)
+					{
+						spin_margin_ = (std::min)(oversleep + oversleep / 4, interval_);
+					}
+					else
+					{
+						spin_margin_ = (std::max)(spin_margin_ - spin_margin_ / 64,
+							std::chrono::duration_cast<Clock::duration>(MIN_SPIN_MARGIN));
+					}
+				}
+
+				while (now_() < deadline_)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			deadline_ += interval_;
+		}
+
+		this->Tick();
+	}
+
+	void FramePacer::ResetStats()
+	{
+		has_last_ = false;
+		history_next_ = 0;
+		history_count_ = 0;
+	}
+
+	FrameTimeStats FramePacer::Stats() const
+	{
+		FrameTimeStats stats;
+		stats.num_frames = static_cast<uint32_t>(history_count_);
+		stats.avg_ms = 0;
+		stats.min_ms = 0;
+		stats.max_ms = 0;
+		stats.std_dev_ms = 0;
+		if (0 == history_count_)
+		{
+			return stats;
+		}
+
+		stats.min_ms = history_ms_[0];
+		stats.max_ms = history_ms_[0];
+		double sum = 0;
+		for (size_t i = 0; i != history_count_; i++)
+		{
+			stats.min_ms = (std::min)(stats.min_ms, history_ms_[i]);
+			stats.max_ms = (std::max)(stats.max_ms, history_ms_[i]);
+			sum += history_ms_[i];
+		}
+		stats.avg_ms = sum / history_count_;
+
+		double var = 0;
+		for (size_t i = 0; i != history_count_; i++)
+		{
+			double d = history_ms_[i] - stats.avg_ms;
+			var += d * d;
+		}
+		stats.std_dev_ms = std::sqrt(var / history_count_);
+
+		return stats;
+	}
+
+	double FramePacer::SpinMargin() const
+	{
+		return std::chrono::duration<double>(spin_margin_).count();
+	}
+
+	void FramePacer::Tick()
+	{
+		Clock::time_point now = now_();
+		if (has_last_)
+		{
+			history_ms_[history_next_] = std::chrono::duration<double, std::milli>(now - last_).count();
+			history_next_ = (history_next_ + 1) % FRAME_HISTORY_SIZE;
+			history_count_ = (std::min)(history_count_ + 1, FRAME_HISTORY_SIZE);
+		}
+		last_ = now;
+		has_last_ = true;
+	}
+
+}
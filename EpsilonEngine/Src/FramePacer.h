@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	struct FrameTimeStats
+	{
+		uint32_t num_frames;
+		double avg_ms;
+		double min_ms;
+		double max_ms;
+		double std_dev_ms;
+	};
+
+
+	//Holds frames to a fixed interval by sleeping most of the way and spinning the rest
+	class FramePacer
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+		typedef std::function<Clock::time_point()> NowFunc;
+		typedef std::function<void(Clock::duration)> SleepFunc;
+
+	public:
+		FramePacer();
+
+		//Reads time and sleeps through the given functions instead of the steady clock and the thread,
+		//so tests can pace frames on a simulated clock
+		FramePacer(NowFunc now, SleepFunc sleep);
+
+		//0 disables the cap, frames are only timed
+		void TargetInterval(double seconds);
+		double TargetInterval() const;
+
+		//Call once per frame, right before presenting
+		void Pace();
+
+		//Records the frame without waiting
+		void Tick();
+
+		void ResetStats();
+
+		//Statistics over the last FRAME_HISTORY_SIZE intervals between Pace calls
+		FrameTimeStats Stats() const;
+
+		//Margin before the deadline below which the pacer spins instead of sleeping
+		double SpinMargin() const;
+
+	private:
+		NowFunc now_;
+		SleepFunc sleep_;
+
+		Clock::duration interval_;
+		Clock::duration spin_margin_;
+		Clock::time_point deadline_;
+
+		bool has_last_;
+		Clock::time_point last_;
+
+		std::vector<double> history_ms_;
+		size_t history_next_;
+		size_t history_count_;
+	};
+
+}
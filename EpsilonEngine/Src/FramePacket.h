@@ -0,0 +1,45 @@
+#pragma once
+#include "Utils.h"
+#include "RSPredeclare.h"
+#include "Camera.h"
+#include "Light.h"
+#include "FrameArena.h"
+
+
+namespace epsilon
+{
+
+	struct DrawItem
+	{
+		Renderable* r;
+		XMFLOAT4X4 model_mat;
+	};
+
+
+	//Everything the submit stage reads, snapshotted by the update stage.
+	//The arrays live in the packet's own arena, which is reset when the packet is updated again
+	struct FramePacket
+	{
+		LinearArena arena;
+
+		Camera cam;
+
+		FrameArray<DrawItem> draws;
+
+		AmbientLight ambient_light;
+		FrameArray<DirectionLight> dir_lights;
+		FrameArray<SpotLight> spot_lights;
+
+		//Only the ones in the view frustum
+		FrameArray<PointLight> point_lights;
+
+		//One per spot light, and the casters of the pages that render this frame
+		FrameArray<ShadowView> spot_shadows;
+		FrameArray<DrawItem> shadow_casters;
+
+		//MAX_SHADOW_CASCADES per direction light, with the projections their pages were rendered with
+		FrameArray<ShadowView> cascade_shadows;
+		FrameArray<ShadowCascade> cascades;
+	};
+
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Returned by FramesInFlight::WaitForSlot for a slot no frame was holding
+	const uint64_t NO_FRAME_IN_FLIGHT = ~0ULL;
+
+	//Bounds how many frames the GPU may be behind. Frame N reuses the slot of frame N - max_frames, so
+	//before it is submitted the frame that last held the slot has to have completed
+	class FramesInFlight
+	{
+	public:
+		explicit FramesInFlight(uint32_t max_frames = 2)
+		{
+			this->Reset(max_frames);
+		}
+
+		//Forgets every frame in flight
+		void Reset(uint32_t max_frames)
+		{
+			slot_frames_.assign((std::max)(max_frames, 1u), NO_FRAME_IN_FLIGHT);
+		}
+
+		uint32_t MaxFrames() const
+		{
+			return static_cast<uint32_t>(slot_frames_.size());
+		}
+
+		size_t Slot(uint64_t frame) const
+		{
+			return static_cast<size_t>(frame % slot_frames_.size());
+		}
+
+		//Polls done(slot) until the frame holding frame's slot has completed. Returns that frame, whose
+		//resources can now be reused, or NO_FRAME_IN_FLIGHT if the slot was free
+		template <typename DoneFunc>
+		uint64_t WaitForSlot(uint64_t frame, DoneFunc done)
+		{
+			size_t slot = this->Slot(frame);
+			uint64_t completed = slot_frames_[slot];
+			if (completed != NO_FRAME_IN_FLIGHT)
+			{
+				while (!done(slot))
+				{
+					std::this_thread::yield();
+				}
+				slot_frames_[slot] = NO_FRAME_IN_FLIGHT;
+			}
+			return completed;
+		}
+
+		//Once frame has been submitted with the fence of its slot
+		void Issue(uint64_t frame)
+		{
+			slot_frames_[this->Slot(frame)] = frame;
+		}
+
+		uint32_t NumInFlight() const
+		{
+			uint32_t n = 0;
+			for (uint64_t f : slot_frames_)
+			{
+				n += (f != NO_FRAME_IN_FLIGHT);
+			}
+			return n;
+		}
+
+	private:
+		std::vector<uint64_t> slot_frames_;
+	};
+
+
+	//Double-buffered packets: the update of frame N+1 runs on the job system while frame N is submitted
+	template <typename Packet>
+	class FramePipeline
+	{
+	public:
+		FramePipeline()
+			: frame_index_(0), pipelined_(true)
+		{
+			valid_.fill(false);
+		}
+
+		void Pipelined(bool pipelined)
+		{
+			pipelined_ = pipelined;
+		}
+
+		bool Pipelined() const
+		{
+			return pipelined_;
+		}
+
+		uint64_t FrameIndex() const
+		{
+			return frame_index_;
+		}
+
+		//Drops prepared packets so the next frame is updated from current state
+		void Invalidate()
+		{
+			valid_.fill(false);
+		}
+
+		template <typename UpdateFunc, typename SubmitFunc>
+		void Frame(JobSystem& js, UpdateFunc update, SubmitFunc submit)
+		{
+			size_t cur = frame_index_ & 1;
+			size_t next = cur ^ 1;
+
+			if (!valid_[cur])
+			{
+				update(packets_[cur]);
+			}
+
+			std::exception_ptr error;
+			JobCounter counter;
+			if (pipelined_)
+			{
+				//One captured pointer keeps the job inside std::function's inline storage
+				struct UpdateJob
+				{
+					UpdateFunc* update;
+					Packet* packet;
+					std::exception_ptr* error;
+				} job = { &update, &packets_[next], &error };
+
+				js.Run([&job]()
+				{
+					try
+					{
+						(*job.update)(*job.packet);
+					}
+					catch (...)
+					{
+						*job.error = std::current_exception();
+					}
+				}, &counter);
+			}
+
+			try
+			{
+				submit(packets_[cur]);
+			}
+			catch (...)
+			{
+				js.Wait(counter);
+				throw;
+			}
+
+			js.Wait(counter);
+
+			valid_[cur] = false;
+			valid_[next] = pipelined_;
+			++frame_index_;
+
+			if (error)
+			{
+				valid_[next] = false;
+				std::rethrow_exception(error);
+			}
+		}
+
+	private:
+		std::array<Packet, 2> packets_;
+		std::array<bool, 2> valid_;
+
+		uint64_t frame_index_;
+		bool pipelined_;
+	};
+
+}
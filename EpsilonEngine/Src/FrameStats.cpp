@@ -0,0 +1,112 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace epsilon
+{
+
+	FrameStats::FrameStats()
+	{
+		this->Clear();
+	}
+
+	void FrameStats::Clear()
+	{
+		frame_ms_.clear();
+		passes_.clear();
+		counter_totals_.fill(0);
+		counter_maxs_.fill(0);
+	}
+
+	void FrameStats::Reserve(size_t num_frames)
+	{
+		frame_ms_.reserve(num_frames);
+	}
+
+	void FrameStats::Sample(double frame_ms, const std::vector<PassTiming>& passes, const RenderStatistics& stats)
+	{
+		frame_ms_.push_back(frame_ms);
+
+		for (const auto& timing : passes)
+		{
+			PassAccum& accum = passes_[timing.name];
+			accum.cpu_ms += timing.cpu_ms;
+			accum.gpu_ms += timing.gpu_ms;
+			++accum.count;
+		}
+
+		for (size_t i = 0; i != SC_NumCounters; i++)
+		{
+			uint64_t value = stats.Counter(static_cast<StatCounter>(i));
+			counter_totals_[i] += value;
+			counter_maxs_[i] = (std::max)(counter_maxs_[i], value);
+		}
+	}
+
+	size_t FrameStats::NumFrames() const
+	{
+		return frame_ms_.size();
+	}
+
+	double FrameStats::FrameMsPercentile(double p) const
+	{
+		if (frame_ms_.empty())
+		{
+			return 0;
+		}
+
+		std::vector<double> sorted = frame_ms_;
+		std::sort(sorted.begin(), sorted.end());
+
+		size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+		return sorted[(std::min)((std::max)(rank, static_cast<size_t>(1)), sorted.size()) - 1];
+	}
+
+	void FrameStats::WriteJson(std::ostream& os, uint32_t num_warmup_frames) const
+	{
+		os << "{\n";
+		this->WriteJsonMembers(os, num_warmup_frames);
+		os << "}";
+	}
+
+	void FrameStats::WriteJsonMembers(std::ostream& os, uint32_t num_warmup_frames) const
+	{
+		size_t n = frame_ms_.size();
+
+		double sum = 0;
+		for (double ms : frame_ms_)
+		{
+			sum += ms;
+		}
+
+		os << "  \"frames\": " << n << ",\n";
+		os << "  \"warmup_frames\": " << num_warmup_frames << ",\n";
+		if (n > 0)
+		{
+			os << "  \"frame_ms\": { \"min\": " << *std::min_element(frame_ms_.begin(), frame_ms_.end())
+				<< ", \"avg\": " << sum / n
+				<< ", \"p95\": " << this->FrameMsPercentile(0.95) << ", \"p99\": " << this->FrameMsPercentile(0.99)
+				<< ", \"max\": " << *std::max_element(frame_ms_.begin(), frame_ms_.end()) << " },\n";
+			os << "  \"counters\": {";
+			for (size_t i = 0; i != SC_NumCounters; i++)
+			{
+				os << (i ? ",\n" : "\n") << "    \"" << RenderStatistics::CounterName(static_cast<StatCounter>(i)) << "\": { \"avg\": "
+					<< static_cast<double>(counter_totals_[i]) / n << ", \"max\": " << counter_maxs_[i] << " }";
+			}
+			os << "\n  },\n";
+		}
+
+		os << "  \"passes\": [";
+		bool first = true;
+		for (const auto& pass : passes_)
+		{
+			os << (first ? "\n" : ",\n");
+			os << "    { \"name\": \"" << pass.first << "\", \"cpu_ms\": " << pass.second.cpu_ms / pass.second.count
+				<< ", \"gpu_ms\": " << pass.second.gpu_ms / pass.second.count << " }";
+			first = false;
+		}
+		os << "\n  ]\n";
+	}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Profiler.h"
+#include "RenderStatistics.h"
+#include <array>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Frame times, pass timings and render counters of a benchmark's measured frames, summarized as JSON.
+	//Shared by the D3D11 Benchmark and the headless one of EpsilonEngineBench so both write the same format
+	class FrameStats
+	{
+	public:
+		FrameStats();
+
+		void Clear();
+		void Reserve(size_t num_frames);
+
+		//stats holds the counters latched by the frame's EndFrame
+		void Sample(double frame_ms, const std::vector<PassTiming>& passes, const RenderStatistics& stats);
+
+		size_t NumFrames() const;
+
+		//Nearest-rank percentile of the frame times, p in [0, 1]. 0 without frames
+		double FrameMsPercentile(double p) const;
+
+		//One object, without a trailing newline
+		void WriteJson(std::ostream& os, uint32_t num_warmup_frames) const;
+
+		//Only the object's members, one per line, for adding them to an object of the caller's
+		void WriteJsonMembers(std::ostream& os, uint32_t num_warmup_frames) const;
+
+	private:
+		struct PassAccum
+		{
+			double cpu_ms;
+			double gpu_ms;
+			uint32_t count;
+		};
+
+		std::vector<double> frame_ms_;
+		std::map<std::string, PassAccum> passes_;
+		std::array<uint64_t, SC_NumCounters> counter_totals_;
+		std::array<uint64_t, SC_NumCounters> counter_maxs_;
+	};
+
+}
@@ -0,0 +1,208 @@
+#include "GPUProfiler.h"
+#include "RenderEngine.h"
+#include <thread>
+#include <d3d11.h>
+
+
+namespace epsilon
+{
+
+	GPUProfiler::GPUProfiler()
+	{
+		trace_ = nullptr;
+		frame_index_ = 0;
+		in_frame_ = false;
+		last_frame_gpu_ms_ = 0;
+		num_resolved_frames_ = 0;
+	}
+
+	GPUProfiler::~GPUProfiler()
+	{
+		this->Destory();
+	}
+
+	void GPUProfiler::Create(TraceBuffer& trace)
+	{
+		trace_ = &trace;
+		frame_index_ = 0;
+		in_frame_ = false;
+
+		for (auto& frame : frames_)
+		{
+			frame.disjoint = this->CreateQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+			frame.begin = this->CreateQuery(D3D11_QUERY_TIMESTAMP);
+			frame.end = this->CreateQuery(D3D11_QUERY_TIMESTAMP);
+			for (auto& pass : frame.passes)
+			{
+				pass.name = nullptr;
+				pass.begin = this->CreateQuery(D3D11_QUERY_TIMESTAMP);
+				pass.end = this->CreateQuery(D3D11_QUERY_TIMESTAMP);
+			}
+			frame.num_passes = 0;
+			frame.issued = false;
+		}
+	}
+
+	void GPUProfiler::Destory()
+	{
+		for (auto& frame : frames_)
+		{
+			frame.disjoint.reset();
+			frame.begin.reset();
+			frame.end.reset();
+			for (auto& pass : frame.passes)
+			{
+				pass.begin.reset();
+				pass.end.reset();
+			}
+			frame.issued = false;
+		}
+		last_timings_.clear();
+	}
+
+	ID3D11QueryPtr GPUProfiler::CreateQuery(int type)
+	{
+		D3D11_QUERY_DESC d3d_query_desc;
+		d3d_query_desc.Query = static_cast<D3D11_QUERY>(type);
+		d3d_query_desc.MiscFlags = 0;
+
+		ID3D11Query* d3d_query = nullptr;
+		THROW_FAILED(re_->D3DDevice()->CreateQuery(&d3d_query_desc, &d3d_query));
+		return MakeCOMPtr(d3d_query);
+	}
+
+	void GPUProfiler::BeginFrame()
+	{
+		FrameQueries& frame = frames_[frame_index_ % NUM_FRAMES];
+		if (frame.issued)
+		{
+			this->Resolve(frame);
+		}
+
+		ID3D11DeviceContext* ctx = re_->D3DContext();
+		ctx->Begin(frame.disjoint.get());
+		ctx->End(frame.begin.get());
+		frame.cpu_begin_ns = TraceBuffer::NowNs();
+		frame.num_passes = 0;
+
+		in_frame_ = true;
+	}
+
+	void GPUProfiler::EndFrame()
+	{
+		FrameQueries& frame = frames_[frame_index_ % NUM_FRAMES];
+		ID3D11DeviceContext* ctx = re_->D3DContext();
+		ctx->End(frame.end.get());
+		ctx->End(frame.disjoint.get());
+		frame.issued = true;
+
+		++frame_index_;
+		in_frame_ = false;
+	}
+
+	uint32_t GPUProfiler::BeginPass(const char* name)
+	{
+		FrameQueries& frame = frames_[frame_index_ % NUM_FRAMES];
+		if (!in_frame_ || (frame.num_passes == MAX_PASSES))
+		{
+			return MAX_PASSES;
+		}
+
+		PassQueries& pass = frame.passes[frame.num_passes];
+		pass.name = name;
+		re_->D3DContext()->End(pass.begin.get());
+
+		return frame.num_passes++;
+	}
+
+	void GPUProfiler::EndPass(uint32_t pass, uint64_t cpu_begin_ns, uint64_t cpu_end_ns)
+	{
+		if (pass < MAX_PASSES)
+		{
+			PassQueries& pq = frames_[frame_index_ % NUM_FRAMES].passes[pass];
+			re_->D3DContext()->End(pq.end.get());
+			pq.cpu_begin_ns = cpu_begin_ns;
+			pq.cpu_end_ns = cpu_end_ns;
+
+			trace_->Push(pq.name, cpu_begin_ns, cpu_end_ns);
+		}
+	}
+
+	const std::vector<PassTiming>& GPUProfiler::LastTimings() const
+	{
+		return last_timings_;
+	}
+
+	double GPUProfiler::LastFrameGPUTime() const
+	{
+		return last_frame_gpu_ms_;
+	}
+
+	uint64_t GPUProfiler::NumResolvedFrames() const
+	{
+		return num_resolved_frames_;
+	}
+
+	TraceBuffer& GPUProfiler::Trace()
+	{
+		return *trace_;
+	}
+
+	void GPUProfiler::Resolve(FrameQueries& frame)
+	{
+		frame.issued = false;
+
+		ID3D11DeviceContext* ctx = re_->D3DContext();
+
+		//Issued NUM_FRAMES frames ago, so this rarely has to wait
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		HRESULT hr;
+		while (S_FALSE == (hr = ctx->GetData(frame.disjoint.get(), &disjoint, sizeof(disjoint), 0)))
+		{
+			std::this_thread::yield();
+		}
+		if (FAILED(hr) || disjoint.Disjoint)
+		{
+			return;
+		}
+
+		uint64_t frame_begin = 0;
+		uint64_t frame_end = 0;
+		if ((S_OK != ctx->GetData(frame.begin.get(), &frame_begin, sizeof(frame_begin), 0))
+			|| (S_OK != ctx->GetData(frame.end.get(), &frame_end, sizeof(frame_end), 0)))
+		{
+			return;
+		}
+
+		double ns_per_tick = 1e9 / disjoint.Frequency;
+
+		last_frame_gpu_ms_ = (frame_end - frame_begin) * ns_per_tick / 1e6;
+		++num_resolved_frames_;
+
+		last_timings_.clear();
+		for (uint32_t i = 0; i != frame.num_passes; i++)
+		{
+			const PassQueries& pass = frame.passes[i];
+
+			uint64_t begin = 0;
+			uint64_t end = 0;
+			if ((S_OK != ctx->GetData(pass.begin.get(), &begin, sizeof(begin), 0))
+				|| (S_OK != ctx->GetData(pass.end.get(), &end, sizeof(end), 0)))
+			{
+				continue;
+			}
+
+			//Place GPU work on the CPU timeline relative to where the frame began
+			uint64_t begin_ns = frame.cpu_begin_ns + static_cast<uint64_t>((begin - frame_begin) * ns_per_tick);
+			uint64_t end_ns = frame.cpu_begin_ns + static_cast<uint64_t>((end - frame_begin) * ns_per_tick);
+			trace_->Push(pass.name, begin_ns, end_ns, TT_GPU, 0);
+
+			PassTiming timing;
+			timing.name = pass.name;
+			timing.cpu_ms = (pass.cpu_end_ns - pass.cpu_begin_ns) / 1e6;
+			timing.gpu_ms = (end - begin) * ns_per_tick / 1e6;
+			last_timings_.push_back(timing);
+		}
+	}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "Utils.h"
+#include "D3D11Predeclare.h"
+#include "RSPredeclare.h"
+#include "Profiler.h"
+#include <array>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Timestamp queries around named passes, read back a few frames later so the CPU never stalls on them
+	class GPUProfiler
+	{
+	public:
+		static const uint32_t MAX_PASSES = 32;
+		static const uint32_t NUM_FRAMES = 4;
+
+	public:
+		GPUProfiler();
+		virtual ~GPUProfiler();
+
+		INTERFACE_SET_RE;
+
+		void Create(TraceBuffer& trace);
+
+		void Destory();
+
+		void BeginFrame();
+		void EndFrame();
+
+		uint32_t BeginPass(const char* name);
+		void EndPass(uint32_t pass, uint64_t cpu_begin_ns, uint64_t cpu_end_ns);
+
+		//Timings of the most recent frame whose queries have been read back
+		const std::vector<PassTiming>& LastTimings() const;
+
+		//GPU time between BeginFrame and EndFrame of that same frame
+		double LastFrameGPUTime() const;
+
+		//Grows by one whenever a frame is read back, tells a new LastFrameGPUTime from a repeated one
+		uint64_t NumResolvedFrames() const;
+
+		TraceBuffer& Trace();
+
+	private:
+		struct PassQueries
+		{
+			const char* name;
+			ID3D11QueryPtr begin;
+			ID3D11QueryPtr end;
+			uint64_t cpu_begin_ns;
+			uint64_t cpu_end_ns;
+		};
+
+		struct FrameQueries
+		{
+			ID3D11QueryPtr disjoint;
+			ID3D11QueryPtr begin;
+			ID3D11QueryPtr end;
+			std::array<PassQueries, MAX_PASSES> passes;
+			uint32_t num_passes;
+			uint64_t cpu_begin_ns;
+			bool issued;
+		};
+
+		ID3D11QueryPtr CreateQuery(int /*D3D11_QUERY*/ type);
+
+		void Resolve(FrameQueries& frame);
+
+	private:
+		TraceBuffer* trace_;
+
+		std::array<FrameQueries, NUM_FRAMES> frames_;
+		uint64_t frame_index_;
+		bool in_frame_;
+
+		std::vector<PassTiming> last_timings_;
+		double last_frame_gpu_ms_;
+		uint64_t num_resolved_frames_;
+	};
+
+
+	//CPU and GPU timing of one pass on the immediate context
+	class PassProfileScope
+	{
+	public:
+		PassProfileScope(GPUProfiler& profiler, const char* name)
+			: profiler_(profiler), cpu_begin_ns_(TraceBuffer::NowNs())
+		{
+			pass_ = profiler_.BeginPass(name);
+		}
+
+		~PassProfileScope()
+		{
+			profiler_.EndPass(pass_, cpu_begin_ns_, TraceBuffer::NowNs());
+		}
+
+	private:
+		PassProfileScope(const PassProfileScope&) = delete;
+		PassProfileScope& operator=(const PassProfileScope&) = delete;
+
+	private:
+		GPUProfiler& profiler_;
+		uint64_t cpu_begin_ns_;
+		uint32_t pass_;
+	};
+
+}
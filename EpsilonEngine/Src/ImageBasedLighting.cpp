@@ -0,0 +1,837 @@
+#include "ImageBasedLighting.h"
+#include "BatchMath.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EPSILON_IBL_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#define EPSILON_TARGET_SSE2
+#else
+#define EPSILON_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+
+namespace epsilon
+{
+	const float IBL_PI = 3.14159265f;
+
+	//Rows of face texels a job gets
+	const size_t IBL_ROW_GRAIN = 8;
+
+	//Per row, the 27 SH sums and the solid angle weights they're normalized by
+	const uint32_t SH_PARTIAL_SIZE = SH_COEFFICIENTS * 3 + 1;
+
+	//Basis constants, sqrt((2l + 1) / (4 pi) * (l - |m|)! / (l + |m|)!) up to the factors of the polynomials
+	const float SH_C0 = 0.282095f;
+	const float SH_C1 = 0.488603f;
+	const float SH_C2 = 1.092548f;
+	const float SH_C3 = 0.315392f;
+	const float SH_C4 = 0.546274f;
+
+	//Clamped cosine convolution of each band over pi: 1, 2/3 and 1/4
+	const float SH_IRRADIANCE_BANDS[SH_COEFFICIENTS] =
+	{
+		1.0f,
+		2.0f / 3, 2.0f / 3, 2.0f / 3,
+		0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+	};
+
+	const float SKY_ZENITH[3] = { 0.25f, 0.45f, 0.9f };
+	const float SKY_HORIZON[3] = { 0.9f, 0.85f, 0.8f };
+	const float SKY_GROUND[3] = { 0.3f, 0.27f, 0.24f };
+	const float SKY_SUN_DIR[3] = { 0.3f, 0.8f, 0.5f };
+	const float SKY_SUN_INTENSITY = 20;
+	const float SKY_SUN_EXPONENT = 512;
+
+	//Direction = major + u * u_axis + v * v_axis, the D3D cube layout
+	struct CubeFaceAxes
+	{
+		float major[3];
+		float u_axis[3];
+		float v_axis[3];
+	};
+
+	const CubeFaceAxes CUBE_FACE_AXES[6] =
+	{
+		{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+		{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+		{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+		{ { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } }
+	};
+
+	//Importance samples of one mip's lobe around +z, padded with zero weights to a multiple of 4
+	struct SpecularSamples
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> weight;
+
+		//Environment mip each sample reads
+		std::vector<uint32_t> level;
+
+		float inv_weight_sum;
+	};
+
+
+	float TexelCoord(uint32_t i, uint32_t size)
+	{
+		return (i + 0.5f) * (2.0f / size) - 1;
+	}
+
+	void Normalize3(float v[3])
+	{
+		float inv_len = 1 / std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		v[0] *= inv_len;
+		v[1] *= inv_len;
+		v[2] *= inv_len;
+	}
+
+	void CubemapFaceUV(const float dir[3], uint32_t& face, float& u, float& v)
+	{
+		float ax = std::abs(dir[0]);
+		float ay = std::abs(dir[1]);
+		float az = std::abs(dir[2]);
+		if ((ax >= ay) && (ax >= az))
+		{
+			face = (dir[0] >= 0) ? 0 : 1;
+			u = ((dir[0] >= 0) ? -dir[2] : dir[2]) / ax;
+			v = -dir[1] / ax;
+		}
+		else if (ay >= az)
+		{
+			face = (dir[1] >= 0) ? 2 : 3;
+			u = dir[0] / ay;
+			v = ((dir[1] >= 0) ? dir[2] : -dir[2]) / ay;
+		}
+		else
+		{
+			face = (dir[2] >= 0) ? 4 : 5;
+			u = ((dir[2] >= 0) ? dir[0] : -dir[0]) / az;
+			v = -dir[1] / az;
+		}
+	}
+
+	//The 4 texels under a direction and the weights between them
+	struct BilinearTaps
+	{
+		const float* t00;
+		const float* t10;
+		const float* t01;
+		const float* t11;
+		float tx;
+		float ty;
+	};
+
+	BilinearTaps CubemapTaps(const Cubemap& cube, const float dir[3])
+	{
+		uint32_t face;
+		float u;
+		float v;
+		CubemapFaceUV(dir, face, u, v);
+
+		uint32_t size = cube.size;
+		float max_coord = static_cast<float>(size - 1);
+		float fx = (std::min)((std::max)((u + 1) * 0.5f * size - 0.5f, 0.0f), max_coord);
+		float fy = (std::min)((std::max)((v + 1) * 0.5f * size - 0.5f, 0.0f), max_coord);
+		uint32_t x0 = static_cast<uint32_t>(fx);
+		uint32_t y0 = static_cast<uint32_t>(fy);
+		uint32_t x1 = (std::min)(x0 + 1, size - 1);
+		uint32_t y1 = (std::min)(y0 + 1, size - 1);
+
+		const float* texels = &cube.texels[static_cast<size_t>(face) * size * size * 4];
+		BilinearTaps taps;
+		taps.t00 = &texels[(y0 * size + x0) * 4];
+		taps.t10 = &texels[(y0 * size + x1) * 4];
+		taps.t01 = &texels[(y1 * size + x0) * 4];
+		taps.t11 = &texels[(y1 * size + x1) * 4];
+		taps.tx = fx - x0;
+		taps.ty = fy - y0;
+		return taps;
+	}
+
+	void TangentFrame(const float n[3], float t[3], float b[3])
+	{
+		float up[3] = { 0, 0, 1 };
+		if (std::abs(n[2]) >= 0.999f)
+		{
+			up[0] = 1;
+			up[2] = 0;
+		}
+
+		t[0] = up[1] * n[2] - up[2] * n[1];
+		t[1] = up[2] * n[0] - up[0] * n[2];
+		t[2] = up[0] * n[1] - up[1] * n[0];
+		Normalize3(t);
+
+		b[0] = n[1] * t[2] - n[2] * t[1];
+		b[1] = n[2] * t[0] - n[0] * t[2];
+		b[2] = n[0] * t[1] - n[1] * t[0];
+	}
+
+	//Base-2 Van der Corput sequence. Not RadicalInverse like AmbientOcclusion.cpp's, both link into the engine
+	float VanDerCorput(uint32_t bits)
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555U) << 1) | ((bits & 0xAAAAAAAAU) >> 1);
+		bits = ((bits & 0x33333333U) << 2) | ((bits & 0xCCCCCCCCU) >> 2);
+		bits = ((bits & 0x0F0F0F0FU) << 4) | ((bits & 0xF0F0F0F0U) >> 4);
+		bits = ((bits & 0x00FF00FFU) << 8) | ((bits & 0xFF00FF00U) >> 8);
+		return bits * 2.3283064365386963e-10f;
+	}
+
+	float GGXDistribution(float cos_theta, float roughness)
+	{
+		float a2 = roughness * roughness * roughness * roughness;
+		float d = (a2 - 1) * cos_theta * cos_theta + 1;
+		return a2 / (IBL_PI * d * d);
+	}
+
+	//Hammersley points through the GGX distribution of half vectors, reflected about them, the mip each one
+	//reads chosen from the solid angle it stands for against a texel's (Colbert and Krivanek, GPU Gems 3 20.4)
+	void BuildSpecularSamples(float roughness, uint32_t num_samples, uint32_t size, uint32_t num_levels,
+		SpecularSamples& samples)
+	{
+		float a2 = roughness * roughness * roughness * roughness;
+		float texel_solid_angle = 4 * IBL_PI / (6.0f * size * size);
+
+		samples.x.clear();
+		samples.y.clear();
+		samples.z.clear();
+		samples.weight.clear();
+		samples.level.clear();
+
+		float weight_sum = 0;
+		for (uint32_t i = 0; i != num_samples; i++)
+		{
+			float phi = 2 * IBL_PI * i / num_samples;
+			float e = VanDerCorput(i);
+			float cos_theta = std::sqrt((1 - e) / (1 + (a2 - 1) * e));
+			float sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+
+			//The view is the normal, so the half vector's cosine is the same to both
+			float lz = 2 * cos_theta * cos_theta - 1;
+			if (lz <= 0)
+			{
+				continue;
+			}
+
+			float pdf = GGXDistribution(cos_theta, roughness) / 4;
+			float sample_solid_angle = 1 / (num_samples * pdf);
+			float lod = 0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1;
+
+			samples.x.push_back(2 * cos_theta * sin_theta * std::cos(phi));
+			samples.y.push_back(2 * cos_theta * sin_theta * std::sin(phi));
+			samples.z.push_back(lz);
+			samples.weight.push_back(lz);
+			samples.level.push_back((std::min)(static_cast<uint32_t>((std::max)(lod + 0.5f, 0.0f)), num_levels - 1));
+			weight_sum += lz;
+		}
+
+		while (samples.weight.size() % 4 != 0)
+		{
+			samples.x.push_back(0);
+			samples.y.push_back(0);
+			samples.z.push_back(1);
+			samples.weight.push_back(0);
+			samples.level.push_back(0);
+		}
+
+		samples.inv_weight_sum = 1 / weight_sum;
+	}
+
+
+	void AccumulateSHTexel(const Cubemap& cube, uint32_t face, uint32_t x, uint32_t y, float partial[SH_PARTIAL_SIZE])
+	{
+		uint32_t size = cube.size;
+		float u = TexelCoord(x, size);
+		float v = TexelCoord(y, size);
+
+		float dir[3];
+		CubemapDirection(face, u, v, dir);
+		float inv_len = 1 / std::sqrt(1 + u * u + v * v);
+		dir[0] *= inv_len;
+		dir[1] *= inv_len;
+		dir[2] *= inv_len;
+
+		//Solid angle of the texel, up to a constant
+		float w = inv_len * inv_len * inv_len;
+
+		float basis[SH_COEFFICIENTS];
+		SHBasis9(dir, basis);
+
+		const float* t = &cube.texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+		for (uint32_t i = 0; i != SH_COEFFICIENTS; i++)
+		{
+			float bw = basis[i] * w;
+			partial[i * 3 + 0] += bw * t[0];
+			partial[i * 3 + 1] += bw * t[1];
+			partial[i * 3 + 2] += bw * t[2];
+		}
+		partial[SH_COEFFICIENTS * 3] += w;
+	}
+
+	void ProjectRowScalar(const Cubemap& cube, uint32_t face, uint32_t y, float partial[SH_PARTIAL_SIZE])
+	{
+		for (uint32_t x = 0; x != cube.size; x++)
+		{
+			AccumulateSHTexel(cube, face, x, y, partial);
+		}
+	}
+
+	void SampleSpecularScalar(const std::vector<Cubemap>& levels, const SpecularSamples& samples, const float n[3],
+		float out[4])
+	{
+		float t[3];
+		float b[3];
+		TangentFrame(n, t, b);
+
+		float acc[3] = { 0, 0, 0 };
+		for (size_t s = 0; s != samples.weight.size(); s++)
+		{
+			float w = samples.weight[s];
+			if (w <= 0)
+			{
+				continue;
+			}
+
+			float sx = samples.x[s];
+			float sy = samples.y[s];
+			float sz = samples.z[s];
+			float l[3] =
+			{
+				t[0] * sx + b[0] * sy + n[0] * sz,
+				t[1] * sx + b[1] * sy + n[1] * sz,
+				t[2] * sx + b[2] * sy + n[2] * sz
+			};
+
+			float rgba[4];
+			SampleCubemap(levels[samples.level[s]], l, rgba);
+			acc[0] += rgba[0] * w;
+			acc[1] += rgba[1] * w;
+			acc[2] += rgba[2] * w;
+		}
+
+		out[0] = acc[0] * samples.inv_weight_sum;
+		out[1] = acc[1] * samples.inv_weight_sum;
+		out[2] = acc[2] * samples.inv_weight_sum;
+		out[3] = 1;
+	}
+
+#ifdef EPSILON_IBL_X86
+	EPSILON_TARGET_SSE2 void ProjectRowSSE2(const Cubemap& cube, uint32_t face, uint32_t y,
+		float partial[SH_PARTIAL_SIZE])
+	{
+		const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+		uint32_t size = cube.size;
+		float v = TexelCoord(y, size);
+
+		__m128 acc[SH_PARTIAL_SIZE];
+		for (auto& a : acc)
+		{
+			a = _mm_setzero_ps();
+		}
+
+		const __m128 one = _mm_set1_ps(1);
+		const __m128 scale = _mm_set1_ps(2.0f / size);
+		const __m128 vv = _mm_set1_ps(v);
+		__m128 c[3];
+		__m128 ua[3];
+		for (int k = 0; k != 3; k++)
+		{
+			c[k] = _mm_set1_ps(axes.major[k]);
+			ua[k] = _mm_set1_ps(axes.u_axis[k]);
+		}
+		__m128 va[3] =
+		{
+			_mm_set1_ps(v * axes.v_axis[0]), _mm_set1_ps(v * axes.v_axis[1]), _mm_set1_ps(v * axes.v_axis[2])
+		};
+
+		const float* row = &cube.texels[(static_cast<size_t>(face) * size + y) * size * 4];
+		uint32_t x = 0;
+		for (; x + 4 <= size; x += 4)
+		{
+			__m128 u = _mm_sub_ps(_mm_mul_ps(_mm_set_ps(x + 3.5f, x + 2.5f, x + 1.5f, x + 0.5f), scale), one);
+			__m128 inv_len = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(one, _mm_mul_ps(u, u)), _mm_mul_ps(vv, vv))));
+			__m128 dx = _mm_mul_ps(_mm_add_ps(_mm_add_ps(c[0], _mm_mul_ps(u, ua[0])), va[0]), inv_len);
+			__m128 dy = _mm_mul_ps(_mm_add_ps(_mm_add_ps(c[1], _mm_mul_ps(u, ua[1])), va[1]), inv_len);
+			__m128 dz = _mm_mul_ps(_mm_add_ps(_mm_add_ps(c[2], _mm_mul_ps(u, ua[2])), va[2]), inv_len);
+			__m128 w = _mm_mul_ps(_mm_mul_ps(inv_len, inv_len), inv_len);
+
+			//4 rgba texels to planes of r, g and b
+			__m128 r = _mm_loadu_ps(&row[(x + 0) * 4]);
+			__m128 g = _mm_loadu_ps(&row[(x + 1) * 4]);
+			__m128 b = _mm_loadu_ps(&row[(x + 2) * 4]);
+			__m128 a = _mm_loadu_ps(&row[(x + 3) * 4]);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			__m128 basis[SH_COEFFICIENTS] =
+			{
+				_mm_set1_ps(SH_C0),
+				_mm_mul_ps(_mm_set1_ps(SH_C1), dy),
+				_mm_mul_ps(_mm_set1_ps(SH_C1), dz),
+				_mm_mul_ps(_mm_set1_ps(SH_C1), dx),
+				_mm_mul_ps(_mm_set1_ps(SH_C2), _mm_mul_ps(dx, dy)),
+				_mm_mul_ps(_mm_set1_ps(SH_C2), _mm_mul_ps(dy, dz)),
+				_mm_mul_ps(_mm_set1_ps(SH_C3), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3), _mm_mul_ps(dz, dz)), one)),
+				_mm_mul_ps(_mm_set1_ps(SH_C2), _mm_mul_ps(dx, dz)),
+				_mm_mul_ps(_mm_set1_ps(SH_C4), _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)))
+			};
+			for (uint32_t i = 0; i != SH_COEFFICIENTS; i++)
+			{
+				__m128 bw = _mm_mul_ps(basis[i], w);
+				acc[i * 3 + 0] = _mm_add_ps(acc[i * 3 + 0], _mm_mul_ps(bw, r));
+				acc[i * 3 + 1] = _mm_add_ps(acc[i * 3 + 1], _mm_mul_ps(bw, g));
+				acc[i * 3 + 2] = _mm_add_ps(acc[i * 3 + 2], _mm_mul_ps(bw, b));
+			}
+			acc[SH_COEFFICIENTS * 3] = _mm_add_ps(acc[SH_COEFFICIENTS * 3], w);
+		}
+
+		for (uint32_t k = 0; k != SH_PARTIAL_SIZE; k++)
+		{
+			float lanes[4];
+			_mm_storeu_ps(lanes, acc[k]);
+			partial[k] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		}
+
+		for (; x != size; x++)
+		{
+			AccumulateSHTexel(cube, face, x, y, partial);
+		}
+	}
+
+	EPSILON_TARGET_SSE2 __m128 SampleCubemapSSE2(const Cubemap& cube, const float dir[3])
+	{
+		BilinearTaps taps = CubemapTaps(cube, dir);
+
+		__m128 tx = _mm_set1_ps(taps.tx);
+		__m128 ty = _mm_set1_ps(taps.ty);
+		__m128 t00 = _mm_loadu_ps(taps.t00);
+		__m128 t10 = _mm_loadu_ps(taps.t10);
+		__m128 t01 = _mm_loadu_ps(taps.t01);
+		__m128 t11 = _mm_loadu_ps(taps.t11);
+		__m128 top = _mm_add_ps(t00, _mm_mul_ps(_mm_sub_ps(t10, t00), tx));
+		__m128 bottom = _mm_add_ps(t01, _mm_mul_ps(_mm_sub_ps(t11, t01), tx));
+		return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), ty));
+	}
+
+	//Rotates 4 samples into the texel's frame at once, then reads and weights them a texel per register
+	EPSILON_TARGET_SSE2 void SampleSpecularSSE2(const std::vector<Cubemap>& levels, const SpecularSamples& samples,
+		const float n[3], float out[4])
+	{
+		float t[3];
+		float b[3];
+		TangentFrame(n, t, b);
+
+		__m128 acc = _mm_setzero_ps();
+		for (size_t s = 0; s != samples.weight.size(); s += 4)
+		{
+			__m128 sx = _mm_loadu_ps(&samples.x[s]);
+			__m128 sy = _mm_loadu_ps(&samples.y[s]);
+			__m128 sz = _mm_loadu_ps(&samples.z[s]);
+
+			float l[3][4];
+			for (int k = 0; k != 3; k++)
+			{
+				__m128 lk = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t[k]), sx), _mm_mul_ps(_mm_set1_ps(b[k]), sy)),
+					_mm_mul_ps(_mm_set1_ps(n[k]), sz));
+				_mm_storeu_ps(l[k], lk);
+			}
+
+			for (size_t lane = 0; lane != 4; lane++)
+			{
+				float w = samples.weight[s + lane];
+				if (w <= 0)
+				{
+					continue;
+				}
+
+				float dir[3] = { l[0][lane], l[1][lane], l[2][lane] };
+				__m128 texel = SampleCubemapSSE2(levels[samples.level[s + lane]], dir);
+				acc = _mm_add_ps(acc, _mm_mul_ps(texel, _mm_set1_ps(w)));
+			}
+		}
+
+		_mm_storeu_ps(out, _mm_mul_ps(acc, _mm_set1_ps(samples.inv_weight_sum)));
+		out[3] = 1;
+	}
+#endif
+
+
+	void AllocateCubemap(uint32_t size, Cubemap& cube)
+	{
+		cube.size = size;
+		cube.texels.assign(static_cast<size_t>(6) * size * size * 4, 0.0f);
+	}
+
+	void CubemapDirection(uint32_t face, float u, float v, float dir[3])
+	{
+		const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+		for (int k = 0; k != 3; k++)
+		{
+			dir[k] = axes.major[k] + u * axes.u_axis[k] + v * axes.v_axis[k];
+		}
+	}
+
+	void SampleCubemap(const Cubemap& cube, const float dir[3], float rgba[4])
+	{
+		BilinearTaps taps = CubemapTaps(cube, dir);
+		for (int c = 0; c != 4; c++)
+		{
+			float top = taps.t00[c] + (taps.t10[c] - taps.t00[c]) * taps.tx;
+			float bottom = taps.t01[c] + (taps.t11[c] - taps.t01[c]) * taps.tx;
+			rgba[c] = top + (bottom - top) * taps.ty;
+		}
+	}
+
+	void DownsampleCubemap(const Cubemap& src, Cubemap& dst)
+	{
+		uint32_t size = (std::max)(src.size / 2, 1U);
+		AllocateCubemap(size, dst);
+
+		for (uint32_t face = 0; face != 6; face++)
+		{
+			const float* src_face = &src.texels[static_cast<size_t>(face) * src.size * src.size * 4];
+			float* dst_face = &dst.texels[static_cast<size_t>(face) * size * size * 4];
+			for (uint32_t y = 0; y != size; y++)
+			{
+				uint32_t y0 = (std::min)(y * 2, src.size - 1);
+				uint32_t y1 = (std::min)(y * 2 + 1, src.size - 1);
+				for (uint32_t x = 0; x != size; x++)
+				{
+					uint32_t x0 = (std::min)(x * 2, src.size - 1);
+					uint32_t x1 = (std::min)(x * 2 + 1, src.size - 1);
+					for (int c = 0; c != 4; c++)
+					{
+						dst_face[(y * size + x) * 4 + c] = 0.25f * (src_face[(y0 * src.size + x0) * 4 + c]
+							+ src_face[(y0 * src.size + x1) * 4 + c] + src_face[(y1 * src.size + x0) * 4 + c]
+							+ src_face[(y1 * src.size + x1) * 4 + c]);
+					}
+				}
+			}
+		}
+	}
+
+	void BuildSkyCubemap(uint32_t size, Cubemap& cube)
+	{
+		AllocateCubemap(size, cube);
+
+		float sun[3] = { SKY_SUN_DIR[0], SKY_SUN_DIR[1], SKY_SUN_DIR[2] };
+		Normalize3(sun);
+
+		for (uint32_t face = 0; face != 6; face++)
+		{
+			for (uint32_t y = 0; y != size; y++)
+			{
+				for (uint32_t x = 0; x != size; x++)
+				{
+					float dir[3];
+					CubemapDirection(face, TexelCoord(x, size), TexelCoord(y, size), dir);
+					Normalize3(dir);
+
+					float* t = &cube.texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+					if (dir[1] >= 0)
+					{
+						float f = std::sqrt(dir[1]);
+						float s = std::pow((std::max)(dir[0] * sun[0] + dir[1] * sun[1] + dir[2] * sun[2], 0.0f), SKY_SUN_EXPONENT);
+						for (int c = 0; c != 3; c++)
+						{
+							t[c] = SKY_HORIZON[c] + (SKY_ZENITH[c] - SKY_HORIZON[c]) * f + SKY_SUN_INTENSITY * s;
+						}
+					}
+					else
+					{
+						float f = (std::min)(-dir[1] * 4, 1.0f);
+						for (int c = 0; c != 3; c++)
+						{
+							t[c] = SKY_HORIZON[c] * 0.5f + (SKY_GROUND[c] - SKY_HORIZON[c] * 0.5f) * f;
+						}
+					}
+					t[3] = 1;
+				}
+			}
+		}
+	}
+
+	void SHBasis9(const float dir[3], float basis[SH_COEFFICIENTS])
+	{
+		float x = dir[0];
+		float y = dir[1];
+		float z = dir[2];
+
+		basis[0] = SH_C0;
+		basis[1] = SH_C1 * y;
+		basis[2] = SH_C1 * z;
+		basis[3] = SH_C1 * x;
+		basis[4] = SH_C2 * (x * y);
+		basis[5] = SH_C2 * (y * z);
+		basis[6] = SH_C3 * (3 * (z * z) - 1);
+		basis[7] = SH_C2 * (x * z);
+		basis[8] = SH_C4 * (x * x - y * y);
+	}
+
+	void ProjectSH9(const Cubemap& cube, float sh[SH_COEFFICIENTS][3], JobSystem* js /*= nullptr*/)
+	{
+		size_t num_rows = static_cast<size_t>(6) * cube.size;
+		std::vector<float> partials(num_rows * SH_PARTIAL_SIZE, 0.0f);
+
+#ifdef EPSILON_IBL_X86
+		bool sse2 = ActiveSIMDLevel() >= SL_SSE2;
+#endif
+		auto project = [&](size_t begin, size_t end)
+		{
+			for (size_t row = begin; row != end; row++)
+			{
+				uint32_t face = static_cast<uint32_t>(row / cube.size);
+				uint32_t y = static_cast<uint32_t>(row % cube.size);
+				float* partial = &partials[row * SH_PARTIAL_SIZE];
+#ifdef EPSILON_IBL_X86
+				if (sse2)
+				{
+					ProjectRowSSE2(cube, face, y, partial);
+					continue;
+				}
+#endif
+				ProjectRowScalar(cube, face, y, partial);
+			}
+		};
+		if (js)
+		{
+			js->ParallelFor(num_rows, IBL_ROW_GRAIN, project);
+		}
+		else
+		{
+			project(0, num_rows);
+		}
+
+		//Summed in row order, the result doesn't depend on how the rows were split
+		double sums[SH_PARTIAL_SIZE] = {};
+		for (size_t row = 0; row != num_rows; row++)
+		{
+			for (uint32_t k = 0; k != SH_PARTIAL_SIZE; k++)
+			{
+				sums[k] += partials[row * SH_PARTIAL_SIZE + k];
+			}
+		}
+
+		//The weights add up to the whole sphere
+		double scale = 4 * IBL_PI / sums[SH_COEFFICIENTS * 3];
+		for (uint32_t i = 0; i != SH_COEFFICIENTS; i++)
+		{
+			for (int c = 0; c != 3; c++)
+			{
+				sh[i][c] = static_cast<float>(sums[i * 3 + c] * scale);
+			}
+		}
+	}
+
+	void ConvolveSH9Irradiance(float sh[SH_COEFFICIENTS][3])
+	{
+		for (uint32_t i = 0; i != SH_COEFFICIENTS; i++)
+		{
+			for (int c = 0; c != 3; c++)
+			{
+				sh[i][c] *= SH_IRRADIANCE_BANDS[i];
+			}
+		}
+	}
+
+	void EvaluateSH9(const float sh[SH_COEFFICIENTS][3], const float dir[3], float rgb[3])
+	{
+		float basis[SH_COEFFICIENTS];
+		SHBasis9(dir, basis);
+
+		for (int c = 0; c != 3; c++)
+		{
+			float sum = 0;
+			for (uint32_t i = 0; i != SH_COEFFICIENTS; i++)
+			{
+				sum += sh[i][c] * basis[i];
+			}
+			rgb[c] = (std::max)(sum, 0.0f);
+		}
+	}
+
+	uint32_t SpecularMipCount(uint32_t size)
+	{
+		uint32_t num_mips = 1;
+		while (size / 2 >= MIN_SPECULAR_MIP_SIZE)
+		{
+			size /= 2;
+			++num_mips;
+		}
+		return num_mips;
+	}
+
+	float SpecularMipRoughness(uint32_t mip, uint32_t num_mips)
+	{
+		return (num_mips > 1) ? static_cast<float>(mip) / (num_mips - 1) : 0.0f;
+	}
+
+	void PrefilterSpecular(const Cubemap& cube, uint32_t num_samples, std::vector<Cubemap>& mips,
+		JobSystem* js /*= nullptr*/)
+	{
+		uint32_t num_mips = SpecularMipCount(cube.size);
+		mips.resize(num_mips);
+
+		//A mirror reflects the environment as it is
+		mips[0] = cube;
+		if (num_mips == 1)
+		{
+			return;
+		}
+
+		//Every mip of the environment down to 1x1, for the samples of wide lobes to read
+		std::vector<Cubemap> levels(1, cube);
+		while (levels.back().size > 1)
+		{
+			Cubemap level;
+			DownsampleCubemap(levels.back(), level);
+			levels.push_back(std::move(level));
+		}
+
+#ifdef EPSILON_IBL_X86
+		bool sse2 = ActiveSIMDLevel() >= SL_SSE2;
+#endif
+		SpecularSamples samples;
+		for (uint32_t mip = 1; mip != num_mips; mip++)
+		{
+			BuildSpecularSamples(SpecularMipRoughness(mip, num_mips), num_samples, cube.size,
+				static_cast<uint32_t>(levels.size()), samples);
+
+			Cubemap& dst = mips[mip];
+			AllocateCubemap((std::max)(cube.size >> mip, 1U), dst);
+			uint32_t size = dst.size;
+
+			auto prefilter = [&](size_t begin, size_t end)
+			{
+				for (size_t row = begin; row != end; row++)
+				{
+					uint32_t face = static_cast<uint32_t>(row / size);
+					uint32_t y = static_cast<uint32_t>(row % size);
+					for (uint32_t x = 0; x != size; x++)
+					{
+						float n[3];
+						CubemapDirection(face, TexelCoord(x, size), TexelCoord(y, size), n);
+						Normalize3(n);
+
+						float* out = &dst.texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+#ifdef EPSILON_IBL_X86
+						if (sse2)
+						{
+							SampleSpecularSSE2(levels, samples, n, out);
+							continue;
+						}
+#endif
+						SampleSpecularScalar(levels, samples, n, out);
+					}
+				}
+			};
+			if (js)
+			{
+				js->ParallelFor(static_cast<size_t>(6) * size, IBL_ROW_GRAIN, prefilter);
+			}
+			else
+			{
+				prefilter(0, static_cast<size_t>(6) * size);
+			}
+		}
+	}
+
+	void ReferenceIrradiance(const Cubemap& cube, const float normal[3], float rgb[3])
+	{
+		uint32_t size = cube.size;
+		double acc[3] = {};
+		double weight_sum = 0;
+		for (uint32_t face = 0; face != 6; face++)
+		{
+			for (uint32_t y = 0; y != size; y++)
+			{
+				for (uint32_t x = 0; x != size; x++)
+				{
+					float u = TexelCoord(x, size);
+					float v = TexelCoord(y, size);
+					float dir[3];
+					CubemapDirection(face, u, v, dir);
+					float inv_len = 1 / std::sqrt(1 + u * u + v * v);
+					float w = inv_len * inv_len * inv_len;
+					weight_sum += w;
+
+					float cos_theta = (dir[0] * normal[0] + dir[1] * normal[1] + dir[2] * normal[2]) * inv_len;
+					if (cos_theta > 0)
+					{
+						const float* t = &cube.texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+						for (int c = 0; c != 3; c++)
+						{
+							acc[c] += t[c] * cos_theta * w;
+						}
+					}
+				}
+			}
+		}
+
+		//Solid angles add up to 4 pi, the Lambertian reflectance divides by pi
+		for (int c = 0; c != 3; c++)
+		{
+			rgb[c] = static_cast<float>(acc[c] * 4 / weight_sum);
+		}
+	}
+
+	void ReferenceSpecular(const Cubemap& cube, const float dir[3], float roughness, float rgb[3])
+	{
+		float n[3] = { dir[0], dir[1], dir[2] };
+		Normalize3(n);
+
+		//The samples' estimate converges to the radiance weighted by n.l and the distribution of their half vectors
+		uint32_t size = cube.size;
+		double acc[3] = {};
+		double weight_sum = 0;
+		for (uint32_t face = 0; face != 6; face++)
+		{
+			for (uint32_t y = 0; y != size; y++)
+			{
+				for (uint32_t x = 0; x != size; x++)
+				{
+					float u = TexelCoord(x, size);
+					float v = TexelCoord(y, size);
+					float l[3];
+					CubemapDirection(face, u, v, l);
+					float inv_len = 1 / std::sqrt(1 + u * u + v * v);
+					l[0] *= inv_len;
+					l[1] *= inv_len;
+					l[2] *= inv_len;
+
+					float n_dot_l = n[0] * l[0] + n[1] * l[1] + n[2] * l[2];
+					if (n_dot_l <= 0)
+					{
+						continue;
+					}
+
+					float h[3] = { n[0] + l[0], n[1] + l[1], n[2] + l[2] };
+					Normalize3(h);
+					float n_dot_h = n[0] * h[0] + n[1] * h[1] + n[2] * h[2];
+
+					double w = static_cast<double>(inv_len * inv_len * inv_len) * n_dot_l * GGXDistribution(n_dot_h, roughness);
+					const float* t = &cube.texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+					for (int c = 0; c != 3; c++)
+					{
+						acc[c] += t[c] * w;
+					}
+					weight_sum += w;
+				}
+			}
+		}
+
+		for (int c = 0; c != 3; c++)
+		{
+			rgb[c] = (weight_sum > 0) ? static_cast<float>(acc[c] / weight_sum) : 0.0f;
+		}
+	}
+
+}
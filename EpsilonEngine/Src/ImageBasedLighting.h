@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	class JobSystem;
+
+	//Load-time processing of the ambient light's environment for the ambient pass of DeferredRendering.fx:
+	//the diffuse irradiance as 9 spherical harmonics and the specular radiance prefiltered with GGX into
+	//the mips of a cubemap. The kernels run at the SIMD level of BatchMath.h, SSE2 working on 4 texels or
+	//samples at a time, and spread over a job system when given one. Reference integrals over every texel
+	//are here for checking both
+
+	//Second-order SH, SH_COEFFICIENTS in the shader
+	const uint32_t SH_COEFFICIENTS = 9;
+
+	//Specular mips stop at this size, the roughest lobes change too slowly to need smaller ones
+	const uint32_t MIN_SPECULAR_MIP_SIZE = 8;
+
+	//Faces in D3D order +X -X +Y -Y +Z -Z, each size x size texels of rgba, row-major
+	struct Cubemap
+	{
+		uint32_t size;
+		std::vector<float> texels;
+	};
+
+	//What the ambient pass reads of an environment besides the specular cube
+	struct EnvironmentLighting
+	{
+		//From ConvolveSH9Irradiance, rgb each
+		float irradiance_sh[SH_COEFFICIENTS][3];
+
+		//Mips of the specular cube, the last one being fully rough
+		uint32_t specular_mips;
+	};
+
+	void AllocateCubemap(uint32_t size, Cubemap& cube);
+
+	//Direction through a face at (u, v) in [-1, 1], v pointing down the face like texel rows. Not normalized
+	void CubemapDirection(uint32_t face, float u, float v, float dir[3]);
+
+	//Bilinear within the face the direction hits, clamped at its edges
+	void SampleCubemap(const Cubemap& cube, const float dir[3], float rgba[4]);
+
+	//Averages 2x2 texels into a cube half the size, rounded down
+	void DownsampleCubemap(const Cubemap& src, Cubemap& dst);
+
+	//The environment when none is loaded: a sky fading from the horizon to the zenith, a sun and a darker ground
+	void BuildSkyCubemap(uint32_t size, Cubemap& cube);
+
+	//Real SH basis up to band 2 of a normalized direction
+	void SHBasis9(const float dir[3], float basis[SH_COEFFICIENTS]);
+
+	//Radiance projected on the basis, each texel weighted by its solid angle
+	void ProjectSH9(const Cubemap& cube, float sh[SH_COEFFICIENTS][3], JobSystem* js = nullptr);
+
+	//Convolves radiance SH with the clamped cosine and divides by pi, so evaluating gives what a white
+	//Lambertian surface reflects
+	void ConvolveSH9Irradiance(float sh[SH_COEFFICIENTS][3]);
+
+	void EvaluateSH9(const float sh[SH_COEFFICIENTS][3], const float dir[3], float rgb[3]);
+
+	uint32_t SpecularMipCount(uint32_t size);
+
+	//Roughness, sqrt of GGX alpha, linear in the mips
+	float SpecularMipRoughness(uint32_t mip, uint32_t num_mips);
+
+	//GGX-prefiltered radiance with the view along the normal, SpecularMipCount(cube.size) cubes halving in
+	//size, the first being the environment itself. Samples are importance sampled and read from a lower
+	//mip of the environment the wider their lobe is
+	void PrefilterSpecular(const Cubemap& cube, uint32_t num_samples, std::vector<Cubemap>& mips,
+		JobSystem* js = nullptr);
+
+	//What the irradiance SH approximates, integrated over every texel
+	void ReferenceIrradiance(const Cubemap& cube, const float normal[3], float rgb[3]);
+
+	//What the prefiltered mips estimate in a direction, integrated over every texel
+	void ReferenceSpecular(const Cubemap& cube, const float dir[3], float roughness, float rgb[3]);
+
+}
@@ -0,0 +1,434 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+
+namespace epsilon
+{
+
+	const uint32_t JOB_DEQUE_CAPACITY = 4096;
+	const uint32_t JOB_SPIN_COUNT = 64;
+
+	thread_local JobSystem* tls_job_system_ = nullptr;
+	thread_local uint32_t tls_worker_index_ = 0;
+	thread_local uint32_t tls_steal_seed_ = 0;
+
+
+	JobSystem::WorkStealingDeque::WorkStealingDeque(uint32_t capacity)
+		: top_(0), bottom_(0), buffer_(new std::atomic<Job*>[capacity]), mask_(capacity - 1)
+	{
+	}
+
+	bool JobSystem::WorkStealingDeque::Push(Job* job)
+	{
+		int64_t b = bottom_.load(std::memory_order_relaxed);
+		int64_t t = top_.load(std::memory_order_acquire);
+		if (b - t > mask_)
+		{
+			return false;
+		}
+
+		buffer_[b & mask_].store(job, std::memory_order_release);
+		bottom_.store(b + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	JobSystem::Job* JobSystem::WorkStealingDeque::Pop()
+	{
+		int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+		bottom_.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top_.load(std::memory_order_relaxed);
+
+		Job* job = nullptr;
+		if (t <= b)
+		{
+			job = buffer_[b & mask_].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				//Last element, race against thieves for it
+				if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				bottom_.store(b + 1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	JobSystem::Job* JobSystem::WorkStealingDeque::Steal()
+	{
+		int64_t t = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom_.load(std::memory_order_acquire);
+
+		Job* job = nullptr;
+		if (t < b)
+		{
+			job = buffer_[t & mask_].load(std::memory_order_acquire);
+			if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				job = nullptr;
+			}
+		}
+
+		return job;
+	}
+
+
+	JobSystem::JobSystem(uint32_t num_workers)
+		: pending_(0), sleeping_(0), quit_(false)
+	{
+		if (num_workers == 0)
+		{
+			num_workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		//Deque 0 belongs to the thread that created the system
+		for (uint32_t i = 0; i != num_workers + 1; i++)
+		{
+			deques_.push_back(std::make_unique<WorkStealingDeque>(JOB_DEQUE_CAPACITY));
+		}
+
+		tls_job_system_ = this;
+		tls_worker_index_ = 0;
+
+		for (uint32_t i = 0; i != num_workers; i++)
+		{
+			workers_.emplace_back(&JobSystem::WorkerMain, this, i + 1);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		quit_.store(true);
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex_);
+		}
+		wake_cv_.notify_all();
+
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+
+		if (tls_job_system_ == this)
+		{
+			tls_job_system_ = nullptr;
+		}
+
+		for (auto job : free_jobs_)
+		{
+			delete job;
+		}
+	}
+
+	void JobSystem::Run(JobFunc func, JobCounter* counter)
+	{
+		Job* job = this->AllocateJob();
+		job->func = std::move(func);
+		job->counter = counter;
+
+		if (counter)
+		{
+			counter->value_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (tls_job_system_ == this)
+		{
+			if (!deques_[tls_worker_index_]->Push(job))
+			{
+				//Deque is full, running inline keeps ordering guarantees trivial
+				this->Execute(job);
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(external_mutex_);
+			external_jobs_.push_back(job);
+		}
+
+		pending_.fetch_add(1);
+		this->Wake();
+	}
+
+	void JobSystem::RunBackground(JobFunc func, JobCounter* counter)
+	{
+		Job* job = this->AllocateJob();
+		job->func = std::move(func);
+		job->counter = counter;
+
+		if (counter)
+		{
+			counter->value_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (workers_.empty())
+		{
+			this->Execute(job);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(background_mutex_);
+			background_jobs_.push_back(job);
+		}
+
+		pending_.fetch_add(1);
+		this->Wake();
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		uint32_t index = (tls_job_system_ == this) ? tls_worker_index_ : (uint32_t)deques_.size();
+
+		while (!counter.Done())
+		{
+			Job* job = this->FindJob(index, false);
+			if (job)
+			{
+				this->Execute(job);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		std::exception_ptr error;
+		if (counter.failed_.load(std::memory_order_relaxed))
+		{
+			//Reset so the counter can be used again
+			std::swap(error, counter.error_);
+			counter.failed_.store(false, std::memory_order_relaxed);
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(error_mutex_);
+			std::swap(error, uncounted_error_);
+		}
+
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t grain, const RangeFunc& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		grain = std::max<size_t>(grain, 1);
+		if (count <= grain || workers_.empty())
+		{
+			func(0, count);
+			return;
+		}
+
+		//Chunk jobs capture two words so they fit in std::function's inline storage
+		struct Range
+		{
+			const RangeFunc* func;
+			size_t grain;
+			size_t count;
+		} range = { &func, grain, count };
+
+		JobCounter counter;
+		for (size_t begin = grain; begin < count; begin += grain)
+		{
+			this->Run([&range, begin]() { (*range.func)(begin, std::min(begin + range.grain, range.count)); }, &counter);
+		}
+
+		std::exception_ptr error;
+		try
+		{
+			func(0, grain);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		//The chunks reference this frame, all of them finish before anything is rethrown. Wait rethrows
+		//the first exception of a chunk job
+		this->Wait(counter);
+
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	uint32_t JobSystem::NumWorkers() const
+	{
+		return (uint32_t)workers_.size();
+	}
+
+	void JobSystem::WorkerMain(uint32_t index)
+	{
+		tls_job_system_ = this;
+		tls_worker_index_ = index;
+		tls_steal_seed_ = index * 2654435761u;
+
+		uint32_t spins = 0;
+		while (!quit_.load(std::memory_order_relaxed))
+		{
+			Job* job = this->FindJob(index, true);
+			if (job)
+			{
+				this->Execute(job);
+				spins = 0;
+			}
+			else if (++spins < JOB_SPIN_COUNT)
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock(wake_mutex_);
+				sleeping_.fetch_add(1);
+				wake_cv_.wait(lock, [this]() { return pending_.load() > 0 || quit_.load(); });
+				sleeping_.fetch_sub(1);
+				spins = 0;
+			}
+		}
+	}
+
+	JobSystem::Job* JobSystem::FindJob(uint32_t index, bool background)
+	{
+		Job* job = nullptr;
+
+		if (index < deques_.size())
+		{
+			job = deques_[index]->Pop();
+		}
+
+		if (!job)
+		{
+			uint32_t num_deques = (uint32_t)deques_.size();
+			tls_steal_seed_ = tls_steal_seed_ * 1664525u + 1013904223u;
+			uint32_t start = tls_steal_seed_ % num_deques;
+			for (uint32_t i = 0; i != num_deques && !job; i++)
+			{
+				uint32_t victim = (start + i) % num_deques;
+				if (victim != index)
+				{
+					job = deques_[victim]->Steal();
+				}
+			}
+		}
+
+		if (!job)
+		{
+			std::lock_guard<std::mutex> lock(external_mutex_);
+			if (!external_jobs_.empty())
+			{
+				job = external_jobs_.front();
+				external_jobs_.pop_front();
+			}
+		}
+
+		if (!job && background)
+		{
+			std::lock_guard<std::mutex> lock(background_mutex_);
+			if (!background_jobs_.empty())
+			{
+				job = background_jobs_.front();
+				background_jobs_.pop_front();
+			}
+		}
+
+		if (job)
+		{
+			pending_.fetch_sub(1);
+		}
+
+		return job;
+	}
+
+	void JobSystem::Execute(Job* job)
+	{
+		//A throwing job still counts as done, or its waiter would spin forever. The exception goes to Wait
+		//rather than unwinding a worker into std::terminate
+		try
+		{
+			job->func();
+		}
+		catch (...)
+		{
+			this->KeepError(job->counter, std::current_exception());
+		}
+		job->func = nullptr;
+
+		if (job->counter)
+		{
+			job->counter->value_.fetch_sub(1, std::memory_order_release);
+		}
+
+		this->FreeJob(job);
+	}
+
+	void JobSystem::KeepError(JobCounter* counter, std::exception_ptr error)
+	{
+		if (counter)
+		{
+			//Only the first one is kept. Its release decrement publishes error_ to the acquiring Wait
+			bool expected = false;
+			if (counter->failed_.compare_exchange_strong(expected, true, std::memory_order_relaxed))
+			{
+				counter->error_ = std::move(error);
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(error_mutex_);
+			if (!uncounted_error_)
+			{
+				uncounted_error_ = std::move(error);
+			}
+		}
+	}
+
+	JobSystem::Job* JobSystem::AllocateJob()
+	{
+		{
+			std::lock_guard<std::mutex> lock(job_pool_mutex_);
+			if (!free_jobs_.empty())
+			{
+				Job* job = free_jobs_.back();
+				free_jobs_.pop_back();
+				return job;
+			}
+		}
+
+		return new Job;
+	}
+
+	void JobSystem::FreeJob(Job* job)
+	{
+		std::lock_guard<std::mutex> lock(job_pool_mutex_);
+		free_jobs_.push_back(job);
+	}
+
+	void JobSystem::Wake()
+	{
+		if (sleeping_.load() > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(wake_mutex_);
+			}
+			wake_cv_.notify_one();
+		}
+	}
+
+}
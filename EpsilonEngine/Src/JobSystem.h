@@ -0,0 +1,123 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	class JobCounter
+	{
+	public:
+		JobCounter() : value_(0), failed_(false) {}
+
+		inline bool Done() const { return value_.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int32_t> value_;
+
+		//First exception thrown by one of the counted jobs, written by whoever sets failed_ before its
+		//decrement and read by Wait once the count is zero
+		std::atomic<bool> failed_;
+		std::exception_ptr error_;
+	};
+
+
+	class JobSystem
+	{
+	public:
+		typedef std::function<void()> JobFunc;
+		typedef std::function<void(size_t begin, size_t end)> RangeFunc;
+
+		//0 workers means one per hardware thread besides the creating one
+		explicit JobSystem(uint32_t num_workers = 0);
+		~JobSystem();
+
+		void Run(JobFunc func, JobCounter* counter = nullptr);
+
+		//Queues a long job that only workers pick up, once they have nothing else to run. Wait never runs it on
+		//the calling thread, so a frame waiting on its own jobs isn't held up behind it. Without workers it
+		//runs right away
+		void RunBackground(JobFunc func, JobCounter* counter = nullptr);
+
+		//Executes pending jobs other than background ones on the calling thread until the counter drops to zero.
+		//Then rethrows the first exception of a job counted by it, or else of a job run without a counter since
+		//the last Wait
+		void Wait(JobCounter& counter);
+
+		void ParallelFor(size_t count, size_t grain, const RangeFunc& func);
+
+		uint32_t NumWorkers() const;
+
+	private:
+		struct Job
+		{
+			JobFunc func;
+			JobCounter* counter;
+		};
+
+		//Chase-Lev deque: the owner pushes and pops at the bottom, thieves steal from the top
+		class WorkStealingDeque
+		{
+		public:
+			explicit WorkStealingDeque(uint32_t capacity);
+
+			bool Push(Job* job);
+			Job* Pop();
+			Job* Steal();
+
+		private:
+			std::atomic<int64_t> top_;
+			std::atomic<int64_t> bottom_;
+			std::unique_ptr<std::atomic<Job*>[]> buffer_;
+			int64_t mask_;
+		};
+
+		void WorkerMain(uint32_t index);
+
+		//Background jobs are only taken when background is set, by workers
+		Job* FindJob(uint32_t index, bool background);
+
+		void Execute(Job* job);
+		void KeepError(JobCounter* counter, std::exception_ptr error);
+
+		//Jobs are recycled so a steady frame loop never reaches the heap
+		Job* AllocateJob();
+		void FreeJob(Job* job);
+
+		void Wake();
+
+	private:
+		std::vector<std::unique_ptr<WorkStealingDeque>> deques_;
+		std::vector<std::thread> workers_;
+
+		std::mutex job_pool_mutex_;
+		std::vector<Job*> free_jobs_;
+
+		std::mutex external_mutex_;
+		std::deque<Job*> external_jobs_;
+
+		std::mutex background_mutex_;
+		std::deque<Job*> background_jobs_;
+
+		std::mutex error_mutex_;
+		std::exception_ptr uncounted_error_;
+
+		std::mutex wake_mutex_;
+		std::condition_variable wake_cv_;
+		std::atomic<int32_t> pending_;
+		std::atomic<int32_t> sleeping_;
+		std::atomic<bool> quit_;
+	};
+
+}
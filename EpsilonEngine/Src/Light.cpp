@@ -1,61 +1,148 @@
 #include "Light.h"
-#include "d3dx11effect.h"
 #include "Camera.h"
+#include "CommandList.h"
+#include "LightBounds.h"
+#include <algorithm>
 
 
 
 namespace epsilon
 {
+	const float SPOT_SHADOW_NEAR_PLANE = 0.5f;
 
-	void AmbientLight::Bind(ID3DX11Effect* d3d_effect, Camera* cam)
+	//A perspective frustum can't open to 180 degrees
+	const float SPOT_SHADOW_MAX_FOV = XM_PI * 0.95f;
+
+	//Point lights dimmer than this are cut off
+	const float POINT_LIGHT_CUTOFF = 1.0f / 1024;
+
+
+	void AmbientLight::Bind(CommandList& cl, Camera* cam, const EnvironmentLighting& env)
 	{
-		auto var_g_light_dir_es = d3d_effect->GetVariableByName("g_light_dir_es")->AsVector();
-		auto var_g_light_color = d3d_effect->GetVariableByName("g_light_color")->AsVector();
+		LightConstants constants = {};
+		constants.light_color = color_;
+
+		//Normals and reflections are looked up in the environment in world space
+		XMStoreFloat4x4(&constants.shadow_mat, cam->view_.Inverse());
+		for (uint32_t i = 0; i != SH_COEFFICIENTS; i++)
+		{
+			const float* sh = env.irradiance_sh[i];
+			constants.ambient_sh[i] = Vector4f(sh[0], sh[1], sh[2], 0);
+		}
+		constants.env_specular_mips = static_cast<float>(env.specular_mips);
+
+		cl.SetConstants(CF_PerLight, constants);
+	}
+
+
+	void DirectionLight::Bind(CommandList& cl, Camera* cam, const ShadowView* shadows, const ShadowCascade* cascades,
+		uint32_t atlas_size)
+	{
+		LightConstants constants = {};
+		constants.light_dir_es = TransformNormal(dir_, cam->view_);
+		constants.light_color = color_;
+
+		if (shadows && cascades)
+		{
+			//The cascades share the light's axes, only their boxes differ
+			const float (&axes)[3][3] = cascades[0].axes;
+			Matrix light_mat(axes[0][0], axes[1][0], axes[2][0], 0,
+				axes[0][1], axes[1][1], axes[2][1], 0,
+				axes[0][2], axes[1][2], axes[2][2], 0,
+				0, 0, 0, 1);
+
+			Matrix shadow_mat;
+			shadow_mat = cam->view_.Inverse() * light_mat;
+
+			constants.shadow_enabled = 1;
+			constants.num_cascades = static_cast<float>(MAX_SHADOW_CASCADES);
+			XMStoreFloat4x4(&constants.shadow_mat, shadow_mat);
+
+			for (uint32_t i = 0; i != MAX_SHADOW_CASCADES; i++)
+			{
+				if (0 == shadows[i].page.size)
+				{
+					//An empty rectangle, no position picks a cascade without a page
+					constants.cascade_uv_clamp[i] = Vector4f(1, 1, 0, 0);
+					continue;
+				}
 
-		Vector3f light_dir(0, 1, 0);
-		light_dir = TransformNormal(light_dir, cam->view_);
+				CascadeScaleOffset(cascades[i], shadows[i].page, atlas_size,
+					&constants.cascade_scale[i].x, &constants.cascade_offset[i].x);
+				ShadowPageUVClamp(shadows[i].page, atlas_size, &constants.cascade_uv_clamp[i].x);
+			}
+		}
 
-		var_g_light_dir_es->SetFloatVector((float*)&light_dir);
-		var_g_light_color->SetFloatVector((float*)&color_);
+		cl.SetConstants(CF_PerLight, constants);
 	}
 
 
-	void DirectionLight::Bind(ID3DX11Effect* d3d_effect, Camera* cam)
+	void SpotLight::Pack(LightPacker& packer, Camera* cam, const ShadowView& shadow, uint32_t atlas_size) const
 	{
-		auto var_g_light_dir_es = d3d_effect->GetVariableByName("g_light_dir_es")->AsVector();
-		auto var_g_light_color = d3d_effect->GetVariableByName("g_light_color")->AsVector();
+		//The shading fades from the narrower angle out to the wider
+		Vector3f dir = Normalize(dir_);
+		float outer_ang = this->OuterAngle();
+		float inner_ang = (std::min)(inner_ang_, outter_ang_);
 
-		Vector3f light_dir = TransformNormal(dir_, cam->view_);
+		Vector3f center;
+		float radius;
+		SpotLightBoundingSphere(&pos_.x, &dir.x, range_, outer_ang, &center.x, radius);
 
-		var_g_light_dir_es->SetFloatVector((float*)&light_dir);
-		var_g_light_color->SetFloatVector((float*)&color_);
+		uint32_t light = packer.Add(&pos_.x, &dir.x, range_, cos(outer_ang), cos(inner_ang),
+			&color_.x, &falloff_.x, &center.x, radius);
+
+		if (shadow.page.size > 0)
+		{
+			//Clip space of the light to the page's corner of the atlas, before the divide by w
+			float so[4];
+			ShadowPageScaleOffset(shadow.page, atlas_size, so);
+			Matrix page_mat(so[0], 0, 0, 0,
+				0, so[1], 0, 0,
+				0, 0, 1, 0,
+				so[2], so[3], 0, 1);
+
+			Matrix shadow_mat;
+			shadow_mat = cam->view_.Inverse() * XMLoadFloat4x4(&shadow.view_proj) * page_mat;
+
+			XMFLOAT4X4 mat;
+			XMStoreFloat4x4(&mat, shadow_mat);
+			float uv_clamp[4];
+			ShadowPageUVClamp(shadow.page, atlas_size, uv_clamp);
+			packer.SetShadow(light, &mat._11, uv_clamp);
+		}
 	}
 
+	float SpotLight::OuterAngle() const
+	{
+		return (std::max)(inner_ang_, outter_ang_);
+	}
+
+	void SpotLight::ShadowMatrices(Matrix& view, Matrix& proj) const
+	{
+		Vector3f up(0, 1, 0);
+		if (std::abs(dir_.y) > 0.99f * Length(dir_))
+		{
+			up = Vector3f(1, 0, 0);
+		}
+		view = XMMatrixLookToLH(pos_.XMV(), dir_.XMV(), up.XMV());
+
+		float fov = (std::min)(this->OuterAngle() * 2, SPOT_SHADOW_MAX_FOV);
+		proj = XMMatrixPerspectiveFovLH(fov, 1, SPOT_SHADOW_NEAR_PLANE, range_);
+	}
+
+
+	float PointLight::EffectiveRange() const
+	{
+		float intensity = (std::max)((std::max)(color_.x, color_.y), color_.z);
+		return (std::min)(range_, AttenuationCutoff(&falloff_.x, intensity, POINT_LIGHT_CUTOFF));
+	}
 
-	void SpotLight::Bind(ID3DX11Effect* d3d_effect, Camera* cam)
+	void PointLight::Pack(LightPacker& packer) const
 	{
-		auto var_g_light_pos_es = d3d_effect->GetVariableByName("g_light_pos_es")->AsVector();
-		auto var_g_light_dir_es = d3d_effect->GetVariableByName("g_light_dir_es")->AsVector();
-		auto var_g_light_color = d3d_effect->GetVariableByName("g_light_color")->AsVector();
-		auto var_g_light_falloff_range = d3d_effect->GetVariableByName("g_light_falloff_range")->AsVector();
-		auto var_g_spot_light_cos_cone = d3d_effect->GetVariableByName("g_spot_light_cos_cone")->AsVector();
-
-		Vector3f light_pos = TransformCoord(pos_, cam->view_);
-		Vector3f light_dir = TransformNormal(dir_, cam->view_);
-		Vector2f cos_cone;
-		cos_cone.x = cos(inner_ang_);
-		cos_cone.y = cos(outter_ang_);
-		Vector4f falloff_range;
-		falloff_range.x = falloff_.x;
-		falloff_range.y = falloff_.y;
-		falloff_range.z = falloff_.z;
-		falloff_range.w = range_;
-
-		var_g_light_pos_es->SetFloatVector((float*)&light_pos);
-		var_g_light_dir_es->SetFloatVector((float*)&light_dir);
-		var_g_light_color->SetFloatVector((float*)&color_);
-		var_g_light_falloff_range->SetFloatVector((float*)&falloff_range);
-		var_g_spot_light_cos_cone->SetFloatVector((float*)&cos_cone);
+		//A cone wider than every direction, so nothing is cut off by it
+		const float dir[3] = { 0, 0, 1 };
+		float range = this->EffectiveRange();
+		packer.Add(&pos_.x, dir, range, -2, -1, &color_.x, &falloff_.x, &pos_.x, range);
 	}
 
 }
\ No newline at end of file
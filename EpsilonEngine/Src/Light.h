@@ -2,6 +2,11 @@
 #include "Utils.h"
 #include "D3D11Predeclare.h"
 #include "RSPredeclare.h"
+#include "ShaderConstants.h"
+#include "ShadowAtlas.h"
+#include "CascadedShadow.h"
+#include "LightPacker.h"
+#include "ImageBasedLighting.h"
 
 
 namespace epsilon
@@ -10,16 +15,33 @@ namespace epsilon
 	class AmbientLight
 	{
 	public:
-		void Bind(ID3DX11Effect* d3d_effect, Camera* cam);
+		void Bind(CommandList& cl, Camera* cam, const EnvironmentLighting& env);
 
+		//Scales the environment's lighting
 		Vector3f color_;
 	};
 
 
+	//A light's view into the shadow atlas for one frame, decided by the update stage
+	struct ShadowView
+	{
+		ShadowPage page;
+		bool render;
+
+		XMFLOAT4X4 view_proj;
+
+		//Casters to draw when the page renders, a range of FramePacket::shadow_casters
+		uint32_t first_caster;
+		uint32_t num_casters;
+	};
+
+
 	class DirectionLight
 	{
 	public:
-		void Bind(ID3DX11Effect* d3d_effect, Camera* cam);
+		//MAX_SHADOW_CASCADES views and their projections, or none for an unshadowed light
+		void Bind(CommandList& cl, Camera* cam, const ShadowView* shadows, const ShadowCascade* cascades,
+			uint32_t atlas_size);
 
 		Vector3f dir_;
 		Vector3f color_;
@@ -29,7 +51,14 @@ namespace epsilon
 	class SpotLight
 	{
 	public:
-		void Bind(ID3DX11Effect* d3d_effect, Camera* cam);
+		//A shadow without a page leaves the light unshadowed
+		void Pack(LightPacker& packer, Camera* cam, const ShadowView& shadow, uint32_t atlas_size) const;
+
+		//The wider of the two cone angles, where the light ends
+		float OuterAngle() const;
+
+		//Perspective frustum through the cone, from a small near plane out to the range
+		void ShadowMatrices(Matrix& view, Matrix& proj) const;
 
 		Vector3f pos_;
 		Vector3f dir_;
@@ -40,4 +69,19 @@ namespace epsilon
 		float outter_ang_;
 	};
 
+
+	class PointLight
+	{
+	public:
+		//Where the shading stops: the range, or closer where the attenuated light is too dim to see
+		float EffectiveRange() const;
+
+		void Pack(LightPacker& packer) const;
+
+		Vector3f pos_;
+		Vector3f color_;
+		Vector3f falloff_;
+		float range_;
+	};
+
 }
\ No newline at end of file
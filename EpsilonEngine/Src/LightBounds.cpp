@@ -0,0 +1,84 @@
+#include "LightBounds.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace epsilon
+{
+	//Projected extent of a circle on one screen axis, c is the center's (axis, depth) in view space
+	void CircleScreenBounds(float cx, float cz, float radius, float proj, float& min_ndc, float& max_ndc)
+	{
+		//The two tangents from the eye are the center's direction turned by +-asin(radius / len)
+		float len2 = cx * cx + cz * cz;
+		float len = std::sqrt(len2);
+		float cos_t = std::sqrt(len2 - radius * radius) / len;
+		float sin_t = radius / len;
+
+		float ux = cos_t * cx - sin_t * cz;
+		float uz = sin_t * cx + cos_t * cz;
+		float lx = cos_t * cx + sin_t * cz;
+		float lz = -sin_t * cx + cos_t * cz;
+
+		float u = ux / uz * proj;
+		float l = lx / lz * proj;
+		min_ndc = (std::min)(u, l);
+		max_ndc = (std::max)(u, l);
+	}
+
+
+	float AttenuationTerm(const float falloff[3], float dist)
+	{
+		return 1 / (falloff[0] + falloff[1] * dist + falloff[2] * dist * dist);
+	}
+
+	float AttenuationCutoff(const float falloff[3], float intensity, float threshold)
+	{
+		//intensity * AttenuationTerm(d) == threshold where falloff . (1, d, d^2) == k
+		float k = intensity / threshold;
+		if (falloff[0] >= k)
+		{
+			return 0;
+		}
+
+		if (falloff[2] > 0)
+		{
+			float b = falloff[1];
+			float disc = b * b - 4 * falloff[2] * (falloff[0] - k);
+			return (-b + std::sqrt(disc)) / (2 * falloff[2]);
+		}
+		if (falloff[1] > 0)
+		{
+			return (k - falloff[0]) / falloff[1];
+		}
+		return std::numeric_limits<float>::infinity();
+	}
+
+	bool SphereScreenRect(const float center[3], float radius, float near_plane, float proj_x, float proj_y,
+		float rect[4])
+	{
+		if (center[2] + radius <= near_plane)
+		{
+			return false;
+		}
+
+		if (center[2] - radius <= near_plane)
+		{
+			rect[0] = -1;
+			rect[1] = -1;
+			rect[2] = 1;
+			rect[3] = 1;
+			return true;
+		}
+
+		CircleScreenBounds(center[0], center[2], radius, proj_x, rect[0], rect[2]);
+		CircleScreenBounds(center[1], center[2], radius, proj_y, rect[1], rect[3]);
+
+		for (int i = 0; i != 4; i++)
+		{
+			rect[i] = (std::min)((std::max)(rect[i], -1.0f), 1.0f);
+		}
+		return (rect[0] < rect[2]) && (rect[1] < rect[3]);
+	}
+
+}
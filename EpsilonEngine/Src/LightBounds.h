@@ -0,0 +1,20 @@
+#pragma once
+
+
+namespace epsilon
+{
+
+	//1 / (constant + linear * dist + quadratic * dist^2), the AttenuationTerm of DeferredRendering.fx
+	float AttenuationTerm(const float falloff[3], float dist);
+
+	//Distance from which a light of the given peak intensity, attenuated by falloff, stays below threshold.
+	//0 when it never reaches the threshold, infinite when it never falls below it
+	float AttenuationCutoff(const float falloff[3], float intensity, float threshold);
+
+	//NDC rectangle (min x, min y, max x, max y) covering a view-space sphere, clamped to the screen.
+	//proj_x and proj_y are the projection's x and y scales. A sphere reaching the near plane gets the
+	//whole screen. Returns false when no pixel can be covered
+	bool SphereScreenRect(const float center[3], float radius, float near_plane, float proj_x, float proj_y,
+		float rect[4]);
+
+}
@@ -0,0 +1,97 @@
+#include "LightBuffer.h"
+#include "RenderEngine.h"
+#include <d3d11.h>
+#include <algorithm>
+#include "RenderStatistics.h"
+#include "MemoryTracker.h"
+
+
+namespace epsilon
+{
+	const uint32_t MIN_LIGHT_CAPACITY = 64;
+
+
+	LightBuffer::LightBuffer()
+	{
+		capacity_ = 0;
+	}
+
+	LightBuffer::~LightBuffer()
+	{
+		this->Destory();
+	}
+
+	void LightBuffer::Create(uint32_t capacity)
+	{
+		d3d_srv_.reset();
+		d3d_buffer_.reset();
+
+		D3D11_BUFFER_DESC buffer_desc;
+		buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+		buffer_desc.ByteWidth = capacity * sizeof(PackedLight);
+		buffer_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		buffer_desc.CPUAccessFlags = 0;
+		buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		buffer_desc.StructureByteStride = sizeof(PackedLight);
+
+		ID3D11Buffer* d3d_buffer = nullptr;
+		THROW_FAILED(re_->D3DDevice()->CreateBuffer(&buffer_desc, nullptr, &d3d_buffer));
+		d3d_buffer_ = MakeTrackedCOMPtr(d3d_buffer, MC_StructuredBuffer, buffer_desc.ByteWidth);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC d3d_srv_desc;
+		d3d_srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+		d3d_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		d3d_srv_desc.Buffer.FirstElement = 0;
+		d3d_srv_desc.Buffer.NumElements = capacity;
+
+		ID3D11ShaderResourceView* d3d_srv = nullptr;
+		THROW_FAILED(re_->D3DDevice()->CreateShaderResourceView(d3d_buffer, &d3d_srv_desc, &d3d_srv));
+		d3d_srv_ = MakeCOMPtr(d3d_srv);
+
+		capacity_ = capacity;
+	}
+
+	void LightBuffer::Destory()
+	{
+		d3d_srv_.reset();
+		d3d_buffer_.reset();
+		capacity_ = 0;
+	}
+
+	void LightBuffer::Upload(ID3D11DeviceContext* ctx, const LightPacker& packer)
+	{
+		uint32_t num_lights = static_cast<uint32_t>(packer.NumLights());
+
+		//A new buffer starts out empty, so everything goes up
+		if (num_lights > capacity_)
+		{
+			uint32_t capacity = (std::max)(capacity_, MIN_LIGHT_CAPACITY);
+			while (capacity < num_lights)
+			{
+				capacity *= 2;
+			}
+			this->Create(capacity);
+
+			D3D11_BOX box = { 0, 0, 0, num_lights * static_cast<UINT>(sizeof(PackedLight)), 1, 1 };
+			ctx->UpdateSubresource(d3d_buffer_.get(), 0, &box, packer.Lights(), 0, 0);
+			RenderStatistics::Add(SC_BytesUploaded, box.right);
+			RenderStatistics::Add(SC_LightBufferBytes, box.right);
+			return;
+		}
+
+		for (const auto& range : packer.DirtyRanges())
+		{
+			D3D11_BOX box = { range.first * static_cast<UINT>(sizeof(PackedLight)), 0, 0,
+				(range.first + range.count) * static_cast<UINT>(sizeof(PackedLight)), 1, 1 };
+			ctx->UpdateSubresource(d3d_buffer_.get(), 0, &box, packer.Lights() + range.first, 0, 0);
+			RenderStatistics::Add(SC_BytesUploaded, box.right - box.left);
+			RenderStatistics::Add(SC_LightBufferBytes, box.right - box.left);
+		}
+	}
+
+	ID3D11ShaderResourceView* LightBuffer::D3DShaderResourceView()
+	{
+		return d3d_srv_.get();
+	}
+
+}
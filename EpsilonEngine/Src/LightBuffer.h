@@ -0,0 +1,36 @@
+#pragma once
+#include "Utils.h"
+#include "D3D11Predeclare.h"
+#include "RSPredeclare.h"
+#include "LightPacker.h"
+
+
+namespace epsilon
+{
+
+	//Structured buffer of the packed lights, read by the lighting pass in one loop
+	class LightBuffer
+	{
+	public:
+		LightBuffer();
+		virtual ~LightBuffer();
+
+		INTERFACE_SET_RE;
+
+		void Destory();
+
+		//Uploads the lights the packer found changed, or all of them when the buffer had to grow
+		void Upload(ID3D11DeviceContext* ctx, const LightPacker& packer);
+
+		ID3D11ShaderResourceView* D3DShaderResourceView();
+
+	private:
+		void Create(uint32_t capacity);
+
+	private:
+		ID3D11BufferPtr d3d_buffer_;
+		ID3D11ShaderResourceViewPtr d3d_srv_;
+		uint32_t capacity_;
+	};
+
+}
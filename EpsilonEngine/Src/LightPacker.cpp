@@ -0,0 +1,134 @@
+#include "LightPacker.h"
+#include "BatchMath.h"
+#include "LightBounds.h"
+#include <cstring>
+
+
+namespace epsilon
+{
+	//Clean lights between two dirty runs that are uploaded anyway to save an upload call
+	const uint32_t DIRTY_MERGE_GAP = 4;
+
+
+	LightPacker::LightPacker()
+		: num_dirty_(0)
+	{
+	}
+
+	void LightPacker::Clear()
+	{
+		params_.clear();
+		pos_ws_.clear();
+		dir_ws_.clear();
+		bound_ws_.clear();
+	}
+
+	uint32_t LightPacker::Add(const float pos[3], const float dir[3], float range, float cos_outer, float cos_inner,
+		const float color[3], const float falloff[3], const float bound_center[3], float bound_radius)
+	{
+		LightParams params = {};
+		params.range = range;
+		params.cos_outer = cos_outer;
+		params.cos_inner = cos_inner;
+		memcpy(params.color, color, sizeof(params.color));
+		memcpy(params.falloff, falloff, sizeof(params.falloff));
+		params.bound_radius = bound_radius;
+		params_.push_back(params);
+
+		pos_ws_.insert(pos_ws_.end(), pos, pos + 3);
+		dir_ws_.insert(dir_ws_.end(), dir, dir + 3);
+		bound_ws_.insert(bound_ws_.end(), bound_center, bound_center + 3);
+
+		return static_cast<uint32_t>(params_.size() - 1);
+	}
+
+	void LightPacker::SetShadow(uint32_t light, const float shadow_mat[16], const float shadow_uv_clamp[4])
+	{
+		LightParams& params = params_[light];
+		params.shadow_enabled = true;
+		memcpy(params.shadow_mat, shadow_mat, sizeof(params.shadow_mat));
+		memcpy(params.shadow_uv_clamp, shadow_uv_clamp, sizeof(params.shadow_uv_clamp));
+	}
+
+	void LightPacker::Pack(const float view_mat[16], float near_plane, float proj_x, float proj_y)
+	{
+		size_t n = params_.size();
+
+		pos_vs_.resize(n * 3);
+		dir_vs_.resize(n * 3);
+		bound_vs_.resize(n * 3);
+		TransformCoords(view_mat, pos_ws_.data(), pos_vs_.data(), n);
+		TransformNormals(view_mat, dir_ws_.data(), dir_vs_.data(), n);
+		TransformCoords(view_mat, bound_ws_.data(), bound_vs_.data(), n);
+
+		size_t num_prev = packed_.size();
+		packed_.resize(n);
+		dirty_.clear();
+		num_dirty_ = 0;
+
+		for (size_t i = 0; i != n; i++)
+		{
+			const LightParams& params = params_[i];
+
+			PackedLight light;
+			memcpy(light.pos_es, &pos_vs_[i * 3], sizeof(light.pos_es));
+			light.range = params.range;
+			memcpy(light.dir_es, &dir_vs_[i * 3], sizeof(light.dir_es));
+			light.cos_outer = params.cos_outer;
+			memcpy(light.color, params.color, sizeof(light.color));
+			light.cos_inner = params.cos_inner;
+			memcpy(light.falloff, params.falloff, sizeof(light.falloff));
+			light.shadow_enabled = params.shadow_enabled ? 1.0f : 0.0f;
+			memcpy(light.shadow_mat, params.shadow_mat, sizeof(light.shadow_mat));
+			memcpy(light.shadow_uv_clamp, params.shadow_uv_clamp, sizeof(light.shadow_uv_clamp));
+
+			if (!SphereScreenRect(&bound_vs_[i * 3], params.bound_radius, near_plane, proj_x, proj_y, light.screen_rect))
+			{
+				light.screen_rect[0] = 1;
+				light.screen_rect[1] = 1;
+				light.screen_rect[2] = -1;
+				light.screen_rect[3] = -1;
+			}
+
+			if ((i < num_prev) && (0 == memcmp(&light, &packed_[i], sizeof(light))))
+			{
+				continue;
+			}
+
+			packed_[i] = light;
+			++num_dirty_;
+
+			uint32_t index = static_cast<uint32_t>(i);
+			if (!dirty_.empty() && (dirty_.back().first + dirty_.back().count + DIRTY_MERGE_GAP >= index))
+			{
+				dirty_.back().count = index + 1 - dirty_.back().first;
+			}
+			else
+			{
+				LightRange range = { index, 1 };
+				dirty_.push_back(range);
+			}
+		}
+	}
+
+	size_t LightPacker::NumLights() const
+	{
+		return packed_.size();
+	}
+
+	const PackedLight* LightPacker::Lights() const
+	{
+		return packed_.data();
+	}
+
+	const std::vector<LightRange>& LightPacker::DirtyRanges() const
+	{
+		return dirty_;
+	}
+
+	uint32_t LightPacker::NumDirtyLights() const
+	{
+		return num_dirty_;
+	}
+
+}
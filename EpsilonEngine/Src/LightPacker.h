@@ -0,0 +1,98 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//A spot or point light as the lighting pass reads it from its structured buffer, the PACKED_LIGHT
+	//of DeferredRendering.fx. Point lights have a cone wider than every direction
+	struct PackedLight
+	{
+		float pos_es[3];
+		float range;
+		float dir_es[3];
+		float cos_outer;
+		float color[3];
+		float cos_inner;
+		float falloff[3];
+		float shadow_enabled;
+
+		//NDC rectangle of the light's bounding sphere, empty when it covers no pixel
+		float screen_rect[4];
+
+		//View space to the shadow page's atlas uv and depth
+		float shadow_mat[16];
+		float shadow_uv_clamp[4];
+	};
+
+
+	//Run of lights, in elements of the structured buffer
+	struct LightRange
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+
+	//Collects a frame's lights in world space and packs them in view space. Positions, directions and
+	//bounds are kept as arrays of xyz so the view transform runs in a batch. The packed lights of the
+	//previous frame are kept to find the ones that changed, only those need uploading
+	class LightPacker
+	{
+	public:
+		LightPacker();
+
+		//Starts a new frame's lights, the packed ones of the last frame are kept for comparison
+		void Clear();
+
+		//bound is a world-space sphere around everything the light reaches. Returns the light's index
+		uint32_t Add(const float pos[3], const float dir[3], float range, float cos_outer, float cos_inner,
+			const float color[3], const float falloff[3], const float bound_center[3], float bound_radius);
+
+		//shadow_mat already goes from view space, as it depends on the camera and the shadow page
+		void SetShadow(uint32_t light, const float shadow_mat[16], const float shadow_uv_clamp[4]);
+
+		//view_mat is row-major for row vectors, proj_x and proj_y the projection's x and y scales
+		void Pack(const float view_mat[16], float near_plane, float proj_x, float proj_y);
+
+		size_t NumLights() const;
+		const PackedLight* Lights() const;
+
+		//Lights that differ from the previous Pack, runs closer than a few lights are merged
+		//since every upload has a fixed cost
+		const std::vector<LightRange>& DirtyRanges() const;
+		uint32_t NumDirtyLights() const;
+
+	private:
+		//What stays in world space or doesn't need transforming
+		struct LightParams
+		{
+			float range;
+			float cos_outer;
+			float cos_inner;
+			float color[3];
+			float falloff[3];
+			float bound_radius;
+			bool shadow_enabled;
+			float shadow_mat[16];
+			float shadow_uv_clamp[4];
+		};
+
+		std::vector<LightParams> params_;
+		std::vector<float> pos_ws_;
+		std::vector<float> dir_ws_;
+		std::vector<float> bound_ws_;
+
+		std::vector<float> pos_vs_;
+		std::vector<float> dir_vs_;
+		std::vector<float> bound_vs_;
+
+		std::vector<PackedLight> packed_;
+		std::vector<LightRange> dirty_;
+		uint32_t num_dirty_;
+	};
+
+}
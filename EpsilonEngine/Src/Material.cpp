@@ -0,0 +1,189 @@
+#include "Material.h"
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <d3d11_2.h>
+#include "RenderEngine.h"
+#include "ConstantBufferRing.h"
+#include "CommandStream.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "DDSTextureLoader\DDSTextureLoader.h"
+#include <cstring>
+
+
+namespace epsilon
+{
+
+	MaterialConstants DefaultMaterialConstants()
+	{
+		MaterialConstants constants = {};
+		constants.albedo_clr = Vector3f(0.58f, 0.58f, 0.58f);
+		constants.metalness_clr = Vector2f(0.02f, 0);
+		constants.glossiness_clr = Vector2f(0.04f, 0);
+		return constants;
+	}
+
+	MaterialConstants MakeMaterialConstants(const MaterialDesc& desc, const bool has_maps[MM_NumMaps])
+	{
+		MaterialConstants constants = {};
+		constants.albedo_clr = Vector3f(desc.albedo[0], desc.albedo[1], desc.albedo[2]);
+		constants.albedo_map_enabled = has_maps[MM_Albedo] ? 1 : 0;
+		constants.metalness_clr = Vector2f(desc.metalness, has_maps[MM_Metalness] ? 1.0f : 0.0f);
+		constants.glossiness_clr = Vector2f(desc.glossiness, has_maps[MM_SpecGloss] ? 1.0f : 0.0f);
+		constants.normal_map_enabled = has_maps[MM_Normal] ? 1 : 0;
+		return constants;
+	}
+
+	void CreateMaterials(RenderEngine& re, const std::vector<MaterialDesc>& descs, std::vector<MaterialPtr>& materials)
+	{
+		materials.clear();
+		if (descs.empty())
+		{
+			return;
+		}
+
+		std::vector<std::string> textures;
+		std::vector<int32_t> map_textures;
+		CollectMaterialTextures(descs, textures, map_textures);
+
+		std::vector<ID3D11ResourcePtr> d3d_texs(textures.size());
+		std::vector<ID3D11ShaderResourceViewPtr> d3d_srvs(textures.size());
+		re.Jobs().ParallelFor(textures.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i != end; i++)
+			{
+				std::wstring wfile_path = ToWstring(textures[i]);
+
+				ID3D11Resource* d3d_tex_res = nullptr;
+				ID3D11ShaderResourceView* d3d_tex_srv = nullptr;
+				if (SUCCEEDED(CreateDDSTextureFromFile(re.D3DDevice(), wfile_path.c_str(), &d3d_tex_res, &d3d_tex_srv)))
+				{
+					d3d_texs[i] = MakeTrackedCOMPtr(d3d_tex_res, MC_Texture, re.D3DTextureSize(d3d_tex_res));
+					d3d_srvs[i] = MakeCOMPtr(d3d_tex_srv);
+				}
+			}
+		});
+
+		//One slice per material, at the alignment offset binding needs
+		uint32_t stride = ConstantBufferRing::NumConstants(sizeof(MaterialConstants)) * 16;
+		std::vector<uint8_t, TrackedAllocator<uint8_t, MC_Staging>> cb_data(descs.size() * stride, 0);
+
+		std::vector<MaterialDesc> loaded(descs);
+		std::vector<std::array<ID3D11ResourcePtr, MM_NumMaps>> mtl_texs(descs.size());
+		std::vector<std::array<ID3D11ShaderResourceViewPtr, MM_NumMaps>> mtl_srvs(descs.size());
+		for (size_t i = 0; i != descs.size(); i++)
+		{
+			bool has_maps[MM_NumMaps];
+			for (int m = 0; m != MM_NumMaps; m++)
+			{
+				int32_t tex = map_textures[i * MM_NumMaps + m];
+				has_maps[m] = (tex >= 0) && d3d_srvs[tex];
+				if (has_maps[m])
+				{
+					mtl_texs[i][m] = d3d_texs[tex];
+					mtl_srvs[i][m] = d3d_srvs[tex];
+				}
+				else
+				{
+					loaded[i].maps[m].clear();
+				}
+			}
+			DerivePBRParameters(loaded[i]);
+
+			MaterialConstants constants = MakeMaterialConstants(loaded[i], has_maps);
+			memcpy(&cb_data[i * stride], &constants, sizeof(constants));
+		}
+
+		D3D11_BUFFER_DESC buffer_desc;
+		buffer_desc.Usage = D3D11_USAGE_IMMUTABLE;
+		buffer_desc.ByteWidth = static_cast<UINT>(cb_data.size());
+		buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		buffer_desc.CPUAccessFlags = 0;
+		buffer_desc.MiscFlags = 0;
+		buffer_desc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA buffer_data;
+		buffer_data.pSysMem = cb_data.data();
+		buffer_data.SysMemPitch = 0;
+		buffer_data.SysMemSlicePitch = 0;
+
+		ID3D11Buffer* d3d_buffer = nullptr;
+		THROW_FAILED(re.D3DDevice()->CreateBuffer(&buffer_desc, &buffer_data, &d3d_buffer));
+		ID3D11BufferPtr d3d_cb = MakeTrackedCOMPtr(d3d_buffer, MC_ConstantBuffer, buffer_desc.ByteWidth);
+
+		materials.resize(descs.size());
+		for (size_t i = 0; i != descs.size(); i++)
+		{
+			materials[i] = std::make_shared<Material>();
+			materials[i]->Create(loaded[i], mtl_texs[i], mtl_srvs[i], d3d_cb, static_cast<uint32_t>(i * stride / 16));
+		}
+	}
+
+
+	Material::Material()
+		: first_constant_(0), constants_(DefaultMaterialConstants())
+	{
+	}
+
+	Material::~Material()
+	{
+		this->Destory();
+	}
+
+	void Material::Create(const MaterialDesc& desc,
+		const std::array<ID3D11ResourcePtr, MM_NumMaps>& d3d_texs,
+		const std::array<ID3D11ShaderResourceViewPtr, MM_NumMaps>& d3d_srvs,
+		ID3D11BufferPtr d3d_cb, uint32_t first_constant)
+	{
+		name_ = desc.name;
+		d3d_texs_ = d3d_texs;
+		d3d_srvs_ = d3d_srvs;
+		d3d_cb_ = d3d_cb;
+		first_constant_ = first_constant;
+
+		bool has_maps[MM_NumMaps];
+		for (int m = 0; m != MM_NumMaps; m++)
+		{
+			has_maps[m] = d3d_srvs_[m] ? true : false;
+		}
+		constants_ = MakeMaterialConstants(desc, has_maps);
+	}
+
+	void Material::Destory()
+	{
+		for (auto& srv : d3d_srvs_)
+		{
+			srv.reset();
+		}
+		for (auto& tex : d3d_texs_)
+		{
+			tex.reset();
+		}
+		d3d_cb_.reset();
+	}
+
+	const std::string& Material::Name() const
+	{
+		return name_;
+	}
+
+	const MaterialConstants& Material::Constants() const
+	{
+		return constants_;
+	}
+
+	void Material::Bind(CommandStream& cs)
+	{
+		//Slots it has no map in keep the previous material's, the constants say not to sample them
+		for (uint32_t m = 0; m != MM_NumMaps; m++)
+		{
+			if (d3d_srvs_[m])
+			{
+				cs.SetTexture(m, d3d_srvs_[m].get());
+			}
+		}
+
+		cs.SetStaticConstants(CF_PerMaterial, d3d_cb_.get(), first_constant_, constants_);
+	}
+
+}
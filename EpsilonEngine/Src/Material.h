@@ -0,0 +1,59 @@
+#pragma once
+#include "D3D11Predeclare.h"
+#include "RSPredeclare.h"
+#include "Utils.h"
+#include "ShaderConstants.h"
+#include "MaterialParser.h"
+#include <array>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//A surface shared by the meshes using it: its maps, each loaded once for every material, and its
+	//constants, a slice of one buffer holding all materials created together
+	class Material
+	{
+	public:
+		Material();
+		virtual ~Material();
+
+		void Create(const MaterialDesc& desc,
+			const std::array<ID3D11ResourcePtr, MM_NumMaps>& d3d_texs,
+			const std::array<ID3D11ShaderResourceViewPtr, MM_NumMaps>& d3d_srvs,
+			ID3D11BufferPtr d3d_cb, uint32_t first_constant);
+
+		void Destory();
+
+		const std::string& Name() const;
+
+		const MaterialConstants& Constants() const;
+
+		//Records setting the maps it has and binding its constants for the following draws
+		void Bind(CommandStream& cs);
+
+	private:
+		std::string name_;
+
+		std::array<ID3D11ResourcePtr, MM_NumMaps> d3d_texs_;
+		std::array<ID3D11ShaderResourceViewPtr, MM_NumMaps> d3d_srvs_;
+
+		ID3D11BufferPtr d3d_cb_;
+		uint32_t first_constant_;
+
+		MaterialConstants constants_;
+	};
+
+
+	//Grey and matte, for meshes without a material
+	MaterialConstants DefaultMaterialConstants();
+
+	//The constants of a material, the maps it has being enabled
+	MaterialConstants MakeMaterialConstants(const MaterialDesc& desc, const bool has_maps[MM_NumMaps]);
+
+	//Materials for the descs, in order, sharing their textures and one immutable buffer of constants.
+	//Textures load on the job system, a map that fails to load is left out and its parameter derived again
+	void CreateMaterials(RenderEngine& re, const std::vector<MaterialDesc>& descs, std::vector<MaterialPtr>& materials);
+
+}
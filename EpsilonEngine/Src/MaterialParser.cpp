@@ -0,0 +1,428 @@
+#include "MaterialParser.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+
+namespace epsilon
+{
+	//Suffixes of albedo maps whose spec-gloss map is <name>_spec
+	const char* ALBEDO_MAP_SUFFIXES[] = { "_diff", "_dif" };
+	const char* SPEC_GLOSS_MAP_SUFFIX = "_spec";
+
+
+	std::string ToLower(std::string s)
+	{
+		std::transform(s.begin(), s.end(), s.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		return s;
+	}
+
+	bool EndsWith(const std::string& s, const std::string& suffix)
+	{
+		return (s.size() >= suffix.size()) && (0 == s.compare(s.size() - suffix.size(), suffix.size(), suffix));
+	}
+
+	void ReadColor(std::istringstream& ss, float clr[3])
+	{
+		//A single value is grey
+		float r = 0;
+		ss >> r;
+		float g = r;
+		float b = r;
+		if (ss >> g)
+		{
+			ss >> b;
+		}
+		clr[0] = r;
+		clr[1] = g;
+		clr[2] = b;
+	}
+
+	bool IsNumber(const std::string& s)
+	{
+		char* end = nullptr;
+		strtod(s.c_str(), &end);
+		return !s.empty() && (end == s.c_str() + s.size());
+	}
+
+	//Options like -bm 0.02 can come before or after the path, their arguments are numbers, on/off or
+	//a channel letter. What's left is the path, spaces included
+	std::string ReadMapPath(std::istringstream& ss)
+	{
+		std::string path;
+		std::string arg;
+		bool option_arg = false;
+		while (ss >> arg)
+		{
+			bool option = ('-' == arg[0]) && !IsNumber(arg);
+			bool value = option_arg && (IsNumber(arg) || ("on" == arg) || ("off" == arg) || (1 == arg.size()));
+			if (option)
+			{
+				option_arg = true;
+			}
+			else if (!value)
+			{
+				option_arg = false;
+				path += path.empty() ? arg : " " + arg;
+			}
+		}
+		return path;
+	}
+
+	bool FileExists(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return file.is_open();
+	}
+
+	std::string JoinMapPath(const std::string& base_dir, std::string path)
+	{
+		std::replace(path.begin(), path.end(), '\\', '/');
+		bool absolute = (!path.empty() && ('/' == path[0])) || ((path.size() > 1) && (':' == path[1]));
+		if (base_dir.empty() || absolute)
+		{
+			return path;
+		}
+
+		std::string dir = base_dir;
+		std::replace(dir.begin(), dir.end(), '\\', '/');
+		if ('/' != dir.back())
+		{
+			dir += '/';
+		}
+		return dir + path;
+	}
+
+	//Empty if the file isn't there with its extension in either case
+	std::string FindMapFile(const std::string& path)
+	{
+		if (FileExists(path))
+		{
+			return path;
+		}
+
+		size_t dot = path.find_last_of("./");
+		if ((dot != std::string::npos) && ('.' == path[dot]))
+		{
+			std::string ext = path.substr(dot);
+			std::string lower = ToLower(ext);
+			if (ext == lower)
+			{
+				std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+			}
+			else
+			{
+				ext = lower;
+			}
+
+			std::string other = path.substr(0, dot) + ext;
+			if (FileExists(other))
+			{
+				return other;
+			}
+		}
+
+		return std::string();
+	}
+
+	std::string InferSpecGlossMap(const std::string& albedo_map)
+	{
+		size_t dot = albedo_map.find_last_of("./");
+		if ((dot == std::string::npos) || ('.' != albedo_map[dot]))
+		{
+			dot = albedo_map.size();
+		}
+		std::string stem = albedo_map.substr(0, dot);
+		std::string ext = albedo_map.substr(dot);
+
+		for (const char* suffix : ALBEDO_MAP_SUFFIXES)
+		{
+			if (EndsWith(stem, suffix))
+			{
+				stem.resize(stem.size() - strlen(suffix));
+				break;
+			}
+		}
+
+		return FindMapFile(stem + SPEC_GLOSS_MAP_SUFFIX + ext);
+	}
+
+	bool SameSurface(const MaterialDesc& a, const MaterialDesc& b)
+	{
+		for (int m = 0; m != MM_NumMaps; m++)
+		{
+			if (a.maps[m] != b.maps[m])
+			{
+				return false;
+			}
+		}
+		return (a.albedo[0] == b.albedo[0]) && (a.albedo[1] == b.albedo[1]) && (a.albedo[2] == b.albedo[2])
+			&& (a.metalness == b.metalness) && (a.glossiness == b.glossiness);
+	}
+
+
+	void InitMaterialDesc(const std::string& name, MaterialDesc& desc)
+	{
+		desc.name = name;
+		for (auto& map : desc.maps)
+		{
+			map.clear();
+		}
+
+		//The defaults of the .mtl format
+		for (int c = 0; c != 3; c++)
+		{
+			desc.ka[c] = 0.2f;
+			desc.kd[c] = 0.8f;
+			desc.ks[c] = 1.0f;
+		}
+		desc.ns = 0;
+		desc.pm = 0;
+
+		DerivePBRParameters(desc);
+	}
+
+	bool ParseMTL(std::istream& is, std::vector<MaterialDesc>& materials)
+	{
+		materials.clear();
+
+		MaterialDesc* desc = nullptr;
+		std::string line;
+		while (std::getline(is, line))
+		{
+			std::istringstream ss(line);
+			std::string key;
+			if (!(ss >> key) || ('#' == key[0]))
+			{
+				continue;
+			}
+			key = ToLower(key);
+
+			if ("newmtl" == key)
+			{
+				std::string name;
+				ss >> name;
+				materials.emplace_back();
+				desc = &materials.back();
+				InitMaterialDesc(name, *desc);
+			}
+			else if (!desc)
+			{
+				continue;
+			}
+			else if ("ka" == key)
+			{
+				ReadColor(ss, desc->ka);
+			}
+			else if ("kd" == key)
+			{
+				ReadColor(ss, desc->kd);
+			}
+			else if ("ks" == key)
+			{
+				ReadColor(ss, desc->ks);
+			}
+			else if ("ns" == key)
+			{
+				ss >> desc->ns;
+			}
+			else if ("pm" == key)
+			{
+				ss >> desc->pm;
+			}
+			else if ("map_kd" == key)
+			{
+				desc->maps[MM_Albedo] = ReadMapPath(ss);
+			}
+			else if (("bump" == key) || ("map_bump" == key) || ("norm" == key))
+			{
+				desc->maps[MM_Normal] = ReadMapPath(ss);
+			}
+			else if ("map_ks" == key)
+			{
+				desc->maps[MM_SpecGloss] = ReadMapPath(ss);
+			}
+			else if ("map_pm" == key)
+			{
+				desc->maps[MM_Metalness] = ReadMapPath(ss);
+			}
+		}
+
+		return !materials.empty();
+	}
+
+	void ResolveMaterialMaps(MaterialDesc& desc, const std::string& base_dir)
+	{
+		for (auto& map : desc.maps)
+		{
+			if (!map.empty())
+			{
+				map = FindMapFile(JoinMapPath(base_dir, map));
+			}
+		}
+
+		if (desc.maps[MM_SpecGloss].empty() && !desc.maps[MM_Albedo].empty())
+		{
+			desc.maps[MM_SpecGloss] = InferSpecGlossMap(desc.maps[MM_Albedo]);
+		}
+	}
+
+	void DerivePBRParameters(MaterialDesc& desc)
+	{
+		bool has_kd = (desc.kd[0] > 0) || (desc.kd[1] > 0) || (desc.kd[2] > 0);
+		bool has_ks = (desc.ks[0] > 0) || (desc.ks[1] > 0) || (desc.ks[2] > 0);
+
+		const float* albedo = has_kd ? desc.kd : desc.ka;
+		for (int c = 0; c != 3; c++)
+		{
+			desc.albedo[c] = (std::min)((std::max)(albedo[c], 0.0f), 1.0f);
+		}
+
+		if (!desc.maps[MM_Metalness].empty())
+		{
+			desc.metalness = 1;
+		}
+		else
+		{
+			desc.metalness = (std::min)((std::max)(desc.pm, 0.0f), 1.0f);
+		}
+
+		if (!desc.maps[MM_SpecGloss].empty())
+		{
+			desc.glossiness = 1;
+		}
+		else if (!has_ks)
+		{
+			desc.glossiness = 0;
+		}
+		else
+		{
+			//Shininess2Glossiness of the shader. Exporters write Ns below 1, even negative, for matte surfaces
+			float shininess = (std::min)((std::max)(desc.ns, 1.0f), MAX_MATERIAL_SHININESS);
+			desc.glossiness = std::log2(shininess) / std::log2(MAX_MATERIAL_SHININESS);
+		}
+	}
+
+	bool LoadMTL(const std::string& path, std::vector<MaterialDesc>& materials)
+	{
+		std::ifstream file(path);
+		if (!file || !ParseMTL(file, materials))
+		{
+			return false;
+		}
+
+		size_t slash = path.find_last_of("/\\");
+		std::string base_dir = (slash != std::string::npos) ? path.substr(0, slash) : std::string();
+		for (auto& desc : materials)
+		{
+			ResolveMaterialMaps(desc, base_dir);
+			DerivePBRParameters(desc);
+		}
+
+		return true;
+	}
+
+	std::string FindMTLLibrary(const std::string& obj_path)
+	{
+		std::ifstream file(obj_path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream ss(line);
+			std::string key;
+			if (!(ss >> key))
+			{
+				continue;
+			}
+
+			if ("mtllib" == key)
+			{
+				std::string name;
+				std::getline(ss >> std::ws, name);
+				while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back())))
+				{
+					name.pop_back();
+				}
+
+				size_t slash = obj_path.find_last_of("/\\");
+				return JoinMapPath((slash != std::string::npos) ? obj_path.substr(0, slash) : std::string(), name);
+			}
+
+			//The library comes before the geometry, no need to read the rest
+			if (("v" == key) || ("f" == key))
+			{
+				break;
+			}
+		}
+
+		return std::string();
+	}
+
+	int32_t FindMaterial(const std::vector<MaterialDesc>& materials, const std::string& name)
+	{
+		for (size_t i = 0; i != materials.size(); i++)
+		{
+			if (materials[i].name == name)
+			{
+				return static_cast<int32_t>(i);
+			}
+		}
+		return -1;
+	}
+
+	void DedupeMaterials(const std::vector<MaterialDesc>& materials, std::vector<MaterialDesc>& unique,
+		std::vector<uint32_t>& remap)
+	{
+		unique.clear();
+		remap.resize(materials.size());
+
+		//Scenes have tens of materials, a linear search is enough
+		for (size_t i = 0; i != materials.size(); i++)
+		{
+			size_t u = 0;
+			while ((u != unique.size()) && !SameSurface(materials[i], unique[u]))
+			{
+				u++;
+			}
+			if (u == unique.size())
+			{
+				unique.push_back(materials[i]);
+			}
+			remap[i] = static_cast<uint32_t>(u);
+		}
+	}
+
+	void CollectMaterialTextures(const std::vector<MaterialDesc>& materials, std::vector<std::string>& textures,
+		std::vector<int32_t>& map_textures)
+	{
+		textures.clear();
+		map_textures.assign(materials.size() * MM_NumMaps, -1);
+
+		std::unordered_map<std::string, int32_t> indices;
+		for (size_t i = 0; i != materials.size(); i++)
+		{
+			for (int m = 0; m != MM_NumMaps; m++)
+			{
+				const std::string& map = materials[i].maps[m];
+				if (map.empty())
+				{
+					continue;
+				}
+
+				auto iter = indices.find(map);
+				if (iter == indices.end())
+				{
+					iter = indices.emplace(map, static_cast<int32_t>(textures.size())).first;
+					textures.push_back(map);
+				}
+				map_textures[i * MM_NumMaps + m] = iter->second;
+			}
+		}
+	}
+
+}
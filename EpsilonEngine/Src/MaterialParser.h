@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Wavefront .mtl materials turned into what the GBuffer pass of DeferredRendering.fx takes: texture maps
+	//and the albedo, metalness and glossiness they are scaled by. Meshes share materials through
+	//DedupeMaterials, so each one is loaded and bound once
+
+	//Texture slots of a material, in the order of Material's
+	enum MaterialMap
+	{
+		MM_Albedo = 0,
+		MM_Normal,
+		MM_SpecGloss,
+		MM_Metalness,
+
+		MM_NumMaps
+	};
+
+	//MAX_SHININESS in the shader, glossiness 1
+	const float MAX_MATERIAL_SHININESS = 8192.0f;
+
+	struct MaterialDesc
+	{
+		std::string name;
+
+		//Relative to the .mtl as written until ResolveMaterialMaps, then paths to the files. Empty for none
+		std::string maps[MM_NumMaps];
+
+		//As written, Pm being the metalness of the PBR extension
+		float ka[3];
+		float kd[3];
+		float ks[3];
+		float ns;
+		float pm;
+
+		//From DerivePBRParameters. A map scales its parameter per texel
+		float albedo[3];
+		float metalness;
+		float glossiness;
+	};
+
+	//Defaults of keys a material leaves out
+	void InitMaterialDesc(const std::string& name, MaterialDesc& desc);
+
+	//Materials in the order of the newmtl lines. Maps are map_Kd, bump/map_bump/norm (exporters write normal
+	//maps under bump), map_Ks for the spec-gloss map and map_Pm, their options skipped. Unknown keys are
+	//ignored. Returns false if there are none
+	bool ParseMTL(std::istream& is, std::vector<MaterialDesc>& materials);
+
+	//Joins the maps to the .mtl's directory with forward slashes. A map missing from disk is looked up with
+	//its extension in the other case, then dropped. Without a map_Ks, a <name>_spec next to the albedo map
+	//<name>_diff or <name> is the spec-gloss map when it exists
+	void ResolveMaterialMaps(MaterialDesc& desc, const std::string& base_dir);
+
+	//The albedo is Kd, or Ka when Kd is black as in Sponza. Glossiness follows Ns, and is 0 without Ks.
+	//A spec-gloss or metalness map supplies its parameter alone, scaled by 1
+	void DerivePBRParameters(MaterialDesc& desc);
+
+	//ParseMTL, ResolveMaterialMaps and DerivePBRParameters on a file
+	bool LoadMTL(const std::string& path, std::vector<MaterialDesc>& materials);
+
+	//Path of the .mtl an .obj names in its mtllib line, next to the .obj. Empty if it names none
+	std::string FindMTLLibrary(const std::string& obj_path);
+
+	//Index of the material with the name, -1 if there is none
+	int32_t FindMaterial(const std::vector<MaterialDesc>& materials, const std::string& name);
+
+	//Materials the GBuffer pass can't tell apart, same maps and parameters, are kept once under the first
+	//one's name. remap[i] is the unique material of materials[i]
+	void DedupeMaterials(const std::vector<MaterialDesc>& materials, std::vector<MaterialDesc>& unique,
+		std::vector<uint32_t>& remap);
+
+	//Every map of the materials once, in order of first use. map_textures has MM_NumMaps entries per
+	//material indexing textures, -1 for none
+	void CollectMaterialTextures(const std::vector<MaterialDesc>& materials, std::vector<std::string>& textures,
+		std::vector<int32_t>& map_textures);
+
+}
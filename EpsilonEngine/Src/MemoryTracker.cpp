@@ -0,0 +1,128 @@
+#include "MemoryTracker.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace epsilon
+{
+
+	struct MemoryRecord
+	{
+		MemoryCategory category;
+		uint64_t bytes;
+	};
+
+	std::array<std::atomic<uint64_t>, MC_NumCategories> memory_current_ = {};
+	std::array<std::atomic<uint64_t>, MC_NumCategories> memory_peak_ = {};
+
+#ifdef _DEBUG
+	std::atomic<bool> memory_detailed_(true);
+#else
+	std::atomic<bool> memory_detailed_(false);
+#endif
+
+	std::mutex memory_records_mutex_;
+	std::unordered_map<const void*, MemoryRecord> memory_records_;
+
+
+	void MemoryTracker::Allocate(MemoryCategory category, uint64_t bytes, const void* id)
+	{
+		uint64_t current = memory_current_[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+		uint64_t peak = memory_peak_[category].load(std::memory_order_relaxed);
+		while ((current > peak)
+			&& !memory_peak_[category].compare_exchange_weak(peak, current, std::memory_order_relaxed))
+		{
+		}
+
+		if (memory_detailed_.load(std::memory_order_relaxed))
+		{
+			MemoryRecord record;
+			record.category = category;
+			record.bytes = bytes;
+
+			std::lock_guard<std::mutex> lock(memory_records_mutex_);
+			memory_records_[id] = record;
+		}
+	}
+
+	void MemoryTracker::Free(MemoryCategory category, uint64_t bytes, const void* id)
+	{
+		memory_current_[category].fetch_sub(bytes, std::memory_order_relaxed);
+
+		if (memory_detailed_.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(memory_records_mutex_);
+			memory_records_.erase(id);
+		}
+	}
+
+	uint64_t MemoryTracker::CurrentBytes(MemoryCategory category)
+	{
+		return memory_current_[category].load(std::memory_order_relaxed);
+	}
+
+	uint64_t MemoryTracker::PeakBytes(MemoryCategory category)
+	{
+		return memory_peak_[category].load(std::memory_order_relaxed);
+	}
+
+	const char* MemoryTracker::CategoryName(MemoryCategory category)
+	{
+		static const char* names[MC_NumCategories] =
+		{
+			"RenderTarget",
+			"VertexBuffer",
+			"IndexBuffer",
+			"ConstantBuffer",
+			"StructuredBuffer",
+			"Texture",
+			"Staging",
+			"CPUHeap"
+		};
+		return names[category];
+	}
+
+	void MemoryTracker::Detailed(bool detailed)
+	{
+		if (!detailed)
+		{
+			std::lock_guard<std::mutex> lock(memory_records_mutex_);
+			memory_records_.clear();
+		}
+		memory_detailed_.store(detailed, std::memory_order_relaxed);
+	}
+
+	bool MemoryTracker::Detailed()
+	{
+		return memory_detailed_.load(std::memory_order_relaxed);
+	}
+
+	uint32_t MemoryTracker::ReportLeaks(std::ostream& os)
+	{
+		uint32_t num_leaks = 0;
+		for (size_t i = 0; i != MC_NumCategories; i++)
+		{
+			MemoryCategory category = static_cast<MemoryCategory>(i);
+			uint64_t current = CurrentBytes(category);
+			if (current != 0)
+			{
+				os << "Memory leak: " << CategoryName(category) << " " << current << " bytes still allocated, peak "
+					<< PeakBytes(category) << " bytes\n";
+				++num_leaks;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(memory_records_mutex_);
+		for (const auto& record : memory_records_)
+		{
+			os << "  " << CategoryName(record.second.category) << " at " << record.first << ": "
+				<< record.second.bytes << " bytes\n";
+		}
+
+		return num_leaks;
+	}
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+
+
+namespace epsilon
+{
+
+	enum MemoryCategory
+	{
+		MC_RenderTarget,
+		MC_VertexBuffer,
+		MC_IndexBuffer,
+		MC_ConstantBuffer,
+		MC_StructuredBuffer,
+		MC_Texture,
+		MC_Staging,
+		MC_CPUHeap,
+
+		MC_NumCategories
+	};
+
+
+	//Current and peak bytes per category. Counting is a couple of relaxed atomics,
+	//the detailed mode also remembers every live allocation so leaks can be listed one by one
+	class MemoryTracker
+	{
+	public:
+		static void Allocate(MemoryCategory category, uint64_t bytes, const void* id);
+		static void Free(MemoryCategory category, uint64_t bytes, const void* id);
+
+		static uint64_t CurrentBytes(MemoryCategory category);
+		static uint64_t PeakBytes(MemoryCategory category);
+
+		static const char* CategoryName(MemoryCategory category);
+
+		//On by default in debug builds. Only allocations made while it is on are listed
+		static void Detailed(bool detailed);
+		static bool Detailed();
+
+		//Writes what is still allocated and returns the number of leaking categories
+		static uint32_t ReportLeaks(std::ostream& os);
+	};
+
+
+	//COM pointer that accounts its memory until the last reference is dropped
+	template <typename T>
+	inline std::shared_ptr<T> MakeTrackedCOMPtr(T* p, MemoryCategory category, uint64_t bytes)
+	{
+		if (!p)
+		{
+			return std::shared_ptr<T>();
+		}
+
+		MemoryTracker::Allocate(category, bytes, p);
+		return std::shared_ptr<T>(p, [category, bytes](T* p)
+		{
+			MemoryTracker::Free(category, bytes, p);
+			p->Release();
+		});
+	}
+
+
+	//STL allocator that makes container storage visible to the tracker
+	template <typename T, MemoryCategory Category = MC_CPUHeap>
+	class TrackedAllocator
+	{
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef TrackedAllocator<U, Category> other;
+		};
+
+	public:
+		TrackedAllocator()
+		{
+		}
+
+		template <typename U>
+		TrackedAllocator(const TrackedAllocator<U, Category>&)
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			T* p = std::allocator<T>().allocate(n);
+			MemoryTracker::Allocate(Category, n * sizeof(T), p);
+			return p;
+		}
+
+		void deallocate(T* p, size_t n)
+		{
+			MemoryTracker::Free(Category, n * sizeof(T), p);
+			std::allocator<T>().deallocate(p, n);
+		}
+
+		template <typename U>
+		bool operator==(const TrackedAllocator<U, Category>&) const
+		{
+			return true;
+		}
+
+		template <typename U>
+		bool operator!=(const TrackedAllocator<U, Category>&) const
+		{
+			return false;
+		}
+	};
+
+}
@@ -0,0 +1,96 @@
+#include "NullBackend.h"
+#include <cstring>
+
+
+namespace epsilon
+{
+	const StatCounter CONSTANT_BYTES_COUNTERS[CF_NumFrequencies] =
+	{
+		SC_FrameConstantBytes,
+		SC_LightConstantBytes,
+		SC_MaterialConstantBytes,
+		SC_ObjectConstantBytes,
+		SC_PassConstantBytes
+	};
+
+
+	NullBackend::NullBackend()
+		: topology_(PT_TriangleList)
+	{
+	}
+
+	void NullBackend::Reset()
+	{
+		topology_ = PT_TriangleList;
+		for (auto& constants : constants_)
+		{
+			constants.clear();
+		}
+	}
+
+	void NullBackend::SetVertexBuffer(CommandHandle, uint32_t)
+	{
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void NullBackend::SetIndexBuffer(CommandHandle)
+	{
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void NullBackend::SetTopology(PrimitiveTopology topology)
+	{
+		topology_ = topology;
+
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void NullBackend::SetInputLayout(CommandHandle)
+	{
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void NullBackend::SetTexture(uint32_t, CommandHandle)
+	{
+		RenderStatistics::Add(SC_TextureBinds);
+	}
+
+	void NullBackend::SetConstants(ConstantFrequency freq, const void* data, uint32_t size)
+	{
+		std::vector<uint8_t>& constants = constants_[freq];
+		if ((constants.size() == size) && (0 == memcmp(constants.data(), data, size)))
+		{
+			return;
+		}
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		constants.assign(bytes, bytes + size);
+
+		RenderStatistics::Add(CONSTANT_BYTES_COUNTERS[freq], size);
+	}
+
+	void NullBackend::SetStaticConstants(ConstantFrequency freq, CommandHandle, uint32_t,
+		const void* data, uint32_t size)
+	{
+		//Without the ring the values are uploaded like any others
+		this->SetConstants(freq, data, size);
+	}
+
+	void NullBackend::ApplyPass(CommandHandle)
+	{
+		RenderStatistics::Add(SC_StateChanges);
+	}
+
+	void NullBackend::Draw(uint32_t num_vertices, uint32_t)
+	{
+		RenderStatistics::Add(SC_Draws);
+		RenderStatistics::Add(SC_Triangles, (PT_TriangleStrip == topology_) ? num_vertices - 2 : num_vertices / 3);
+	}
+
+	void NullBackend::DrawIndexed(uint32_t num_indices, uint32_t, int32_t)
+	{
+		RenderStatistics::Add(SC_Draws);
+		RenderStatistics::Add(SC_Triangles, (PT_TriangleStrip == topology_) ? num_indices - 2 : num_indices / 3);
+	}
+
+}
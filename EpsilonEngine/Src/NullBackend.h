@@ -0,0 +1,43 @@
+#pragma once
+#include "CommandStream.h"
+#include "RenderStatistics.h"
+#include <array>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//A CommandStream backend without a device, for running the CPU side of a frame anywhere. Nothing is
+	//drawn, but every call adds to RenderStatistics what the D3D11 CommandList adds for it when it sets
+	//constants through the effect, so the counters of a headless frame compare with a real one's
+	class NullBackend : public CommandBackend
+	{
+	public:
+		NullBackend();
+
+		//Forgets the bound constants, as a new frame does
+		void Reset();
+
+		virtual void SetVertexBuffer(CommandHandle buffer, uint32_t stride) override;
+		virtual void SetIndexBuffer(CommandHandle buffer) override;
+		virtual void SetTopology(PrimitiveTopology topology) override;
+		virtual void SetInputLayout(CommandHandle layout) override;
+		virtual void SetTexture(uint32_t slot, CommandHandle view) override;
+
+		//Setting the same values again counts no bytes
+		virtual void SetConstants(ConstantFrequency freq, const void* data, uint32_t size) override;
+		virtual void SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+			const void* data, uint32_t size) override;
+
+		virtual void ApplyPass(CommandHandle pass) override;
+
+		virtual void Draw(uint32_t num_vertices, uint32_t first_vertex) override;
+		virtual void DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex) override;
+
+	private:
+		PrimitiveTopology topology_;
+		std::array<std::vector<uint8_t>, CF_NumFrequencies> constants_;
+	};
+
+}
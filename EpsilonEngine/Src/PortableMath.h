@@ -0,0 +1,574 @@
+#pragma once
+#include <stdint.h>
+#include <cmath>
+
+//The part of DirectXMath the engine's platform-neutral code uses, for compilers without the Windows SDK.
+//Same names, layouts and row-vector conventions. Everything is built on the primitives in Internal, which
+//have an SSE2, a NEON and a plain C form doing the same IEEE operations in the same order, so the three
+//give identical results as long as the compiler doesn't contract multiply-adds (-ffp-contract=off).
+//EPSILON_MATH_NO_INTRINSICS forces the plain C form
+
+#if !defined(EPSILON_MATH_NO_INTRINSICS)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define EPSILON_MATH_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+//AArch64 only, 32-bit NEON has no IEEE divide
+#define EPSILON_MATH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+
+namespace DirectX
+{
+
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_PIDIV2 = 1.570796327f;
+
+	inline float XMConvertToRadians(float degrees)
+	{
+		return degrees * (XM_PI / 180.0f);
+	}
+
+	inline float XMConvertToDegrees(float radians)
+	{
+		return radians * (180.0f / XM_PI);
+	}
+
+
+#if defined(EPSILON_MATH_SSE2)
+	typedef __m128 XMVECTOR;
+#elif defined(EPSILON_MATH_NEON)
+	typedef float32x4_t XMVECTOR;
+#else
+	struct XMVECTOR
+	{
+		float f[4];
+	};
+#endif
+
+	struct XMFLOAT2
+	{
+		float x;
+		float y;
+
+		XMFLOAT2() {}
+		XMFLOAT2(float xx, float yy) : x(xx), y(yy) {}
+		explicit XMFLOAT2(const float* arr) : x(arr[0]), y(arr[1]) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() {}
+		XMFLOAT3(float xx, float yy, float zz) : x(xx), y(yy), z(zz) {}
+		explicit XMFLOAT3(const float* arr) : x(arr[0]), y(arr[1]), z(arr[2]) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() {}
+		XMFLOAT4(float xx, float yy, float zz, float ww) : x(xx), y(yy), z(zz), w(ww) {}
+		explicit XMFLOAT4(const float* arr) : x(arr[0]), y(arr[1]), z(arr[2]), w(arr[3]) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
+		XMFLOAT4X4() {}
+		XMFLOAT4X4(float m00, float m01, float m02, float m03,
+			float m10, float m11, float m12, float m13,
+			float m20, float m21, float m22, float m23,
+			float m30, float m31, float m32, float m33)
+			: _11(m00), _12(m01), _13(m02), _14(m03),
+				_21(m10), _22(m11), _23(m12), _24(m13),
+				_31(m20), _32(m21), _33(m22), _34(m23),
+				_41(m30), _42(m31), _43(m32), _44(m33)
+		{
+		}
+		explicit XMFLOAT4X4(const float* arr)
+		{
+			for (int i = 0; i != 16; i++)
+			{
+				m[i / 4][i % 4] = arr[i];
+			}
+		}
+	};
+
+
+	namespace Internal
+	{
+
+		//The primitives, one per form. Lane-wise IEEE add, subtract, multiply and divide round the same in
+		//every form; anything else is done on scalars
+
+#if defined(EPSILON_MATH_SSE2)
+		inline XMVECTOR Set(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+		inline XMVECTOR Replicate(float s) { return _mm_set1_ps(s); }
+		inline XMVECTOR Load4(const float* p) { return _mm_loadu_ps(p); }
+		inline void Store4(float* p, XMVECTOR v) { _mm_storeu_ps(p, v); }
+		inline XMVECTOR Add(XMVECTOR a, XMVECTOR b) { return _mm_add_ps(a, b); }
+		inline XMVECTOR Sub(XMVECTOR a, XMVECTOR b) { return _mm_sub_ps(a, b); }
+		inline XMVECTOR Mul(XMVECTOR a, XMVECTOR b) { return _mm_mul_ps(a, b); }
+		inline XMVECTOR Div(XMVECTOR a, XMVECTOR b) { return _mm_div_ps(a, b); }
+		inline float Lane(XMVECTOR v, int i)
+		{
+			float f[4];
+			_mm_storeu_ps(f, v);
+			return f[i];
+		}
+#elif defined(EPSILON_MATH_NEON)
+		inline XMVECTOR Set(float x, float y, float z, float w)
+		{
+			float f[4] = { x, y, z, w };
+			return vld1q_f32(f);
+		}
+		inline XMVECTOR Replicate(float s) { return vdupq_n_f32(s); }
+		inline XMVECTOR Load4(const float* p) { return vld1q_f32(p); }
+		inline void Store4(float* p, XMVECTOR v) { vst1q_f32(p, v); }
+		inline XMVECTOR Add(XMVECTOR a, XMVECTOR b) { return vaddq_f32(a, b); }
+		inline XMVECTOR Sub(XMVECTOR a, XMVECTOR b) { return vsubq_f32(a, b); }
+		inline XMVECTOR Mul(XMVECTOR a, XMVECTOR b) { return vmulq_f32(a, b); }
+		inline XMVECTOR Div(XMVECTOR a, XMVECTOR b) { return vdivq_f32(a, b); }
+		inline float Lane(XMVECTOR v, int i)
+		{
+			float f[4];
+			vst1q_f32(f, v);
+			return f[i];
+		}
+#else
+		inline XMVECTOR Set(float x, float y, float z, float w)
+		{
+			XMVECTOR v = { { x, y, z, w } };
+			return v;
+		}
+		inline XMVECTOR Replicate(float s) { return Set(s, s, s, s); }
+		inline XMVECTOR Load4(const float* p) { return Set(p[0], p[1], p[2], p[3]); }
+		inline void Store4(float* p, XMVECTOR v)
+		{
+			for (int i = 0; i != 4; i++)
+			{
+				p[i] = v.f[i];
+			}
+		}
+		inline XMVECTOR Add(XMVECTOR a, XMVECTOR b) { return Set(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]); }
+		inline XMVECTOR Sub(XMVECTOR a, XMVECTOR b) { return Set(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]); }
+		inline XMVECTOR Mul(XMVECTOR a, XMVECTOR b) { return Set(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]); }
+		inline XMVECTOR Div(XMVECTOR a, XMVECTOR b) { return Set(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]); }
+		inline float Lane(XMVECTOR v, int i) { return v.f[i]; }
+#endif
+
+		//a * b + c, rounded twice like the separate operations
+		inline XMVECTOR MulAdd(XMVECTOR a, XMVECTOR b, XMVECTOR c)
+		{
+			return Add(Mul(a, b), c);
+		}
+
+	}
+
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+
+		XMMATRIX() {}
+		XMMATRIX(XMVECTOR r0, XMVECTOR r1, XMVECTOR r2, XMVECTOR r3)
+		{
+			r[0] = r0;
+			r[1] = r1;
+			r[2] = r2;
+			r[3] = r3;
+		}
+		XMMATRIX(float m00, float m01, float m02, float m03,
+			float m10, float m11, float m12, float m13,
+			float m20, float m21, float m22, float m23,
+			float m30, float m31, float m32, float m33)
+		{
+			r[0] = Internal::Set(m00, m01, m02, m03);
+			r[1] = Internal::Set(m10, m11, m12, m13);
+			r[2] = Internal::Set(m20, m21, m22, m23);
+			r[3] = Internal::Set(m30, m31, m32, m33);
+		}
+		explicit XMMATRIX(const float* arr)
+		{
+			for (int i = 0; i != 4; i++)
+			{
+				r[i] = Internal::Load4(arr + i * 4);
+			}
+		}
+	};
+
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+	{
+		return Internal::Set(x, y, z, w);
+	}
+
+	inline XMVECTOR XMVectorReplicate(float s)
+	{
+		return Internal::Replicate(s);
+	}
+
+	inline XMVECTOR XMVectorZero()
+	{
+		return Internal::Replicate(0);
+	}
+
+	inline float XMVectorGetX(XMVECTOR v)
+	{
+		return Internal::Lane(v, 0);
+	}
+
+	inline float XMVectorGetY(XMVECTOR v)
+	{
+		return Internal::Lane(v, 1);
+	}
+
+	inline float XMVectorGetZ(XMVECTOR v)
+	{
+		return Internal::Lane(v, 2);
+	}
+
+	inline float XMVectorGetW(XMVECTOR v)
+	{
+		return Internal::Lane(v, 3);
+	}
+
+
+	inline XMVECTOR XMLoadFloat2(const XMFLOAT2* src)
+	{
+		return Internal::Set(src->x, src->y, 0, 0);
+	}
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* src)
+	{
+		return Internal::Set(src->x, src->y, src->z, 0);
+	}
+
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* src)
+	{
+		return Internal::Load4(&src->x);
+	}
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* src)
+	{
+		return XMMATRIX(&src->_11);
+	}
+
+	inline void XMStoreFloat2(XMFLOAT2* dst, XMVECTOR v)
+	{
+		float f[4];
+		Internal::Store4(f, v);
+		dst->x = f[0];
+		dst->y = f[1];
+	}
+
+	inline void XMStoreFloat3(XMFLOAT3* dst, XMVECTOR v)
+	{
+		float f[4];
+		Internal::Store4(f, v);
+		dst->x = f[0];
+		dst->y = f[1];
+		dst->z = f[2];
+	}
+
+	inline void XMStoreFloat4(XMFLOAT4* dst, XMVECTOR v)
+	{
+		Internal::Store4(&dst->x, v);
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* dst, const XMMATRIX& m)
+	{
+		for (int i = 0; i != 4; i++)
+		{
+			Internal::Store4(dst->m[i], m.r[i]);
+		}
+	}
+
+
+	inline XMVECTOR XMVectorAdd(XMVECTOR v1, XMVECTOR v2)
+	{
+		return Internal::Add(v1, v2);
+	}
+
+	inline XMVECTOR XMVectorSubtract(XMVECTOR v1, XMVECTOR v2)
+	{
+		return Internal::Sub(v1, v2);
+	}
+
+	inline XMVECTOR XMVectorMultiply(XMVECTOR v1, XMVECTOR v2)
+	{
+		return Internal::Mul(v1, v2);
+	}
+
+	inline XMVECTOR XMVectorDivide(XMVECTOR v1, XMVECTOR v2)
+	{
+		return Internal::Div(v1, v2);
+	}
+
+	inline XMVECTOR XMVectorMultiplyAdd(XMVECTOR v1, XMVECTOR v2, XMVECTOR v3)
+	{
+		return Internal::MulAdd(v1, v2, v3);
+	}
+
+	inline XMVECTOR XMVectorScale(XMVECTOR v, float s)
+	{
+		return Internal::Mul(v, Internal::Replicate(s));
+	}
+
+	inline XMVECTOR XMVectorNegate(XMVECTOR v)
+	{
+		return Internal::Sub(Internal::Replicate(0), v);
+	}
+
+	inline XMVECTOR XMVectorLerp(XMVECTOR v0, XMVECTOR v1, float t)
+	{
+		return Internal::MulAdd(Internal::Sub(v1, v0), Internal::Replicate(t), v0);
+	}
+
+	inline XMVECTOR XMVectorCatmullRom(XMVECTOR p0, XMVECTOR p1, XMVECTOR p2, XMVECTOR p3, float t)
+	{
+		float t2 = t * t;
+		float t3 = t * t2;
+		XMVECTOR w0 = Internal::Replicate((-t3 + 2.0f * t2 - t) * 0.5f);
+		XMVECTOR w1 = Internal::Replicate((3.0f * t3 - 5.0f * t2 + 2.0f) * 0.5f);
+		XMVECTOR w2 = Internal::Replicate((-3.0f * t3 + 4.0f * t2 + t) * 0.5f);
+		XMVECTOR w3 = Internal::Replicate((t3 - t2) * 0.5f);
+
+		XMVECTOR result = Internal::Mul(w0, p0);
+		result = Internal::MulAdd(w1, p1, result);
+		result = Internal::MulAdd(w2, p2, result);
+		return Internal::MulAdd(w3, p3, result);
+	}
+
+
+	inline XMVECTOR XMVector2Dot(XMVECTOR v1, XMVECTOR v2)
+	{
+		using namespace Internal;
+		return Replicate(Lane(v1, 0) * Lane(v2, 0) + Lane(v1, 1) * Lane(v2, 1));
+	}
+
+	inline XMVECTOR XMVector3Dot(XMVECTOR v1, XMVECTOR v2)
+	{
+		using namespace Internal;
+		return Replicate(Lane(v1, 0) * Lane(v2, 0) + Lane(v1, 1) * Lane(v2, 1) + Lane(v1, 2) * Lane(v2, 2));
+	}
+
+	inline XMVECTOR XMVector4Dot(XMVECTOR v1, XMVECTOR v2)
+	{
+		using namespace Internal;
+		return Replicate(Lane(v1, 0) * Lane(v2, 0) + Lane(v1, 1) * Lane(v2, 1)
+			+ Lane(v1, 2) * Lane(v2, 2) + Lane(v1, 3) * Lane(v2, 3));
+	}
+
+	inline XMVECTOR XMVector3Length(XMVECTOR v)
+	{
+		return Internal::Replicate(std::sqrt(XMVectorGetX(XMVector3Dot(v, v))));
+	}
+
+	inline XMVECTOR XMVector3Cross(XMVECTOR v1, XMVECTOR v2)
+	{
+		using namespace Internal;
+		float x1 = Lane(v1, 0), y1 = Lane(v1, 1), z1 = Lane(v1, 2);
+		float x2 = Lane(v2, 0), y2 = Lane(v2, 1), z2 = Lane(v2, 2);
+		return Set(y1 * z2 - z1 * y2, z1 * x2 - x1 * z2, x1 * y2 - y1 * x2, 0);
+	}
+
+
+	namespace Internal
+	{
+
+		//Every lane divided by the length, zero for a zero-length vector
+		inline XMVECTOR NormalizeByDot(XMVECTOR v, XMVECTOR dot)
+		{
+			float len = std::sqrt(Lane(dot, 0));
+			return (len > 0) ? Div(v, Replicate(len)) : Replicate(0);
+		}
+
+		inline XMVECTOR TransformRows(float x, float y, float z, float w, const XMMATRIX& m)
+		{
+			XMVECTOR result = Mul(Replicate(x), m.r[0]);
+			result = MulAdd(Replicate(y), m.r[1], result);
+			result = MulAdd(Replicate(z), m.r[2], result);
+			return MulAdd(Replicate(w), m.r[3], result);
+		}
+
+		inline XMVECTOR DivideByW(XMVECTOR v)
+		{
+			return Div(v, Replicate(Lane(v, 3)));
+		}
+
+	}
+
+	inline XMVECTOR XMVector2Normalize(XMVECTOR v)
+	{
+		return Internal::NormalizeByDot(v, XMVector2Dot(v, v));
+	}
+
+	inline XMVECTOR XMVector3Normalize(XMVECTOR v)
+	{
+		return Internal::NormalizeByDot(v, XMVector3Dot(v, v));
+	}
+
+	inline XMVECTOR XMVector4Normalize(XMVECTOR v)
+	{
+		return Internal::NormalizeByDot(v, XMVector4Dot(v, v));
+	}
+
+	inline XMVECTOR XMVector4Transform(XMVECTOR v, const XMMATRIX& m)
+	{
+		using namespace Internal;
+		return TransformRows(Lane(v, 0), Lane(v, 1), Lane(v, 2), Lane(v, 3), m);
+	}
+
+	inline XMVECTOR XMVector3TransformCoord(XMVECTOR v, const XMMATRIX& m)
+	{
+		using namespace Internal;
+		return DivideByW(TransformRows(Lane(v, 0), Lane(v, 1), Lane(v, 2), 1, m));
+	}
+
+	inline XMVECTOR XMVector3TransformNormal(XMVECTOR v, const XMMATRIX& m)
+	{
+		using namespace Internal;
+		return TransformRows(Lane(v, 0), Lane(v, 1), Lane(v, 2), 0, m);
+	}
+
+	inline XMVECTOR XMVector2TransformCoord(XMVECTOR v, const XMMATRIX& m)
+	{
+		using namespace Internal;
+		return DivideByW(TransformRows(Lane(v, 0), Lane(v, 1), 0, 1, m));
+	}
+
+	inline XMVECTOR XMVector2TransformNormal(XMVECTOR v, const XMMATRIX& m)
+	{
+		using namespace Internal;
+		return TransformRows(Lane(v, 0), Lane(v, 1), 0, 0, m);
+	}
+
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return XMMATRIX(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixMultiply(const XMMATRIX& m1, const XMMATRIX& m2)
+	{
+		XMMATRIX result;
+		for (int i = 0; i != 4; i++)
+		{
+			result.r[i] = XMVector4Transform(m1.r[i], m2);
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixTranspose(const XMMATRIX& m)
+	{
+		XMFLOAT4X4 f;
+		XMStoreFloat4x4(&f, m);
+		return XMMATRIX(f._11, f._21, f._31, f._41,
+			f._12, f._22, f._32, f._42,
+			f._13, f._23, f._33, f._43,
+			f._14, f._24, f._34, f._44);
+	}
+
+	inline XMMATRIX XMMatrixScaling(float sx, float sy, float sz)
+	{
+		return XMMATRIX(sx, 0, 0, 0, 0, sy, 0, 0, 0, 0, sz, 0, 0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		return XMMATRIX(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1);
+	}
+
+	//The quaternion is expected to be unit length
+	inline XMMATRIX XMMatrixRotationQuaternion(XMVECTOR q)
+	{
+		using namespace Internal;
+		float qx = Lane(q, 0), qy = Lane(q, 1), qz = Lane(q, 2), qw = Lane(q, 3);
+		float qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+		return XMMATRIX(
+			1.0f - 2.0f * qyy - 2.0f * qzz, 2.0f * qx * qy + 2.0f * qz * qw, 2.0f * qx * qz - 2.0f * qy * qw, 0,
+			2.0f * qx * qy - 2.0f * qz * qw, 1.0f - 2.0f * qxx - 2.0f * qzz, 2.0f * qy * qz + 2.0f * qx * qw, 0,
+			2.0f * qx * qz + 2.0f * qy * qw, 2.0f * qy * qz - 2.0f * qx * qw, 1.0f - 2.0f * qxx - 2.0f * qyy, 0,
+			0, 0, 0, 1);
+	}
+
+	//Scale, then rotate about the origin point, then translate
+	inline XMMATRIX XMMatrixAffineTransformation(XMVECTOR scaling, XMVECTOR rotation_origin, XMVECTOR rotation_quaternion,
+		XMVECTOR translation)
+	{
+		using namespace Internal;
+		XMVECTOR origin = Set(Lane(rotation_origin, 0), Lane(rotation_origin, 1), Lane(rotation_origin, 2), 0);
+		XMVECTOR trans = Set(Lane(translation, 0), Lane(translation, 1), Lane(translation, 2), 0);
+
+		XMMATRIX m = XMMatrixScaling(Lane(scaling, 0), Lane(scaling, 1), Lane(scaling, 2));
+		m.r[3] = Sub(m.r[3], origin);
+		m = XMMatrixMultiply(m, XMMatrixRotationQuaternion(rotation_quaternion));
+		m.r[3] = Add(m.r[3], origin);
+		m.r[3] = Add(m.r[3], trans);
+		return m;
+	}
+
+	//General inverse by cofactors. The determinant, replicated, goes to det when it isn't null
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* det, const XMMATRIX& m)
+	{
+		XMFLOAT4X4 f;
+		XMStoreFloat4x4(&f, m);
+		const float* a = &f._11;
+
+		float inv[16];
+		inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+		inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+		inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+		inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+		inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+		inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+		inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+		inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+		inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+		inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+		inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+		inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+		inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+		inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+		inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+		inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+		float d = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+		if (det)
+		{
+			*det = Internal::Replicate(d);
+		}
+
+		XMMATRIX result(inv);
+		XMVECTOR rcp = Internal::Replicate(1.0f / d);
+		for (int i = 0; i != 4; i++)
+		{
+			result.r[i] = Internal::Mul(result.r[i], rcp);
+		}
+		return result;
+	}
+
+}
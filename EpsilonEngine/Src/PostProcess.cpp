@@ -0,0 +1,435 @@
+#include "PostProcess.h"
+#include "BatchMath.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EPSILON_POST_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#define EPSILON_TARGET_SSE2
+#else
+#define EPSILON_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+
+namespace epsilon
+{
+	struct FilterTap
+	{
+		float dx;
+		float dy;
+		float weight;
+	};
+
+	//Offsets in source texels. The dual filter's downsample reaches a texel past the 2x2 block under a
+	//target texel, its upsample a texel out along the axes and half a texel along the diagonals
+	const FilterTap BRIGHT_PASS_TAPS[] =
+	{
+		{ -1, -1, 0.25f }, { 1, -1, 0.25f }, { -1, 1, 0.25f }, { 1, 1, 0.25f }
+	};
+
+	const FilterTap DOWNSAMPLE_TAPS[] =
+	{
+		{ 0, 0, 4 / 8.0f },
+		{ -1, -1, 1 / 8.0f }, { 1, -1, 1 / 8.0f }, { -1, 1, 1 / 8.0f }, { 1, 1, 1 / 8.0f }
+	};
+
+	const FilterTap UPSAMPLE_TAPS[] =
+	{
+		{ -1, 0, 1 / 12.0f }, { 1, 0, 1 / 12.0f }, { 0, -1, 1 / 12.0f }, { 0, 1, 1 / 12.0f },
+		{ -0.5f, -0.5f, 2 / 12.0f }, { 0.5f, -0.5f, 2 / 12.0f }, { -0.5f, 0.5f, 2 / 12.0f }, { 0.5f, 0.5f, 2 / 12.0f }
+	};
+
+	const uint32_t NUM_BRIGHT_PASS_TAPS = sizeof(BRIGHT_PASS_TAPS) / sizeof(BRIGHT_PASS_TAPS[0]);
+	const uint32_t NUM_DOWNSAMPLE_TAPS = sizeof(DOWNSAMPLE_TAPS) / sizeof(DOWNSAMPLE_TAPS[0]);
+	const uint32_t NUM_UPSAMPLE_TAPS = sizeof(UPSAMPLE_TAPS) / sizeof(UPSAMPLE_TAPS[0]);
+
+
+	PostSettings DefaultPostSettings()
+	{
+		PostSettings settings;
+		settings.bloom = false;
+		settings.bloom_threshold = 0.8f;
+		settings.bloom_knee = 0.2f;
+		settings.bloom_intensity = 0.4f;
+		settings.bloom_levels = 5;
+		settings.vignette = 0;
+		settings.color_grading = false;
+		settings.saturation = 1.1f;
+		settings.contrast = 1.1f;
+		return settings;
+	}
+
+	uint32_t BloomTargetSize(uint32_t size, uint32_t level)
+	{
+		return (std::max)((size + (2U << level) - 1) >> (level + 1), 1U);
+	}
+
+	//Texels and weights of a bilinear tap, clamped half a texel inside the image
+	struct BilinearTap
+	{
+		size_t t00;
+		size_t t10;
+		size_t t01;
+		size_t t11;
+		float tx;
+		float ty;
+	};
+
+	inline BilinearTap SetupBilinear(uint32_t width, uint32_t height, float px, float py)
+	{
+		float x = (std::min)((std::max)(px, 0.5f), width - 0.5f) - 0.5f;
+		float y = (std::min)((std::max)(py, 0.5f), height - 0.5f) - 0.5f;
+		uint32_t x0 = static_cast<uint32_t>(x);
+		uint32_t y0 = static_cast<uint32_t>(y);
+		uint32_t x1 = (std::min)(x0 + 1, width - 1);
+		uint32_t y1 = (std::min)(y0 + 1, height - 1);
+
+		BilinearTap tap;
+		tap.t00 = (static_cast<size_t>(y0) * width + x0) * 4;
+		tap.t10 = (static_cast<size_t>(y0) * width + x1) * 4;
+		tap.t01 = (static_cast<size_t>(y1) * width + x0) * 4;
+		tap.t11 = (static_cast<size_t>(y1) * width + x1) * 4;
+		tap.tx = x - x0;
+		tap.ty = y - y0;
+		return tap;
+	}
+
+	float LinearToSRGB(float c)
+	{
+		return c < 0.0031308f ? 12.92f * c : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+	}
+
+	float SRGBToLinear(float c)
+	{
+		return c < 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+
+	//Scalar reference
+
+	inline void SampleScalar(const float* image, uint32_t width, uint32_t height, float px, float py, float* rgba)
+	{
+		BilinearTap tap = SetupBilinear(width, height, px, py);
+		for (int c = 0; c != 4; c++)
+		{
+			float top = image[tap.t00 + c] + (image[tap.t10 + c] - image[tap.t00 + c]) * tap.tx;
+			float bottom = image[tap.t01 + c] + (image[tap.t11 + c] - image[tap.t01 + c]) * tap.tx;
+			rgba[c] = top + (bottom - top) * tap.ty;
+		}
+	}
+
+	inline void FilterScalar(const float* src, uint32_t src_width, uint32_t src_height, const FilterTap* taps, uint32_t num_taps,
+		float px, float py, float* rgba)
+	{
+		rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0;
+		for (uint32_t i = 0; i != num_taps; i++)
+		{
+			float s[4];
+			SampleScalar(src, src_width, src_height, px + taps[i].dx, py + taps[i].dy, s);
+			for (int c = 0; c != 4; c++)
+			{
+				rgba[c] += s[c] * taps[i].weight;
+			}
+		}
+	}
+
+	void FilterImageScalar(const float* src, uint32_t src_width, uint32_t src_height, const FilterTap* taps, uint32_t num_taps,
+		float* dst, uint32_t dst_width, uint32_t dst_height, bool accumulate)
+	{
+		float scale_x = static_cast<float>(src_width) / dst_width;
+		float scale_y = static_cast<float>(src_height) / dst_height;
+		for (uint32_t y = 0; y != dst_height; y++)
+		{
+			float py = (y + 0.5f) * scale_y;
+			for (uint32_t x = 0; x != dst_width; x++)
+			{
+				float rgba[4];
+				FilterScalar(src, src_width, src_height, taps, num_taps, (x + 0.5f) * scale_x, py, rgba);
+
+				float* out = dst + (static_cast<size_t>(y) * dst_width + x) * 4;
+				for (int c = 0; c != 4; c++)
+				{
+					out[c] = accumulate ? out[c] + rgba[c] : rgba[c];
+				}
+			}
+		}
+	}
+
+	//Soft knee: a quadratic from threshold - knee up to threshold + knee, linear above
+	inline float ThresholdWeight(float brightness, float threshold, float knee)
+	{
+		float soft = (std::min)((std::max)(brightness - threshold + knee, 0.0f), 2 * knee);
+		soft = soft * soft / (4 * knee + 1e-5f);
+		return (std::max)(soft, brightness - threshold) / (std::max)(brightness, 1e-5f);
+	}
+
+	void ThresholdScalar(float* image, size_t num_texels, float threshold, float knee)
+	{
+		for (size_t i = 0; i != num_texels; i++)
+		{
+			float* t = image + i * 4;
+			float w = ThresholdWeight((std::max)((std::max)(t[0], t[1]), t[2]), threshold, knee);
+			for (int c = 0; c != 4; c++)
+			{
+				t[c] *= w;
+			}
+		}
+	}
+
+
+#ifdef EPSILON_POST_X86
+
+	EPSILON_TARGET_SSE2 inline __m128 SampleSSE2(const float* image, uint32_t width, uint32_t height, float px, float py)
+	{
+		BilinearTap tap = SetupBilinear(width, height, px, py);
+		__m128 tx = _mm_set1_ps(tap.tx);
+		__m128 t00 = _mm_loadu_ps(image + tap.t00);
+		__m128 t01 = _mm_loadu_ps(image + tap.t01);
+		__m128 top = _mm_add_ps(t00, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(image + tap.t10), t00), tx));
+		__m128 bottom = _mm_add_ps(t01, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(image + tap.t11), t01), tx));
+		return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(tap.ty)));
+	}
+
+	EPSILON_TARGET_SSE2 inline __m128 FilterSSE2(const float* src, uint32_t src_width, uint32_t src_height,
+		const FilterTap* taps, uint32_t num_taps, float px, float py)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t i = 0; i != num_taps; i++)
+		{
+			__m128 s = SampleSSE2(src, src_width, src_height, px + taps[i].dx, py + taps[i].dy);
+			sum = _mm_add_ps(sum, _mm_mul_ps(s, _mm_set1_ps(taps[i].weight)));
+		}
+		return sum;
+	}
+
+	EPSILON_TARGET_SSE2 void FilterImageSSE2(const float* src, uint32_t src_width, uint32_t src_height,
+		const FilterTap* taps, uint32_t num_taps, float* dst, uint32_t dst_width, uint32_t dst_height, bool accumulate)
+	{
+		float scale_x = static_cast<float>(src_width) / dst_width;
+		float scale_y = static_cast<float>(src_height) / dst_height;
+		for (uint32_t y = 0; y != dst_height; y++)
+		{
+			float py = (y + 0.5f) * scale_y;
+			float* out = dst + static_cast<size_t>(y) * dst_width * 4;
+			for (uint32_t x = 0; x != dst_width; x++, out += 4)
+			{
+				__m128 rgba = FilterSSE2(src, src_width, src_height, taps, num_taps, (x + 0.5f) * scale_x, py);
+				if (accumulate)
+				{
+					rgba = _mm_add_ps(rgba, _mm_loadu_ps(out));
+				}
+				_mm_storeu_ps(out, rgba);
+			}
+		}
+	}
+
+	EPSILON_TARGET_SSE2 void ThresholdSSE2(float* image, size_t num_texels, float threshold, float knee)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 t = _mm_set1_ps(threshold);
+		__m128 k = _mm_set1_ps(knee);
+		__m128 k2 = _mm_set1_ps(2 * knee);
+		__m128 inv_k4 = _mm_set1_ps(1 / (4 * knee + 1e-5f));
+		__m128 eps = _mm_set1_ps(1e-5f);
+
+		//4 texels at a time as rgba columns, one brightness per lane
+		size_t i = 0;
+		for (; i + 4 <= num_texels; i += 4)
+		{
+			float* p = image + i * 4;
+			__m128 r = _mm_loadu_ps(p);
+			__m128 g = _mm_loadu_ps(p + 4);
+			__m128 b = _mm_loadu_ps(p + 8);
+			__m128 a = _mm_loadu_ps(p + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			__m128 brightness = _mm_max_ps(_mm_max_ps(r, g), b);
+			__m128 soft = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_sub_ps(brightness, t), k), zero), k2);
+			soft = _mm_mul_ps(_mm_mul_ps(soft, soft), inv_k4);
+			__m128 w = _mm_div_ps(_mm_max_ps(soft, _mm_sub_ps(brightness, t)), _mm_max_ps(brightness, eps));
+
+			r = _mm_mul_ps(r, w);
+			g = _mm_mul_ps(g, w);
+			b = _mm_mul_ps(b, w);
+			a = _mm_mul_ps(a, w);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			_mm_storeu_ps(p, r);
+			_mm_storeu_ps(p + 4, g);
+			_mm_storeu_ps(p + 8, b);
+			_mm_storeu_ps(p + 12, a);
+		}
+		ThresholdScalar(image + i * 4, num_texels - i, threshold, knee);
+	}
+
+#endif
+
+
+	//Filters run a texel per SSE2 register, AVX2 has no wider texel to work on and takes the same path
+	void FilterImage(const float* src, uint32_t src_width, uint32_t src_height, const FilterTap* taps, uint32_t num_taps,
+		float* dst, uint32_t dst_width, uint32_t dst_height, bool accumulate)
+	{
+#ifdef EPSILON_POST_X86
+		if (ActiveSIMDLevel() >= SL_SSE2)
+		{
+			FilterImageSSE2(src, src_width, src_height, taps, num_taps, dst, dst_width, dst_height, accumulate);
+			return;
+		}
+#endif
+		FilterImageScalar(src, src_width, src_height, taps, num_taps, dst, dst_width, dst_height, accumulate);
+	}
+
+	void BloomBrightPass(const float* scene, uint32_t width, uint32_t height, float threshold, float knee,
+		float* bright, uint32_t bright_width, uint32_t bright_height)
+	{
+		FilterImage(scene, width, height, BRIGHT_PASS_TAPS, NUM_BRIGHT_PASS_TAPS, bright, bright_width, bright_height, false);
+
+		size_t num_texels = static_cast<size_t>(bright_width) * bright_height;
+#ifdef EPSILON_POST_X86
+		if (ActiveSIMDLevel() >= SL_SSE2)
+		{
+			ThresholdSSE2(bright, num_texels, threshold, knee);
+			return;
+		}
+#endif
+		ThresholdScalar(bright, num_texels, threshold, knee);
+	}
+
+	void BloomDownsample(const float* src, uint32_t src_width, uint32_t src_height,
+		float* dst, uint32_t dst_width, uint32_t dst_height)
+	{
+		FilterImage(src, src_width, src_height, DOWNSAMPLE_TAPS, NUM_DOWNSAMPLE_TAPS, dst, dst_width, dst_height, false);
+	}
+
+	void BloomUpsample(const float* src, uint32_t src_width, uint32_t src_height,
+		float* dst, uint32_t dst_width, uint32_t dst_height)
+	{
+		FilterImage(src, src_width, src_height, UPSAMPLE_TAPS, NUM_UPSAMPLE_TAPS, dst, dst_width, dst_height, true);
+	}
+
+	void BuildGradingLUT(const PostSettings& settings, uint32_t size, float* lut)
+	{
+		//Contrast pivots around middle grey
+		const float MID_GREY = 0.18f;
+
+		for (uint32_t b = 0; b != size; b++)
+		{
+			for (uint32_t g = 0; g != size; g++)
+			{
+				for (uint32_t r = 0; r != size; r++)
+				{
+					float rgb[3] = { SRGBToLinear(r / (size - 1.0f)), SRGBToLinear(g / (size - 1.0f)), SRGBToLinear(b / (size - 1.0f)) };
+					for (int c = 0; c != 3; c++)
+					{
+						rgb[c] = MID_GREY * std::pow(rgb[c] / MID_GREY, settings.contrast);
+					}
+
+					float luminance = rgb[0] * 0.2126f + rgb[1] * 0.7152f + rgb[2] * 0.0722f;
+
+					float* out = lut + ((static_cast<size_t>(b) * size + g) * size + r) * 4;
+					for (int c = 0; c != 3; c++)
+					{
+						float graded = luminance + (rgb[c] - luminance) * settings.saturation;
+						out[c] = LinearToSRGB((std::min)((std::max)(graded, 0.0f), 1.0f));
+					}
+					out[3] = 1;
+				}
+			}
+		}
+	}
+
+	//Trilinear, the lattice points at 0 and 1 as the shader's half-texel offset puts them
+	void SampleLUT(const float* lut, uint32_t size, const float rgb[3], float* out)
+	{
+		uint32_t i0[3];
+		uint32_t i1[3];
+		float t[3];
+		for (int c = 0; c != 3; c++)
+		{
+			float x = (std::min)((std::max)(rgb[c], 0.0f), 1.0f) * (size - 1);
+			i0[c] = (std::min)(static_cast<uint32_t>(x), size - 1);
+			i1[c] = (std::min)(i0[c] + 1, size - 1);
+			t[c] = x - i0[c];
+		}
+
+		for (int c = 0; c != 3; c++)
+		{
+			float v = 0;
+			for (int corner = 0; corner != 8; corner++)
+			{
+				uint32_t r = (corner & 1) ? i1[0] : i0[0];
+				uint32_t g = (corner & 2) ? i1[1] : i0[1];
+				uint32_t b = (corner & 4) ? i1[2] : i0[2];
+				float w = ((corner & 1) ? t[0] : 1 - t[0]) * ((corner & 2) ? t[1] : 1 - t[1]) * ((corner & 4) ? t[2] : 1 - t[2]);
+				v += lut[((static_cast<size_t>(b) * size + g) * size + r) * 4 + c] * w;
+			}
+			out[c] = v;
+		}
+	}
+
+	void PostComposite(const float* scene, uint32_t width, uint32_t height, const float* bloom,
+		uint32_t bloom_width, uint32_t bloom_height, const PostSettings& settings, const float* lut, uint32_t lut_size,
+		float* out)
+	{
+#ifdef EPSILON_POST_X86
+		bool sse2 = (ActiveSIMDLevel() >= SL_SSE2);
+#endif
+		float scale_x = static_cast<float>(bloom_width) / width;
+		float scale_y = static_cast<float>(bloom_height) / height;
+		for (uint32_t y = 0; y != height; y++)
+		{
+			for (uint32_t x = 0; x != width; x++)
+			{
+				size_t texel = (static_cast<size_t>(y) * width + x) * 4;
+				float rgb[3] = { scene[texel + 0], scene[texel + 1], scene[texel + 2] };
+
+				if (bloom)
+				{
+					float b[4];
+					float px = (x + 0.5f) * scale_x;
+					float py = (y + 0.5f) * scale_y;
+#ifdef EPSILON_POST_X86
+					if (sse2)
+					{
+						_mm_storeu_ps(b, FilterSSE2(bloom, bloom_width, bloom_height, UPSAMPLE_TAPS, NUM_UPSAMPLE_TAPS, px, py));
+					}
+					else
+#endif
+					{
+						FilterScalar(bloom, bloom_width, bloom_height, UPSAMPLE_TAPS, NUM_UPSAMPLE_TAPS, px, py, b);
+					}
+					for (int c = 0; c != 3; c++)
+					{
+						rgb[c] += b[c] * settings.bloom_intensity;
+					}
+				}
+
+				if (settings.vignette > 0)
+				{
+					float u = (x + 0.5f) / width * 2 - 1;
+					float v = (y + 0.5f) / height * 2 - 1;
+					float falloff = (std::min)((std::max)(1 - settings.vignette * (u * u + v * v) * 0.5f, 0.0f), 1.0f);
+					for (int c = 0; c != 3; c++)
+					{
+						rgb[c] *= falloff;
+					}
+				}
+
+				for (int c = 0; c != 3; c++)
+				{
+					rgb[c] = LinearToSRGB((std::max)(rgb[c], 1e-6f));
+				}
+				if (lut)
+				{
+					SampleLUT(lut, lut_size, rgb, rgb);
+				}
+
+				std::copy(rgb, rgb + 3, out + texel);
+				out[texel + 3] = 1;
+			}
+		}
+	}
+
+}
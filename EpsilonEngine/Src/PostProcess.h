@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+
+
+namespace epsilon
+{
+
+	//Reference versions of the post-processing passes of DeferredRendering.fx, with the same taps and
+	//texel mapping, for checking the shaders and timing each stage. Images are row-major rgba, 4 floats
+	//a texel. Taps are bilinear at a position in source texels, clamped half a texel inside the image
+	//like the shaders clamp them to the valid part of a pooled target. Each kernel runs at the SIMD level
+	//of BatchMath.h, SSE2 working on one texel per register, the scalar path being the reference
+
+	//Pyramid levels below the scene, the first one being the bright pass at half resolution
+	const uint32_t MAX_BLOOM_LEVELS = 6;
+
+	struct PostSettings
+	{
+		bool bloom;
+
+		//Brightness where bloom starts, and the width of the soft transition below it
+		float bloom_threshold;
+		float bloom_knee;
+
+		//Weight of the bloom added back to the scene
+		float bloom_intensity;
+
+		//Pyramid levels, up to MAX_BLOOM_LEVELS
+		uint32_t bloom_levels;
+
+		//Darkening at the corners, 0 leaves them
+		float vignette;
+
+		//Applied through a lookup table on the sRGB-encoded image
+		bool color_grading;
+		float saturation;
+		float contrast;
+	};
+
+	//Everything off, with the parameters the chain uses once a stage is turned on
+	PostSettings DefaultPostSettings();
+
+	//Size of a pyramid level, half the size at level 0, rounded up
+	uint32_t BloomTargetSize(uint32_t size, uint32_t level);
+
+	//Scene at half resolution keeping only what's brighter than the threshold. 4 taps, which averages a
+	//4x4 block and keeps single bright pixels from flickering
+	void BloomBrightPass(const float* scene, uint32_t width, uint32_t height, float threshold, float knee,
+		float* bright, uint32_t bright_width, uint32_t bright_height);
+
+	//Dual-filter downsample: the center weighted 4 and the 4 diagonal corners of the source 2x2 block
+	void BloomDownsample(const float* src, uint32_t src_width, uint32_t src_height,
+		float* dst, uint32_t dst_width, uint32_t dst_height);
+
+	//Dual-filter upsample, added to dst: 4 taps 2 texels out along the axes and 4 diagonal ones weighted 2
+	void BloomUpsample(const float* src, uint32_t src_width, uint32_t src_height,
+		float* dst, uint32_t dst_width, uint32_t dst_height);
+
+	//size^3 texels of rgba, red fastest, from an sRGB-encoded color to the graded one
+	void BuildGradingLUT(const PostSettings& settings, uint32_t size, float* lut);
+
+	//The scene plus the upsampled bloom, vignetted, sRGB encoded and graded, at the scene's size. bloom
+	//is the first pyramid level, it and the lut may be null
+	void PostComposite(const float* scene, uint32_t width, uint32_t height, const float* bloom,
+		uint32_t bloom_width, uint32_t bloom_height, const PostSettings& settings, const float* lut, uint32_t lut_size,
+		float* out);
+
+}
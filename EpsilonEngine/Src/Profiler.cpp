@@ -0,0 +1,96 @@
+#include "Profiler.h"
+#include <chrono>
+
+
+namespace epsilon
+{
+
+	std::atomic<uint32_t> trace_thread_count_(0);
+	thread_local uint32_t tls_trace_thread_ = 0xFFFFFFFF;
+
+
+	TraceBuffer::TraceBuffer(uint32_t capacity /*= 16384*/)
+		: head_(0)
+	{
+		uint32_t size = 1;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		events_.reset(new TraceEvent[size]);
+		mask_ = size - 1;
+	}
+
+	void TraceBuffer::Push(const char* name, uint64_t begin_ns, uint64_t end_ns, TraceTrack track /*= TT_CPU*/,
+		uint32_t thread /*= CurrentThread()*/)
+	{
+		TraceEvent& e = events_[head_.fetch_add(1, std::memory_order_relaxed) & mask_];
+		e.name = name;
+		e.begin_ns = begin_ns;
+		e.end_ns = end_ns;
+		e.thread = thread;
+		e.track = track;
+	}
+
+	void TraceBuffer::Snapshot(std::vector<TraceEvent>& events) const
+	{
+		uint64_t head = head_.load(std::memory_order_acquire);
+		uint64_t count = head < mask_ + 1 ? head : mask_ + 1;
+
+		events.clear();
+		events.reserve(static_cast<size_t>(count));
+		for (uint64_t i = head - count; i != head; i++)
+		{
+			events.push_back(events_[i & mask_]);
+		}
+	}
+
+	void TraceBuffer::Clear()
+	{
+		head_.store(0, std::memory_order_release);
+	}
+
+	uint64_t TraceBuffer::NowNs()
+	{
+		static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	uint32_t TraceBuffer::CurrentThread()
+	{
+		if (0xFFFFFFFF == tls_trace_thread_)
+		{
+			tls_trace_thread_ = trace_thread_count_.fetch_add(1, std::memory_order_relaxed);
+		}
+		return tls_trace_thread_;
+	}
+
+
+	void WriteChromeTrace(std::ostream& os, const std::vector<TraceEvent>& events)
+	{
+		os << "{\"traceEvents\":[\n";
+		os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << TT_CPU << ",\"args\":{\"name\":\"CPU\"}},\n";
+		os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << TT_GPU << ",\"args\":{\"name\":\"GPU\"}}";
+
+		for (const auto& e : events)
+		{
+			os << ",\n{\"name\":\"";
+			for (const char* c = e.name; *c; c++)
+			{
+				if (('"' == *c) || ('\\' == *c))
+				{
+					os << '\\';
+				}
+				os << *c;
+			}
+
+			//Chrome expects microseconds
+			os << "\",\"ph\":\"X\",\"pid\":" << e.track << ",\"tid\":" << e.thread
+				<< ",\"ts\":" << e.begin_ns / 1000 << '.' << (e.begin_ns % 1000) / 100
+				<< ",\"dur\":" << (e.end_ns - e.begin_ns) / 1000 << '.' << ((e.end_ns - e.begin_ns) % 1000) / 100 << "}";
+		}
+
+		os << "\n]}\n";
+	}
+
+}
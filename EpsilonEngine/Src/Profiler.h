@@ -0,0 +1,92 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	enum TraceTrack
+	{
+		TT_CPU,
+		TT_GPU
+	};
+
+	//Names must outlive the buffer, string literals in practice
+	struct TraceEvent
+	{
+		const char* name;
+		uint64_t begin_ns;
+		uint64_t end_ns;
+		uint32_t thread;
+		uint32_t track;
+	};
+
+
+	//Milliseconds a named pass took on each side, gpu_ms stays 0 where nothing timed the GPU
+	struct PassTiming
+	{
+		const char* name;
+		double cpu_ms;
+		double gpu_ms;
+	};
+
+
+	//Fixed-size ring, writers claim a slot with one atomic increment and old events are overwritten.
+	//Keep the capacity well above the events of a frame so concurrent writers never lap each other
+	class TraceBuffer
+	{
+	public:
+		explicit TraceBuffer(uint32_t capacity = 16384);
+
+		void Push(const char* name, uint64_t begin_ns, uint64_t end_ns, TraceTrack track = TT_CPU, uint32_t thread = CurrentThread());
+
+		//Oldest first. Must not run concurrently with Push
+		void Snapshot(std::vector<TraceEvent>& events) const;
+
+		void Clear();
+
+		//Nanoseconds since the first call in the process
+		static uint64_t NowNs();
+
+		//Small sequential id of the calling thread
+		static uint32_t CurrentThread();
+
+	private:
+		std::unique_ptr<TraceEvent[]> events_;
+		uint32_t mask_;
+		std::atomic<uint64_t> head_;
+	};
+
+
+	class CPUTimerScope
+	{
+	public:
+		CPUTimerScope(TraceBuffer& trace, const char* name)
+			: trace_(trace), name_(name), begin_ns_(TraceBuffer::NowNs())
+		{
+		}
+
+		~CPUTimerScope()
+		{
+			trace_.Push(name_, begin_ns_, TraceBuffer::NowNs());
+		}
+
+	private:
+		CPUTimerScope(const CPUTimerScope&) = delete;
+		CPUTimerScope& operator=(const CPUTimerScope&) = delete;
+
+	private:
+		TraceBuffer& trace_;
+		const char* name_;
+		uint64_t begin_ns_;
+	};
+
+
+	//Writes the events in the Chrome trace event format, loadable in chrome://tracing
+	void WriteChromeTrace(std::ostream& os, const std::vector<TraceEvent>& events);
+
+}
@@ -16,6 +16,9 @@ namespace epsilon
 	class StaticMesh;
 	typedef std::shared_ptr<StaticMesh> StaticMeshPtr;
 
+	class Material;
+	typedef std::shared_ptr<Material> MaterialPtr;
+
 	class Quad;
 	typedef std::shared_ptr<Quad> QuadPtr;
 
@@ -31,6 +34,28 @@ namespace epsilon
 	class SpotLight;
 	typedef std::shared_ptr<SpotLight> SpotLightPtr;
 
+	class PointLight;
+	typedef std::shared_ptr<PointLight> PointLightPtr;
+
+	class LightBuffer;
+	typedef std::shared_ptr<LightBuffer> LightBufferPtr;
+
+	class TransformSystem;
+	typedef std::shared_ptr<TransformSystem> TransformSystemPtr;
+
+	class JobSystem;
+
+	class ConstantBufferRing;
+	typedef std::shared_ptr<ConstantBufferRing> ConstantBufferRingPtr;
+
+	class CommandList;
+	typedef std::shared_ptr<CommandList> CommandListPtr;
+
+	class CommandStream;
+
+	class GPUProfiler;
+	typedef std::shared_ptr<GPUProfiler> GPUProfilerPtr;
+
 }
 
 
@@ -1,18 +1,33 @@
 #include "RenderEngine.h"
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
 #include <array>
 #include <vector>
 #include <fstream>
+#include <thread>
+#include <sstream>
+#include <iomanip>
 #include <d3d11.h>
 #include <d3d11_1.h>
 #include <d3d11_2.h>
+#include <dxgi1_3.h>
 #include <d3dx11effect.h>
 #include <d3dcompiler.h>
+#include <DirectXCollision.h>
 #include "FrameBuffer.h"
 #include "Camera.h"
 #include "Renderable.h"
 #include "Light.h"
+#include "LightBuffer.h"
+#include "Transform.h"
+#include "CommandList.h"
+#include "CommandStream.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "AllocationCounter.h"
+#include "DDSTextureLoader\DDSTextureLoader.h"
+#include <DirectXPackedVector.h>
 
 
 namespace epsilon
@@ -28,12 +43,256 @@ namespace epsilon
 	D3D11CreateDeviceFunc DynamicD3D11CreateDevice_ = nullptr;
 	pD3DCompile DynamicD3DCompile_ = nullptr;
 
+	const size_t CULL_GRAIN = 64;
+	const size_t GBUFFER_CHUNK_MIN = 64;
+
+	//From the DXGI 1.4/1.5 headers, which the 8.1 SDK doesn't have
+	const DXGI_SWAP_EFFECT SWAP_EFFECT_FLIP_DISCARD = static_cast<DXGI_SWAP_EFFECT>(4);
+	const UINT SWAP_CHAIN_FLAG_ALLOW_TEARING = 2048;
+	const UINT PRESENT_ALLOW_TEARING = 0x00000200UL;
+
+	const DWORD FRAME_LATENCY_WAIT_TIMEOUT = 1000;
+
+	const uint64_t STATS_TITLE_INTERVAL = 30;
+
+	//Frames a released render target may sit unused in the pool
+	const uint64_t RENDER_TARGET_MAX_IDLE_FRAMES = 120;
+
+	//Spot light shadow pages share one atlas, sized from how large the light's cone is on screen
+	const uint32_t SHADOW_ATLAS_SIZE = 4096;
+	const uint32_t SHADOW_PAGE_MIN_SIZE = 128;
+	const uint32_t SHADOW_PAGE_MAX_SIZE = 1024;
+
+	//Frames an off-screen light keeps its page
+	const uint64_t SHADOW_PAGE_MAX_IDLE_FRAMES = 120;
+
+	//Direction light cascades split the view up to this distance, farther surfaces are unshadowed
+	const uint32_t CASCADE_PAGE_SIZE = 1024;
+	const float CASCADE_SHADOW_DISTANCE = 100;
+	const float CASCADE_SPLIT_LAMBDA = 0.75f;
+
+	//Room on each side of a staggered cascade, as a fraction of its slice's radius, for the camera
+	//to move in before the frame the cascade is next scheduled for
+	const float CASCADE_STAGGER_GUARD = 0.1f;
+
+	//Frames before the jitter repeats, and the weight of the current frame in the temporal resolve
+	const uint32_t TAA_JITTER_PERIOD = 8;
+	const float TAA_BLEND = 0.1f;
+
+	//Lattice points along each axis of the color grading table
+	const uint32_t GRADING_LUT_SIZE = 16;
+
+	//Environment maps are read at up to this size, and prefiltered for specular at up to the second
+	const uint32_t ENV_MAP_MAX_SIZE = 256;
+	const uint32_t ENV_SPECULAR_SIZE = 128;
+	const uint32_t ENV_SPECULAR_SAMPLES = 64;
+	const uint32_t SKY_CUBEMAP_SIZE = 64;
+
+	//The unfiltered sky bound until the first environment is prefiltered
+	const uint32_t ENV_PLACEHOLDER_SIZE = 16;
+
+#ifdef EPSILON_COUNT_ALLOCATIONS
+	const uint64_t ALLOCATION_CHECK_WARMUP_FRAMES = 16;
+#endif
+
+
+	//Bits per texel, or per 4x4 block divided by 16 for block-compressed formats
+	uint32_t DXGIFormatBitsPerPixel(DXGI_FORMAT fmt)
+	{
+		switch (fmt)
+		{
+		case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_UINT:
+		case DXGI_FORMAT_R32G32B32A32_SINT:
+			return 128;
+
+		case DXGI_FORMAT_R32G32B32_TYPELESS:
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+		case DXGI_FORMAT_R32G32B32_UINT:
+		case DXGI_FORMAT_R32G32B32_SINT:
+			return 96;
+
+		case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_UINT:
+		case DXGI_FORMAT_R16G16B16A16_SNORM:
+		case DXGI_FORMAT_R16G16B16A16_SINT:
+		case DXGI_FORMAT_R32G32_TYPELESS:
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R32G32_UINT:
+		case DXGI_FORMAT_R32G32_SINT:
+		case DXGI_FORMAT_R32G8X24_TYPELESS:
+		case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+			return 64;
+
+		case DXGI_FORMAT_R8G8_TYPELESS:
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R8G8_UINT:
+		case DXGI_FORMAT_R8G8_SNORM:
+		case DXGI_FORMAT_R8G8_SINT:
+		case DXGI_FORMAT_R16_TYPELESS:
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_D16_UNORM:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_UINT:
+		case DXGI_FORMAT_R16_SNORM:
+		case DXGI_FORMAT_R16_SINT:
+		case DXGI_FORMAT_B5G6R5_UNORM:
+		case DXGI_FORMAT_B5G5R5A1_UNORM:
+			return 16;
+
+		case DXGI_FORMAT_R8_TYPELESS:
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R8_UINT:
+		case DXGI_FORMAT_R8_SNORM:
+		case DXGI_FORMAT_R8_SINT:
+		case DXGI_FORMAT_A8_UNORM:
+		case DXGI_FORMAT_BC2_TYPELESS:
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_TYPELESS:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_TYPELESS:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_TYPELESS:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_BC7_TYPELESS:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return 8;
+
+		case DXGI_FORMAT_BC1_TYPELESS:
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_TYPELESS:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			return 4;
+
+		default:
+			//R16G16, R8G8B8A8, R32 and the packed depth formats
+			return 32;
+		}
+	}
+
+	bool DXGIFormatIsBlockCompressed(DXGI_FORMAT fmt)
+	{
+		return ((fmt >= DXGI_FORMAT_BC1_TYPELESS) && (fmt <= DXGI_FORMAT_BC5_SNORM))
+			|| ((fmt >= DXGI_FORMAT_BC6H_TYPELESS) && (fmt <= DXGI_FORMAT_BC7_UNORM_SRGB));
+	}
+
+	float SRGBToLinear(float c)
+	{
+		return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	//Top mip of a staging cubemap as rgba floats. False for formats other than 32 and 16-bit float and 8-bit rgba
+	bool ReadStagingCubemap(ID3D11DeviceContext* ctx, ID3D11Texture2D* tex, Cubemap& cube)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		tex->GetDesc(&desc);
+
+		bool srgb = false;
+		switch (desc.Format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			srgb = true;
+			break;
+
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+			break;
+
+		default:
+			return false;
+		}
+		if ((desc.ArraySize != 6) || !(desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) || (desc.Width != desc.Height))
+		{
+			return false;
+		}
+		bool bgra = (DXGI_FORMAT_B8G8R8A8_UNORM == desc.Format) || (DXGI_FORMAT_B8G8R8A8_UNORM_SRGB == desc.Format);
+
+		AllocateCubemap(desc.Width, cube);
+		for (uint32_t face = 0; face != 6; face++)
+		{
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			THROW_FAILED(ctx->Map(tex, D3D11CalcSubresource(0, face, desc.MipLevels), D3D11_MAP_READ, 0, &mapped));
+
+			for (uint32_t y = 0; y != desc.Height; y++)
+			{
+				const uint8_t* row = static_cast<const uint8_t*>(mapped.pData) + y * mapped.RowPitch;
+				float* dst = &cube.texels[((static_cast<size_t>(face) * desc.Height + y) * desc.Width) * 4];
+				for (uint32_t x = 0; x != desc.Width * 4; x++)
+				{
+					switch (desc.Format)
+					{
+					case DXGI_FORMAT_R32G32B32A32_FLOAT:
+						dst[x] = reinterpret_cast<const float*>(row)[x];
+						break;
+
+					case DXGI_FORMAT_R16G16B16A16_FLOAT:
+						dst[x] = PackedVector::XMConvertHalfToFloat(reinterpret_cast<const PackedVector::HALF*>(row)[x]);
+						break;
+
+					default:
+						{
+							//Swizzle bgra, alpha stays in place
+							uint32_t c = x & 3;
+							uint32_t src = (bgra && (c != 3)) ? (x - c + 2 - c) : x;
+							float value = row[src] / 255.0f;
+							dst[x] = (srgb && (c != 3)) ? SRGBToLinear(value) : value;
+						}
+						break;
+					}
+				}
+			}
+
+			ctx->Unmap(tex, D3D11CalcSubresource(0, face, desc.MipLevels));
+		}
+
+		return true;
+	}
+
 
 	RenderEngine::RenderEngine()
 	{
 		wnd_ = nullptr;
 		width_ = 0;
 		height_ = 0;
+		render_width_ = 0;
+		render_height_ = 0;
+		rt_width_ = 0;
+		rt_height_ = 0;
+		drs_enabled_ = false;
+		drs_resolved_frames_ = 0;
+		stagger_cascades_ = false;
+		ao_quality_ = SQ_Off;
+		this->SetAmbientOcclusion(SQ_Medium);
+		taa_enabled_ = false;
+		taa_frame_ = 0;
+		taa_index_ = 0;
+		taa_history_valid_ = false;
+		taa_prev_view_proj_ = XMMatrixIdentity();
+		post_settings_ = DefaultPostSettings();
+		compute_lighting_ = false;
+		env_lighting_ = {};
+		job_system_ = nullptr;
+		max_frames_in_flight_ = 2;
+		show_stats_ = false;
+		present_mode_ = PM_Discard;
+		swap_chain_flags_ = 0;
+		sync_interval_ = 0;
+		present_flags_ = 0;
+		frame_latency_waitable_ = nullptr;
+		pacer_.TargetInterval(1.0 / 60);
 
 		if (!DynamicFuncInit_)
 		{
@@ -125,6 +384,30 @@ namespace epsilon
 		quad_ = std::make_shared<Quad>();
 		quad_->SetRE(*this);
 
+		transforms_ = std::make_shared<TransformSystem>();
+
+		this->CreateFrameQueries();
+
+		gpu_profiler_ = std::make_shared<GPUProfiler>();
+		gpu_profiler_->SetRE(*this);
+		gpu_profiler_->Create(trace_);
+
+		shadow_atlas_fb_ = std::make_shared<FrameBuffer>();
+		shadow_atlas_fb_->SetRE(*this);
+		shadow_atlas_fb_->Create(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 0);
+		shadow_cache_.Reset(SHADOW_ATLAS_SIZE, SHADOW_PAGE_MIN_SIZE);
+
+		light_buffer_ = std::make_shared<LightBuffer>();
+		light_buffer_->SetRE(*this);
+
+		//A small sky with a single mip lights the frames until the job building the environment finishes
+		std::vector<Cubemap> placeholder(1);
+		BuildSkyCubemap(ENV_PLACEHOLDER_SIZE, placeholder[0]);
+		ProjectSH9(placeholder[0], env_lighting_.irradiance_sh);
+		ConvolveSH9Irradiance(env_lighting_.irradiance_sh);
+		this->CreateEnvironmentTexture(placeholder);
+		this->StartEnvironmentBuild();
+
 		this->Resize(width, height);
 
 		this->LoadEffect("../../../Media/Effect/DeferredRendering.fx");
@@ -134,62 +417,56 @@ namespace epsilon
 	{
 		width_ = width;
 		height_ = height;
+		this->UpdateRenderSize();
 
 		d3d_imm_ctx_->OMSetRenderTargets(0, 0, 0);
 		d3d_imm_ctx_->OMSetDepthStencilState(0, 0);
 
-		gbuffer_fb_.reset();
-		lighting_fb_.reset();
 		srgb_fb_.reset();
 
 		//SwapChain
-		IDXGISwapChain1* dxgi_sc = nullptr;
 		if (gi_swap_chain_1_)
 		{
-			dxgi_sc = gi_swap_chain_1_.get();
-			THROW_FAILED(dxgi_sc->ResizeBuffers(2, width_, height_, DXGI_FORMAT_R8G8B8A8_UNORM,
-				DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+			THROW_FAILED(gi_swap_chain_1_->ResizeBuffers(2, width_, height_, DXGI_FORMAT_R8G8B8A8_UNORM, swap_chain_flags_));
 		}
 		else
 		{
-			DXGI_SWAP_CHAIN_DESC1 sc_desc1;
-			ZeroMemory(&sc_desc1, sizeof(sc_desc1));
-			sc_desc1.Width = width_;
-			sc_desc1.Height = height_;
-			sc_desc1.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			sc_desc1.Stereo = false;
-			sc_desc1.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-			sc_desc1.BufferCount = 2;
-			sc_desc1.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-			sc_desc1.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
-			sc_desc1.SampleDesc.Count = 1;
-			sc_desc1.SampleDesc.Quality = 0;
-			sc_desc1.Scaling = DXGI_SCALING_STRETCH;
-			sc_desc1.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-
-			DXGI_SWAP_CHAIN_FULLSCREEN_DESC sc_fs_desc;
-			sc_fs_desc.RefreshRate.Numerator = 60;
-			sc_fs_desc.RefreshRate.Denominator = 1;
-			sc_fs_desc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-			sc_fs_desc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-			sc_fs_desc.Windowed = true;
-
-			THROW_FAILED(gi_factory_2_->CreateSwapChainForHwnd(d3d_device_.get(), wnd_, &sc_desc1, &sc_fs_desc, nullptr, &dxgi_sc));
-			gi_swap_chain_1_ = MakeCOMPtr(dxgi_sc);
+			this->CreateSwapChain();
 		}
+		IDXGISwapChain1* dxgi_sc = gi_swap_chain_1_.get();
 
-		//Frame buffers
-		gbuffer_fb_ = std::make_shared<FrameBuffer>();
-		gbuffer_fb_->SetRE(*this);
-		gbuffer_fb_->Create(width_, height_, 2);
-
-		linear_depth_fb_ = std::make_shared<FrameBuffer>(DXGI_FORMAT_R32_FLOAT);
-		linear_depth_fb_->SetRE(*this);
-		linear_depth_fb_->Create(width_, height_, 1);
-
-		lighting_fb_ = std::make_shared<FrameBuffer>();
-		lighting_fb_->SetRE(*this);
-		lighting_fb_->Create(width_, height_, 1);
+		//Frame buffers. While the window stays inside the allocated extent only the viewport changes,
+		//otherwise the old targets go back to the pool before the new ones are taken from it
+		if (!gbuffer_fb_ || !RenderTargetCovers(rt_width_, width_) || !RenderTargetCovers(rt_height_, height_))
+		{
+			rt_width_ = RenderTargetSizeClass(width_);
+			rt_height_ = RenderTargetSizeClass(height_);
+
+			gbuffer_fb_.reset();
+			linear_depth_fb_.reset();
+			ao_fb_.reset();
+			lighting_fb_.reset();
+			taa_fbs_[0].reset();
+			taa_fbs_[1].reset();
+			bloom_fbs_.clear();
+
+			gbuffer_fb_ = std::make_shared<FrameBuffer>();
+			gbuffer_fb_->SetRE(*this);
+			gbuffer_fb_->Create(rt_width_, rt_height_, 2);
+
+			linear_depth_fb_ = std::make_shared<FrameBuffer>(DXGI_FORMAT_R32_FLOAT);
+			linear_depth_fb_->SetRE(*this);
+			linear_depth_fb_->Create(rt_width_, rt_height_, 1);
+
+			//Written by the lighting passes or the tiled lighting compute shader
+			lighting_fb_ = std::make_shared<FrameBuffer>(DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_UNORDERED_ACCESS);
+			lighting_fb_->SetRE(*this);
+			lighting_fb_->Create(rt_width_, rt_height_, 1);
+
+			this->CreateAOTarget();
+			this->CreateTAATargets();
+			this->CreateBloomTargets();
+		}
 
 		ID3D11Texture2D* frame_buffer = nullptr;
 		THROW_FAILED(dxgi_sc->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&frame_buffer));
@@ -202,15 +479,194 @@ namespace epsilon
 		frame_buffer = nullptr;
 
 		//Viewport
-		D3D11_VIEWPORT viewport;
-		viewport.Width = (float)width_;
-		viewport.Height = (float)height_;
-		viewport.MinDepth = 0.0f;
-		viewport.MaxDepth = 1.0f;
-		viewport.TopLeftX = 0.0f;
-		viewport.TopLeftY = 0.0f;
+		this->D3DSetViewport(d3d_imm_ctx_.get());
+	}
+
+	void RenderEngine::CreateSwapChain()
+	{
+		DXGI_SWAP_CHAIN_DESC1 sc_desc1;
+		ZeroMemory(&sc_desc1, sizeof(sc_desc1));
+		sc_desc1.Width = width_;
+		sc_desc1.Height = height_;
+		sc_desc1.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		sc_desc1.Stereo = false;
+		sc_desc1.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		sc_desc1.BufferCount = 2;
+		sc_desc1.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+		sc_desc1.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+		sc_desc1.SampleDesc.Count = 1;
+		sc_desc1.SampleDesc.Quality = 0;
+		sc_desc1.Scaling = DXGI_SCALING_STRETCH;
+		sc_desc1.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+
+		DXGI_SWAP_CHAIN_FULLSCREEN_DESC sc_fs_desc;
+		sc_fs_desc.RefreshRate.Numerator = 60;
+		sc_fs_desc.RefreshRate.Denominator = 1;
+		sc_fs_desc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
+		sc_fs_desc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+		sc_fs_desc.Windowed = true;
+
+		sync_interval_ = 0;
+		present_flags_ = 0;
+
+		IDXGISwapChain1* dxgi_sc = nullptr;
+		HRESULT hr = E_FAIL;
+		switch (present_mode_)
+		{
+		case PM_FlipWaitable:
+			sc_desc1.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+			sc_desc1.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+			hr = gi_factory_2_->CreateSwapChainForHwnd(d3d_device_.get(), wnd_, &sc_desc1, &sc_fs_desc, nullptr, &dxgi_sc);
+			sync_interval_ = 1;
+			break;
+
+		case PM_Tearing:
+			sc_desc1.SwapEffect = SWAP_EFFECT_FLIP_DISCARD;
+			sc_desc1.Flags |= SWAP_CHAIN_FLAG_ALLOW_TEARING;
+			hr = gi_factory_2_->CreateSwapChainForHwnd(d3d_device_.get(), wnd_, &sc_desc1, &sc_fs_desc, nullptr, &dxgi_sc);
+			if (SUCCEEDED(hr))
+			{
+				present_flags_ = PRESENT_ALLOW_TEARING;
+			}
+			else
+			{
+				//No tearing support before Windows 10, flip without it
+				sc_desc1.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+				sc_desc1.Flags &= ~SWAP_CHAIN_FLAG_ALLOW_TEARING;
+				hr = gi_factory_2_->CreateSwapChainForHwnd(d3d_device_.get(), wnd_, &sc_desc1, &sc_fs_desc, nullptr, &dxgi_sc);
+			}
+			break;
+
+		case PM_FixedCap:
+			sc_desc1.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+			hr = gi_factory_2_->CreateSwapChainForHwnd(d3d_device_.get(), wnd_, &sc_desc1, &sc_fs_desc, nullptr, &dxgi_sc);
+			break;
+
+		default:
+			break;
+		}
+
+		if (FAILED(hr))
+		{
+			//Flip model needs Windows 8, fall back to the blt model
+			sc_desc1.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+			sc_desc1.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+			sync_interval_ = 0;
+			present_flags_ = 0;
+			THROW_FAILED(gi_factory_2_->CreateSwapChainForHwnd(d3d_device_.get(), wnd_, &sc_desc1, &sc_fs_desc, nullptr, &dxgi_sc));
+		}
+		gi_swap_chain_1_ = MakeCOMPtr(dxgi_sc);
+		swap_chain_flags_ = sc_desc1.Flags;
+
+		if (sc_desc1.Flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT)
+		{
+			IDXGISwapChain2* dxgi_sc_2 = nullptr;
+			THROW_FAILED(dxgi_sc->QueryInterface(__uuidof(IDXGISwapChain2), reinterpret_cast<void**>(&dxgi_sc_2)));
+			gi_swap_chain_2_ = MakeCOMPtr(dxgi_sc_2);
+
+			THROW_FAILED(gi_swap_chain_2_->SetMaximumFrameLatency(max_frames_in_flight_));
+			frame_latency_waitable_ = gi_swap_chain_2_->GetFrameLatencyWaitableObject();
+		}
+
+		pacer_.ResetStats();
+	}
+
+	void RenderEngine::DestroySwapChain()
+	{
+		if (frame_latency_waitable_)
+		{
+			::CloseHandle(frame_latency_waitable_);
+			frame_latency_waitable_ = nullptr;
+		}
+
+		gi_swap_chain_2_.reset();
+		gi_swap_chain_1_.reset();
+	}
+
+	void RenderEngine::SetPresentMode(PresentMode mode)
+	{
+		present_mode_ = mode;
+
+		if (gi_swap_chain_1_)
+		{
+			gi_swap_chain_1_->SetFullscreenState(false, nullptr);
+
+			//Drop every reference to the old back buffers before recreating
+			srgb_fb_.reset();
+			d3d_imm_ctx_->ClearState();
+			d3d_imm_ctx_->Flush();
+
+			this->DestroySwapChain();
+			this->Resize(width_, height_);
+		}
+	}
+
+	RenderEngine::PresentMode RenderEngine::GetPresentMode() const
+	{
+		return present_mode_;
+	}
+
+	void RenderEngine::SetFrameRateCap(float fps)
+	{
+		pacer_.TargetInterval(fps > 0 ? 1.0 / fps : 0.0);
+	}
+
+	FrameTimeStats RenderEngine::FrameStats() const
+	{
+		return pacer_.Stats();
+	}
+
+	TraceBuffer& RenderEngine::Trace()
+	{
+		return trace_;
+	}
+
+	const std::vector<PassTiming>& RenderEngine::PassTimings() const
+	{
+		return gpu_profiler_->LastTimings();
+	}
+
+	void RenderEngine::WriteTrace(const std::string& path)
+	{
+		std::vector<TraceEvent> events;
+		trace_.Snapshot(events);
+
+		std::ofstream ofs(path);
+		WriteChromeTrace(ofs, events);
+	}
+
+	const RenderStatistics& RenderEngine::Statistics() const
+	{
+		return stats_;
+	}
+
+	void RenderEngine::ShowStatistics(bool show)
+	{
+		show_stats_ = show;
+	}
+
+	void RenderEngine::LogStatistics(const std::string& csv_path)
+	{
+		if (stats_csv_.is_open())
+		{
+			stats_csv_.close();
+		}
 
-		d3d_imm_ctx_->RSSetViewports(1, &viewport);
+		if (!csv_path.empty())
+		{
+			stats_csv_.open(csv_path);
+			stats_.WriteCsvHeader(stats_csv_);
+		}
+	}
+
+	void RenderEngine::SetJobSystem(JobSystem& js)
+	{
+		job_system_ = &js;
+	}
+
+	JobSystem& RenderEngine::Jobs()
+	{
+		return *job_system_;
 	}
 
 	void RenderEngine::Destory()
@@ -225,16 +681,46 @@ namespace epsilon
 
 		gbuffer_fb_.reset();
 		linear_depth_fb_.reset();
+		ao_fb_.reset();
 		lighting_fb_.reset();
+		taa_fbs_[0].reset();
+		taa_fbs_[1].reset();
+		bloom_fbs_.clear();
+		grading_lut_srv_.reset();
+		grading_lut_.reset();
+
+		//The jobs write into the builds, so they finish first. Teardown has no use for what they threw
+		for (auto& build : env_builds_)
+		{
+			while (!build->counter.Done())
+			{
+				std::this_thread::yield();
+			}
+		}
+		env_builds_.clear();
+		env_specular_srv_.reset();
+		env_specular_tex_.reset();
 		srgb_fb_.reset();
+		shadow_atlas_fb_.reset();
+		light_buffer_.reset();
+		rt_pool_.Clear();
 
 		quad_.reset();
 
+		imm_cl_.reset();
+		deferred_cls_.clear();
+
+		frame_queries_.clear();
+
+		gpu_profiler_.reset();
+
+		transforms_.reset();
+
 		d3d_effect_.reset();
 		d3d_imm_ctx_.reset();
 		d3d_device_.reset();
 
-		gi_swap_chain_1_.reset();
+		this->DestroySwapChain();
 		gi_adapter_.reset();
 		gi_factory_1_.reset();
 		gi_factory_2_.reset();
@@ -267,149 +753,1335 @@ namespace epsilon
 		THROW_FAILED(hr);
 
 		d3d_effect_ = MakeCOMPtr(d3d_effect);
+
+		this->CreateCommandLists();
+	}
+
+	void RenderEngine::CreateCommandLists()
+	{
+		imm_cl_ = std::make_shared<CommandList>();
+		imm_cl_->SetRE(*this);
+		imm_cl_->CreateImmediate(d3d_imm_ctx_.get(), d3d_effect_.get());
+
+		//One deferred list per thread that can record in parallel
+		deferred_cls_.clear();
+		for (uint32_t i = 0; i != job_system_->NumWorkers() + 1; i++)
+		{
+			CommandListPtr cl = std::make_shared<CommandList>();
+			cl->SetRE(*this);
+			cl->CreateDeferred(d3d_effect_.get());
+			deferred_cls_.push_back(cl);
+		}
+		deferred_css_.resize(deferred_cls_.size());
 	}
 
 	void RenderEngine::SetCamera(CameraPtr cam)
 	{
 		cam_ = cam;
+		this->InvalidatePackets();
 	}
 
 	void RenderEngine::AddRenderable(RenderablePtr r)
 	{
 		rs_.push_back(r);
+		this->InvalidatePackets();
 	}
 
 	void RenderEngine::SetAmbientLight(AmbientLightPtr al)
 	{
 		ambient_light_ = al;
+		this->InvalidatePackets();
 	}
 
 	void RenderEngine::AddDirectionLight(DirectionLightPtr dl)
 	{
 		dir_lights_.push_back(dl);
+		this->InvalidatePackets();
 	}
 
 	void RenderEngine::AddSpotLight(SpotLightPtr sl)
 	{
 		spot_lights_.push_back(sl);
+		this->InvalidatePackets();
+	}
+
+	void RenderEngine::AddPointLight(PointLightPtr pl)
+	{
+		point_lights_.push_back(pl);
+		this->InvalidatePackets();
 	}
 
 	void RenderEngine::Frame()
 	{
-		ID3DX11EffectTechnique* tech = d3d_effect_->GetTechniqueByName("DeferredRendering");
+#ifdef EPSILON_COUNT_ALLOCATIONS
+		uint64_t num_allocs = HeapAllocationCount();
+#endif
 
-		//GBuffer pass
-		ID3DX11EffectPass* pass = tech->GetPassByName("GBuffer");
+		frame_pipeline_.Frame(*job_system_,
+			[this](FramePacket& packet) { this->Update(packet); },
+			[this](FramePacket& packet) { this->Submit(packet); });
 
-		gbuffer_fb_->Clear();
-		gbuffer_fb_->Bind();
+		//Every job of this frame has finished
+		LinearArena::ResetThreadLocals();
+
+		rt_pool_.Trim(RENDER_TARGET_MAX_IDLE_FRAMES);
 
-		cam_->Bind(d3d_effect_.get());
-		for (auto i = rs_.begin(); i != rs_.end(); i++)
+#ifdef EPSILON_COUNT_ALLOCATIONS
+		//Once caches and arenas have grown to fit, a frame must not touch the heap
+		if (frame_pipeline_.FrameIndex() > ALLOCATION_CHECK_WARMUP_FRAMES)
 		{
-			RenderablePtr r = *i;
-			r->Render(d3d_effect_.get(), pass);
+			assert(HeapAllocationCount() == num_allocs);
 		}
+#endif
+	}
 
-		//Linear depth pass
-		pass = tech->GetPassByName("LinearDepth");
-
-		linear_depth_fb_->Clear();
-		linear_depth_fb_->Bind();
+	void RenderEngine::SetPipelined(bool pipelined)
+	{
+		frame_pipeline_.Pipelined(pipelined);
+		this->InvalidatePackets();
+	}
 
-		auto var_g_pp_tex = d3d_effect_->GetVariableByName("g_pp_tex")->AsShaderResource();
-		auto var_g_near_q_far = d3d_effect_->GetVariableByName("g_near_q_far")->AsVector();
+	void RenderEngine::InvalidatePackets()
+	{
+		frame_pipeline_.Invalidate();
+		shadow_cache_.Invalidate();
+	}
 
-		var_g_pp_tex->SetResource(gbuffer_fb_->RetriveDSShaderResourceView());
+	void RenderEngine::SetMaxFramesInFlight(uint32_t n)
+	{
+		max_frames_in_flight_ = (std::max)(n, 1u);
+		this->CreateFrameQueries();
 
-		float q = cam_->far_plane_ / (cam_->far_plane_ - cam_->near_plane_);
-		Vector4f near_q_far(cam_->near_plane_ * q, q, cam_->far_plane_, 1 / cam_->far_plane_);
-		var_g_near_q_far->SetFloatVector((float*)&near_q_far);
+		if (gi_swap_chain_2_)
+		{
+			THROW_FAILED(gi_swap_chain_2_->SetMaximumFrameLatency(max_frames_in_flight_));
+		}
+	}
 
-		quad_->Render(d3d_effect_.get(), pass);
+	void RenderEngine::CreateFrameQueries()
+	{
+		D3D11_QUERY_DESC d3d_query_desc;
+		d3d_query_desc.Query = D3D11_QUERY_EVENT;
+		d3d_query_desc.MiscFlags = 0;
 
-		//Lighting-kind passes
-		lighting_fb_->Clear();
-		lighting_fb_->Bind();
+		frames_in_flight_.Reset(max_frames_in_flight_);
+		frame_queries_.resize(max_frames_in_flight_);
+		for (uint32_t i = 0; i != max_frames_in_flight_; i++)
+		{
+			ID3D11Query* d3d_query = nullptr;
+			THROW_FAILED(d3d_device_->CreateQuery(&d3d_query_desc, &d3d_query));
+			frame_queries_[i] = MakeCOMPtr(d3d_query);
+		}
 
-		auto var_g_buffer_tex = d3d_effect_->GetVariableByName("g_buffer_tex")->AsShaderResource();
-		auto var_g_buffer_1_tex = d3d_effect_->GetVariableByName("g_buffer_1_tex")->AsShaderResource();
-		var_g_buffer_tex->SetResource(gbuffer_fb_->RetriveRTShaderResourceView(0));
-		var_g_buffer_1_tex->SetResource(gbuffer_fb_->RetriveRTShaderResourceView(1));
+		IDXGIDevice1* dxgi_device = nullptr;
+		if (SUCCEEDED(d3d_device_->QueryInterface(__uuidof(IDXGIDevice1), reinterpret_cast<void**>(&dxgi_device))))
+		{
+			dxgi_device->SetMaximumFrameLatency(max_frames_in_flight_);
+			dxgi_device->Release();
+		}
+	}
 
-		//Ambient lighting pass
-		pass = tech->GetPassByName("AmbientLighting");
+	void RenderEngine::WaitForFrameLatency()
+	{
+		//Block until the GPU has finished the frame that last used this slot
+		uint64_t completed = frames_in_flight_.WaitForSlot(frame_pipeline_.FrameIndex(), [this](size_t slot)
+		{
+			BOOL done = FALSE;
+			return S_FALSE != d3d_imm_ctx_->GetData(frame_queries_[slot].get(), &done, sizeof(done), 0);
+		});
+		if (completed != NO_FRAME_IN_FLIGHT)
+		{
+			imm_cl_->ReleaseCompleted(completed);
+		}
+	}
 
-		ambient_light_->Bind(d3d_effect_.get(), cam_.get());
+	void RenderEngine::Update(FramePacket& packet)
+	{
+		CPUTimerScope timer(trace_, "Update");
 
-		quad_->Render(d3d_effect_.get(), pass);
+		transforms_->Update();
 
-		//Direction lighting pass for each
-		pass = tech->GetPassByName("DirectionLighting");
+		//Frustum culling
+		BoundingFrustum frustum(cam_->proj_);
+		frustum.Transform(frustum, cam_->view_.Inverse());
 
-		for (auto i : dir_lights_)
+		visible_.resize(rs_.size());
+		job_system_->ParallelFor(rs_.size(), CULL_GRAIN, [this, &frustum](size_t begin, size_t end)
 		{
-			i->Bind(d3d_effect_.get(), cam_.get());
+			for (size_t i = begin; i != end; i++)
+			{
+				BoundingBox bounds;
+				visible_[i] = (!rs_[i]->WorldBounds(bounds) || frustum.Intersects(bounds)) ? 1 : 0;
+			}
+		});
 
-			quad_->Render(d3d_effect_.get(), pass);
+		packet.arena.Reset();
+
+		packet.draws.Allocate(packet.arena, rs_.size());
+		for (size_t i = 0; i != rs_.size(); i++)
+		{
+			if (visible_[i])
+			{
+				DrawItem item;
+				item.r = rs_[i].get();
+				item.model_mat = rs_[i]->ModelMatrix();
+				packet.draws.push_back(item);
+			}
 		}
 
-		//Spot lighting pass for each
-		pass = tech->GetPassByName("SpotLighting");
+		//Snapshot the scene state the submit stage reads. The camera without jitter, that depends on the
+		//render size of the frame it's submitted in
+		packet.cam = *cam_;
 
-		auto var_g_depth_tex = d3d_effect_->GetVariableByName("g_depth_tex")->AsShaderResource();
-		var_g_depth_tex->SetResource(linear_depth_fb_->RetriveRTShaderResourceView(0));
+		packet.ambient_light = *ambient_light_;
 
-		for (auto i : spot_lights_)
+		packet.dir_lights.Allocate(packet.arena, dir_lights_.size());
+		for (const auto& dl : dir_lights_)
 		{
-			i->Bind(d3d_effect_.get(), cam_.get());
+			packet.dir_lights.push_back(*dl);
+		}
 
-			quad_->Render(d3d_effect_.get(), pass);
+		packet.spot_lights.Allocate(packet.arena, spot_lights_.size());
+		for (const auto& sl : spot_lights_)
+		{
+			packet.spot_lights.push_back(*sl);
 		}
 
-		//SRGBCorrection pass
-		srgb_fb_->Clear();
-		srgb_fb_->Bind();
+		packet.point_lights.Allocate(packet.arena, point_lights_.size());
+		for (const auto& pl : point_lights_)
+		{
+			if (frustum.Intersects(BoundingSphere(pl->pos_, pl->EffectiveRange())))
+			{
+				packet.point_lights.push_back(*pl);
+			}
+		}
 
-		pass = tech->GetPassByName("SRGBCorrection");
+		this->UpdateShadows(packet, frustum);
+	}
 
-		var_g_pp_tex->SetResource(lighting_fb_->RetriveRTShaderResourceView(0));
+	void RenderEngine::UpdateShadows(FramePacket& packet, const BoundingFrustum& frustum)
+	{
+		shadow_cache_.BeginFrame();
 
-		quad_->Render(d3d_effect_.get(), pass);
+		packet.spot_shadows.Allocate(packet.arena, spot_lights_.size());
+		size_t num_views = spot_lights_.size() + dir_lights_.size() * MAX_SHADOW_CASCADES;
+		packet.shadow_casters.Allocate(packet.arena, rs_.size() * num_views);
 
-		gi_swap_chain_1_->Present(0, 0);
-	}
+		float proj_scale = 1 / tan(cam_->ang_ / 2);
 
-	IDXGISwapChain1* RenderEngine::DXGISwapChain()
-	{
-		return gi_swap_chain_1_.get();
-	}
+		for (uint32_t i = 0; i != spot_lights_.size(); i++)
+		{
+			const SpotLight& sl = *spot_lights_[i];
 
-	ID3D11Device* RenderEngine::D3DDevice()
-	{
-		return d3d_device_.get();
-	}
+			ShadowView shadow = {};
 
-	ID3D11DeviceContext* RenderEngine::D3DContext()
-	{
-		return d3d_imm_ctx_.get();
+			//Lights off screen keep their page until it is trimmed
+			Vector3f dir = Normalize(sl.dir_);
+			Vector3f center;
+			float radius;
+			SpotLightBoundingSphere(&sl.pos_.x, &dir.x, sl.range_, sl.OuterAngle(), &center.x, radius);
+			if (!frustum.Intersects(BoundingSphere(center, radius)))
+			{
+				packet.spot_shadows.push_back(shadow);
+				continue;
+			}
+
+			Matrix view, proj;
+			sl.ShadowMatrices(view, proj);
+			XMStoreFloat4x4(&shadow.view_proj, view * proj);
+
+			BoundingFrustum light_frustum(proj);
+			light_frustum.Transform(light_frustum, view.Inverse());
+
+			ShadowHash light_hash;
+			light_hash.Add(sl.pos_);
+			light_hash.Add(dir);
+			light_hash.Add(sl.range_);
+			light_hash.Add(sl.OuterAngle());
+
+			//Which renderables are in the cone and where they are
+			ShadowHash casters_hash;
+			shadow.first_caster = static_cast<uint32_t>(packet.shadow_casters.size());
+			for (size_t r = 0; r != rs_.size(); r++)
+			{
+				BoundingBox bounds;
+				if (rs_[r]->WorldBounds(bounds) && !light_frustum.Intersects(bounds))
+				{
+					continue;
+				}
+
+				DrawItem item;
+				item.r = rs_[r].get();
+				item.model_mat = rs_[r]->ModelMatrix();
+				packet.shadow_casters.push_back(item);
+
+				casters_hash.Add(r);
+				casters_hash.Add(item.model_mat);
+			}
+			shadow.num_casters = static_cast<uint32_t>(packet.shadow_casters.size()) - shadow.first_caster;
+
+			float projected_size = ProjectedSphereSize(Length(center - cam_->eye_pos_), radius, proj_scale, (float)height_);
+			uint32_t page_size = ShadowPageSize(projected_size, shadow_cache_.PageSize(i),
+				SHADOW_PAGE_MIN_SIZE, SHADOW_PAGE_MAX_SIZE);
+
+			shadow.render = shadow_cache_.Update(i, light_hash.Value(), casters_hash.Value(), page_size, shadow.page);
+			if (!shadow.render)
+			{
+				packet.shadow_casters.resize(shadow.first_caster);
+				shadow.num_casters = 0;
+			}
+
+			packet.spot_shadows.push_back(shadow);
+		}
+
+		this->UpdateCascades(packet);
+
+		shadow_cache_.Trim(SHADOW_PAGE_MAX_IDLE_FRAMES);
 	}
 
-	HRESULT RenderEngine::D3DCompile(std::string const & src_data, const char* entry_point, const char* target,
-		std::vector<uint8_t>& code, std::string& error_msgs) const
+	void RenderEngine::UpdateCascades(FramePacket& packet)
 	{
-		ID3DBlob* code_blob = nullptr;
-		ID3DBlob* error_msgs_blob = nullptr;
-
-		uint32_t const flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_PREFER_FLOW_CONTROL | D3DCOMPILE_SKIP_OPTIMIZATION;
-		HRESULT hr = DynamicD3DCompile_(src_data.c_str(), static_cast<UINT>(src_data.size()),
-			nullptr, nullptr, nullptr, entry_point,
-			target, flags, 0, &code_blob, &error_msgs_blob);
-		if (code_blob)
+		packet.cascade_shadows.Allocate(packet.arena, dir_lights_.size() * MAX_SHADOW_CASCADES);
+		packet.cascades.Allocate(packet.arena, dir_lights_.size() * MAX_SHADOW_CASCADES);
+		if (dir_lights_.empty())
 		{
-			uint8_t const * p = static_cast<uint8_t const *>(code_blob->GetBufferPointer());
-			code.assign(p, p + code_blob->GetBufferSize());
-			code_blob->Release();
+			return;
+		}
+
+		cascades_.resize(dir_lights_.size() * MAX_SHADOW_CASCADES);
+
+		//Depth of every cascade spans the scene, renderables without bounds are drawn into all of them
+		BoundingBox scene_bounds;
+		bool has_scene_bounds = false;
+		for (const auto& r : rs_)
+		{
+			BoundingBox bounds;
+			if (r->WorldBounds(bounds))
+			{
+				if (has_scene_bounds)
+				{
+					BoundingBox::CreateMerged(scene_bounds, scene_bounds, bounds);
+				}
+				else
+				{
+					scene_bounds = bounds;
+					has_scene_bounds = true;
+				}
+			}
+		}
+		const float* scene_center = has_scene_bounds ? &scene_bounds.Center.x : nullptr;
+		const float* scene_extents = has_scene_bounds ? &scene_bounds.Extents.x : nullptr;
+
+		float splits[MAX_SHADOW_CASCADES + 1];
+		CascadeSplits(cam_->near_plane_, (std::min)(cam_->far_plane_, CASCADE_SHADOW_DISTANCE),
+			MAX_SHADOW_CASCADES, CASCADE_SPLIT_LAMBDA, splits);
+
+		Vector3f forward = cam_->ForwardVec();
+		float tan_half_fov = tan(cam_->ang_ / 2);
+
+		//Spot lights take the first pages of the cache
+		uint32_t first_id = static_cast<uint32_t>(spot_lights_.size());
+
+		for (uint32_t d = 0; d != dir_lights_.size(); d++)
+		{
+			//dir_ points at the light
+			Vector3f light_dir = -dir_lights_[d]->dir_;
+			float axes[3][3];
+			ShadowLightAxes(&light_dir.x, axes);
+
+			for (uint32_t c = 0; c != MAX_SHADOW_CASCADES; c++)
+			{
+				uint32_t id = d * MAX_SHADOW_CASCADES + c;
+				ShadowCascade& cascade = cascades_[id];
+				ShadowView shadow = {};
+
+				float center_dist, radius;
+				FrustumSliceSphere(splits[c], splits[c + 1], tan_half_fov, cam_->aspect_, center_dist, radius);
+				Vector3f center = cam_->eye_pos_ + forward * center_dist;
+
+				//A skipped cascade keeps the projection its page was rendered with while the slice stays inside
+				//it, which the guard band it's fitted with leaves room for
+				bool refit = !stagger_cascades_ || CascadeScheduled(c, MAX_SHADOW_CASCADES, shadow_cache_.Frame())
+					|| !CascadeCovers(cascade, axes, &center.x, radius, scene_center, scene_extents);
+				if (refit || !shadow_cache_.Keep(first_id + id, shadow.page))
+				{
+					float guard = (stagger_cascades_ && (c != 0)) ? radius * CASCADE_STAGGER_GUARD : 0;
+					FitCascade(axes, &center.x, radius, guard, CASCADE_PAGE_SIZE, scene_center, scene_extents, cascade);
+
+					ShadowHash light_hash;
+					light_hash.Add(cascade);
+
+					ShadowHash casters_hash;
+					shadow.first_caster = static_cast<uint32_t>(packet.shadow_casters.size());
+					for (size_t r = 0; r != rs_.size(); r++)
+					{
+						BoundingBox bounds;
+						if (rs_[r]->WorldBounds(bounds) && !CascadeIntersectsBox(cascade, &bounds.Center.x, &bounds.Extents.x))
+						{
+							continue;
+						}
+
+						DrawItem item;
+						item.r = rs_[r].get();
+						item.model_mat = rs_[r]->ModelMatrix();
+						packet.shadow_casters.push_back(item);
+
+						casters_hash.Add(r);
+						casters_hash.Add(item.model_mat);
+					}
+					shadow.num_casters = static_cast<uint32_t>(packet.shadow_casters.size()) - shadow.first_caster;
+
+					shadow.render = shadow_cache_.Update(first_id + id, light_hash.Value(), casters_hash.Value(),
+						CASCADE_PAGE_SIZE, shadow.page);
+					if (!shadow.render)
+					{
+						packet.shadow_casters.resize(shadow.first_caster);
+						shadow.num_casters = 0;
+					}
+				}
+
+				CascadeViewProj(cascade, &shadow.view_proj.m[0][0]);
+
+				packet.cascade_shadows.push_back(shadow);
+				packet.cascades.push_back(cascade);
+			}
+		}
+	}
+
+	void RenderEngine::RenderShadows(FramePacket& packet)
+	{
+		ID3DX11EffectPass* clear_pass = nullptr;
+		ID3DX11EffectPass* depth_pass = nullptr;
+
+		auto render_page = [this, &packet, &clear_pass, &depth_pass](const ShadowView& shadow)
+		{
+			if (!shadow.render)
+			{
+				return;
+			}
+
+			if (!clear_pass)
+			{
+				clear_pass = imm_cl_->D3DPass("DeferredRendering", "ShadowClear");
+				depth_pass = imm_cl_->D3DPass("DeferredRendering", "ShadowDepth");
+
+				shadow_atlas_fb_->Bind();
+			}
+
+			D3D11_VIEWPORT vp;
+			vp.TopLeftX = (float)shadow.page.x;
+			vp.TopLeftY = (float)shadow.page.y;
+			vp.Width = (float)shadow.page.size;
+			vp.Height = (float)shadow.page.size;
+			vp.MinDepth = 0;
+			vp.MaxDepth = 1;
+			d3d_imm_ctx_->RSSetViewports(1, &vp);
+
+			LightConstants constants = {};
+			constants.light_view_proj = shadow.view_proj;
+			imm_cl_->SetConstants(CF_PerLight, constants);
+
+			//Depth clears always cover the whole atlas, so the page is reset by drawing the far plane over it
+			quad_->Render(imm_cs_, clear_pass);
+
+			for (uint32_t i = 0; i != shadow.num_casters; i++)
+			{
+				const DrawItem& item = packet.shadow_casters[shadow.first_caster + i];
+				item.r->Render(imm_cs_, depth_pass, item.model_mat);
+			}
+			this->FlushCommands();
+
+			RenderStatistics::Add(SC_ShadowPageRenders);
+			RenderStatistics::Add(SC_ShadowCasterDraws, shadow.num_casters);
+		};
+
+		for (const auto& shadow : packet.spot_shadows)
+		{
+			render_page(shadow);
+		}
+		for (const auto& shadow : packet.cascade_shadows)
+		{
+			render_page(shadow);
+		}
+	}
+
+	void RenderEngine::Submit(FramePacket& packet)
+	{
+		{
+			CPUTimerScope timer(trace_, "WaitForGPU");
+
+			if (frame_latency_waitable_)
+			{
+				::WaitForSingleObjectEx(frame_latency_waitable_, FRAME_LATENCY_WAIT_TIMEOUT, true);
+			}
+			this->WaitForFrameLatency();
+		}
+
+		gpu_profiler_->BeginFrame();
+
+		this->UpdateRenderSize();
+
+		Camera* cam = &packet.cam;
+
+		//A new sub-pixel offset each frame for temporal anti-aliasing, in pixels of the size rendered at
+		float jitter[2] = { 0, 0 };
+		if (taa_enabled_)
+		{
+			float offset[2];
+			HaltonJitter(taa_frame_ % TAA_JITTER_PERIOD, offset);
+			JitterToNDC(offset, render_width_, render_height_, jitter);
+			++taa_frame_;
+		}
+		cam->Jitter(jitter[0], jitter[1]);
+
+		//The history is what the previous submitted frame rendered, so its view-projection is tracked here
+		//rather than by the update running a frame ahead
+		cam->prev_view_proj_ = taa_prev_view_proj_;
+		taa_prev_view_proj_ = cam->ViewProj();
+
+		//Shadow pass, only for pages whose light or casters changed
+		{
+			PassProfileScope profile(*gpu_profiler_, "Shadows");
+
+			this->RenderShadows(packet);
+		}
+
+		FrameConstants frame_constants = {};
+		cam->FillConstants(frame_constants);
+
+		//Full-screen passes only cover the viewport part of the pooled targets
+		frame_constants.tc_scale = Vector2f((float)render_width_ / rt_width_, (float)render_height_ / rt_height_);
+
+		//Spot and point lights go to the light buffer in view space, only the changed ones are uploaded
+		{
+			light_packer_.Clear();
+			for (size_t i = 0; i != packet.spot_lights.size(); i++)
+			{
+				packet.spot_lights[i].Pack(light_packer_, cam, packet.spot_shadows[i], SHADOW_ATLAS_SIZE);
+			}
+			for (size_t i = 0; i != packet.point_lights.size(); i++)
+			{
+				packet.point_lights[i].Pack(light_packer_);
+			}
+
+			XMFLOAT4X4 proj;
+			XMStoreFloat4x4(&proj, cam->proj_);
+			light_packer_.Pack(&frame_constants.view_mat._11, cam->near_plane_, proj._11, proj._22);
+			frame_constants.num_lights = static_cast<uint32_t>(light_packer_.NumLights());
+
+			light_buffer_->Upload(d3d_imm_ctx_.get(), light_packer_);
+		}
+
+		//GBuffer pass
+		{
+			PassProfileScope profile(*gpu_profiler_, "GBuffer");
+
+			this->RenderGBuffer(packet, frame_constants);
+		}
+
+		ID3DX11EffectTechnique* tech = d3d_effect_->GetTechniqueByName("DeferredRendering");
+
+		imm_cl_->SetConstants(CF_PerFrame, frame_constants);
+
+		auto var_g_pp_tex = d3d_effect_->GetVariableByName("g_pp_tex")->AsShaderResource();
+
+		//Linear depth pass
+		{
+			PassProfileScope profile(*gpu_profiler_, "LinearDepth");
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("LinearDepth");
+
+			linear_depth_fb_->Clear();
+			linear_depth_fb_->Bind();
+
+			var_g_pp_tex->SetResource(gbuffer_fb_->RetriveDSShaderResourceView());
+			RenderStatistics::Add(SC_TextureBinds);
+
+			quad_->Render(imm_cs_, pass);
+			this->FlushCommands();
+		}
+
+		auto var_g_buffer_tex = d3d_effect_->GetVariableByName("g_buffer_tex")->AsShaderResource();
+		auto var_g_buffer_1_tex = d3d_effect_->GetVariableByName("g_buffer_1_tex")->AsShaderResource();
+		auto var_g_depth_tex = d3d_effect_->GetVariableByName("g_depth_tex")->AsShaderResource();
+		var_g_buffer_tex->SetResource(gbuffer_fb_->RetriveRTShaderResourceView(0));
+		var_g_buffer_1_tex->SetResource(gbuffer_fb_->RetriveRTShaderResourceView(1));
+		var_g_depth_tex->SetResource(linear_depth_fb_->RetriveRTShaderResourceView(0));
+		RenderStatistics::Add(SC_TextureBinds, 3);
+
+		PassConstants pass_constants = {};
+		pass_constants.render_size = Vector2f((float)render_width_, (float)render_height_);
+		pass_constants.bloom_threshold = post_settings_.bloom_threshold;
+		pass_constants.bloom_knee = post_settings_.bloom_knee;
+
+		//Ambient occlusion pass, at the preset's fraction of the resolution
+		if (ao_fb_)
+		{
+			PassProfileScope profile(*gpu_profiler_, "SSAO");
+
+			SSAOSettings settings = SSAOPreset(ao_quality_);
+			uint32_t ao_width = SSAOTargetSize(render_width_, settings.downscale);
+			uint32_t ao_height = SSAOTargetSize(render_height_, settings.downscale);
+
+			std::copy(ao_kernel_.begin(), ao_kernel_.end(), &pass_constants.ao_kernel[0].x);
+			pass_constants.ao_size = Vector2f((float)ao_width, (float)ao_height);
+			pass_constants.ao_radius = settings.radius;
+			pass_constants.ao_bias = settings.bias;
+			pass_constants.ao_intensity = settings.intensity;
+			pass_constants.ao_num_samples = (std::min)(settings.num_samples, MAX_SSAO_SAMPLES);
+			imm_cl_->SetConstants(CF_PerPass, pass_constants);
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("SSAO");
+
+			ao_fb_->Clear();
+			ao_fb_->Bind();
+			this->D3DSetViewport(d3d_imm_ctx_.get(), ao_width, ao_height);
+
+			quad_->Render(imm_cs_, pass);
+			this->FlushCommands();
+
+			this->D3DSetViewport(d3d_imm_ctx_.get());
+
+			auto var_g_ao_tex = d3d_effect_->GetVariableByName("g_ao_tex")->AsShaderResource();
+			var_g_ao_tex->SetResource(ao_fb_->RetriveRTShaderResourceView(0));
+			RenderStatistics::Add(SC_TextureBinds);
+		}
+		else
+		{
+			imm_cl_->SetConstants(CF_PerPass, pass_constants);
+		}
+
+		//Shadows for the direction and spot lights
+		auto var_g_shadow_tex = d3d_effect_->GetVariableByName("g_shadow_tex")->AsShaderResource();
+		var_g_shadow_tex->SetResource(shadow_atlas_fb_->RetriveDSShaderResourceView());
+		RenderStatistics::Add(SC_TextureBinds);
+
+		auto var_g_lights = d3d_effect_->GetVariableByName("g_lights")->AsShaderResource();
+
+		//Environment of the ambient light, the previous one until a build started since is uploaded
+		this->FinishEnvironmentBuilds();
+		auto var_g_env_specular_tex = d3d_effect_->GetVariableByName("g_env_specular_tex")->AsShaderResource();
+		var_g_env_specular_tex->SetResource(env_specular_srv_.get());
+		RenderStatistics::Add(SC_TextureBinds);
+
+		//Lighting-kind passes
+		if (compute_lighting_)
+		{
+			//Tiled lighting pass, the ambient, spot and point lights written once per pixel, no clear needed
+			PassProfileScope profile(*gpu_profiler_, "TiledLighting");
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("TiledLighting");
+
+			packet.ambient_light.Bind(*imm_cl_, cam, env_lighting_);
+
+			auto var_g_lighting_uav = d3d_effect_->GetVariableByName("g_lighting_uav")->AsUnorderedAccessView();
+			var_g_lighting_uav->SetUnorderedAccessView(lighting_fb_->RetriveRTUnorderedAccessView(0));
+			var_g_lights->SetResource(light_buffer_->D3DShaderResourceView());
+			RenderStatistics::Add(SC_TextureBinds, 2);
+
+			imm_cl_->ApplyComputePass(pass);
+
+			uint32_t groups_x;
+			uint32_t groups_y;
+			LightingDispatchSize(render_width_, render_height_, groups_x, groups_y);
+			d3d_imm_ctx_->Dispatch(groups_x, groups_y, 1);
+			RenderStatistics::Add(SC_Dispatches);
+
+			//The target can't be bound for output twice, the direction lights draw into it next
+			ID3D11UnorderedAccessView* d3d_null_uav = nullptr;
+			var_g_lighting_uav->SetUnorderedAccessView(nullptr);
+			d3d_imm_ctx_->CSSetUnorderedAccessViews(0, 1, &d3d_null_uav, nullptr);
+
+			lighting_fb_->Bind();
+		}
+		else
+		{
+			lighting_fb_->Clear();
+			lighting_fb_->Bind();
+
+			//Ambient lighting pass, occluded by the upsampled SSAO
+			PassProfileScope profile(*gpu_profiler_, "AmbientLighting");
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("AmbientLighting");
+
+			packet.ambient_light.Bind(*imm_cl_, cam, env_lighting_);
+
+			quad_->Render(imm_cs_, pass);
+			this->FlushCommands();
+		}
+
+		//Direction lighting pass for each
+		{
+			PassProfileScope profile(*gpu_profiler_, "DirectionLighting");
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("DirectionLighting");
+
+			for (size_t i = 0; i != packet.dir_lights.size(); i++)
+			{
+				packet.dir_lights[i].Bind(*imm_cl_, cam, &packet.cascade_shadows[i * MAX_SHADOW_CASCADES],
+					&packet.cascades[i * MAX_SHADOW_CASCADES], SHADOW_ATLAS_SIZE);
+
+				quad_->Render(imm_cs_, pass);
+				this->FlushCommands();
+			}
+		}
+
+		//Local lighting pass, every spot and point light in one loop over the light buffer
+		if (!compute_lighting_ && (light_packer_.NumLights() > 0))
+		{
+			PassProfileScope profile(*gpu_profiler_, "LocalLighting");
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("LocalLighting");
+
+			var_g_lights->SetResource(light_buffer_->D3DShaderResourceView());
+			RenderStatistics::Add(SC_TextureBinds);
+
+			quad_->Render(imm_cs_, pass);
+			this->FlushCommands();
+		}
+
+		//Temporal resolve pass, the lit image blended with the history reprojected into it
+		ID3D11ShaderResourceView* resolved_srv = lighting_fb_->RetriveRTShaderResourceView(0);
+		if (taa_enabled_)
+		{
+			PassProfileScope profile(*gpu_profiler_, "TemporalResolve");
+
+			FrameBuffer& history_fb = *taa_fbs_[taa_index_];
+			taa_index_ ^= 1;
+			FrameBuffer& resolved_fb = *taa_fbs_[taa_index_];
+
+			Matrix reproj_mat;
+			reproj_mat = cam->view_.Inverse() * cam->prev_view_proj_;
+			XMStoreFloat4x4(&pass_constants.taa_reproj_mat, reproj_mat);
+			pass_constants.taa_prev_tc_scale = taa_prev_tc_scale_;
+			pass_constants.taa_blend = taa_history_valid_ ? TAA_BLEND : 1;
+			imm_cl_->SetConstants(CF_PerPass, pass_constants);
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("TemporalResolve");
+
+			resolved_fb.Bind();
+
+			auto var_g_history_tex = d3d_effect_->GetVariableByName("g_history_tex")->AsShaderResource();
+			var_g_pp_tex->SetResource(resolved_srv);
+			var_g_history_tex->SetResource(history_fb.RetriveRTShaderResourceView(0));
+			RenderStatistics::Add(SC_TextureBinds, 2);
+
+			quad_->Render(imm_cs_, pass);
+			this->FlushCommands();
+
+			taa_history_valid_ = true;
+			taa_prev_tc_scale_ = frame_constants.tc_scale;
+			resolved_srv = resolved_fb.RetriveRTShaderResourceView(0);
+		}
+
+		//Bloom passes, a bright pass at half resolution, dual-filter downsamples to the smallest level and
+		//upsamples added back up the pyramid
+		if (!bloom_fbs_.empty())
+		{
+			auto filter = [&](const char* pass_name, ID3D11ShaderResourceView* src, uint32_t src_level, uint32_t dst_level)
+			{
+				//Level ~0U is the full-resolution scene
+				Vector2f src_size = (~0U == src_level) ? pass_constants.render_size
+					: Vector2f((float)BloomTargetSize(render_width_, src_level), (float)BloomTargetSize(render_height_, src_level));
+				uint32_t dst_width = BloomTargetSize(render_width_, dst_level);
+				uint32_t dst_height = BloomTargetSize(render_height_, dst_level);
+
+				pass_constants.post_src_size = src_size;
+				pass_constants.post_dst_size = Vector2f((float)dst_width, (float)dst_height);
+				imm_cl_->SetConstants(CF_PerPass, pass_constants);
+
+				bloom_fbs_[dst_level]->Bind();
+				this->D3DSetViewport(d3d_imm_ctx_.get(), dst_width, dst_height);
+
+				var_g_pp_tex->SetResource(src);
+				RenderStatistics::Add(SC_TextureBinds);
+
+				quad_->Render(imm_cs_, tech->GetPassByName(pass_name));
+				this->FlushCommands();
+			};
+
+			uint32_t num_levels = static_cast<uint32_t>(bloom_fbs_.size());
+			{
+				PassProfileScope profile(*gpu_profiler_, "BloomBrightPass");
+
+				filter("BloomBrightPass", resolved_srv, ~0U, 0);
+			}
+			{
+				PassProfileScope profile(*gpu_profiler_, "BloomDownsample");
+
+				for (uint32_t level = 1; level < num_levels; level++)
+				{
+					filter("BloomDownsample", bloom_fbs_[level - 1]->RetriveRTShaderResourceView(0), level - 1, level);
+				}
+			}
+			{
+				PassProfileScope profile(*gpu_profiler_, "BloomUpsample");
+
+				for (uint32_t level = num_levels - 1; level > 0; level--)
+				{
+					filter("BloomUpsample", bloom_fbs_[level]->RetriveRTShaderResourceView(0), level, level - 1);
+				}
+			}
+
+			this->D3DSetViewport(d3d_imm_ctx_.get());
+		}
+
+		//SRGBCorrection pass, with the bloom, vignette and color grading composited in
+		{
+			PassProfileScope profile(*gpu_profiler_, "SRGBCorrection");
+
+			pass_constants.bloom_intensity = 0;
+			if (!bloom_fbs_.empty())
+			{
+				pass_constants.bloom_intensity = post_settings_.bloom_intensity;
+				pass_constants.post_src_size = Vector2f((float)BloomTargetSize(render_width_, 0), (float)BloomTargetSize(render_height_, 0));
+
+				auto var_g_bloom_tex = d3d_effect_->GetVariableByName("g_bloom_tex")->AsShaderResource();
+				var_g_bloom_tex->SetResource(bloom_fbs_[0]->RetriveRTShaderResourceView(0));
+				RenderStatistics::Add(SC_TextureBinds);
+			}
+			pass_constants.vignette = post_settings_.vignette;
+			pass_constants.grading_enabled = post_settings_.color_grading ? 1 : 0;
+			if (post_settings_.color_grading)
+			{
+				if (!grading_lut_srv_)
+				{
+					this->CreateGradingLUT();
+				}
+
+				auto var_g_grading_lut = d3d_effect_->GetVariableByName("g_grading_lut")->AsShaderResource();
+				var_g_grading_lut->SetResource(grading_lut_srv_.get());
+				RenderStatistics::Add(SC_TextureBinds);
+			}
+			imm_cl_->SetConstants(CF_PerPass, pass_constants);
+
+			srgb_fb_->Clear();
+			srgb_fb_->Bind();
+			this->D3DSetViewport(d3d_imm_ctx_.get(), width_, height_);
+
+			ID3DX11EffectPass* pass = tech->GetPassByName("SRGBCorrection");
+
+			var_g_pp_tex->SetResource(resolved_srv);
+			RenderStatistics::Add(SC_TextureBinds);
+
+			quad_->Render(imm_cs_, pass);
+			this->FlushCommands();
+		}
+
+		gpu_profiler_->EndFrame();
+
+		//Uncapped modes only time the frame
+		if (PM_FixedCap == present_mode_)
+		{
+			pacer_.Pace();
+		}
+		else
+		{
+			pacer_.Tick();
+		}
+
+		UINT present_flags = present_flags_;
+		if (present_flags & PRESENT_ALLOW_TEARING)
+		{
+			BOOL fullscreen = FALSE;
+			gi_swap_chain_1_->GetFullscreenState(&fullscreen, nullptr);
+			if (fullscreen)
+			{
+				present_flags &= ~PRESENT_ALLOW_TEARING;
+			}
+		}
+		{
+			CPUTimerScope timer(trace_, "Present");
+
+			gi_swap_chain_1_->Present(sync_interval_, present_flags);
+		}
+
+		d3d_imm_ctx_->End(frame_queries_[frames_in_flight_.Slot(frame_pipeline_.FrameIndex())].get());
+		frames_in_flight_.Issue(frame_pipeline_.FrameIndex());
+
+		//Constants of this frame stay untouched until its query has passed
+		imm_cl_->FinishFrame(frame_pipeline_.FrameIndex());
+
+		this->EndFrameStatistics();
+	}
+
+	void RenderEngine::SetDynamicResolution(bool enable)
+	{
+		drs_enabled_ = enable;
+		drs_.Reset();
+		drs_resolved_frames_ = gpu_profiler_ ? gpu_profiler_->NumResolvedFrames() : 0;
+	}
+
+	bool RenderEngine::DynamicResolutionEnabled() const
+	{
+		return drs_enabled_;
+	}
+
+	void RenderEngine::SetCascadeStaggering(bool stagger)
+	{
+		stagger_cascades_ = stagger;
+	}
+
+	bool RenderEngine::CascadeStaggering() const
+	{
+		return stagger_cascades_;
+	}
+
+	void RenderEngine::SetAmbientOcclusion(SSAOQuality quality)
+	{
+		SSAOSettings settings = SSAOPreset(quality);
+		ao_kernel_.assign(MAX_SSAO_SAMPLES * 4, 0.0f);
+		SSAOKernel((std::min)(settings.num_samples, MAX_SSAO_SAMPLES), ao_kernel_.data());
+
+		bool changed = (quality != ao_quality_);
+		ao_quality_ = quality;
+
+		//Before the first Resize there is nothing to size the target by
+		if (changed && gbuffer_fb_)
+		{
+			this->CreateAOTarget();
+		}
+	}
+
+	SSAOQuality RenderEngine::AmbientOcclusion() const
+	{
+		return ao_quality_;
+	}
+
+	void RenderEngine::CreateAOTarget()
+	{
+		ao_fb_.reset();
+		if (SQ_Off == ao_quality_)
+		{
+			return;
+		}
+
+		SSAOSettings settings = SSAOPreset(ao_quality_);
+		ao_fb_ = std::make_shared<FrameBuffer>(DXGI_FORMAT_R16G16_FLOAT);
+		ao_fb_->SetRE(*this);
+		ao_fb_->Create(SSAOTargetSize(rt_width_, settings.downscale), SSAOTargetSize(rt_height_, settings.downscale), 1);
+	}
+
+	void RenderEngine::SetTemporalAA(bool enable)
+	{
+		bool changed = (enable != taa_enabled_);
+		taa_enabled_ = enable;
+
+		if (changed && gbuffer_fb_)
+		{
+			this->CreateTAATargets();
+		}
+	}
+
+	bool RenderEngine::TemporalAA() const
+	{
+		return taa_enabled_;
+	}
+
+	void RenderEngine::CreateTAATargets()
+	{
+		taa_history_valid_ = false;
+		for (auto& fb : taa_fbs_)
+		{
+			fb.reset();
+			if (taa_enabled_)
+			{
+				fb = std::make_shared<FrameBuffer>(DXGI_FORMAT_R16G16B16A16_FLOAT);
+				fb->SetRE(*this);
+				fb->Create(rt_width_, rt_height_, 1);
+			}
+		}
+	}
+
+	void RenderEngine::SetPostProcessing(const PostSettings& settings)
+	{
+		bool bloom_changed = (settings.bloom != post_settings_.bloom) || (settings.bloom_levels != post_settings_.bloom_levels);
+		post_settings_ = settings;
+		post_settings_.bloom_levels = (std::min)((std::max)(settings.bloom_levels, 1U), MAX_BLOOM_LEVELS);
+
+		if (bloom_changed && gbuffer_fb_)
+		{
+			this->CreateBloomTargets();
+		}
+
+		//Rebuilt by the next submit
+		grading_lut_srv_.reset();
+		grading_lut_.reset();
+	}
+
+	const PostSettings& RenderEngine::PostProcessing() const
+	{
+		return post_settings_;
+	}
+
+	void RenderEngine::SetComputeLighting(bool enable)
+	{
+		compute_lighting_ = enable;
+	}
+
+	bool RenderEngine::ComputeLighting() const
+	{
+		return compute_lighting_;
+	}
+
+	void RenderEngine::SetEnvironmentMap(const std::string& dds_path)
+	{
+		//The same map again would only repeat the prefilter
+		if (dds_path == env_map_path_)
+		{
+			return;
+		}
+		env_map_path_ = dds_path;
+
+		//Before Create the build starts there
+		if (d3d_device_)
+		{
+			this->StartEnvironmentBuild();
+		}
+	}
+
+	const std::string& RenderEngine::EnvironmentMap() const
+	{
+		return env_map_path_;
+	}
+
+	void RenderEngine::CreateBloomTargets()
+	{
+		bloom_fbs_.clear();
+		if (!post_settings_.bloom)
+		{
+			return;
+		}
+
+		for (uint32_t level = 0; level != post_settings_.bloom_levels; level++)
+		{
+			FrameBufferPtr fb = std::make_shared<FrameBuffer>(DXGI_FORMAT_R11G11B10_FLOAT);
+			fb->SetRE(*this);
+			fb->Create(BloomTargetSize(rt_width_, level), BloomTargetSize(rt_height_, level), 1);
+			bloom_fbs_.push_back(fb);
+		}
+	}
+
+	void RenderEngine::CreateGradingLUT()
+	{
+		std::vector<float> lut(GRADING_LUT_SIZE * GRADING_LUT_SIZE * GRADING_LUT_SIZE * 4);
+		BuildGradingLUT(post_settings_, GRADING_LUT_SIZE, lut.data());
+
+		D3D11_TEXTURE3D_DESC d3d_tex_desc;
+		d3d_tex_desc.Width = GRADING_LUT_SIZE;
+		d3d_tex_desc.Height = GRADING_LUT_SIZE;
+		d3d_tex_desc.Depth = GRADING_LUT_SIZE;
+		d3d_tex_desc.MipLevels = 1;
+		d3d_tex_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		d3d_tex_desc.Usage = D3D11_USAGE_IMMUTABLE;
+		d3d_tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		d3d_tex_desc.CPUAccessFlags = 0;
+		d3d_tex_desc.MiscFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA tex_data;
+		tex_data.pSysMem = lut.data();
+		tex_data.SysMemPitch = GRADING_LUT_SIZE * 4 * sizeof(float);
+		tex_data.SysMemSlicePitch = GRADING_LUT_SIZE * tex_data.SysMemPitch;
+
+		ID3D11Texture3D* d3d_tex = nullptr;
+		THROW_FAILED(d3d_device_->CreateTexture3D(&d3d_tex_desc, &tex_data, &d3d_tex));
+		grading_lut_ = MakeTrackedCOMPtr(d3d_tex, MC_Texture, this->D3DTextureSize(d3d_tex));
+
+		ID3D11ShaderResourceView* d3d_srv = nullptr;
+		THROW_FAILED(d3d_device_->CreateShaderResourceView(d3d_tex, nullptr, &d3d_srv));
+		grading_lut_srv_ = MakeCOMPtr(d3d_srv);
+	}
+
+	void RenderEngine::StartEnvironmentBuild()
+	{
+		//The map is read back through a staging copy here, the immediate context being the main thread's.
+		//Maps that fail to load fall back to the sky
+		std::unique_ptr<EnvironmentBuild> build(new EnvironmentBuild);
+		build->superseded = false;
+		if (!env_map_path_.empty())
+		{
+			std::wstring wfile_path = ToWstring(env_map_path_);
+
+			ID3D11Resource* d3d_tex_res = nullptr;
+			if (SUCCEEDED(CreateDDSTextureFromFileEx(d3d_device_.get(), wfile_path.c_str(), ENV_MAP_MAX_SIZE,
+				D3D11_USAGE_STAGING, 0, D3D11_CPU_ACCESS_READ, 0, false, &d3d_tex_res, nullptr)))
+			{
+				ID3D11Texture2D* d3d_staging_tex = nullptr;
+				if (SUCCEEDED(d3d_tex_res->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&d3d_staging_tex))))
+				{
+					ReadStagingCubemap(d3d_imm_ctx_.get(), d3d_staging_tex, build->env);
+					d3d_staging_tex->Release();
+				}
+				d3d_tex_res->Release();
+			}
+		}
+
+		//Then prefiltered on the CPU by a background job, which splits the work further over the job system.
+		//Only workers take it, a frame's waits on the main thread never end up running it
+		EnvironmentBuild* b = build.get();
+		JobSystem* js = job_system_;
+		job_system_->RunBackground([b, js]
+		{
+			try
+			{
+				if (b->env.texels.empty())
+				{
+					BuildSkyCubemap(SKY_CUBEMAP_SIZE, b->env);
+				}
+
+				ProjectSH9(b->env, b->lighting.irradiance_sh, js);
+				ConvolveSH9Irradiance(b->lighting.irradiance_sh);
+
+				while (b->env.size > ENV_SPECULAR_SIZE)
+				{
+					Cubemap half;
+					DownsampleCubemap(b->env, half);
+					b->env = std::move(half);
+				}
+
+				PrefilterSpecular(b->env, ENV_SPECULAR_SAMPLES, b->mips, js);
+				b->lighting.specular_mips = static_cast<uint32_t>(b->mips.size());
+			}
+			catch (...)
+			{
+				b->error = std::current_exception();
+			}
+		}, &build->counter);
+
+		//Builds still running for an earlier map are left to finish, but never uploaded
+		for (auto& earlier : env_builds_)
+		{
+			earlier->superseded = true;
+		}
+		env_builds_.push_back(std::move(build));
+	}
+
+	void RenderEngine::FinishEnvironmentBuilds()
+	{
+		//Only the newest build is uploaded, superseded ones are dropped once their job is done
+		for (size_t i = 0; i != env_builds_.size();)
+		{
+			if (!env_builds_[i]->counter.Done())
+			{
+				++i;
+				continue;
+			}
+
+			std::unique_ptr<EnvironmentBuild> build = std::move(env_builds_[i]);
+			env_builds_.erase(env_builds_.begin() + i);
+
+			//Rethrows what the job threw, here on the main thread. Not through Wait, which would also rethrow
+			//whatever an unrelated job run without a counter threw
+			if (build->error)
+			{
+				std::rethrow_exception(build->error);
+			}
+
+			if (!build->superseded)
+			{
+				env_lighting_ = build->lighting;
+				this->CreateEnvironmentTexture(build->mips);
+			}
+		}
+	}
+
+	void RenderEngine::CreateEnvironmentTexture(const std::vector<Cubemap>& mips)
+	{
+		uint32_t num_mips = static_cast<uint32_t>(mips.size());
+		uint32_t env_size = mips[0].size;
+		env_lighting_.specular_mips = num_mips;
+
+		D3D11_TEXTURE2D_DESC d3d_tex_desc;
+		d3d_tex_desc.Width = env_size;
+		d3d_tex_desc.Height = env_size;
+		d3d_tex_desc.MipLevels = num_mips;
+		d3d_tex_desc.ArraySize = 6;
+		d3d_tex_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		d3d_tex_desc.SampleDesc.Count = 1;
+		d3d_tex_desc.SampleDesc.Quality = 0;
+		d3d_tex_desc.Usage = D3D11_USAGE_IMMUTABLE;
+		d3d_tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		d3d_tex_desc.CPUAccessFlags = 0;
+		d3d_tex_desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+		//Subresources go face by face, each with all its mips
+		std::vector<D3D11_SUBRESOURCE_DATA> tex_data(6 * num_mips);
+		for (uint32_t face = 0; face != 6; face++)
+		{
+			for (uint32_t mip = 0; mip != num_mips; mip++)
+			{
+				uint32_t size = mips[mip].size;
+				D3D11_SUBRESOURCE_DATA& data = tex_data[face * num_mips + mip];
+				data.pSysMem = &mips[mip].texels[static_cast<size_t>(face) * size * size * 4];
+				data.SysMemPitch = size * 4 * sizeof(float);
+				data.SysMemSlicePitch = 0;
+			}
+		}
+
+		ID3D11Texture2D* d3d_tex = nullptr;
+		THROW_FAILED(d3d_device_->CreateTexture2D(&d3d_tex_desc, tex_data.data(), &d3d_tex));
+		env_specular_tex_ = MakeTrackedCOMPtr(d3d_tex, MC_Texture, this->D3DTextureSize(d3d_tex));
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC d3d_srv_desc;
+		d3d_srv_desc.Format = d3d_tex_desc.Format;
+		d3d_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		d3d_srv_desc.TextureCube.MostDetailedMip = 0;
+		d3d_srv_desc.TextureCube.MipLevels = num_mips;
+
+		ID3D11ShaderResourceView* d3d_srv = nullptr;
+		THROW_FAILED(d3d_device_->CreateShaderResourceView(d3d_tex, &d3d_srv_desc, &d3d_srv));
+		env_specular_srv_ = MakeCOMPtr(d3d_srv);
+	}
+
+	DynamicResolution& RenderEngine::ResolutionController()
+	{
+		return drs_;
+	}
+
+	float RenderEngine::ResolutionScale() const
+	{
+		return drs_enabled_ ? drs_.Scale() : 1.0f;
+	}
+
+	void RenderEngine::UpdateRenderSize()
+	{
+		//Feed each read-back frame once, repeats would wind the integral up
+		if (drs_enabled_ && gpu_profiler_ && (gpu_profiler_->NumResolvedFrames() != drs_resolved_frames_))
+		{
+			drs_resolved_frames_ = gpu_profiler_->NumResolvedFrames();
+			drs_.Update(gpu_profiler_->LastFrameGPUTime());
+		}
+
+		float scale = this->ResolutionScale();
+		render_width_ = (std::max)(1U, static_cast<uint32_t>(width_ * scale + 0.5f));
+		render_height_ = (std::max)(1U, static_cast<uint32_t>(height_ * scale + 0.5f));
+	}
+
+	void RenderEngine::EndFrameStatistics()
+	{
+		stats_.EndFrame();
+
+		if (stats_csv_.is_open())
+		{
+			stats_.WriteCsvRow(stats_csv_);
+		}
+
+		if (show_stats_ && (stats_.FrameIndex() % STATS_TITLE_INTERVAL == 0))
+		{
+			FrameTimeStats frame_stats = pacer_.Stats();
+			std::ostringstream oss;
+			oss << std::fixed << std::setprecision(2) << frame_stats.avg_ms << " ms  " << stats_.Summary();
+			if (drs_enabled_)
+			{
+				oss << "  " << render_width_ << "x" << render_height_;
+			}
+			::SetWindowTextA(wnd_, oss.str().c_str());
+		}
+	}
+
+	void RenderEngine::RenderGBuffer(FramePacket& packet, const FrameConstants& frame_constants)
+	{
+		gbuffer_fb_->Clear();
+		gbuffer_fb_->Bind();
+		this->D3DSetViewport(d3d_imm_ctx_.get());
+
+		size_t num_chunks = (std::min)(deferred_cls_.size(), packet.draws.size() / GBUFFER_CHUNK_MIN);
+		if (num_chunks < 2)
+		{
+			ID3DX11EffectPass* pass = imm_cl_->D3DPass("DeferredRendering", "GBuffer");
+
+			imm_cl_->SetConstants(CF_PerFrame, frame_constants);
+			for (const auto& item : packet.draws)
+			{
+				item.r->Render(imm_cs_, pass, item.model_mat);
+			}
+			this->FlushCommands();
+			return;
+		}
+
+		//Record contiguous chunks in parallel, each replayed into its own deferred context by the same job.
+		//The lists are then played back in order
+		size_t chunk_size = (packet.draws.size() + num_chunks - 1) / num_chunks;
+		job_system_->ParallelFor(num_chunks, 1, [this, &packet, &frame_constants, chunk_size](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c != end; c++)
+			{
+				CPUTimerScope timer(trace_, "GBufferRecord");
+
+				CommandList& cl = *deferred_cls_[c];
+				CommandStream& cs = deferred_css_[c];
+				ID3DX11EffectPass* pass = cl.D3DPass("DeferredRendering", "GBuffer");
+
+				cs.Reset();
+				size_t first = c * chunk_size;
+				size_t last = (std::min)(first + chunk_size, packet.draws.size());
+				for (size_t i = first; i < last; i++)
+				{
+					const DrawItem& item = packet.draws[i];
+					item.r->Render(cs, pass, item.model_mat);
+				}
+
+				cl.Begin();
+
+				gbuffer_fb_->Bind(cl.D3DContext());
+				this->D3DSetViewport(cl.D3DContext());
+				cl.SetConstants(CF_PerFrame, frame_constants);
+				cs.Replay(cl);
+
+				cl.End();
+			}
+		});
+
+		for (size_t c = 0; c != num_chunks; c++)
+		{
+			deferred_cls_[c]->Execute(d3d_imm_ctx_.get());
+		}
+
+		//Executing a command list resets the immediate context state
+		this->D3DSetViewport(d3d_imm_ctx_.get());
+	}
+
+	void RenderEngine::FlushCommands()
+	{
+		imm_cs_.Replay(*imm_cl_);
+		imm_cs_.Reset();
+	}
+
+	TransformSystem& RenderEngine::Transforms()
+	{
+		return *transforms_;
+	}
+
+	IDXGISwapChain1* RenderEngine::DXGISwapChain()
+	{
+		return gi_swap_chain_1_.get();
+	}
+
+	ID3D11Device* RenderEngine::D3DDevice()
+	{
+		return d3d_device_.get();
+	}
+
+	ID3D11DeviceContext* RenderEngine::D3DContext()
+	{
+		return d3d_imm_ctx_.get();
+	}
+
+	HRESULT RenderEngine::D3DCompile(std::string const & src_data, const char* entry_point, const char* target,
+		std::vector<uint8_t>& code, std::string& error_msgs) const
+	{
+		ID3DBlob* code_blob = nullptr;
+		ID3DBlob* error_msgs_blob = nullptr;
+
+		uint32_t const flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_PREFER_FLOW_CONTROL | D3DCOMPILE_SKIP_OPTIMIZATION;
+		HRESULT hr = DynamicD3DCompile_(src_data.c_str(), static_cast<UINT>(src_data.size()),
+			nullptr, nullptr, nullptr, entry_point,
+			target, flags, 0, &code_blob, &error_msgs_blob);
+		if (code_blob)
+		{
+			uint8_t const * p = static_cast<uint8_t const *>(code_blob->GetBufferPointer());
+			code.assign(p, p + code_blob->GetBufferSize());
+			code_blob->Release();
 		}
 		else
 		{
@@ -432,8 +2104,8 @@ namespace epsilon
 	{
 		D3D11_TEXTURE2D_DESC d3d_tex_desc;
 		ZeroMemory(&d3d_tex_desc, sizeof(d3d_tex_desc));
-		d3d_tex_desc.Width = width_;
-		d3d_tex_desc.Height = height_;
+		d3d_tex_desc.Width = width;
+		d3d_tex_desc.Height = height;
 		d3d_tex_desc.MipLevels = 1;
 		d3d_tex_desc.ArraySize = 1;
 		d3d_tex_desc.Format = (DXGI_FORMAT)fmt;
@@ -450,6 +2122,25 @@ namespace epsilon
 		return d3d_tex;
 	}
 
+	ID3D11Texture2DPtr RenderEngine::AcquireRenderTarget(UINT width, UINT height, int fmt, UINT bind_flags)
+	{
+		return rt_pool_.Acquire(fmt, width, height, bind_flags, [this](const RenderTargetKey& key)
+		{
+			ID3D11Texture2D* d3d_tex = this->D3DCreateTexture2D(key.width, key.height, key.format, key.bind_flags);
+			return MakeTrackedCOMPtr(d3d_tex, MC_RenderTarget, this->D3DTextureSize(d3d_tex));
+		});
+	}
+
+	void RenderEngine::ReleaseRenderTarget(const ID3D11Texture2DPtr& tex)
+	{
+		rt_pool_.Release(tex);
+	}
+
+	const RenderTargetPool<ID3D11Texture2DPtr>& RenderEngine::RenderTargets() const
+	{
+		return rt_pool_;
+	}
+
 	ID3D11DepthStencilView* RenderEngine::D3DCreateDepthStencilView(ID3D11Texture2D* tex, int fmt)
 	{
 		D3D11_DEPTH_STENCIL_VIEW_DESC d3d_dsv_desc;
@@ -472,4 +2163,94 @@ namespace epsilon
 		return d3d_rtv;
 	}
 
+	uint64_t RenderEngine::D3DTextureSize(ID3D11Resource* res) const
+	{
+		uint32_t width = 1;
+		uint32_t height = 1;
+		uint32_t depth = 1;
+		uint32_t mip_levels = 1;
+		uint32_t array_size = 1;
+		DXGI_FORMAT fmt = DXGI_FORMAT_UNKNOWN;
+
+		D3D11_RESOURCE_DIMENSION dim;
+		res->GetType(&dim);
+		switch (dim)
+		{
+		case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+			{
+				D3D11_TEXTURE1D_DESC desc;
+				static_cast<ID3D11Texture1D*>(res)->GetDesc(&desc);
+				width = desc.Width;
+				mip_levels = desc.MipLevels;
+				array_size = desc.ArraySize;
+				fmt = desc.Format;
+			}
+			break;
+
+		case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+			{
+				D3D11_TEXTURE2D_DESC desc;
+				static_cast<ID3D11Texture2D*>(res)->GetDesc(&desc);
+				width = desc.Width;
+				height = desc.Height;
+				mip_levels = desc.MipLevels;
+				array_size = desc.ArraySize * desc.SampleDesc.Count;
+				fmt = desc.Format;
+			}
+			break;
+
+		case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+			{
+				D3D11_TEXTURE3D_DESC desc;
+				static_cast<ID3D11Texture3D*>(res)->GetDesc(&desc);
+				width = desc.Width;
+				height = desc.Height;
+				depth = desc.Depth;
+				mip_levels = desc.MipLevels;
+				fmt = desc.Format;
+			}
+			break;
+
+		default:
+			return 0;
+		}
+
+		uint32_t bpp = DXGIFormatBitsPerPixel(fmt);
+		bool bc = DXGIFormatIsBlockCompressed(fmt);
+
+		uint64_t size = 0;
+		for (uint32_t mip = 0; mip != mip_levels; mip++)
+		{
+			uint64_t w = (std::max)(width >> mip, 1u);
+			uint64_t h = (std::max)(height >> mip, 1u);
+			uint64_t d = (std::max)(depth >> mip, 1u);
+			if (bc)
+			{
+				w = (w + 3) & ~3ULL;
+				h = (h + 3) & ~3ULL;
+			}
+			size += w * h * d * bpp / 8;
+		}
+
+		return size * array_size;
+	}
+
+	void RenderEngine::D3DSetViewport(ID3D11DeviceContext* ctx)
+	{
+		this->D3DSetViewport(ctx, render_width_, render_height_);
+	}
+
+	void RenderEngine::D3DSetViewport(ID3D11DeviceContext* ctx, uint32_t width, uint32_t height)
+	{
+		D3D11_VIEWPORT viewport;
+		viewport.Width = (float)width;
+		viewport.Height = (float)height;
+		viewport.MinDepth = 0.0f;
+		viewport.MaxDepth = 1.0f;
+		viewport.TopLeftX = 0.0f;
+		viewport.TopLeftY = 0.0f;
+
+		ctx->RSSetViewports(1, &viewport);
+	}
+
 }
\ No newline at end of file
@@ -6,10 +6,30 @@
 #include <functional>
 #include <vector>
 #include <array>
+#include <fstream>
 
 #include "Utils.h"
 #include "D3D11Predeclare.h"
 #include "RSPredeclare.h"
+#include "FramePacket.h"
+#include "FramePipeline.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "GPUProfiler.h"
+#include "RenderStatistics.h"
+#include "RenderTargetPool.h"
+#include "DynamicResolution.h"
+#include "ShaderConstants.h"
+#include "ShadowAtlas.h"
+#include "CascadedShadow.h"
+#include "LightPacker.h"
+#include "AmbientOcclusion.h"
+#include "TemporalAA.h"
+#include "PostProcess.h"
+#include "TiledLighting.h"
+#include "ImageBasedLighting.h"
+#include "CommandStream.h"
+#include <DirectXCollision.h>
 
 
 namespace epsilon
@@ -17,6 +37,15 @@ namespace epsilon
 
 	class RenderEngine
 	{
+	public:
+		enum PresentMode
+		{
+			PM_Discard,
+			PM_FlipWaitable,
+			PM_Tearing,
+			PM_FixedCap
+		};
+
 	public:
 		RenderEngine();
 		~RenderEngine();
@@ -26,6 +55,9 @@ namespace epsilon
 
 		void Resize(int width, int height);
 
+		void SetJobSystem(JobSystem& js);
+		JobSystem& Jobs();
+
 		void LoadEffect(std::string file_path);
 
 		void SetCamera(CameraPtr cam);
@@ -35,9 +67,83 @@ namespace epsilon
 		void SetAmbientLight(AmbientLightPtr al);
 		void AddDirectionLight(DirectionLightPtr dl);
 		void AddSpotLight(SpotLightPtr sl);
+		void AddPointLight(PointLightPtr pl);
 
 		void Frame();
 
+		//Overlap the update of the next frame with the submission of the current one
+		void SetPipelined(bool pipelined);
+
+		//How many frames the CPU may run ahead of the GPU
+		void SetMaxFramesInFlight(uint32_t n);
+
+		//Recreates the swap chain if it already exists
+		void SetPresentMode(PresentMode mode);
+		PresentMode GetPresentMode() const;
+
+		//Frame rate used by PM_FixedCap
+		void SetFrameRateCap(float fps);
+
+		FrameTimeStats FrameStats() const;
+
+		TraceBuffer& Trace();
+
+		//CPU and GPU time of each pass, from a frame a few frames back
+		const std::vector<PassTiming>& PassTimings() const;
+
+		//Dumps the trace buffer as Chrome trace JSON, call between frames
+		void WriteTrace(const std::string& path);
+
+		//Counters of the last completed frame
+		const RenderStatistics& Statistics() const;
+
+		//Shows the counters in the window title
+		void ShowStatistics(bool show);
+
+		//Appends one CSV row per frame, an empty path stops logging
+		void LogStatistics(const std::string& csv_path);
+
+		//Renders G-buffer and lighting at a scale of the window picked from the GPU frame time,
+		//SRGBCorrection upscales to the back buffer
+		void SetDynamicResolution(bool enable);
+		bool DynamicResolutionEnabled() const;
+
+		DynamicResolution& ResolutionController();
+
+		//Scale of the frame being submitted, 1 unless dynamic resolution is on
+		float ResolutionScale() const;
+
+		//Refits the first shadow cascade of direction lights every frame and the others in turns,
+		//a cascade is still refitted early when the camera left the part its map covers
+		void SetCascadeStaggering(bool stagger);
+		bool CascadeStaggering() const;
+
+		//Occlusion of the ambient light, computed at the preset's resolution and upsampled in the ambient pass
+		void SetAmbientOcclusion(SSAOQuality quality);
+		SSAOQuality AmbientOcclusion() const;
+
+		//Jitters the projection by a sub-pixel offset each frame and blends the lit image with the
+		//reprojected history before the sRGB pass
+		void SetTemporalAA(bool enable);
+		bool TemporalAA() const;
+
+		//Bloom from a pyramid at half resolution and below, vignette and color grading, composited in the sRGB pass
+		void SetPostProcessing(const PostSettings& settings);
+		const PostSettings& PostProcessing() const;
+
+		//Shades the ambient, spot and point lights in a compute shader over 8x8 tiles, each culling the lights
+		//into a shared list and writing its pixels once, instead of a blended pass each
+		void SetComputeLighting(bool enable);
+		bool ComputeLighting() const;
+
+		//Environment of the ambient light, a DDS cubemap or a built-in sky for an empty path. Its irradiance
+		//SH and prefiltered specular mips are computed on the job system, frames keep the previous environment,
+		//or a small unfiltered sky at first, until they're done. Setting the current path again does nothing
+		void SetEnvironmentMap(const std::string& dds_path);
+		const std::string& EnvironmentMap() const;
+
+		TransformSystem& Transforms();
+
 		IDXGISwapChain1* DXGISwapChain();
 
 		ID3D11Device* D3DDevice();
@@ -53,10 +159,78 @@ namespace epsilon
 
 		ID3D11RenderTargetView* D3DCreateRenderTargetView(ID3D11Texture2D* tex);
 
+		//Pooled render target, rounded up to its size class. Release it instead of dropping it
+		ID3D11Texture2DPtr AcquireRenderTarget(UINT width, UINT height, int /*DXGI_FORMAT*/ fmt, UINT bind_flags);
+		void ReleaseRenderTarget(const ID3D11Texture2DPtr& tex);
+
+		const RenderTargetPool<ID3D11Texture2DPtr>& RenderTargets() const;
+
+		//Bytes of video memory taken by all mips and slices of a texture
+		uint64_t D3DTextureSize(ID3D11Resource* res) const;
+
+		//Viewport of the scaled render size, which the scene and lighting passes draw into
+		void D3DSetViewport(ID3D11DeviceContext* ctx);
+		void D3DSetViewport(ID3D11DeviceContext* ctx, uint32_t width, uint32_t height);
+
+	private:
+		void CreateCommandLists();
+
+		//Replays what was recorded into imm_cs_ on the immediate context
+		void FlushCommands();
+
+		void CreateFrameQueries();
+
+		void CreateSwapChain();
+
+		void DestroySwapChain();
+
+		//Sized by the ambient occlusion preset, none when it's off
+		void CreateAOTarget();
+
+		//Drops the history, none when temporal anti-aliasing is off
+		void CreateTAATargets();
+
+		//One per pyramid level, none when bloom is off
+		void CreateBloomTargets();
+
+		void CreateGradingLUT();
+
+		//Reads the environment map and starts the job prefiltering it
+		void StartEnvironmentBuild();
+
+		//Uploads the newest finished build, if there is one
+		void FinishEnvironmentBuilds();
+
+		//Specular cube with the given mips, and their count in the ambient lighting
+		void CreateEnvironmentTexture(const std::vector<Cubemap>& mips);
+
+		void Update(FramePacket& packet);
+
+		void Submit(FramePacket& packet);
+
+		void RenderGBuffer(FramePacket& packet, const FrameConstants& frame_constants);
+
+		void UpdateShadows(FramePacket& packet, const BoundingFrustum& frustum);
+
+		void UpdateCascades(FramePacket& packet);
+
+		void RenderShadows(FramePacket& packet);
+
+		//Drops prepared packets, and with them shadow pages they were going to render
+		void InvalidatePackets();
+
+		void WaitForFrameLatency();
+
+		void EndFrameStatistics();
+
+		void UpdateRenderSize();
+
 	private:
 		HWND wnd_;
 		uint32_t width_;
 		uint32_t height_;
+		uint32_t render_width_;
+		uint32_t render_height_;
 
 		HMODULE mod_d3d11_;
 		HMODULE mod_dxgi_;
@@ -66,25 +240,117 @@ namespace epsilon
 		IDXGIFactory2Ptr gi_factory_2_;
 		IDXGIAdapterPtr gi_adapter_;
 		IDXGISwapChain1Ptr gi_swap_chain_1_;
+		IDXGISwapChain2Ptr gi_swap_chain_2_;
+
+		PresentMode present_mode_;
+		UINT swap_chain_flags_;
+		UINT sync_interval_;
+		UINT present_flags_;
+		HANDLE frame_latency_waitable_;
+		FramePacer pacer_;
+
+		TraceBuffer trace_;
+		GPUProfilerPtr gpu_profiler_;
 
 		ID3D11DevicePtr d3d_device_;
 		ID3D11DeviceContextPtr d3d_imm_ctx_;
 
 		FrameBufferPtr gbuffer_fb_;
 		FrameBufferPtr linear_depth_fb_;
+		FrameBufferPtr ao_fb_;
 		FrameBufferPtr lighting_fb_;
 		FrameBufferPtr srgb_fb_;
 
+		FrameBufferPtr shadow_atlas_fb_;
+		ShadowCache shadow_cache_;
+
+		//Projection each cascade's page was last rendered with, MAX_SHADOW_CASCADES per direction light
+		std::vector<ShadowCascade> cascades_;
+		bool stagger_cascades_;
+
+		SSAOQuality ao_quality_;
+		std::vector<float> ao_kernel_;
+
+		//Resolved images, one read as the history while the other is written
+		bool taa_enabled_;
+		uint32_t taa_frame_;
+		std::array<FrameBufferPtr, 2> taa_fbs_;
+		uint32_t taa_index_;
+		bool taa_history_valid_;
+		Vector2f taa_prev_tc_scale_;
+		Matrix taa_prev_view_proj_;
+
+		PostSettings post_settings_;
+		std::vector<FrameBufferPtr> bloom_fbs_;
+		ID3D11Texture3DPtr grading_lut_;
+		ID3D11ShaderResourceViewPtr grading_lut_srv_;
+
+		bool compute_lighting_;
+
+		std::string env_map_path_;
+		EnvironmentLighting env_lighting_;
+		ID3D11Texture2DPtr env_specular_tex_;
+		ID3D11ShaderResourceViewPtr env_specular_srv_;
+
+		//Filled by a job, uploaded by the submit after it
+		struct EnvironmentBuild
+		{
+			Cubemap env;
+			EnvironmentLighting lighting;
+			std::vector<Cubemap> mips;
+			bool superseded;
+
+			//What the job threw, kept by the job itself so the main thread sees it without a Wait
+			std::exception_ptr error;
+			JobCounter counter;
+		};
+		std::vector<std::unique_ptr<EnvironmentBuild>> env_builds_;
+
+		//Spot and point lights of the frame, uploaded where they changed
+		LightPacker light_packer_;
+		LightBufferPtr light_buffer_;
+
+		RenderTargetPool<ID3D11Texture2DPtr> rt_pool_;
+		uint32_t rt_width_;
+		uint32_t rt_height_;
+
+		DynamicResolution drs_;
+		bool drs_enabled_;
+		uint64_t drs_resolved_frames_;
+
 		ID3DX11EffectPtr d3d_effect_;
 
 		QuadPtr quad_;
 
+		TransformSystemPtr transforms_;
+
+		CommandListPtr imm_cl_;
+		std::vector<CommandListPtr> deferred_cls_;
+
+		//Draws are recorded into a stream, then replayed on the list of the same index
+		CommandStream imm_cs_;
+		std::vector<CommandStream> deferred_css_;
+
+		JobSystem* job_system_;
+
 		CameraPtr cam_;
 		std::vector<RenderablePtr> rs_;
+		std::vector<uint8_t> visible_;
+
+		FramePipeline<FramePacket> frame_pipeline_;
+
+		RenderStatistics stats_;
+		bool show_stats_;
+		std::ofstream stats_csv_;
+
+		uint32_t max_frames_in_flight_;
+		FramesInFlight frames_in_flight_;
+		std::vector<ID3D11QueryPtr> frame_queries_;
 
 		AmbientLightPtr ambient_light_;
 		std::vector<DirectionLightPtr> dir_lights_;
 		std::vector<SpotLightPtr> spot_lights_;
+		std::vector<PointLightPtr> point_lights_;
 	};
 
 }
\ No newline at end of file
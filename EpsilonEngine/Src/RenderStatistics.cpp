@@ -0,0 +1,149 @@
+#include "RenderStatistics.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Only the owning thread writes a block, so a relaxed load and store is enough to increment
+	struct ThreadStatCounters
+	{
+		std::array<std::atomic<uint64_t>, SC_NumCounters> counters;
+	};
+
+	std::mutex stat_blocks_mutex_;
+	std::vector<std::unique_ptr<ThreadStatCounters>> stat_blocks_;
+	thread_local ThreadStatCounters* tls_stat_block_ = nullptr;
+
+	ThreadStatCounters* ThreadStatBlock()
+	{
+		if (!tls_stat_block_)
+		{
+			std::unique_ptr<ThreadStatCounters> block(new ThreadStatCounters);
+			for (auto& c : block->counters)
+			{
+				c.store(0, std::memory_order_relaxed);
+			}
+
+			//Blocks outlive their threads so the running totals never go backwards
+			std::lock_guard<std::mutex> lock(stat_blocks_mutex_);
+			tls_stat_block_ = block.get();
+			stat_blocks_.push_back(std::move(block));
+		}
+		return tls_stat_block_;
+	}
+
+
+	RenderStatistics::RenderStatistics()
+		: frame_index_(0)
+	{
+		totals_.fill(0);
+		frame_.fill(0);
+	}
+
+	void RenderStatistics::Add(StatCounter counter, uint64_t n /*= 1*/)
+	{
+		std::atomic<uint64_t>& c = ThreadStatBlock()->counters[counter];
+		c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	const char* RenderStatistics::CounterName(StatCounter counter)
+	{
+		static const char* names[SC_NumCounters] =
+		{
+			"draws",
+			"triangles",
+			"state_changes",
+			"bytes_uploaded",
+			"texture_binds",
+			"frame_constant_bytes",
+			"light_constant_bytes",
+			"material_constant_bytes",
+			"object_constant_bytes",
+			"pass_constant_bytes",
+			"shadow_page_renders",
+			"shadow_caster_draws",
+			"light_buffer_bytes",
+			"dispatches"
+		};
+		return names[counter];
+	}
+
+	void RenderStatistics::EndFrame()
+	{
+		std::array<uint64_t, SC_NumCounters> totals;
+		totals.fill(0);
+		{
+			std::lock_guard<std::mutex> lock(stat_blocks_mutex_);
+			for (const auto& block : stat_blocks_)
+			{
+				for (size_t i = 0; i != SC_NumCounters; i++)
+				{
+					totals[i] += block->counters[i].load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		for (size_t i = 0; i != SC_NumCounters; i++)
+		{
+			frame_[i] = totals[i] - totals_[i];
+		}
+		totals_ = totals;
+		++frame_index_;
+	}
+
+	uint64_t RenderStatistics::Counter(StatCounter counter) const
+	{
+		return frame_[counter];
+	}
+
+	uint64_t RenderStatistics::FrameIndex() const
+	{
+		return frame_index_;
+	}
+
+	std::string RenderStatistics::Summary() const
+	{
+		std::ostringstream oss;
+		oss << "Draws: " << frame_[SC_Draws]
+			<< "  Dispatches: " << frame_[SC_Dispatches]
+			<< "  Triangles: " << frame_[SC_Triangles]
+			<< "  State changes: " << frame_[SC_StateChanges]
+			<< "  Uploaded: " << frame_[SC_BytesUploaded] / 1024 << " KB"
+			<< " (frame " << frame_[SC_FrameConstantBytes]
+			<< " / light " << frame_[SC_LightConstantBytes]
+			<< " / material " << frame_[SC_MaterialConstantBytes]
+			<< " / object " << frame_[SC_ObjectConstantBytes]
+			<< " / pass " << frame_[SC_PassConstantBytes]
+			<< " / lights " << frame_[SC_LightBufferBytes] << " B)"
+			<< "  Texture binds: " << frame_[SC_TextureBinds]
+			<< "  Shadow renders: " << frame_[SC_ShadowPageRenders]
+			<< " (" << frame_[SC_ShadowCasterDraws] << " casters)";
+		return oss.str();
+	}
+
+	void RenderStatistics::WriteCsvHeader(std::ostream& os) const
+	{
+		os << "frame";
+		for (size_t i = 0; i != SC_NumCounters; i++)
+		{
+			os << ',' << CounterName(static_cast<StatCounter>(i));
+		}
+		os << '\n';
+	}
+
+	void RenderStatistics::WriteCsvRow(std::ostream& os) const
+	{
+		os << frame_index_;
+		for (size_t i = 0; i != SC_NumCounters; i++)
+		{
+			os << ',' << frame_[i];
+		}
+		os << '\n';
+	}
+
+}
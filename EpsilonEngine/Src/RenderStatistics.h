@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <ostream>
+#include <string>
+
+
+namespace epsilon
+{
+
+	enum StatCounter
+	{
+		SC_Draws,
+		SC_Triangles,
+		SC_StateChanges,
+		SC_BytesUploaded,
+		SC_TextureBinds,
+
+		//Constant bytes set per update frequency, whether through the ring or the effect
+		SC_FrameConstantBytes,
+		SC_LightConstantBytes,
+		SC_MaterialConstantBytes,
+		SC_ObjectConstantBytes,
+		SC_PassConstantBytes,
+
+		SC_ShadowPageRenders,
+		SC_ShadowCasterDraws,
+		SC_LightBufferBytes,
+		SC_Dispatches,
+
+		SC_NumCounters
+	};
+
+
+	//Per-frame render counters. Add only touches a block owned by the calling thread,
+	//EndFrame sums every thread's block once per frame
+	class RenderStatistics
+	{
+	public:
+		RenderStatistics();
+
+		static void Add(StatCounter counter, uint64_t n = 1);
+
+		static const char* CounterName(StatCounter counter);
+
+		//Latches everything added since the previous call as the last frame's values
+		void EndFrame();
+
+		uint64_t Counter(StatCounter counter) const;
+
+		uint64_t FrameIndex() const;
+
+		std::string Summary() const;
+
+		void WriteCsvHeader(std::ostream& os) const;
+		void WriteCsvRow(std::ostream& os) const;
+
+	private:
+		std::array<uint64_t, SC_NumCounters> totals_;
+		std::array<uint64_t, SC_NumCounters> frame_;
+		uint64_t frame_index_;
+	};
+
+}
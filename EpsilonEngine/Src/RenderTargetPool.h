@@ -0,0 +1,144 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Targets are over-allocated to multiples of this, so small size changes map to the same texture
+	const uint32_t RENDER_TARGET_SIZE_STEP = 128;
+
+	inline uint32_t RenderTargetSizeClass(uint32_t extent)
+	{
+		uint32_t steps = ((std::max)(extent, 1U) + RENDER_TARGET_SIZE_STEP - 1) / RENDER_TARGET_SIZE_STEP;
+		return steps * RENDER_TARGET_SIZE_STEP;
+	}
+
+	//An allocated extent keeps serving until the window grows past it or shrinks to under half of it,
+	//in between only the viewport changes
+	inline bool RenderTargetCovers(uint32_t allocated, uint32_t needed)
+	{
+		return (needed <= allocated) && (RenderTargetSizeClass(needed) * 2 > allocated);
+	}
+
+
+	struct RenderTargetKey
+	{
+		int format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t bind_flags;
+
+		bool operator==(const RenderTargetKey& rhs) const
+		{
+			return (format == rhs.format) && (width == rhs.width) && (height == rhs.height)
+				&& (bind_flags == rhs.bind_flags);
+		}
+	};
+
+
+	//Keeps released render targets around keyed by (format, size class, bind flags) so a resize
+	//back and forth reuses them. Texture is any copyable handle, the backend creates it on a miss
+	template <typename Texture>
+	class RenderTargetPool
+	{
+	public:
+		RenderTargetPool()
+			: frame_(0), num_created_(0)
+		{
+		}
+
+		//Width and height are rounded up to their size class, which is what create receives
+		template <typename CreateFunc>
+		Texture Acquire(int format, uint32_t width, uint32_t height, uint32_t bind_flags, CreateFunc create)
+		{
+			RenderTargetKey key = { format, RenderTargetSizeClass(width), RenderTargetSizeClass(height), bind_flags };
+
+			Entry entry;
+			auto iter = std::find_if(free_.begin(), free_.end(), [&key](const Entry& e)
+			{
+				return e.key == key;
+			});
+			if (iter != free_.end())
+			{
+				entry = *iter;
+				free_.erase(iter);
+			}
+			else
+			{
+				entry.key = key;
+				entry.tex = create(key);
+				++num_created_;
+			}
+
+			entry.last_used = frame_;
+			in_use_.push_back(entry);
+			return entry.tex;
+		}
+
+		void Release(const Texture& tex)
+		{
+			auto iter = std::find_if(in_use_.begin(), in_use_.end(), [&tex](const Entry& e)
+			{
+				return e.tex == tex;
+			});
+			if (iter != in_use_.end())
+			{
+				iter->last_used = frame_;
+				free_.push_back(*iter);
+				in_use_.erase(iter);
+			}
+		}
+
+		//Advances the frame clock and drops free targets that nobody asked for in max_idle_frames
+		void Trim(uint64_t max_idle_frames)
+		{
+			++frame_;
+
+			uint64_t frame = frame_;
+			free_.erase(std::remove_if(free_.begin(), free_.end(), [frame, max_idle_frames](const Entry& e)
+			{
+				return frame - e.last_used > max_idle_frames;
+			}), free_.end());
+		}
+
+		void Clear()
+		{
+			free_.clear();
+			in_use_.clear();
+		}
+
+		//Textures the backend had to create, a resize that hits the pool leaves this unchanged
+		uint64_t NumCreated() const
+		{
+			return num_created_;
+		}
+
+		size_t NumFree() const
+		{
+			return free_.size();
+		}
+
+		size_t NumInUse() const
+		{
+			return in_use_.size();
+		}
+
+	private:
+		struct Entry
+		{
+			RenderTargetKey key;
+			Texture tex;
+			uint64_t last_used;
+		};
+
+		std::vector<Entry> free_;
+		std::vector<Entry> in_use_;
+
+		uint64_t frame_;
+		uint64_t num_created_;
+	};
+
+}
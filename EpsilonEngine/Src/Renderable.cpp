@@ -3,19 +3,39 @@
 #include <d3d11_1.h>
 #include <d3d11_2.h>
 #include "RenderEngine.h"
+#include "CommandStream.h"
+#include "Material.h"
+#include "MemoryTracker.h"
 #include "d3dx11effect.h"
-#include "DDSTextureLoader\DDSTextureLoader.h"
 
 
 namespace epsilon
 {
 
+	XMFLOAT4X4 Renderable::ModelMatrix() const
+	{
+		XMFLOAT4X4 model_mat;
+		if (transform_ != INVALID_TRANSFORM)
+		{
+			model_mat = re_->Transforms().WorldMatrix(transform_);
+		}
+		else
+		{
+			XMStoreFloat4x4(&model_mat, XMMatrixIdentity());
+		}
+		return model_mat;
+	}
+
 	void StaticMesh::CreateVertexBuffer(size_t num_vert,
 		const Vector3f* pos_data,
 		const Vector3f* norm_data,
 		const Vector2f* tc_data)
 	{
-		std::vector<VS_INPUT> vs_inputs(num_vert);
+		Vector3f min_pt, max_pt;
+		BoundsOfPoints(pos_data, num_vert, min_pt, max_pt);
+		BoundingBox::CreateFromPoints(local_bounds_, min_pt.XMV(), max_pt.XMV());
+
+		std::vector<VS_INPUT, TrackedAllocator<VS_INPUT, MC_Staging>> vs_inputs(num_vert);
 		for (size_t i = 0; i != num_vert; i++)
 		{
 			vs_inputs[i].pos = pos_data[i];
@@ -38,7 +58,7 @@ namespace epsilon
 
 		ID3D11Buffer* d3d_buffer = nullptr;
 		THROW_FAILED(re_->D3DDevice()->CreateBuffer(&buffer_desc, &buffer_data, &d3d_buffer));
-		d3d_vertex_buffer_ = MakeCOMPtr(d3d_buffer);
+		d3d_vertex_buffer_ = MakeTrackedCOMPtr(d3d_buffer, MC_VertexBuffer, buffer_desc.ByteWidth);
 	}
 
 	void StaticMesh::CreateIndexBuffer(size_t num_indice, const uint32_t* data)
@@ -58,34 +78,21 @@ namespace epsilon
 
 		ID3D11Buffer* d3d_index_buffer = nullptr;
 		THROW_FAILED(re_->D3DDevice()->CreateBuffer(&buffer_desc, &buffer_data, &d3d_index_buffer));
-		d3d_index_buffer_ = MakeCOMPtr(d3d_index_buffer);
+		d3d_index_buffer_ = MakeTrackedCOMPtr(d3d_index_buffer, MC_IndexBuffer, buffer_desc.ByteWidth);
 
 		num_indice_ = (UINT)num_indice;
 	}
 
-	void StaticMesh::CreateMaterial(std::string file_path, Vector3f ka, Vector3f kd, Vector3f ks)
+	void StaticMesh::SetMaterial(MaterialPtr mtl)
 	{
-		if (!file_path.empty())
-		{
-			std::wstring wfile_path = ToWstring(file_path);
-
-			ID3D11Resource* d3d_tex_res = nullptr;
-			ID3D11ShaderResourceView* d3d_tex_srv = nullptr;
-			if (SUCCEEDED(CreateDDSTextureFromFile(re_->D3DDevice(), wfile_path.c_str(), &d3d_tex_res, &d3d_tex_srv)))
-			{
-				d3d_tex_ = MakeCOMPtr(d3d_tex_res);
-				d3d_srv_ = MakeCOMPtr(d3d_tex_srv);
-			}
-		}
-
-		ka_ = ka;
-		kd_ = kd;
-		ks_ = ks;
+		material_ = mtl;
 	}
 
 
 	ID3D11InputLayout* StaticMesh::D3DInputLayout(ID3DX11EffectPass* pass)
 	{
+		std::lock_guard<std::mutex> lock(d3d_input_layouts_mutex_);
+
 		for (auto i = d3d_input_layouts_.begin(); i != d3d_input_layouts_.end(); i++)
 		{
 			if (i->first == pass)
@@ -128,62 +135,41 @@ namespace epsilon
 		d3d_input_layouts_.clear();
 		d3d_vertex_buffer_.reset();
 		d3d_index_buffer_.reset();
-		d3d_tex_.reset();
-		d3d_srv_.reset();
+		material_.reset();
 	}
 
-	void StaticMesh::Render(ID3DX11Effect* effect, ID3DX11EffectPass* pass)
+	bool StaticMesh::WorldBounds(BoundingBox& bounds) const
+	{
+		XMFLOAT4X4 model_mat = this->ModelMatrix();
+		local_bounds_.Transform(bounds, XMLoadFloat4x4(&model_mat));
+		return true;
+	}
+
+	void StaticMesh::Render(CommandStream& cs, ID3DX11EffectPass* pass, const XMFLOAT4X4& model_mat)
 	{
 		//Material
-		if (d3d_srv_)
+		if (material_)
 		{
-			auto var_g_albedo_tex = effect->GetVariableByName("g_albedo_tex")->AsShaderResource();
-			var_g_albedo_tex->SetResource(d3d_srv_.get());
-
-			auto var_g_albedo_map_enabled = effect->GetVariableByName("g_albedo_map_enabled")->AsScalar();
-			var_g_albedo_map_enabled->SetBool(true);
+			material_->Bind(cs);
 		}
 		else
 		{
-			auto var_g_albedo_map_enabled = effect->GetVariableByName("g_albedo_map_enabled")->AsScalar();
-			var_g_albedo_map_enabled->SetBool(false);
+			cs.SetConstants(CF_PerMaterial, DefaultMaterialConstants());
 		}
 
-		auto var_g_albedo_clr = effect->GetVariableByName("g_albedo_clr")->AsVector();
-		Vector3f albedo_clr(0.58f, 0.58f, 0.58f);
-		var_g_albedo_clr->SetFloatVector((float*)&albedo_clr);
-
-		auto var_g_metalness_clr = effect->GetVariableByName("g_metalness_clr")->AsVector();
-		Vector2f metalness_clr(0.02f, 0);
-		var_g_metalness_clr->SetFloatVector((float*)&metalness_clr);
-
-		auto var_g_glossiness_clr = effect->GetVariableByName("g_glossiness_clr")->AsVector();
-		Vector2f glossiness_clr(0.04f, 0);
-		var_g_glossiness_clr->SetFloatVector((float*)&glossiness_clr);
-
 		//Vertex buffer and index buffer
-		std::array<ID3D11Buffer*, 1> buffers = {
-			d3d_vertex_buffer_.get()
-		};
+		cs.SetVertexBuffer(d3d_vertex_buffer_.get(), sizeof(VS_INPUT));
+		cs.SetTopology(PT_TriangleList);
+		cs.SetIndexBuffer(d3d_index_buffer_.get());
+		cs.SetInputLayout(this->D3DInputLayout(pass));
 
-		std::array<UINT, 1> strides = {
-			sizeof(VS_INPUT)
-		};
-
-		std::array<UINT, 1> offsets = {
-			0
-		};
+		ObjectConstants constants;
+		constants.model_mat = model_mat;
+		cs.SetConstants(CF_PerObject, constants);
 
-		re_->D3DContext()->IASetVertexBuffers(0, 1, buffers.data(), strides.data(), offsets.data());
+		cs.ApplyPass(pass);
 
-		re_->D3DContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		re_->D3DContext()->IASetIndexBuffer(d3d_index_buffer_.get(), DXGI_FORMAT_R32_UINT, 0);
-
-		re_->D3DContext()->IASetInputLayout(this->D3DInputLayout(pass));
-
-		pass->Apply(0, re_->D3DContext());
-
-		re_->D3DContext()->DrawIndexed(num_indice_, 0, 0);
+		cs.DrawIndexed(num_indice_, 0, 0);
 	}
 
 	Quad::Quad()
@@ -196,7 +182,12 @@ namespace epsilon
 		this->Destory();
 	}
 
-	void Quad::Render(ID3DX11Effect* effect, ID3DX11EffectPass* pass)
+	void Quad::Render(CommandStream& cs, ID3DX11EffectPass* pass, const XMFLOAT4X4& model_mat)
+	{
+		this->Render(cs, pass);
+	}
+
+	void Quad::Render(CommandStream& cs, ID3DX11EffectPass* pass)
 	{
 		if (!d3d_vertex_buffer_)
 		{
@@ -223,31 +214,17 @@ namespace epsilon
 
 			ID3D11Buffer* d3d_buffer = nullptr;
 			THROW_FAILED(re_->D3DDevice()->CreateBuffer(&buffer_desc, &buffer_data, &d3d_buffer));
-			d3d_vertex_buffer_ = MakeCOMPtr(d3d_buffer);
+			d3d_vertex_buffer_ = MakeTrackedCOMPtr(d3d_buffer, MC_VertexBuffer, buffer_desc.ByteWidth);
 		}
 
-		//Vertex buffer and index buffer
-		std::array<ID3D11Buffer*, 1> buffers = {
-			d3d_vertex_buffer_.get()
-		};
-
-		std::array<UINT, 1> strides = {
-			sizeof(Vector3f)
-		};
-
-		std::array<UINT, 1> offsets = {
-			0
-		};
-
-		re_->D3DContext()->IASetVertexBuffers(0, 1, buffers.data(), strides.data(), offsets.data());
-
-		re_->D3DContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-
-		re_->D3DContext()->IASetInputLayout(this->D3DInputLayout(pass));
+		//Vertex buffer
+		cs.SetVertexBuffer(d3d_vertex_buffer_.get(), sizeof(Vector3f));
+		cs.SetTopology(PT_TriangleStrip);
+		cs.SetInputLayout(this->D3DInputLayout(pass));
 
-		pass->Apply(0, re_->D3DContext());
+		cs.ApplyPass(pass);
 
-		re_->D3DContext()->Draw(4, 0);
+		cs.Draw(4, 0);
 	}
 
 	void Quad::Destory()
@@ -2,7 +2,11 @@
 #include "D3D11Predeclare.h"
 #include "RSPredeclare.h"
 #include "Utils.h"
+#include "Transform.h"
+#include "ShaderConstants.h"
+#include <DirectXCollision.h>
 #include <vector>
+#include <mutex>
 
 
 namespace epsilon
@@ -11,9 +15,23 @@ namespace epsilon
 	class Renderable
 	{
 	public:
+		Renderable() : transform_(INVALID_TRANSFORM) {}
+
 		INTERFACE_SET_RE;
 
-		virtual void Render(ID3DX11Effect* effect, ID3DX11EffectPass* pass) = 0;
+		inline void SetTransform(TransformHandle h) { transform_ = h; }
+		inline TransformHandle Transform() const { return transform_; }
+
+		XMFLOAT4X4 ModelMatrix() const;
+
+		//Returns false if the renderable has no bounds and must never be culled
+		virtual bool WorldBounds(BoundingBox& bounds) const { return false; }
+
+		//Records the draw with pass, which belongs to the effect of the list the stream is replayed on
+		virtual void Render(CommandStream& cs, ID3DX11EffectPass* pass, const XMFLOAT4X4& model_mat) = 0;
+
+	protected:
+		TransformHandle transform_;
 	};
 
 
@@ -23,14 +41,18 @@ namespace epsilon
 		StaticMesh();
 		virtual ~StaticMesh();
 
-		virtual void Render(ID3DX11Effect* effect, ID3DX11EffectPass* pass) override;
+		virtual void Render(CommandStream& cs, ID3DX11EffectPass* pass, const XMFLOAT4X4& model_mat) override;
+
+		virtual bool WorldBounds(BoundingBox& bounds) const override;
 
 		void CreateVertexBuffer(size_t num_vert,
 			const Vector3f* pos_data,
 			const Vector3f* norm_data,
 			const Vector2f* tc_data);
 		void CreateIndexBuffer(size_t num_indice, const uint32_t* data);
-		void CreateMaterial(std::string file_path, Vector3f ka, Vector3f kd, Vector3f ks);
+
+		//Meshes share materials, one without any renders with DefaultMaterialConstants
+		void SetMaterial(MaterialPtr mtl);
 
 		void Destory();
 
@@ -50,12 +72,13 @@ namespace epsilon
 
 		unsigned int num_indice_;
 
-		std::vector<std::pair<ID3DX11EffectPass*, ID3D11InputLayoutPtr>> d3d_input_layouts_;
+		BoundingBox local_bounds_;
 
-		ID3D11ResourcePtr d3d_tex_;
-		ID3D11ShaderResourceViewPtr d3d_srv_;
+		//Passes of cloned effects are looked up from recording threads
+		std::mutex d3d_input_layouts_mutex_;
+		std::vector<std::pair<ID3DX11EffectPass*, ID3D11InputLayoutPtr>> d3d_input_layouts_;
 
-		Vector3f ka_, kd_, ks_;
+		MaterialPtr material_;
 	};
 
 
@@ -65,7 +88,10 @@ namespace epsilon
 		Quad();
 		virtual ~Quad();
 
-		virtual void Render(ID3DX11Effect* effect, ID3DX11EffectPass* pass) override;
+		virtual void Render(CommandStream& cs, ID3DX11EffectPass* pass, const XMFLOAT4X4& model_mat) override;
+
+		//Fullscreen passes need no model matrix
+		void Render(CommandStream& cs, ID3DX11EffectPass* pass);
 
 		void Destory();
 
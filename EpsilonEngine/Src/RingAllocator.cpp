@@ -0,0 +1,145 @@
+#include "RingAllocator.h"
+
+
+namespace epsilon
+{
+	const size_t INITIAL_FRAME_MARKS = 8;
+
+
+	RingAllocator::RingAllocator(uint64_t size /*= 0*/)
+		: frames_(INITIAL_FRAME_MARKS)
+	{
+		this->Reset(size);
+	}
+
+	void RingAllocator::Reset(uint64_t size)
+	{
+		size_ = size;
+		this->Reset();
+	}
+
+	void RingAllocator::Reset()
+	{
+		head_ = 0;
+		tail_ = 0;
+		used_ = 0;
+		frame_used_ = 0;
+		frame_bytes_ = 0;
+		frames_first_ = 0;
+		frames_count_ = 0;
+	}
+
+	uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		if ((0 == size) || (size > size_))
+		{
+			return INVALID_OFFSET;
+		}
+
+		if (0 == used_)
+		{
+			//Nothing in flight, start over at the front so fewer allocations wrap
+			head_ = 0;
+			tail_ = 0;
+		}
+
+		uint64_t offset = (head_ + alignment - 1) & ~(alignment - 1);
+
+		//head_ == tail_ with something in flight means full
+		if ((head_ > tail_) || (0 == used_))
+		{
+			//Free space is [head_, size_) and then [0, tail_)
+			if (offset + size <= size_)
+			{
+				return this->Commit(offset, size, offset + size - head_);
+			}
+
+			//Skip the end of the buffer, offset 0 is aligned for any alignment
+			if (size <= tail_)
+			{
+				return this->Commit(0, size, size_ - head_ + size);
+			}
+		}
+		else if (head_ < tail_)
+		{
+			//Free space is [head_, tail_)
+			if (offset + size <= tail_)
+			{
+				return this->Commit(offset, size, offset + size - head_);
+			}
+		}
+
+		return INVALID_OFFSET;
+	}
+
+	uint64_t RingAllocator::Commit(uint64_t offset, uint64_t size, uint64_t consumed)
+	{
+		head_ = offset + size;
+		used_ += consumed;
+		frame_used_ += consumed;
+		frame_bytes_ += size;
+		return offset;
+	}
+
+	void RingAllocator::FinishFrame(uint64_t fence)
+	{
+		if (frames_count_ == frames_.size())
+		{
+			//Unwrap into a larger ring, only when more frames are in flight than ever before
+			std::vector<FrameMark> frames(frames_.size() * 2);
+			for (size_t i = 0; i != frames_count_; i++)
+			{
+				frames[i] = frames_[(frames_first_ + i) % frames_.size()];
+			}
+			frames_.swap(frames);
+			frames_first_ = 0;
+		}
+
+		FrameMark& mark = frames_[(frames_first_ + frames_count_) % frames_.size()];
+		mark.fence = fence;
+		mark.head = head_;
+		mark.used = frame_used_;
+		++frames_count_;
+
+		frame_used_ = 0;
+		frame_bytes_ = 0;
+	}
+
+	void RingAllocator::ReleaseCompleted(uint64_t completed_fence)
+	{
+		while (frames_count_ > 0)
+		{
+			const FrameMark& mark = frames_[frames_first_];
+			if (mark.fence > completed_fence)
+			{
+				break;
+			}
+
+			//A frame that allocated nothing may predate a restart at the front, its head is stale
+			if (mark.used > 0)
+			{
+				tail_ = mark.head;
+				used_ -= mark.used;
+			}
+
+			frames_first_ = (frames_first_ + 1) % frames_.size();
+			--frames_count_;
+		}
+	}
+
+	uint64_t RingAllocator::Size() const
+	{
+		return size_;
+	}
+
+	uint64_t RingAllocator::UsedBytes() const
+	{
+		return used_;
+	}
+
+	uint64_t RingAllocator::FrameBytes() const
+	{
+		return frame_bytes_;
+	}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Offsets into a GPU buffer written front to back with no-overwrite maps. Each frame's allocations
+	//are tagged with a fence and their space is only handed out again once that fence has completed.
+	//Knows nothing about the buffer itself, so any API can sit on top
+	class RingAllocator
+	{
+	public:
+		static const uint64_t INVALID_OFFSET = ~0ULL;
+
+	public:
+		explicit RingAllocator(uint64_t size = 0);
+
+		//Forgets every allocation, for a new buffer or one that has been renamed
+		void Reset(uint64_t size);
+		void Reset();
+
+		//alignment must be a power of two. Returns INVALID_OFFSET when the only free space
+		//is still being read by frames in flight
+		uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+		//Tags everything allocated since the previous call with the fence of the frame
+		void FinishFrame(uint64_t fence);
+
+		//Returns the space of every finished frame whose fence is at or below completed_fence
+		void ReleaseCompleted(uint64_t completed_fence);
+
+		uint64_t Size() const;
+
+		//Including alignment padding and the space skipped when wrapping
+		uint64_t UsedBytes() const;
+
+		//Requested bytes since the last FinishFrame
+		uint64_t FrameBytes() const;
+
+	private:
+		uint64_t Commit(uint64_t offset, uint64_t size, uint64_t consumed);
+
+	private:
+		struct FrameMark
+		{
+			uint64_t fence;
+			uint64_t head;
+			uint64_t used;
+		};
+
+		uint64_t size_;
+		uint64_t head_;
+		uint64_t tail_;
+		uint64_t used_;
+
+		uint64_t frame_used_;
+		uint64_t frame_bytes_;
+
+		//Frames in flight, oldest at frames_first_. Kept as a ring so steady state never allocates
+		std::vector<FrameMark> frames_;
+		size_t frames_first_;
+		size_t frames_count_;
+	};
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "Utils.h"
+#include "ImageBasedLighting.h"
+
+
+namespace epsilon
+{
+
+	//The cbuffers of DeferredRendering.fx, one per update frequency
+	enum ConstantFrequency
+	{
+		CF_PerFrame,
+		CF_PerLight,
+		CF_PerMaterial,
+		CF_PerObject,
+		CF_PerPass,
+
+		CF_NumFrequencies
+	};
+
+
+	//Matches MAX_SHADOW_CASCADES in DeferredRendering.fx
+	const uint32_t MAX_SHADOW_CASCADES = 4;
+
+	//Matches MAX_SSAO_SAMPLES in DeferredRendering.fx
+	const uint32_t MAX_SSAO_SAMPLES = 16;
+
+	//Layouts follow HLSL packing: a vector never straddles a 16-byte register, so a float3 is
+	//padded unless a scalar follows it. Matrices are uploaded as-is and declared row_major.
+	//Initialize with = {} so the padding is zero and equal values compare equal
+
+	struct FrameConstants
+	{
+		XMFLOAT4X4 view_mat;
+		XMFLOAT4X4 proj_mat;
+		XMFLOAT4X4 inv_proj_mat;
+		Vector4f near_q_far;
+		Vector2f tc_scale;
+
+		//Spot and point lights in the light buffer
+		uint32_t num_lights;
+		float pad;
+	};
+
+	struct LightConstants
+	{
+		Vector3f light_pos_es;
+		float pad0;
+		Vector3f light_dir_es;
+		float pad1;
+		Vector3f light_color;
+		float pad2;
+		Vector4f light_falloff_range;
+		float shadow_enabled;
+		float num_cascades;
+		Vector2f pad3;
+
+		//World to the light's clip space, for rendering its shadow page
+		XMFLOAT4X4 light_view_proj;
+
+		//View space to the light's space, these on to each cascade's uv and depth. World space for the
+		//ambient light, whose environment is there
+		XMFLOAT4X4 shadow_mat;
+		Vector4f cascade_scale[MAX_SHADOW_CASCADES];
+		Vector4f cascade_offset[MAX_SHADOW_CASCADES];
+		Vector4f cascade_uv_clamp[MAX_SHADOW_CASCADES];
+
+		//Irradiance SH of the ambient light's environment, rgb each, and the mips of its specular cube
+		Vector4f ambient_sh[SH_COEFFICIENTS];
+		float env_specular_mips;
+		Vector3f pad4;
+	};
+
+	struct MaterialConstants
+	{
+		Vector3f albedo_clr;
+		uint32_t albedo_map_enabled;
+		Vector2f metalness_clr;
+		Vector2f glossiness_clr;
+		uint32_t normal_map_enabled;
+		Vector3f pad5;
+	};
+
+	struct ObjectConstants
+	{
+		XMFLOAT4X4 model_mat;
+	};
+
+	//Full-screen passes besides the lighting, each reads the part it needs
+	struct PassConstants
+	{
+		//SSAOKernel points, in the frame around the normal
+		Vector4f ao_kernel[MAX_SSAO_SAMPLES];
+
+		//Viewports of the occlusion target and of the full-resolution targets, in texels
+		Vector2f ao_size;
+		Vector2f render_size;
+		float ao_radius;
+		float ao_bias;
+		float ao_intensity;
+
+		//0 leaves the ambient light unoccluded
+		uint32_t ao_num_samples;
+
+		//View space to the previous frame's unjittered clip space, and the part of the history target
+		//that frame covered
+		XMFLOAT4X4 taa_reproj_mat;
+		Vector2f taa_prev_tc_scale;
+
+		//Weight of the current frame, 1 drops the history
+		float taa_blend;
+
+		//Brightness where bloom starts and the soft transition below it, and the weight it's added back with
+		float bloom_threshold;
+		float bloom_knee;
+		float bloom_intensity;
+
+		//Valid texels of the source and of the target of a post-processing pass
+		Vector2f post_src_size;
+		Vector2f post_dst_size;
+
+		//Darkening at the corners, 0 leaves them
+		float vignette;
+
+		//Nonzero maps the sRGB-encoded image through g_grading_lut
+		uint32_t grading_enabled;
+	};
+
+}
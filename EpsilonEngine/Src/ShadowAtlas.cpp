@@ -0,0 +1,406 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace epsilon
+{
+	//Ideal size has to pass the next power of two by this factor before a page changes size
+	const float SHADOW_PAGE_HYSTERESIS = 1.25f;
+
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+
+
+	uint32_t NextPowerOfTwo(uint32_t v)
+	{
+		uint32_t p = 1;
+		while (p < v)
+		{
+			p <<= 1;
+		}
+		return p;
+	}
+
+
+	ShadowAtlasPacker::ShadowAtlasPacker(uint32_t atlas_size /*= 0*/, uint32_t min_page_size /*= 1*/)
+	{
+		this->Reset(atlas_size, min_page_size);
+	}
+
+	void ShadowAtlasPacker::Reset(uint32_t atlas_size, uint32_t min_page_size)
+	{
+		atlas_size_ = atlas_size;
+		min_page_size_ = (std::max)((std::min)(min_page_size, atlas_size), 1U);
+
+		free_.clear();
+		if (atlas_size_ > 0)
+		{
+			free_.resize(this->Level(min_page_size_) + 1);
+
+			ShadowPage root = { 0, 0, atlas_size_ };
+			free_[0].push_back(root);
+		}
+	}
+
+	bool ShadowAtlasPacker::Allocate(uint32_t size, ShadowPage& page)
+	{
+		if (0 == atlas_size_)
+		{
+			return false;
+		}
+
+		size = (std::min)((std::max)(NextPowerOfTwo(size), min_page_size_), atlas_size_);
+		uint32_t target = this->Level(size);
+
+		//Split the smallest free page that is large enough
+		uint32_t level = target;
+		while (free_[level].empty())
+		{
+			if (0 == level)
+			{
+				return false;
+			}
+			--level;
+		}
+
+		ShadowPage p = free_[level].back();
+		free_[level].pop_back();
+		while (level < target)
+		{
+			uint32_t half = p.size / 2;
+			++level;
+
+			ShadowPage sibling = { p.x + half, p.y, half };
+			free_[level].push_back(sibling);
+			sibling.x = p.x;
+			sibling.y = p.y + half;
+			free_[level].push_back(sibling);
+			sibling.x = p.x + half;
+			free_[level].push_back(sibling);
+
+			p.size = half;
+		}
+
+		page = p;
+		return true;
+	}
+
+	void ShadowAtlasPacker::Free(const ShadowPage& page)
+	{
+		if (0 == page.size)
+		{
+			return;
+		}
+
+		ShadowPage p = page;
+		uint32_t level = this->Level(p.size);
+		while (level > 0)
+		{
+			uint32_t parent_size = p.size * 2;
+			uint32_t px = p.x & ~(parent_size - 1);
+			uint32_t py = p.y & ~(parent_size - 1);
+
+			//Merge only when all three siblings are free
+			uint32_t siblings[3][2];
+			uint32_t num_siblings = 0;
+			for (uint32_t i = 0; i != 4; i++)
+			{
+				uint32_t sx = px + (i & 1) * p.size;
+				uint32_t sy = py + (i >> 1) * p.size;
+				if ((sx != p.x) || (sy != p.y))
+				{
+					siblings[num_siblings][0] = sx;
+					siblings[num_siblings][1] = sy;
+					++num_siblings;
+				}
+			}
+
+			bool all_free = true;
+			for (uint32_t i = 0; i != 3; i++)
+			{
+				const std::vector<ShadowPage>& pages = free_[level];
+				uint32_t sx = siblings[i][0];
+				uint32_t sy = siblings[i][1];
+				all_free &= pages.end() != std::find_if(pages.begin(), pages.end(), [sx, sy](const ShadowPage& fp)
+				{
+					return (fp.x == sx) && (fp.y == sy);
+				});
+			}
+			if (!all_free)
+			{
+				break;
+			}
+
+			for (uint32_t i = 0; i != 3; i++)
+			{
+				this->RemoveFree(level, siblings[i][0], siblings[i][1]);
+			}
+
+			p.x = px;
+			p.y = py;
+			p.size = parent_size;
+			--level;
+		}
+
+		free_[level].push_back(p);
+	}
+
+	uint32_t ShadowAtlasPacker::AtlasSize() const
+	{
+		return atlas_size_;
+	}
+
+	uint32_t ShadowAtlasPacker::MinPageSize() const
+	{
+		return min_page_size_;
+	}
+
+	uint64_t ShadowAtlasPacker::FreeArea() const
+	{
+		uint64_t area = 0;
+		for (const auto& pages : free_)
+		{
+			for (const auto& p : pages)
+			{
+				area += static_cast<uint64_t>(p.size) * p.size;
+			}
+		}
+		return area;
+	}
+
+	uint32_t ShadowAtlasPacker::Level(uint32_t size) const
+	{
+		uint32_t level = 0;
+		for (uint32_t s = atlas_size_; s > size; s >>= 1)
+		{
+			++level;
+		}
+		return level;
+	}
+
+	bool ShadowAtlasPacker::RemoveFree(uint32_t level, uint32_t x, uint32_t y)
+	{
+		std::vector<ShadowPage>& pages = free_[level];
+		for (size_t i = 0; i != pages.size(); i++)
+		{
+			if ((pages[i].x == x) && (pages[i].y == y))
+			{
+				pages[i] = pages.back();
+				pages.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	uint32_t ShadowPageSize(float projected_size, uint32_t current_size, uint32_t min_size, uint32_t max_size)
+	{
+		float ideal = (std::min)((std::max)(projected_size, static_cast<float>(min_size)), static_cast<float>(max_size));
+		uint32_t size = (std::min)(NextPowerOfTwo(static_cast<uint32_t>(std::ceil(ideal))), max_size);
+
+		if ((current_size >= min_size) && (current_size <= max_size))
+		{
+			if ((size > current_size) && (ideal < current_size * SHADOW_PAGE_HYSTERESIS))
+			{
+				size = current_size;
+			}
+			else if ((size < current_size) && (ideal * SHADOW_PAGE_HYSTERESIS > current_size / 2))
+			{
+				size = current_size;
+			}
+		}
+
+		return size;
+	}
+
+	float ProjectedSphereSize(float dist, float radius, float proj_scale, float viewport_height)
+	{
+		if (dist <= radius)
+		{
+			return (std::numeric_limits<float>::max)();
+		}
+
+		return radius / std::sqrt(dist * dist - radius * radius) * proj_scale * viewport_height;
+	}
+
+	void SpotLightBoundingSphere(const float pos[3], const float dir[3], float range, float half_angle,
+		float center[3], float& radius)
+	{
+		//Wide cones are bounded by the circle of their base, narrow ones by the sphere through apex and rim
+		float c = std::cos(half_angle);
+		float d;
+		if (half_angle > 0.78539816f)
+		{
+			d = range * c;
+			radius = range * std::sin(half_angle);
+		}
+		else
+		{
+			d = range / (2 * c);
+			radius = d;
+		}
+
+		for (int i = 0; i != 3; i++)
+		{
+			center[i] = pos[i] + dir[i] * d;
+		}
+	}
+
+	void ShadowPageScaleOffset(const ShadowPage& page, uint32_t atlas_size, float scale_offset[4])
+	{
+		float inv_atlas = 1.0f / atlas_size;
+		scale_offset[0] = 0.5f * page.size * inv_atlas;
+		scale_offset[1] = -0.5f * page.size * inv_atlas;
+		scale_offset[2] = (page.x + 0.5f * page.size) * inv_atlas;
+		scale_offset[3] = (page.y + 0.5f * page.size) * inv_atlas;
+	}
+
+	void ShadowPageUVClamp(const ShadowPage& page, uint32_t atlas_size, float uv_rect[4])
+	{
+		float inv_atlas = 1.0f / atlas_size;
+		uv_rect[0] = (page.x + 0.5f) * inv_atlas;
+		uv_rect[1] = (page.y + 0.5f) * inv_atlas;
+		uv_rect[2] = (page.x + page.size - 0.5f) * inv_atlas;
+		uv_rect[3] = (page.y + page.size - 0.5f) * inv_atlas;
+	}
+
+
+	ShadowHash::ShadowHash()
+		: hash_(FNV_OFFSET_BASIS)
+	{
+	}
+
+	void ShadowHash::Add(const void* data, size_t size)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i != size; i++)
+		{
+			hash_ = (hash_ ^ p[i]) * FNV_PRIME;
+		}
+	}
+
+	uint64_t ShadowHash::Value() const
+	{
+		return hash_;
+	}
+
+
+	ShadowCache::ShadowCache()
+		: frame_(0), num_renders_(0)
+	{
+	}
+
+	void ShadowCache::Reset(uint32_t atlas_size, uint32_t min_page_size)
+	{
+		packer_.Reset(atlas_size, min_page_size);
+		entries_.clear();
+	}
+
+	void ShadowCache::BeginFrame()
+	{
+		++frame_;
+	}
+
+	bool ShadowCache::Update(uint32_t light, uint64_t light_hash, uint64_t casters_hash, uint32_t page_size, ShadowPage& page)
+	{
+		if (light >= entries_.size())
+		{
+			Entry entry = {};
+			entries_.resize(light + 1, entry);
+		}
+
+		Entry& entry = entries_[light];
+		entry.last_used = frame_;
+
+		if ((entry.requested_size != page_size) || (0 == entry.page.size))
+		{
+			packer_.Free(entry.page);
+			entry.page = ShadowPage();
+			entry.requested_size = page_size;
+			entry.rendered = false;
+
+			//A full atlas gives smaller pages rather than none
+			uint32_t size = page_size;
+			while (!packer_.Allocate(size, entry.page) && (size > packer_.MinPageSize()))
+			{
+				size /= 2;
+			}
+		}
+
+		page = entry.page;
+		if (0 == entry.page.size)
+		{
+			return false;
+		}
+
+		bool render = !entry.rendered || (entry.light_hash != light_hash) || (entry.casters_hash != casters_hash);
+		entry.rendered = true;
+		entry.light_hash = light_hash;
+		entry.casters_hash = casters_hash;
+
+		if (render)
+		{
+			++num_renders_;
+		}
+		return render;
+	}
+
+	bool ShadowCache::Keep(uint32_t light, ShadowPage& page)
+	{
+		if ((light >= entries_.size()) || !entries_[light].rendered || (0 == entries_[light].page.size))
+		{
+			return false;
+		}
+
+		Entry& entry = entries_[light];
+		entry.last_used = frame_;
+		page = entry.page;
+		return true;
+	}
+
+	uint32_t ShadowCache::PageSize(uint32_t light) const
+	{
+		return light < entries_.size() ? entries_[light].requested_size : 0;
+	}
+
+	void ShadowCache::Trim(uint64_t max_idle_frames)
+	{
+		for (auto& entry : entries_)
+		{
+			if ((entry.page.size > 0) && (frame_ - entry.last_used > max_idle_frames))
+			{
+				packer_.Free(entry.page);
+				entry.page = ShadowPage();
+				entry.requested_size = 0;
+				entry.rendered = false;
+			}
+		}
+	}
+
+	void ShadowCache::Invalidate()
+	{
+		for (auto& entry : entries_)
+		{
+			entry.rendered = false;
+		}
+	}
+
+	uint64_t ShadowCache::Frame() const
+	{
+		return frame_;
+	}
+
+	uint64_t ShadowCache::NumRenders() const
+	{
+		return num_renders_;
+	}
+
+	const ShadowAtlasPacker& ShadowCache::Packer() const
+	{
+		return packer_;
+	}
+
+}
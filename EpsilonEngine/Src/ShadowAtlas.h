@@ -0,0 +1,150 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	//Square region of the shadow atlas, in texels. size 0 means no page
+	struct ShadowPage
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t size;
+	};
+
+
+	//Hands out power-of-two square pages of a square atlas. A page is split into four to serve
+	//smaller requests, and four free siblings merge back when the last of them is freed
+	class ShadowAtlasPacker
+	{
+	public:
+		explicit ShadowAtlasPacker(uint32_t atlas_size = 0, uint32_t min_page_size = 1);
+
+		//Both must be powers of two. Drops every page
+		void Reset(uint32_t atlas_size, uint32_t min_page_size);
+
+		//size is rounded up to a power of two between the minimum page size and the atlas size
+		bool Allocate(uint32_t size, ShadowPage& page);
+
+		void Free(const ShadowPage& page);
+
+		uint32_t AtlasSize() const;
+		uint32_t MinPageSize() const;
+
+		//Texels not covered by an allocated page
+		uint64_t FreeArea() const;
+
+	private:
+		uint32_t Level(uint32_t size) const;
+
+		bool RemoveFree(uint32_t level, uint32_t x, uint32_t y);
+
+	private:
+		uint32_t atlas_size_;
+		uint32_t min_page_size_;
+
+		//Free pages per level, level 0 is the whole atlas
+		std::vector<std::vector<ShadowPage>> free_;
+	};
+
+
+	//Power-of-two page size for a light covering projected_size pixels on screen. With a current page,
+	//the size only changes once the ideal has moved well past the neighbouring size, so a camera
+	//hovering around a boundary doesn't re-render the page every frame
+	uint32_t ShadowPageSize(float projected_size, uint32_t current_size, uint32_t min_size, uint32_t max_size);
+
+	//Diameter in pixels of a sphere at distance dist from the eye. proj_scale is the projection's
+	//y scale, cot(fov / 2). An eye inside the sphere gets a huge value
+	float ProjectedSphereSize(float dist, float radius, float proj_scale, float viewport_height);
+
+	//Smallest sphere around a cone with its apex at pos, pointing along the normalized dir
+	void SpotLightBoundingSphere(const float pos[3], const float dir[3], float range, float half_angle,
+		float center[3], float& radius);
+
+	//Scale and offset (sx, sy, ox, oy) taking clip-space xy to the page's atlas uv, y flipped
+	void ShadowPageScaleOffset(const ShadowPage& page, uint32_t atlas_size, float scale_offset[4]);
+
+	//Atlas uv rectangle (min x, min y, max x, max y) of the page inset by half a texel,
+	//so bilinear comparisons never read a neighbouring page
+	void ShadowPageUVClamp(const ShadowPage& page, uint32_t atlas_size, float uv_rect[4]);
+
+
+	//FNV-1a over the state a shadow page depends on
+	class ShadowHash
+	{
+	public:
+		ShadowHash();
+
+		void Add(const void* data, size_t size);
+
+		template <typename T>
+		void Add(const T& v)
+		{
+			this->Add(&v, sizeof(v));
+		}
+
+		uint64_t Value() const;
+
+	private:
+		uint64_t hash_;
+	};
+
+
+	//Keeps each light's page in the atlas across frames. A page is rendered again only when the
+	//light moved, something inside its cone changed or its size changed
+	class ShadowCache
+	{
+	public:
+		ShadowCache();
+
+		void Reset(uint32_t atlas_size, uint32_t min_page_size);
+
+		//Advances the frame clock, call before updating the lights of a frame
+		void BeginFrame();
+
+		//Returns true when the light's page has to be rendered this frame. page.size is 0 when
+		//not even a minimum page was free, the light is then unshadowed
+		bool Update(uint32_t light, uint64_t light_hash, uint64_t casters_hash, uint32_t page_size, ShadowPage& page);
+
+		//Keeps the light's page as last rendered without checking for changes. Returns false when there
+		//is no rendered page to keep, Update has to run instead
+		bool Keep(uint32_t light, ShadowPage& page);
+
+		//Current page of a light, to pick the next size with hysteresis
+		uint32_t PageSize(uint32_t light) const;
+
+		//Frees the pages of lights that haven't been updated in max_idle_frames
+		void Trim(uint64_t max_idle_frames);
+
+		//Makes every light render its page again, e.g. after the atlas contents were lost
+		void Invalidate();
+
+		//Frames begun so far
+		uint64_t Frame() const;
+
+		uint64_t NumRenders() const;
+
+		const ShadowAtlasPacker& Packer() const;
+
+	private:
+		struct Entry
+		{
+			ShadowPage page;
+			uint32_t requested_size;
+			bool rendered;
+			uint64_t light_hash;
+			uint64_t casters_hash;
+			uint64_t last_used;
+		};
+
+		ShadowAtlasPacker packer_;
+		std::vector<Entry> entries_;
+
+		uint64_t frame_;
+		uint64_t num_renders_;
+	};
+
+}
@@ -0,0 +1,129 @@
+#include "TemporalAA.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace epsilon
+{
+
+	float Halton(uint32_t index, uint32_t base)
+	{
+		float f = 1;
+		float r = 0;
+		while (index > 0)
+		{
+			f /= base;
+			r += f * (index % base);
+			index /= base;
+		}
+		return r;
+	}
+
+	void HaltonJitter(uint32_t index, float offset[2])
+	{
+		//Index 0 of the sequence is the corner, start at 1
+		offset[0] = Halton(index + 1, 2) - 0.5f;
+		offset[1] = Halton(index + 1, 3) - 0.5f;
+	}
+
+	void JitterToNDC(const float offset[2], uint32_t width, uint32_t height, float ndc[2])
+	{
+		ndc[0] = 2 * offset[0] / width;
+		ndc[1] = -2 * offset[1] / height;
+	}
+
+	void TransformPoint(const float m[16], const float v[4], float out[4])
+	{
+		for (int j = 0; j != 4; j++)
+		{
+			out[j] = v[0] * m[j] + v[1] * m[4 + j] + v[2] * m[8 + j] + v[3] * m[12 + j];
+		}
+	}
+
+	bool ReprojectToUV(const float reproj_mat[16], const float pos[3], float uv[2])
+	{
+		const float p[4] = { pos[0], pos[1], pos[2], 1 };
+		float clip[4];
+		TransformPoint(reproj_mat, p, clip);
+		if (clip[3] <= 0)
+		{
+			return false;
+		}
+
+		uv[0] = clip[0] / clip[3] * 0.5f + 0.5f;
+		uv[1] = 0.5f - clip[1] / clip[3] * 0.5f;
+		return true;
+	}
+
+	//Bilinear filtering of an rgb image at uv, clamped to the edge texels
+	void SampleBilinear(const float* image, uint32_t width, uint32_t height, float u, float v, float rgb[3])
+	{
+		float x = u * width - 0.5f;
+		float y = v * height - 0.5f;
+		float fx = std::floor(x);
+		float fy = std::floor(y);
+		float tx = x - fx;
+		float ty = y - fy;
+
+		int x0 = (std::min)((std::max)(static_cast<int>(fx), 0), static_cast<int>(width) - 1);
+		int y0 = (std::min)((std::max)(static_cast<int>(fy), 0), static_cast<int>(height) - 1);
+		int x1 = (std::min)((std::max)(static_cast<int>(fx) + 1, 0), static_cast<int>(width) - 1);
+		int y1 = (std::min)((std::max)(static_cast<int>(fy) + 1, 0), static_cast<int>(height) - 1);
+
+		for (int c = 0; c != 3; c++)
+		{
+			float top = image[(y0 * width + x0) * 3 + c] * (1 - tx) + image[(y0 * width + x1) * 3 + c] * tx;
+			float bottom = image[(y1 * width + x0) * 3 + c] * (1 - tx) + image[(y1 * width + x1) * 3 + c] * tx;
+			rgb[c] = top * (1 - ty) + bottom * ty;
+		}
+	}
+
+	void ResolveTemporalAA(const float* current, const float* history, const float* depth, uint32_t width, uint32_t height,
+		float proj_x, float proj_y, const float reproj_mat[16], float blend, float* resolved)
+	{
+		for (uint32_t y = 0; y != height; y++)
+		{
+			for (uint32_t x = 0; x != width; x++)
+			{
+				const float* c = current + (y * width + x) * 3;
+				float* out = resolved + (y * width + x) * 3;
+
+				float lo[3] = { c[0], c[1], c[2] };
+				float hi[3] = { c[0], c[1], c[2] };
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					int ny = (std::min)((std::max)(static_cast<int>(y) + dy, 0), static_cast<int>(height) - 1);
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = (std::min)((std::max)(static_cast<int>(x) + dx, 0), static_cast<int>(width) - 1);
+						const float* n = current + (ny * width + nx) * 3;
+						for (int ch = 0; ch != 3; ch++)
+						{
+							lo[ch] = (std::min)(lo[ch], n[ch]);
+							hi[ch] = (std::max)(hi[ch], n[ch]);
+						}
+					}
+				}
+
+				float z = depth[y * width + x];
+				float pos[3] = { ((x + 0.5f) / width * 2 - 1) / proj_x * z, (1 - (y + 0.5f) / height * 2) / proj_y * z, z };
+
+				float uv[2];
+				if (!history || !ReprojectToUV(reproj_mat, pos, uv) || (uv[0] < 0) || (uv[0] > 1) || (uv[1] < 0) || (uv[1] > 1))
+				{
+					std::copy(c, c + 3, out);
+					continue;
+				}
+
+				float h[3];
+				SampleBilinear(history, width, height, uv[0], uv[1], h);
+				for (int ch = 0; ch != 3; ch++)
+				{
+					float clamped = (std::min)((std::max)(h[ch], lo[ch]), hi[ch]);
+					out[ch] = clamped + (c[ch] - clamped) * blend;
+				}
+			}
+		}
+	}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+
+namespace epsilon
+{
+
+	//Sub-pixel jitter and the reference version of the TemporalResolve pass of DeferredRendering.fx.
+	//Matrices are 16 floats, row-major for row vectors as XMFLOAT4X4 holds them. Images are row-major
+	//rgb, depth is view-space z
+
+	//Offset of the index-th frame in pixels, in [-0.5, 0.5). The Halton (2, 3) sequence, which covers
+	//the pixel evenly over any run of frames
+	void HaltonJitter(uint32_t index, float offset[2]);
+
+	//A pixel offset as an NDC offset for a viewport of the given size, y pointing up
+	void JitterToNDC(const float offset[2], uint32_t width, uint32_t height, float ndc[2]);
+
+	//Where a view-space position was in the previous frame's image, as uv. reproj_mat takes view space
+	//to the previous clip space. Returns false when the position was behind that camera
+	bool ReprojectToUV(const float reproj_mat[16], const float pos[3], float uv[2]);
+
+	//Blends the history, clamped to the 3x3 neighbourhood of the current pixel so stale colors don't
+	//ghost, with the current frame. blend is the current frame's weight, history may be null. A pixel
+	//is reprojected from its center without the jitter, so a still camera reads the history where it
+	//wrote it. proj_x and proj_y are the projection's x and y scales
+	void ResolveTemporalAA(const float* current, const float* history, const float* depth, uint32_t width, uint32_t height,
+		float proj_x, float proj_y, const float reproj_mat[16], float blend, float* resolved);
+
+}
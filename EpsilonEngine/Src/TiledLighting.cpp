@@ -0,0 +1,91 @@
+#include "TiledLighting.h"
+#include <algorithm>
+
+
+namespace epsilon
+{
+
+	void LightingDispatchSize(uint32_t width, uint32_t height, uint32_t& groups_x, uint32_t& groups_y)
+	{
+		groups_x = (width + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE;
+		groups_y = (height + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE;
+	}
+
+	void TileNDCRect(uint32_t tile_x, uint32_t tile_y, uint32_t width, uint32_t height, float rect[4])
+	{
+		uint32_t x0 = tile_x * LIGHTING_TILE_SIZE;
+		uint32_t y0 = tile_y * LIGHTING_TILE_SIZE;
+		uint32_t x1 = (std::min)(x0 + LIGHTING_TILE_SIZE, width);
+		uint32_t y1 = (std::min)(y0 + LIGHTING_TILE_SIZE, height);
+
+		//NDC y points up, the tile's bottom row is its min y
+		rect[0] = static_cast<float>(x0) / width * 2 - 1;
+		rect[1] = 1 - static_cast<float>(y1) / height * 2;
+		rect[2] = static_cast<float>(x1) / width * 2 - 1;
+		rect[3] = 1 - static_cast<float>(y0) / height * 2;
+	}
+
+	void TileDepthBounds(const float* depth, uint32_t width, uint32_t height, uint32_t tile_x, uint32_t tile_y,
+		float bounds[2])
+	{
+		uint32_t x0 = tile_x * LIGHTING_TILE_SIZE;
+		uint32_t y0 = tile_y * LIGHTING_TILE_SIZE;
+		uint32_t x1 = (std::min)(x0 + LIGHTING_TILE_SIZE, width);
+		uint32_t y1 = (std::min)(y0 + LIGHTING_TILE_SIZE, height);
+
+		bounds[0] = depth[y0 * width + x0];
+		bounds[1] = bounds[0];
+		for (uint32_t y = y0; y != y1; y++)
+		{
+			for (uint32_t x = x0; x != x1; x++)
+			{
+				bounds[0] = (std::min)(bounds[0], depth[y * width + x]);
+				bounds[1] = (std::max)(bounds[1], depth[y * width + x]);
+			}
+		}
+	}
+
+	bool LightOverlapsTile(const PackedLight& light, const float rect[4], const float depth_bounds[2])
+	{
+		//An empty screen rectangle has min > max and meets nothing
+		const float* sr = light.screen_rect;
+		return ((std::max)(sr[0], rect[0]) <= (std::min)(sr[2], rect[2]))
+			&& ((std::max)(sr[1], rect[1]) <= (std::min)(sr[3], rect[3]))
+			&& (light.pos_es[2] - light.range <= depth_bounds[1])
+			&& (light.pos_es[2] + light.range >= depth_bounds[0]);
+	}
+
+	void BuildTileLightLists(const PackedLight* lights, size_t num_lights, const float* depth, uint32_t width,
+		uint32_t height, TileLightLists& lists)
+	{
+		LightingDispatchSize(width, height, lists.groups_x, lists.groups_y);
+
+		size_t num_tiles = static_cast<size_t>(lists.groups_x) * lists.groups_y;
+		lists.counts.assign(num_tiles, 0);
+		lists.indices.resize(num_tiles * MAX_TILE_LIGHTS);
+
+		for (uint32_t ty = 0; ty != lists.groups_y; ty++)
+		{
+			for (uint32_t tx = 0; tx != lists.groups_x; tx++)
+			{
+				float rect[4];
+				float depth_bounds[2];
+				TileNDCRect(tx, ty, width, height, rect);
+				TileDepthBounds(depth, width, height, tx, ty, depth_bounds);
+
+				size_t tile = static_cast<size_t>(ty) * lists.groups_x + tx;
+				uint32_t* indices = &lists.indices[tile * MAX_TILE_LIGHTS];
+				uint32_t& count = lists.counts[tile];
+				for (size_t i = 0; (i != num_lights) && (count != MAX_TILE_LIGHTS); i++)
+				{
+					if (LightOverlapsTile(lights[i], rect, depth_bounds))
+					{
+						indices[count] = static_cast<uint32_t>(i);
+						++count;
+					}
+				}
+			}
+		}
+	}
+
+}
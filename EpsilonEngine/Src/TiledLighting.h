@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "LightPacker.h"
+
+
+namespace epsilon
+{
+
+	//Dispatch sizing and per-tile light lists of the TiledLighting compute pass of DeferredRendering.fx,
+	//for checking the shader. Depth is view-space z, row-major
+
+	//Threads along each side of a thread group, one tile of pixels, LIGHTING_TILE_SIZE in the shader
+	const uint32_t LIGHTING_TILE_SIZE = 8;
+
+	//Lights a tile's list holds, MAX_TILE_LIGHTS in the shader. Further ones are dropped
+	const uint32_t MAX_TILE_LIGHTS = 256;
+
+	//Thread groups covering a viewport, partial tiles at the right and bottom edges included
+	void LightingDispatchSize(uint32_t width, uint32_t height, uint32_t& groups_x, uint32_t& groups_y);
+
+	//NDC rectangle of a tile's pixels, (min x, min y, max x, max y)
+	void TileNDCRect(uint32_t tile_x, uint32_t tile_y, uint32_t width, uint32_t height, float rect[4]);
+
+	//Nearest and farthest depth of the tile's pixels inside the viewport
+	void TileDepthBounds(const float* depth, uint32_t width, uint32_t height, uint32_t tile_x, uint32_t tile_y,
+		float bounds[2]);
+
+	//The light's screen rectangle meets the tile's and its range meets the tile's depths
+	bool LightOverlapsTile(const PackedLight& light, const float rect[4], const float depth_bounds[2]);
+
+	struct TileLightLists
+	{
+		uint32_t groups_x;
+		uint32_t groups_y;
+
+		//Lights of each tile, row by row, up to MAX_TILE_LIGHTS. Lists are MAX_TILE_LIGHTS apart in indices
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> indices;
+	};
+
+	//Lists in light order. The shader fills its lists from 64 threads at once, so its order varies, and
+	//so do the lights an overflowing list drops, the lights of the other lists are the same
+	void BuildTileLightLists(const PackedLight* lights, size_t num_lights, const float* depth, uint32_t width,
+		uint32_t height, TileLightLists& lists);
+
+}
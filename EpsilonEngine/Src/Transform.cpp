@@ -0,0 +1,268 @@
+#include "Transform.h"
+#include <algorithm>
+#include <cstring>
+
+
+namespace epsilon
+{
+	//Nodes gathered and computed together, their streams and matrices stay in L1
+	const uint32_t TRANSFORM_BATCH_SIZE = 128;
+
+
+	TransformSystem::TransformSystem()
+	{
+		num_levels_ = 0;
+		any_dirty_ = false;
+	}
+
+	TransformHandle TransformSystem::Create(TransformHandle parent)
+	{
+		TransformHandle h = (TransformHandle)parents_.size();
+		if (parent != INVALID_TRANSFORM && parent >= h)
+		{
+			DO_THROW_MSG("Transform parent must be created before its children");
+		}
+
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+		for (auto& stream : positions_)
+		{
+			stream.push_back(0.0f);
+		}
+		for (size_t c = 0; c != rotations_.size(); c++)
+		{
+			rotations_[c].push_back((3 == c) ? 1.0f : 0.0f);
+		}
+		for (auto& stream : scales_)
+		{
+			stream.push_back(1.0f);
+		}
+
+		uint32_t depth = (parent != INVALID_TRANSFORM) ? depths_[parent] + 1 : 0;
+		parents_.push_back(parent);
+		depths_.push_back(depth);
+		dirty_.push_back(1);
+		world_mats_.push_back(identity);
+		num_levels_ = (std::max)(num_levels_, depth + 1);
+
+		any_dirty_ = true;
+
+		return h;
+	}
+
+	void TransformSystem::Clear()
+	{
+		for (auto& stream : positions_)
+		{
+			stream.clear();
+		}
+		for (auto& stream : rotations_)
+		{
+			stream.clear();
+		}
+		for (auto& stream : scales_)
+		{
+			stream.clear();
+		}
+		parents_.clear();
+		depths_.clear();
+		dirty_.clear();
+		world_mats_.clear();
+		num_levels_ = 0;
+		dirty_list_.clear();
+		any_dirty_ = false;
+	}
+
+	void TransformSystem::SetPosition(TransformHandle h, const Vector3f& pos)
+	{
+		positions_[0][h] = pos.x;
+		positions_[1][h] = pos.y;
+		positions_[2][h] = pos.z;
+		this->MarkDirty(h);
+	}
+
+	void TransformSystem::SetRotation(TransformHandle h, const Vector4f& quat)
+	{
+		rotations_[0][h] = quat.x;
+		rotations_[1][h] = quat.y;
+		rotations_[2][h] = quat.z;
+		rotations_[3][h] = quat.w;
+		this->MarkDirty(h);
+	}
+
+	void TransformSystem::SetScale(TransformHandle h, const Vector3f& scale)
+	{
+		scales_[0][h] = scale.x;
+		scales_[1][h] = scale.y;
+		scales_[2][h] = scale.z;
+		this->MarkDirty(h);
+	}
+
+	Vector3f TransformSystem::Position(TransformHandle h) const
+	{
+		return Vector3f(positions_[0][h], positions_[1][h], positions_[2][h]);
+	}
+
+	Vector4f TransformSystem::Rotation(TransformHandle h) const
+	{
+		return Vector4f(rotations_[0][h], rotations_[1][h], rotations_[2][h], rotations_[3][h]);
+	}
+
+	Vector3f TransformSystem::Scale(TransformHandle h) const
+	{
+		return Vector3f(scales_[0][h], scales_[1][h], scales_[2][h]);
+	}
+
+	TransformHandle TransformSystem::Parent(TransformHandle h) const
+	{
+		return parents_[h];
+	}
+
+	const XMFLOAT4X4& TransformSystem::WorldMatrix(TransformHandle h) const
+	{
+		return world_mats_[h];
+	}
+
+	size_t TransformSystem::Count() const
+	{
+		return parents_.size();
+	}
+
+	void TransformSystem::MarkDirty(TransformHandle h)
+	{
+		dirty_[h] = 1;
+		any_dirty_ = true;
+	}
+
+	void TransformSystem::Update()
+	{
+		if (!any_dirty_)
+		{
+			return;
+		}
+
+		//Parents always precede children, so one forward sweep propagates dirtiness down the hierarchy.
+		//It also counts the dirty nodes of each depth
+		dirty_list_.clear();
+		level_begins_.assign(num_levels_ + 1, 0);
+		for (size_t i = 0; i != parents_.size(); i++)
+		{
+			TransformHandle p = parents_[i];
+			if (p != INVALID_TRANSFORM && dirty_[p])
+			{
+				dirty_[i] = 1;
+			}
+			if (dirty_[i])
+			{
+				dirty_list_.push_back((TransformHandle)i);
+				++level_begins_[depths_[i]];
+			}
+		}
+
+		//Counting sort by depth. Running sums make each count the end of its depth, filling back to front
+		//moves it to the beginning. Storage order is kept within a depth
+		uint32_t num_dirty = 0;
+		for (auto& count : level_begins_)
+		{
+			num_dirty += count;
+			count = num_dirty;
+		}
+		level_order_.resize(num_dirty);
+		for (size_t i = num_dirty; i-- != 0;)
+		{
+			TransformHandle h = dirty_list_[i];
+			level_order_[--level_begins_[depths_[h]]] = h;
+		}
+
+		//A depth's parents are all in the depths before it, final by the time it's reached. Each batch of a
+		//depth goes through composing and multiplying while it's in cache
+		for (uint32_t level = 0; level != num_levels_; level++)
+		{
+			for (uint32_t begin = level_begins_[level]; begin != level_begins_[level + 1];)
+			{
+				uint32_t count = (std::min)(level_begins_[level + 1] - begin, TRANSFORM_BATCH_SIZE);
+				this->UpdateBatch(&level_order_[begin], count, level > 0);
+				begin += count;
+			}
+		}
+
+		for (size_t i = 0; i != dirty_list_.size(); i++)
+		{
+			dirty_[dirty_list_[i]] = 0;
+		}
+		any_dirty_ = false;
+	}
+
+	void TransformSystem::UpdateBatch(const TransformHandle* batch, uint32_t count, bool has_parents)
+	{
+		//A run of consecutive nodes, as siblings created together are, reads and writes the streams in
+		//place. Anything else is gathered
+		bool run = (batch[count - 1] - batch[0] == count - 1);
+		TransformHandle first = batch[0];
+
+		float* streams[10];
+		if (run)
+		{
+			streams[0] = &scales_[0][first];
+			streams[1] = &scales_[1][first];
+			streams[2] = &scales_[2][first];
+			streams[3] = &rotations_[0][first];
+			streams[4] = &rotations_[1][first];
+			streams[5] = &rotations_[2][first];
+			streams[6] = &rotations_[3][first];
+			streams[7] = &positions_[0][first];
+			streams[8] = &positions_[1][first];
+			streams[9] = &positions_[2][first];
+		}
+		else
+		{
+			batch_streams_.resize(TRANSFORM_BATCH_SIZE * 10);
+			for (size_t c = 0; c != 10; c++)
+			{
+				streams[c] = &batch_streams_[c * TRANSFORM_BATCH_SIZE];
+			}
+			for (uint32_t j = 0; j != count; j++)
+			{
+				TransformHandle h = batch[j];
+				streams[0][j] = scales_[0][h];
+				streams[1][j] = scales_[1][h];
+				streams[2][j] = scales_[2][h];
+				streams[3][j] = rotations_[0][h];
+				streams[4][j] = rotations_[1][h];
+				streams[5][j] = rotations_[2][h];
+				streams[6][j] = rotations_[3][h];
+				streams[7][j] = positions_[0][h];
+				streams[8][j] = positions_[1][h];
+				streams[9][j] = positions_[2][h];
+			}
+		}
+
+		local_mats_.resize(TRANSFORM_BATCH_SIZE * 16);
+		float* out = run ? &world_mats_[first]._11 : local_mats_.data();
+		float* locals = has_parents ? local_mats_.data() : out;
+		AffineMatrices(ConstFloat3Streams(streams[0], streams[1], streams[2]),
+			ConstFloat4Streams(streams[3], streams[4], streams[5], streams[6]),
+			ConstFloat3Streams(streams[7], streams[8], streams[9]), locals, count);
+
+		//Roots are their local matrix
+		if (has_parents)
+		{
+			parent_mats_.resize(TRANSFORM_BATCH_SIZE * 16);
+			for (uint32_t j = 0; j != count; j++)
+			{
+				memcpy(&parent_mats_[j * 16], &world_mats_[parents_[batch[j]]]._11, sizeof(float) * 16);
+			}
+			MultiplyMatrices(locals, parent_mats_.data(), out, count);
+		}
+
+		if (!run)
+		{
+			for (uint32_t j = 0; j != count; j++)
+			{
+				memcpy(&world_mats_[batch[j]]._11, &local_mats_[j * 16], sizeof(float) * 16);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Utils.h"
+#include <array>
+#include <vector>
+
+
+namespace epsilon
+{
+
+	typedef uint32_t TransformHandle;
+
+	const TransformHandle INVALID_TRANSFORM = 0xFFFFFFFF;
+
+
+	//Positions, rotations and scales are kept as structure-of-arrays streams. Update gathers the dirty
+	//nodes depth by depth and computes their matrices in batches through BatchMath
+	class TransformSystem
+	{
+	public:
+		TransformSystem();
+
+		//Parent must already exist, so storage order is always a valid topological order
+		TransformHandle Create(TransformHandle parent = INVALID_TRANSFORM);
+
+		void Clear();
+
+		void SetPosition(TransformHandle h, const Vector3f& pos);
+		void SetRotation(TransformHandle h, const Vector4f& quat);
+		void SetScale(TransformHandle h, const Vector3f& scale);
+
+		Vector3f Position(TransformHandle h) const;
+		Vector4f Rotation(TransformHandle h) const;
+		Vector3f Scale(TransformHandle h) const;
+		TransformHandle Parent(TransformHandle h) const;
+
+		const XMFLOAT4X4& WorldMatrix(TransformHandle h) const;
+
+		size_t Count() const;
+
+		//Recompute world matrices of dirty nodes and everything below them
+		void Update();
+
+	private:
+		void MarkDirty(TransformHandle h);
+
+		//World matrices of up to TRANSFORM_BATCH_SIZE nodes of one depth
+		void UpdateBatch(const TransformHandle* batch, uint32_t count, bool has_parents);
+
+	private:
+		std::array<std::vector<float>, 3> positions_;
+		std::array<std::vector<float>, 4> rotations_;
+		std::array<std::vector<float>, 3> scales_;
+		std::vector<TransformHandle> parents_;
+		std::vector<uint32_t> depths_;
+		std::vector<uint8_t> dirty_;
+		std::vector<XMFLOAT4X4> world_mats_;
+		uint32_t num_levels_;
+
+		//Scratch of Update, kept between frames. Dirty nodes in storage order and sorted by depth, where
+		//each depth begins in the latter, and a batch's gathered scale, rotation and translation streams
+		//and matrices
+		std::vector<TransformHandle> dirty_list_;
+		std::vector<TransformHandle> level_order_;
+		std::vector<uint32_t> level_begins_;
+		std::vector<float> batch_streams_;
+		std::vector<float> local_mats_;
+		std::vector<float> parent_mats_;
+		bool any_dirty_;
+	};
+
+}
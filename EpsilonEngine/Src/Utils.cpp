@@ -5,7 +5,7 @@
 namespace epsilon
 {
 
-	std::wstring epsilon::ToWstring(const std::string& str, const std::locale& loc /*= std::locale()*/)
+	std::wstring ToWstring(const std::string& str, const std::locale& loc /*= std::locale()*/)
 	{
 		std::vector<wchar_t> buf(str.size());
 		std::use_facet<std::ctype<wchar_t>>(loc).widen(str.data(),//ctype<char_type>  
@@ -14,7 +14,7 @@ namespace epsilon
 		return std::wstring(buf.data(), buf.size());
 	}
 
-	std::string epsilon::ToString(const std::wstring& str, const std::locale& loc /*= std::locale()*/)
+	std::string ToString(const std::wstring& str, const std::locale& loc /*= std::locale()*/)
 	{
 		std::vector<char> buf(str.size());
 		std::use_facet<std::ctype<wchar_t>>(loc).narrow(str.data(),
@@ -1,9 +1,25 @@
 #pragma once
 #include <stdint.h>
-#include <DirectXMath.h>
-#include <string>
-#include <xlocale>
+#include <cmath>
+#include <functional>
+#include <locale>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include "BatchMath.h"
+
+//DirectXMath where the Windows SDK ships it, elsewhere (or with EPSILON_PORTABLE_MATH) its subset in
+//PortableMath.h. Both pick SSE, NEON or plain C from the target. EPSILON_MATH_NO_INTRINSICS forces the
+//plain C path, for comparing against the SIMD ones
+#if defined(_MSC_VER) && !defined(EPSILON_PORTABLE_MATH)
+#if defined(EPSILON_MATH_NO_INTRINSICS) && !defined(_XM_NO_INTRINSICS_)
+#define _XM_NO_INTRINSICS_
+#endif
+#include <DirectXMath.h>
+#else
+#include "PortableMath.h"
+#endif
 
 
 namespace epsilon
@@ -197,12 +213,37 @@ namespace epsilon
 
 	inline float Length(const Vector2f& v)
 	{
-		return ::sqrt(v.x * v.x + v.y * v.y);
+		return std::sqrt(v.x * v.x + v.y * v.y);
 	}
 
 	inline float Length(const Vector3f& v)
 	{
-		return ::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+
+	//Whole-array forms of the above, on the SIMD paths of BatchMath.h. out may be in
+	inline void TransformCoords(const Vector3f* in, Vector3f* out, size_t count, const Matrix& mat)
+	{
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, mat);
+		TransformCoords(&m._11, reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), count);
+	}
+
+	inline void TransformNormals(const Vector3f* in, Vector3f* out, size_t count, const Matrix& mat)
+	{
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, mat);
+		TransformNormals(&m._11, reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), count);
+	}
+
+	inline void NormalizeVectors(const Vector3f* in, Vector3f* out, size_t count)
+	{
+		NormalizeVectors(reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), count);
+	}
+
+	inline void BoundsOfPoints(const Vector3f* pts, size_t count, Vector3f& min_pt, Vector3f& max_pt)
+	{
+		BoundsOfPoints(reinterpret_cast<const float*>(pts), count, &min_pt.x, &max_pt.x);
 	}
 
 	std::wstring ToWstring(const std::string& str, const std::locale& loc = std::locale());
@@ -213,9 +254,7 @@ namespace epsilon
 
 inline std::string CombineFileLine(std::string const & file, int line)
 {
-	char str[256];
-	sprintf_s(str, "%s: %d", file.c_str(), line);
-	return std::string(str);
+	return file + ": " + std::to_string(line);
 }
 
 template <typename T>
@@ -225,6 +264,6 @@ inline std::shared_ptr<T> MakeCOMPtr(T* p)
 }
 
 
-#define DO_THROW_MSG(x)	{ throw std::exception(x); }
+#define DO_THROW_MSG(x)	{ throw std::runtime_error(x); }
 #define DO_THROW(x)	{ throw std::system_error(std::make_error_code(x), CombineFileLine(__FILE__, __LINE__)); }
 #define THROW_FAILED(x)	{ HRESULT _hr = x; if (static_cast<HRESULT>(_hr) < 0) { throw std::runtime_error(CombineFileLine(__FILE__, __LINE__)); } }
\ No newline at end of file
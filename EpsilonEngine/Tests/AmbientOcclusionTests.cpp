@@ -0,0 +1,262 @@
+#include "TestHarness.h"
+#include "AmbientOcclusion.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const uint32_t WIDTH = 160;
+	const uint32_t HEIGHT = 90;
+	const float PROJ_Y = 1.732f;
+	const float PROJ_X = PROJ_Y * HEIGHT / WIDTH;
+
+	const uint32_t REFERENCE_SAMPLES = 64;
+
+	//Rays from the origin through each pixel, the depth being the hit's distance along the view axis
+	struct Scene
+	{
+		std::vector<float> depth;
+		std::vector<float> normals;
+
+		explicit Scene(bool corner)
+			: depth(WIDTH * HEIGHT), normals(WIDTH * HEIGHT * 3)
+		{
+			const float sphere[4] = { 0.8f, -0.4f, 4, 0.6f };
+
+			for (uint32_t y = 0; y != HEIGHT; y++)
+			{
+				for (uint32_t x = 0; x != WIDTH; x++)
+				{
+					float dir[3] = { ((x + 0.5f) / WIDTH * 2 - 1) / PROJ_X, (1 - (y + 0.5f) / HEIGHT * 2) / PROJ_Y, 1 };
+
+					//A wall at z = 8 facing the camera, with a floor at y = -1, a wall at x = -2 and a ball
+					//in front of it in the corner scene
+					float z = 8;
+					float n[3] = { 0, 0, -1 };
+					if (corner)
+					{
+						if ((dir[1] < 0) && (-1 / dir[1] < z))
+						{
+							z = -1 / dir[1];
+							n[0] = 0;
+							n[1] = 1;
+							n[2] = 0;
+						}
+						if ((dir[0] < 0) && (-2 / dir[0] < z))
+						{
+							z = -2 / dir[0];
+							n[0] = 1;
+							n[1] = 0;
+							n[2] = 0;
+						}
+
+						float dd = dir[0] * dir[0] + dir[1] * dir[1] + 1;
+						float dc = dir[0] * sphere[0] + dir[1] * sphere[1] + sphere[2];
+						float cc = sphere[0] * sphere[0] + sphere[1] * sphere[1] + sphere[2] * sphere[2] - sphere[3] * sphere[3];
+						float disc = dc * dc - dd * cc;
+						float t = (dc - std::sqrt((std::max)(disc, 0.0f))) / dd;
+						if ((disc >= 0) && (t > 0) && (t < z))
+						{
+							z = t;
+							for (int c = 0; c != 3; c++)
+							{
+								n[c] = (dir[c] * t - sphere[c]) / sphere[3];
+							}
+						}
+					}
+
+					depth[y * WIDTH + x] = z;
+					std::copy(n, n + 3, &normals[(y * WIDTH + x) * 3]);
+				}
+			}
+		}
+	};
+
+	//Full-resolution visibility with the given settings
+	std::vector<float> RunSSAO(const Scene& scene, const SSAOSettings& settings)
+	{
+		std::vector<float> kernel(settings.num_samples * 4);
+		SSAOKernel(settings.num_samples, kernel.data());
+
+		uint32_t ao_width = SSAOTargetSize(WIDTH, settings.downscale);
+		uint32_t ao_height = SSAOTargetSize(HEIGHT, settings.downscale);
+		std::vector<float> ao(ao_width * ao_height * 2);
+		ComputeSSAO(scene.depth.data(), scene.normals.data(), WIDTH, HEIGHT, PROJ_X, PROJ_Y, settings, kernel.data(), ao.data());
+
+		std::vector<float> visibility(WIDTH * HEIGHT);
+		UpsampleSSAO(ao.data(), ao_width, ao_height, scene.depth.data(), WIDTH, HEIGHT, visibility.data());
+		return visibility;
+	}
+
+	SSAOSettings Settings(uint32_t downscale, uint32_t num_samples)
+	{
+		SSAOSettings settings = SSAOPreset(SQ_High);
+		settings.downscale = downscale;
+		settings.num_samples = num_samples;
+		return settings;
+	}
+
+	double MeanAbsError(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		double error = 0;
+		for (size_t i = 0; i != a.size(); i++)
+		{
+			error += std::abs(a[i] - b[i]);
+		}
+		return error / a.size();
+	}
+
+	//Darkest pixel on the line from (u0, v0) to (u1, v1), in [0, 1] screen coordinates
+	float Darkest(const std::vector<float>& visibility, float u0, float v0, float u1, float v1)
+	{
+		float darkest = 1;
+		for (int i = 0; i <= 100; i++)
+		{
+			float u = u0 + (u1 - u0) * i / 100;
+			float v = v0 + (v1 - v0) * i / 100;
+			darkest = (std::min)(darkest, visibility[static_cast<uint32_t>(v * HEIGHT) * WIDTH + static_cast<uint32_t>(u * WIDTH)]);
+		}
+		return darkest;
+	}
+}
+
+
+TEST_CASE(AmbientOcclusion, TargetSizeRoundsUp)
+{
+	CHECK_EQ(SSAOTargetSize(1280, 1), 1280u);
+	CHECK_EQ(SSAOTargetSize(1280, 2), 640u);
+	CHECK_EQ(SSAOTargetSize(1281, 2), 641u);
+	CHECK_EQ(SSAOTargetSize(719, 4), 180u);
+	CHECK_EQ(SSAOTargetSize(1, 4), 1u);
+}
+
+TEST_CASE(AmbientOcclusion, KernelFillsTheHemisphere)
+{
+	const uint32_t counts[] = { 1, 4, 8, 16, 64 };
+	for (uint32_t num_samples : counts)
+	{
+		std::vector<float> kernel(num_samples * 4);
+		SSAOKernel(num_samples, kernel.data());
+
+		//Above the surface, inside the radius, and longer further along so most sit near the pixel
+		float last_len = 0;
+		for (uint32_t s = 0; s != num_samples; s++)
+		{
+			const float* k = &kernel[s * 4];
+			float len = std::sqrt(k[0] * k[0] + k[1] * k[1] + k[2] * k[2]);
+			CHECK(k[2] >= 0);
+			CHECK(len <= 1);
+			CHECK(len >= last_len);
+			CHECK_EQ(k[3], 0.0f);
+			last_len = len;
+		}
+	}
+}
+
+TEST_CASE(AmbientOcclusion, OpenWallIsUnoccluded)
+{
+	Scene wall(false);
+	for (uint32_t num_samples : { 4u, 16u, 64u })
+	{
+		std::vector<float> visibility = RunSSAO(wall, Settings(1, num_samples));
+		CHECK_EQ(*std::min_element(visibility.begin(), visibility.end()), 1.0f);
+	}
+
+	SSAOSettings off = SSAOPreset(SQ_Off);
+	CHECK_EQ(off.num_samples, 0u);
+	std::vector<float> visibility = RunSSAO(Scene(true), off);
+	CHECK_EQ(*std::min_element(visibility.begin(), visibility.end()), 1.0f);
+}
+
+TEST_CASE(AmbientOcclusion, CreasesAreDarker)
+{
+	Scene corner(true);
+	std::vector<float> visibility = RunSSAO(corner, Settings(1, REFERENCE_SAMPLES));
+	for (float v : visibility)
+	{
+		REQUIRE((v >= 0) && (v <= 1));
+	}
+
+	//Across the back wall's creases with the side wall and the floor, and along the floor under the ball
+	float open_wall = Darkest(visibility, 0.5f, 0.1f, 0.9f, 0.4f);
+	float open_floor = Darkest(visibility, 0.9f, 0.8f, 0.9f, 0.95f);
+	float wall_crease = Darkest(visibility, 0.3f, 0.3f, 0.45f, 0.3f);
+	float floor_crease = Darkest(visibility, 0.9f, 0.55f, 0.9f, 0.65f);
+	float under_ball = Darkest(visibility, 0.5f, 0.7f, 0.7f, 0.7f);
+	CHECK(open_wall > 0.98f);
+	CHECK(open_floor > 0.98f);
+	CHECK(wall_crease < 0.9f);
+	CHECK(floor_crease < 0.9f);
+	CHECK(under_ball < 0.6f);
+}
+
+TEST_CASE(AmbientOcclusion, PresetsStayCloseToReference)
+{
+	Scene corner(true);
+	std::vector<float> reference = RunSSAO(corner, Settings(1, REFERENCE_SAMPLES));
+
+	//Downscaling costs more than fewer samples, most of what the cheaper presets lose is at the edges
+	for (int q = SQ_Low; q != SQ_NumQualities; q++)
+	{
+		double error = MeanAbsError(RunSSAO(corner, SSAOPreset(static_cast<SSAOQuality>(q))), reference);
+		CHECK(error < ((SSAOPreset(static_cast<SSAOQuality>(q)).downscale == 1) ? 0.005 : 0.03));
+	}
+}
+
+TEST_CASE(AmbientOcclusion, MoreSamplesConverge)
+{
+	Scene corner(true);
+	std::vector<float> reference = RunSSAO(corner, Settings(1, REFERENCE_SAMPLES));
+
+	//At full resolution only, a downscaled result is off by its sampling positions whatever the count
+	double last_error = 1;
+	for (uint32_t num_samples : { 4u, 8u, 16u, 32u })
+	{
+		double error = MeanAbsError(RunSSAO(corner, Settings(1, num_samples)), reference);
+		CHECK(error < last_error);
+		last_error = error;
+	}
+}
+
+TEST_CASE(AmbientOcclusion, UpsampleKeepsDepthEdges)
+{
+	Scene corner(true);
+	SSAOSettings settings = Settings(2, 16);
+	uint32_t ao_width = SSAOTargetSize(WIDTH, settings.downscale);
+	uint32_t ao_height = SSAOTargetSize(HEIGHT, settings.downscale);
+
+	std::vector<float> kernel(settings.num_samples * 4);
+	SSAOKernel(settings.num_samples, kernel.data());
+	std::vector<float> ao(ao_width * ao_height * 2);
+	ComputeSSAO(corner.depth.data(), corner.normals.data(), WIDTH, HEIGHT, PROJ_X, PROJ_Y, settings, kernel.data(), ao.data());
+
+	//Lit back wall, black everything in front of it: nothing near the camera picks up the wall's light
+	for (size_t i = 0; i != ao_width * ao_height; i++)
+	{
+		ao[i * 2] = (ao[i * 2 + 1] == 8) ? 1.0f : 0.0f;
+	}
+	std::vector<float> visibility(WIDTH * HEIGHT);
+	UpsampleSSAO(ao.data(), ao_width, ao_height, corner.depth.data(), WIDTH, HEIGHT, visibility.data());
+
+	double wall_sum = 0;
+	uint32_t num_wall = 0;
+	for (size_t i = 0; i != visibility.size(); i++)
+	{
+		if (corner.depth[i] < 7)
+		{
+			CHECK_EQ(visibility[i], 0.0f);
+		}
+		else if (corner.depth[i] == 8)
+		{
+			wall_sum += visibility[i];
+			++num_wall;
+		}
+	}
+	REQUIRE(num_wall > 0);
+	CHECK(wall_sum / num_wall > 0.95);
+}
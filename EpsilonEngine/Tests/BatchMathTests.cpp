@@ -0,0 +1,238 @@
+#include "TestHarness.h"
+#include "BatchMath.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//Covers every tail length of the 4 and 8 wide kernels, and one long run
+	const size_t COUNTS[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 1000 };
+
+	struct Vec3
+	{
+		float x, y, z;
+	};
+
+	//Rotation, translation and a perspective projection, so w varies per point
+	void PerspectiveMatrix(float* m)
+	{
+		const float rot_trans[16] =
+		{
+			0.8f, 0.3f, -0.5f, 0,
+			-0.2f, 0.9f, 0.4f, 0,
+			0.55f, -0.3f, 0.75f, 0,
+			1, 2, 3, 1
+		};
+		const float proj[16] =
+		{
+			1.36f, 0, 0, 0,
+			0, 2.41f, 0, 0,
+			0, 0, 1.0002f, 1,
+			0, 0, -0.10002f, 0
+		};
+		for (int r = 0; r != 4; r++)
+		{
+			for (int c = 0; c != 4; c++)
+			{
+				float sum = 0;
+				for (int k = 0; k != 4; k++)
+				{
+					sum += rot_trans[r * 4 + k] * proj[k * 4 + c];
+				}
+				m[r * 4 + c] = sum;
+			}
+		}
+	}
+
+	Vec3 ReferenceCoord(const float* m, const Vec3& v)
+	{
+		float x = v.x * m[0] + v.y * m[4] + v.z * m[8] + m[12];
+		float y = v.x * m[1] + v.y * m[5] + v.z * m[9] + m[13];
+		float z = v.x * m[2] + v.y * m[6] + v.z * m[10] + m[14];
+		float w = v.x * m[3] + v.y * m[7] + v.z * m[11] + m[15];
+		Vec3 r = { x / w, y / w, z / w };
+		return r;
+	}
+
+	Vec3 ReferenceNormal(const float* m, const Vec3& v)
+	{
+		Vec3 r = { v.x * m[0] + v.y * m[4] + v.z * m[8], v.x * m[1] + v.y * m[5] + v.z * m[9],
+			v.x * m[2] + v.y * m[6] + v.z * m[10] };
+		return r;
+	}
+
+	Vec3 ReferenceNormalize(const Vec3& v)
+	{
+		float len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		Vec3 r = { 0, 0, 0 };
+		if (len > 0)
+		{
+			r.x = v.x / len;
+			r.y = v.y / len;
+			r.z = v.z / len;
+		}
+		return r;
+	}
+
+	bool Near(const Vec3& a, const Vec3& b, float eps)
+	{
+		auto near = [eps](float x, float y) { return std::abs(x - y) <= eps * (std::max)(1.0f, std::abs(y)); };
+		return near(a.x, b.x) && near(a.y, b.y) && near(a.z, b.z);
+	}
+
+	//Points in front of the camera of PerspectiveMatrix, so w stays away from zero
+	std::vector<Vec3> RandomPoints(Random& rng, size_t count)
+	{
+		std::vector<Vec3> pts(count);
+		for (auto& p : pts)
+		{
+			p.x = rng.Uniform(-10, 10);
+			p.y = rng.Uniform(-10, 10);
+			p.z = rng.Uniform(20, 40);
+		}
+		if (count > 2)
+		{
+			pts[count / 2].x = pts[count / 2].y = pts[count / 2].z = 0;
+		}
+		return pts;
+	}
+
+	//Runs check at every level the CPU has, restoring the detected one
+	template <typename F>
+	void AtEveryLevel(F check)
+	{
+		SIMDLevel detected = DetectSIMDLevel();
+		for (int level = SL_Scalar; level <= detected; level++)
+		{
+			ForceSIMDLevel(static_cast<SIMDLevel>(level));
+			CHECK_EQ(ActiveSIMDLevel(), static_cast<SIMDLevel>(level));
+			check();
+		}
+		ForceSIMDLevel(detected);
+	}
+}
+
+
+TEST_CASE(BatchMath, PackedMatchesReference)
+{
+	float m[16];
+	PerspectiveMatrix(m);
+
+	AtEveryLevel([&m]()
+	{
+		Random rng(38);
+		for (size_t count : COUNTS)
+		{
+			std::vector<Vec3> in = RandomPoints(rng, count);
+			std::vector<Vec3> coords(count), normals(count), normalized(count);
+			const float* in_xyz = count ? &in[0].x : nullptr;
+			TransformCoords(m, in_xyz, count ? &coords[0].x : nullptr, count);
+			TransformNormals(m, in_xyz, count ? &normals[0].x : nullptr, count);
+			NormalizeVectors(in_xyz, count ? &normalized[0].x : nullptr, count);
+
+			bool coords_ok = true, normals_ok = true, normalized_ok = true;
+			for (size_t i = 0; i != count; i++)
+			{
+				coords_ok &= Near(coords[i], ReferenceCoord(m, in[i]), 1e-5f);
+				normals_ok &= Near(normals[i], ReferenceNormal(m, in[i]), 1e-5f);
+				normalized_ok &= Near(normalized[i], ReferenceNormalize(in[i]), 1e-6f);
+			}
+			CHECK(coords_ok);
+			CHECK(normals_ok);
+			CHECK(normalized_ok);
+
+			float mn[3], mx[3];
+			BoundsOfPoints(in_xyz, count, mn, mx);
+			bool bounds_ok = (count != 0) || ((mn[0] > mx[0]) && (mn[1] > mx[1]) && (mn[2] > mx[2]));
+			Vec3 lo = { 1e30f, 1e30f, 1e30f }, hi = { -1e30f, -1e30f, -1e30f };
+			for (const auto& p : in)
+			{
+				lo.x = (std::min)(lo.x, p.x); lo.y = (std::min)(lo.y, p.y); lo.z = (std::min)(lo.z, p.z);
+				hi.x = (std::max)(hi.x, p.x); hi.y = (std::max)(hi.y, p.y); hi.z = (std::max)(hi.z, p.z);
+			}
+			if (count != 0)
+			{
+				bounds_ok = (mn[0] == lo.x) && (mn[1] == lo.y) && (mn[2] == lo.z)
+					&& (mx[0] == hi.x) && (mx[1] == hi.y) && (mx[2] == hi.z);
+			}
+			CHECK(bounds_ok);
+		}
+	});
+}
+
+TEST_CASE(BatchMath, StreamsMatchPackedInPlace)
+{
+	float m[16];
+	PerspectiveMatrix(m);
+
+	AtEveryLevel([&m]()
+	{
+		Random rng(380);
+		for (size_t count : COUNTS)
+		{
+			std::vector<Vec3> in = RandomPoints(rng, count);
+			std::vector<float> x(count), y(count), z(count);
+			for (size_t i = 0; i != count; i++)
+			{
+				x[i] = in[i].x;
+				y[i] = in[i].y;
+				z[i] = in[i].z;
+			}
+
+			//Both layouts written over their input
+			std::vector<Vec3> packed = in;
+			float* packed_xyz = count ? &packed[0].x : nullptr;
+			TransformCoords(m, packed_xyz, packed_xyz, count);
+			NormalizeVectors(packed_xyz, packed_xyz, count);
+
+			Float3Streams streams = { x.data(), y.data(), z.data() };
+			TransformCoords(m, streams, streams, count);
+			NormalizeVectors(streams, streams, count);
+
+			bool same = true;
+			for (size_t i = 0; i != count; i++)
+			{
+				Vec3 s = { x[i], y[i], z[i] };
+				same &= Near(s, packed[i], 1e-6f);
+				same &= Near(s, ReferenceNormalize(ReferenceCoord(m, in[i])), 1e-5f);
+			}
+			CHECK(same);
+		}
+	});
+}
+
+TEST_CASE(BatchMath, ZeroVectorsStayZero)
+{
+	AtEveryLevel([]()
+	{
+		std::vector<Vec3> in(13);
+		for (size_t i = 0; i != in.size(); i++)
+		{
+			float v = (i % 3 == 0) ? 0.0f : static_cast<float>(i);
+			in[i].x = v;
+			in[i].y = -v;
+			in[i].z = 0.5f * v;
+		}
+		std::vector<Vec3> out(in.size());
+		NormalizeVectors(&in[0].x, &out[0].x, in.size());
+
+		bool ok = true;
+		for (size_t i = 0; i != in.size(); i++)
+		{
+			if (i % 3 == 0)
+			{
+				ok &= (out[i].x == 0) && (out[i].y == 0) && (out[i].z == 0);
+			}
+			else
+			{
+				ok &= std::abs(out[i].x * out[i].x + out[i].y * out[i].y + out[i].z * out[i].z - 1) < 1e-6f;
+			}
+		}
+		CHECK(ok);
+	});
+}
@@ -0,0 +1,257 @@
+#include "TestHarness.h"
+#include "CascadedShadow.h"
+#include <cmath>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const uint32_t RESOLUTION = 1024;
+	const float RADIUS = 10;
+
+	const float LIGHT_DIR[3] = { 0.3f, -1, 0.2f };
+
+	const float SCENE_CENTER[3] = { 0, 5, 0 };
+	const float SCENE_EXTENTS[3] = { 50, 20, 50 };
+
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	//Offset from a world-space point along the light's axes
+	void Move(const float axes[3][3], const float from[3], float dx, float dy, float dz, float to[3])
+	{
+		for (int i = 0; i != 3; i++)
+		{
+			to[i] = from[i] + axes[0][i] * dx + axes[1][i] * dy + axes[2][i] * dz;
+		}
+	}
+}
+
+
+TEST_CASE(CascadedShadow, PracticalSplits)
+{
+	//Blends near * (far / near)^(i / n) with near + (far - near) * i / n
+	float splits[5];
+	CascadeSplits(1, 16, 4, 1, splits);
+	const float log_splits[5] = { 1, 2, 4, 8, 16 };
+	for (int i = 0; i != 5; i++)
+	{
+		CHECK_NEAR(splits[i], log_splits[i], 1e-4f);
+	}
+
+	CascadeSplits(1, 16, 4, 0, splits);
+	const float uniform_splits[5] = { 1, 4.75f, 8.5f, 12.25f, 16 };
+	for (int i = 0; i != 5; i++)
+	{
+		CHECK_NEAR(splits[i], uniform_splits[i], 1e-4f);
+	}
+
+	CascadeSplits(1, 16, 4, 0.75f, splits);
+	for (int i = 0; i != 5; i++)
+	{
+		CHECK_NEAR(splits[i], 0.75f * log_splits[i] + 0.25f * uniform_splits[i], 1e-4f);
+	}
+
+	//The near and far planes exactly, whatever the blend
+	CascadeSplits(0.1f, 100, 3, 0.5f, splits);
+	CHECK_EQ(splits[0], 0.1f);
+	CHECK_EQ(splits[3], 100.0f);
+	CHECK(splits[1] < splits[2]);
+}
+
+TEST_CASE(CascadedShadow, FitMovesInWholeTexels)
+{
+	float axes[3][3];
+	ShadowLightAxes(LIGHT_DIR, axes);
+	CHECK_NEAR(Dot(axes[0], axes[1]), 0.0f, 1e-6f);
+	CHECK_NEAR(Dot(axes[0], axes[2]), 0.0f, 1e-6f);
+	CHECK_NEAR(Dot(axes[2], axes[2]), 1.0f, 1e-6f);
+
+	//A quarter texel into a texel of the grid
+	const float texel = 2 * RADIUS / RESOLUTION;
+	float center[3];
+	const float origin[3] = { 0, 0, 0 };
+	Move(axes, origin, 100.25f * texel, -40.75f * texel, 0, center);
+
+	ShadowCascade cascade;
+	FitCascade(axes, center, RADIUS, 0, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, cascade);
+	CHECK_NEAR(cascade.max[0] - cascade.min[0], 2 * RADIUS, 1e-4f);
+	CHECK_NEAR(cascade.max[1] - cascade.min[1], 2 * RADIUS, 1e-4f);
+
+	//Less than a texel in xy, or any distance along the light, changes nothing
+	const float small_moves[][3] = { { 0.5f, 0, 0 }, { 0, 0.5f, 0 }, { 0.6f, 0.6f, 0 }, { -0.2f, -0.2f, 0 }, { 0, 0, 37 } };
+	for (const auto& m : small_moves)
+	{
+		float moved[3];
+		Move(axes, center, m[0] * texel, m[1] * texel, m[2], moved);
+		ShadowCascade refitted;
+		FitCascade(axes, moved, RADIUS, 0, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, refitted);
+		for (int i = 0; i != 3; i++)
+		{
+			CHECK_EQ(refitted.min[i], cascade.min[i]);
+			CHECK_EQ(refitted.max[i], cascade.max[i]);
+		}
+	}
+
+	//Farther it moves by whole texels, the same size
+	float moved[3];
+	Move(axes, center, 3 * texel, -2 * texel, 0, moved);
+	ShadowCascade refitted;
+	FitCascade(axes, moved, RADIUS, 0, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, refitted);
+	CHECK_NEAR(refitted.min[0] - cascade.min[0], 3 * texel, 1e-4f);
+	CHECK_NEAR(refitted.min[1] - cascade.min[1], -2 * texel, 1e-4f);
+	CHECK_NEAR(refitted.max[0] - refitted.min[0], 2 * RADIUS, 1e-4f);
+
+	//Depth spans the scene, or the sphere without scene bounds
+	CHECK_NEAR(cascade.min[2], Dot(SCENE_CENTER, axes[2]) - (std::abs(axes[2][0]) * 50 + std::abs(axes[2][1]) * 20 + std::abs(axes[2][2]) * 50), 1e-3f);
+	ShadowCascade unbounded;
+	FitCascade(axes, center, RADIUS, 0, RESOLUTION, nullptr, nullptr, unbounded);
+	CHECK_NEAR(unbounded.max[2] - unbounded.min[2], 2 * RADIUS, 1e-4f);
+
+	//A guard band grows the square on every side
+	ShadowCascade guarded;
+	FitCascade(axes, center, RADIUS, 2, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, guarded);
+	CHECK_NEAR(guarded.max[0] - guarded.min[0], 2 * (RADIUS + 2), 1e-4f);
+	CHECK(guarded.min[0] < cascade.min[0]);
+	CHECK(guarded.max[0] > cascade.max[0]);
+}
+
+TEST_CASE(CascadedShadow, CullsCastersOutsideTheSlice)
+{
+	float axes[3][3];
+	ShadowLightAxes(LIGHT_DIR, axes);
+	const float center[3] = { 0, 0, 0 };
+	ShadowCascade cascade;
+	FitCascade(axes, center, RADIUS, 0, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, cascade);
+
+	const float extents[3] = { 1, 1, 1 };
+	float inside[3];
+	Move(axes, center, 3, -4, 0, inside);
+	CHECK(CascadeIntersectsBox(cascade, inside, extents));
+
+	//Straddling the edge of the square is kept, past it culled
+	float edge[3];
+	Move(axes, center, RADIUS + 0.5f, 0, 0, edge);
+	CHECK(CascadeIntersectsBox(cascade, edge, extents));
+	float beside[3];
+	Move(axes, center, RADIUS + 3, 0, 0, beside);
+	CHECK(!CascadeIntersectsBox(cascade, beside, extents));
+	Move(axes, center, 0, -RADIUS - 3, 0, beside);
+	CHECK(!CascadeIntersectsBox(cascade, beside, extents));
+
+	//Toward the light casters are kept up to the scene bounds, far outside them culled
+	float above[3];
+	Move(axes, center, 0, 0, -40, above);
+	CHECK(CascadeIntersectsBox(cascade, above, extents));
+	Move(axes, center, 0, 0, -200, above);
+	CHECK(!CascadeIntersectsBox(cascade, above, extents));
+
+	//A culling rate over a grid of casters, only the columns over the slice are kept
+	uint32_t kept = 0;
+	uint32_t total = 0;
+	for (int x = -50; x <= 50; x += 4)
+	{
+		for (int z = -50; z <= 50; z += 4)
+		{
+			float c[3] = { static_cast<float>(x), 0, static_cast<float>(z) };
+			kept += CascadeIntersectsBox(cascade, c, extents) ? 1 : 0;
+			++total;
+		}
+	}
+	CHECK(kept > 0);
+	CHECK(kept * 4 < total);
+}
+
+TEST_CASE(CascadedShadow, StaggeredCascadesCoverAMovingSlice)
+{
+	float axes[3][3];
+	ShadowLightAxes(LIGHT_DIR, axes);
+	const float guard = RADIUS * 0.1f;
+	const float origin[3] = { 0, 0, 0 };
+
+	ShadowCascade cascade;
+	FitCascade(axes, origin, RADIUS, guard, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, cascade);
+	CHECK(CascadeCovers(cascade, axes, origin, RADIUS, SCENE_CENTER, SCENE_EXTENTS));
+
+	//Within the guard band, less the texel snapping, the slice is still covered, beyond it not
+	float moved[3];
+	Move(axes, origin, guard * 0.5f, -guard * 0.5f, 0, moved);
+	CHECK(CascadeCovers(cascade, axes, moved, RADIUS, SCENE_CENTER, SCENE_EXTENTS));
+	Move(axes, origin, guard * 1.5f, 0, 0, moved);
+	CHECK(!CascadeCovers(cascade, axes, moved, RADIUS, SCENE_CENTER, SCENE_EXTENTS));
+
+	//Nor when the light turned or the scene grew past the depth range
+	float turned[3][3];
+	const float other_dir[3] = { 0.31f, -1, 0.2f };
+	ShadowLightAxes(other_dir, turned);
+	CHECK(!CascadeCovers(cascade, turned, origin, RADIUS, SCENE_CENTER, SCENE_EXTENTS));
+	const float grown[3] = { 50, 80, 50 };
+	CHECK(!CascadeCovers(cascade, axes, origin, RADIUS, SCENE_CENTER, grown));
+
+	//A camera moving a few texels a frame: with the guard band the cascade is refitted only when it's
+	//scheduled, without one every frame
+	const uint32_t num_cascades = 4;
+	const uint32_t num_frames = 30;
+	const float step = 0.05f;
+	for (float g : { guard, 0.0f })
+	{
+		ShadowCascade staggered;
+		FitCascade(axes, origin, RADIUS, g, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, staggered);
+		uint32_t refits = 0;
+		uint32_t scheduled = 0;
+		for (uint32_t frame = 1; frame <= num_frames; frame++)
+		{
+			float center[3] = { frame * step, 0, frame * step * 0.5f };
+			bool is_scheduled = CascadeScheduled(2, num_cascades, frame);
+			scheduled += is_scheduled ? 1 : 0;
+			if (is_scheduled || !CascadeCovers(staggered, axes, center, RADIUS, SCENE_CENTER, SCENE_EXTENTS))
+			{
+				FitCascade(axes, center, RADIUS, g, RESOLUTION, SCENE_CENTER, SCENE_EXTENTS, staggered);
+				++refits;
+			}
+		}
+		if (g > 0)
+		{
+			CHECK_EQ(refits, scheduled);
+		}
+		else
+		{
+			CHECK_EQ(refits, num_frames);
+		}
+	}
+}
+
+TEST_CASE(CascadedShadow, StaggeredScheduleTakesTurns)
+{
+	//The first cascade every frame, the others once in num_cascades - 1 frames, two per frame at most
+	const uint32_t num_cascades = 4;
+	uint32_t counts[4] = {};
+	for (uint64_t frame = 0; frame != 12; frame++)
+	{
+		uint32_t per_frame = 0;
+		for (uint32_t c = 0; c != num_cascades; c++)
+		{
+			if (CascadeScheduled(c, num_cascades, frame))
+			{
+				++counts[c];
+				++per_frame;
+			}
+		}
+		CHECK_EQ(per_frame, 2u);
+	}
+	CHECK_EQ(counts[0], 12u);
+	for (uint32_t c = 1; c != num_cascades; c++)
+	{
+		CHECK_EQ(counts[c], 4u);
+	}
+
+	//With two cascades or fewer there's nothing to stagger
+	for (uint64_t frame = 0; frame != 3; frame++)
+	{
+		CHECK(CascadeScheduled(1, 2, frame));
+	}
+}
@@ -0,0 +1,300 @@
+#include "TestHarness.h"
+#include "CommandStream.h"
+#include "JobSystem.h"
+#include "NullBackend.h"
+#include "RenderStatistics.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//Every call as text, payloads included, so two replays compare with ==
+	class LoggingBackend : public CommandBackend
+	{
+	public:
+		virtual void SetVertexBuffer(CommandHandle buffer, uint32_t stride) override
+		{
+			this->Log("vb", buffer, stride);
+		}
+
+		virtual void SetIndexBuffer(CommandHandle buffer) override
+		{
+			this->Log("ib", buffer);
+		}
+
+		virtual void SetTopology(PrimitiveTopology topology) override
+		{
+			this->Log("topology", topology);
+		}
+
+		virtual void SetInputLayout(CommandHandle layout) override
+		{
+			this->Log("layout", layout);
+		}
+
+		virtual void SetTexture(uint32_t slot, CommandHandle view) override
+		{
+			this->Log("texture", slot, view);
+		}
+
+		virtual void SetConstants(ConstantFrequency freq, const void* data, uint32_t size) override
+		{
+			this->Log("constants", freq, Bytes(data, size));
+		}
+
+		virtual void SetStaticConstants(ConstantFrequency freq, CommandHandle buffer, uint32_t first_constant,
+			const void* data, uint32_t size) override
+		{
+			this->Log("static", freq, buffer, first_constant, Bytes(data, size));
+		}
+
+		virtual void ApplyPass(CommandHandle pass) override
+		{
+			this->Log("pass", pass);
+		}
+
+		virtual void Draw(uint32_t num_vertices, uint32_t first_vertex) override
+		{
+			this->Log("draw", num_vertices, first_vertex);
+		}
+
+		virtual void DrawIndexed(uint32_t num_indices, uint32_t first_index, int32_t base_vertex) override
+		{
+			this->Log("indexed", num_indices, first_index, base_vertex);
+		}
+
+		std::vector<std::string> lines;
+
+	private:
+		template <typename... Args>
+		void Log(const Args&... args)
+		{
+			//Fields separated by spaces
+			std::ostringstream ss;
+			int expand[] = { (ss << args << " ", 0)... };
+			(void)expand;
+			lines.push_back(ss.str());
+		}
+
+		static std::string Bytes(const void* data, uint32_t size)
+		{
+			std::ostringstream ss;
+			ss << std::hex;
+			for (uint32_t i = 0; i != size; i++)
+			{
+				ss << static_cast<uint32_t>(static_cast<const uint8_t*>(data)[i]) << ".";
+			}
+			return ss.str();
+		}
+	};
+
+	CommandHandle Handle(uintptr_t value)
+	{
+		return reinterpret_cast<CommandHandle>(value);
+	}
+
+	//What StaticMesh records for one draw, with values derived from its index
+	void RecordMesh(CommandStream& cs, uint32_t i)
+	{
+		struct
+		{
+			float model_mat[16];
+		} object = {};
+		for (uint32_t j = 0; j != 16; j++)
+		{
+			object.model_mat[j] = static_cast<float>(i * 16 + j);
+		}
+
+		cs.SetTexture(i % 4, Handle(0x1000 + i));
+		cs.SetStaticConstants(CF_PerMaterial, Handle(0x2000), i % 7 * 16, &i, sizeof(i));
+		cs.SetVertexBuffer(Handle(0x3000 + i), 32);
+		cs.SetTopology(PT_TriangleList);
+		cs.SetIndexBuffer(Handle(0x4000 + i));
+		cs.SetInputLayout(Handle(0x5000));
+		cs.SetConstants(CF_PerObject, object);
+		cs.ApplyPass(Handle(0x6000));
+		cs.DrawIndexed(3 * (i + 1), 0, 0);
+	}
+}
+
+
+TEST_CASE(Commands, ReplaysInRecordingOrder)
+{
+	CommandStream cs;
+	CHECK(cs.Empty());
+
+	uint8_t odd[5] = { 1, 2, 3, 4, 5 };
+	cs.SetVertexBuffer(Handle(0x10), 12);
+	cs.SetTopology(PT_TriangleStrip);
+	cs.SetInputLayout(Handle(0x20));
+	cs.SetConstants(CF_PerPass, odd, sizeof(odd));
+	cs.ApplyPass(Handle(0x30));
+	cs.Draw(4, 0);
+	cs.SetIndexBuffer(Handle(0x40));
+	cs.SetTexture(2, Handle(0x50));
+	cs.SetStaticConstants(CF_PerMaterial, Handle(0x60), 32, odd, 3);
+	cs.DrawIndexed(36, 6, -2);
+	CHECK_EQ(cs.NumCommands(), static_cast<size_t>(10));
+
+	LoggingBackend expected;
+	expected.SetVertexBuffer(Handle(0x10), 12);
+	expected.SetTopology(PT_TriangleStrip);
+	expected.SetInputLayout(Handle(0x20));
+	expected.SetConstants(CF_PerPass, odd, sizeof(odd));
+	expected.ApplyPass(Handle(0x30));
+	expected.Draw(4, 0);
+	expected.SetIndexBuffer(Handle(0x40));
+	expected.SetTexture(2, Handle(0x50));
+	expected.SetStaticConstants(CF_PerMaterial, Handle(0x60), 32, odd, 3);
+	expected.DrawIndexed(36, 6, -2);
+
+	LoggingBackend replayed;
+	cs.Replay(replayed);
+	std::vector<std::string> lines = replayed.lines;
+	CHECK_EQ(lines.size(), static_cast<size_t>(10));
+	CHECK(lines == expected.lines);
+
+	//Replaying doesn't consume anything
+	LoggingBackend again;
+	cs.Replay(again);
+	CHECK(again.lines == lines);
+}
+
+TEST_CASE(Commands, ConstantsAreCopiedWhenRecorded)
+{
+	uint8_t big[512];
+	for (size_t i = 0; i != sizeof(big); i++)
+	{
+		big[i] = static_cast<uint8_t>(i * 7);
+	}
+
+	CommandStream cs;
+	cs.SetConstants(CF_PerLight, big, sizeof(big));
+	LoggingBackend expected;
+	expected.SetConstants(CF_PerLight, big, sizeof(big));
+
+	memset(big, 0, sizeof(big));
+
+	LoggingBackend replayed;
+	cs.Replay(replayed);
+	CHECK(replayed.lines == expected.lines);
+}
+
+TEST_CASE(Commands, ResetKeepsMemory)
+{
+	CommandStream cs;
+	for (uint32_t i = 0; i != 1000; i++)
+	{
+		RecordMesh(cs, i);
+	}
+	size_t size = cs.SizeBytes();
+	CHECK(size > 0);
+
+	cs.Reset();
+	CHECK(cs.Empty());
+	CHECK_EQ(cs.SizeBytes(), static_cast<size_t>(0));
+
+	LoggingBackend empty;
+	cs.Replay(empty);
+	CHECK(empty.lines.empty());
+
+	for (uint32_t i = 0; i != 1000; i++)
+	{
+		RecordMesh(cs, i);
+	}
+	CHECK_EQ(cs.SizeBytes(), size);
+	CHECK_EQ(cs.NumCommands(), static_cast<size_t>(9000));
+}
+
+TEST_CASE(Commands, ParallelChunksReplayLikeOneStream)
+{
+	const uint32_t num_draws = 3000;
+
+	CommandStream serial;
+	for (uint32_t i = 0; i != num_draws; i++)
+	{
+		RecordMesh(serial, i);
+	}
+	LoggingBackend expected;
+	serial.Replay(expected);
+	std::vector<std::string> expected_lines = expected.lines;
+
+	//Chunks recorded by whichever worker gets them, played back in chunk order as the G-buffer pass does
+	const uint32_t worker_counts[] = { 1, 2, 4, 8 };
+	for (uint32_t workers : worker_counts)
+	{
+		JobSystem js(workers);
+		const uint32_t num_chunks = workers + 1;
+		const uint32_t chunk_size = (num_draws + num_chunks - 1) / num_chunks;
+		std::vector<CommandStream> chunks(num_chunks);
+
+		for (int round = 0; round != 3; round++)
+		{
+			js.ParallelFor(num_chunks, 1, [&chunks, chunk_size, num_draws](size_t begin, size_t end)
+			{
+				for (size_t c = begin; c != end; c++)
+				{
+					chunks[c].Reset();
+					uint32_t first = static_cast<uint32_t>(c) * chunk_size;
+					uint32_t last = (std::min)(first + chunk_size, num_draws);
+					for (uint32_t i = first; i < last; i++)
+					{
+						RecordMesh(chunks[c], i);
+					}
+				}
+			});
+
+			LoggingBackend replayed;
+			for (const auto& cs : chunks)
+			{
+				cs.Replay(replayed);
+			}
+			CHECK(replayed.lines == expected_lines);
+		}
+	}
+}
+
+TEST_CASE(Commands, NullBackendCountsLikeCommandList)
+{
+	CommandStream cs;
+	for (uint32_t i = 0; i != 4; i++)
+	{
+		RecordMesh(cs, i);
+	}
+
+	//The same object constants again upload nothing, a strip of 4 vertices is 2 triangles
+	float model_mat[16] = {};
+	cs.SetConstants(CF_PerObject, model_mat);
+	cs.SetConstants(CF_PerObject, model_mat);
+	cs.SetTopology(PT_TriangleStrip);
+	cs.Draw(4, 0);
+
+	RenderStatistics stats;
+	stats.EndFrame();
+	NullBackend backend;
+	cs.Replay(backend);
+	stats.EndFrame();
+
+	CHECK_EQ(stats.Counter(SC_Draws), static_cast<uint64_t>(5));
+	CHECK_EQ(stats.Counter(SC_Triangles), static_cast<uint64_t>(1 + 2 + 3 + 4 + 2));
+	CHECK_EQ(stats.Counter(SC_StateChanges), static_cast<uint64_t>(4 * 5 + 1));
+	CHECK_EQ(stats.Counter(SC_TextureBinds), static_cast<uint64_t>(4));
+	CHECK_EQ(stats.Counter(SC_MaterialConstantBytes), static_cast<uint64_t>(4 * sizeof(uint32_t)));
+	CHECK_EQ(stats.Counter(SC_ObjectConstantBytes), static_cast<uint64_t>(5 * sizeof(model_mat)));
+
+	//The backend still holds the last constants until Reset, as a new frame would
+	CommandStream again;
+	again.SetConstants(CF_PerObject, model_mat);
+	again.Replay(backend);
+	stats.EndFrame();
+	CHECK_EQ(stats.Counter(SC_ObjectConstantBytes), static_cast<uint64_t>(0));
+	backend.Reset();
+	again.Replay(backend);
+	stats.EndFrame();
+	CHECK_EQ(stats.Counter(SC_ObjectConstantBytes), static_cast<uint64_t>(sizeof(model_mat)));
+}
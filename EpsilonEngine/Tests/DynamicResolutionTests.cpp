@@ -0,0 +1,215 @@
+#include "TestHarness.h"
+#include "DynamicResolution.h"
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const double TARGET_MS = 16;
+
+	//GPU timings reach the controller this many frames after the frame that used the scale
+	const size_t TIMING_LATENCY = 3;
+
+	//Frame time for a frame rendered at scale, the part that scales with pixels plus a fixed part
+	typedef std::function<double(int frame, float scale)> GPUModel;
+
+	GPUModel PixelBound(double full_res_ms, double fixed_ms = 1)
+	{
+		return [full_res_ms, fixed_ms](int, float scale)
+		{
+			return fixed_ms + full_res_ms * scale * scale;
+		};
+	}
+
+	//Runs the controller against a model, the returned trace holds the scale of every frame
+	std::vector<float> Simulate(DynamicResolution& drs, const GPUModel& gpu, int num_frames,
+		std::vector<double>* frame_ms = nullptr)
+	{
+		std::deque<float> in_flight(TIMING_LATENCY, drs.Scale());
+		std::vector<float> scales;
+		for (int f = 0; f != num_frames; f++)
+		{
+			double ms = gpu(f, in_flight.front());
+			in_flight.pop_front();
+			if (frame_ms)
+			{
+				frame_ms->push_back(ms);
+			}
+
+			float scale = drs.Update(ms);
+			scales.push_back(scale);
+			in_flight.push_back(scale);
+		}
+		return scales;
+	}
+
+	uint32_t NumChanges(const std::vector<float>& scales, size_t first)
+	{
+		uint32_t changes = 0;
+		for (size_t i = first + 1; i < scales.size(); i++)
+		{
+			changes += (scales[i] != scales[i - 1]);
+		}
+		return changes;
+	}
+
+	//Deterministic noise in [-amplitude, amplitude]
+	double Noise(int frame, double amplitude)
+	{
+		return amplitude * (((frame * 7919) % 13) - 6) / 6.0;
+	}
+}
+
+
+TEST_CASE(DynamicResolution, UnderBudgetStaysAtFullResolution)
+{
+	DynamicResolution drs;
+	drs.TargetFrameTime(TARGET_MS);
+	std::vector<float> scales = Simulate(drs, PixelBound(8), 300);
+	for (float s : scales)
+	{
+		CHECK_EQ(s, 1.0f);
+	}
+}
+
+TEST_CASE(DynamicResolution, OverBudgetSettlesOnTarget)
+{
+	for (double full_res_ms : { 20.0, 30.0, 50.0 })
+	{
+		DynamicResolution drs;
+		drs.TargetFrameTime(TARGET_MS);
+		std::vector<double> frame_ms;
+		GPUModel gpu = PixelBound(full_res_ms);
+		std::vector<float> scales = Simulate(drs, [&gpu](int f, float s) { return gpu(f, s) + Noise(f, 0.3); },
+			600, &frame_ms);
+
+		//Settled within a few seconds, at a scale that fits the budget, and staying there
+		for (size_t f = 300; f != frame_ms.size(); f++)
+		{
+			CHECK(frame_ms[f] < TARGET_MS * 1.1);
+			CHECK(frame_ms[f] > TARGET_MS * 0.8);
+		}
+		CHECK(NumChanges(scales, 300) <= 2);
+		CHECK(scales.back() < 1.0f);
+	}
+}
+
+TEST_CASE(DynamicResolution, LoadSpikeDropsAndRecovers)
+{
+	DynamicResolution drs;
+	drs.TargetFrameTime(TARGET_MS);
+
+	//A heavy stretch, like an explosion filling the screen, between light ones
+	std::vector<double> frame_ms;
+	std::vector<float> scales = Simulate(drs, [](int f, float s)
+	{
+		double full_res_ms = (f >= 100) && (f < 250) ? 40 : 10;
+		return 1 + full_res_ms * s * s;
+	}, 500, &frame_ms);
+
+	CHECK_EQ(scales[99], 1.0f);
+
+	//Under budget again within a second of the spike starting
+	for (size_t f = 160; f != 250; f++)
+	{
+		CHECK(frame_ms[f] < TARGET_MS * 1.1);
+	}
+
+	//Back to full resolution within a second of it ending
+	CHECK_EQ(scales[310], 1.0f);
+	CHECK_EQ(scales.back(), 1.0f);
+}
+
+TEST_CASE(DynamicResolution, LongOverloadDoesNotWindUp)
+{
+	DynamicResolution drs;
+	drs.TargetFrameTime(TARGET_MS);
+	drs.ScaleRange(0.5f, 1.0f);
+
+	//Even the minimum scale can't meet the target for a long time
+	std::vector<float> scales = Simulate(drs, [](int f, float s)
+	{
+		return f < 1000 ? 20 + 40 * s * s : 1 + 8 * s * s;
+	}, 1100);
+
+	CHECK_EQ(scales[999], 0.5f);
+
+	//With no wound up integral to unwind, full resolution comes back quickly
+	CHECK_EQ(scales[1000 + 30], 1.0f);
+}
+
+TEST_CASE(DynamicResolution, NoiseWithinDeadbandIsIgnored)
+{
+	DynamicResolution drs;
+	drs.TargetFrameTime(TARGET_MS);
+
+	//Hovering right at the target with a few percent of noise
+	std::vector<float> scales = Simulate(drs, [](int f, float s)
+	{
+		return (TARGET_MS - 0.5) * s * s + Noise(f, TARGET_MS * 0.03);
+	}, 600);
+	CHECK_EQ(NumChanges(scales, 0), 0u);
+	CHECK_EQ(scales.back(), 1.0f);
+}
+
+TEST_CASE(DynamicResolution, TracesReplayExactly)
+{
+	GPUModel gpu = [](int f, float s) { return 1 + (f % 200 < 100 ? 35 : 12) * s * s + Noise(f, 1); };
+
+	DynamicResolution a;
+	a.TargetFrameTime(TARGET_MS);
+	std::vector<double> trace;
+	std::vector<float> scales = Simulate(a, gpu, 400, &trace);
+
+	//Fed the recorded frame times, a fresh controller and a reset one give the same scales
+	DynamicResolution b;
+	b.TargetFrameTime(TARGET_MS);
+	a.Reset();
+	CHECK_EQ(a.Scale(), 1.0f);
+	bool same = true;
+	for (size_t f = 0; f != trace.size(); f++)
+	{
+		float sa = a.Update(trace[f]);
+		float sb = b.Update(trace[f]);
+		same &= (sa == scales[f]) && (sb == scales[f]);
+	}
+	CHECK(same);
+
+	//Scales are always on the snapping grid and within range
+	for (float s : scales)
+	{
+		CHECK(s >= 0.5f);
+		CHECK(s <= 1.0f);
+		CHECK_NEAR(s * 64, std::floor(s * 64 + 0.5f), 1e-4);
+	}
+}
+
+TEST_CASE(DynamicResolution, ScaleRangeClamps)
+{
+	DynamicResolution drs;
+	drs.TargetFrameTime(0);
+	CHECK_NEAR(drs.TargetFrameTime(), 0.1, 1e-9);
+
+	drs.TargetFrameTime(TARGET_MS);
+	drs.ScaleRange(0.75f, 0.9f);
+	CHECK_EQ(drs.Scale(), 0.9f);
+	drs.Reset();
+	CHECK_EQ(drs.Scale(), 0.9f);
+
+	for (int i = 0; i != 100; i++)
+	{
+		drs.Update(100);
+	}
+	CHECK_EQ(drs.Scale(), 0.75f);
+
+	//A maximum below the minimum collapses the range
+	drs.ScaleRange(0.6f, 0.4f);
+	CHECK_EQ(drs.Update(100), 0.6f);
+	CHECK_EQ(drs.Update(1), 0.6f);
+}
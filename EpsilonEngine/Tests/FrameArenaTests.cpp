@@ -0,0 +1,198 @@
+#include "TestHarness.h"
+#include "AllocationCounter.h"
+#include "FrameArena.h"
+#include <thread>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const uint32_t WARMUP_FRAMES = 8;
+	const uint32_t MEASURED_FRAMES = 200;
+
+	//Varies from frame to frame but repeats, the way a scene seen along a camera path does
+	size_t FrameItems(uint32_t frame, uint32_t job)
+	{
+		return 100 + ((frame * 7 + job * 13) % 4) * 250;
+	}
+
+	struct VisibleItem
+	{
+		uint32_t index;
+		float depth;
+	};
+
+	//Culls into arena arrays and sorts, like the scene update does
+	float ArenaFrame(LinearArena& arena, uint32_t frame, uint32_t job)
+	{
+		size_t num_items = FrameItems(frame, job);
+
+		FrameArray<VisibleItem> visible;
+		visible.Allocate(arena, num_items);
+		for (size_t i = 0; i != num_items; i++)
+		{
+			if (i % 3 != 0)
+			{
+				VisibleItem item = { static_cast<uint32_t>(i), static_cast<float>((i * 2654435761u) % 1000) };
+				visible.push_back(item);
+			}
+		}
+
+		float* depths = arena.Allocate<float>(visible.size());
+		for (size_t i = 0; i != visible.size(); i++)
+		{
+			depths[i] = visible[i].depth;
+		}
+
+		float sum = 0;
+		for (size_t i = 0; i != visible.size(); i++)
+		{
+			sum += depths[i];
+		}
+		return sum;
+	}
+}
+
+
+TEST_CASE(FrameArena, AllocationsAreCounted)
+{
+	//Otherwise every zero-allocation check below passes trivially
+	uint64_t before = HeapAllocationCount();
+	std::unique_ptr<int> p(new int(1));
+	CHECK_EQ(HeapAllocationCount(), before + 1);
+}
+
+TEST_CASE(FrameArena, SteadyStateFramesDontAllocate)
+{
+	//Small blocks so the first frames spill and have to be merged
+	LinearArena arena(1024);
+	float sink = 0;
+	for (uint32_t f = 0; f != WARMUP_FRAMES; f++)
+	{
+		sink += ArenaFrame(arena, f, 0);
+		arena.Reset();
+	}
+	size_t capacity = arena.Capacity();
+
+	uint64_t before = HeapAllocationCount();
+	for (uint32_t f = WARMUP_FRAMES; f != WARMUP_FRAMES + MEASURED_FRAMES; f++)
+	{
+		sink += ArenaFrame(arena, f, 0);
+		arena.Reset();
+	}
+	CHECK_EQ(HeapAllocationCount(), before);
+	CHECK_EQ(arena.Capacity(), capacity);
+	CHECK(sink > 0);
+}
+
+TEST_CASE(FrameArena, SpilledBlocksMergeOnReset)
+{
+	LinearArena arena(256);
+	for (int i = 0; i != 10; i++)
+	{
+		arena.Allocate(200);
+	}
+	CHECK_EQ(arena.BytesUsed(), static_cast<size_t>(2000));
+	size_t capacity = arena.Capacity();
+	CHECK(capacity >= 2000);
+
+	//The next identical frame fits in one block of the merged size
+	arena.Reset();
+	CHECK_EQ(arena.BytesUsed(), static_cast<size_t>(0));
+	uint64_t before = HeapAllocationCount();
+	for (int i = 0; i != 10; i++)
+	{
+		arena.Allocate(200);
+	}
+	CHECK_EQ(HeapAllocationCount(), before + 1);
+	CHECK_EQ(arena.Capacity(), capacity);
+
+	arena.Reset();
+	before = HeapAllocationCount();
+	for (int i = 0; i != 10; i++)
+	{
+		arena.Allocate(200);
+	}
+	CHECK_EQ(HeapAllocationCount(), before);
+}
+
+TEST_CASE(FrameArena, AllocationsAreAligned)
+{
+	LinearArena arena(4096);
+	arena.Allocate(3, 1);
+	void* p = arena.Allocate(8, 64);
+	CHECK_EQ(reinterpret_cast<uintptr_t>(p) % 64, static_cast<uintptr_t>(0));
+
+	//Larger than a block, still aligned and usable
+	uint8_t* big = static_cast<uint8_t*>(arena.Allocate(10000, 256));
+	CHECK_EQ(reinterpret_cast<uintptr_t>(big) % 256, static_cast<uintptr_t>(0));
+	big[9999] = 1;
+}
+
+TEST_CASE(FrameArena, FrameArrayBasics)
+{
+	LinearArena arena;
+	FrameArray<int> a;
+	CHECK(a.empty());
+	a.Allocate(arena, 8);
+	for (int i = 0; i != 8; i++)
+	{
+		a.push_back(i * i);
+	}
+	CHECK_EQ(a.size(), static_cast<size_t>(8));
+	CHECK_EQ(a[3], 9);
+
+	a.resize(4);
+	int sum = 0;
+	for (int v : a)
+	{
+		sum += v;
+	}
+	CHECK_EQ(sum, 0 + 1 + 4 + 9);
+
+	a.clear();
+	CHECK(a.empty());
+
+	FrameArray<int> none;
+	none.Allocate(arena, 0);
+	CHECK(none.begin() == none.end());
+}
+
+TEST_CASE(FrameArena, ThreadLocalArenasResetTogether)
+{
+	LinearArena& mine = LinearArena::ThreadLocal();
+	CHECK(&LinearArena::ThreadLocal() == &mine);
+
+	//Another thread's arena is its own, and stays alive for the reset after the thread is gone
+	LinearArena* theirs = nullptr;
+	std::thread t([&theirs]()
+	{
+		theirs = &LinearArena::ThreadLocal();
+		ArenaFrame(*theirs, 0, 0);
+	});
+	t.join();
+	REQUIRE(theirs != nullptr);
+	CHECK(theirs != &mine);
+	CHECK(theirs->BytesUsed() > 0);
+
+	ArenaFrame(mine, 0, 0);
+	LinearArena::ResetThreadLocals();
+	CHECK_EQ(mine.BytesUsed(), static_cast<size_t>(0));
+	CHECK_EQ(theirs->BytesUsed(), static_cast<size_t>(0));
+
+	//Once it has seen its largest frame, a thread's arena is as allocation free as any other
+	for (uint32_t f = 0; f != WARMUP_FRAMES; f++)
+	{
+		ArenaFrame(mine, f, 0);
+		LinearArena::ResetThreadLocals();
+	}
+	uint64_t before = HeapAllocationCount();
+	for (uint32_t f = WARMUP_FRAMES; f != WARMUP_FRAMES + MEASURED_FRAMES; f++)
+	{
+		ArenaFrame(mine, f, 0);
+		LinearArena::ResetThreadLocals();
+	}
+	CHECK_EQ(HeapAllocationCount(), before);
+}
@@ -0,0 +1,221 @@
+#include "TestHarness.h"
+#include "FramePacer.h"
+#include <chrono>
+#include <cmath>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	typedef FramePacer::Clock Clock;
+
+	Clock::duration Ms(double ms)
+	{
+		return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+	}
+
+	//Simulated time, so pacing is judged exactly whatever else the machine is running. Every read of the
+	//clock costs a little, which is what moves it along while the pacer spins, and every sleep overshoots
+	struct FakeClock
+	{
+		Clock::time_point now;
+		Clock::duration per_read;
+		Clock::duration oversleep;
+		uint32_t num_sleeps;
+
+		FakeClock(double per_read_ms, double oversleep_ms)
+			: now(std::chrono::hours(1)), per_read(Ms(per_read_ms)), oversleep(Ms(oversleep_ms)), num_sleeps(0)
+		{
+		}
+
+		FramePacer Pacer()
+		{
+			return FramePacer([this]()
+			{
+				now += per_read;
+				return now;
+			},
+			[this](Clock::duration d)
+			{
+				now += d + oversleep;
+				++num_sleeps;
+			});
+		}
+
+		//A frame's work
+		void Advance(double ms)
+		{
+			now += Ms(ms);
+		}
+	};
+}
+
+
+TEST_CASE(FramePacer, HoldsTargetIntervalWithLowJitter)
+{
+	const double interval_ms = 5;
+	const int num_frames = 100;
+
+	FakeClock clock(0.01, 0.3);
+	FramePacer pacer = clock.Pacer();
+	pacer.TargetInterval(interval_ms / 1000);
+	CHECK_NEAR(pacer.TargetInterval(), interval_ms / 1000, 1e-9);
+
+	//Frames taking a varying part of the interval
+	Random rng(30);
+	for (int i = 0; i != 20; i++)
+	{
+		clock.Advance(rng.Uniform(0, 2));
+		pacer.Pace();
+	}
+	pacer.ResetStats();
+	clock.num_sleeps = 0;
+	for (int i = 0; i != num_frames; i++)
+	{
+		clock.Advance(rng.Uniform(0, 2));
+		pacer.Pace();
+	}
+
+	//Most of the wait is slept, the spin after it lands each frame within a few clock reads of its deadline.
+	//Oversleeping past a shrinking margin makes a frame at most that much late, the next one catches up
+	FrameTimeStats stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, static_cast<uint32_t>(num_frames - 1));
+	CHECK_EQ(clock.num_sleeps, static_cast<uint32_t>(num_frames));
+	CHECK_NEAR(stats.avg_ms, interval_ms, 0.01);
+	CHECK(stats.max_ms - stats.min_ms < 0.2);
+	CHECK(stats.std_dev_ms < 0.05);
+}
+
+TEST_CASE(FramePacer, SpinMarginFollowsOversleep)
+{
+	const double interval_ms = 10;
+
+	FakeClock clock(0.01, 0);
+	FramePacer pacer = clock.Pacer();
+	pacer.TargetInterval(interval_ms / 1000);
+
+	//Sleeps that wake on time shrink the margin to its floor
+	for (int i = 0; i != 300; i++)
+	{
+		pacer.Pace();
+	}
+	CHECK_NEAR(pacer.SpinMargin(), 0.00025, 1e-7);
+
+	//One waking 3 ms late leaves its frame late and grows the margin past the oversleep
+	pacer.ResetStats();
+	pacer.Pace();
+	clock.oversleep = Ms(3);
+	pacer.Pace();
+	FrameTimeStats stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 1u);
+	CHECK_NEAR(stats.max_ms, interval_ms + 3 - 0.25, 0.03);
+	CHECK_NEAR(pacer.SpinMargin(), 0.00375, 2e-5);
+
+	//After the frame catching up, the same oversleep no longer makes frames late
+	pacer.Pace();
+	pacer.ResetStats();
+	for (int i = 0; i != 11; i++)
+	{
+		pacer.Pace();
+	}
+	stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 10u);
+	CHECK_NEAR(stats.min_ms, interval_ms, 0.03);
+	CHECK_NEAR(stats.max_ms, interval_ms, 0.03);
+}
+
+TEST_CASE(FramePacer, LateFrameResynchronizes)
+{
+	const double interval_ms = 4;
+
+	FakeClock clock(0.01, 0);
+	FramePacer pacer = clock.Pacer();
+	pacer.TargetInterval(interval_ms / 1000);
+	for (int i = 0; i != 5; i++)
+	{
+		pacer.Pace();
+	}
+
+	//A frame several intervals late isn't followed by a burst of short ones catching up
+	clock.Advance(interval_ms * 4);
+	pacer.Pace();
+	pacer.ResetStats();
+	pacer.Pace();
+	for (int i = 0; i != 5; i++)
+	{
+		pacer.Pace();
+	}
+
+	FrameTimeStats stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 5u);
+	CHECK_NEAR(stats.min_ms, interval_ms, 0.03);
+	CHECK_NEAR(stats.max_ms, interval_ms, 0.03);
+}
+
+TEST_CASE(FramePacer, UncappedOnlyTimes)
+{
+	FakeClock clock(0, 0);
+	FramePacer pacer = clock.Pacer();
+	pacer.TargetInterval(-1);
+	CHECK_EQ(pacer.TargetInterval(), 0.0);
+
+	for (int i = 0; i != 1000; i++)
+	{
+		clock.Advance(1);
+		pacer.Pace();
+	}
+	CHECK_EQ(clock.num_sleeps, 0u);
+
+	FrameTimeStats stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 256u);
+	CHECK_NEAR(stats.avg_ms, 1.0, 1e-9);
+}
+
+TEST_CASE(FramePacer, StatsOfKnownIntervals)
+{
+	FakeClock clock(0, 0);
+	FramePacer pacer = clock.Pacer();
+	FrameTimeStats stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 0u);
+	CHECK_EQ(stats.avg_ms, 0.0);
+
+	pacer.Tick();
+	clock.Advance(10);
+	pacer.Tick();
+	stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 1u);
+	CHECK_NEAR(stats.avg_ms, 10.0, 1e-9);
+	CHECK_EQ(stats.min_ms, stats.max_ms);
+	CHECK_EQ(stats.std_dev_ms, 0.0);
+
+	clock.Advance(20);
+	pacer.Tick();
+	stats = pacer.Stats();
+	CHECK_EQ(stats.num_frames, 2u);
+	CHECK_NEAR(stats.avg_ms, 15.0, 1e-9);
+	CHECK_NEAR(stats.min_ms, 10.0, 1e-9);
+	CHECK_NEAR(stats.max_ms, 20.0, 1e-9);
+	CHECK_NEAR(stats.std_dev_ms, 5.0, 1e-9);
+
+	pacer.ResetStats();
+	CHECK_EQ(pacer.Stats().num_frames, 0u);
+}
+
+TEST_CASE(FramePacer, RealClockNeverPacesEarly)
+{
+	//Only a lower bound holds on a loaded machine: no frame ends before its deadline
+	const double interval_ms = 2;
+
+	FramePacer pacer;
+	pacer.TargetInterval(interval_ms / 1000);
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i != 10; i++)
+	{
+		pacer.Pace();
+	}
+	double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	CHECK(elapsed_ms >= interval_ms * 9);
+	CHECK_EQ(pacer.Stats().num_frames, 9u);
+}
@@ -0,0 +1,306 @@
+#include "TestHarness.h"
+#include "FramePipeline.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	struct TestPacket
+	{
+		uint64_t frame;
+		uint32_t num_updates;
+	};
+
+	//Finishes submitted frames one after another, each after latency, like a GPU running behind
+	class SimulatedGPU
+	{
+	public:
+		explicit SimulatedGPU(std::chrono::microseconds latency)
+			: latency_(latency), completed_(0), quit_(false), thread_(&SimulatedGPU::Main, this)
+		{
+		}
+
+		~SimulatedGPU()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				quit_ = true;
+			}
+			cv_.notify_one();
+			thread_.join();
+		}
+
+		void Submit(uint64_t frame)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				queue_.push_back(frame);
+			}
+			cv_.notify_one();
+		}
+
+		//Frames are submitted in order, so everything up to here has completed too
+		bool Completed(uint64_t frame) const
+		{
+			return completed_.load() > frame;
+		}
+
+		uint64_t NumCompleted() const
+		{
+			return completed_.load();
+		}
+
+	private:
+		void Main()
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			for (;;)
+			{
+				cv_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+				if (queue_.empty())
+				{
+					return;
+				}
+
+				uint64_t frame = queue_.front();
+				queue_.pop_front();
+
+				lock.unlock();
+				std::this_thread::sleep_for(latency_);
+				completed_.store(frame + 1);
+				lock.lock();
+			}
+		}
+
+	private:
+		std::chrono::microseconds latency_;
+		std::atomic<uint64_t> completed_;
+
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::deque<uint64_t> queue_;
+		bool quit_;
+
+		std::thread thread_;
+	};
+
+	//Polls until pred holds, false after a few seconds
+	template <typename Pred>
+	bool Eventually(Pred pred)
+	{
+		auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!pred())
+		{
+			if (std::chrono::steady_clock::now() > give_up)
+			{
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+
+
+TEST_CASE(FramePipeline, SubmitsEveryFrameInOrder)
+{
+	for (bool pipelined : { true, false })
+	{
+		JobSystem js(2);
+		FramePipeline<TestPacket> pipeline;
+		pipeline.Pipelined(pipelined);
+
+		uint64_t next_update = 0;
+		bool in_order = true;
+		for (uint64_t f = 0; f != 50; f++)
+		{
+			pipeline.Frame(js,
+				[&next_update](TestPacket& p) { p.frame = next_update++; },
+				[&in_order, f](TestPacket& p) { in_order &= (p.frame == f); });
+		}
+		CHECK(in_order);
+		CHECK_EQ(pipeline.FrameIndex(), static_cast<uint64_t>(50));
+
+		//Pipelined, the update of the frame after the last has already run
+		CHECK_EQ(next_update, static_cast<uint64_t>(pipelined ? 51 : 50));
+	}
+}
+
+TEST_CASE(FramePipeline, NextUpdateOverlapsSubmit)
+{
+	JobSystem js(1);
+	FramePipeline<TestPacket> pipeline;
+
+	//Each submit only returns once the update of the following frame has started on the worker
+	std::atomic<uint64_t> updates_started(0);
+	bool overlapped = true;
+	for (uint64_t f = 0; f != 10; f++)
+	{
+		pipeline.Frame(js,
+			[&updates_started](TestPacket& p)
+			{
+				p.frame = updates_started.fetch_add(1);
+			},
+			[&updates_started, &overlapped](TestPacket& p)
+			{
+				overlapped &= Eventually([&]() { return updates_started.load() > p.frame + 1; });
+			});
+	}
+	CHECK(overlapped);
+}
+
+TEST_CASE(FramePipeline, InvalidateUpdatesFromCurrentState)
+{
+	JobSystem js(2);
+	FramePipeline<TestPacket> pipeline;
+
+	int state = 0;
+	int submitted = -1;
+	auto update = [&state](TestPacket& p) { p.frame = state; };
+	auto submit = [&submitted](TestPacket& p) { submitted = static_cast<int>(p.frame); };
+
+	pipeline.Frame(js, update, submit);
+	CHECK_EQ(submitted, 0);
+
+	//The packet prepared during the last frame still has the old state
+	state = 1;
+	pipeline.Frame(js, update, submit);
+	CHECK_EQ(submitted, 0);
+
+	state = 2;
+	pipeline.Invalidate();
+	pipeline.Frame(js, update, submit);
+	CHECK_EQ(submitted, 2);
+}
+
+TEST_CASE(FramePipeline, ExceptionsReachTheCaller)
+{
+	JobSystem js(2);
+	FramePipeline<TestPacket> pipeline;
+
+	uint32_t updates = 0;
+	bool fail_update = false;
+	bool fail_submit = false;
+	auto update = [&](TestPacket& p)
+	{
+		++updates;
+		p.num_updates = updates;
+		if (fail_update)
+		{
+			throw std::runtime_error("update");
+		}
+	};
+	auto submit = [&](TestPacket&)
+	{
+		if (fail_submit)
+		{
+			throw std::runtime_error("submit");
+		}
+	};
+
+	pipeline.Frame(js, update, submit);
+
+	//A failed update of the next frame is rethrown after this frame's submit, and redone next frame
+	fail_update = true;
+	bool threw = false;
+	try
+	{
+		pipeline.Frame(js, update, submit);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	fail_update = false;
+	uint32_t before = updates;
+	pipeline.Frame(js, update, submit);
+	CHECK_EQ(updates, before + 2);
+
+	//A failed submit still waits for the update running beside it
+	fail_submit = true;
+	threw = false;
+	try
+	{
+		pipeline.Frame(js, update, submit);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE(FramePipeline, FramesInFlightBoundsGPULatency)
+{
+	//The CPU is much faster than the simulated GPU, so it runs ahead until the limit holds it back
+	for (uint32_t max_frames : { 1u, 2u, 3u })
+	{
+		JobSystem js(1);
+		FramePipeline<TestPacket> pipeline;
+		FramesInFlight in_flight(max_frames);
+		SimulatedGPU gpu(std::chrono::microseconds(2000));
+
+		std::vector<uint64_t> slot_frames(max_frames, 0);
+		uint64_t max_ahead = 0;
+		bool released_in_order = true;
+		uint64_t next_release = 0;
+
+		for (uint64_t f = 0; f != 20; f++)
+		{
+			pipeline.Frame(js,
+				[](TestPacket&) {},
+				[&](TestPacket&)
+				{
+					uint64_t frame = pipeline.FrameIndex();
+					uint64_t released = in_flight.WaitForSlot(frame, [&](size_t slot) { return gpu.Completed(slot_frames[slot]); });
+					if (released != NO_FRAME_IN_FLIGHT)
+					{
+						released_in_order &= (released == next_release);
+						++next_release;
+					}
+
+					max_ahead = (std::max)(max_ahead, frame - gpu.NumCompleted());
+
+					slot_frames[in_flight.Slot(frame)] = frame;
+					gpu.Submit(frame);
+					in_flight.Issue(frame);
+				});
+
+			CHECK(in_flight.NumInFlight() <= max_frames);
+		}
+
+		//Submitting frame f, at most max_frames - 1 frames before it are still running
+		CHECK(max_ahead < max_frames);
+		CHECK(released_in_order);
+		CHECK_EQ(next_release, static_cast<uint64_t>(20 - max_frames));
+	}
+}
+
+TEST_CASE(FramePipeline, FramesInFlightReset)
+{
+	FramesInFlight in_flight(2);
+	CHECK_EQ(in_flight.MaxFrames(), 2u);
+
+	in_flight.Issue(0);
+	in_flight.Issue(1);
+	CHECK_EQ(in_flight.NumInFlight(), 2u);
+
+	//Free slots don't poll
+	bool polled = false;
+	in_flight.Reset(0);
+	CHECK_EQ(in_flight.MaxFrames(), 1u);
+	CHECK_EQ(in_flight.NumInFlight(), 0u);
+	CHECK_EQ(in_flight.WaitForSlot(5, [&](size_t) { polled = true; return true; }), NO_FRAME_IN_FLIGHT);
+	CHECK(!polled);
+}
@@ -0,0 +1,79 @@
+#include "TestHarness.h"
+#include "FrameStats.h"
+#include <sstream>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	std::vector<PassTiming> Passes(double gbuffer_ms)
+	{
+		PassTiming gbuffer = { "GBuffer", gbuffer_ms, 2 * gbuffer_ms };
+		PassTiming present = { "Present", 0.5, 0 };
+		return { gbuffer, present };
+	}
+}
+
+
+TEST_CASE(FrameStats, NearestRankPercentiles)
+{
+	FrameStats frame_stats;
+	CHECK_EQ(frame_stats.FrameMsPercentile(0.5), 0.0);
+
+	RenderStatistics stats;
+	stats.EndFrame();
+
+	//1 to 100 ms in shuffled order
+	for (uint32_t i = 0; i != 100; i++)
+	{
+		frame_stats.Sample(static_cast<double>((i * 37) % 100 + 1), Passes(1), stats);
+	}
+	CHECK_EQ(frame_stats.NumFrames(), static_cast<size_t>(100));
+	CHECK_EQ(frame_stats.FrameMsPercentile(0), 1.0);
+	CHECK_EQ(frame_stats.FrameMsPercentile(0.5), 50.0);
+	CHECK_EQ(frame_stats.FrameMsPercentile(0.95), 95.0);
+	CHECK_EQ(frame_stats.FrameMsPercentile(0.99), 99.0);
+	CHECK_EQ(frame_stats.FrameMsPercentile(1), 100.0);
+
+	//With few frames p99 is the slowest
+	frame_stats.Clear();
+	frame_stats.Sample(3, Passes(1), stats);
+	frame_stats.Sample(1, Passes(1), stats);
+	CHECK_EQ(frame_stats.FrameMsPercentile(0.99), 3.0);
+	CHECK_EQ(frame_stats.FrameMsPercentile(0.5), 1.0);
+}
+
+TEST_CASE(FrameStats, AveragesPassesAndCounters)
+{
+	FrameStats frame_stats;
+	RenderStatistics stats;
+	stats.EndFrame();
+
+	RenderStatistics::Add(SC_Draws, 10);
+	stats.EndFrame();
+	frame_stats.Sample(2, Passes(1), stats);
+
+	RenderStatistics::Add(SC_Draws, 30);
+	stats.EndFrame();
+	frame_stats.Sample(4, Passes(3), stats);
+
+	std::ostringstream ss;
+	frame_stats.WriteJson(ss, 7);
+	std::string json = ss.str();
+	CHECK_EQ(json.front(), '{');
+	CHECK_EQ(json.back(), '}');
+	CHECK(json.find("\"frames\": 2,") != std::string::npos);
+	CHECK(json.find("\"warmup_frames\": 7,") != std::string::npos);
+	CHECK(json.find("\"frame_ms\": { \"min\": 2, \"avg\": 3, \"p95\": 4, \"p99\": 4, \"max\": 4 }") != std::string::npos);
+	CHECK(json.find("\"draws\": { \"avg\": 20, \"max\": 30 }") != std::string::npos);
+	CHECK(json.find("\"triangles\": { \"avg\": 0, \"max\": 0 }") != std::string::npos);
+	CHECK(json.find("{ \"name\": \"GBuffer\", \"cpu_ms\": 2, \"gpu_ms\": 4 }") != std::string::npos);
+	CHECK(json.find("{ \"name\": \"Present\", \"cpu_ms\": 0.5, \"gpu_ms\": 0 }") != std::string::npos);
+
+	//The members alone, for a caller's own object
+	std::ostringstream members;
+	frame_stats.WriteJsonMembers(members, 7);
+	CHECK_EQ("{\n" + members.str() + "}", json);
+}
@@ -0,0 +1,268 @@
+#include "TestHarness.h"
+#include "BatchMath.h"
+#include "ImageBasedLighting.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const uint32_t SIZE = 32;
+	const uint32_t NUM_SAMPLES = 64;
+
+	//The floor under the reference in relative errors, so the dark ground doesn't dominate them
+	const float ERROR_FLOOR = 0.05f;
+
+	const float FACE_AXES[6][3] =
+	{
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+	};
+
+	void FillCubemap(uint32_t size, const float rgb[3], Cubemap& cube)
+	{
+		AllocateCubemap(size, cube);
+		for (size_t i = 0; i != cube.texels.size(); i += 4)
+		{
+			std::copy(rgb, rgb + 3, &cube.texels[i]);
+			cube.texels[i + 3] = 1;
+		}
+	}
+
+	//Fibonacci sphere
+	std::vector<std::array<float, 3>> SphereDirections(uint32_t count)
+	{
+		std::vector<std::array<float, 3>> dirs(count);
+		for (uint32_t i = 0; i != count; i++)
+		{
+			float y = 1 - (i + 0.5f) * 2 / count;
+			float r = std::sqrt(1 - y * y);
+			float phi = i * 2.39996323f;
+			dirs[i] = { { r * std::cos(phi), y, r * std::sin(phi) } };
+		}
+		return dirs;
+	}
+
+	float RelativeError(const float* approx, const float* reference)
+	{
+		float err = 0;
+		for (int c = 0; c != 3; c++)
+		{
+			err = (std::max)(err, std::abs(approx[c] - reference[c]) / (reference[c] + ERROR_FLOOR));
+		}
+		return err;
+	}
+
+	float MaxAbsDiff(const std::vector<Cubemap>& a, const std::vector<Cubemap>& b)
+	{
+		float diff = 0;
+		for (size_t m = 0; m != a.size(); m++)
+		{
+			for (size_t i = 0; i != a[m].texels.size(); i++)
+			{
+				diff = (std::max)(diff, std::abs(a[m].texels[i] - b[m].texels[i]));
+			}
+		}
+		return diff;
+	}
+}
+
+
+TEST_CASE(ImageBasedLighting, FacesAreInD3DOrder)
+{
+	Cubemap cube;
+	AllocateCubemap(4, cube);
+	CHECK_EQ(cube.size, 4u);
+	REQUIRE(cube.texels.size() == 6 * 4 * 4 * 4);
+
+	//Each face its own value, read back along its axis
+	for (size_t i = 0; i != cube.texels.size(); i++)
+	{
+		cube.texels[i] = static_cast<float>(i / (4 * 4 * 4));
+	}
+	for (uint32_t face = 0; face != 6; face++)
+	{
+		float rgba[4];
+		SampleCubemap(cube, FACE_AXES[face], rgba);
+		CHECK_EQ(rgba[0], static_cast<float>(face));
+
+		//And the face's center direction is its axis
+		float dir[3];
+		CubemapDirection(face, 0, 0, dir);
+		for (int c = 0; c != 3; c++)
+		{
+			CHECK_EQ(dir[c], FACE_AXES[face][c]);
+		}
+	}
+}
+
+TEST_CASE(ImageBasedLighting, DownsampleAverages)
+{
+	Cubemap cube;
+	AllocateCubemap(4, cube);
+	for (size_t i = 0; i != cube.texels.size(); i++)
+	{
+		//Alternating columns of 0 and 2
+		cube.texels[i] = ((i / 4) & 1) ? 2.0f : 0.0f;
+	}
+
+	Cubemap half;
+	DownsampleCubemap(cube, half);
+	CHECK_EQ(half.size, 2u);
+	CHECK_EQ(*std::min_element(half.texels.begin(), half.texels.end()), 1.0f);
+	CHECK_EQ(*std::max_element(half.texels.begin(), half.texels.end()), 1.0f);
+
+	Cubemap one;
+	DownsampleCubemap(half, one);
+	Cubemap still_one;
+	DownsampleCubemap(one, still_one);
+	CHECK_EQ(still_one.size, 1u);
+	CHECK_EQ(still_one.texels.size(), static_cast<size_t>(6 * 4));
+}
+
+TEST_CASE(ImageBasedLighting, ConstantEnvironmentIrradiance)
+{
+	//A white Lambertian surface under uniform radiance reflects that radiance in every direction
+	const float rgb[3] = { 0.5f, 1, 2 };
+	Cubemap cube;
+	FillCubemap(SIZE, rgb, cube);
+
+	float sh[SH_COEFFICIENTS][3];
+	ProjectSH9(cube, sh);
+	CHECK_NEAR(sh[0][0], 0.5f * 0.282095f * 4 * 3.14159265f, 1e-3f);
+	for (uint32_t i = 1; i != SH_COEFFICIENTS; i++)
+	{
+		CHECK_NEAR(sh[i][1], 0.0f, 1e-4f);
+	}
+
+	ConvolveSH9Irradiance(sh);
+	for (const auto& dir : SphereDirections(16))
+	{
+		float irradiance[3];
+		EvaluateSH9(sh, dir.data(), irradiance);
+		float reference[3];
+		ReferenceIrradiance(cube, dir.data(), reference);
+		for (int c = 0; c != 3; c++)
+		{
+			CHECK_NEAR(irradiance[c], rgb[c], 1e-3f * rgb[c]);
+			CHECK_NEAR(reference[c], rgb[c], 1e-3f * rgb[c]);
+		}
+	}
+}
+
+TEST_CASE(ImageBasedLighting, SpecularMipChain)
+{
+	CHECK_EQ(SpecularMipCount(128), 5u);
+	CHECK_EQ(SpecularMipCount(MIN_SPECULAR_MIP_SIZE), 1u);
+	CHECK_EQ(SpecularMipCount(MIN_SPECULAR_MIP_SIZE * 2 - 1), 1u);
+	CHECK_EQ(SpecularMipRoughness(0, 5), 0.0f);
+	CHECK_EQ(SpecularMipRoughness(2, 5), 0.5f);
+	CHECK_EQ(SpecularMipRoughness(4, 5), 1.0f);
+	CHECK_EQ(SpecularMipRoughness(0, 1), 0.0f);
+
+	//Uniform radiance stays uniform at every roughness, the first mip being the environment itself
+	const float rgb[3] = { 0.25f, 0.5f, 1 };
+	Cubemap cube;
+	FillCubemap(SIZE, rgb, cube);
+	std::vector<Cubemap> mips;
+	PrefilterSpecular(cube, NUM_SAMPLES, mips);
+	REQUIRE(mips.size() == SpecularMipCount(SIZE));
+	CHECK(mips[0].texels == cube.texels);
+	for (size_t m = 1; m != mips.size(); m++)
+	{
+		CHECK_EQ(mips[m].size, SIZE >> m);
+		float max_diff = 0;
+		for (size_t i = 0; i != mips[m].texels.size(); i += 4)
+		{
+			for (int c = 0; c != 3; c++)
+			{
+				max_diff = (std::max)(max_diff, std::abs(mips[m].texels[i + c] - rgb[c]));
+			}
+		}
+		CHECK(max_diff < 1e-4f);
+	}
+}
+
+TEST_CASE(ImageBasedLighting, SkyMatchesReferenceIntegrals)
+{
+	Cubemap sky;
+	BuildSkyCubemap(SIZE, sky);
+
+	float sh[SH_COEFFICIENTS][3];
+	ProjectSH9(sky, sh);
+	ConvolveSH9Irradiance(sh);
+	std::vector<Cubemap> mips;
+	PrefilterSpecular(sky, NUM_SAMPLES, mips);
+
+	//Irradiance is smooth enough for SH9 to be close everywhere. The importance sampled lobes are
+	//noisier, the engine's sample count keeps them within a tenth of the reference
+	float irradiance_err = 0;
+	float specular_err = 0;
+	for (const auto& dir : SphereDirections(32))
+	{
+		float approx[4];
+		float reference[3];
+		EvaluateSH9(sh, dir.data(), approx);
+		ReferenceIrradiance(sky, dir.data(), reference);
+		irradiance_err = (std::max)(irradiance_err, RelativeError(approx, reference));
+
+		for (uint32_t m = 1; m != mips.size(); m++)
+		{
+			SampleCubemap(mips[m], dir.data(), approx);
+			ReferenceSpecular(sky, dir.data(), SpecularMipRoughness(m, static_cast<uint32_t>(mips.size())), reference);
+			specular_err = (std::max)(specular_err, RelativeError(approx, reference));
+		}
+	}
+	CHECK(irradiance_err < 0.03f);
+	CHECK(specular_err < 0.1f);
+
+	//Brightest looking up, darkest at the ground
+	float up[3] = { 0, 1, 0 };
+	float down[3] = { 0, -1, 0 };
+	float sky_irradiance[3];
+	float ground_irradiance[3];
+	EvaluateSH9(sh, up, sky_irradiance);
+	EvaluateSH9(sh, down, ground_irradiance);
+	CHECK(sky_irradiance[2] > ground_irradiance[2] * 2);
+}
+
+TEST_CASE(ImageBasedLighting, SameThreadedAndAtEverySIMDLevel)
+{
+	Cubemap sky;
+	BuildSkyCubemap(SIZE, sky);
+	JobSystem js(2);
+
+	SIMDLevel detected = DetectSIMDLevel();
+	ForceSIMDLevel(SL_Scalar);
+	float reference_sh[SH_COEFFICIENTS][3];
+	ProjectSH9(sky, reference_sh);
+	std::vector<Cubemap> reference_mips;
+	PrefilterSpecular(sky, NUM_SAMPLES, reference_mips);
+
+	for (int level = SL_Scalar; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+		for (JobSystem* jobs : { static_cast<JobSystem*>(nullptr), &js })
+		{
+			float sh[SH_COEFFICIENTS][3];
+			ProjectSH9(sky, sh, jobs);
+			float sh_diff = 0;
+			for (uint32_t i = 0; i != SH_COEFFICIENTS * 3; i++)
+			{
+				sh_diff = (std::max)(sh_diff, std::abs((&sh[0][0])[i] - (&reference_sh[0][0])[i]));
+			}
+			CHECK(sh_diff < 1e-4f);
+
+			std::vector<Cubemap> mips;
+			PrefilterSpecular(sky, NUM_SAMPLES, mips, jobs);
+			REQUIRE(mips.size() == reference_mips.size());
+			CHECK(MaxAbsDiff(mips, reference_mips) < 1e-4f);
+		}
+	}
+	ForceSIMDLevel(detected);
+}
@@ -0,0 +1,278 @@
+#include "TestHarness.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+//Meant to be run under ThreadSanitizer too, configure with -DEPSILON_SANITIZER=thread
+
+namespace
+{
+	const uint32_t WORKER_COUNTS[] = { 1, 2, 4 };
+
+	//Runs body once on its own job system per worker count
+	template <typename F>
+	void ForEachWorkerCount(F body)
+	{
+		for (uint32_t workers : WORKER_COUNTS)
+		{
+			JobSystem js(workers);
+			body(js);
+		}
+	}
+
+	bool WaitThrows(JobSystem& js, JobCounter& counter, const char* what)
+	{
+		try
+		{
+			js.Wait(counter);
+		}
+		catch (const std::runtime_error& e)
+		{
+			return std::string(e.what()) == what;
+		}
+		return false;
+	}
+}
+
+
+TEST_CASE(Jobs, RunExecutesEveryJob)
+{
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		for (int round = 0; round != 20; round++)
+		{
+			std::atomic<int32_t> sum(0);
+			JobCounter counter;
+			for (int32_t i = 1; i <= 1000; i++)
+			{
+				js.Run([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }, &counter);
+			}
+			js.Wait(counter);
+			CHECK(counter.Done());
+			CHECK_EQ(sum.load(), 500500);
+		}
+	});
+}
+
+TEST_CASE(Jobs, JobsSpawnAndWaitOnJobs)
+{
+	//Each job waits on children of its own, so workers execute and steal while waiting
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		std::atomic<int32_t> leaves(0);
+		JobCounter counter;
+		for (int i = 0; i != 16; i++)
+		{
+			js.Run([&js, &leaves]()
+			{
+				JobCounter children;
+				for (int j = 0; j != 16; j++)
+				{
+					js.Run([&js, &leaves]()
+					{
+						js.ParallelFor(64, 4, [&leaves](size_t begin, size_t end)
+						{
+							leaves.fetch_add(static_cast<int32_t>(end - begin), std::memory_order_relaxed);
+						});
+					}, &children);
+				}
+				js.Wait(children);
+			}, &counter);
+		}
+		js.Wait(counter);
+		CHECK_EQ(leaves.load(), 16 * 16 * 64);
+	});
+}
+
+TEST_CASE(Jobs, ParallelForCoversRangeOnce)
+{
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		const size_t counts[] = { 0, 1, 7, 64, 1000, 4099 };
+		for (size_t count : counts)
+		{
+			std::vector<std::atomic<int32_t>> hits(count);
+			for (auto& h : hits)
+			{
+				h.store(0);
+			}
+			js.ParallelFor(count, 16, [&hits](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i != end; i++)
+				{
+					hits[i].fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+
+			bool once = true;
+			for (auto& h : hits)
+			{
+				once &= (h.load() == 1);
+			}
+			CHECK(once);
+		}
+	});
+}
+
+TEST_CASE(Jobs, ExternalThreadsRunJobs)
+{
+	//Threads that aren't workers queue through the external list and wait without a deque
+	JobSystem js(2);
+	std::atomic<int32_t> sum(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t != 4; t++)
+	{
+		threads.emplace_back([&js, &sum]()
+		{
+			JobCounter counter;
+			for (int i = 0; i != 500; i++)
+			{
+				js.Run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			}
+			js.Wait(counter);
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	CHECK_EQ(sum.load(), 2000);
+}
+
+TEST_CASE(Jobs, RunExceptionReachesWait)
+{
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		std::atomic<int32_t> ran(0);
+		JobCounter counter;
+		for (int i = 0; i != 100; i++)
+		{
+			js.Run([&ran, i]()
+			{
+				ran.fetch_add(1, std::memory_order_relaxed);
+				if (i % 10 == 3)
+				{
+					throw std::runtime_error("job failed");
+				}
+			}, &counter);
+		}
+
+		//Every job still ran and was counted, only then is the first exception rethrown
+		CHECK(WaitThrows(js, counter, "job failed"));
+		CHECK(counter.Done());
+		CHECK_EQ(ran.load(), 100);
+
+		//The counter and the workers are still usable
+		js.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		js.Wait(counter);
+		CHECK_EQ(ran.load(), 101);
+	});
+}
+
+TEST_CASE(Jobs, UncountedExceptionReachesNextWait)
+{
+	JobSystem js(2);
+	JobCounter counter;
+	js.Run([]() { throw std::runtime_error("uncounted"); });
+	js.Run([]() {}, &counter);
+
+	//Reported by the first Wait after the job ran, whichever counter it's on
+	bool threw = false;
+	auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!threw && std::chrono::steady_clock::now() < give_up)
+	{
+		threw = WaitThrows(js, counter, "uncounted");
+		std::this_thread::yield();
+	}
+	CHECK(threw);
+	js.Wait(counter);
+}
+
+TEST_CASE(Jobs, NestedExceptionPropagatesOutward)
+{
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		JobCounter outer;
+		js.Run([&js]()
+		{
+			JobCounter inner;
+			js.Run([]() { throw std::runtime_error("inner"); }, &inner);
+			js.Wait(inner);
+		}, &outer);
+		CHECK(WaitThrows(js, outer, "inner"));
+	});
+}
+
+TEST_CASE(Jobs, ParallelForRethrowsAfterEveryChunk)
+{
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		for (size_t failing : { size_t(0), size_t(500) })
+		{
+			std::atomic<int32_t> done(0);
+			bool threw = false;
+			try
+			{
+				js.ParallelFor(1000, 10, [&done, failing](size_t begin, size_t end)
+				{
+					done.fetch_add(static_cast<int32_t>(end - begin), std::memory_order_relaxed);
+					if (begin == failing)
+					{
+						throw std::runtime_error("chunk failed");
+					}
+				});
+			}
+			catch (const std::runtime_error&)
+			{
+				threw = true;
+			}
+			CHECK(threw);
+			CHECK_EQ(done.load(), 1000);
+		}
+	});
+}
+
+TEST_CASE(Jobs, WaitLeavesBackgroundJobsToWorkers)
+{
+	ForEachWorkerCount([](JobSystem& js)
+	{
+		//The background job holds its worker until released, so the waits below can't find it finished
+		std::atomic<bool> release(false);
+		std::thread::id background_thread;
+		JobCounter background;
+		js.RunBackground([&release, &background_thread]()
+		{
+			background_thread = std::this_thread::get_id();
+			while (!release.load())
+			{
+				std::this_thread::yield();
+			}
+		}, &background);
+
+		//Main thread waits on unrelated work, as a frame does, and never runs the background job itself
+		for (int round = 0; round != 20; round++)
+		{
+			std::atomic<int32_t> sum(0);
+			JobCounter counter;
+			for (int32_t i = 1; i <= 100; i++)
+			{
+				js.Run([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }, &counter);
+			}
+			js.Wait(counter);
+			CHECK_EQ(sum.load(), 5050);
+			js.ParallelFor(1000, 10, [](size_t, size_t) {});
+		}
+		CHECK(!background.Done());
+
+		release.store(true);
+		js.Wait(background);
+		CHECK(background_thread != std::this_thread::get_id());
+	});
+}
@@ -0,0 +1,150 @@
+#include "TestHarness.h"
+#include "LightBounds.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const float NEAR_PLANE = 0.1f;
+	const float PROJ_X = 1.358f;
+	const float PROJ_Y = 2.414f;
+
+	const float THRESHOLD = 0.01f;
+
+	//Fibonacci sphere
+	std::vector<std::array<float, 3>> SphereDirections(uint32_t count)
+	{
+		std::vector<std::array<float, 3>> dirs(count);
+		for (uint32_t i = 0; i != count; i++)
+		{
+			float y = 1 - (i + 0.5f) * 2 / count;
+			float r = std::sqrt(1 - y * y);
+			float phi = i * 2.39996323f;
+			dirs[i] = { { r * std::cos(phi), y, r * std::sin(phi) } };
+		}
+		return dirs;
+	}
+}
+
+
+TEST_CASE(LightBounds, CutoffBoundsTheContribution)
+{
+	//Quadratic, mixed and linear-only falloffs, what's brighter than the threshold is inside the bound
+	const float falloffs[][3] = { { 1, 0, 1 }, { 1, 0.5f, 0.2f }, { 0.5f, 0, 0.05f }, { 1, 2, 0 } };
+	for (const auto& falloff : falloffs)
+	{
+		for (float intensity : { 0.5f, 4.0f, 100.0f })
+		{
+			float cutoff = AttenuationCutoff(falloff, intensity, THRESHOLD);
+			REQUIRE(cutoff > 0);
+			REQUIRE(std::isfinite(cutoff));
+
+			bool above_inside = true;
+			for (uint32_t i = 0; i <= 64; i++)
+			{
+				float dist = cutoff * i / 64 * 0.999f;
+				above_inside &= intensity * AttenuationTerm(falloff, dist) >= THRESHOLD;
+			}
+			CHECK(above_inside);
+			CHECK_NEAR(intensity * AttenuationTerm(falloff, cutoff), THRESHOLD, THRESHOLD * 1e-3f);
+			CHECK(intensity * AttenuationTerm(falloff, cutoff * 1.001f) < THRESHOLD);
+		}
+	}
+
+	//Linear only, solved directly
+	const float linear[3] = { 1, 2, 0 };
+	CHECK_NEAR(AttenuationCutoff(linear, 1, THRESHOLD), (100.0f - 1) / 2, 1e-3f);
+}
+
+TEST_CASE(LightBounds, CutoffEdgeCases)
+{
+	//A constant falloff never fades: no range when it's below the threshold from the start, infinite otherwise
+	const float constant[3] = { 1, 0, 0 };
+	CHECK_EQ(AttenuationCutoff(constant, 0.005f, THRESHOLD), 0.0f);
+	CHECK_EQ(AttenuationCutoff(constant, 0.01f, THRESHOLD), 0.0f);
+	CHECK(std::isinf(AttenuationCutoff(constant, 1, THRESHOLD)));
+
+	//Too dim even at the light
+	const float quadratic[3] = { 1, 0, 1 };
+	CHECK_EQ(AttenuationCutoff(quadratic, 0.001f, THRESHOLD), 0.0f);
+}
+
+TEST_CASE(LightBounds, ScreenRectContainsTheSphere)
+{
+	//Lights of random brightness, bounded at their cutoff as the light packer does
+	const std::vector<std::array<float, 3>> dirs = SphereDirections(256);
+	const float falloff[3] = { 1, 0, 1 };
+	Random rnd(5);
+	uint32_t num_tested = 0;
+	for (int s = 0; s != 64; s++)
+	{
+		float center[3] = { rnd.Uniform(-20, 20), rnd.Uniform(-10, 10), rnd.Uniform(0.5f, 40) };
+		float radius = AttenuationCutoff(falloff, rnd.Uniform(0.02f, 0.6f), THRESHOLD);
+		float rect[4];
+		if (!SphereScreenRect(center, radius, NEAR_PLANE, PROJ_X, PROJ_Y, rect))
+		{
+			continue;
+		}
+		++num_tested;
+
+		//Points on the surface and halfway in, those in front of the near plane land in the rectangle
+		bool inside = true;
+		for (const auto& d : dirs)
+		{
+			for (float scale : { 1.0f, 0.5f })
+			{
+				float p[3];
+				for (int i = 0; i != 3; i++)
+				{
+					p[i] = center[i] + d[i] * radius * scale;
+				}
+				if (p[2] <= NEAR_PLANE)
+				{
+					continue;
+				}
+
+				float x = (std::min)((std::max)(p[0] * PROJ_X / p[2], -1.0f), 1.0f);
+				float y = (std::min)((std::max)(p[1] * PROJ_Y / p[2], -1.0f), 1.0f);
+				const float eps = 1e-5f;
+				inside &= (x >= rect[0] - eps) && (x <= rect[2] + eps) && (y >= rect[1] - eps) && (y <= rect[3] + eps);
+			}
+		}
+		CHECK(inside);
+	}
+	CHECK(num_tested > 32);
+
+	//And tightly: the rectangle of a sphere straight ahead is its tangents' projection
+	const float ahead[3] = { 0, 0, 10 };
+	float rect[4];
+	REQUIRE(SphereScreenRect(ahead, 1, NEAR_PLANE, PROJ_X, PROJ_Y, rect));
+	float tan_t = 1 / std::sqrt(99.0f);
+	CHECK_NEAR(rect[2], tan_t * PROJ_X, 1e-5f);
+	CHECK_NEAR(rect[0], -tan_t * PROJ_X, 1e-5f);
+	CHECK_NEAR(rect[3], tan_t * PROJ_Y, 1e-5f);
+}
+
+TEST_CASE(LightBounds, ScreenRectNearPlaneAndOffscreen)
+{
+	float rect[4];
+
+	//Reaching the near plane covers the screen, wholly behind it covers nothing
+	const float straddling[3] = { 3, 0, 0.5f };
+	REQUIRE(SphereScreenRect(straddling, 1, NEAR_PLANE, PROJ_X, PROJ_Y, rect));
+	CHECK_EQ(rect[0], -1.0f);
+	CHECK_EQ(rect[1], -1.0f);
+	CHECK_EQ(rect[2], 1.0f);
+	CHECK_EQ(rect[3], 1.0f);
+
+	const float behind[3] = { 0, 0, -2 };
+	CHECK(!SphereScreenRect(behind, 1, NEAR_PLANE, PROJ_X, PROJ_Y, rect));
+
+	//Off to the side it clamps to an empty edge
+	const float beside[3] = { 100, 0, 5 };
+	CHECK(!SphereScreenRect(beside, 1, NEAR_PLANE, PROJ_X, PROJ_Y, rect));
+}
@@ -0,0 +1,276 @@
+#include "TestHarness.h"
+#include "BatchMath.h"
+#include "LightPacker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const float NEAR_PLANE = 0.1f;
+	const float PROJ_X = 1.358f;
+	const float PROJ_Y = 2.414f;
+
+	const float COLOR[3] = { 1, 0.9f, 0.8f };
+	const float FALLOFF[3] = { 1, 0, 1 };
+
+	//Camera at eye looking along +z turned by yaw around y, row-major for row vectors
+	void ViewMatrix(float yaw, const float eye[3], float view[16])
+	{
+		float r[3] = { std::cos(yaw), 0, -std::sin(yaw) };
+		float u[3] = { 0, 1, 0 };
+		float f[3] = { std::sin(yaw), 0, std::cos(yaw) };
+		const float* axes[3] = { r, u, f };
+		for (int row = 0; row != 3; row++)
+		{
+			for (int col = 0; col != 3; col++)
+			{
+				view[row * 4 + col] = axes[col][row];
+			}
+			view[row * 4 + 3] = 0;
+		}
+		for (int col = 0; col != 3; col++)
+		{
+			view[12 + col] = -(axes[col][0] * eye[0] + axes[col][1] * eye[1] + axes[col][2] * eye[2]);
+		}
+		view[15] = 1;
+	}
+
+	struct TestLight
+	{
+		float pos[3];
+		float dir[3];
+	};
+
+	//In a box in front of the camera, every other one a spot
+	std::vector<TestLight> MakeLights(size_t count)
+	{
+		std::vector<TestLight> lights(count);
+		for (size_t i = 0; i != count; i++)
+		{
+			float f = static_cast<float>(i);
+			TestLight& l = lights[i];
+			l.pos[0] = std::sin(f * 0.37f) * 50;
+			l.pos[1] = std::cos(f * 0.11f) * 10 + 10;
+			l.pos[2] = std::sin(f * 0.73f) * 50 + 60;
+			float len = std::sqrt(std::cos(f) * std::cos(f) + 1 + std::sin(f) * std::sin(f));
+			l.dir[0] = std::cos(f) / len;
+			l.dir[1] = -1 / len;
+			l.dir[2] = std::sin(f) / len;
+		}
+		return lights;
+	}
+
+	void AddAll(LightPacker& packer, const std::vector<TestLight>& lights)
+	{
+		packer.Clear();
+		for (size_t i = 0; i != lights.size(); i++)
+		{
+			const TestLight& l = lights[i];
+			float cos_outer = (i & 1) ? 0.7f : -2.0f;
+			float cos_inner = (i & 1) ? 0.9f : -1.0f;
+			packer.Add(l.pos, l.dir, 8, cos_outer, cos_inner, COLOR, FALLOFF, l.pos, 8);
+		}
+	}
+
+	void Pack(LightPacker& packer, float yaw)
+	{
+		const float eye[3] = { 0, 5, 0 };
+		float view[16];
+		ViewMatrix(yaw, eye, view);
+		packer.Pack(view, NEAR_PLANE, PROJ_X, PROJ_Y);
+	}
+
+	//Every dirty light is in a range, ranges are ordered and apart
+	bool RangesCover(const LightPacker& packer, const std::vector<bool>& changed)
+	{
+		const std::vector<LightRange>& ranges = packer.DirtyRanges();
+		std::vector<bool> covered(changed.size(), false);
+		uint32_t end = 0;
+		for (size_t r = 0; r != ranges.size(); r++)
+		{
+			if ((r > 0) && (ranges[r].first <= end))
+			{
+				return false;
+			}
+			for (uint32_t i = ranges[r].first; i != ranges[r].first + ranges[r].count; i++)
+			{
+				covered[i] = true;
+			}
+			end = ranges[r].first + ranges[r].count;
+		}
+		for (size_t i = 0; i != changed.size(); i++)
+		{
+			if (changed[i] && !covered[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+
+TEST_CASE(LightPacker, PacksInViewSpace)
+{
+	std::vector<TestLight> lights = MakeLights(4);
+
+	//Behind the camera, so it covers no pixel
+	lights[3].pos[2] = -30;
+
+	LightPacker packer;
+	AddAll(packer, lights);
+	const float shadow_mat[16] = { 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 1, 0, 0.5f, 0.5f, 0, 1 };
+	const float uv_clamp[4] = { 0, 0, 0.25f, 0.25f };
+	packer.SetShadow(1, shadow_mat, uv_clamp);
+	Pack(packer, 0);
+
+	REQUIRE(packer.NumLights() == 4);
+	const PackedLight* packed = packer.Lights();
+	for (size_t i = 0; i != 4; i++)
+	{
+		//Without a yaw the view transform is a translation by the eye
+		CHECK_NEAR(packed[i].pos_es[0], lights[i].pos[0], 1e-4f);
+		CHECK_NEAR(packed[i].pos_es[1], lights[i].pos[1] - 5, 1e-4f);
+		CHECK_NEAR(packed[i].pos_es[2], lights[i].pos[2], 1e-4f);
+		CHECK_NEAR(packed[i].dir_es[1], lights[i].dir[1], 1e-6f);
+		CHECK_EQ(packed[i].range, 8.0f);
+		CHECK_EQ(packed[i].shadow_enabled, 1 == i ? 1.0f : 0.0f);
+	}
+	CHECK_EQ(packed[1].cos_outer, 0.7f);
+	CHECK_EQ(packed[1].shadow_mat[12], 0.5f);
+	CHECK_EQ(packed[1].shadow_uv_clamp[2], 0.25f);
+	CHECK(packed[0].screen_rect[0] <= packed[0].screen_rect[2]);
+	CHECK(packed[3].screen_rect[0] > packed[3].screen_rect[2]);
+}
+
+TEST_CASE(LightPacker, OnlyChangedLightsAreDirty)
+{
+	const size_t num_lights = 1000;
+	std::vector<TestLight> lights = MakeLights(num_lights);
+
+	LightPacker packer;
+	AddAll(packer, lights);
+	Pack(packer, 0);
+	CHECK_EQ(packer.NumDirtyLights(), static_cast<uint32_t>(num_lights));
+	REQUIRE(packer.DirtyRanges().size() == 1);
+	CHECK_EQ(packer.DirtyRanges()[0].count, static_cast<uint32_t>(num_lights));
+
+	//Nothing moved
+	AddAll(packer, lights);
+	Pack(packer, 0);
+	CHECK_EQ(packer.NumDirtyLights(), 0u);
+	CHECK(packer.DirtyRanges().empty());
+
+	//A percent of the lights move with a still camera
+	for (uint32_t frame = 1; frame != 20; frame++)
+	{
+		std::vector<TestLight> moved = lights;
+		std::vector<bool> changed(num_lights, false);
+		for (size_t i = frame % 100; i < num_lights; i += 100)
+		{
+			moved[i].pos[1] += 0.5f;
+			changed[i] = true;
+		}
+		AddAll(packer, moved);
+		Pack(packer, 0);
+		CHECK_EQ(packer.NumDirtyLights(), static_cast<uint32_t>(num_lights / 100));
+		CHECK_EQ(packer.DirtyRanges().size(), num_lights / 100);
+		CHECK(RangesCover(packer, changed));
+		lights = moved;
+	}
+
+	//A moving camera changes every light
+	AddAll(packer, lights);
+	Pack(packer, 0.01f);
+	CHECK_EQ(packer.NumDirtyLights(), static_cast<uint32_t>(num_lights));
+}
+
+TEST_CASE(LightPacker, CloseDirtyRunsMerge)
+{
+	std::vector<TestLight> lights = MakeLights(40);
+	LightPacker packer;
+	AddAll(packer, lights);
+	Pack(packer, 0);
+
+	//Gaps of up to a few clean lights are uploaded with their neighbours
+	const size_t moved_lights[] = { 2, 5, 20, 30 };
+	std::vector<bool> changed(lights.size(), false);
+	for (size_t i : moved_lights)
+	{
+		lights[i].pos[0] += 1;
+		changed[i] = true;
+	}
+	AddAll(packer, lights);
+	Pack(packer, 0);
+	CHECK_EQ(packer.NumDirtyLights(), 4u);
+	REQUIRE(packer.DirtyRanges().size() == 3);
+	CHECK_EQ(packer.DirtyRanges()[0].first, 2u);
+	CHECK_EQ(packer.DirtyRanges()[0].count, 4u);
+	CHECK(RangesCover(packer, changed));
+}
+
+TEST_CASE(LightPacker, GrowingAndShrinking)
+{
+	std::vector<TestLight> lights = MakeLights(50);
+	LightPacker packer;
+	AddAll(packer, lights);
+	Pack(packer, 0);
+
+	//New lights at the end are dirty, the others untouched
+	lights = MakeLights(60);
+	AddAll(packer, lights);
+	Pack(packer, 0);
+	CHECK_EQ(packer.NumLights(), static_cast<size_t>(60));
+	CHECK_EQ(packer.NumDirtyLights(), 10u);
+	REQUIRE(packer.DirtyRanges().size() == 1);
+	CHECK_EQ(packer.DirtyRanges()[0].first, 50u);
+
+	lights = MakeLights(20);
+	AddAll(packer, lights);
+	Pack(packer, 0);
+	CHECK_EQ(packer.NumLights(), static_cast<size_t>(20));
+	CHECK_EQ(packer.NumDirtyLights(), 0u);
+}
+
+TEST_CASE(LightPacker, SameAtEverySIMDLevel)
+{
+	std::vector<TestLight> lights = MakeLights(333);
+
+	SIMDLevel detected = DetectSIMDLevel();
+	ForceSIMDLevel(SL_Scalar);
+	LightPacker reference;
+	AddAll(reference, lights);
+	Pack(reference, 0.3f);
+
+	for (int level = SL_Scalar + 1; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+		LightPacker packer;
+		AddAll(packer, lights);
+		Pack(packer, 0.3f);
+
+		bool same = true;
+		for (size_t i = 0; i != lights.size(); i++)
+		{
+			const PackedLight& a = packer.Lights()[i];
+			const PackedLight& b = reference.Lights()[i];
+			for (int c = 0; c != 3; c++)
+			{
+				same &= std::abs(a.pos_es[c] - b.pos_es[c]) <= 1e-4f * (std::max)(1.0f, std::abs(b.pos_es[c]));
+				same &= std::abs(a.dir_es[c] - b.dir_es[c]) <= 1e-5f;
+			}
+			for (int c = 0; c != 4; c++)
+			{
+				same &= std::abs(a.screen_rect[c] - b.screen_rect[c]) <= 1e-4f;
+			}
+		}
+		CHECK(same);
+	}
+	ForceSIMDLevel(detected);
+}
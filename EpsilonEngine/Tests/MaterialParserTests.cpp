@@ -0,0 +1,211 @@
+#include "TestHarness.h"
+#include "MaterialParser.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const std::string SPONZA_DIR = EPSILON_MEDIA_DIR "/Model/Sponza";
+
+	std::vector<MaterialDesc> Parse(const std::string& text)
+	{
+		std::istringstream ss(text);
+		std::vector<MaterialDesc> materials;
+		ParseMTL(ss, materials);
+		return materials;
+	}
+
+	MaterialDesc Derived(const std::string& text)
+	{
+		std::vector<MaterialDesc> materials = Parse(text);
+		REQUIRE(materials.size() == 1);
+		DerivePBRParameters(materials[0]);
+		return materials[0];
+	}
+
+	bool Exists(const std::string& path)
+	{
+		return std::ifstream(path).is_open();
+	}
+}
+
+
+TEST_CASE(MaterialParser, ParsesKeysAndDefaults)
+{
+	std::vector<MaterialDesc> materials = Parse(
+		"# exported\n"
+		"Kd 1 0 0\n"
+		"newmtl first\n"
+		"  KD 0.5 0.25 0.125\n"
+		"Ka 0.3\n"
+		"Ns 64\n"
+		"Pm 0.75\n"
+		"\n"
+		"newmtl second\n"
+		"illum 2\n");
+	REQUIRE(materials.size() == 2);
+
+	//Keys before the first newmtl belong to nothing, a single value is grey, key case doesn't matter
+	const MaterialDesc& first = materials[0];
+	CHECK_EQ(first.name, std::string("first"));
+	CHECK_EQ(first.kd[0], 0.5f);
+	CHECK_EQ(first.kd[1], 0.25f);
+	CHECK_EQ(first.kd[2], 0.125f);
+	CHECK_EQ(first.ka[1], 0.3f);
+	CHECK_EQ(first.ka[2], 0.3f);
+	CHECK_EQ(first.ns, 64.0f);
+	CHECK_EQ(first.pm, 0.75f);
+
+	//And the format's defaults for what a material leaves out
+	const MaterialDesc& second = materials[1];
+	CHECK_EQ(second.name, std::string("second"));
+	CHECK_EQ(second.ka[0], 0.2f);
+	CHECK_EQ(second.kd[0], 0.8f);
+	CHECK_EQ(second.ks[0], 1.0f);
+	CHECK_EQ(second.ns, 0.0f);
+	for (const auto& map : second.maps)
+	{
+		CHECK(map.empty());
+	}
+
+	std::istringstream empty("# nothing\nKd 1 1 1\n");
+	CHECK(!ParseMTL(empty, materials));
+	CHECK(materials.empty());
+}
+
+TEST_CASE(MaterialParser, MapOptionsAreSkipped)
+{
+	std::vector<MaterialDesc> materials = Parse(
+		"newmtl a\n"
+		"map_Kd -clamp on -o 0.5 0.5 textures\\stone wall.dds\n"
+		"bump textures\\stone_ddn.dds -bm 0.02\n"
+		"map_Ks -imfchan r spec.dds\n"
+		"map_Pm metal.dds\n"
+		"newmtl b\n"
+		"map_bump b_ddn.dds\n"
+		"newmtl c\n"
+		"norm c_ddn.dds\n");
+	REQUIRE(materials.size() == 3);
+	CHECK_EQ(materials[0].maps[MM_Albedo], std::string("textures\\stone wall.dds"));
+	CHECK_EQ(materials[0].maps[MM_Normal], std::string("textures\\stone_ddn.dds"));
+	CHECK_EQ(materials[0].maps[MM_SpecGloss], std::string("spec.dds"));
+	CHECK_EQ(materials[0].maps[MM_Metalness], std::string("metal.dds"));
+	CHECK_EQ(materials[1].maps[MM_Normal], std::string("b_ddn.dds"));
+	CHECK_EQ(materials[2].maps[MM_Normal], std::string("c_ddn.dds"));
+}
+
+TEST_CASE(MaterialParser, DerivesPBRParameters)
+{
+	//Kd black falls back to Ka, as Sponza writes it
+	MaterialDesc sponza = Derived("newmtl a\nKd 0 0 0\nKa 0.59 0.59 0.59\nKs 0.9 0.9 0.9\nNs 30\n");
+	CHECK_EQ(sponza.albedo[0], 0.59f);
+	CHECK_NEAR(sponza.glossiness, std::log2(30.0f) / std::log2(MAX_MATERIAL_SHININESS), 1e-6f);
+	CHECK_EQ(sponza.metalness, 0.0f);
+
+	//Glossiness covers Ns from 1 to the maximum, below is matte and no Ks none at all
+	CHECK_EQ(Derived("newmtl a\nNs 1\n").glossiness, 0.0f);
+	CHECK_EQ(Derived("newmtl a\nNs -0.00\n").glossiness, 0.0f);
+	CHECK_NEAR(Derived("newmtl a\nNs 100000\n").glossiness, 1.0f, 1e-6f);
+	CHECK_EQ(Derived("newmtl a\nKs 0 0 0\nNs 64\n").glossiness, 0.0f);
+
+	//Out of range values clamp
+	MaterialDesc bright = Derived("newmtl a\nKd 2 -1 0.5\nPm 3\n");
+	CHECK_EQ(bright.albedo[0], 1.0f);
+	CHECK_EQ(bright.albedo[1], 0.0f);
+	CHECK_EQ(bright.albedo[2], 0.5f);
+	CHECK_EQ(bright.metalness, 1.0f);
+
+	//A map supplies its parameter alone
+	MaterialDesc mapped = Derived("newmtl a\nNs 2\nPm 0.1\nmap_Ks s.dds\nmap_Pm m.dds\n");
+	CHECK_EQ(mapped.glossiness, 1.0f);
+	CHECK_EQ(mapped.metalness, 1.0f);
+}
+
+TEST_CASE(MaterialParser, ResolvesSponzaMapsOnDisk)
+{
+	std::vector<MaterialDesc> materials;
+	REQUIRE(LoadMTL(SPONZA_DIR + "/Sponza.mtl", materials));
+	CHECK_EQ(materials.size(), static_cast<size_t>(24));
+
+	//Backslashes turned, the .dds found as .DDS, and the spec-gloss map found next to the albedo one
+	int32_t thorn = FindMaterial(materials, "sponza_00SG");
+	REQUIRE(thorn >= 0);
+	CHECK_EQ(materials[thorn].maps[MM_Albedo], SPONZA_DIR + "/textures/sponza_thorn_diff.DDS");
+	CHECK_EQ(materials[thorn].maps[MM_Normal], SPONZA_DIR + "/textures/sponza_thorn_ddn.DDS");
+	CHECK_EQ(materials[thorn].maps[MM_SpecGloss], SPONZA_DIR + "/textures/sponza_thorn_spec.DDS");
+	CHECK_EQ(materials[thorn].glossiness, 1.0f);
+
+	//Without a _diff suffix the spec map is <name>_spec
+	int32_t plant = FindMaterial(materials, "sponza_01SG");
+	REQUIRE(plant >= 0);
+	CHECK_EQ(materials[plant].maps[MM_SpecGloss], SPONZA_DIR + "/textures/vase_plant_spec.DDS");
+
+	//The curtains' maps aren't shipped, so they're dropped
+	int32_t curtain = FindMaterial(materials, "sponza_320SG");
+	REQUIRE(curtain >= 0);
+	CHECK(materials[curtain].maps[MM_Albedo].empty());
+	CHECK(materials[curtain].maps[MM_SpecGloss].empty());
+
+	bool all_exist = true;
+	for (const auto& desc : materials)
+	{
+		for (const auto& map : desc.maps)
+		{
+			all_exist &= map.empty() || Exists(map);
+		}
+	}
+	CHECK(all_exist);
+
+	CHECK_EQ(FindMaterial(materials, "missing"), -1);
+	CHECK(!LoadMTL(SPONZA_DIR + "/missing.mtl", materials));
+}
+
+TEST_CASE(MaterialParser, FindsTheLibraryOfAnObj)
+{
+	CHECK_EQ(FindMTLLibrary(EPSILON_MEDIA_DIR "/Model/Cup/cup.obj"), std::string(EPSILON_MEDIA_DIR "/Model/Cup/cup.mtl"));
+	CHECK(FindMTLLibrary(EPSILON_MEDIA_DIR "/Model/Cup/missing.obj").empty());
+}
+
+TEST_CASE(MaterialParser, DedupesAndSharesTextures)
+{
+	std::vector<MaterialDesc> materials = Parse(
+		"newmtl a\nKd 0.5 0.5 0.5\nmap_Kd wall.dds\n"
+		"newmtl b\nKd 0.5 0.5 0.5\nmap_Kd wall.dds\n"
+		"newmtl c\nKd 0.5 0.5 0.5\nmap_Kd wall.dds\nbump wall_ddn.dds\n"
+		"newmtl d\nKd 0.4 0.5 0.5\nmap_Kd wall.dds\n"
+		"newmtl e\nKd 0.5 0.5 0.5\nmap_Kd wall.dds\nNs 50\n");
+	for (auto& desc : materials)
+	{
+		DerivePBRParameters(desc);
+	}
+
+	//Only a and b look the same, and e once its glossiness differs
+	std::vector<MaterialDesc> unique;
+	std::vector<uint32_t> remap;
+	DedupeMaterials(materials, unique, remap);
+	REQUIRE(unique.size() == 4);
+	CHECK_EQ(unique[0].name, std::string("a"));
+	const uint32_t expected_remap[] = { 0, 0, 1, 2, 3 };
+	for (size_t i = 0; i != materials.size(); i++)
+	{
+		CHECK_EQ(remap[i], expected_remap[i]);
+	}
+
+	//Each file once, in order of first use
+	std::vector<std::string> textures;
+	std::vector<int32_t> map_textures;
+	CollectMaterialTextures(unique, textures, map_textures);
+	REQUIRE(textures.size() == 2);
+	CHECK_EQ(textures[0], std::string("wall.dds"));
+	CHECK_EQ(textures[1], std::string("wall_ddn.dds"));
+	REQUIRE(map_textures.size() == unique.size() * MM_NumMaps);
+	CHECK_EQ(map_textures[1 * MM_NumMaps + MM_Albedo], 0);
+	CHECK_EQ(map_textures[1 * MM_NumMaps + MM_Normal], 1);
+	CHECK_EQ(map_textures[0 * MM_NumMaps + MM_Normal], -1);
+	CHECK_EQ(map_textures[3 * MM_NumMaps + MM_Albedo], 0);
+}
@@ -0,0 +1,356 @@
+#include "TestHarness.h"
+#include "Utils.h"
+#include "CameraPath.h"
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//Components of a vector type, for checking them one by one against plain float arithmetic
+	template <typename VECTOR>
+	struct Components;
+
+	template <>
+	struct Components<Vector2f>
+	{
+		static const int N = 2;
+	};
+
+	template <>
+	struct Components<Vector3f>
+	{
+		static const int N = 3;
+	};
+
+	template <>
+	struct Components<Vector4f>
+	{
+		static const int N = 4;
+	};
+
+	template <typename VECTOR>
+	VECTOR RandomVector(Random& rng, float lo, float hi)
+	{
+		VECTOR v;
+		float* c = &v.x;
+		for (int i = 0; i != Components<VECTOR>::N; i++)
+		{
+			c[i] = rng.Uniform(lo, hi);
+		}
+		return v;
+	}
+
+	//Away from zero, for dividing by
+	template <typename VECTOR>
+	VECTOR RandomDivisor(Random& rng)
+	{
+		VECTOR v = RandomVector<VECTOR>(rng, 0.25f, 4.0f);
+		float* c = &v.x;
+		for (int i = 0; i != Components<VECTOR>::N; i++)
+		{
+			c[i] = (rng.Next() & 1) ? c[i] : -c[i];
+		}
+		return v;
+	}
+
+	template <typename VECTOR, typename OP>
+	bool MatchesComponentwise(const VECTOR& result, const VECTOR& a, const VECTOR& b, OP op)
+	{
+		const float* r = &result.x;
+		const float* ca = &a.x;
+		const float* cb = &b.x;
+		for (int i = 0; i != Components<VECTOR>::N; i++)
+		{
+			if (!SameFloat(r[i], op(ca[i], cb[i])))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename VECTOR>
+	bool NearlyEqual(const VECTOR& a, const VECTOR& b, float eps)
+	{
+		const float* ca = &a.x;
+		const float* cb = &b.x;
+		for (int i = 0; i != Components<VECTOR>::N; i++)
+		{
+			if (!(std::abs(ca[i] - cb[i]) <= eps * (std::max)(1.0f, std::abs(cb[i]))))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Every operator of DEFINE_VECTOR_OPERATORS. They are lane-wise IEEE operations, so whichever math path
+	//is built they have to equal the scalar ones exactly. Division by a scalar is scaling by its reciprocal
+	template <typename VECTOR>
+	void CheckVectorOperators(uint32_t seed)
+	{
+		Random rng(seed);
+		for (int iter = 0; iter != 1000; iter++)
+		{
+			VECTOR a = RandomVector<VECTOR>(rng, -100, 100);
+			VECTOR b = RandomVector<VECTOR>(rng, -100, 100);
+			VECTOR d = RandomDivisor<VECTOR>(rng);
+			float s = rng.Uniform(-8, 8);
+			float sd = (rng.Next() & 1) ? rng.Uniform(0.25f, 4) : -rng.Uniform(0.25f, 4);
+			VECTOR unused;
+
+			auto add = [](float x, float y) { return x + y; };
+			auto sub = [](float x, float y) { return x - y; };
+			auto mul = [](float x, float y) { return x * y; };
+			auto div = [](float x, float y) { return x / y; };
+			auto scale = [s](float x, float) { return x * s; };
+			auto scale_inv = [sd](float x, float) { return x * (1 / sd); };
+			auto negate = [](float x, float) { return x * -1.0f; };
+			auto same = [](float x, float) { return x; };
+
+			VECTOR r = a;
+			CHECK(MatchesComponentwise(r += b, a, b, add));
+			r = a;
+			CHECK(MatchesComponentwise(r -= b, a, b, sub));
+			r = a;
+			CHECK(MatchesComponentwise(r *= b, a, b, mul));
+			r = a;
+			CHECK(MatchesComponentwise(r /= d, a, d, div));
+			r = a;
+			CHECK(MatchesComponentwise(r *= s, a, unused, scale));
+			r = a;
+			CHECK(MatchesComponentwise(r /= sd, a, unused, scale_inv));
+
+			CHECK(MatchesComponentwise(a + b, a, b, add));
+			CHECK(MatchesComponentwise(a - b, a, b, sub));
+			CHECK(MatchesComponentwise(a * b, a, b, mul));
+			CHECK(MatchesComponentwise(a / d, a, d, div));
+			CHECK(MatchesComponentwise(a * s, a, unused, scale));
+			CHECK(MatchesComponentwise(s * a, a, unused, scale));
+			CHECK(MatchesComponentwise(a / sd, a, unused, scale_inv));
+			CHECK(MatchesComponentwise(+a, a, unused, same));
+			CHECK(MatchesComponentwise(-a, a, unused, negate));
+		}
+
+		//The compound forms return the left operand
+		VECTOR v;
+		VECTOR w = RandomVector<VECTOR>(rng, 1, 2);
+		CHECK(&(v += w) == &v);
+		CHECK(&(v -= w) == &v);
+		CHECK(&(v *= w) == &v);
+		CHECK(&(v /= w) == &v);
+		CHECK(&(v *= 2.0f) == &v);
+		CHECK(&(v /= 2.0f) == &v);
+	}
+
+	Matrix RandomAffine(Random& rng)
+	{
+		Matrix m(rng.Uniform(-2, 2), rng.Uniform(-2, 2), rng.Uniform(-2, 2), 0,
+			rng.Uniform(-2, 2), rng.Uniform(-2, 2), rng.Uniform(-2, 2), 0,
+			rng.Uniform(-2, 2), rng.Uniform(-2, 2), rng.Uniform(-2, 2), 0,
+			rng.Uniform(-50, 50), rng.Uniform(-50, 50), rng.Uniform(-50, 50), 1);
+		return m;
+	}
+
+	XMFLOAT4X4 ToFloat4x4(const Matrix& m)
+	{
+		XMFLOAT4X4 f;
+		XMStoreFloat4x4(&f, m);
+		return f;
+	}
+}
+
+
+TEST_CASE(Math, Vector2fOperators)
+{
+	CheckVectorOperators<Vector2f>(2);
+}
+
+TEST_CASE(Math, Vector3fOperators)
+{
+	CheckVectorOperators<Vector3f>(3);
+}
+
+TEST_CASE(Math, Vector4fOperators)
+{
+	CheckVectorOperators<Vector4f>(4);
+}
+
+TEST_CASE(Math, Vector3fLoadStoreKeepsSize)
+{
+	//A 3-vector in an array must not write its neighbour's x
+	Vector3f vs[2] = { Vector3f(1, 2, 3), Vector3f(4, 5, 6) };
+	vs[0] += Vector3f(1, 1, 1);
+	vs[0] = -vs[0];
+	CHECK_EQ(vs[0].x, -2.0f);
+	CHECK_EQ(vs[0].z, -4.0f);
+	CHECK_EQ(vs[1].x, 4.0f);
+
+	Vector2f ws[2] = { Vector2f(1, 2), Vector2f(3, 4) };
+	ws[0] *= 3.0f;
+	CHECK_EQ(ws[0].y, 6.0f);
+	CHECK_EQ(ws[1].x, 3.0f);
+}
+
+TEST_CASE(Math, CrossProduct)
+{
+	Random rng(5);
+	for (int iter = 0; iter != 1000; iter++)
+	{
+		Vector3f a = RandomVector<Vector3f>(rng, -10, 10);
+		Vector3f b = RandomVector<Vector3f>(rng, -10, 10);
+		Vector3f c = CrossProduct3(a, b);
+		Vector3f ref(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+		CHECK(NearlyEqual(c, ref, 1e-5f));
+	}
+
+	Vector3f z = CrossProduct3(Vector3f(1, 0, 0), Vector3f(0, 1, 0));
+	CHECK_EQ(z.x, 0.0f);
+	CHECK_EQ(z.y, 0.0f);
+	CHECK_EQ(z.z, 1.0f);
+}
+
+TEST_CASE(Math, Normalize)
+{
+	Random rng(6);
+	for (int iter = 0; iter != 1000; iter++)
+	{
+		Vector3f v3 = RandomVector<Vector3f>(rng, -10, 10);
+		float len3 = Length(v3);
+		CHECK(NearlyEqual(Normalize(v3), v3 / len3, 1e-6f));
+		CHECK_NEAR(Length(Normalize(v3)), 1.0f, 1e-6f);
+
+		Vector2f v2 = RandomVector<Vector2f>(rng, -10, 10);
+		CHECK(NearlyEqual(Normalize(v2), v2 / Length(v2), 1e-6f));
+
+		Vector4f v4 = RandomVector<Vector4f>(rng, -10, 10);
+		float len4 = std::sqrt(v4.x * v4.x + v4.y * v4.y + v4.z * v4.z + v4.w * v4.w);
+		CHECK(NearlyEqual(Normalize(v4), v4 / len4, 1e-6f));
+	}
+
+	//Zero-length vectors stay zero
+	Vector3f n = Normalize(Vector3f(0, 0, 0));
+	CHECK_EQ(n.x, 0.0f);
+	CHECK_EQ(n.y, 0.0f);
+	CHECK_EQ(n.z, 0.0f);
+	Vector2f n2 = Normalize(Vector2f(0, 0));
+	CHECK_EQ(n2.x, 0.0f);
+	CHECK_EQ(n2.y, 0.0f);
+}
+
+TEST_CASE(Math, Transforms)
+{
+	Random rng(7);
+	for (int iter = 0; iter != 200; iter++)
+	{
+		Matrix m = RandomAffine(rng);
+		XMFLOAT4X4 f = ToFloat4x4(m);
+
+		Vector4f v4 = RandomVector<Vector4f>(rng, -10, 10);
+		Vector4f t4 = Transform(v4, m);
+		Vector4f ref4(v4.x * f._11 + v4.y * f._21 + v4.z * f._31 + v4.w * f._41,
+			v4.x * f._12 + v4.y * f._22 + v4.z * f._32 + v4.w * f._42,
+			v4.x * f._13 + v4.y * f._23 + v4.z * f._33 + v4.w * f._43,
+			v4.x * f._14 + v4.y * f._24 + v4.z * f._34 + v4.w * f._44);
+		CHECK(NearlyEqual(t4, ref4, 1e-5f));
+
+		Vector3f v3 = RandomVector<Vector3f>(rng, -10, 10);
+		Vector3f ref_coord(v3.x * f._11 + v3.y * f._21 + v3.z * f._31 + f._41,
+			v3.x * f._12 + v3.y * f._22 + v3.z * f._32 + f._42,
+			v3.x * f._13 + v3.y * f._23 + v3.z * f._33 + f._43);
+		Vector3f ref_normal(v3.x * f._11 + v3.y * f._21 + v3.z * f._31,
+			v3.x * f._12 + v3.y * f._22 + v3.z * f._32,
+			v3.x * f._13 + v3.y * f._23 + v3.z * f._33);
+		CHECK(NearlyEqual(TransformCoord(v3, m), ref_coord, 1e-5f));
+		CHECK(NearlyEqual(TransformNormal(v3, m), ref_normal, 1e-5f));
+
+		Vector2f v2 = RandomVector<Vector2f>(rng, -10, 10);
+		Vector2f ref_coord2(v2.x * f._11 + v2.y * f._21 + f._41, v2.x * f._12 + v2.y * f._22 + f._42);
+		Vector2f ref_normal2(v2.x * f._11 + v2.y * f._21, v2.x * f._12 + v2.y * f._22);
+		CHECK(NearlyEqual(TransformCoord(v2, m), ref_coord2, 1e-5f));
+		CHECK(NearlyEqual(TransformNormal(v2, m), ref_normal2, 1e-5f));
+	}
+
+	//Coords are divided by w
+	Matrix proj(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0);
+	Vector3f p = TransformCoord(Vector3f(2, 4, 2), proj);
+	CHECK_EQ(p.x, 1.0f);
+	CHECK_EQ(p.y, 2.0f);
+	CHECK_EQ(p.z, 1.0f);
+}
+
+TEST_CASE(Math, MatrixInverse)
+{
+	Matrix identity;
+	XMFLOAT4X4 fi = ToFloat4x4(identity);
+	CHECK_EQ(fi._11, 1.0f);
+	CHECK_EQ(fi._22, 1.0f);
+	CHECK_EQ(fi._41, 0.0f);
+
+	Random rng(8);
+	for (int iter = 0; iter != 200; iter++)
+	{
+		Matrix m = RandomAffine(rng);
+		Matrix inv = m.Inverse();
+
+		//Round trip of a point
+		Vector3f v = RandomVector<Vector3f>(rng, -10, 10);
+		Vector3f back = TransformCoord(TransformCoord(v, m), inv);
+		XMFLOAT4X4 f = ToFloat4x4(m);
+		float det = f._11 * (f._22 * f._33 - f._23 * f._32) - f._12 * (f._21 * f._33 - f._23 * f._31)
+			+ f._13 * (f._21 * f._32 - f._22 * f._31);
+		if (std::abs(det) > 0.1f)
+		{
+			CHECK(NearlyEqual(back, v, 1e-3f));
+		}
+	}
+}
+
+TEST_CASE(Math, BatchWrappersMatchPerVector)
+{
+	Random rng(9);
+	Matrix m = RandomAffine(rng);
+
+	std::vector<Vector3f> in(37);
+	for (auto& v : in)
+	{
+		v = RandomVector<Vector3f>(rng, -10, 10);
+	}
+
+	std::vector<Vector3f> coords(in.size());
+	std::vector<Vector3f> normals(in.size());
+	std::vector<Vector3f> normalized(in.size());
+	TransformCoords(in.data(), coords.data(), in.size(), m);
+	TransformNormals(in.data(), normals.data(), in.size(), m);
+	NormalizeVectors(in.data(), normalized.data(), in.size());
+
+	Vector3f mn, mx;
+	BoundsOfPoints(in.data(), in.size(), mn, mx);
+	for (size_t i = 0; i != in.size(); i++)
+	{
+		CHECK(NearlyEqual(coords[i], TransformCoord(in[i], m), 1e-5f));
+		CHECK(NearlyEqual(normals[i], TransformNormal(in[i], m), 1e-5f));
+		CHECK(NearlyEqual(normalized[i], Normalize(in[i]), 1e-6f));
+		CHECK((in[i].x >= mn.x) && (in[i].y >= mn.y) && (in[i].z >= mn.z));
+		CHECK((in[i].x <= mx.x) && (in[i].y <= mx.y) && (in[i].z <= mx.z));
+	}
+}
+
+TEST_CASE(Math, CameraPathThroughKeys)
+{
+	CameraPath path;
+	path.AddKey(Vector3f(0, 0, 0), Vector3f(0, 0, 1));
+	path.AddKey(Vector3f(10, 2, 0), Vector3f(10, 2, 1));
+	path.AddKey(Vector3f(20, 0, 5), Vector3f(20, 0, 6));
+	CHECK_EQ(path.NumKeys(), static_cast<size_t>(3));
+
+	CameraKey k = path.Evaluate(0.5f);
+	CHECK_NEAR(k.eye.x, 10.0f, 1e-5f);
+	CHECK_NEAR(k.eye.y, 2.0f, 1e-5f);
+	CameraKey end = path.Evaluate(2.0f);
+	CHECK_NEAR(end.eye.z, 5.0f, 1e-5f);
+	CHECK_NEAR(end.at.z, 6.0f, 1e-5f);
+}
@@ -0,0 +1,167 @@
+#include "TestHarness.h"
+#include "MemoryTracker.h"
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//Stands in for a D3D object, MakeTrackedCOMPtr only needs Release
+	struct FakeCOMObject
+	{
+		explicit FakeCOMObject(int& releases)
+			: releases(releases)
+		{
+		}
+
+		void Release()
+		{
+			++releases;
+			delete this;
+		}
+
+		int& releases;
+	};
+
+	//Restores the detailed mode the test found
+	class DetailedScope
+	{
+	public:
+		explicit DetailedScope(bool detailed)
+			: was_detailed_(MemoryTracker::Detailed())
+		{
+			MemoryTracker::Detailed(detailed);
+		}
+
+		~DetailedScope()
+		{
+			MemoryTracker::Detailed(was_detailed_);
+		}
+
+	private:
+		bool was_detailed_;
+	};
+}
+
+
+TEST_CASE(MemoryTracker, CountsCurrentAndPeak)
+{
+	//Totals are process wide, so everything is measured from where earlier tests left them
+	uint64_t base = MemoryTracker::CurrentBytes(MC_Texture);
+	int a, b;
+
+	MemoryTracker::Allocate(MC_Texture, 100, &a);
+	MemoryTracker::Allocate(MC_Texture, 50, &b);
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_Texture), base + 150);
+	CHECK(MemoryTracker::PeakBytes(MC_Texture) >= base + 150);
+
+	MemoryTracker::Free(MC_Texture, 100, &a);
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_Texture), base + 50);
+	uint64_t peak = MemoryTracker::PeakBytes(MC_Texture);
+	CHECK(peak >= base + 150);
+
+	MemoryTracker::Free(MC_Texture, 50, &b);
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_Texture), base);
+	CHECK_EQ(MemoryTracker::PeakBytes(MC_Texture), peak);
+
+	//Other categories are untouched
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_Staging), static_cast<uint64_t>(0));
+}
+
+TEST_CASE(MemoryTracker, ConcurrentAllocationsBalance)
+{
+	const uint32_t num_threads = 4;
+	const uint32_t per_thread = 5000;
+
+	DetailedScope detailed(true);
+	uint64_t base = MemoryTracker::CurrentBytes(MC_VertexBuffer);
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t != num_threads; t++)
+	{
+		threads.emplace_back([per_thread]()
+		{
+			std::vector<char> ids(64);
+			for (uint32_t i = 0; i != per_thread; i++)
+			{
+				const void* id = &ids[i % ids.size()];
+				MemoryTracker::Allocate(MC_VertexBuffer, 256, id);
+				MemoryTracker::Free(MC_VertexBuffer, 256, id);
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_VertexBuffer), base);
+	CHECK(MemoryTracker::PeakBytes(MC_VertexBuffer) >= base + 256);
+}
+
+TEST_CASE(MemoryTracker, ReportListsLiveAllocations)
+{
+	DetailedScope detailed(true);
+
+	std::ostringstream clean;
+	uint32_t leaks_before = MemoryTracker::ReportLeaks(clean);
+
+	int id;
+	MemoryTracker::Allocate(MC_Staging, 4096, &id);
+	std::ostringstream report;
+	CHECK_EQ(MemoryTracker::ReportLeaks(report), leaks_before + 1);
+	CHECK(report.str().find("Memory leak: Staging 4096 bytes still allocated") != std::string::npos);
+
+	std::ostringstream id_text;
+	id_text << "  Staging at " << static_cast<const void*>(&id) << ": 4096 bytes\n";
+	CHECK(report.str().find(id_text.str()) != std::string::npos);
+
+	MemoryTracker::Free(MC_Staging, 4096, &id);
+	std::ostringstream after;
+	CHECK_EQ(MemoryTracker::ReportLeaks(after), leaks_before);
+	CHECK_EQ(after.str(), clean.str());
+}
+
+TEST_CASE(MemoryTracker, SummaryModeSkipsRecords)
+{
+	DetailedScope detailed(false);
+	CHECK(!MemoryTracker::Detailed());
+
+	int id;
+	MemoryTracker::Allocate(MC_Staging, 64, &id);
+	std::ostringstream report;
+	MemoryTracker::ReportLeaks(report);
+	CHECK(report.str().find("Memory leak: Staging 64 bytes") != std::string::npos);
+	CHECK(report.str().find("  Staging at") == std::string::npos);
+	MemoryTracker::Free(MC_Staging, 64, &id);
+}
+
+TEST_CASE(MemoryTracker, TrackedPointersAndContainers)
+{
+	uint64_t base = MemoryTracker::CurrentBytes(MC_ConstantBuffer);
+	int releases = 0;
+	{
+		std::shared_ptr<FakeCOMObject> p = MakeTrackedCOMPtr(new FakeCOMObject(releases), MC_ConstantBuffer, 1024);
+		std::shared_ptr<FakeCOMObject> copy = p;
+		p.reset();
+		CHECK_EQ(MemoryTracker::CurrentBytes(MC_ConstantBuffer), base + 1024);
+		CHECK_EQ(releases, 0);
+	}
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_ConstantBuffer), base);
+	CHECK_EQ(releases, 1);
+
+	CHECK(!MakeTrackedCOMPtr<FakeCOMObject>(nullptr, MC_ConstantBuffer, 1024));
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_ConstantBuffer), base);
+
+	uint64_t heap_base = MemoryTracker::CurrentBytes(MC_CPUHeap);
+	{
+		std::vector<uint32_t, TrackedAllocator<uint32_t>> v;
+		v.reserve(1000);
+		CHECK_EQ(MemoryTracker::CurrentBytes(MC_CPUHeap), heap_base + 1000 * sizeof(uint32_t));
+	}
+	CHECK_EQ(MemoryTracker::CurrentBytes(MC_CPUHeap), heap_base);
+}
@@ -0,0 +1,313 @@
+#include "TestHarness.h"
+#include "BatchMath.h"
+#include "PostProcess.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const uint32_t WIDTH = 96;
+	const uint32_t HEIGHT = 54;
+	const uint32_t LUT_SIZE = 16;
+
+	std::vector<float> Constant(uint32_t width, uint32_t height, float value)
+	{
+		std::vector<float> image(width * height * 4, value);
+		for (size_t i = 3; i < image.size(); i += 4)
+		{
+			image[i] = 1;
+		}
+		return image;
+	}
+
+	//A dim gradient with a few bright discs
+	std::vector<float> TestImage()
+	{
+		std::vector<float> scene = Constant(WIDTH, HEIGHT, 0);
+		for (uint32_t y = 0; y != HEIGHT; y++)
+		{
+			for (uint32_t x = 0; x != WIDTH; x++)
+			{
+				float* t = &scene[(y * WIDTH + x) * 4];
+				float base = 0.1f + 0.4f * x / WIDTH;
+				t[0] = base;
+				t[1] = base * 0.9f;
+				t[2] = base * 0.8f;
+
+				for (uint32_t spot = 0; spot != 4; spot++)
+				{
+					float dx = x - WIDTH * (spot + 0.5f) / 4.0f;
+					float dy = y - HEIGHT * (0.3f + 0.1f * spot);
+					if (dx * dx + dy * dy < 9)
+					{
+						t[0] = t[1] = t[2] = 4;
+					}
+				}
+			}
+		}
+		return scene;
+	}
+
+	//rgb summed over the image
+	double Energy(const std::vector<float>& image)
+	{
+		double sum = 0;
+		for (size_t i = 0; i != image.size(); i++)
+		{
+			sum += ((i & 3) != 3) ? image[i] : 0;
+		}
+		return sum;
+	}
+
+	float MaxAbsDiff(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		float diff = 0;
+		for (size_t i = 0; i != a.size(); i++)
+		{
+			diff = (std::max)(diff, std::abs(a[i] - b[i]));
+		}
+		return diff;
+	}
+
+	//Bright pass, pyramid and composite with every stage on
+	std::vector<float> RunChain(const std::vector<float>& scene, const PostSettings& settings)
+	{
+		std::vector<float> lut(LUT_SIZE * LUT_SIZE * LUT_SIZE * 4);
+		BuildGradingLUT(settings, LUT_SIZE, lut.data());
+
+		std::vector<std::vector<float>> levels(settings.bloom_levels);
+		for (uint32_t l = 0; l != settings.bloom_levels; l++)
+		{
+			levels[l].resize(BloomTargetSize(WIDTH, l) * BloomTargetSize(HEIGHT, l) * 4);
+		}
+		BloomBrightPass(scene.data(), WIDTH, HEIGHT, settings.bloom_threshold, settings.bloom_knee,
+			levels[0].data(), BloomTargetSize(WIDTH, 0), BloomTargetSize(HEIGHT, 0));
+		for (uint32_t l = 1; l != settings.bloom_levels; l++)
+		{
+			BloomDownsample(levels[l - 1].data(), BloomTargetSize(WIDTH, l - 1), BloomTargetSize(HEIGHT, l - 1),
+				levels[l].data(), BloomTargetSize(WIDTH, l), BloomTargetSize(HEIGHT, l));
+		}
+		for (uint32_t l = settings.bloom_levels - 1; l > 0; l--)
+		{
+			BloomUpsample(levels[l].data(), BloomTargetSize(WIDTH, l), BloomTargetSize(HEIGHT, l),
+				levels[l - 1].data(), BloomTargetSize(WIDTH, l - 1), BloomTargetSize(HEIGHT, l - 1));
+		}
+
+		std::vector<float> out(WIDTH * HEIGHT * 4);
+		PostComposite(scene.data(), WIDTH, HEIGHT, levels[0].data(), BloomTargetSize(WIDTH, 0), BloomTargetSize(HEIGHT, 0),
+			settings, lut.data(), LUT_SIZE, out.data());
+		return out;
+	}
+
+	//Scalar and every SIMD level the kernels have, AVX2 taking the SSE2 path
+	template <typename F>
+	void AtEveryLevel(F check)
+	{
+		SIMDLevel detected = DetectSIMDLevel();
+		for (int level = SL_Scalar; level <= detected; level++)
+		{
+			ForceSIMDLevel(static_cast<SIMDLevel>(level));
+			check();
+		}
+		ForceSIMDLevel(detected);
+	}
+}
+
+
+TEST_CASE(PostProcess, DefaultsAreOff)
+{
+	PostSettings settings = DefaultPostSettings();
+	CHECK(!settings.bloom);
+	CHECK(!settings.color_grading);
+	CHECK_EQ(settings.vignette, 0.0f);
+	CHECK(settings.bloom_levels >= 1);
+	CHECK(settings.bloom_levels <= MAX_BLOOM_LEVELS);
+	CHECK(settings.bloom_knee > 0);
+}
+
+TEST_CASE(PostProcess, TargetSizeHalvesAndRoundsUp)
+{
+	CHECK_EQ(BloomTargetSize(1280, 0), 640u);
+	CHECK_EQ(BloomTargetSize(1281, 0), 641u);
+	CHECK_EQ(BloomTargetSize(1280, 1), 320u);
+	CHECK_EQ(BloomTargetSize(720, 4), 23u);
+	CHECK_EQ(BloomTargetSize(1, 0), 1u);
+	CHECK_EQ(BloomTargetSize(5, MAX_BLOOM_LEVELS - 1), 1u);
+}
+
+TEST_CASE(PostProcess, FiltersKeepFlatImagesFlat)
+{
+	AtEveryLevel([]()
+	{
+		//The taps' weights each add up to 1, so a constant passes through, the upsample adding it
+		std::vector<float> src = Constant(WIDTH, HEIGHT, 0.5f);
+		std::vector<float> dst = Constant(WIDTH / 2, HEIGHT / 2, 0);
+		BloomDownsample(src.data(), WIDTH, HEIGHT, dst.data(), WIDTH / 2, HEIGHT / 2);
+		CHECK(MaxAbsDiff(dst, Constant(WIDTH / 2, HEIGHT / 2, 0.5f)) < 1e-6f);
+
+		std::vector<float> up = Constant(WIDTH, HEIGHT, 0.25f);
+		BloomUpsample(dst.data(), WIDTH / 2, HEIGHT / 2, up.data(), WIDTH, HEIGHT);
+		std::vector<float> expected = Constant(WIDTH, HEIGHT, 0.75f);
+		for (size_t i = 3; i < expected.size(); i += 4)
+		{
+			expected[i] = 2;
+		}
+		CHECK(MaxAbsDiff(up, expected) < 1e-6f);
+	});
+}
+
+TEST_CASE(PostProcess, DownsampleKeepsEnergy)
+{
+	AtEveryLevel([]()
+	{
+		//A bright texel away from the edges spreads out but keeps its total, a quarter as many texels
+		//each covering four
+		std::vector<float> src = Constant(WIDTH, HEIGHT, 0);
+		float* t = &src[(20 * WIDTH + 30) * 4];
+		t[0] = t[1] = t[2] = 16;
+		std::vector<float> dst = Constant(WIDTH / 2, HEIGHT / 2, 0);
+		BloomDownsample(src.data(), WIDTH, HEIGHT, dst.data(), WIDTH / 2, HEIGHT / 2);
+		CHECK_NEAR(Energy(dst) * 4, Energy(src), 1e-3);
+	});
+}
+
+TEST_CASE(PostProcess, BrightPassThresholds)
+{
+	PostSettings settings = DefaultPostSettings();
+	const uint32_t bright_width = BloomTargetSize(WIDTH, 0);
+	const uint32_t bright_height = BloomTargetSize(HEIGHT, 0);
+
+	AtEveryLevel([&]()
+	{
+		//Below the knee nothing is kept
+		std::vector<float> bright(bright_width * bright_height * 4);
+		std::vector<float> dark = Constant(WIDTH, HEIGHT, settings.bloom_threshold - settings.bloom_knee - 0.01f);
+		BloomBrightPass(dark.data(), WIDTH, HEIGHT, settings.bloom_threshold, settings.bloom_knee, bright.data(), bright_width, bright_height);
+		CHECK_EQ(*std::max_element(bright.begin(), bright.end()), 0.0f);
+
+		//Above it, what's past the threshold
+		std::vector<float> lit = Constant(WIDTH, HEIGHT, 2);
+		BloomBrightPass(lit.data(), WIDTH, HEIGHT, settings.bloom_threshold, settings.bloom_knee, bright.data(), bright_width, bright_height);
+		CHECK_NEAR(bright[0], 2 - settings.bloom_threshold, 1e-5f);
+		CHECK_NEAR(bright[bright.size() - 4], 2 - settings.bloom_threshold, 1e-5f);
+
+		//Brightness goes by the largest channel, the color's hue is kept
+		std::vector<float> red = Constant(WIDTH, HEIGHT, 0);
+		for (size_t i = 0; i < red.size(); i += 4)
+		{
+			red[i] = 2;
+			red[i + 1] = 1;
+		}
+		BloomBrightPass(red.data(), WIDTH, HEIGHT, settings.bloom_threshold, settings.bloom_knee, bright.data(), bright_width, bright_height);
+		CHECK_NEAR(bright[0] / bright[1], 2.0f, 1e-5f);
+		CHECK_EQ(bright[2], 0.0f);
+	});
+}
+
+TEST_CASE(PostProcess, NeutralGradingIsIdentity)
+{
+	PostSettings settings = DefaultPostSettings();
+	settings.saturation = 1;
+	settings.contrast = 1;
+
+	std::vector<float> lut(LUT_SIZE * LUT_SIZE * LUT_SIZE * 4);
+	BuildGradingLUT(settings, LUT_SIZE, lut.data());
+	float max_diff = 0;
+	for (uint32_t b = 0; b != LUT_SIZE; b++)
+	{
+		for (uint32_t g = 0; g != LUT_SIZE; g++)
+		{
+			for (uint32_t r = 0; r != LUT_SIZE; r++)
+			{
+				const float* t = &lut[((b * LUT_SIZE + g) * LUT_SIZE + r) * 4];
+				const float expected[3] = { r / (LUT_SIZE - 1.0f), g / (LUT_SIZE - 1.0f), b / (LUT_SIZE - 1.0f) };
+				for (int c = 0; c != 3; c++)
+				{
+					max_diff = (std::max)(max_diff, std::abs(t[c] - expected[c]));
+				}
+				CHECK_EQ(t[3], 1.0f);
+			}
+		}
+	}
+	CHECK(max_diff < 1e-4f);
+
+	//And a greyscale one takes the saturation out
+	settings.saturation = 0;
+	BuildGradingLUT(settings, LUT_SIZE, lut.data());
+	const float* t = &lut[((3 * LUT_SIZE + 7) * LUT_SIZE + 15) * 4];
+	CHECK_NEAR(t[0], t[1], 1e-5f);
+	CHECK_NEAR(t[1], t[2], 1e-5f);
+}
+
+TEST_CASE(PostProcess, CompositeEncodesAndVignettes)
+{
+	PostSettings settings = DefaultPostSettings();
+	std::vector<float> scene = Constant(WIDTH, HEIGHT, 0.5f);
+	std::vector<float> out(WIDTH * HEIGHT * 4);
+
+	AtEveryLevel([&]()
+	{
+		//Only the sRGB encoding with everything off
+		PostComposite(scene.data(), WIDTH, HEIGHT, nullptr, 0, 0, settings, nullptr, 0, out.data());
+		CHECK_NEAR(out[0], 0.735357f, 1e-5f);
+		CHECK_EQ(out[3], 1.0f);
+		CHECK_EQ(MaxAbsDiff(out, Constant(WIDTH, HEIGHT, out[0])), 0.0f);
+
+		//Darker towards the corners, the center barely touched
+		PostSettings vignetted = settings;
+		vignetted.vignette = 0.5f;
+		PostComposite(scene.data(), WIDTH, HEIGHT, nullptr, 0, 0, vignetted, nullptr, 0, out.data());
+		float center = out[((HEIGHT / 2) * WIDTH + WIDTH / 2) * 4];
+		float corner = out[0];
+		CHECK_NEAR(center, 0.735357f, 1e-3f);
+		CHECK(corner < center - 0.1f);
+	});
+}
+
+TEST_CASE(PostProcess, BloomSpreadsBrightSpots)
+{
+	PostSettings settings = DefaultPostSettings();
+	settings.bloom = true;
+	std::vector<float> scene = TestImage();
+
+	PostSettings no_bloom = settings;
+	no_bloom.bloom_intensity = 0;
+	std::vector<float> plain = RunChain(scene, no_bloom);
+	std::vector<float> bloomed = RunChain(scene, settings);
+
+	//Brighter around the spots, nothing gets darker
+	size_t near_spot = ((HEIGHT * 3 / 10 + 5) * WIDTH + WIDTH / 8) * 4;
+	size_t far_corner = ((HEIGHT - 1) * WIDTH) * 4;
+	CHECK(bloomed[near_spot] > plain[near_spot] + 0.1f);
+	CHECK_NEAR(bloomed[far_corner], plain[far_corner], 0.05f);
+	bool never_darker = true;
+	for (size_t i = 0; i != plain.size(); i++)
+	{
+		never_darker &= (bloomed[i] >= plain[i] - 1e-6f);
+	}
+	CHECK(never_darker);
+}
+
+TEST_CASE(PostProcess, SameAtEverySIMDLevel)
+{
+	PostSettings settings = DefaultPostSettings();
+	settings.bloom = true;
+	settings.vignette = 0.5f;
+	settings.color_grading = true;
+	std::vector<float> scene = TestImage();
+
+	SIMDLevel detected = DetectSIMDLevel();
+	ForceSIMDLevel(SL_Scalar);
+	std::vector<float> reference = RunChain(scene, settings);
+	for (int level = SL_Scalar + 1; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+		CHECK(MaxAbsDiff(RunChain(scene, settings), reference) < 1e-5f);
+	}
+	ForceSIMDLevel(detected);
+}
@@ -0,0 +1,147 @@
+#include "TestHarness.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//What one timed scope may cost, clock reads and the push together; a frame records a few hundred
+	const double EVENT_BUDGET_NS = 1000;
+
+	const char* EVENT_NAMES[] = { "e0", "e1", "e2", "e3", "e4", "e5", "e6", "e7", "e8", "e9",
+		"e10", "e11", "e12", "e13", "e14", "e15", "e16", "e17", "e18", "e19" };
+}
+
+
+TEST_CASE(Profiler, ScopeRecordsOneEvent)
+{
+	TraceBuffer trace(64);
+	uint64_t before = TraceBuffer::NowNs();
+	{
+		CPUTimerScope timer(trace, "Scope");
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	uint64_t after = TraceBuffer::NowNs();
+
+	std::vector<TraceEvent> events;
+	trace.Snapshot(events);
+	REQUIRE(events.size() == 1);
+	CHECK(0 == strcmp(events[0].name, "Scope"));
+	CHECK(events[0].begin_ns >= before);
+	CHECK(events[0].end_ns <= after);
+	CHECK(events[0].end_ns - events[0].begin_ns >= 1000000u);
+	CHECK_EQ(events[0].thread, TraceBuffer::CurrentThread());
+	CHECK_EQ(events[0].track, static_cast<uint32_t>(TT_CPU));
+
+	trace.Clear();
+	trace.Snapshot(events);
+	CHECK(events.empty());
+}
+
+TEST_CASE(Profiler, RingKeepsNewestOldestFirst)
+{
+	//Rounded up to 8
+	TraceBuffer trace(5);
+	for (uint64_t i = 0; i != 20; i++)
+	{
+		trace.Push(EVENT_NAMES[i], i, i + 1);
+	}
+
+	std::vector<TraceEvent> events;
+	trace.Snapshot(events);
+	REQUIRE(events.size() == 8);
+	for (size_t i = 0; i != events.size(); i++)
+	{
+		CHECK(events[i].name == EVENT_NAMES[12 + i]);
+		CHECK_EQ(events[i].begin_ns, static_cast<uint64_t>(12 + i));
+	}
+}
+
+TEST_CASE(Profiler, ConcurrentWritersLoseNothing)
+{
+	const uint32_t num_threads = 4;
+	const uint32_t per_thread = 2000;
+
+	TraceBuffer trace(num_threads * per_thread);
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t != num_threads; t++)
+	{
+		threads.emplace_back([&trace, t, per_thread]()
+		{
+			for (uint32_t i = 0; i != per_thread; i++)
+			{
+				trace.Push(EVENT_NAMES[t], i, i);
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	std::vector<TraceEvent> events;
+	trace.Snapshot(events);
+	REQUIRE(events.size() == num_threads * per_thread);
+
+	//Every writer's events, each from one thread id that no other writer shares
+	std::vector<uint32_t> counts(num_threads, 0);
+	std::vector<uint32_t> ids(num_threads, ~0u);
+	bool one_id = true;
+	for (const auto& e : events)
+	{
+		uint32_t t = static_cast<uint32_t>(std::find(EVENT_NAMES, EVENT_NAMES + num_threads, e.name) - EVENT_NAMES);
+		REQUIRE(t < num_threads);
+		++counts[t];
+		one_id &= (ids[t] == ~0u) || (ids[t] == e.thread);
+		ids[t] = e.thread;
+	}
+	CHECK(one_id);
+	for (uint32_t t = 0; t != num_threads; t++)
+	{
+		CHECK_EQ(counts[t], per_thread);
+		CHECK_EQ(std::count(ids.begin(), ids.end(), ids[t]), static_cast<std::ptrdiff_t>(1));
+	}
+}
+
+TEST_CASE(Profiler, ChromeTraceFormat)
+{
+	std::vector<TraceEvent> events;
+	TraceEvent e = { "Pass \"A\"\\B", 1234567, 1334567, 3, TT_GPU };
+	events.push_back(e);
+
+	std::ostringstream ss;
+	WriteChromeTrace(ss, events);
+	std::string json = ss.str();
+
+	CHECK_EQ(json.find("{\"traceEvents\":["), static_cast<size_t>(0));
+	CHECK(json.find("\"name\":\"Pass \\\"A\\\"\\\\B\"") != std::string::npos);
+	CHECK(json.find("\"pid\":1,\"tid\":3,\"ts\":1234.5,\"dur\":100.0}") != std::string::npos);
+	CHECK(json.find("\"args\":{\"name\":\"GPU\"}") != std::string::npos);
+	CHECK(json.compare(json.size() - 4, 4, "\n]}\n") == 0);
+}
+
+TEST_CASE(Profiler, ScopeOverheadWithinBudget)
+{
+	const uint32_t num_events = 10000;
+	TraceBuffer trace(num_events);
+
+	//Best of a few rounds, a preempted round says nothing about the profiler
+	double best_ns = 1e30;
+	for (int round = 0; round != 5; round++)
+	{
+		uint64_t begin = TraceBuffer::NowNs();
+		for (uint32_t i = 0; i != num_events; i++)
+		{
+			CPUTimerScope timer(trace, "Overhead");
+		}
+		best_ns = (std::min)(best_ns, static_cast<double>(TraceBuffer::NowNs() - begin) / num_events);
+	}
+
+	CHECK(best_ns < EVENT_BUDGET_NS);
+}
@@ -0,0 +1,180 @@
+#include "TestHarness.h"
+#include "RenderStatistics.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//Counters are process wide, so a fresh instance first latches whatever earlier tests added
+	void Latch(RenderStatistics& stats)
+	{
+		stats.EndFrame();
+	}
+
+	size_t CountFields(const std::string& line)
+	{
+		return std::count(line.begin(), line.end(), ',') + 1;
+	}
+}
+
+
+TEST_CASE(RenderStatistics, FrameHoldsOnlyItsOwnCounts)
+{
+	RenderStatistics stats;
+	Latch(stats);
+	uint64_t first_frame = stats.FrameIndex();
+
+	RenderStatistics::Add(SC_Draws, 3);
+	RenderStatistics::Add(SC_Triangles, 120);
+	RenderStatistics::Add(SC_TextureBinds);
+	RenderStatistics::Add(SC_TextureBinds);
+	stats.EndFrame();
+	CHECK_EQ(stats.FrameIndex(), first_frame + 1);
+	CHECK_EQ(stats.Counter(SC_Draws), static_cast<uint64_t>(3));
+	CHECK_EQ(stats.Counter(SC_Triangles), static_cast<uint64_t>(120));
+	CHECK_EQ(stats.Counter(SC_TextureBinds), static_cast<uint64_t>(2));
+	CHECK_EQ(stats.Counter(SC_Dispatches), static_cast<uint64_t>(0));
+
+	//Nothing carries into the next frame
+	stats.EndFrame();
+	for (int i = 0; i != SC_NumCounters; i++)
+	{
+		CHECK_EQ(stats.Counter(static_cast<StatCounter>(i)), static_cast<uint64_t>(0));
+	}
+}
+
+TEST_CASE(RenderStatistics, ExitedThreadsStillCount)
+{
+	const uint32_t num_threads = 4;
+	const uint32_t per_thread = 1000;
+
+	RenderStatistics stats;
+	Latch(stats);
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t != num_threads; t++)
+	{
+		threads.emplace_back([per_thread]()
+		{
+			for (uint32_t i = 0; i != per_thread; i++)
+			{
+				RenderStatistics::Add(SC_Draws);
+				RenderStatistics::Add(SC_Triangles, 2);
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	stats.EndFrame();
+	CHECK_EQ(stats.Counter(SC_Draws), static_cast<uint64_t>(num_threads * per_thread));
+	CHECK_EQ(stats.Counter(SC_Triangles), static_cast<uint64_t>(num_threads * per_thread * 2));
+
+	//The finished threads' blocks stay summed, so the next frame doesn't go negative
+	stats.EndFrame();
+	CHECK_EQ(stats.Counter(SC_Draws), static_cast<uint64_t>(0));
+}
+
+TEST_CASE(RenderStatistics, FramesEndingDuringAddsLoseNothing)
+{
+	const uint32_t num_threads = 3;
+
+	RenderStatistics stats;
+	Latch(stats);
+
+	//Writers keep adding until told to stop, each counting what it added
+	std::atomic<uint32_t> started(0);
+	std::atomic<bool> stop(false);
+	std::vector<uint64_t> added(num_threads, 0);
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t != num_threads; t++)
+	{
+		threads.emplace_back([&started, &stop, &added, t]()
+		{
+			RenderStatistics::Add(SC_StateChanges);
+			added[t] = 1;
+			started.fetch_add(1);
+			while (!stop.load())
+			{
+				RenderStatistics::Add(SC_StateChanges);
+				++added[t];
+			}
+		});
+	}
+
+	//Every add lands in exactly one frame
+	uint64_t sum = 0;
+	while (started.load() != num_threads)
+	{
+		std::this_thread::yield();
+	}
+	for (int f = 0; f != 200; f++)
+	{
+		stats.EndFrame();
+		sum += stats.Counter(SC_StateChanges);
+		std::this_thread::yield();
+	}
+	stop.store(true);
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	stats.EndFrame();
+	sum += stats.Counter(SC_StateChanges);
+
+	uint64_t expected = 0;
+	for (uint64_t n : added)
+	{
+		expected += n;
+	}
+	CHECK_EQ(sum, expected);
+}
+
+TEST_CASE(RenderStatistics, CsvAndSummary)
+{
+	std::set<std::string> names;
+	for (int i = 0; i != SC_NumCounters; i++)
+	{
+		const char* name = RenderStatistics::CounterName(static_cast<StatCounter>(i));
+		REQUIRE(name != nullptr);
+		CHECK(strlen(name) > 0);
+		CHECK(strchr(name, ',') == nullptr);
+		names.insert(name);
+	}
+	CHECK_EQ(names.size(), static_cast<size_t>(SC_NumCounters));
+
+	RenderStatistics stats;
+	Latch(stats);
+	RenderStatistics::Add(SC_Draws, 7);
+	RenderStatistics::Add(SC_ShadowCasterDraws, 5);
+	stats.EndFrame();
+
+	std::ostringstream header;
+	stats.WriteCsvHeader(header);
+	std::ostringstream row;
+	stats.WriteCsvRow(row);
+
+	//One column per counter after the frame index, in enum order
+	CHECK_EQ(header.str().find("frame,draws,"), static_cast<size_t>(0));
+	CHECK_EQ(CountFields(header.str()), static_cast<size_t>(SC_NumCounters + 1));
+	CHECK_EQ(CountFields(row.str()), static_cast<size_t>(SC_NumCounters + 1));
+	std::ostringstream expected_start;
+	expected_start << stats.FrameIndex() << ",7,0,";
+	CHECK_EQ(row.str().find(expected_start.str()), static_cast<size_t>(0));
+	CHECK(row.str().back() == '\n');
+
+	std::string summary = stats.Summary();
+	CHECK(summary.find("Draws: 7 ") != std::string::npos);
+	CHECK(summary.find("(5 casters)") != std::string::npos);
+}
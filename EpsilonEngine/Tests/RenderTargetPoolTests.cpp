@@ -0,0 +1,231 @@
+#include "TestHarness.h"
+#include "RenderTargetPool.h"
+#include <functional>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const int FORMAT_COLOR = 28;
+	const int FORMAT_DEPTH = 40;
+	const uint32_t BIND_RT = 0x20;
+	const uint32_t BIND_DS = 0x40;
+
+	//Hands out increasing ids as textures and remembers what it was asked to create
+	struct Creator
+	{
+		Creator()
+			: next_id(1)
+		{
+		}
+
+		int operator()(const RenderTargetKey& key)
+		{
+			last_key = key;
+			return next_id++;
+		}
+
+		int next_id;
+		RenderTargetKey last_key;
+	};
+
+	//Reallocates the way RenderEngine::Resize does for the G-buffer, returns the number of reallocations
+	uint32_t FollowSizes(const std::vector<uint32_t>& sizes, uint32_t& allocated)
+	{
+		uint32_t num_allocations = 0;
+		for (uint32_t needed : sizes)
+		{
+			if ((0 == allocated) || !RenderTargetCovers(allocated, needed))
+			{
+				allocated = RenderTargetSizeClass(needed);
+				++num_allocations;
+			}
+		}
+		return num_allocations;
+	}
+}
+
+
+TEST_CASE(RenderTargetPool, SizeClassRoundsUpToSteps)
+{
+	CHECK_EQ(RenderTargetSizeClass(0), RENDER_TARGET_SIZE_STEP);
+	CHECK_EQ(RenderTargetSizeClass(1), RENDER_TARGET_SIZE_STEP);
+	CHECK_EQ(RenderTargetSizeClass(128), 128u);
+	CHECK_EQ(RenderTargetSizeClass(129), 256u);
+	CHECK_EQ(RenderTargetSizeClass(1080), 1152u);
+	CHECK_EQ(RenderTargetSizeClass(1920), 1920u);
+}
+
+TEST_CASE(RenderTargetPool, CoversWithinHysteresisBand)
+{
+	CHECK(RenderTargetCovers(1024, 1024));
+	CHECK(RenderTargetCovers(1024, 900));
+	CHECK(RenderTargetCovers(1024, 513));
+
+	//Growing past the allocation, or shrinking to half of it, reallocates
+	CHECK(!RenderTargetCovers(1024, 1025));
+	CHECK(!RenderTargetCovers(1024, 512));
+	CHECK(!RenderTargetCovers(1024, 100));
+
+	//Every covered size fits and wastes less than half the allocation
+	for (uint32_t allocated = 128; allocated <= 4096; allocated += 128)
+	{
+		for (uint32_t needed = 1; needed <= 4096; needed++)
+		{
+			if (RenderTargetCovers(allocated, needed))
+			{
+				CHECK(needed <= allocated);
+				CHECK(allocated < RenderTargetSizeClass(needed) * 2);
+			}
+		}
+
+		//A size class is always covered by its own allocation
+		CHECK(RenderTargetCovers(allocated, allocated));
+	}
+}
+
+TEST_CASE(RenderTargetPool, DraggedWindowRarelyReallocates)
+{
+	//A window edge dragged a pixel at a time from 1920 down to 1000 and back, then jittering around 1300
+	std::vector<uint32_t> sizes;
+	for (uint32_t w = 1920; w >= 1000; w--)
+	{
+		sizes.push_back(w);
+	}
+	for (uint32_t w = 1000; w <= 1920; w++)
+	{
+		sizes.push_back(w);
+	}
+	Random rng(36);
+	for (int i = 0; i != 1000; i++)
+	{
+		sizes.push_back(1300 + rng.Next() % 64 - 32);
+	}
+
+	uint32_t allocated = 0;
+	CHECK_EQ(FollowSizes(sizes, allocated), 1u);
+	CHECK_EQ(allocated, 1920u);
+
+	//Shrinking to under half reallocates once, and the smaller target then serves the jitter
+	sizes.clear();
+	for (uint32_t w = 1920; w >= 700; w--)
+	{
+		sizes.push_back(w);
+	}
+	for (int i = 0; i != 1000; i++)
+	{
+		sizes.push_back(800 + rng.Next() % 64 - 32);
+	}
+	CHECK_EQ(FollowSizes(sizes, allocated), 1u);
+	CHECK_EQ(allocated, 896u);
+
+	//Growing reallocates once per size step it crosses
+	sizes.clear();
+	for (uint32_t w = 896; w <= 1920; w++)
+	{
+		sizes.push_back(w);
+	}
+	CHECK_EQ(FollowSizes(sizes, allocated), (1920u - 896u) / RENDER_TARGET_SIZE_STEP);
+	CHECK_EQ(allocated, 1920u);
+}
+
+TEST_CASE(RenderTargetPool, ReleasedTargetsAreReused)
+{
+	RenderTargetPool<int> pool;
+	Creator create;
+
+	int a = pool.Acquire(FORMAT_COLOR, 1000, 700, BIND_RT, std::ref(create));
+	CHECK_EQ(create.last_key.width, 1024u);
+	CHECK_EQ(create.last_key.height, 768u);
+	CHECK_EQ(pool.NumInUse(), static_cast<size_t>(1));
+	pool.Release(a);
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(1));
+	CHECK_EQ(pool.NumInUse(), static_cast<size_t>(0));
+
+	//Same size class reuses it
+	int b = pool.Acquire(FORMAT_COLOR, 1020, 705, BIND_RT, std::ref(create));
+	CHECK_EQ(b, a);
+	CHECK_EQ(pool.NumCreated(), static_cast<uint64_t>(1));
+
+	//Format, bind flags and size class all have to match
+	int c = pool.Acquire(FORMAT_DEPTH, 1020, 705, BIND_DS, std::ref(create));
+	int d = pool.Acquire(FORMAT_COLOR, 1020, 705, BIND_RT, std::ref(create));
+	int e = pool.Acquire(FORMAT_COLOR, 1100, 705, BIND_RT, std::ref(create));
+	CHECK(c != a);
+	CHECK(d != a);
+	CHECK(e != d);
+	CHECK_EQ(pool.NumCreated(), static_cast<uint64_t>(4));
+	CHECK_EQ(pool.NumInUse(), static_cast<size_t>(4));
+
+	//Releasing something the pool never handed out is ignored
+	pool.Release(12345);
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(0));
+
+	pool.Clear();
+	CHECK_EQ(pool.NumInUse(), static_cast<size_t>(0));
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(0));
+}
+
+TEST_CASE(RenderTargetPool, TrimKeepsIdleTargetsForAWhile)
+{
+	const uint64_t max_idle = 4;
+
+	RenderTargetPool<int> pool;
+	Creator create;
+
+	int a = pool.Acquire(FORMAT_COLOR, 800, 600, BIND_RT, std::ref(create));
+	pool.Release(a);
+	for (uint64_t f = 0; f != max_idle; f++)
+	{
+		pool.Trim(max_idle);
+	}
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(1));
+	pool.Trim(max_idle);
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(0));
+
+	//Targets in use are never trimmed
+	int b = pool.Acquire(FORMAT_COLOR, 800, 600, BIND_RT, std::ref(create));
+	for (uint64_t f = 0; f != max_idle * 4; f++)
+	{
+		pool.Trim(max_idle);
+	}
+	CHECK_EQ(pool.NumInUse(), static_cast<size_t>(1));
+
+	//The idle clock starts at release, not at acquire
+	pool.Release(b);
+	pool.Trim(max_idle);
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(1));
+}
+
+TEST_CASE(RenderTargetPool, ResizingBackAndForthHitsThePool)
+{
+	const uint64_t max_idle = 8;
+
+	RenderTargetPool<int> pool;
+	Creator create;
+
+	//Toggling between two sizes every few frames, faster than the idle limit
+	int current = pool.Acquire(FORMAT_COLOR, 1920, 1080, BIND_RT, std::ref(create));
+	for (int f = 0; f != 200; f++)
+	{
+		if (f % 5 == 0)
+		{
+			pool.Release(current);
+			bool small = (f / 5) % 2 == 0;
+			current = pool.Acquire(FORMAT_COLOR, small ? 1280 : 1920, small ? 720 : 1080, BIND_RT, std::ref(create));
+		}
+		pool.Trim(max_idle);
+	}
+	CHECK_EQ(pool.NumCreated(), static_cast<uint64_t>(2));
+
+	//Staying at one size lets the other age out
+	for (uint64_t f = 0; f != max_idle + 1; f++)
+	{
+		pool.Trim(max_idle);
+	}
+	CHECK_EQ(pool.NumFree(), static_cast<size_t>(0));
+	CHECK_EQ(pool.NumInUse(), static_cast<size_t>(1));
+}
@@ -0,0 +1,202 @@
+#include "TestHarness.h"
+#include "RingAllocator.h"
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//A copy, so comparisons don't need the class member defined out of line
+	const uint64_t INVALID = RingAllocator::INVALID_OFFSET;
+
+	struct LiveAllocation
+	{
+		uint64_t fence;
+		uint64_t offset;
+		uint64_t size;
+	};
+}
+
+
+TEST_CASE(RingAllocator, WrapsOnceFramesComplete)
+{
+	RingAllocator ring(1024);
+	CHECK_EQ(ring.Allocate(300, 256), static_cast<uint64_t>(0));
+	CHECK_EQ(ring.Allocate(300, 256), static_cast<uint64_t>(512));
+	CHECK_EQ(ring.FrameBytes(), static_cast<uint64_t>(600));
+	ring.FinishFrame(1);
+	CHECK_EQ(ring.FrameBytes(), static_cast<uint64_t>(0));
+
+	//Neither the end of the buffer nor the front is free while frame 1 is in flight
+	CHECK_EQ(ring.Allocate(300, 256), INVALID);
+	ring.ReleaseCompleted(0);
+	CHECK_EQ(ring.Allocate(300, 256), INVALID);
+
+	ring.ReleaseCompleted(1);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(0));
+	CHECK_EQ(ring.Allocate(300, 256), static_cast<uint64_t>(0));
+	CHECK_EQ(ring.Allocate(300, 256), static_cast<uint64_t>(512));
+	ring.FinishFrame(2);
+
+	//What doesn't fit before the end has to wait for the front to be read
+	CHECK_EQ(ring.Allocate(100, 16), static_cast<uint64_t>(816));
+	ring.FinishFrame(3);
+	CHECK_EQ(ring.Allocate(150, 16), INVALID);
+	ring.ReleaseCompleted(2);
+	CHECK_EQ(ring.Allocate(150, 16), static_cast<uint64_t>(0));
+
+	//Padding, and the end skipped when wrapping, count as used until their frames complete
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(104 + 108 + 150));
+	ring.FinishFrame(4);
+	ring.ReleaseCompleted(4);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(0));
+}
+
+TEST_CASE(RingAllocator, RejectsWhatCanNeverFit)
+{
+	RingAllocator ring(1024);
+	CHECK_EQ(ring.Allocate(0, 16), INVALID);
+	CHECK_EQ(ring.Allocate(1025, 16), INVALID);
+	CHECK_EQ(ring.Allocate(1024, 16), static_cast<uint64_t>(0));
+	CHECK_EQ(ring.Allocate(1, 1), INVALID);
+
+	RingAllocator empty;
+	CHECK_EQ(empty.Size(), static_cast<uint64_t>(0));
+	CHECK_EQ(empty.Allocate(1, 1), INVALID);
+
+	//Reset forgets everything in flight, and can take a new size
+	ring.FinishFrame(1);
+	ring.Reset(2048);
+	CHECK_EQ(ring.Size(), static_cast<uint64_t>(2048));
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(0));
+	CHECK_EQ(ring.Allocate(2048, 256), static_cast<uint64_t>(0));
+}
+
+TEST_CASE(RingAllocator, AlignmentPaddingIsAccounted)
+{
+	RingAllocator ring(4096);
+	CHECK_EQ(ring.Allocate(10, 1), static_cast<uint64_t>(0));
+	CHECK_EQ(ring.Allocate(10, 64), static_cast<uint64_t>(64));
+	CHECK_EQ(ring.Allocate(10, 256), static_cast<uint64_t>(256));
+	CHECK_EQ(ring.FrameBytes(), static_cast<uint64_t>(30));
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(266));
+}
+
+TEST_CASE(RingAllocator, FencesReleaseInOrder)
+{
+	RingAllocator ring(1000);
+	for (uint64_t fence = 1; fence <= 4; fence++)
+	{
+		CHECK(ring.Allocate(200, 8) != INVALID);
+		ring.FinishFrame(fence);
+	}
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(800));
+
+	//One completed fence releases every frame up to it
+	ring.ReleaseCompleted(2);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(400));
+	ring.ReleaseCompleted(2);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(400));
+	ring.ReleaseCompleted(10);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(0));
+
+	//More frames in flight than the marks ring starts with
+	for (uint64_t fence = 11; fence <= 40; fence++)
+	{
+		CHECK(ring.Allocate(10, 8) != INVALID);
+		ring.FinishFrame(fence);
+	}
+	ring.ReleaseCompleted(25);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(15 * 16));
+	ring.ReleaseCompleted(40);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(0));
+}
+
+TEST_CASE(RingAllocator, EmptyFramesDontMoveTheTail)
+{
+	RingAllocator ring(1024);
+	CHECK_EQ(ring.Allocate(600, 8), static_cast<uint64_t>(0));
+	ring.FinishFrame(1);
+
+	//A frame with nothing in it, finished while head was at 600
+	ring.FinishFrame(2);
+	ring.ReleaseCompleted(1);
+
+	//Nothing in flight, so this restarts at the front
+	CHECK_EQ(ring.Allocate(600, 8), static_cast<uint64_t>(0));
+	ring.FinishFrame(3);
+
+	//Releasing the empty frame must not free the space frame 3 is still using
+	ring.ReleaseCompleted(2);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(600));
+	CHECK_EQ(ring.Allocate(600, 8), INVALID);
+	CHECK_EQ(ring.Allocate(400, 8), static_cast<uint64_t>(600));
+}
+
+TEST_CASE(RingAllocator, LiveAllocationsNeverOverlap)
+{
+	const uint64_t frames_in_flight = 2;
+
+	RingAllocator ring(1 << 16);
+	Random rng(40);
+	std::vector<LiveAllocation> live;
+	uint64_t fence = 0;
+	uint32_t num_allocated = 0;
+	uint32_t num_failed = 0;
+	bool disjoint = true;
+	bool in_range = true;
+
+	for (int f = 0; f != 3000; f++)
+	{
+		uint32_t n = rng.Next() % 40;
+		for (uint32_t i = 0; i != n; i++)
+		{
+			uint64_t size = 1 + rng.Next() % 1500;
+			uint64_t alignment = 1ULL << (rng.Next() % 9);
+			uint64_t offset = ring.Allocate(size, alignment);
+			if (INVALID == offset)
+			{
+				++num_failed;
+				continue;
+			}
+			++num_allocated;
+
+			in_range &= (offset % alignment == 0) && (offset + size <= ring.Size());
+			for (const auto& l : live)
+			{
+				disjoint &= (offset + size <= l.offset) || (l.offset + l.size <= offset);
+			}
+			LiveAllocation a = { fence + 1, offset, size };
+			live.push_back(a);
+		}
+		ring.FinishFrame(++fence);
+
+		if (fence > frames_in_flight)
+		{
+			uint64_t completed = fence - frames_in_flight;
+			ring.ReleaseCompleted(completed);
+
+			std::vector<LiveAllocation> still_live;
+			for (const auto& l : live)
+			{
+				if (l.fence > completed)
+				{
+					still_live.push_back(l);
+				}
+			}
+			live.swap(still_live);
+		}
+		CHECK(ring.UsedBytes() <= ring.Size());
+	}
+	CHECK(disjoint);
+	CHECK(in_range);
+
+	//Sized so most allocations fit and some have to wait
+	CHECK(num_allocated > num_failed * 10);
+	CHECK(num_failed > 0);
+
+	ring.ReleaseCompleted(fence);
+	CHECK_EQ(ring.UsedBytes(), static_cast<uint64_t>(0));
+}
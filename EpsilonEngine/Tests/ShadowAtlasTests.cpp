@@ -0,0 +1,277 @@
+#include "TestHarness.h"
+#include "ShadowAtlas.h"
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const uint32_t ATLAS_SIZE = 1024;
+	const uint32_t MIN_PAGE_SIZE = 128;
+	const uint32_t MAX_PAGE_SIZE = 512;
+
+	bool Overlap(const ShadowPage& a, const ShadowPage& b)
+	{
+		return (a.x < b.x + b.size) && (b.x < a.x + a.size) && (a.y < b.y + b.size) && (b.y < a.y + a.size);
+	}
+
+	uint64_t Area(uint32_t size)
+	{
+		return static_cast<uint64_t>(size) * size;
+	}
+}
+
+
+TEST_CASE(ShadowAtlas, AllocateFreeAndMergeBuddies)
+{
+	ShadowAtlasPacker packer(ATLAS_SIZE, MIN_PAGE_SIZE);
+	CHECK_EQ(packer.FreeArea(), Area(ATLAS_SIZE));
+
+	//Sizes round up to a power of two within the limits
+	ShadowPage page;
+	REQUIRE(packer.Allocate(200, page));
+	CHECK_EQ(page.size, 256u);
+	CHECK_EQ(packer.FreeArea(), Area(ATLAS_SIZE) - Area(256));
+	ShadowPage tiny;
+	REQUIRE(packer.Allocate(1, tiny));
+	CHECK_EQ(tiny.size, MIN_PAGE_SIZE);
+	CHECK(!Overlap(page, tiny));
+
+	//Freed, the buddies merge back into the whole atlas
+	packer.Free(page);
+	packer.Free(tiny);
+	CHECK_EQ(packer.FreeArea(), Area(ATLAS_SIZE));
+	ShadowPage whole;
+	REQUIRE(packer.Allocate(ATLAS_SIZE * 2, whole));
+	CHECK_EQ(whole.size, ATLAS_SIZE);
+	CHECK(!packer.Allocate(MIN_PAGE_SIZE, page));
+	packer.Free(whole);
+
+	//Four quarters fill it, and only the last of them freed makes the whole free again
+	ShadowPage quarters[4];
+	for (auto& q : quarters)
+	{
+		REQUIRE(packer.Allocate(ATLAS_SIZE / 2, q));
+	}
+	CHECK_EQ(packer.FreeArea(), 0u);
+	for (int i = 0; i != 3; i++)
+	{
+		packer.Free(quarters[i]);
+		CHECK(!packer.Allocate(ATLAS_SIZE, whole));
+	}
+	packer.Free(quarters[3]);
+	CHECK(packer.Allocate(ATLAS_SIZE, whole));
+}
+
+TEST_CASE(ShadowAtlas, FragmentedAtlasServesSmallPagesOnly)
+{
+	ShadowAtlasPacker packer(ATLAS_SIZE, MIN_PAGE_SIZE);
+
+	//Every 256 page, then one of each 2x2 block freed: half the atlas is free but no 512 page is
+	std::vector<ShadowPage> pages(16);
+	for (auto& p : pages)
+	{
+		REQUIRE(packer.Allocate(256, p));
+	}
+	for (size_t i = 0; i != pages.size(); i++)
+	{
+		for (size_t j = i + 1; j != pages.size(); j++)
+		{
+			CHECK(!Overlap(pages[i], pages[j]));
+		}
+	}
+
+	std::vector<ShadowPage> kept;
+	for (const auto& p : pages)
+	{
+		if (((p.x / 256) & 1) == ((p.y / 256) & 1))
+		{
+			packer.Free(p);
+		}
+		else
+		{
+			kept.push_back(p);
+		}
+	}
+	CHECK_EQ(packer.FreeArea(), Area(ATLAS_SIZE) / 2);
+
+	ShadowPage page;
+	CHECK(!packer.Allocate(512, page));
+	REQUIRE(packer.Allocate(256, page));
+	for (const auto& k : kept)
+	{
+		CHECK(!Overlap(page, k));
+	}
+
+	//Random churn never hands out overlapping pages
+	packer.Reset(ATLAS_SIZE, MIN_PAGE_SIZE);
+	Random rnd(11);
+	std::vector<ShadowPage> live;
+	for (int step = 0; step != 500; step++)
+	{
+		if (!live.empty() && (rnd.Next() % 3 == 0))
+		{
+			size_t i = rnd.Next() % live.size();
+			packer.Free(live[i]);
+			live[i] = live.back();
+			live.pop_back();
+		}
+		else if (packer.Allocate(MIN_PAGE_SIZE << (rnd.Next() % 3), page))
+		{
+			for (const auto& p : live)
+			{
+				REQUIRE(!Overlap(page, p));
+			}
+			live.push_back(page);
+		}
+	}
+	uint64_t live_area = 0;
+	for (const auto& p : live)
+	{
+		live_area += Area(p.size);
+		packer.Free(p);
+	}
+	CHECK(live_area > 0);
+	CHECK_EQ(packer.FreeArea(), Area(ATLAS_SIZE));
+}
+
+TEST_CASE(ShadowAtlas, PageSizeHysteresis)
+{
+	//Without a page the ideal size rounds up, clamped to the limits
+	CHECK_EQ(ShadowPageSize(200, 0, MIN_PAGE_SIZE, MAX_PAGE_SIZE), 256u);
+	CHECK_EQ(ShadowPageSize(10, 0, MIN_PAGE_SIZE, MAX_PAGE_SIZE), MIN_PAGE_SIZE);
+	CHECK_EQ(ShadowPageSize(1e6f, 0, MIN_PAGE_SIZE, MAX_PAGE_SIZE), MAX_PAGE_SIZE);
+
+	//A 256 page grows only once the ideal passes 1.25 x 256 = 320, and shrinks once it is under 128 / 1.25 = 102.4
+	CHECK_EQ(ShadowPageSize(300, 256, MIN_PAGE_SIZE, MAX_PAGE_SIZE), 256u);
+	CHECK_EQ(ShadowPageSize(319, 256, MIN_PAGE_SIZE, MAX_PAGE_SIZE), 256u);
+	CHECK_EQ(ShadowPageSize(321, 256, MIN_PAGE_SIZE, MAX_PAGE_SIZE), 512u);
+	CHECK_EQ(ShadowPageSize(110, 256, MIN_PAGE_SIZE, MAX_PAGE_SIZE), 256u);
+	CHECK_EQ(ShadowPageSize(100, 512, MIN_PAGE_SIZE, MAX_PAGE_SIZE), 128u);
+
+	//An ideal hovering around a boundary keeps the page
+	uint32_t size = ShadowPageSize(250, 0, MIN_PAGE_SIZE, MAX_PAGE_SIZE);
+	uint32_t changes = 0;
+	for (int frame = 0; frame != 100; frame++)
+	{
+		float ideal = 256 + std::sin(frame * 0.7f) * 50;
+		uint32_t next = ShadowPageSize(ideal, size, MIN_PAGE_SIZE, MAX_PAGE_SIZE);
+		changes += (next != size) ? 1 : 0;
+		size = next;
+	}
+	CHECK_EQ(changes, 0u);
+	CHECK_EQ(size, 256u);
+}
+
+TEST_CASE(ShadowAtlas, SpotLightSphereBoundsTheCone)
+{
+	const float pos[3] = { 1, 2, 3 };
+	const float dir[3] = { 0, -1, 0 };
+	const float range = 10;
+	for (float half_angle : { 0.2f, 0.6f, 0.785f, 0.8f, 1.2f })
+	{
+		float center[3];
+		float radius;
+		SpotLightBoundingSphere(pos, dir, range, half_angle, center, radius);
+
+		//The apex, and the rim and axis end of the cone's spherical cap at range
+		bool inside = true;
+		auto check = [&](float px, float py, float pz)
+		{
+			float d = std::sqrt((px - center[0]) * (px - center[0]) + (py - center[1]) * (py - center[1]) + (pz - center[2]) * (pz - center[2]));
+			inside &= d <= radius * 1.0001f;
+		};
+		check(pos[0], pos[1], pos[2]);
+		for (int i = 0; i != 16; i++)
+		{
+			float phi = i * 0.3926991f;
+			float s = std::sin(half_angle) * range;
+			float c = std::cos(half_angle) * range;
+			check(pos[0] + s * std::cos(phi), pos[1] - c, pos[2] + s * std::sin(phi));
+		}
+		check(pos[0], pos[1] - range * std::cos(half_angle), pos[2]);
+		CHECK(inside);
+		CHECK(radius <= range);
+	}
+}
+
+TEST_CASE(ShadowAtlas, CacheRendersOnlyWhatChanged)
+{
+	ShadowCache cache;
+	cache.Reset(ATLAS_SIZE, MIN_PAGE_SIZE);
+
+	//First sight renders, the same hashes then hit the cache
+	ShadowPage page;
+	cache.BeginFrame();
+	CHECK(cache.Update(0, 1, 2, 256, page));
+	CHECK_EQ(page.size, 256u);
+	ShadowPage first = page;
+	for (int frame = 0; frame != 5; frame++)
+	{
+		cache.BeginFrame();
+		CHECK(!cache.Update(0, 1, 2, 256, page));
+		CHECK_EQ(page.x, first.x);
+		CHECK_EQ(page.y, first.y);
+	}
+	CHECK_EQ(cache.NumRenders(), 1u);
+
+	//A moved light, a moved caster or a new size renders again
+	cache.BeginFrame();
+	CHECK(cache.Update(0, 3, 2, 256, page));
+	cache.BeginFrame();
+	CHECK(cache.Update(0, 3, 4, 256, page));
+	cache.BeginFrame();
+	CHECK(cache.Update(0, 3, 4, 512, page));
+	CHECK_EQ(page.size, 512u);
+	CHECK_EQ(cache.PageSize(0), 512u);
+
+	//Keep reuses the page unchecked, but only once it was rendered
+	ShadowPage kept;
+	CHECK(cache.Keep(0, kept));
+	CHECK_EQ(kept.x, page.x);
+	CHECK(!cache.Keep(1, kept));
+
+	//Everything renders again after an invalidate
+	cache.Invalidate();
+	CHECK(!cache.Keep(0, kept));
+	cache.BeginFrame();
+	CHECK(cache.Update(0, 3, 4, 512, page));
+	CHECK_EQ(cache.NumRenders(), 5u);
+
+	//A full atlas gives smaller pages rather than none
+	cache.BeginFrame();
+	ShadowPage big;
+	CHECK(cache.Update(1, 1, 1, 1024, big));
+	CHECK_EQ(big.size, 512u);
+}
+
+TEST_CASE(ShadowAtlas, TrimEvictsIdlePages)
+{
+	ShadowCache cache;
+	cache.Reset(ATLAS_SIZE, MIN_PAGE_SIZE);
+
+	ShadowPage page;
+	cache.BeginFrame();
+	cache.Update(0, 1, 1, 512, page);
+	cache.Update(1, 1, 1, 512, page);
+	CHECK_EQ(cache.Packer().FreeArea(), Area(ATLAS_SIZE) - 2 * Area(512));
+
+	//Light 1 stays in use, light 0 goes idle and is evicted past the limit
+	for (int frame = 0; frame != 10; frame++)
+	{
+		cache.BeginFrame();
+		cache.Update(1, 1, 1, 512, page);
+		cache.Trim(5);
+	}
+	CHECK_EQ(cache.Packer().FreeArea(), Area(ATLAS_SIZE) - Area(512));
+	CHECK_EQ(cache.PageSize(0), 0u);
+	CHECK_EQ(cache.PageSize(1), 512u);
+
+	//Evicted, it renders again when it comes back
+	cache.BeginFrame();
+	CHECK(cache.Update(0, 1, 1, 512, page));
+	CHECK_EQ(page.size, 512u);
+}
@@ -0,0 +1,190 @@
+#include "TestHarness.h"
+#include "TemporalAA.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	const float PROJ_X = 1.5f;
+	const float PROJ_Y = 2;
+	const float NEAR_PLANE = 0.1f;
+	const float FAR_PLANE = 100;
+
+	//View to clip, row-major for row vectors, shifted by a number of pixels of a viewport width wide
+	void Projection(float shift_pixels, uint32_t width, float m[16])
+	{
+		std::fill(m, m + 16, 0.0f);
+		m[0] = PROJ_X;
+		m[5] = PROJ_Y;
+		m[10] = FAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+		m[11] = 1;
+		m[14] = -NEAR_PLANE * FAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+
+		//clip x += shift in NDC times w, w being view z
+		m[8] += shift_pixels * 2 / width;
+	}
+
+	std::vector<float> Gray(const std::vector<float>& values)
+	{
+		std::vector<float> image;
+		for (float v : values)
+		{
+			image.insert(image.end(), 3, v);
+		}
+		return image;
+	}
+}
+
+
+TEST_CASE(TemporalAA, HaltonJitterSequence)
+{
+	//Halton (2, 3) from index 1, centered on the pixel
+	const float expected[4][2] =
+	{
+		{ 0.5f - 0.5f, 1 / 3.0f - 0.5f },
+		{ 0.25f - 0.5f, 2 / 3.0f - 0.5f },
+		{ 0.75f - 0.5f, 1 / 9.0f - 0.5f },
+		{ 0.125f - 0.5f, 4 / 9.0f - 0.5f }
+	};
+	for (uint32_t i = 0; i != 4; i++)
+	{
+		float offset[2];
+		HaltonJitter(i, offset);
+		CHECK_NEAR(offset[0], expected[i][0], 1e-6f);
+		CHECK_NEAR(offset[1], expected[i][1], 1e-6f);
+	}
+
+	bool in_pixel = true;
+	for (uint32_t i = 0; i != 1024; i++)
+	{
+		float offset[2];
+		HaltonJitter(i, offset);
+		in_pixel &= (offset[0] >= -0.5f) && (offset[0] < 0.5f) && (offset[1] >= -0.5f) && (offset[1] < 0.5f);
+	}
+	CHECK(in_pixel);
+}
+
+TEST_CASE(TemporalAA, JitterNDCPointsYUp)
+{
+	//Half a pixel right and a quarter down, NDC spans 2 over the viewport
+	const float offset[2] = { 0.5f, 0.25f };
+	float ndc[2];
+	JitterToNDC(offset, 100, 50, ndc);
+	CHECK_NEAR(ndc[0], 0.01f, 1e-7f);
+	CHECK_NEAR(ndc[1], -0.01f, 1e-7f);
+}
+
+TEST_CASE(TemporalAA, ReprojectsPixelCenters)
+{
+	const uint32_t width = 16;
+	const uint32_t height = 8;
+	float m[16];
+	Projection(0, width, m);
+
+	//A still camera puts each pixel's view-space position back at its center
+	for (uint32_t y = 0; y < height; y += 3)
+	{
+		for (uint32_t x = 0; x < width; x += 5)
+		{
+			float z = 3 + x * 0.5f;
+			float pos[3] = { ((x + 0.5f) / width * 2 - 1) / PROJ_X * z, (1 - (y + 0.5f) / height * 2) / PROJ_Y * z, z };
+			float uv[2];
+			REQUIRE(ReprojectToUV(m, pos, uv));
+			CHECK_NEAR(uv[0], (x + 0.5f) / width, 1e-6f);
+			CHECK_NEAR(uv[1], (y + 0.5f) / height, 1e-6f);
+		}
+	}
+
+	//Behind the camera, or on its plane, there's no previous position
+	float uv[2];
+	const float behind[3] = { 0.1f, 0.2f, -1 };
+	CHECK(!ReprojectToUV(m, behind, uv));
+	const float on_plane[3] = { 1, 1, 0 };
+	CHECK(!ReprojectToUV(m, on_plane, uv));
+}
+
+TEST_CASE(TemporalAA, StillCameraConverges)
+{
+	const uint32_t width = 8;
+	const uint32_t height = 6;
+	Random rnd(3);
+	std::vector<float> current(width * height * 3);
+	for (auto& c : current)
+	{
+		c = rnd.Uniform(0, 1);
+	}
+	std::vector<float> depth(width * height, 4);
+	float m[16];
+	Projection(0, width, m);
+
+	//From a black history, each frame closes the gap by the blend factor
+	std::vector<float> history(current.size(), 0);
+	std::vector<float> resolved(current.size());
+	for (int frame = 0; frame != 100; frame++)
+	{
+		ResolveTemporalAA(current.data(), history.data(), depth.data(), width, height, PROJ_X, PROJ_Y, m, 0.1f, resolved.data());
+		history = resolved;
+	}
+	float diff = 0;
+	for (size_t i = 0; i != current.size(); i++)
+	{
+		diff = (std::max)(diff, std::abs(resolved[i] - current[i]));
+	}
+	CHECK(diff < 1e-3f);
+
+	//Without a history the current frame passes through
+	ResolveTemporalAA(current.data(), nullptr, depth.data(), width, height, PROJ_X, PROJ_Y, m, 0.1f, resolved.data());
+	CHECK(resolved == current);
+}
+
+TEST_CASE(TemporalAA, NeighbourhoodClampRemovesStaleColor)
+{
+	//The history remembers green where the scene is now red all around
+	const uint32_t width = 4;
+	const uint32_t height = 4;
+	std::vector<float> current;
+	std::vector<float> history;
+	for (uint32_t i = 0; i != width * height; i++)
+	{
+		const float red[3] = { 1, 0, 0 };
+		const float green[3] = { 0, 1, 0 };
+		current.insert(current.end(), red, red + 3);
+		history.insert(history.end(), green, green + 3);
+	}
+	std::vector<float> depth(width * height, 2);
+	float m[16];
+	Projection(0, width, m);
+
+	std::vector<float> resolved(current.size());
+	ResolveTemporalAA(current.data(), history.data(), depth.data(), width, height, PROJ_X, PROJ_Y, m, 0.1f, resolved.data());
+	CHECK(resolved == current);
+}
+
+TEST_CASE(TemporalAA, GoldenResolve)
+{
+	//The previous camera one pixel to the right, so pixel x reads the history's texel x - 1 exactly and
+	//the first column has no history
+	const uint32_t width = 4;
+	const uint32_t height = 2;
+	std::vector<float> current = Gray({ 0.2f, 0.4f, 0.6f, 0.8f, 0.1f, 0.3f, 0.5f, 0.7f });
+	std::vector<float> history = Gray({ 0.9f, 0, 0.5f, 0.5f, 0.3f, 0.3f, 0.3f, 0.3f });
+	std::vector<float> depth(width * height, 5);
+	float m[16];
+	Projection(-1, width, m);
+
+	std::vector<float> resolved(current.size());
+	ResolveTemporalAA(current.data(), history.data(), depth.data(), width, height, PROJ_X, PROJ_Y, m, 0.25f, resolved.data());
+
+	//E.g. pixel (1, 0): its neighbourhood spans [0.1, 0.6], the history's 0.9 clamps to 0.6 and blends
+	//a quarter of the way to 0.4
+	std::vector<float> expected = Gray({ 0.2f, 0.55f, 0.375f, 0.575f, 0.1f, 0.3f, 0.35f, 0.55f });
+	for (size_t i = 0; i != expected.size(); i++)
+	{
+		CHECK_NEAR(resolved[i], expected[i], 1e-5f);
+	}
+}
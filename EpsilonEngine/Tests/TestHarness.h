@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace epsilon
+{
+	namespace test
+	{
+
+		//Just enough of a test framework for the platform-neutral engine code. TEST_CASE registers a function
+		//under a suite; CHECK* record a failure and carry on, REQUIRE* also end the test. EpsilonEngineTests
+		//runs the suite named on its command line, every suite without one
+
+		typedef void (*TestFunc)();
+
+		struct TestCase
+		{
+			const char* suite;
+			const char* name;
+			TestFunc func;
+		};
+
+		std::vector<TestCase>& TestCases();
+
+		struct TestRegistrar
+		{
+			TestRegistrar(const char* suite, const char* name, TestFunc func);
+		};
+
+		void ReportFailure(const char* file, int line, const std::string& msg);
+
+		//Thrown by REQUIRE*, caught by the runner
+		struct RequireFailed
+		{
+		};
+
+		template <typename T>
+		std::string ToText(const T& v)
+		{
+			std::ostringstream ss;
+			ss.precision(9);
+			ss << v;
+			return ss.str();
+		}
+
+		//Bit-exact, NaNs equal to themselves
+		inline bool SameFloat(float a, float b)
+		{
+			return (a == b) || (std::isnan(a) && std::isnan(b));
+		}
+
+		//Deterministic, so a failure reproduces
+		class Random
+		{
+		public:
+			explicit Random(uint32_t seed = 1) : state_(seed ? seed : 1) {}
+
+			uint32_t Next()
+			{
+				state_ ^= state_ << 13;
+				state_ ^= state_ >> 17;
+				state_ ^= state_ << 5;
+				return state_;
+			}
+
+			float Uniform(float lo, float hi)
+			{
+				return lo + (hi - lo) * ((Next() >> 8) * (1.0f / 16777216.0f));
+			}
+
+		private:
+			uint32_t state_;
+		};
+
+	}
+}
+
+
+#define TEST_CASE(suite, name)\
+	static void suite##_##name();\
+	static epsilon::test::TestRegistrar suite##_##name##_registrar(#suite, #name, suite##_##name);\
+	static void suite##_##name()
+
+#define CHECK(cond)\
+	do { if (!(cond)) { epsilon::test::ReportFailure(__FILE__, __LINE__, #cond); } } while (0)
+
+//Each operand is evaluated once, so a failure reports the values that were compared
+#define CHECK_EQ(a, b)\
+	do { const auto& check_a_ = (a); const auto& check_b_ = (b);\
+		if (!(check_a_ == check_b_)) { epsilon::test::ReportFailure(__FILE__, __LINE__,\
+		std::string(#a " == " #b ": ") + epsilon::test::ToText(check_a_) + " vs " + epsilon::test::ToText(check_b_)); } } while (0)
+
+#define CHECK_NEAR(a, b, eps)\
+	do { const auto& check_a_ = (a); const auto& check_b_ = (b);\
+		if (!(std::abs(check_a_ - check_b_) <= (eps))) { epsilon::test::ReportFailure(__FILE__, __LINE__,\
+		std::string(#a " ~= " #b ": ") + epsilon::test::ToText(check_a_) + " vs " + epsilon::test::ToText(check_b_)); } } while (0)
+
+#define REQUIRE(cond)\
+	do { if (!(cond)) { epsilon::test::ReportFailure(__FILE__, __LINE__, #cond); throw epsilon::test::RequireFailed(); } } while (0)
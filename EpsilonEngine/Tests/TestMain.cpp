@@ -0,0 +1,89 @@
+#include "TestHarness.h"
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+
+namespace epsilon
+{
+	namespace test
+	{
+		int failures_ = 0;
+
+
+		std::vector<TestCase>& TestCases()
+		{
+			static std::vector<TestCase> cases;
+			return cases;
+		}
+
+		TestRegistrar::TestRegistrar(const char* suite, const char* name, TestFunc func)
+		{
+			TestCase tc = { suite, name, func };
+			TestCases().push_back(tc);
+		}
+
+		void ReportFailure(const char* file, int line, const std::string& msg)
+		{
+			std::cerr << file << "(" << line << "): " << msg << std::endl;
+			++failures_;
+		}
+	}
+}
+
+
+//EpsilonEngineTests [suite [test]], or --list for the suites and tests. Fails when nothing matches, so a
+//misspelt CTest entry can't pass by running nothing
+int main(int argc, char* argv[])
+{
+	using namespace epsilon::test;
+
+	if ((argc > 1) && (0 == strcmp(argv[1], "--list")))
+	{
+		for (const auto& tc : TestCases())
+		{
+			std::cout << tc.suite << " " << tc.name << std::endl;
+		}
+		return 0;
+	}
+
+	const char* suite = (argc > 1) ? argv[1] : nullptr;
+	const char* name = (argc > 2) ? argv[2] : nullptr;
+
+	int num_run = 0;
+	int num_failed = 0;
+	for (const auto& tc : TestCases())
+	{
+		if ((suite && strcmp(suite, tc.suite)) || (name && strcmp(name, tc.name)))
+		{
+			continue;
+		}
+
+		int failures_before = failures_;
+		try
+		{
+			tc.func();
+		}
+		catch (const RequireFailed&)
+		{
+		}
+		catch (const std::exception& e)
+		{
+			ReportFailure(tc.suite, 0, std::string("unexpected exception: ") + e.what());
+		}
+
+		bool passed = (failures_ == failures_before);
+		std::cout << (passed ? "[ PASS ] " : "[ FAIL ] ") << tc.suite << "." << tc.name << std::endl;
+		++num_run;
+		num_failed += passed ? 0 : 1;
+	}
+
+	if (0 == num_run)
+	{
+		std::cerr << "No tests match" << std::endl;
+		return 1;
+	}
+
+	std::cout << num_run - num_failed << "/" << num_run << " passed" << std::endl;
+	return (0 == num_failed) ? 0 : 1;
+}
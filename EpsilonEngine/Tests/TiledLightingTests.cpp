@@ -0,0 +1,208 @@
+#include "TestHarness.h"
+#include "TiledLighting.h"
+#include <algorithm>
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	//Partial tiles at both edges
+	const uint32_t WIDTH = 37;
+	const uint32_t HEIGHT = 21;
+
+	PackedLight MakeLight(const float rect[4], float z, float range)
+	{
+		PackedLight light = {};
+		std::copy(rect, rect + 4, light.screen_rect);
+		light.pos_es[2] = z;
+		light.range = range;
+		return light;
+	}
+
+	//Whether the light's rectangle meets the pixel's own NDC square and its range the pixel's depth
+	bool LightTouchesPixel(const PackedLight& light, uint32_t x, uint32_t y, float z)
+	{
+		float px0 = static_cast<float>(x) / WIDTH * 2 - 1;
+		float px1 = static_cast<float>(x + 1) / WIDTH * 2 - 1;
+		float py0 = 1 - static_cast<float>(y + 1) / HEIGHT * 2;
+		float py1 = 1 - static_cast<float>(y) / HEIGHT * 2;
+		const float* sr = light.screen_rect;
+		return (sr[0] <= px1) && (sr[2] >= px0) && (sr[1] <= py1) && (sr[3] >= py0)
+			&& (std::abs(light.pos_es[2] - z) <= light.range);
+	}
+}
+
+
+TEST_CASE(TiledLighting, DispatchCoversPartialTiles)
+{
+	uint32_t gx, gy;
+	LightingDispatchSize(1280, 720, gx, gy);
+	CHECK_EQ(gx, 160u);
+	CHECK_EQ(gy, 90u);
+
+	LightingDispatchSize(1281, 721, gx, gy);
+	CHECK_EQ(gx, 161u);
+	CHECK_EQ(gy, 91u);
+
+	LightingDispatchSize(1, 1, gx, gy);
+	CHECK_EQ(gx, 1u);
+	CHECK_EQ(gy, 1u);
+}
+
+TEST_CASE(TiledLighting, TileRectsEndAtTheViewport)
+{
+	//The top left tile starts at the NDC corner, y up
+	float rect[4];
+	TileNDCRect(0, 0, 1281, 721, rect);
+	CHECK_EQ(rect[0], -1.0f);
+	CHECK_EQ(rect[3], 1.0f);
+	CHECK_NEAR(rect[2], 8.0f / 1281 * 2 - 1, 1e-6f);
+	CHECK_NEAR(rect[1], 1 - 8.0f / 721 * 2, 1e-6f);
+
+	//The partial tiles at the right and bottom are one pixel wide and end at the viewport's edges
+	TileNDCRect(160, 90, 1281, 721, rect);
+	CHECK_NEAR(rect[0], 1280.0f / 1281 * 2 - 1, 1e-6f);
+	CHECK_EQ(rect[2], 1.0f);
+	CHECK_EQ(rect[1], -1.0f);
+	CHECK_NEAR(rect[3], 1 - 720.0f / 721 * 2, 1e-6f);
+	CHECK(rect[0] < rect[2]);
+	CHECK(rect[1] < rect[3]);
+}
+
+TEST_CASE(TiledLighting, DepthBoundsOfAPartialTile)
+{
+	//10x10 leaves the last tile 2x2, the pixels around it far out of its range
+	const uint32_t width = 10;
+	const uint32_t height = 10;
+	std::vector<float> depth(width * height, -100.0f);
+	depth[8 * width + 8] = 3;
+	depth[8 * width + 9] = 5;
+	depth[9 * width + 8] = 4;
+	depth[9 * width + 9] = 7;
+
+	float bounds[2];
+	TileDepthBounds(depth.data(), width, height, 1, 1, bounds);
+	CHECK_EQ(bounds[0], 3.0f);
+	CHECK_EQ(bounds[1], 7.0f);
+
+	//And a full tile sees all 64 of its pixels
+	depth[7 * width + 7] = 50;
+	TileDepthBounds(depth.data(), width, height, 0, 0, bounds);
+	CHECK_EQ(bounds[0], -100.0f);
+	CHECK_EQ(bounds[1], 50.0f);
+}
+
+TEST_CASE(TiledLighting, ListsMatchPerPixelOverlap)
+{
+	Random rnd(7);
+	std::vector<float> depth(WIDTH * HEIGHT);
+	for (auto& z : depth)
+	{
+		z = rnd.Uniform(1, 20);
+	}
+
+	std::vector<PackedLight> lights;
+	for (uint32_t i = 0; i != 64; i++)
+	{
+		float x = rnd.Uniform(-1.2f, 1.2f);
+		float y = rnd.Uniform(-1.2f, 1.2f);
+		float w = rnd.Uniform(0.01f, 0.4f);
+		float h = rnd.Uniform(0.01f, 0.4f);
+		float rect[4] = { x - w, y - h, x + w, y + h };
+		lights.push_back(MakeLight(rect, rnd.Uniform(-5, 30), rnd.Uniform(0.5f, 6)));
+	}
+
+	//One that covers no pixel
+	const float empty_rect[4] = { 1, 1, -1, -1 };
+	lights.push_back(MakeLight(empty_rect, 10, 100));
+
+	TileLightLists lists;
+	BuildTileLightLists(lights.data(), lights.size(), depth.data(), WIDTH, HEIGHT, lists);
+	REQUIRE(lists.groups_x == 5);
+	REQUIRE(lists.groups_y == 3);
+
+	uint32_t num_listed = 0;
+	uint32_t num_culled = 0;
+	for (uint32_t ty = 0; ty != lists.groups_y; ty++)
+	{
+		for (uint32_t tx = 0; tx != lists.groups_x; tx++)
+		{
+			size_t tile = static_cast<size_t>(ty) * lists.groups_x + tx;
+			const uint32_t* begin = &lists.indices[tile * MAX_TILE_LIGHTS];
+			const uint32_t* end = begin + lists.counts[tile];
+			CHECK(std::is_sorted(begin, end));
+			num_listed += lists.counts[tile];
+
+			float z_min = 1e30f;
+			float z_max = -1e30f;
+			for (uint32_t y = ty * LIGHTING_TILE_SIZE; y != (std::min)((ty + 1) * LIGHTING_TILE_SIZE, HEIGHT); y++)
+			{
+				for (uint32_t x = tx * LIGHTING_TILE_SIZE; x != (std::min)((tx + 1) * LIGHTING_TILE_SIZE, WIDTH); x++)
+				{
+					z_min = (std::min)(z_min, depth[y * WIDTH + x]);
+					z_max = (std::max)(z_max, depth[y * WIDTH + x]);
+				}
+			}
+
+			for (uint32_t i = 0; i != lights.size(); i++)
+			{
+				//Every light lighting one of the tile's pixels is listed, listed ones at least meet a pixel's
+				//square and the tile's depth range, the list is conservative in depth only
+				PackedLight any_depth = lights[i];
+				any_depth.range = 1e30f;
+				bool touches = false;
+				bool meets_rect = false;
+				for (uint32_t y = ty * LIGHTING_TILE_SIZE; y != (std::min)((ty + 1) * LIGHTING_TILE_SIZE, HEIGHT); y++)
+				{
+					for (uint32_t x = tx * LIGHTING_TILE_SIZE; x != (std::min)((tx + 1) * LIGHTING_TILE_SIZE, WIDTH); x++)
+					{
+						touches |= LightTouchesPixel(lights[i], x, y, depth[y * WIDTH + x]);
+						meets_rect |= LightTouchesPixel(any_depth, x, y, 0);
+					}
+				}
+				bool in_range = (lights[i].pos_es[2] - lights[i].range <= z_max) && (lights[i].pos_es[2] + lights[i].range >= z_min);
+
+				bool listed = std::find(begin, end, i) != end;
+				CHECK_EQ(listed, meets_rect && in_range);
+				if (touches)
+				{
+					CHECK(listed);
+				}
+				num_culled += (meets_rect && !listed) ? 1 : 0;
+			}
+
+			CHECK(std::find(begin, end, static_cast<uint32_t>(lights.size() - 1)) == end);
+		}
+	}
+
+	//The scene has to exercise both the rectangle and the depth test
+	CHECK(num_listed > 0);
+	CHECK(num_culled > 0);
+}
+
+TEST_CASE(TiledLighting, OverflowingListsKeepTheFirstLights)
+{
+	std::vector<float> depth(WIDTH * HEIGHT, 10.0f);
+	const float full_rect[4] = { -1, -1, 1, 1 };
+	std::vector<PackedLight> lights(MAX_TILE_LIGHTS + 44, MakeLight(full_rect, 10, 1));
+
+	//One more that only the top left tile gets, past the cap there too
+	const float corner_rect[4] = { -1, 0.99f, -0.99f, 1 };
+	lights.push_back(MakeLight(corner_rect, 10, 1));
+
+	TileLightLists lists;
+	BuildTileLightLists(lights.data(), lights.size(), depth.data(), WIDTH, HEIGHT, lists);
+	for (size_t tile = 0; tile != lists.counts.size(); tile++)
+	{
+		REQUIRE(lists.counts[tile] == MAX_TILE_LIGHTS);
+		bool in_order = true;
+		for (uint32_t i = 0; i != MAX_TILE_LIGHTS; i++)
+		{
+			in_order &= (lists.indices[tile * MAX_TILE_LIGHTS + i] == i);
+		}
+		CHECK(in_order);
+	}
+}
@@ -0,0 +1,209 @@
+#include "TestHarness.h"
+#include "Transform.h"
+#include <vector>
+
+using namespace epsilon;
+using namespace epsilon::test;
+
+
+namespace
+{
+	Vector4f RandomRotation(Random& rng)
+	{
+		return Normalize(Vector4f(rng.Uniform(-1, 1), rng.Uniform(-1, 1), rng.Uniform(-1, 1), rng.Uniform(-1, 1)));
+	}
+
+	//A random hierarchy, each node's parent one of the nodes before it or none
+	void BuildHierarchy(TransformSystem& ts, Random& rng, size_t count)
+	{
+		for (size_t i = 0; i != count; i++)
+		{
+			TransformHandle parent = ((i == 0) || (rng.Next() % 5 == 0)) ? INVALID_TRANSFORM
+				: static_cast<TransformHandle>(rng.Next() % i);
+			TransformHandle h = ts.Create(parent);
+			ts.SetPosition(h, Vector3f(rng.Uniform(-10, 10), rng.Uniform(-10, 10), rng.Uniform(-10, 10)));
+			ts.SetRotation(h, RandomRotation(rng));
+			ts.SetScale(h, Vector3f(rng.Uniform(0.5f, 2), rng.Uniform(0.5f, 2), rng.Uniform(0.5f, 2)));
+		}
+	}
+
+	//What Update computed per node before it was batched
+	XMMATRIX ReferenceWorld(const TransformSystem& ts, TransformHandle h)
+	{
+		XMMATRIX local = XMMatrixAffineTransformation(ts.Scale(h).XMV(), XMVectorZero(),
+			ts.Rotation(h).XMV(), ts.Position(h).XMV());
+		TransformHandle p = ts.Parent(h);
+		return (p != INVALID_TRANSFORM) ? XMMatrixMultiply(local, ReferenceWorld(ts, p)) : local;
+	}
+
+	bool MatchesReference(const TransformSystem& ts, TransformHandle h, float eps)
+	{
+		XMFLOAT4X4 ref;
+		XMStoreFloat4x4(&ref, ReferenceWorld(ts, h));
+		const float* a = &ts.WorldMatrix(h)._11;
+		const float* b = &ref._11;
+		for (size_t i = 0; i != 16; i++)
+		{
+			if (!(std::abs(a[i] - b[i]) <= eps * (std::max)(1.0f, std::abs(b[i]))))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+
+TEST_CASE(Transform, UpdateMatchesPerNodeReference)
+{
+	SIMDLevel detected = DetectSIMDLevel();
+	for (int level = SL_Scalar; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+
+		TransformSystem ts;
+		Random rng(11);
+		BuildHierarchy(ts, rng, 1000);
+		ts.Update();
+
+		for (TransformHandle h = 0; h != ts.Count(); h++)
+		{
+			CHECK(MatchesReference(ts, h, 1e-4f));
+		}
+	}
+	ForceSIMDLevel(detected);
+}
+
+TEST_CASE(Transform, DirtyParentUpdatesSubtreeOnly)
+{
+	TransformSystem ts;
+	TransformHandle root = ts.Create();
+	TransformHandle child = ts.Create(root);
+	TransformHandle grandchild = ts.Create(child);
+	TransformHandle other = ts.Create();
+	ts.SetPosition(child, Vector3f(1, 0, 0));
+	ts.SetPosition(grandchild, Vector3f(0, 1, 0));
+	ts.SetPosition(other, Vector3f(0, 0, 5));
+	ts.Update();
+
+	CHECK_EQ(ts.WorldMatrix(grandchild)._41, 1.0f);
+	CHECK_EQ(ts.WorldMatrix(grandchild)._42, 1.0f);
+
+	//Moving the root moves everything under it and nothing else
+	ts.SetPosition(root, Vector3f(10, 0, 0));
+	ts.Update();
+
+	CHECK_EQ(ts.WorldMatrix(child)._41, 11.0f);
+	CHECK_EQ(ts.WorldMatrix(grandchild)._41, 11.0f);
+	CHECK_EQ(ts.WorldMatrix(grandchild)._42, 1.0f);
+	CHECK_EQ(ts.WorldMatrix(other)._41, 0.0f);
+	CHECK_EQ(ts.WorldMatrix(other)._43, 5.0f);
+
+	//Scale and rotation of a parent apply to its children's offsets
+	ts.SetScale(root, Vector3f(2, 2, 2));
+	ts.SetRotation(root, Vector4f(0, 0, std::sin(XM_PI / 4), std::cos(XM_PI / 4)));
+	ts.Update();
+	CHECK(MatchesReference(ts, grandchild, 1e-5f));
+	CHECK_NEAR(ts.WorldMatrix(child)._41, 10.0f, 1e-5f);
+	CHECK_NEAR(ts.WorldMatrix(child)._42, 2.0f, 1e-5f);
+}
+
+TEST_CASE(Transform, PartialUpdatesMatchFullRebuild)
+{
+	TransformSystem ts;
+	Random rng(12);
+	BuildHierarchy(ts, rng, 2000);
+	ts.Update();
+
+	for (int frame = 0; frame != 10; frame++)
+	{
+		for (int i = 0; i != 50; i++)
+		{
+			TransformHandle h = rng.Next() % ts.Count();
+			ts.SetPosition(h, Vector3f(rng.Uniform(-10, 10), rng.Uniform(-10, 10), rng.Uniform(-10, 10)));
+			ts.SetRotation(h, RandomRotation(rng));
+		}
+		ts.Update();
+	}
+
+	for (TransformHandle h = 0; h != ts.Count(); h++)
+	{
+		CHECK(MatchesReference(ts, h, 1e-4f));
+	}
+}
+
+TEST_CASE(Transform, AccessorsAndClear)
+{
+	TransformSystem ts;
+	TransformHandle h = ts.Create();
+	CHECK_EQ(ts.Rotation(h).w, 1.0f);
+	CHECK_EQ(ts.Scale(h).y, 1.0f);
+
+	ts.SetPosition(h, Vector3f(1, 2, 3));
+	CHECK_EQ(ts.Position(h).z, 3.0f);
+	CHECK_EQ(ts.Parent(h), INVALID_TRANSFORM);
+
+	bool threw = false;
+	try
+	{
+		ts.Create(5);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	ts.Clear();
+	CHECK_EQ(ts.Count(), static_cast<size_t>(0));
+	ts.Update();
+}
+
+TEST_CASE(Transform, BatchKernelsMatchScalar)
+{
+	Random rng(13);
+	const size_t count = 103;
+	std::vector<float> streams(count * 10);
+	for (size_t i = 0; i != count; i++)
+	{
+		Vector4f q = RandomRotation(rng);
+		float values[10] = { rng.Uniform(0.5f, 2), rng.Uniform(0.5f, 2), rng.Uniform(0.5f, 2), q.x, q.y, q.z, q.w,
+			rng.Uniform(-10, 10), rng.Uniform(-10, 10), rng.Uniform(-10, 10) };
+		for (size_t c = 0; c != 10; c++)
+		{
+			streams[c * count + i] = values[c];
+		}
+	}
+	const float* s = streams.data();
+	ConstFloat3Streams scales(s, s + count, s + count * 2);
+	ConstFloat4Streams rotations(s + count * 3, s + count * 4, s + count * 5, s + count * 6);
+	ConstFloat3Streams translations(s + count * 7, s + count * 8, s + count * 9);
+
+	SIMDLevel detected = DetectSIMDLevel();
+	ForceSIMDLevel(SL_Scalar);
+	std::vector<float> ref_mats(count * 16);
+	std::vector<float> ref_products(count * 16);
+	AffineMatrices(scales, rotations, translations, ref_mats.data(), count);
+	MultiplyMatrices(ref_mats.data(), ref_mats.data() + 16, ref_products.data(), count - 1);
+
+	for (int level = SL_Scalar; level <= detected; level++)
+	{
+		ForceSIMDLevel(static_cast<SIMDLevel>(level));
+		std::vector<float> mats(count * 16);
+		AffineMatrices(scales, rotations, translations, mats.data(), count);
+		std::vector<float> products(mats);
+		MultiplyMatrices(products.data(), mats.data() + 16, products.data(), count - 1);
+
+		//Same operations in the same order on every path
+		bool same_mats = true;
+		bool same_products = true;
+		for (size_t i = 0; i != mats.size(); i++)
+		{
+			same_mats &= SameFloat(mats[i], ref_mats[i]);
+			same_products &= (i >= (count - 1) * 16) || SameFloat(products[i], ref_products[i]);
+		}
+		CHECK(same_mats);
+		CHECK(same_products);
+	}
+	ForceSIMDLevel(detected);
+}